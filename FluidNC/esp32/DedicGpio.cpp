@@ -0,0 +1,52 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Dedicated GPIO outputs
+// Uses the dedic_gpio driver for setup and the CPU instruction from ESP-IDF v4.4 for writing
+
+#include "Driver/DedicGpio.h"
+
+#include <sdkconfig.h>  // CONFIG_IDF_TARGET_*
+#include <esp_attr.h>
+
+#ifdef CONFIG_IDF_TARGET_ESP32S3
+#    include <driver/dedic_gpio.h>
+#    include <hal/dedic_gpio_cpu_ll.h>
+
+static uint32_t out_offset = 0;
+
+bool dedic_gpio_init(const pinnum_t* pins, int count) {
+    int gpios[dedicGpioMaxPins];
+    if (count > dedicGpioMaxPins) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        gpios[i] = pins[i];
+    }
+    dedic_gpio_bundle_config_t bundleConfig = {
+        .gpio_array = gpios,
+        .array_size = size_t(count),
+        .flags      = {
+                 .in_en      = 0,
+                 .in_invert  = 0,
+                 .out_en     = 1,
+                 .out_invert = 0,
+        },
+    };
+    dedic_gpio_bundle_handle_t bundle;
+    if (dedic_gpio_new_bundle(&bundleConfig, &bundle) != ESP_OK) {
+        return false;
+    }
+    dedic_gpio_get_out_offset(bundle, &out_offset);
+    return true;
+}
+
+void IRAM_ATTR dedic_gpio_write(uint32_t mask, uint32_t value) {
+    dedic_gpio_cpu_ll_write_mask(mask << out_offset, value << out_offset);
+}
+#else
+bool dedic_gpio_init(const pinnum_t* pins, int count) {
+    return false;
+}
+
+void IRAM_ATTR dedic_gpio_write(uint32_t mask, uint32_t value) {}
+#endif
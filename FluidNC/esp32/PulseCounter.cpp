@@ -0,0 +1,100 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Pulse counting with the PCNT peripheral
+// Uses the pcnt driver for setup and the pcnt_ll API from ESP-IDF v4.4 for reading
+
+#include "Driver/PulseCounter.h"
+
+#include <driver/pcnt.h>
+#include <hal/pcnt_ll.h>
+#include <soc/pcnt_periph.h>
+#include <soc/gpio_periph.h>
+#include <esp_rom_gpio.h>
+#include <esp_attr.h>
+
+static int next_unit = 0;
+
+int pulse_counter_attach(pinnum_t pin, bool falling) {
+    if (next_unit >= SOC_PCNT_UNITS_PER_GROUP) {
+        return -1;
+    }
+    pcnt_unit_t unit = pcnt_unit_t(next_unit);
+
+    // The pulse input is routed below, so the driver does not turn the pin into an input
+    pcnt_config_t pcntConfig = {
+        .pulse_gpio_num = PCNT_PIN_NOT_USED,
+        .ctrl_gpio_num  = PCNT_PIN_NOT_USED,
+        .lctrl_mode     = PCNT_MODE_KEEP,
+        .hctrl_mode     = PCNT_MODE_KEEP,
+        .pos_mode       = falling ? PCNT_COUNT_DIS : PCNT_COUNT_INC,
+        .neg_mode       = falling ? PCNT_COUNT_INC : PCNT_COUNT_DIS,
+        .counter_h_lim  = int16_t(pulseCounterLimit),
+        .counter_l_lim  = -int16_t(pulseCounterLimit),
+        .unit           = unit,
+        .channel        = PCNT_CHANNEL_0,
+    };
+    if (pcnt_unit_config(&pcntConfig) != ESP_OK) {
+        return -1;
+    }
+    // Step pulses are only a few microseconds long, shorter than the filter can pass
+    pcnt_filter_disable(unit);
+
+    PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[pin]);
+    esp_rom_gpio_connect_in_signal(pin, pcnt_periph_signals.groups[0].units[unit].channels[0].pulse_sig, false);
+
+    pcnt_counter_pause(unit);
+    pcnt_counter_clear(unit);
+    pcnt_counter_resume(unit);
+
+    return next_unit++;
+}
+
+// Each channel counts the edges of one signal, in the direction that the level
+// of the other one gives at the time
+int pulse_counter_attach_quadrature(pinnum_t a, pinnum_t b) {
+    if (next_unit >= SOC_PCNT_UNITS_PER_GROUP) {
+        return -1;
+    }
+    pcnt_unit_t unit = pcnt_unit_t(next_unit);
+
+    pcnt_config_t pcntConfig = {
+        .pulse_gpio_num = int(a),
+        .ctrl_gpio_num  = int(b),
+        .lctrl_mode     = PCNT_MODE_KEEP,
+        .hctrl_mode     = PCNT_MODE_REVERSE,
+        .pos_mode       = PCNT_COUNT_INC,
+        .neg_mode       = PCNT_COUNT_DEC,
+        .counter_h_lim  = int16_t(pulseCounterLimit),
+        .counter_l_lim  = -int16_t(pulseCounterLimit),
+        .unit           = unit,
+        .channel        = PCNT_CHANNEL_0,
+    };
+    if (pcnt_unit_config(&pcntConfig) != ESP_OK) {
+        return -1;
+    }
+    pcntConfig.pulse_gpio_num = int(b);
+    pcntConfig.ctrl_gpio_num  = int(a);
+    pcntConfig.pos_mode       = PCNT_COUNT_DEC;
+    pcntConfig.neg_mode       = PCNT_COUNT_INC;
+    pcntConfig.channel        = PCNT_CHANNEL_1;
+    if (pcnt_unit_config(&pcntConfig) != ESP_OK) {
+        return -1;
+    }
+
+    pcnt_counter_pause(unit);
+    pcnt_counter_clear(unit);
+    pcnt_counter_resume(unit);
+
+    return next_unit++;
+}
+
+void pulse_counter_set_filter(int unit, uint16_t apb_cycles) {
+    pcnt_set_filter_value(pcnt_unit_t(unit), apb_cycles);
+    pcnt_filter_enable(pcnt_unit_t(unit));
+}
+
+uint32_t IRAM_ATTR pulse_counter_read(int unit) {
+    int16_t count;
+    pcnt_ll_get_counter_value(&PCNT, pcnt_unit_t(unit), &count);
+    return uint16_t(count);
+}
@@ -9,6 +9,7 @@
 #include "src/Config.h"
 
 #include <soc/ledc_struct.h>  // LEDC
+#include <type_traits>
 
 #include "soc/soc_caps.h"
 #include "driver/ledc.h"
@@ -33,6 +34,9 @@
 #    error Target CONFIG_IDF_TARGET is not supported
 #endif
 
+// The registers of one LEDC channel
+using ledc_channel_regs_t = std::remove_reference_t<decltype(LEDC.channel_group[0].channel[0])>;
+
 static int allocateChannel() {
     static int nextLedcChannel = 0;
 
@@ -105,22 +109,29 @@ PwmPin::PwmPin(Pin& pin, uint32_t frequency) : _frequency(frequency) {
         log_error("ledc channel setup failed");
         throw -1;
     }
+    _regs = &LEDC.channel_group[group].channel[_channel % 8];
 }
 
 void IRAM_ATTR PwmPin::setDuty(uint32_t duty) {
-    uint8_t g = _channel >> 3, c = _channel & 7;
-    bool    on = duty != 0;
+    auto regs = static_cast<ledc_channel_regs_t*>(_regs);
+    bool on   = duty != 0;
 
     // This is like ledcWrite, but it is called from an ISR
     // and ledcWrite uses RTOS features not compatible with ISRs
     // Also, ledcWrite infers enable from duty, which is incorrect
     // for use with RcServo which wants the
 
-    // We might be able to use ledc_duty_config() which is IRAM_ATTR
-
-    LEDC.channel_group[g].channel[c].duty.duty        = duty << 4;
-    LEDC.channel_group[g].channel[c].conf0.sig_out_en = on;
-    LEDC.channel_group[g].channel[c].conf1.duty_start = on;
+    // ledc_set_duty() and ledc_update_duty() would check their arguments and take
+    // a spinlock on every call, so the registers are written directly.  The duty
+    // register has 4 fractional bits.
+    regs->duty.duty        = duty << 4;
+    regs->conf0.sig_out_en = on;
+    regs->conf1.duty_start = on;
+#if !SOC_LEDC_SUPPORT_HS_MODE
+    // Without the ESP32's high speed channels, new settings take effect at the
+    // end of the current period only once they are latched.
+    regs->conf0.para_up = 1;
+#endif
 }
 
 PwmPin::~PwmPin() {
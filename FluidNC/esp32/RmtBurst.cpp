@@ -0,0 +1,127 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Driver/RmtBurst.h"
+#include "Driver/delay_usecs.h"  // getCpuTicks()
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <sdkconfig.h>
+#include <soc/rmt_struct.h>
+#include <soc/soc_caps.h>
+
+static const uint32_t rmtWords    = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+static const uint32_t maxDuration = 0x7fff;  // RMT item durations are 15 bits
+
+// Each filler item covers at least maxDuration, so this many are enough for the longest burst
+static const uint32_t maxFillers = rmtBurstMaxUsecs / maxDuration + 1;
+
+// Bursts are built in RAM and copied to the channel memory once the channel is idle
+static uint32_t staged[SOC_RMT_CHANNELS_PER_GROUP][rmtWords];
+static uint32_t stagedLength[SOC_RMT_CHANNELS_PER_GROUP];
+static uint32_t pending = 0;  // Channels with a staged burst
+static uint32_t busy    = 0;  // Channels that may still be sending
+
+static inline uint32_t IRAM_ATTR rmtItem(uint32_t level0, uint32_t duration0, uint32_t level1, uint32_t duration1) {
+    return duration0 | (level0 << 15) | (duration1 << 16) | (level1 << 31);
+}
+
+static inline uint32_t IRAM_ATTR txEndBit(int channel) {
+#ifdef CONFIG_IDF_TARGET_ESP32
+    return 1 << (channel * 3);
+#else
+    return 1 << channel;
+#endif
+}
+
+static inline void IRAM_ATTR txStart(int channel) {
+#ifdef CONFIG_IDF_TARGET_ESP32
+    RMT.conf_ch[channel].conf1.mem_rd_rst = 1;
+    RMT.conf_ch[channel].conf1.mem_rd_rst = 0;
+    RMT.conf_ch[channel].conf1.tx_start   = 1;
+#endif
+#ifdef CONFIG_IDF_TARGET_ESP32S3
+    RMT.chnconf0[channel].mem_rd_rst_n = 1;
+    RMT.chnconf0[channel].mem_rd_rst_n = 0;
+    RMT.chnconf0[channel].tx_start_n   = 1;
+#endif
+}
+
+uint32_t rmtBurstCapacity() {
+    // One item per pulse, plus the fillers and the end marker
+    return rmtWords - maxFillers - 1;
+}
+
+void IRAM_ATTR rmtBurstPulses(int channel, bool invert, const uint32_t* starts, uint32_t count, uint32_t pulseUsecs) {
+    uint32_t  idle   = invert;
+    uint32_t  active = !invert;
+    uint32_t* items  = staged[channel];
+    uint32_t  n      = 0;
+    uint32_t  t      = 0;  // Time at the end of the last item
+
+    for (uint32_t i = 0; i < count && n < rmtWords - maxFillers - 1; i++) {
+        // A zero duration would end the burst, so pulses that are too close are pushed back by 1 us
+        uint32_t gap = starts[i] > t ? starts[i] - t : 1;
+        t += gap + pulseUsecs;
+        // Gaps that are too long for one item are filled with idle items
+        while (gap > maxDuration) {
+            uint32_t fill = gap - 1 < 2 * maxDuration ? gap - 1 : 2 * maxDuration;
+            items[n++]    = rmtItem(idle, fill / 2, idle, fill - fill / 2);
+            gap -= fill;
+        }
+        items[n++] = rmtItem(idle, gap, active, pulseUsecs);
+    }
+    items[n++] = 0;  // End marker
+
+    stagedLength[channel] = n;
+    pending |= 1 << channel;
+}
+
+void IRAM_ATTR rmtBurstStart() {
+    // The previous bursts normally ended before this one was computed, but
+    // a long computation of the previous burst can push its end a little later.
+    uint32_t waiting = busy & pending;
+    int32_t  timeout = usToEndTicks(200);
+    while (waiting && (getCpuTicks() - timeout) < 0) {
+        for (int channel = 0; channel < SOC_RMT_CHANNELS_PER_GROUP; channel++) {
+            if ((waiting & (1 << channel)) && (RMT.int_raw.val & txEndBit(channel))) {
+                waiting &= ~(1 << channel);
+            }
+        }
+    }
+
+    for (int channel = 0; channel < SOC_RMT_CHANNELS_PER_GROUP; channel++) {
+        if (pending & (1 << channel)) {
+            volatile uint32_t* mem   = &RMTMEM.chan[channel].data32[0].val;
+            uint32_t*          items = staged[channel];
+            for (uint32_t i = 0; i < stagedLength[channel]; i++) {
+                mem[i] = items[i];
+            }
+            RMT.int_clr.val = txEndBit(channel);
+        }
+    }
+    for (int channel = 0; channel < SOC_RMT_CHANNELS_PER_GROUP; channel++) {
+        if (pending & (1 << channel)) {
+            txStart(channel);
+        }
+    }
+    busy |= pending;
+    pending = 0;
+}
+
+void IRAM_ATTR rmtBurstStop() {
+    // Pointing the channels at an end marker stops them after the current item
+    for (int channel = 0; channel < SOC_RMT_CHANNELS_PER_GROUP; channel++) {
+        if (busy & (1 << channel)) {
+            RMTMEM.chan[channel].data32[0].val = 0;
+            txStart(channel);
+        }
+    }
+    busy    = 0;
+    pending = 0;
+}
+
+void rmtBurstSinglePulse(int channel, bool invert, uint32_t dirDelayUsecs, uint32_t pulseUsecs) {
+    uint32_t idle = invert;
+
+    RMTMEM.chan[channel].data32[0].val = rmtItem(idle, dirDelayUsecs ? dirDelayUsecs : 1, !idle, pulseUsecs);
+    RMTMEM.chan[channel].data32[1].val = 0;
+}
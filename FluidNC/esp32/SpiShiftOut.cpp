@@ -0,0 +1,232 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// 74HC595 chains on VSPI, driven from its registers.  The spi_master driver
+// cannot start a transfer from an interrupt, and a transfer per descriptor
+// has to follow the last with as short a gap as possible.
+// Uses the spicommon claim functions from ESP-IDF v4.4 so that the bus and
+// DMA channel are not given to the spi section as well.
+
+#include "Driver/SpiShiftOut.h"
+
+#include <sdkconfig.h>
+
+#ifdef CONFIG_IDF_TARGET_ESP32
+#    include <driver/gpio.h>
+#    include <driver/periph_ctrl.h>
+#    include <driver/spi_common_internal.h>
+#    include <esp_attr.h>
+#    include <esp_intr_alloc.h>
+#    include <freertos/FreeRTOS.h>
+#    include <rom/gpio.h>
+#    include <soc/gpio_periph.h>
+#    include <soc/gpio_sig_map.h>
+#    include <soc/gpio_struct.h>
+#    include <soc/spi_struct.h>
+
+// In dual output mode the first bit of each pair goes out on Q, as in SPI
+// flash dual output, so the latch takes the odd bits of each byte
+static const uint8_t  latchBit = 0x80;
+static const uint32_t tailBits = 2;  // The extra latch clock
+
+static spiShiftOutDone_t doneCallback = nullptr;
+static intr_handle_t     isrHandle;
+
+static lldesc_t* sending = nullptr;  // Descriptor of the DMA transfer in progress
+static bool      busy    = false;
+static bool      pending = false;  // A write is waiting for the transfer in progress
+static uint32_t  pendingSample;
+
+static portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static void configure() {
+    SPI3.slave.val    = 0;  // Master
+    SPI3.pin.val      = 0;  // SCK idles low
+    SPI3.pin.cs0_dis  = 1;
+    SPI3.pin.cs1_dis  = 1;
+    SPI3.pin.cs2_dis  = 1;
+    SPI3.ctrl.val     = 0;  // MSB first
+    SPI3.ctrl2.val    = 0;
+    SPI3.user.val     = 0;  // Data out on the falling edge, as for SPI mode 0
+    SPI3.user1.val    = 0;
+    SPI3.user2.val    = 0;
+    SPI3.dma_conf.val = 0;
+
+    SPI3.user.usr_mosi    = 1;
+    SPI3.user.fwrite_dual = 1;
+
+    // 80 MHz APB / 10 = 8 MHz, 32 clocks per 4 us sample
+    SPI3.clock.val      = 0;
+    SPI3.clock.clkcnt_n = 9;
+    SPI3.clock.clkcnt_h = 4;
+    SPI3.clock.clkcnt_l = 9;
+
+    SPI3.slave.trans_done  = 0;
+    SPI3.slave.trans_inten = 1;
+}
+
+static inline void IRAM_ATTR resetDma() {
+    SPI3.dma_conf.out_rst       = 1;
+    SPI3.dma_conf.out_rst       = 0;
+    SPI3.dma_conf.ahbm_fifo_rst = 1;
+    SPI3.dma_conf.ahbm_fifo_rst = 0;
+}
+
+// Call with the spinlock held
+static void IRAM_ATTR startDma(lldesc_t* desc) {
+    uint8_t* buf = (uint8_t*)desc->buf;
+    uint32_t len = desc->length;
+
+    buf[0] &= ~latchBit;  // Nothing has been shifted in yet
+    buf[len]     = latchBit;
+    desc->length = len + 1;
+    sending      = desc;
+
+    resetDma();
+    SPI3.dma_out_link.addr          = uint32_t(desc) & 0xfffff;
+    SPI3.dma_out_link.start         = 1;
+    SPI3.mosi_dlen.usr_mosi_dbitlen = len * 8 + tailBits - 1;
+    SPI3.cmd.usr                    = 1;
+    busy                            = true;
+}
+
+// Call with the spinlock held
+static void IRAM_ATTR startWrite(uint32_t sample) {
+    uint32_t words[2];
+    spiShiftOutEncode(words, sample);
+
+    resetDma();
+    SPI3.data_buf[0]                = words[0] & ~latchBit;
+    SPI3.data_buf[1]                = words[1];
+    SPI3.data_buf[2]                = latchBit;
+    SPI3.mosi_dlen.usr_mosi_dbitlen = spiShiftOutSampleBytes * 8 + tailBits - 1;
+    SPI3.cmd.usr                    = 1;
+    busy                            = true;
+}
+
+static void IRAM_ATTR spiShiftOutIsr(void* arg) {
+    SPI3.slave.trans_done = 0;
+
+    portENTER_CRITICAL_ISR(&spinlock);
+    lldesc_t* done = sending;
+    lldesc_t* next = nullptr;
+    sending        = nullptr;
+    busy           = false;
+    if (done) {
+        done->length -= 1;  // Give back the tail
+        next = done->qe.stqe_next;
+        if (next) {
+            startDma(next);
+        }
+    }
+    if (!busy && pending) {
+        pending = false;
+        startWrite(pendingSample);
+    }
+    portEXIT_CRITICAL_ISR(&spinlock);
+
+    if (done) {
+        doneCallback(done, next == nullptr);
+    }
+}
+
+bool spiShiftOutInit(spiShiftOutDone_t done) {
+    if (!spicommon_periph_claim(VSPI_HOST, "spiso")) {
+        return false;
+    }
+    uint32_t txChannel, rxChannel;
+    if (spicommon_slave_dma_chan_alloc(VSPI_HOST, SPI_DMA_CH_AUTO, &txChannel, &rxChannel) != ESP_OK) {
+        spicommon_periph_free(VSPI_HOST);
+        return false;
+    }
+    doneCallback = done;
+    configure();
+    esp_intr_alloc(ETS_SPI3_INTR_SOURCE, ESP_INTR_FLAG_IRAM, spiShiftOutIsr, nullptr, &isrHandle);
+    return true;
+}
+
+static void route(pinnum_t pin, uint32_t signal) {
+    PIN_FUNC_SELECT(GPIO_PIN_MUX_REG[pin], PIN_FUNC_GPIO);
+    gpio_set_direction((gpio_num_t)pin, GPIO_MODE_OUTPUT);
+    gpio_matrix_out(pin, signal, false, false);
+    // The peripheral enables Q only while sending, which would leave the
+    // latch floating between transfers
+    GPIO.func_out_sel_cfg[pin].oen_sel = 1;
+}
+
+void spiShiftOutAttach(pinnum_t sck, pinnum_t data, pinnum_t latch) {
+    route(sck, VSPICLK_OUT_IDX);
+    route(data, VSPID_OUT_IDX);
+    route(latch, VSPIQ_OUT_IDX);
+}
+
+void spiShiftOutDetach(pinnum_t sck, pinnum_t data, pinnum_t latch) {
+    route(latch, SIG_GPIO_OUT_IDX);
+    route(sck, SIG_GPIO_OUT_IDX);
+    route(data, SIG_GPIO_OUT_IDX);
+}
+
+// Spreads a nibble over the second bit of each pair of a byte, for D
+static inline uint32_t IRAM_ATTR spread(uint32_t nibble) {
+    return (nibble & 1) | ((nibble & 2) << 1) | ((nibble & 4) << 2) | ((nibble & 8) << 3);
+}
+
+void IRAM_ATTR spiShiftOutEncode(uint32_t* out, uint32_t sample) {
+    // Bytes go out from the lowest address and each byte from its MSB, so
+    // the top nibble of the sample is in the low byte of out[0]
+    for (int word = 0; word < 2; ++word) {
+        uint32_t w = 0;
+        for (int i = 0; i < 4; ++i) {
+            w |= spread((sample >> (28 - 4 * (word * 4 + i))) & 0xf) << (8 * i);
+        }
+        out[word] = w;
+    }
+    // Latches the sample before this one
+    out[0] |= latchBit;
+}
+
+void IRAM_ATTR spiShiftOutStart(lldesc_t* desc) {
+    portENTER_CRITICAL_SAFE(&spinlock);
+    pending = false;
+    startDma(desc);
+    portEXIT_CRITICAL_SAFE(&spinlock);
+}
+
+void spiShiftOutStop() {
+    portENTER_CRITICAL(&spinlock);
+    if (sending) {
+        sending->length -= 1;
+    }
+    sending                = nullptr;
+    busy                   = false;
+    pending                = false;
+    SPI3.dma_out_link.stop = 1;
+    SPI3.slave.trans_inten = 0;
+    // A transfer cannot be cut short, so the peripheral is reset instead
+    periph_module_reset(PERIPH_VSPI_MODULE);
+    configure();
+    portEXIT_CRITICAL(&spinlock);
+}
+
+void IRAM_ATTR spiShiftOutWrite(uint32_t sample) {
+    portENTER_CRITICAL_SAFE(&spinlock);
+    if (busy) {
+        pendingSample = sample;
+        pending       = true;
+    } else {
+        startWrite(sample);
+    }
+    portEXIT_CRITICAL_SAFE(&spinlock);
+}
+#else
+// The newer ESP32 variants have different SPI registers
+
+bool spiShiftOutInit(spiShiftOutDone_t done) {
+    return false;
+}
+void spiShiftOutAttach(pinnum_t sck, pinnum_t data, pinnum_t latch) {}
+void spiShiftOutDetach(pinnum_t sck, pinnum_t data, pinnum_t latch) {}
+void spiShiftOutEncode(uint32_t* out, uint32_t sample) {}
+void spiShiftOutStart(lldesc_t* desc) {}
+void spiShiftOutStop() {}
+void spiShiftOutWrite(uint32_t sample) {}
+#endif
@@ -4,6 +4,7 @@
 #include "src/StartupLog.h"
 #include "src/Protocol.h"  // send_line()
 #include <sstream>
+#include <esp_timer.h>
 
 // The startup log is stored in RTC RAM that is preserved across
 // resets.  That lets us show the previous startup log if the
@@ -50,6 +51,25 @@ void StartupLog::dump(Channel& out) {
     }
 }
 
+// The stage times are only kept for this boot, so they are in ordinary RAM
+static std::string _stages;
+static int64_t     _stageEnd = 0;  // Microseconds since the application started
+
+void StartupLog::stage(const char* name) {
+    int64_t now = esp_timer_get_time();
+    stage(name, uint32_t((now - _stageEnd) / 1000));
+    _stageEnd = now;
+}
+void StartupLog::stage(const char* name, uint32_t ms) {
+    _stages += ' ';
+    _stages += name;
+    _stages += ':';
+    _stages += std::to_string(ms);
+}
+void StartupLog::showStages() {
+    log_info("Startup ms" << _stages << " total:" << uint32_t(esp_timer_get_time() / 1000));
+}
+
 StartupLog::~StartupLog() {}
 
 StartupLog startupLog;
@@ -9,6 +9,7 @@ extern "C" {
 
 #include "hal/timer_ll.h"
 #include "esp_intr_alloc.h"
+#include "esp_spi_flash.h"
 
 static const uint32_t fTimers = 80000000;  // the frequency of ESP32 timers
 
@@ -44,6 +45,16 @@ void IRAM_ATTR stepTimerStop() {
     timer_ll_set_alarm_enable(&TIMERG0, TIMER_0, false);
 }
 
+uint32_t IRAM_ATTR stepTimerGetTicks() {
+    uint64_t ticks;
+    timer_ll_get_counter_value(&TIMERG0, TIMER_0, &ticks);
+    return (uint32_t)ticks;
+}
+
+bool IRAM_ATTR stepTimerFlashCacheOn() {
+    return spi_flash_cache_enabled();
+}
+
 void stepTimerInit(uint32_t frequency, bool (*callback)(void)) {
     timer_ll_intr_disable(&TIMERG0, TIMER_0);
     timer_ll_set_counter_enable(&TIMERG0, TIMER_0, TIMER_PAUSE);
@@ -71,6 +82,44 @@ void stepTimerInit(uint32_t frequency, bool (*callback)(void)) {
     timer_ll_intr_enable(&TIMERG0, TIMER_0);
 }
 
+static void (*pulse_timer_callback)(void);
+
+static void IRAM_ATTR pulse_timer_isr(void* arg) {
+    timer_ll_clear_intr_status(&TIMERG0, TIMER_1);
+    timer_ll_set_counter_enable(&TIMERG0, TIMER_1, false);
+    pulse_timer_callback();
+}
+
+void IRAM_ATTR pulseTimerStart(uint32_t ticks) {
+    timer_ll_set_counter_enable(&TIMERG0, TIMER_1, false);
+    timer_ll_set_counter_value(&TIMERG0, TIMER_1, 0ULL);
+    timer_ll_set_alarm_value(&TIMERG0, TIMER_1, (uint64_t)ticks);
+    timer_ll_set_alarm_enable(&TIMERG0, TIMER_1, true);
+    timer_ll_set_counter_enable(&TIMERG0, TIMER_1, true);
+}
+
+void pulseTimerInit(uint32_t frequency, void (*callback)(void)) {
+    timer_ll_intr_disable(&TIMERG0, TIMER_1);
+    timer_ll_set_counter_enable(&TIMERG0, TIMER_1, false);
+    timer_ll_set_divider(&TIMERG0, TIMER_1, fTimers / frequency);
+    timer_ll_set_counter_increase(&TIMERG0, TIMER_1, true);
+    timer_ll_set_auto_reload(&TIMERG0, TIMER_1, false);
+    timer_ll_set_alarm_enable(&TIMERG0, TIMER_1, false);
+    timer_ll_clear_intr_status(&TIMERG0, TIMER_1);
+
+    pulse_timer_callback = callback;
+
+    esp_intr_alloc_intrstatus(timer_group_periph_signals.groups[TIMER_GROUP_0].t1_irq_id,
+                              ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL2,
+                              timer_ll_get_intr_status_reg(&TIMERG0),
+                              1 << TIMER_1,
+                              pulse_timer_isr,
+                              NULL,
+                              NULL);
+
+    timer_ll_intr_enable(&TIMERG0, TIMER_1);
+}
+
 #ifdef __cplusplus
 }
 #endif
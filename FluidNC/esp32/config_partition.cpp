@@ -0,0 +1,46 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Driver/config_partition.h"
+
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+
+static const char*             configLabel = "config";
+static spi_flash_mmap_handle_t mapHandle;
+static bool                    mapped = false;
+
+static const esp_partition_t* config_partition() {
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, configLabel);
+}
+
+size_t config_partition_size() {
+    auto part = config_partition();
+    return part ? part->size : 0;
+}
+
+const char* config_partition_map() {
+    auto        part = config_partition();
+    const void* ptr;
+    if (!part || mapped || esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &mapHandle) != ESP_OK) {
+        return nullptr;
+    }
+    mapped = true;
+    return static_cast<const char*>(ptr);
+}
+
+void config_partition_unmap() {
+    if (mapped) {
+        spi_flash_munmap(mapHandle);
+        mapped = false;
+    }
+}
+
+bool config_partition_erase() {
+    auto part = config_partition();
+    return part && esp_partition_erase_range(part, 0, part->size) == ESP_OK;
+}
+
+bool config_partition_write(size_t offset, const void* data, size_t length) {
+    auto part = config_partition();
+    return part && offset + length <= part->size && esp_partition_write(part, offset, data, length) == ESP_OK;
+}
@@ -10,6 +10,7 @@
 
 #include "src/Protocol.h"
 
+#include <esp_timer.h>  // esp_timer_get_time()
 #include <vector>
 
 static gpio_dev_t* _gpio_dev = GPIO_HAL_GET_HW(GPIO_PORT_0);
@@ -17,6 +18,20 @@ static gpio_dev_t* _gpio_dev = GPIO_HAL_GET_HW(GPIO_PORT_0);
 void IRAM_ATTR gpio_write(pinnum_t pin, bool value) {
     gpio_ll_set_level(_gpio_dev, (gpio_num_t)pin, value);
 }
+void IRAM_ATTR gpio_write_mask(uint32_t set_lo, uint32_t clear_lo, uint32_t set_hi, uint32_t clear_hi) {
+    if (set_lo) {
+        _gpio_dev->out_w1ts = set_lo;
+    }
+    if (clear_lo) {
+        _gpio_dev->out_w1tc = clear_lo;
+    }
+    if (set_hi) {
+        _gpio_dev->out1_w1ts.val = set_hi;
+    }
+    if (clear_hi) {
+        _gpio_dev->out1_w1tc.val = clear_hi;
+    }
+}
 bool IRAM_ATTR gpio_read(pinnum_t pin) {
     return gpio_ll_get_level(_gpio_dev, (gpio_num_t)pin);
 }
@@ -40,24 +55,21 @@ void gpio_mode(pinnum_t pin, bool input, bool output, bool pullup, bool pulldown
     }
     gpio_config(&conf);
 }
-#if 0
 void gpio_add_interrupt(pinnum_t pin, int mode, void (*callback)(void*), void* arg) {
-    gpio_install_isr_service(ESP_INTR_FLAG_IRAM);  // Will return an err if already called
+    // The handlers call virtual methods whose vtables are in flash, so the service is not
+    // an IRAM one and is held off while the flash cache is disabled
+    gpio_install_isr_service(0);  // Will return an err if already called
 
     gpio_num_t gpio = (gpio_num_t)pin;
+    gpio_set_intr_type(gpio, (gpio_int_type_t)mode);
     gpio_isr_handler_add(gpio, callback, arg);
-
-    //FIX interrupts on peripherals outputs (eg. LEDC,...)
-    //Enable input in GPIO register
-    gpio_hal_context_t gpiohal;
-    gpiohal.dev = GPIO_LL_GET_HW(GPIO_PORT_0);
-    gpio_hal_input_enable(&gpiohal, gpio);
 }
 void gpio_remove_interrupt(pinnum_t pin) {
     gpio_num_t gpio = (gpio_num_t)pin;
     gpio_isr_handler_remove(gpio);  //remove handle and disable isr for pin
     gpio_set_intr_type(gpio, GPIO_INTR_DISABLE);
 }
+#if 0
 void gpio_route(pinnum_t pin, uint32_t signal) {
     if (pin == 255) {
         return;
@@ -110,6 +122,11 @@ static void gpios_update(gpio_mask_t& gpios, int gpio_num, bool active) {
 static gpio_dispatch_t gpioActions[GPIO_NUM_MAX + 1] = { nullptr };
 static void*           gpioArgs[GPIO_NUM_MAX + 1];
 
+static gpio_dispatch_t  gpio_edge_actions[GPIO_NUM_MAX + 1] = { nullptr };
+static int64_t          gpio_edge_window[GPIO_NUM_MAX + 1]  = { 0 };  // Debounce window in microseconds
+static volatile int64_t gpio_edge_until[GPIO_NUM_MAX + 1]   = { 0 };  // End of the current window
+static volatile int64_t gpio_edge_time[GPIO_NUM_MAX + 1]    = { 0 };  // When the last edge was acted on
+
 void gpio_set_action(int gpio_num, gpio_dispatch_t action, void* arg, bool invert) {
     gpioActions[gpio_num] = action;
     gpioArgs[gpio_num]    = arg;
@@ -123,14 +140,43 @@ void gpio_set_action(int gpio_num, gpio_dispatch_t action, void* arg, bool inver
     gpios_update(gpios_current, gpio_num, !active);
 }
 void gpio_clear_action(int gpio_num) {
+    if (gpio_edge_actions[gpio_num]) {
+        gpio_remove_interrupt(gpio_num);
+        gpio_edge_actions[gpio_num] = nullptr;
+    }
     gpioActions[gpio_num] = nullptr;
     gpioArgs[gpio_num]    = nullptr;
     gpios_update(gpios_interest, gpio_num, false);
 }
 
-static void gpio_send_action(int gpio_num, bool active) {
-    auto    end_ticks  = gpio_next_event_ticks[gpio_num];
-    int32_t this_ticks = int32_t(xTaskGetTickCount());
+// The edge interrupt acts on the first edge of a change at once, and ignores the edges
+// that follow it within the debounce window.  Where the input settles after a bounce is
+// picked up by poll_gpios(), which sends the same change to the action it was set with.
+static void gpio_edge_isr(void* arg) {
+    int     gpio_num = int(arg);
+    int64_t now      = esp_timer_get_time();
+    if (now < gpio_edge_until[gpio_num]) {
+        return;
+    }
+    gpio_edge_until[gpio_num] = now + gpio_edge_window[gpio_num];
+    gpio_edge_time[gpio_num]  = now;
+    gpio_edge_actions[gpio_num](gpio_num, gpioArgs[gpio_num], gpio_is_active(gpio_num));
+}
+
+void gpio_set_edge_action(int gpio_num, gpio_dispatch_t action, uint32_t debounce_ms) {
+    gpio_set_rate_limit(gpio_num, debounce_ms);
+    gpio_edge_window[gpio_num]  = int64_t(debounce_ms) * 1000;
+    gpio_edge_until[gpio_num]   = 0;
+    gpio_edge_actions[gpio_num] = action;
+    gpio_add_interrupt(gpio_num, gpioAnyEdge, gpio_edge_isr, (void*)gpio_num);
+}
+
+int64_t gpio_edge_usecs(int gpio_num) {
+    return gpio_edge_time[gpio_num];
+}
+
+static void gpio_send_action(int gpio_num, bool active, int32_t this_ticks) {
+    auto end_ticks = gpio_next_event_ticks[gpio_num];
     if (end_ticks == 0 || ((this_ticks - end_ticks) > 0)) {
         end_ticks = this_ticks + gpio_deltat_ticks[gpio_num];
         if (end_ticks == 0) {
@@ -146,18 +192,31 @@ static void gpio_send_action(int gpio_num, bool active) {
     }
 }
 
+// Called on every pass of the polling loop, so it reads the input registers once, only
+// those that have GPIOs with an action, and does nothing more unless one of those GPIOs
+// differs from the last state that was sent.  The cost does not grow with the number of
+// pins when nothing changed, and only the pins that changed are dispatched.
 void poll_gpios() {
-    gpio_mask_t gpios_active  = get_gpios();
+    static_assert(GPIO_NUM_MAX <= 64, "GPIO masks are 64 bits");
+    gpio_mask_t gpios_active = 0;
+    if (uint32_t(gpios_interest)) {
+        gpios_active = REG_READ(GPIO_IN_REG);
+    }
+    if (gpios_interest >> 32) {
+        gpios_active |= gpio_mask_t(REG_READ(GPIO_IN1_REG)) << 32;
+    }
+    gpios_active ^= gpios_inverted;
+
     gpio_mask_t gpios_changed = (gpios_active ^ gpios_current) & gpios_interest;
-    if (gpios_changed) {
-        int zeros;
-        while ((zeros = __builtin_clzll(gpios_changed)) != 64) {
-            int gpio_num = 63 - zeros;
-            gpio_send_action(gpio_num, gpios_active & gpio_mask(gpio_num));
-            // Remove bit from mask so clzll will find the next one
-            gpios_update(gpios_changed, gpio_num, false);
-        }
+    if (!gpios_changed) {
+        return;
     }
+    int32_t this_ticks = int32_t(xTaskGetTickCount());
+    do {
+        int gpio_num = __builtin_ctzll(gpios_changed);
+        gpio_send_action(gpio_num, gpios_active & gpio_mask(gpio_num), this_ticks);
+        gpios_changed &= gpios_changed - 1;  // Clear the lowest set bit
+    } while (gpios_changed);
 }
 
 // Support functions for gpio_dump
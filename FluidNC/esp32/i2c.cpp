@@ -75,3 +75,14 @@ int i2c_write(int bus_number, uint8_t address, const uint8_t* data, size_t count
 int i2c_read(int bus_number, uint8_t address, uint8_t* data, size_t count) {
     return i2c_master_read_from_device((i2c_port_t)bus_number, address, data, count, 10 / portTICK_RATE_MS) ? -1 : count;
 }
+
+int i2c_write_read(int bus_number, uint8_t address, const uint8_t* tx, size_t tx_count, uint8_t* rx, size_t rx_count) {
+    if (!rx_count) {
+        return i2c_write(bus_number, address, tx, tx_count);
+    }
+    if (!tx_count) {
+        return i2c_read(bus_number, address, rx, rx_count);
+    }
+    esp_err_t ret = i2c_master_write_read_device((i2c_port_t)bus_number, address, tx, tx_count, rx, rx_count, 10 / portTICK_RATE_MS);
+    return ret ? -1 : tx_count + rx_count;
+}
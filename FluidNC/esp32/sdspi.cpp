@@ -5,6 +5,7 @@
 #include "ff.h"
 #include "sdmmc_cmd.h"
 #include "driver/sdspi_host.h"
+#include "driver/sdmmc_host.h"
 
 #include "Driver/sdspi.h"
 #include "src/Config.h"
@@ -58,6 +59,7 @@ fail:
 sdmmc_host_t  host_config = SDSPI_HOST_DEFAULT();
 sdmmc_card_t* card        = NULL;
 const char*   base_path   = "/sd";
+bool          sdmmc_slot  = false;  // host_config is the SDMMC host instead of SPI
 
 static void call_host_deinit(const sdmmc_host_t* host_config) {
     if (host_config->flags & SDMMC_HOST_FLAG_DEINIT_ARG) {
@@ -114,6 +116,42 @@ cleanup:
     return false;
 }
 
+bool sd_init_sdmmc(uint32_t freq_hz, int width, int cd_pin, int wp_pin) {
+    esp_err_t err;
+
+    sdmmc_host_t sdmmc_host = SDMMC_HOST_DEFAULT();
+    host_config             = sdmmc_host;
+    if (width == 1) {
+        host_config.flags &= ~SDMMC_HOST_FLAG_4BIT;
+    }
+    host_config.max_freq_khz = freq_hz / 1000;
+
+    sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+    slot_config.width               = width;
+    slot_config.gpio_cd             = gpio_num_t(cd_pin);
+    slot_config.gpio_wp             = gpio_num_t(wp_pin);
+    // Boards often rely on these instead of fitting resistors on CMD and the data lines
+    slot_config.flags |= SDMMC_SLOT_FLAG_INTERNAL_PULLUP;
+
+    bool host_inited = false;
+
+    err = host_config.init();
+    CHECK_EXECUTE_RESULT(err, "SDMMC host init failed");
+    host_inited = true;
+
+    err = sdmmc_host_init_slot(host_config.slot, &slot_config);
+    CHECK_EXECUTE_RESULT(err, "SDMMC slot init failed");
+
+    sdmmc_slot = true;
+    return true;
+
+cleanup:
+    if (host_inited) {
+        call_host_deinit(&host_config);
+    }
+    return false;
+}
+
 #if 0
 bool init_spi_bus(int mosi_pin, int miso_pin, int clk_pin) {
     spi_bus_config_t bus_cfg = {
@@ -191,7 +229,9 @@ void sd_unmount() {
 
 void sd_deinit_slot() {
     // log_debug("Deinit slot");
-    sdspi_host_remove_device(host_config.slot);
+    if (!sdmmc_slot) {
+        sdspi_host_remove_device(host_config.slot);
+    }
     call_host_deinit(&host_config);
 
     //deinitialize the bus after all devices are removed
@@ -4,6 +4,7 @@
 // There is no .h file to define the interface to this code.
 // It works by replacing weak methods in the TMCStepper library,
 // namely TMCStepper::read() and TMCStepper::write()
+// The exception is write batching for daisy chains, in Driver/TmcSpiChain.h
 
 // It uses low-level direct access to the SPI hardware instead of
 // trying to use the ESP-IDF spi_master() driver.  The reason for this
@@ -37,13 +38,122 @@
 
 #include "src/Config.h"
 #include "esp32/tmc_spi_support.h"
+#include "Driver/TmcSpiChain.h"
 #include <TMCStepper.h>  // https://github.com/teemuatlut/TMCStepper
 
+#include <algorithm>
+
+// Writes to daisy-chained drivers that are held back by tmcSpiChainBegin().
+// The SPI hardware buffer is 64 bytes, so a whole-chain transfer can carry
+// up to 12 of the 5-byte packets.
+static const int packetLen     = 5;
+static const int maxChainLinks = 12;
+static const int maxChainOps   = 16;  // Held writes per driver
+
+struct ChainOp {
+    uint8_t  cmd;
+    uint32_t data;
+};
+
+static int             chainDepth   = 0;
+static TMC2130Stepper* chainStepper = nullptr;  // A driver on the chain, for the shared CS pin
+static int             chainLength  = 0;
+static int             chainOps[maxChainLinks];
+static ChainOp         chainOp[maxChainLinks][maxChainOps];
+
+static void put_packet(uint8_t* out, uint8_t cmd, uint32_t data) {
+    out[0] = cmd;
+    out[1] = data >> 24;
+    out[2] = data >> 16;
+    out[3] = data >> 8;
+    out[4] = data >> 0;
+}
+
+// Sends the held writes, the next one for every driver in each transfer
+static void chain_flush() {
+    if (!chainStepper) {
+        return;
+    }
+    int rounds = *std::max_element(chainOps, chainOps + chainLength);
+
+    tmc_spi_bus_setup();
+    for (int round = 0; round < rounds; ++round) {
+        // The first packet shifted in goes all the way to the last driver
+        // in the chain, so the packet for link_index i is at chainLength - i.
+        // Drivers with nothing left to write get a read of GCONF, which has
+        // no side effects.
+        uint8_t out[chainLength * packetLen];
+        for (int link = 1; link <= chainLength; ++link) {
+            uint8_t* packet = &out[(chainLength - link) * packetLen];
+            if (round < chainOps[link - 1]) {
+                auto& op = chainOp[link - 1][round];
+                put_packet(packet, op.cmd, op.data);
+            } else {
+                put_packet(packet, 0x00, 0);
+            }
+        }
+        chainStepper->switchCSpin(0);
+        tmc_spi_transfer_data(out, chainLength * packetLen * 8, NULL, 0);
+        chainStepper->switchCSpin(1);
+    }
+    std::fill(chainOps, chainOps + maxChainLinks, 0);
+    chainStepper = nullptr;
+}
+
+void tmcSpiChainBegin() {
+    ++chainDepth;
+}
+
+void tmcSpiChainEnd() {
+    if (chainDepth && --chainDepth == 0) {
+        chain_flush();
+    }
+}
+
+void tmcSpiChainRead(TMC2130Stepper* stepper, int chainLength, uint8_t reg, uint32_t* values) {
+    chain_flush();
+    tmc_spi_bus_setup();
+
+    // The first transfer asks every driver for the register, and the second
+    // shifts out the answers while asking again, which has no side effects.
+    size_t  total_bytes = chainLength * packetLen;
+    size_t  total_bits  = total_bytes * 8;
+    uint8_t out[total_bytes];
+    uint8_t in[total_bytes];
+    for (int link = 0; link < chainLength; ++link) {
+        put_packet(&out[link * packetLen], reg, 0);
+    }
+    for (int i = 0; i < 2; ++i) {
+        memcpy(in, out, total_bytes);
+        stepper->switchCSpin(0);
+        tmc_spi_transfer_data(in, total_bits, in, total_bits);
+        stepper->switchCSpin(1);
+    }
+
+    // As for read(), the answer from link_index i is at chainLength - i
+    for (int link = 1; link <= chainLength; ++link) {
+        uint8_t* packet = &in[(chainLength - link) * packetLen];
+        values[link - 1] = (uint32_t)packet[1] << 24 | (uint32_t)packet[2] << 16 | (uint32_t)packet[3] << 8 | packet[4];
+    }
+}
+
 // Replace the library's weak definition of TMC2130Stepper::write()
 // This is executed in the object context so it has access to class
 // data such as the CS pin that switchCSpin() uses
 void TMC2130Stepper::write(uint8_t reg, uint32_t data) {
     log_verbose("TMC reg " << to_hex(reg) << " write " << to_hex(data));
+
+    if (chainDepth && link_index > 0 && chain_length <= maxChainLinks) {
+        int link = link_index - 1;
+        if (chainOps[link] == maxChainOps) {
+            chain_flush();
+        }
+        chainStepper                    = this;
+        chainLength                     = chain_length;
+        chainOp[link][chainOps[link]++] = { uint8_t(reg | 0x80), data };
+        return;
+    }
+
     tmc_spi_bus_setup();
 
     switchCSpin(0);
@@ -53,6 +163,7 @@ void TMC2130Stepper::write(uint8_t reg, uint32_t data) {
 
 // Replace the library's weak definition of TMC2130Stepper::read()
 uint32_t TMC2130Stepper::read(uint8_t reg) {
+    chain_flush();  // Earlier writes may be held for a chain transfer
     tmc_spi_bus_setup();
 
     switchCSpin(0);
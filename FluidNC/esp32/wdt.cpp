@@ -2,9 +2,13 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include "wdt.h"
+#include "Driver/soft_wdt.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "src/Config.h"
+#include <cstring>
 
 static TaskHandle_t wdt_task_handle = nullptr;
 
@@ -45,3 +49,139 @@ void disable_core0_WDT() {
         log_error("Failed to remove Core 0 IDLE task from WDT " << err);
     }
 }
+
+// Soft watchdog
+
+struct SoftWdtPointState {
+    int64_t      last;  // esp_timer time of the last feed, 0 while paused
+    TaskHandle_t task;  // The task that fed it last
+    int          core;  // and the core it fed it on
+    uint32_t     maxGapUs;
+    uint32_t     stalls;
+    bool         caught;   // The open gap has been seen by the check, and detail filled in
+    bool         pending;  // stall is ready to be taken
+    SoftWdtStall detail;
+    SoftWdtStall stall;
+};
+
+static SoftWdtPointState  softWdtPoints[SoftWdtPoints] = {};
+static portMUX_TYPE       softWdtLock                  = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t           softWdtThresholdUs           = 0;
+static esp_timer_handle_t softWdtTimer                 = nullptr;
+static const uint64_t     softWdtCheckUs               = 10000;
+
+static void soft_wdt_name(SoftWdtStall& stall, TaskHandle_t task) {
+    strncpy(stall.task, pcTaskGetName(task), sizeof(stall.task) - 1);
+    stall.task[sizeof(stall.task) - 1] = '\0';
+}
+
+// Runs in the esp_timer task, which has a priority above every task that feeds a point
+static void soft_wdt_check(void* arg) {
+    int64_t      now  = esp_timer_get_time();
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (auto& p : softWdtPoints) {
+        portENTER_CRITICAL(&softWdtLock);
+        if (p.last && !p.caught && softWdtThresholdUs && now - p.last > softWdtThresholdUs) {
+            p.caught = true;
+            switch (eTaskGetState(p.task)) {
+                case eRunning:
+                    p.detail.state = "running";
+                    soft_wdt_name(p.detail, p.task);
+                    break;
+                case eReady: {
+                    TaskHandle_t running = xTaskGetCurrentTaskHandleForCPU(p.core);
+                    p.detail.state       = "preempted";
+                    soft_wdt_name(p.detail, running == self ? p.task : running);
+                } break;
+                default:
+                    p.detail.state = "blocked";
+                    soft_wdt_name(p.detail, p.task);
+                    break;
+            }
+        }
+        portEXIT_CRITICAL(&softWdtLock);
+    }
+}
+
+void soft_wdt_init() {
+    if (softWdtTimer) {
+        return;
+    }
+    esp_timer_create_args_t args = {};
+    args.callback                = soft_wdt_check;
+    args.dispatch_method         = ESP_TIMER_TASK;
+    args.name                    = "soft_wdt";
+    esp_err_t err;
+    if ((err = esp_timer_create(&args, &softWdtTimer)) != ESP_OK ||
+        (err = esp_timer_start_periodic(softWdtTimer, softWdtCheckUs)) != ESP_OK) {
+        log_error("Failed to start the soft watchdog " << err);
+    }
+}
+
+void soft_wdt_set_threshold(uint32_t ms) {
+    softWdtThresholdUs = ms * 1000;
+}
+
+void soft_wdt_feed(SoftWdtPoint point) {
+    SoftWdtPointState& p   = softWdtPoints[point];
+    int64_t            now = esp_timer_get_time();
+    portENTER_CRITICAL(&softWdtLock);
+    if (p.last) {
+        uint32_t gap = now - p.last;
+        if (gap > p.maxGapUs) {
+            p.maxGapUs = gap;
+        }
+        if (softWdtThresholdUs && gap > softWdtThresholdUs) {
+            ++p.stalls;
+            if (p.caught) {
+                p.stall = p.detail;
+            } else {
+                p.stall.state = "unseen";
+                soft_wdt_name(p.stall, xTaskGetCurrentTaskHandle());
+            }
+            p.stall.gapUs = gap;
+            p.pending     = true;
+        }
+    }
+    p.last   = now;
+    p.task   = xTaskGetCurrentTaskHandle();
+    p.core   = xPortGetCoreID();
+    p.caught = false;
+    portEXIT_CRITICAL(&softWdtLock);
+}
+
+void soft_wdt_pause(SoftWdtPoint point) {
+    SoftWdtPointState& p = softWdtPoints[point];
+    portENTER_CRITICAL(&softWdtLock);
+    p.last   = 0;
+    p.caught = false;
+    portEXIT_CRITICAL(&softWdtLock);
+}
+
+SoftWdtStats soft_wdt_stats(SoftWdtPoint point) {
+    SoftWdtPointState& p = softWdtPoints[point];
+    portENTER_CRITICAL(&softWdtLock);
+    SoftWdtStats stats = { p.maxGapUs, p.stalls };
+    portEXIT_CRITICAL(&softWdtLock);
+    return stats;
+}
+
+void soft_wdt_reset_stats() {
+    portENTER_CRITICAL(&softWdtLock);
+    for (auto& p : softWdtPoints) {
+        p.maxGapUs = 0;
+    }
+    portEXIT_CRITICAL(&softWdtLock);
+}
+
+bool soft_wdt_take_stall(SoftWdtPoint point, SoftWdtStall& stall) {
+    SoftWdtPointState& p = softWdtPoints[point];
+    portENTER_CRITICAL(&softWdtLock);
+    bool pending = p.pending;
+    if (pending) {
+        stall     = p.stall;
+        p.pending = false;
+    }
+    portEXIT_CRITICAL(&softWdtLock);
+    return pending;
+}
@@ -0,0 +1,20 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// Interface to the dedicated GPIO outputs of the ESP32-S3 CPU, which write up
+// to dedicGpioMaxPins pins with a single instruction.  The outputs belong to
+// the core that called dedic_gpio_init(), so only that core may write them.
+
+#include "src/Pins/PinDetail.h"  // pinnum_t
+
+#include <stdint.h>
+
+const int dedicGpioMaxPins = 8;
+
+// Routes the pins to dedicated outputs 0..count-1, in order.  Returns false if
+// the chip has no dedicated GPIO or the outputs cannot be allocated.
+bool dedic_gpio_init(const pinnum_t* pins, int count);
+
+// Sets the outputs in mask to the levels of the same bits of value
+void dedic_gpio_write(uint32_t mask, uint32_t value);
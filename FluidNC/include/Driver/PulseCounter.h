@@ -0,0 +1,33 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// Interface to the PCNT peripheral for counting the pulses on pins.
+// An output pin stays an output; its pad is also routed to the counter input,
+// so the counter sees what actually appears on the pin, whatever drives it.
+// Input pins, like spindle tachometers, are counted the same way.
+
+#include "src/Pins/PinDetail.h"  // pinnum_t
+
+#include <stdint.h>
+
+// Counts run from 0 to pulseCounterLimit - 1 and then wrap to 0
+const uint32_t pulseCounterLimit = 32767;
+
+// Attaches a free counter unit to a GPIO pin, counting rising edges, or falling
+// edges if falling is true.  Returns the unit number, or -1 if none is free.
+int pulse_counter_attach(pinnum_t pin, bool falling);
+
+// Attaches a free counter unit to a quadrature encoder on input pins a and b,
+// counting every edge of both signals, up when A leads B and down when B leads
+// A.  Returns the unit number, or -1 if none is free.  The count runs between
+// plus and minus pulseCounterLimit, going back to 0 at either end; read it as
+// an int16_t.
+int pulse_counter_attach_quadrature(pinnum_t a, pinnum_t b);
+
+// Returns the current count of a unit
+uint32_t pulse_counter_read(int unit);
+
+// Ignores pulses shorter than the given number of 80MHz APB clock cycles,
+// up to 1023.  Counting starts out unfiltered, as step pulses need.
+void pulse_counter_set_filter(int unit, uint16_t apb_cycles);
@@ -21,4 +21,6 @@ private:
     int      _channel;
     int      _period;
     int      _gpio;
+
+    volatile void* _regs;  // The LEDC channel registers, so setDuty() need not look them up
 };
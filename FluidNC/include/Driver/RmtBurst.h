@@ -0,0 +1,35 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// Interface to the RMT peripheral for the RMT_burst stepping engine.
+// Each RMT channel drives one step pin.  A burst is a list of pulse start
+// times, in microseconds from the start of the burst, that is loaded into
+// the channel memory and then played out by the hardware, so the step ISR
+// runs once per burst instead of once per step.  The channel must have been
+// set up by rmt_config() with a 1 us tick and one memory block.
+
+#include <stdint.h>
+
+// Longest burst, in microseconds.  It bounds the number of items needed to
+// fill long gaps between pulses.
+const uint32_t rmtBurstMaxUsecs = 50000;
+
+// Number of pulses that one burst can hold for each channel.  It is never
+// more than rmtBurstMaxPulses.
+const uint32_t rmtBurstMaxPulses = 64;
+uint32_t       rmtBurstCapacity();
+
+// Stages a burst of count pulses of pulseUsecs each for a channel.  Nothing
+// is sent until rmtBurstStart().
+void rmtBurstPulses(int channel, bool invert, const uint32_t* starts, uint32_t count, uint32_t pulseUsecs);
+
+// Loads the staged bursts, after waiting for the channels to finish their
+// previous bursts, and starts them together
+void rmtBurstStart();
+
+// Ends any burst that is being sent
+void rmtBurstStop();
+
+// Loads the single-pulse pattern that the RMT engine triggers for each step
+void rmtBurstSinglePulse(int channel, bool invert, uint32_t dirDelayUsecs, uint32_t pulseUsecs);
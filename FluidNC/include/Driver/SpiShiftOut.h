@@ -0,0 +1,50 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// Interface to the VSPI peripheral for driving 74HC595 chains with the
+// I2SO bitstream, on boards that wire the chain to SPI pins.  The SPI bus
+// runs in dual output mode at 8 MHz, so each 32-bit sample takes 32 clocks,
+// the same 4 us as an I2S sample.  The D line (mosi_pin) carries the data
+// and the Q line carries the latch, which goes high at the first clock of
+// each following sample, just after the last bit has been shifted in.  One
+// more clock at the end of each transfer latches its last sample.
+//
+// Streaming sends DMA descriptors one transfer each, starting the next one
+// from the interrupt when one ends, so the same descriptor ring that the I2S
+// DMA walks can be used.  The clock stops for an interrupt latency between
+// transfers, which the 74HC595 outputs do not see.
+
+#include "src/Pins/PinDetail.h"  // pinnum_t
+
+#include <stdint.h>
+#include <rom/lldesc.h>
+
+// Bytes that one sample takes in a DMA buffer, two bits per clock
+const uint32_t spiShiftOutSampleBytes = 8;
+
+// Bytes that each DMA buffer needs beyond its samples, for the extra latch clock
+const uint32_t spiShiftOutTailBytes = 4;
+
+// Called from the interrupt with each descriptor that has been sent.  last is
+// true if its next link was NULL, so streaming has stopped.
+typedef void (*spiShiftOutDone_t)(lldesc_t* desc, bool last);
+
+// Claims VSPI and a DMA channel.  Returns false if either is in use.
+bool spiShiftOutInit(spiShiftOutDone_t done);
+
+// Routes the pins to the peripheral, or back to plain GPIO outputs
+void spiShiftOutAttach(pinnum_t sck, pinnum_t data, pinnum_t latch);
+void spiShiftOutDetach(pinnum_t sck, pinnum_t data, pinnum_t latch);
+
+// Stores one sample at out[0..1] in the form the peripheral sends
+void spiShiftOutEncode(uint32_t* out, uint32_t sample);
+
+// Starts sending the descriptor chain at desc
+void spiShiftOutStart(lldesc_t* desc);
+
+// Abandons whatever is being sent, leaving the peripheral idle
+void spiShiftOutStop();
+
+// Shifts out and latches one sample, now or when the transfer being sent ends
+void spiShiftOutWrite(uint32_t sample);
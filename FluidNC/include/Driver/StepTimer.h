@@ -12,6 +12,19 @@ void stepTimerStop();
 void stepTimerSetTicks(uint32_t ticks);
 void stepTimerStart();
 
+// Timer ticks since the last alarm, for measuring interrupt latency
+uint32_t stepTimerGetTicks();
+
+// False while the flash cache is off for a flash write, when an ISR that touches
+// anything in flash would stall or crash
+bool stepTimerFlashCacheOn();
+
+// A second, one-shot timer with the same frequency that ends step pulses.  Its
+// interrupt has a higher priority than the step timer, so it can end a pulse
+// while the step ISR is still running.
+void pulseTimerInit(uint32_t frequency, void (*fn)(void));
+void pulseTimerStart(uint32_t ticks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,23 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// Batched access to daisy-chained Trinamic SPI drivers.
+// Between tmcSpiChainBegin() and tmcSpiChainEnd(), writes to drivers that
+// are in a daisy chain are held back.  tmcSpiChainEnd() then sends them as
+// whole-chain transfers, each carrying the next write for every driver in
+// the chain, instead of one transfer per write.  Reads flush the held
+// writes first, so register access keeps its order, and writes to drivers
+// that are not chained go out at once.  The calls can be nested.
+
+#include <stdint.h>
+
+class TMC2130Stepper;
+
+void tmcSpiChainBegin();
+void tmcSpiChainEnd();
+
+// Reads register reg from all chainLength drivers in the daisy chain that
+// stepper is on, with two whole-chain transfers instead of two per driver.
+// values[i] gets the value from the driver with link index i + 1.
+void tmcSpiChainRead(TMC2130Stepper* stepper, int chainLength, uint8_t reg, uint32_t* values);
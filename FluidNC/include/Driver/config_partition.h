@@ -0,0 +1,22 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+// A raw data partition labeled "config", if the partition table has one, holds the
+// compiled machine config.  It is mapped into the address space to be read, so the
+// config is tokenized straight from flash.  The partition tables that come with FluidNC
+// leave no room for one, so it is only there in custom tables.
+
+#include <cstddef>
+
+// The size of the partition, or 0 if there is none
+size_t config_partition_size();
+
+// The contents of the partition, or nullptr if it cannot be mapped.  They stay mapped
+// until config_partition_unmap().
+const char* config_partition_map();
+void        config_partition_unmap();
+
+// Erases the whole partition, which must be done before writing to it
+bool config_partition_erase();
+bool config_partition_write(size_t offset, const void* data, size_t length);
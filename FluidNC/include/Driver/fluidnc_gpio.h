@@ -8,6 +8,8 @@
 // GPIO interface
 
 void gpio_write(pinnum_t pin, bool value);
+// Drives several outputs at once.  Bit n of a _lo mask is GPIO n, bit n of a _hi mask is GPIO 32+n
+void gpio_write_mask(uint32_t set_lo, uint32_t clear_lo, uint32_t set_hi, uint32_t clear_hi);
 bool gpio_read(pinnum_t pin);
 void gpio_mode(pinnum_t pin, bool input, bool output, bool pullup, bool pulldown, bool opendrain = false);
 void gpio_set_interrupt_type(pinnum_t pin, int mode);
@@ -15,6 +17,9 @@ void gpio_add_interrupt(pinnum_t pin, int mode, void (*callback)(void*), void* a
 void gpio_remove_interrupt(pinnum_t pin);
 void gpio_route(pinnum_t pin, uint32_t signal);
 
+// The mode of gpio_add_interrupt() is a gpio_int_type_t
+const int gpioAnyEdge = 3;  // GPIO_INTR_ANYEDGE
+
 class Print;
 void gpio_dump(Print& out);
 
@@ -22,4 +27,10 @@ typedef void (*gpio_dispatch_t)(int, void*, bool);
 
 void gpio_set_action(int gpio_num, gpio_dispatch_t action, void* arg, bool invert);
 void gpio_clear_action(int gpio_num);
+
+// Also calls action from an interrupt on the first edge of each change of a GPIO that has
+// an action, ignoring the edges that follow within debounce_ms.  Events from its polling
+// are rate-limited to the same window.
+void    gpio_set_edge_action(int gpio_num, gpio_dispatch_t action, uint32_t debounce_ms);
+int64_t gpio_edge_usecs(int gpio_num);  // esp_timer time of the last edge acted on
 void poll_gpios();
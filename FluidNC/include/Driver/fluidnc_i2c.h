@@ -10,3 +10,7 @@
 bool i2c_master_init(int bus_number, pinnum_t sda_pin, pinnum_t scl_pin, uint32_t frequency);
 int  i2c_write(int bus_number, uint8_t address, const uint8_t* data, size_t count);
 int  i2c_read(int bus_number, uint8_t address, uint8_t* data, size_t count);
+
+// Writes tx, then reads rx after a repeated start; either count may be 0.  Returns the
+// number of bytes transferred or -1.
+int i2c_write_read(int bus_number, uint8_t address, const uint8_t* tx, size_t tx_count, uint8_t* rx, size_t rx_count);
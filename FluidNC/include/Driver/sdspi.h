@@ -1,6 +1,9 @@
 #include <system_error>
 
 bool sd_init_slot(uint32_t freq_hz, int cs_pin, int cd_pin = -1, int wp_pin = -1);
+
+// The native SD host, with its own DMA, on its fixed pins; width is 1 or 4 data lines
+bool sd_init_sdmmc(uint32_t freq_hz, int width, int cd_pin = -1, int wp_pin = -1);
 void sd_unmount();
 void sd_deinit_slot();
 
@@ -0,0 +1,46 @@
+#pragma once
+
+// A soft watchdog for the main loop.  The hardware task watchdog is off for core 0,
+// and would only reset the controller anyway, so instead the gaps between the calls
+// that keep motion going are timed.  A periodic high-priority timer looks for a gap
+// that is still open past the threshold and notes what the task that should feed the
+// point is doing - running, preempted by another task on its core, or blocked - so a
+// blocking call in the main loop shows up by name instead of as a stutter.
+
+#include <cstdint>
+
+enum SoftWdtPoint : uint8_t {
+    SoftWdtRealtime = 0,  // protocol_execute_realtime()
+    SoftWdtPrep,          // Stepper::prep_buffer() while there is motion to prep
+    SoftWdtPoints,
+};
+
+struct SoftWdtStats {
+    uint32_t maxGapUs;  // Longest gap since the stats were reset
+    uint32_t stalls;    // Gaps longer than the threshold, ever
+};
+
+// What the feeding task was doing when a stall was caught
+struct SoftWdtStall {
+    uint32_t    gapUs;     // The whole gap, once the point was fed again
+    const char* state;     // "running", "preempted", "blocked" or "unseen"
+    char        task[16];  // The feeding task, or the task that preempted it
+};
+
+// Starts the periodic check; a threshold of 0 turns it off
+void soft_wdt_init();
+void soft_wdt_set_threshold(uint32_t ms);
+
+// Marks a point as reached
+void soft_wdt_feed(SoftWdtPoint point);
+
+// The point is not expected to be reached until it is fed again, as when the
+// main loop sleeps for lack of work or there is no motion to prep
+void soft_wdt_pause(SoftWdtPoint point);
+
+SoftWdtStats soft_wdt_stats(SoftWdtPoint point);
+void         soft_wdt_reset_stats();
+
+// Takes the last stall of a point, once the point has been fed again, returning
+// false if there is none.  A stall that ended between two checks is "unseen".
+bool soft_wdt_take_stall(SoftWdtPoint point, SoftWdtStall& stall);
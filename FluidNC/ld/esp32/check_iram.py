@@ -0,0 +1,221 @@
+# Checks after the link that the interrupt paths do not depend on the flash cache.
+# See README.md in this directory for why that matters.
+#
+# The flash cache is disabled while the flash is written, by the SD card web upload, a
+# LittleFS write or an NVS commit, and code or data behind it cannot be used then.  The
+# step ISR and the other roots below must therefore be in IRAM, with everything that they
+# call, and the vtables that they call through in DRAM.  Starting from the roots, this
+# follows the calls in the disassembly, direct calls and calls through the literal pool
+# that -mlongcalls makes, and for the classes whose virtual methods the ISR calls, the
+# entries of their vtables for those methods.  It reports each function that is reached
+# but in flash, with the path to it, and each such vtable that is in flash.  Calls through
+# other function pointers, such as hooks and callbacks, cannot be followed, so their
+# targets must be roots themselves.
+#
+# It runs from extra_scripts after the firmware is linked, and fails the build unless
+# the environment sets
+#   custom_iram_check = warn
+# to only report, or off.  It can also be run by hand:
+#   python FluidNC/ld/esp32/check_iram.py .pio/build/wifi/firmware.elf [toolchain-prefix]
+# where the prefix defaults to xtensa-esp32-elf-.
+
+import re, struct, subprocess, sys
+
+# Functions that run in interrupt context, as demangled names without the arguments
+ROOTS = [
+    "timer_isr",
+    "pulse_timer_isr",
+    "spiShiftOutIsr",
+    "Stepper::pulse_func",
+    "Machine::Axes::step",
+    "Machine::Axes::unstep",
+    "Machine::Stepping::onPulseTimer",
+    "Probe::tripped",
+]
+
+# The virtual methods that the ISR paths call, by the class names they are overridden in
+VIRTUALS = [
+    (re.compile(r"^Pins::"), {"write", "synchronousWrite", "read"}),
+    (re.compile(r"^MotorDrivers::"), {"step", "unstep", "set_direction"}),
+    (re.compile(r"^Spindles::"), {"setSpeedfromISR"}),
+]
+
+# objdump --no-show-raw-insn lines like "400d1234:	call8	400d5678 <foo>"
+CALL = re.compile(r"^\s*[0-9a-f]+:\s+(call0|call4|call8|call12|j)\s+([0-9a-f]+)\b")
+LITERAL = re.compile(r"^\s*[0-9a-f]+:\s+l32r\s+a\d+,\s*([0-9a-f]+)\b")
+
+SHT_NOBITS = 8
+SHF_EXECINSTR = 4
+STT_FUNC = 2
+STT_OBJECT = 1
+
+
+class Elf:
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            raise ValueError(path + " is not a 32-bit ELF file")
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x2E)
+        raw = [struct.unpack_from("<IIIIIIIIII", self.data, shoff + i * shentsize) for i in range(shnum)]
+        names = raw[shstrndx]
+        self.sections = []
+        for name, type, flags, addr, offset, size, link, info, align, entsize in raw:
+            self.sections.append({
+                "name": self.string(names[4], name),
+                "type": type,
+                "flags": flags,
+                "addr": addr,
+                "offset": offset,
+                "size": size,
+                "link": link,
+            })
+        self.symbols = []
+        for section in self.sections:
+            if section["type"] != 2:  # SHT_SYMTAB
+                continue
+            strtab = self.sections[section["link"]]["offset"]
+            for i in range(section["size"] // 16):
+                name, value, size, info, other, shndx = struct.unpack_from("<IIIBBH", self.data, section["offset"] + i * 16)
+                if info & 0xF in (STT_FUNC, STT_OBJECT) and value:
+                    self.symbols.append((value, size, info & 0xF, self.string(strtab, name)))
+
+    def string(self, table, index):
+        end = self.data.index(b"\0", table + index)
+        return self.data[table + index:end].decode("ascii", "replace")
+
+    def section_at(self, addr):
+        for section in self.sections:
+            if section["addr"] <= addr < section["addr"] + section["size"] and section["flags"] & 2:  # SHF_ALLOC
+                return section
+        return None
+
+    def word(self, addr):
+        section = self.section_at(addr)
+        if not section or section["type"] == SHT_NOBITS:
+            return None
+        return struct.unpack_from("<I", self.data, section["offset"] + addr - section["addr"])[0]
+
+
+def in_flash(section):
+    return section is not None and section["name"].startswith(".flash")
+
+
+def demangle(names, prefix):
+    out = subprocess.run([prefix + "c++filt"], input="\n".join(names), capture_output=True, text=True, check=True).stdout
+    return out.split("\n")[: len(names)]
+
+
+def short_name(demangled):
+    # "Pins::GPIOPinDetail::write(int)" -> "Pins::GPIOPinDetail::write"
+    depth = 0
+    for i, c in enumerate(demangled):
+        if c == "<":
+            depth += 1
+        elif c == ">":
+            depth -= 1
+        elif c == "(" and depth == 0:
+            return demangled[:i]
+    return demangled
+
+
+def check(elf_path, prefix):
+    elf = Elf(elf_path)
+    funcs = sorted((s for s in elf.symbols if s[2] == STT_FUNC), key=lambda s: s[0])
+    vtables = [s for s in elf.symbols if s[2] == STT_OBJECT and s[3].startswith("_ZTV")]
+    names = dict(zip([s[3] for s in funcs + vtables], demangle([s[3] for s in funcs + vtables], prefix)))
+    by_addr = {}
+    for addr, size, kind, name in funcs:
+        by_addr.setdefault(addr & ~1, short_name(names[name]))
+
+    # The direct calls and literal references out of every function in IRAM
+    calls = {}
+    sections = [s["name"] for s in elf.sections if s["flags"] & SHF_EXECINSTR and not in_flash(s)]
+    args = [prefix + "objdump", "-d", "--no-show-raw-insn"]
+    for name in sections:
+        args += ["-j", name]
+    current = None
+    for line in subprocess.run(args + [elf_path], capture_output=True, text=True, check=True).stdout.split("\n"):
+        header = re.match(r"^([0-9a-f]{8}) <(.+)>:$", line)
+        if header:
+            current = int(header.group(1), 16)
+            calls[current] = set()
+            continue
+        if current is None:
+            continue
+        m = CALL.match(line)
+        if m:
+            target = int(m.group(2), 16)
+            if m.group(1) != "j" or target in by_addr:  # A j is a tail call only to another function
+                calls[current].add(target)
+            continue
+        m = LITERAL.match(line)
+        if m:
+            value = elf.word(int(m.group(1), 16))
+            if value is not None and value in by_addr:
+                calls[current].add(value)
+
+    roots = [addr for addr, name in by_addr.items() if name in ROOTS]
+    errors = []
+    for addr, size, kind, name in vtables:
+        cls = names[name].replace("vtable for ", "")
+        methods = next((m for pattern, m in VIRTUALS if pattern.match(cls)), None)
+        if not methods:
+            continue
+        used = False
+        for offset in range(8, size, 4):  # After the offset to top and the typeinfo
+            target = elf.word(addr + offset)
+            if target is None or target not in by_addr:
+                continue
+            if by_addr[target].split("::")[-1] in methods:
+                used = True
+                roots.append(target)
+        if used and in_flash(elf.section_at(addr)):
+            errors.append("vtable for %s is in flash" % cls)
+
+    # Breadth first, so the path shown to each function is a shortest one
+    via = {addr: None for addr in roots}
+    queue = list(roots)
+    while queue:
+        addr = queue.pop(0)
+        section = elf.section_at(addr)
+        if in_flash(section):
+            path = []
+            step = addr
+            while step is not None:
+                path.append(by_addr.get(step, hex(step)))
+                step = via[step]
+            errors.append("%s is in flash, reached by %s" % (path[0], " <- ".join(path[1:]) or "its being a root"))
+            continue
+        for target in calls.get(addr, ()):
+            if target not in via:
+                via[target] = addr
+                queue.append(target)
+
+    missing = set(ROOTS) - {by_addr[addr] for addr in roots if addr in by_addr}
+    for name in sorted(missing):
+        print("check_iram: root %s not found" % name)
+    for error in errors:
+        print("check_iram: " + error)
+    print("check_iram: %d functions reachable from interrupts, %d problems" % (len(via), len(errors)))
+    return len(errors)
+
+
+try:
+    Import("env")
+
+    def post_link(source, target, env):
+        mode = env.GetProjectOption("custom_iram_check", "error")
+        if mode == "off":
+            return
+        prefix = env.subst("$CC")[: -len("gcc")]
+        if check(str(target[0]), prefix) and mode != "warn":
+            env.Exit(1)
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", post_link)
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) < 2:
+            sys.exit("Usage: check_iram.py firmware.elf [toolchain-prefix]")
+        sys.exit(1 if check(sys.argv[1], sys.argv[2] if len(sys.argv) > 2 else "xtensa-esp32-elf-") else 0)
@@ -0,0 +1,74 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Benchmark.h"
+
+#include "Machine/MachineConfig.h"  // config
+#include "Driver/delay_usecs.h"     // getCpuTicks(), ticks_per_us
+#include "Channel.h"
+#include "Planner.h"  // plan_benchmark()
+#include "Report.h"   // report_realtime_status()
+#include "Stepper.h"  // Stepper::bresenham_benchmark()
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string>
+
+namespace Benchmark {
+    static const uint32_t planSegments = 1000;
+    static const uint32_t nReports     = 200;
+    static const uint32_t nTicks       = 100000;
+
+    // Formats reports as a real channel would, and drops them
+    class NullChannel : public Channel {
+    public:
+        NullChannel() : Channel("benchmark") {}
+
+        size_t write(uint8_t c) override { return 1; }
+
+        void sendLine(MsgLevel level, const char* line) override { log_pool_release(line); }
+        void sendLine(MsgLevel level, const std::string* line) override { delete line; }
+        void sendLine(MsgLevel level, const std::string& line) override {}
+    };
+
+    void result(Channel& out, const char* name, float value, const char* unit) {
+        log_stream(out, "[BENCH:" << name << "," << value << "," << unit);
+    }
+
+    Error run(Channel& out) {
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t n_axes : { 1, 3, 6 }) {
+            if (n_axes > n_axis) {
+                log_info_to(out, "Skipping the planner on " << n_axes << " axes, since the machine has " << n_axis);
+                continue;
+            }
+            uint32_t    ticks = plan_benchmark(out, planSegments, 0.05f, n_axes);
+            std::string name  = "plan_buffer_line_" + std::to_string(n_axes) + "_axes";
+            result(out, name.c_str(), float(ticks) / ticks_per_us, "us");
+        }
+
+        // The tracer runs on arrays of its own, so all the axis counts can be timed
+        for (size_t n_axes : { 3, 6 }) {
+            if (n_axes > MAX_N_AXIS) {
+                continue;
+            }
+            uint32_t    ticks = Stepper::bresenham_benchmark(n_axes, nTicks);
+            std::string name  = "bresenham_" + std::to_string(n_axes) + "_axes";
+            result(out, name.c_str(), ticks, "cycles");
+        }
+
+        // A report within the same RTOS tick as the last one reuses its snapshot, so each
+        // one is made in a tick of its own to time the capture too
+        NullChannel null;
+        uint64_t    total_ticks = 0;
+        for (uint32_t i = 0; i < nReports; i++) {
+            vTaskDelay(1);
+            int32_t start = getCpuTicks();
+            report_realtime_status(null);
+            total_ticks += uint32_t(getCpuTicks() - start);
+        }
+        float report_us = float(total_ticks) / ticks_per_us / nReports;
+        log_info_to(out, "Status report: " << report_us << " us");
+        result(out, "report_realtime_status", report_us, "us");
+        return Error::Ok;
+    }
+}
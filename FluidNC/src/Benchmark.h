@@ -0,0 +1,29 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Benchmark.h - the performance suite for the hot paths of the motion pipeline
+
+  $Benchmark times plan_buffer_line() per block with 1, 3 and 6 axes moving, as far as
+  the machine has them, the Bresenham tick of the step ISR in cycles with 3 and 6 axes,
+  and report_realtime_status() per report.  $SD/Bench and
+  $LocalFS/Bench, in MotionBench.h, add the figures that need a real job: prep_buffer()
+  per segment, pulse_func() per call and gc_execute_line() lines per second.
+
+  Every figure is also sent as a [BENCH:name,value,unit] line, which benchmark.py
+  collects from a captured session and compares with a baseline saved from an earlier
+  one, so a change that slows a path down shows up as a regression.
+*/
+
+#include "Error.h"
+
+class Channel;
+
+namespace Benchmark {
+    // Sends one result as a [BENCH:name,value,unit] line
+    void result(Channel& out, const char* name, float value, const char* unit);
+
+    // Runs the suite.  Resets the planner, so it must only be called when idle.
+    Error run(Channel& out);
+}
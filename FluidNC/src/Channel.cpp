@@ -7,14 +7,19 @@
 #include "RealtimeCmd.h"            // execute_realtime_command
 #include "Limits.h"
 #include "Logging.h"
+#include "Protocol.h"  // protocol_notify_polling
+#include "Jog.h"       // jog_velocity()
 #include <string_view>
+#include <algorithm>
 
 void Channel::flushRx() {
     _linelen   = 0;
     _lastWasCR = false;
-    while (_queue.size()) {
-        _queue.pop();
-    }
+    _rxRing.reset();
+    // After a reset the sender restarts its count, so acks for the
+    // lines before the reset must not be reported.
+    std::lock_guard<std::mutex> lock(_ackMutex);
+    _pendingAcks = 0;
 }
 
 bool Channel::lineComplete(char* line, char ch) {
@@ -70,17 +75,51 @@ bool Channel::lineComplete(char* line, char ch) {
 uint32_t Channel::setReportInterval(uint32_t ms) {
     uint32_t actual = ms;
     if (actual) {
-        actual = std::max(actual, uint32_t(50));
+        actual = std::max(actual, _binaryStatus ? minBinaryReportInterval : minReportInterval);
     }
     _reportInterval = actual;
     _nextReportTime = int32_t(xTaskGetTickCount());
     _lastTool       = 255;  // Force GCodeState report
     return actual;
 }
+
+uint32_t Channel::setStreamWindow(uint32_t bytes) {
+    uint32_t actual = bytes;
+    if (actual) {
+        actual = std::min(std::max(actual, uint32_t(defaultRxWindow)), uint32_t(maxStreamWindow));
+    }
+    flushAcks(true);
+    _streamWindow = actual;
+    return actual;
+}
+
+bool Channel::setBinaryStatus(bool on) {
+    _binaryStatus = on && canSendBinary();
+    if (on && !_binaryStatus) {
+        log_msg_to(*this, _name << " cannot send binary status");
+    } else {
+        log_msg_to(*this, _name << " binary status " << (_binaryStatus ? "on" : "off"));
+    }
+    if (!_binaryStatus && _reportInterval) {
+        setReportInterval(_reportInterval);
+    }
+    return _binaryStatus;
+}
+
+void Channel::setDeltaStatus(bool on) {
+    _statusDelta.on = on;
+    _statusDelta.fields.clear();
+    _statusDelta.nextKeyframe = int32_t(xTaskGetTickCount());
+}
+
 static bool motionState() {
     return sys.state == State::Cycle || sys.state == State::Homing || sys.state == State::Jog;
 }
 
+void Channel::reportStatus() {
+    report_realtime_delta(*this);
+}
+
 void Channel::autoReportGCodeState() {
     // When moving, we suppress $G reports in which the only change is the motion mode
     // (e.g. G0/G1/G2/G3 changes) because rapid-fire motion mode changes are fairly common.
@@ -108,7 +147,7 @@ void Channel::autoReport() {
             report_recompute_pin_string();
         }
         if (_reportWco || sys.state != _lastState || probeState != _lastProbe || _lastPinString != report_pin_string ||
-            (motionState() && (int32_t(xTaskGetTickCount()) - _nextReportTime) >= 0)) {
+            ((motionState() || _binaryStatus) && (int32_t(xTaskGetTickCount()) - _nextReportTime) >= 0)) {
             if (_reportWco) {
                 report_wco_counter = 0;
             }
@@ -118,11 +157,15 @@ void Channel::autoReport() {
             _lastPinString = report_pin_string;
 
             _nextReportTime = xTaskGetTickCount() + _reportInterval;
-            report_realtime_status(*this);
+            reportStatus();
         }
-        if (_reportNgc != CoordIndex::End) {
-            report_ngc_coord(_reportNgc, *this);
-            _reportNgc = CoordIndex::End;
+        // Each system that changed is reported once, however often it changed in the meantime
+        if (uint32_t changed = _reportNgc.exchange(0)) {
+            for (auto coord = CoordIndex::Begin; coord < CoordIndex::End; ++coord) {
+                if (changed & (1 << coord)) {
+                    report_ngc_coord(coord, *this);
+                }
+            }
         }
         autoReportGCodeState();
     }
@@ -163,6 +206,18 @@ void Channel::handleRealtimeCharacter(uint8_t ch) {
         _ackwait = false;
         return;
     }
+    if (cmd == PinFrames) {
+        log_debug(_name << " uses pin frames");
+        _pinFrames = true;
+        sendPinFrame();  // The outputs that were set before
+        return;
+    }
+    if (cmd >= PinEdgeFirst && cmd <= PinEdgeLast) {
+        cmd -= PinEdgeFirst;
+        _pinEdgeMaxAge = std::max(_pinEdgeMaxAge, (cmd >> 7) * 100);
+        pin_event(cmd & 0x3f, cmd & 0x40);
+        return;
+    }
 
     if (cmd >= PinLowFirst && cmd < PinLowLast) {
         pin_event(cmd - PinLowFirst, false);
@@ -172,45 +227,102 @@ void Channel::handleRealtimeCharacter(uint8_t ch) {
         pin_event(cmd - PinHighFirst, true);
         return;
     }
+    if (cmd >= JogVelocityFirst && cmd < JogVelocityLast) {
+        cmd -= JogVelocityFirst;
+        jog_velocity(cmd >> 8, int8_t(cmd & 0xff));
+        return;
+    }
     execute_realtime_command(static_cast<Cmd>(cmd), *this);
 }
 
-void Channel::push(uint8_t byte) {
+void Channel::pushByte(uint8_t byte) {
     if (is_realtime_command(byte)) {
         handleRealtimeCharacter(byte);
-    } else {
-        _queue.push(byte);
+    } else if (!_rxRing.full()) {
+        // A sender that stays within rx_buffer_available() never fills the ring
+        *_rxRing.back() = byte;
+        _rxRing.push();
+    }
+}
+
+void Channel::push(uint8_t byte) {
+    pushByte(byte);
+    protocol_notify_polling();
+}
+
+void Channel::push(uint8_t* data, size_t length) {
+    while (length--) {
+        pushByte(*data++);
+    }
+    protocol_notify_polling();
+}
+
+size_t Channel::read(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int ch = read();
+        if (ch < 0) {
+            break;
+        }
+        buffer[count++] = ch;
+    }
+    return count;
+}
+
+// Handles the realtime characters in buffer and parks the others in the ring,
+// where the next pollLine() that wants a line will pick them up.
+void Channel::park(const uint8_t* buffer, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t ch = buffer[i];
+        if (realtimeOkay(ch) && is_realtime_command(ch)) {
+            handleRealtimeCharacter(ch);
+        } else {
+            *_rxRing.back() = ch;
+            _rxRing.push();
+        }
     }
 }
 
 Channel* Channel::pollLine(char* line) {
     handle();
-    while (1) {
-        int ch = -1;
-        if (line && _queue.size()) {
-            ch = _queue.front();
-            _queue.pop();
-        } else {
-            ch = read();
-            if (ch < 0) {
-                break;
+    if (line) {
+        // Characters parked earlier come before anything still unread
+        while (!_rxRing.empty()) {
+            uint8_t ch = *_rxRing.front();
+            _rxRing.pop();
+            if (lineComplete(line, ch)) {
+                return this;
             }
+        }
+    }
+    uint8_t chunk[64];
+    size_t  taken = 0;
+    while (taken < maxPollBytes) {
+        // The chunk is sized so that its leftovers always fit in the ring.  When the
+        // ring is full, the rest of the input stays in the channel's own buffer.
+        size_t length = read(chunk, std::min(sizeof(chunk), size_t(_rxRing.available())));
+        if (!length) {
+            break;
+        }
+        taken += length;
+        if (!line) {
+            park(chunk, length);
+            continue;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t ch = chunk[i];
             if (realtimeOkay(ch) && is_realtime_command(ch)) {
-                handleRealtimeCharacter((uint8_t)ch);
+                handleRealtimeCharacter(ch);
                 continue;
             }
-            if (!line) {
-                _queue.push(ch);
-                continue;
+            if (lineComplete(line, ch)) {
+                park(chunk + i + 1, length - i - 1);
+                return this;
             }
-            // Fall through if line is non-null and it is not a realtime character
-        }
-
-        if (lineComplete(line, ch)) {
-            return this;
         }
     }
     if (_active) {
+        flushAcks(false);
         autoReport();
     }
     return nullptr;
@@ -223,6 +335,35 @@ void Channel::setAttr(int index, bool* value, const std::string& attrString, con
     out_acked(attrString, tag);
 }
 
+void Channel::writePin(int index, bool high) {
+    if (index < maxPinWords * 16) {
+        uint64_t bit    = uint64_t(1) << index;
+        _pinOutputs     = high ? (_pinOutputs | bit) : (_pinOutputs & ~bit);
+        _pinOutputWords = std::max(_pinOutputWords, index / 16 + 1);
+    }
+    if (_pinFrames && index < maxPinWords * 16) {
+        sendPinFrame();
+        return;
+    }
+    std::string s = "io.";
+    s += std::to_string(index);
+    s += "=";
+    s += std::to_string(high);
+    out(s, "SET:");
+}
+
+void Channel::sendPinFrame() {
+    if (!_pinOutputWords) {
+        return;
+    }
+    uint8_t frame[2 + 4 * maxPinWords];
+    size_t  length = UTF8::encode(PinOutputsFirst + _pinOutputWords, frame);
+    for (int word = 0; word < _pinOutputWords; word++) {
+        length += UTF8::encode(PinWordFirst + uint16_t(_pinOutputs >> (16 * word)), frame + length);
+    }
+    write(frame, length);
+}
+
 void Channel::out(const char* s, const char* tag) {
     sendLine(MsgLevelNone, s);
 }
@@ -249,11 +390,48 @@ void Channel::registerEvent(uint8_t code, EventPin* obj) {
     _events[code] = obj;
 }
 
+void Channel::sendAcks() {
+    if (_pendingAcks == 1) {
+        sendLine(MsgLevelNone, "ok");
+    } else if (_pendingAcks) {
+        log_stream(*this, "ok:" << _pendingAcks);
+    }
+    _pendingAcks = 0;
+}
+
+void Channel::flushAcks(bool force) {
+    std::lock_guard<std::mutex> lock(_ackMutex);
+    if (_pendingAcks && (force || (int32_t(xTaskGetTickCount()) - _ackDeadline) >= 0)) {
+        sendAcks();
+    }
+}
+
 void Channel::ack(Error status) {
+    if (_streamWindow) {
+        // ack() runs in the main loop and flushAcks() in the polling task,
+        // so the lock keeps the counts and their order intact.
+        std::lock_guard<std::mutex> lock(_ackMutex);
+        if (status == Error::Ok) {
+            if (_pendingAcks++ == 0) {
+                _ackDeadline = int32_t(xTaskGetTickCount() + ackHoldMs);
+            }
+            if (_pendingAcks >= maxBatchedAcks) {
+                sendAcks();
+            }
+            return;
+        }
+        sendAcks();
+        sendError(status);
+        return;
+    }
     if (status == Error::Ok) {
         sendLine(MsgLevelNone, "ok");
         return;
     }
+    sendError(status);
+}
+
+void Channel::sendError(Error status) {
     // With verbose errors, the message text is displayed instead of the number.
     // Grbl 0.9 used to display the text, while Grbl 1.1 switched to the number.
     // Many senders support both formats.
@@ -267,8 +445,26 @@ void Channel::ack(Error status) {
 
 void Channel::print_msg(MsgLevel level, const char* msg) {
     if (_message_level >= level) {
-        println(msg);
+        if (!_batching) {
+            println(msg);
+            return;
+        }
+        _outBatch += msg;
+        _outBatch += "\r\n";
+        if (_outBatch.length() >= maxOutputBatch) {
+            write((const uint8_t*)_outBatch.c_str(), _outBatch.length());
+            _outBatch.clear();
+        }
+    }
+}
+
+void Channel::flushOutputBatch() {
+    if (_outBatch.length()) {
+        write((const uint8_t*)_outBatch.c_str(), _outBatch.length());
+        // clear() keeps the capacity, so later batches do not allocate
+        _outBatch.clear();
     }
+    _batching = false;
 }
 
 // This overload is used primarily with fixed string
@@ -282,6 +478,7 @@ void Channel::sendLine(MsgLevel level, const char* line) {
         while (!xQueueSend(message_queue, &msg, 10)) {}
     } else {
         print_msg(level, line);
+        log_pool_release(line);
     }
 }
 
@@ -13,6 +13,13 @@
 // overrunning input buffers.  The default implementation of ack() sends
 // "ok" and "error:" messages via the standard Grbl serial protocol, but it
 // could be implemented in other ways for different channel protocols.
+//
+// A channel can optionally be switched into streaming mode with setStreamWindow().
+// In that mode it advertises a larger reception window, and successful lines are
+// acknowledged in batches as "ok:N", meaning that N more lines have completed.
+// Errors are never batched; any pending acks are sent before the error so the
+// sender can tell which line failed.  This lets a character-counting sender keep
+// the planner full over high-latency links like WiFi.
 
 #pragma once
 
@@ -21,13 +28,25 @@
 #include "Types.h"        // State
 #include "RealtimeCmd.h"  // Cmd
 #include "UTF8.h"
+#include "SpscRing.h"
 
 #include "Pins/PinAttributes.h"
 #include "Machine/EventPin.h"
 
 #include <Stream.h>
 #include <freertos/FreeRTOS.h>  // TickType_T
-#include <queue>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What a channel in delta status mode last sent for each report field; see
+// report_realtime_delta()
+struct StatusDelta {
+    bool                     on = false;
+    std::vector<std::string> fields;  // As last sent, indexed by report field
+    int32_t                  nextKeyframe = 0;
+};
 
 class Channel : public Stream {
 private:
@@ -41,11 +60,56 @@ private:
     const int PinACK = 0xB2;
     const int PinNAK = 0xB3;
 
+    // A device that sends PinFrames, after the RST it gets at startup, is sent the state of
+    // all of its outputs as one frame, PinOutputsFirst + n and then n codes of
+    // PinWordFirst + 16 outputs each, instead of a SET: line for every change.  It may
+    // then report input edges as PinEdgeFirst + (age << 7) + (level << 6) + pin, age
+    // being the time since the edge in 100 us units, so that a burst of edges on many
+    // pins can be sent at once without losing their order or their times.
+    const int      PinFrames       = 0xB4;
+    const int      PinOutputsFirst = 0x1F0;
+    const uint32_t PinWordFirst    = 0x10000;
+    const uint32_t PinEdgeFirst    = 0x10000;
+    const uint32_t PinEdgeLast     = 0x10FFFF;
+
+    static const int maxPinWords = 4;  // 64 pins, as for the PinLow and PinHigh codes
+
+    bool     _pinFrames      = false;
+    uint64_t _pinOutputs     = 0;  // The last level written to each output
+    int      _pinOutputWords = 0;  // Words up to the highest output pin
+    uint32_t _pinEdgeMaxAge  = 0;  // In usecs
+
+    void sendPinFrame();
+
     const int timeout = 2000;
 
+    // Streaming mode sends pending acks once this many have accumulated,
+    // or when the oldest of them has waited ackHoldMs.
+    static const uint32_t maxBatchedAcks = 32;
+    static const uint32_t ackHoldMs      = 10;
+
+    // Text reports are limited to 20 per second, binary frames to 100
+    static const uint32_t minReportInterval       = 50;
+    static const uint32_t minBinaryReportInterval = 10;
+
+    void sendError(Error status);
+    void sendAcks();
+
+    void park(const uint8_t* buffer, size_t length);
+    void pushByte(uint8_t byte);
+
 public:
     static const int maxLine = 255;
 
+    static const int rxRingSize      = 1024;
+    static const int defaultRxWindow = 256;
+    static const int maxStreamWindow = 16384;
+
+    // Input that one pollLine() takes without finding a line.  A sender that floods a
+    // channel with characters and no line ending, or with realtime characters, would
+    // otherwise keep the main loop there for as long as the characters kept coming.
+    static const size_t maxPollBytes = 4 * maxLine;
+
     int _message_level = MsgLevelVerbose;
 
 protected:
@@ -55,10 +119,18 @@ protected:
     bool        _addCR     = false;
     char        _lastWasCR = false;
 
-    std::queue<uint8_t> _queue;
+    // Characters that were received but not yet assembled into a line.  Push-style
+    // channels like WebSockets deliver all their input here, and pollLine() parks
+    // characters here when reading ahead for realtime commands.  The storage is
+    // inline so that no allocation happens as the input flows.
+    uint8_t           _rxBuffer[rxRingSize];
+    SpscRing<uint8_t> _rxRing;
 
     uint32_t _reportInterval = 0;
     int32_t  _nextReportTime = 0;
+    bool     _binaryStatus   = false;
+
+    StatusDelta _statusDelta;
 
     gc_modal_t  _lastModal;
     uint8_t     _lastTool;
@@ -69,8 +141,18 @@ protected:
     bool        _lastProbe;
     std::string _lastPinString;
 
-    bool       _reportWco = true;
-    CoordIndex _reportNgc = CoordIndex::End;
+    // While the output task is sending a burst of messages, print_msg() collects
+    // them here so the channel receives them in one write().
+    std::string _outBatch;
+    bool        _batching = false;
+
+    uint32_t   _streamWindow = 0;  // 0 means ordinary line-by-line acks
+    uint32_t   _pendingAcks  = 0;
+    int32_t    _ackDeadline  = 0;
+    std::mutex _ackMutex;
+
+    bool                  _reportWco = true;
+    std::atomic<uint32_t> _reportNgc { 0 };  // A bit per CoordIndex that changed since the last report
 
     Cmd _last_rt_cmd;
 
@@ -84,10 +166,11 @@ protected:
     bool _active = true;
 
 public:
-    Channel(const char* name, bool addCR = false) : _name(name), _linelen(0), _addCR(addCR) {}
+    Channel(const char* name, bool addCR = false) : _name(name), _linelen(0), _addCR(addCR) { _rxRing.init(_rxBuffer, rxRingSize); }
     Channel(const char* name, int num, bool addCR = false) {
         _name = name;
         _name += std::to_string(num), _linelen = 0, _addCR = addCR;
+        _rxRing.init(_rxBuffer, rxRingSize);
     }
     virtual ~Channel() = default;
 
@@ -106,9 +189,20 @@ public:
     // a reception buffer, even if the system is busy.  Channels that can handle external
     // input via an interrupt or other background mechanism should override it to return
     // the remaining space that mechanism has available.
-    // The queue can handle more than 256 characters but we don't want it to get too
-    // large, so we report a limited size.
-    virtual int rx_buffer_available() { return std::max(0, 256 - int(_queue.size())); }
+    // The ring can hold more than 256 characters but we report a limited size unless
+    // streaming mode asks for more, and never more than the ring has room for.
+    virtual int rx_buffer_available() { return std::max(0, std::min(rxWindow() - int(_rxRing.size()), int(_rxRing.available()))); }
+
+    int rxWindow() { return _streamWindow ? _streamWindow : defaultRxWindow; }
+
+    // setStreamWindow() turns streaming mode on with the given window size in bytes,
+    // or off with 0.  It returns the window actually used.
+    uint32_t setStreamWindow(uint32_t bytes);
+    uint32_t getStreamWindow() { return _streamWindow; }
+
+    // flushAcks() sends batched acks that have waited long enough, or all of them
+    // if force is true.
+    void flushAcks(bool force);
 
     // flushRx() discards any characters that have already been received.  It is used
     // after a reset, so that anything already sent will not be processed.
@@ -134,6 +228,10 @@ public:
 
     virtual void stopJob() {}
 
+    // When lines from several channels are waiting, those of the highest priority
+    // run first.  Jobs are below the interactive channels.
+    virtual int linePriority() { return 1; }
+
     virtual bool is_visible(const std::string& stem, const std::string& extension, bool isdir);
 
     size_t timedReadBytes(uint8_t* buffer, size_t length, TickType_t timeout) { return timedReadBytes((char*)buffer, length, timeout); }
@@ -145,27 +243,52 @@ public:
     }
 
     void notifyWco() { _reportWco = true; }
-    void notifyNgc(CoordIndex coord) { _reportNgc = coord; }
+    void notifyNgc(CoordIndex coord) { _reportNgc.fetch_or(1 << coord); }
 
     int peek() override { return -1; }
     int read() override { return -1; }
-    int available() override { return _queue.size(); }
+    int available() override { return _rxRing.size(); }
+
+    // read() with a buffer returns up to length characters that are available
+    // without waiting.  pollLine() uses it to take input in chunks; channels whose
+    // source can deliver several characters at once should override it.
+    virtual size_t read(uint8_t* buffer, size_t length);
 
     virtual void print_msg(MsgLevel level, const char* msg);
 
     void print_msg(MsgLevel level, const std::string& msg) { print_msg(level, msg.c_str()); }
 
+    // Output batching for the output task.  A batch is written early if it grows
+    // past maxOutputBatch, which is about one TCP segment.
+    static const size_t maxOutputBatch = 1400;
+    virtual void        beginOutputBatch() { _batching = true; }
+    virtual void        flushOutputBatch();
+
     uint32_t     setReportInterval(uint32_t ms);
     uint32_t     getReportInterval() { return _reportInterval; }
     virtual void autoReport();
+
+    // reportStatus() is called by autoReport() when the status has changed or is
+    // due.  Internal consumers that want values rather than text override it and
+    // use report_machine_status().
+    virtual void reportStatus();
     void         autoReportGCodeState();
 
+    // With binary status on, a channel that can carry binary frames sends one
+    // in place of each automatic text report, at every report interval rather
+    // than only while moving.  setBinaryStatus() returns the resulting state.
+    virtual bool canSendBinary() { return false; }
+    bool         setBinaryStatus(bool on);
+    bool         binaryStatus() { return _binaryStatus; }
+
+    // In delta status mode, automatic reports carry only the fields that changed,
+    // with a full keyframe now and then.
+    void         setDeltaStatus(bool on);
+    bool         deltaStatus() { return _statusDelta.on; }
+    StatusDelta& statusDelta() { return _statusDelta; }
+
     void push(uint8_t byte);
-    void push(uint8_t* data, size_t length) {
-        while (length--) {
-            push(*data++);
-        }
-    }
+    void push(uint8_t* data, size_t length);
 
     void push(const std::string& s) { push((uint8_t*)s.c_str(), s.length()); }
 
@@ -176,6 +299,12 @@ public:
 
     void setAttr(int index, bool* valuep, const std::string& s, const char* tag);
 
+    // Sets an output of the device on the other end of the channel
+    void writePin(int index, bool high);
+
+    bool     pinFrames() { return _pinFrames; }
+    uint32_t pinEdgeMaxAge() { return _pinEdgeMaxAge; }
+
     void ready();
     void registerEvent(uint8_t code, EventPin* obj);
 };
@@ -23,7 +23,35 @@ Some features should not be changed. See notes below.
 // machine.h is #included below, after some definitions
 // that the machine file might choose to undefine.
 
-const int MAX_N_AXIS = 6;
+// The largest number of axes and of motors on each axis.  Machines that need
+// more, such as a 9-axis machine or a gantry with four motors on one axis, can
+// raise them with build flags.  The coordinates in NVS are sized by MAX_N_AXIS,
+// so changing it resets the stored offsets.
+#ifndef FLUIDNC_MAX_N_AXIS
+#    define FLUIDNC_MAX_N_AXIS 6
+#endif
+#ifndef FLUIDNC_MAX_MOTORS_PER_AXIS
+#    define FLUIDNC_MAX_MOTORS_PER_AXIS 2
+#endif
+
+const int MAX_N_AXIS          = FLUIDNC_MAX_N_AXIS;
+const int MAX_MOTORS_PER_AXIS = FLUIDNC_MAX_MOTORS_PER_AXIS;
+
+// Every motor of every axis has a bit in a 32-bit MotorMask, so that the step
+// ISR works on a single word.  See Machine::Axes::motor_bit().
+const int MOTOR_MASK_STRIDE = MAX_MOTORS_PER_AXIS <= 2 ? 16 : 32 / MAX_MOTORS_PER_AXIS;
+
+static_assert(MAX_N_AXIS >= 3 && MAX_N_AXIS <= 9, "MAX_N_AXIS must be from 3 to 9, the axis letters XYZABCUVW");
+static_assert(MAX_MOTORS_PER_AXIS >= 1 && MAX_MOTORS_PER_AXIS <= 10, "MAX_MOTORS_PER_AXIS must be from 1 to 10");
+static_assert(MAX_N_AXIS <= MOTOR_MASK_STRIDE, "Too many axes and motors per axis to fit every motor in a MotorMask");
+
+// A build for one machine model can fix its axis count with FLUIDNC_FIXED_N_AXIS, which
+// machine-flags.py works out from the config file that FLUIDNC_MACHINE names.  The step
+// ISR and the segment prep then loop over a constant, and a config file with another
+// axis count is refused.
+#ifdef FLUIDNC_FIXED_N_AXIS
+static_assert(FLUIDNC_FIXED_N_AXIS >= 3 && FLUIDNC_FIXED_N_AXIS <= MAX_N_AXIS, "FLUIDNC_FIXED_N_AXIS must be from 3 to MAX_N_AXIS");
+#endif
 
 const int MAX_MESSAGE_LINE = 256;
 
@@ -36,6 +64,9 @@ const int Z_AXIS = 2;
 const int A_AXIS = 3;
 const int B_AXIS = 4;
 const int C_AXIS = 5;
+const int U_AXIS = 6;
+const int V_AXIS = 7;
+const int W_AXIS = 8;
 
 const int X2_AXIS = (X_AXIS + MAX_N_AXIS);
 const int Y2_AXIS = (Y_AXIS + MAX_N_AXIS);
@@ -46,11 +77,71 @@ const int C2_AXIS = (C_AXIS + MAX_N_AXIS);
 
 const int SUPPORT_TASK_CORE = 0;  // Reference: CONFIG_ARDUINO_RUNNING_CORE = 1
 
+// Core and priority of the step preparation task, used when stepping/prep_task is set.
+// The priority is above the lwIP task (18) but below the WiFi driver (23).
+const int STEP_PREP_TASK_CORE     = 0;
+const int STEP_PREP_TASK_PRIORITY = 19;
+
+// Core and priority of the task that runs the step ISR for $SD/Bench and $LocalFS/Bench.  It
+// yields between slices of stepping, so the priority can be low.
+const int MOTION_BENCH_TASK_CORE     = 0;
+const int MOTION_BENCH_TASK_PRIORITY = 1;
+
+// Core and priority of the tasks that read jobs ahead: file jobs when sdcard/read_ahead_bytes
+// is set, and network stream jobs
+const int FILE_READ_TASK_CORE     = 0;
+const int FILE_READ_TASK_PRIORITY = 2;
+
+// Core and priority of the task that sends job event notifications to the URLToCall setting
+const int WEBHOOK_TASK_CORE     = 0;
+const int WEBHOOK_TASK_PRIORITY = 1;
+
+// Core and priority of the task that writes job telemetry when sdcard/telemetry_ms is set.
+// The priority is below the file read tasks, so a job's reads come before its telemetry.
+const int TELEMETRY_TASK_CORE     = 0;
+const int TELEMETRY_TASK_PRIORITY = 1;
+
+// Core and priority of the task that receives sync link frames.  The priority is just below
+// the step preparation task, so a follower queues the coordinator's segments as they come.
+const int SYNC_LINK_TASK_CORE     = 0;
+const int SYNC_LINK_TASK_PRIORITY = 18;
+
+// Core and priority of the task that writes web uploads to files
+const int UPLOAD_TASK_CORE     = 0;
+const int UPLOAD_TASK_PRIORITY = 2;
+
+// Core and priority of the task that serves HTTP and WebSocket clients.  The priority is
+// below the polling task, so realtime characters and input lines are not held up by web traffic.
+const int WEB_SERVER_TASK_CORE     = 0;
+const int WEB_SERVER_TASK_PRIORITY = 0;
+
+// Core and priority of the task that brings up Bluetooth or WiFi at startup, while the
+// rest of the machine is initialized
+const int NET_START_TASK_CORE     = 0;
+const int NET_START_TASK_PRIORITY = 1;
+
+// Core and priority of the tasks that run the queued transfers of each I2C bus
+const int I2C_TASK_CORE     = 0;
+const int I2C_TASK_PRIORITY = 2;
+
+// Core and priority of the task that draws the OLED screens and sends them over I2C
+const int OLED_TASK_CORE     = 0;
+const int OLED_TASK_PRIORITY = 1;
+
+// Core and priority of the task that hashes local filesystem files for the web server
+const int HASH_TASK_CORE     = 0;
+const int HASH_TASK_PRIORITY = 0;
+
 // Serial baud rate
 // OK to change, but the ESP32 boot text is 115200, so you will not see that is your
 // serial monitor, sender, etc uses a different value than 115200
 const int BAUD_RATE = 115200;
 
+// Driver buffers for the primary serial port, which starts before the config file is
+// read.  The other UARTs take rx_buffer_size and tx_buffer_size from their config nodes.
+const int UART0_RX_BUFFER_SIZE = 4096;
+const int UART0_TX_BUFFER_SIZE = 1024;
+
 //Connect to your local AP with these credentials
 //#define CONNECT_TO_SSID  "your SSID"
 //#define SSID_PASSWORD  "your SSID password"
@@ -134,15 +225,6 @@ const int REPORT_OVR_REFRESH_IDLE_COUNT = 10;  // (1-255) Must be less than or e
 const int REPORT_WCO_REFRESH_BUSY_COUNT = 30;  // (2-255)
 const int REPORT_WCO_REFRESH_IDLE_COUNT = 10;  // (2-255) Must be less than or equal to the busy count
 
-// The temporal resolution of the acceleration management subsystem. A higher number gives smoother
-// acceleration, particularly noticeable on machines that run at very high feedrates, but may negatively
-// impact performance. The correct value for this parameter is machine dependent, so it's advised to
-// set this only as high as needed. Approximate successful values can widely range from 50 to 200 or more.
-// NOTE: Changing this value also changes the execution time of a segment in the step segment buffer.
-// When increasing this value, this stores less overall time in the segment buffer and vice versa. Make
-// certain the step segment buffer is increased/decreased to account for these changes.
-const int ACCELERATION_TICKS_PER_SECOND = 100;
-
 // Sets which axis the tool length offset is applied. Assumes the spindle is always parallel with
 // the selected axis with the tool oriented toward the negative direction. In other words, a positive
 // tool length offset value is subtracted from the current location.
@@ -196,9 +278,14 @@ const double ARC_ANGULAR_TRAVEL_EPSILON = 5E-7;  // Float (radians)
 // and wait for an 'ok' before sending more data.
 // NOTE: Most setting changes - $ commands - are blocked when a job is running. Coordinate setting
 // GCode commands (G10,G28/30.1) are not blocked, since they are part of an active streaming job.
-// This option forces a planner buffer sync only with such GCode commands.
+// Such GCode commands only change the value in memory; this option holds the write back until
+// the planner buffer is empty and the machine has stopped.
 const bool FORCE_BUFFER_SYNC_DURING_NVS_WRITE = true;  // Default enabled. Comment to disable.
 
+// A changed coordinate system is written this long after its last change, so that a probing
+// cycle that sets an offset for each part, with pauses in between, does not write each one.
+const uint32_t COORD_WRITE_HOLDOFF_MS = 2000;
+
 // In old versions of Grbl, v0.9 and prior, there is a bug where the `WPos:` work position reported
 // may not correlate to what is executing, because `WPos:` is based on the GCode parser state, which
 // can be several motions behind. This option forces the planner buffer to empty, sync, and stop
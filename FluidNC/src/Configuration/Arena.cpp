@@ -0,0 +1,98 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Arena.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace Configuration {
+    struct alignas(std::max_align_t) Arena::Block {
+        Block* next;
+        size_t size;  // Of the data after the header
+        size_t used;
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+        bool  contains(void* p) { return p >= data() && p < data() + size; }
+    };
+
+    Arena::Block* Arena::_blocks = nullptr;
+    bool          Arena::_open   = false;
+    size_t        Arena::_live   = 0;
+    size_t        Arena::_used   = 0;
+
+    static const size_t alignment = alignof(std::max_align_t);
+
+    void Arena::open() { _open = true; }
+    void Arena::close() { _open = false; }
+
+    void* Arena::allocate(size_t size) {
+        if (!_open) {
+            return ::operator new(size);
+        }
+        size = (size + alignment - 1) & ~(alignment - 1);
+
+        // Only the newest block has room worth looking for
+        Block* block = _blocks;
+        if (!block || block->size - block->used < size) {
+            size_t want = size > blockSize / 4 ? size : blockSize - sizeof(Block);
+            block       = static_cast<Block*>(malloc(sizeof(Block) + want));
+            if (!block) {
+                return ::operator new(size);  // Which throws if the heap is out
+            }
+            block->size = want;
+            block->used = 0;
+            if (want == size && _blocks) {
+                // A large object gets a block to itself, behind the one that is being filled
+                block->next   = _blocks->next;
+                _blocks->next = block;
+            } else {
+                block->next = _blocks;
+                _blocks     = block;
+            }
+        }
+        void* p = block->data() + block->used;
+        block->used += size;
+        _used += size;
+        ++_live;
+        return p;
+    }
+
+    void Arena::free(void* p) {
+        if (!p) {
+            return;
+        }
+        for (Block* block = _blocks; block; block = block->next) {
+            if (block->contains(p)) {
+                --_live;
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+    bool Arena::release() {
+        if (_live) {
+            return false;
+        }
+        while (_blocks) {
+            Block* next = _blocks->next;
+            ::free(_blocks);
+            _blocks = next;
+        }
+        _used = 0;
+        return true;
+    }
+
+    size_t Arena::used() { return _used; }
+
+    size_t Arena::reserved() {
+        size_t total = 0;
+        for (Block* block = _blocks; block; block = block->next) {
+            total += sizeof(Block) + block->size;
+        }
+        return total;
+    }
+
+    size_t Arena::live() { return _live; }
+}
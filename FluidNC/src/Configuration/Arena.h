@@ -0,0 +1,51 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+
+namespace Configuration {
+    // The objects of the configuration tree, the Configurables and the pin details, are
+    // many and small and live until the next configuration is loaded.  Made with new one
+    // at a time, they would be spread over the heap, between the buffers of whatever
+    // allocated at the same time, and leave it in small free pieces when they go.  While
+    // the arena is open, their operator new takes them from a few large blocks instead,
+    // one after the other.  Their operator delete only counts them off, and release()
+    // frees the blocks when all of them are gone, as they are when the old configuration
+    // has been deleted.
+    //
+    // The configuration is loaded in one task, before the tasks that could make these
+    // objects for themselves are started, so the arena needs no lock.
+    class Arena {
+    public:
+        static const size_t blockSize = 4096;
+
+        // Objects are taken from the arena between these
+        static void open();
+        static void close();
+
+        static void* allocate(size_t size);
+        static void  free(void* p);
+
+        // Frees the blocks if no object in them is left, and returns whether it did
+        static bool release();
+
+        static size_t used();      // Bytes handed out since the last release()
+        static size_t reserved();  // Bytes in blocks
+        static size_t live();      // Objects not yet deleted
+
+    private:
+        struct Block;
+        static Block* _blocks;
+        static bool   _open;
+        static size_t _live;
+        static size_t _used;
+    };
+
+    // For the classes whose objects belong to the configuration
+    class ArenaAllocated {
+    public:
+        static void* operator new(size_t size) { return Arena::allocate(size); }
+        static void  operator delete(void* p) { Arena::free(p); }
+    };
+}
@@ -3,13 +3,14 @@
 
 #pragma once
 
+#include "Arena.h"
 #include "Generator.h"
 #include "Parser.h"
 
 namespace Configuration {
     class HandlerBase;
 
-    class Configurable {
+    class Configurable : public ArenaAllocated {
         Configurable(const Configurable&) = delete;
         Configurable(Configurable&&)      = default;
 
@@ -4,5 +4,5 @@
 #pragma once
 
 namespace Configuration {
-    enum struct HandlerType { Parser, AfterParse, Runtime, Generator, Validator, Completer };
+    enum struct HandlerType { Parser, AfterParse, Runtime, Generator, Validator, Completer, Indexer };
 }
@@ -4,12 +4,11 @@
 #include "JsonGenerator.h"
 
 #include "Configurable.h"
+#include "../FloatFormat.h"  // format_fixed()
 
 #include <cstring>
 #include <cstdio>
 #include <atomic>
-#include <sstream>
-#include <iomanip>
 
 namespace Configuration {
     JsonGenerator::JsonGenerator(WebUI::JSONencoder& encoder) : _encoder(encoder) {
@@ -94,9 +93,9 @@ namespace Configuration {
         } else if (value < -999999.999f) {
             value = -999999.999f;
         }
-        std::ostringstream fstr;
-        fstr << std::fixed << std::setprecision(3) << value;
-        _encoder.begin_webui(_currentPath, _currentPath, "R", fstr.str());
+        char fstr[fixedFormatMax];
+        format_fixed(fstr, value, 3);
+        _encoder.begin_webui(_currentPath, _currentPath, "R", fstr);
         _encoder.end_object();
         leave();
     }
@@ -15,7 +15,8 @@
 #include <string_view>
 
 namespace Configuration {
-    Parser::Parser(std::string_view yaml_string) : Tokenizer(yaml_string) {}
+    Parser::Parser(std::string_view yaml_string, bool compiled) : Tokenizer(yaml_string, compiled) {}
+    Parser::Parser(reader_t read, bool compiled) : Tokenizer(read, compiled) {}
 
     void Parser::parseError(const char* description) const {
         // Attempt to use the correct position in the parser:
@@ -19,7 +19,8 @@ namespace Configuration {
         void parseError(const char* description) const;
 
     public:
-        Parser(std::string_view yaml_string);
+        Parser(std::string_view yaml_string, bool compiled = false);
+        Parser(reader_t read, bool compiled = false);
 
         bool is(const char* expected);
 
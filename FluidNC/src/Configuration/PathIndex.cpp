@@ -0,0 +1,51 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "PathIndex.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace Configuration {
+    std::map<std::string, Configurable*> PathIndex::_sections;
+
+    static void append_lower(std::string& s, const char* name, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            s += char(tolower(name[i]));
+        }
+    }
+
+    void PathIndex::enterSection(const char* name, Configuration::Configurable* value) {
+        auto length = _path.length();
+        if (length) {
+            _path += '/';
+        }
+        append_lower(_path, name, strlen(name));
+        _sections[_path] = value;
+        value->group(*this);
+        _path.resize(length);
+    }
+
+    void PathIndex::build(Configurable* root) {
+        _sections.clear();
+        _sections[""] = root;
+        PathIndex index;
+        root->group(index);
+    }
+
+    Configurable* PathIndex::find(const char* key, const char*& leaf) {
+        if (*key == '/') {
+            ++key;
+        }
+        const char* slash = strrchr(key, '/');
+        leaf              = slash ? slash + 1 : key;
+        if (!*leaf) {
+            return nullptr;
+        }
+        std::string parent;
+        if (slash) {
+            append_lower(parent, key, slash - key);
+        }
+        auto it = _sections.find(parent);
+        return it == _sections.end() ? nullptr : it->second;
+    }
+}
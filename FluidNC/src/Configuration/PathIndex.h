@@ -0,0 +1,49 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "HandlerBase.h"
+#include "Configurable.h"
+
+#include <map>
+#include <string>
+
+namespace Configuration {
+    // The sections of the configuration tree by path, in lower case without the leading
+    // '/', so that a runtime setting starts at the section that holds it instead of
+    // walking the tree from the top.  afterParse() can add sections, so the index is
+    // rebuilt after each run of it.
+    class PathIndex : public Configuration::HandlerBase {
+    private:
+        static std::map<std::string, Configurable*> _sections;
+
+        std::string _path;
+
+        PathIndex() = default;
+
+    protected:
+        void enterSection(const char* name, Configuration::Configurable* value) override;
+        bool matchesUninitialized(const char* name) override { return false; }
+
+    public:
+        // Replaces the index with the sections of the tree below root
+        static void build(Configurable* root);
+
+        // The section that holds the item or section named by key, with leaf set to the
+        // last component of key, or nullptr if key is not under an indexed section
+        static Configurable* find(const char* key, const char*& leaf);
+
+        void item(const char* name, bool& value) override {}
+        void item(const char* name, int32_t& value, int32_t minValue, int32_t maxValue) override {}
+        void item(const char* name, uint32_t& value, uint32_t minValue, uint32_t maxValue) override {}
+        void item(const char* name, float& value, float minValue, float maxValue) override {}
+        void item(const char* name, std::vector<speedEntry>& value) override {}
+        void item(const char* name, UartData& wordLength, UartParity& parity, UartStop& stopBits) override {}
+        void item(const char* name, std::string& value, int minLength, int maxLength) override {}
+        void item(const char* name, Pin& value) override {}
+        void item(const char* name, IPAddress& value) override {}
+        void item(const char* name, int& value, EnumItem* e) override {}
+
+        HandlerType handlerType() override { return HandlerType::Indexer; }
+    };
+}
@@ -10,12 +10,12 @@
 #include <atomic>
 
 namespace Configuration {
-    RuntimeSetting::RuntimeSetting(const char* key, const char* value, Channel& out) : newValue_(value), out_(out) {
+    RuntimeSetting::RuntimeSetting(const char* key, const char* value, Channel& out, const char* start) : newValue_(value), out_(out) {
         // Remove leading '/' if it is present
         setting_ = (*key == '/') ? key + 1 : key;
         // Also remove trailing '/' if it is present
 
-        start_ = setting_;
+        start_ = start ? start : setting_;
         // Read fence for config. Shouldn't be necessary, but better safe than sorry.
         std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);
     }
@@ -31,7 +31,8 @@ namespace Configuration {
         bool matchesUninitialized(const char* name) override { return false; }
 
     public:
-        RuntimeSetting(const char* key, const char* value, Channel& out);
+        // start, if given, is the tail of key to match from, for a walk that begins below the root
+        RuntimeSetting(const char* key, const char* value, Channel& out, const char* start = nullptr);
 
         void item(const char* name, bool& value) override;
         void item(const char* name, int32_t& value, int32_t minValue, int32_t maxValue) override;
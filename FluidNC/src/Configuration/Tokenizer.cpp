@@ -8,10 +8,35 @@
 #include "parser_logging.h"
 
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 namespace Configuration {
 
-    Tokenizer::Tokenizer(std::string_view yaml_string) : _remainder(yaml_string), _linenum(0), _token() {}
+    Tokenizer::Tokenizer(std::string_view yaml_string, bool compiled) :
+        _remainder(yaml_string), _compiled(compiled), _linenum(0), _token() {}
+
+    Tokenizer::Tokenizer(reader_t read, bool compiled) : _remainder(), _compiled(compiled), _read(read), _linenum(0), _token() {}
+
+    static const size_t readChunk = 512;
+
+    // Makes at least n bytes of input available in _remainder, if there are that many left.
+    // Reading more moves the unread input to the start of the buffer, which is only done
+    // once the token that refers to it has been used.
+    bool Tokenizer::fill(size_t n) {
+        while (_remainder.size() < n && _read && !_eof) {
+            size_t keep = _remainder.size();
+            if (keep) {
+                memmove(&_buffer[0], _remainder.data(), keep);
+            }
+            _buffer.resize(std::max(_buffer.size(), std::max(n, keep + readChunk)));
+            size_t got = _read(&_buffer[keep], _buffer.size() - keep);
+            _eof       = got == 0;
+            _remainder = std::string_view(_buffer.data(), keep + got);
+        }
+        return _remainder.size() >= n;
+    }
 
     bool Tokenizer::isWhiteSpace(char c) { return c == ' ' || c == '\t' || c == '\f' || c == '\r'; }
 
@@ -49,13 +74,15 @@ namespace Configuration {
             _linenum++;
 
             // End of input
-            if (_remainder.empty()) {
+            if (!fill(1)) {
                 _line = _remainder;
                 return false;
             }
 
-            // Get next line.  The final line need not have a newline
-            auto pos = _remainder.find_first_of('\n');
+            // Get next line, reading more of a stream until it is all there.  The final line
+            // need not have a newline
+            size_t pos;
+            while ((pos = _remainder.find_first_of('\n')) == std::string_view::npos && fill(_remainder.size() + 1)) {}
             if (pos == std::string_view::npos) {
                 _line = _remainder;
                 _remainder.remove_prefix(_remainder.size());
@@ -131,6 +158,49 @@ namespace Configuration {
         }
     }
 
+    static const size_t recordHeader = 6;
+
+    bool Tokenizer::nextRecord() {
+        if (!fill(1)) {
+            return false;
+        }
+        if (!fill(recordHeader)) {
+            ParseError("Compiled configuration is truncated");
+        }
+        auto   p      = reinterpret_cast<const uint8_t*>(_remainder.data());
+        size_t keyLen = p[3];
+        size_t valLen = p[4] | (p[5] << 8);
+
+        _linenum       = p[0] | (p[1] << 8);
+        _token._indent = p[2];
+        if (!fill(recordHeader + keyLen + valLen)) {
+            ParseError("Compiled configuration is truncated");
+        }
+        _token._key   = _remainder.substr(recordHeader, keyLen);
+        _token._value = _remainder.substr(recordHeader + keyLen, valLen);
+        _remainder.remove_prefix(recordHeader + keyLen + valLen);
+        return true;
+    }
+
+    bool Tokenizer::compile(Tokenizer& source, const writer_t& out) {
+        auto&       token = source._token;
+        std::string record;
+        for (source.Tokenize(); token._state != TokenState::Eof; source.Tokenize()) {
+            if (token._indent > 0xff || token._key.size() > 0xff || token._value.size() > 0xffff) {
+                source.ParseError("Line is too long to compile");
+            }
+            int line = std::min(source._linenum, 0xffff);  // Only for error messages
+            record   = { char(line), char(line >> 8), char(token._indent), char(token._key.size()), char(token._value.size()),
+                         char(token._value.size() >> 8) };
+            record.append(token._key);
+            record.append(token._value);
+            if (!out(record.data(), record.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     void Tokenizer::Tokenize() {
         // Release a held token
         if (_token._state == TokenState::Held) {
@@ -145,7 +215,11 @@ namespace Configuration {
         // We parse 1 line at a time. Each time we get here, we can assume that the cursor
         // is at the start of the line.
 
-        if (nextLine()) {
+        if (_compiled) {
+            if (nextRecord()) {
+                return;
+            }
+        } else if (nextLine()) {
             parseKey();
             parseValue();
             return;
@@ -7,15 +7,30 @@
 #include "TokenState.h"
 #include "../Config.h"
 #include <string_view>
+#include <string>
+#include <functional>
 
 namespace Configuration {
 
     class Tokenizer {
-        std::string_view _remainder;
+    public:
+        // Reads up to len bytes of a stream into buf, returning 0 at its end
+        using reader_t = std::function<size_t(char* buf, size_t len)>;
+        // Takes the next piece of compiled output, returning false to stop
+        using writer_t = std::function<bool(const char* data, size_t len)>;
+
+    private:
+        std::string_view _remainder;  // Unread input, in _buffer when it comes from _read
+        bool             _compiled;
+        reader_t         _read;
+        std::string      _buffer;
+        bool             _eof = false;
 
+        bool fill(size_t n);
         bool isWhiteSpace(char c);
         bool isIdentifierChar(char c);
         bool nextLine();
+        bool nextRecord();
         void parseKey();
         void parseValue();
 
@@ -39,8 +54,20 @@ namespace Configuration {
         void ParseError(const char* description) const;
 
     public:
-        Tokenizer(std::string_view yaml_string);
+        Tokenizer(std::string_view yaml_string, bool compiled = false);
+
+        // Reads the input a piece at a time, so only the current line is held in memory.
+        // The token refers to that line, so it is only good until the next Tokenize().
+        Tokenizer(reader_t read, bool compiled = false);
+
         void                    Tokenize();
         inline std::string_view key() const { return _token._key; }
+
+        // Passes the tokens of source to out as compiled records, one call for each, which
+        // a Tokenizer constructed with compiled set reads back without scanning lines,
+        // comments or quotes.  Each record is the line number (2 bytes), indent (1), key
+        // length (1) and value length (2), little-endian, followed by the key and the value.
+        // Returns false if out does.
+        static bool compile(Tokenizer& source, const writer_t& out);
     };
 }
@@ -7,7 +7,7 @@
 #include "Machine/Macros.h"  // macro0Event
 
 Control::Control() {
-    // The SafetyDoor pin must be defined first because it is checked explicity in safety_door_ajar()
+    // The pins must be pushed in the order of Function, which pin() indexes by
     _pins.push_back(new ControlPin(&safetyDoorEvent, "safety_door_pin", 'D'));
     _pins.push_back(new ControlPin(&rtResetEvent, "reset_pin", 'R'));
     _pins.push_back(new ControlPin(&feedHoldEvent, "feed_hold_pin", 'H'));
@@ -18,7 +18,8 @@ Control::Control() {
     _pins.push_back(new ControlPin(&macro3Event, "macro3_pin", '3'));
     _pins.push_back(new ControlPin(&faultPinEvent, "fault_pin", 'F'));
     _pins.push_back(new ControlPin(&faultPinEvent, "estop_pin", 'E'));
-    _pins.push_back(new ControlPin(&PowerDetectionEvent, "power_pin", 'W'));
+    _pins.push_back(new PowerPin(&PowerDetectionEvent, &powerRestoredEvent, "power_pin", 'W'));
+    Assert(_pins.size() == nFunctions, "Control pins out of order");
 }
 
 void Control::init() {
@@ -68,5 +69,5 @@ bool Control::safety_door_ajar() {
     // If a safety door pin is not defined, this will return false
     // because that is the default for the value field, which will
     // never be changed for an undefined pin.
-    return _pins[0]->get();
+    return pin(SafetyDoor)->get();
 }
@@ -10,10 +10,29 @@
 using namespace Machine;
 class Control : public Configuration::Configurable {
 public:
+    // The control functions, in the order of _pins
+    enum Function : uint8_t {
+        SafetyDoor = 0,
+        Reset,
+        FeedHold,
+        CycleStart,
+        Macro0,
+        Macro1,
+        Macro2,
+        Macro3,
+        Fault,
+        Estop,
+        Power,
+        nFunctions,
+    };
+
     Control();
 
     std::vector<ControlPin*> _pins;
 
+    // The pin for a function, without searching _pins by legend
+    ControlPin* pin(Function function) { return _pins[function]; }
+
     // Initializes control pins.
     void init();
 
@@ -23,6 +42,9 @@ public:
     bool stuck();
     bool safety_door_ajar();
 
+    // False while the power_pin reports that the machine has no power
+    bool powered() { return !pin(Power)->get(); }
+
     std::string report_status();
 
     bool startup_check();
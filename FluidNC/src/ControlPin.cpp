@@ -1,5 +1,7 @@
 #include "ControlPin.h"
 
+#include "Protocol.h"  // protocol_send_event
+
 namespace Machine {
     void ControlPin::init() {
         if (_pin.undefined()) {
@@ -9,4 +11,11 @@ namespace Machine {
         _pin.setAttr(Pin::Attr::Input);
         _pin.registerEvent(static_cast<EventPin*>(this));
     }
+
+    void PowerPin::update(bool active) {
+        if (_lost && !active) {
+            protocol_send_event(_restoredEvent, this);
+        }
+        _lost = active;
+    }
 };
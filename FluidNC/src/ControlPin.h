@@ -20,4 +20,18 @@ namespace Machine {
 
         ~ControlPin();
     };
+
+    // The power_pin is active while the machine has no power.  Unlike the other control
+    // pins, it also sends an event when it goes inactive again, as the power returns.
+    class PowerPin : public ControlPin {
+    private:
+        Event* _restoredEvent;
+        bool   _lost = false;
+
+    public:
+        PowerPin(Event* lostEvent, Event* restoredEvent, const char* legend, char letter) :
+            ControlPin(lostEvent, legend, letter), _restoredEvent(restoredEvent) {}
+
+        void update(bool active) override;
+    };
 }
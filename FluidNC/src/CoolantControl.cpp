@@ -4,6 +4,7 @@
 
 #include "CoolantControl.h"
 #include "System.h"
+#include "Protocol.h"  // protocol_buffer_synchronize
 
 void CoolantControl::init() {
     static bool init_message = true;  // used to show messages only once.
@@ -79,6 +80,28 @@ void CoolantControl::set_state(CoolantState state) {
         delay_msec(_delay_ms, DwellMode::SysSuspend);
 }
 
+void CoolantControl::sync(CoolantState state) {
+    bool turnOn  = (state.Mist && !_previous_state.Mist) || (state.Flood && !_previous_state.Flood);
+    bool turnOff = (!state.Mist && _previous_state.Mist) || (!state.Flood && _previous_state.Flood);
+    if (!_anticipate_ms || !turnOn || turnOff) {
+        protocol_buffer_synchronize();
+        set_state(state);
+        return;
+    }
+
+    // Switch on while the buffered motion is still running, so the coolant is flowing
+    // by the time the motion that needs it starts.  Only the part of the delay that
+    // is not covered by the motion still to run holds up the following blocks.
+    uint32_t lead = protocol_buffer_anticipate(_anticipate_ms);
+    if (sys.abort) {
+        return;
+    }
+    write(state);
+    if (_delay_ms > lead) {
+        delay_msec(_delay_ms - lead, DwellMode::SysSuspend);
+    }
+}
+
 void CoolantControl::off() {
     CoolantState disable = {};
     set_state(disable);
@@ -88,4 +111,5 @@ void CoolantControl::group(Configuration::HandlerBase& handler) {
     handler.item("flood_pin", _flood);
     handler.item("mist_pin", _mist);
     handler.item("delay_ms", _delay_ms, 0, 10000);
+    handler.item("anticipate_ms", _anticipate_ms, 0, 10000);
 }
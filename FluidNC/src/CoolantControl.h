@@ -11,7 +11,8 @@ class CoolantControl : public Configuration::Configurable {
     Pin _mist;
     Pin _flood;
 
-    uint32_t _delay_ms = 0;
+    uint32_t _delay_ms      = 0;
+    uint32_t _anticipate_ms = 0;
 
     CoolantState _previous_state = {};
 
@@ -36,6 +37,10 @@ public:
     void off();
     void set_state(CoolantState state);
 
+    // Sets the state for a g-code block, after the buffered motion or up to
+    // anticipate_ms ahead of its end when coolant is only being turned on.
+    void sync(CoolantState state);
+
     // Configuration handlers.
     void group(Configuration::HandlerBase& handler) override;
 
@@ -0,0 +1,117 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "CrashContext.h"
+
+#include "Channel.h"
+#include "Logging.h"
+#include "Stepper.h"  // Stepper::segments_queued()
+#include "WebHook.h"  // WebHook::post()
+
+#include <esp_attr.h>    // __NOINIT_ATTR
+#include <esp_system.h>  // esp_reset_reason()
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>  // xTaskGetTickCount()
+#include <cstring>
+
+namespace CrashContext {
+    static const uint32_t validMagic = 0x43524358;
+
+    struct Entry {
+        uint32_t ms;  // Since boot
+        uint16_t plannerBlocks;
+        uint16_t segments;
+        char     text[lineLength];
+    };
+
+    struct Store {
+        uint32_t magic;
+        uint32_t next;  // Lines recorded; the last nLines of them are in entries
+        Entry    entries[nLines];
+    };
+
+    // Not cleared by a restart, only by power loss, which the magic number catches
+    static __NOINIT_ATTR Store store;
+
+    static Store              crashed;  // The context of the previous boot, if it crashed
+    static esp_reset_reason_t crashReason;
+    static bool               haveCrash = false;
+    static bool               uploaded  = false;
+
+    static bool is_crash(esp_reset_reason_t reason) {
+        return reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+    }
+
+    void init() {
+        crashReason = esp_reset_reason();
+        haveCrash   = is_crash(crashReason) && store.magic == validMagic && store.next;
+        if (haveCrash) {
+            crashed = store;
+            log_warn("The previous boot crashed on line " << crashed.next << "; see $Crash/Show");
+        }
+        store.magic = validMagic;
+        store.next  = 0;
+    }
+
+    void line(const char* line, uint32_t plannerBlocks) {
+        Entry& e        = store.entries[store.next++ % nLines];
+        e.ms            = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        e.plannerBlocks = plannerBlocks;
+        e.segments      = Stepper::segments_queued();
+        strncpy(e.text, line, lineLength - 1);
+        e.text[lineLength - 1] = '\0';
+    }
+
+    const char* last_line() { return store.next ? store.entries[(store.next - 1) % nLines].text : ""; }
+
+    static uint32_t first() { return crashed.next > nLines ? crashed.next - nLines : 0; }
+
+    void dump(Channel& out) {
+        if (!haveCrash) {
+            log_info_to(out, "The previous boot did not crash");
+            return;
+        }
+        log_info_to(out, "Reset reason " << int(crashReason) << " after " << crashed.next << " lines; ms,planner,segments,line:");
+        for (uint32_t i = first(); i < crashed.next; i++) {
+            const Entry& e = crashed.entries[i % nLines];
+            log_stream(out, "[CRASH:" << e.ms << "," << e.plannerBlocks << "," << e.segments << "," << e.text);
+        }
+    }
+
+    static void append_encoded(String& s, const char* text) {
+        static const char hex[] = "0123456789ABCDEF";
+        for (; *text; ++text) {
+            char c = *text;
+            if (isalnum(c) || c == '-' || c == '.' || c == '_') {
+                s += c;
+            } else {
+                s += '%';
+                s += hex[(c >> 4) & 0xf];
+                s += hex[c & 0xf];
+            }
+        }
+    }
+
+    // WebHook takes queries of up to 191 characters, so the newest lines that fit are sent
+    void upload() {
+        if (!haveCrash || uploaded) {
+            return;
+        }
+        uploaded = true;
+
+        const Entry& last  = crashed.entries[(crashed.next - 1) % nLines];
+        String       query = "crash=" + String(int(crashReason)) + "&lines=" + String(crashed.next) +
+                       "&planner=" + String(last.plannerBlocks) + "&segments=" + String(last.segments) + "&last=";
+        for (uint32_t i = crashed.next; i-- > first();) {
+            String line;
+            append_encoded(line, crashed.entries[i % nLines].text);
+            if (query.length() + line.length() + 3 > 191) {
+                break;
+            }
+            if (i != crashed.next - 1) {
+                query += "%7C";  // |
+            }
+            query += line;
+        }
+        WebHook::post(query);
+    }
+}
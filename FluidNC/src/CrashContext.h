@@ -0,0 +1,39 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  CrashContext.h - what the motion pipeline was doing when the controller last crashed
+
+  The start of each of the last few lines that the main loop took up is kept, with the
+  planner and segment buffer occupancy at that time, in memory that a restart does not
+  clear.  After a panic or a watchdog reset, the next boot keeps them from being
+  overwritten; $Crash/Show lists them, and once the station is connected they are sent
+  as one call to the URL of the URLToCall setting.  Recording a line is one copy of up
+  to lineLength characters, so it is always on.
+*/
+
+#include <cstdint>
+
+class Channel;
+
+namespace CrashContext {
+    const uint32_t nLines     = 8;
+    const uint32_t lineLength = 48;  // Longer lines are kept truncated
+
+    // Takes the context of the previous boot if it ended in a crash, and starts
+    // recording afresh.  Called once, early in setup().
+    void init();
+
+    // Called by the main loop as it takes up each line
+    void line(const char* line, uint32_t plannerBlocks);
+
+    // The line that the main loop took up last, or "" before the first one
+    const char* last_line();
+
+    // Lists the context of the crash, oldest line first
+    void dump(Channel& out);
+
+    // Queues the context of the crash for WebHook, once per boot
+    void upload();
+}
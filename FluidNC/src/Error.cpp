@@ -47,6 +47,16 @@ std::map<Error, const char*> ErrorNames = {
     { Error::GcodeMaxValueExceeded, "Gcode max value exceeded" },
     { Error::PParamMaxExceeded, "P param max exceeded" },
     { Error::CheckControlPins, "Check control pins" },
+    { Error::ExpressionSyntaxError, "Expression syntax error" },
+    { Error::ExpressionDivideByZero, "Expression divide by zero" },
+    { Error::ExpressionInvalidArgument, "Expression invalid argument" },
+    { Error::ExpressionUnknownParameter, "Expression unknown parameter" },
+    { Error::ExpressionReadOnlyParameter, "Expression read-only parameter" },
+    { Error::FlowControlSyntaxError, "O-word syntax error" },
+    { Error::FlowControlUnknownSub, "O-word unknown subroutine" },
+    { Error::FlowControlTooDeep, "O-word calls nested too deeply" },
+    { Error::GcodeToolNotInTable, "Gcode tool not in the tool table" },
+    { Error::GcodeSpindleNotSynced, "Gcode spindle sync needs speed feedback" },
     { Error::FsFailedMount, "Failed to mount device" },
     { Error::FsFailedRead, "Read failed" },
     { Error::FsFailedOpenDir, "Failed to open directory" },
@@ -51,6 +51,16 @@ enum class Error : uint8_t {
     GcodeMaxValueExceeded       = 38,
     PParamMaxExceeded           = 39,
     CheckControlPins            = 40,
+    ExpressionSyntaxError       = 41,
+    ExpressionDivideByZero      = 42,
+    ExpressionInvalidArgument   = 43,
+    ExpressionUnknownParameter  = 44,
+    ExpressionReadOnlyParameter = 45,
+    FlowControlSyntaxError      = 46,
+    FlowControlUnknownSub       = 47,
+    FlowControlTooDeep          = 48,
+    GcodeToolNotInTable         = 49,
+    GcodeSpindleNotSynced       = 50,
     FsFailedMount               = 60,  // Filesystem failed to mount
     FsFailedRead                = 61,  // Failed to read file
     FsFailedOpenDir             = 62,  // Failed to open directory
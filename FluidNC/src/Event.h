@@ -3,11 +3,26 @@
 
 #pragma once
 
-// Objects derived from the Event base class are placed in the event queue.
+#include <cstdint>
+
+// Each class of events has its own queue, and protocol_handle_events() always takes the
+// next event from the most urgent queue that has one, so that a burst of overrides or
+// status reports neither delays nor crowds out a limit, fault or reset.
+enum class EventPriority : uint8_t {
+    Safety   = 0,  // Resets, limits, faults, alarms, holds
+    Motion   = 1,  // Cycle start and stop, and everything else by default
+    Override = 2,  // Feed, rapid, spindle and accessory overrides
+    Report   = 3,  // Status and debug reports
+};
+const int nEventPriorities = 4;
+
+// Objects derived from the Event base class are placed in the event queues.
 // Protocol dequeues them and calls their run methods.
 class Event {
 public:
-    Event() {}
+    const EventPriority _priority;
+
+    Event(EventPriority priority = EventPriority::Motion) : _priority(priority) {}
     virtual void run(void* arg) = 0;
 };
 
@@ -15,7 +30,7 @@ class NoArgEvent : public Event {
     void (*_function)() = nullptr;
 
 public:
-    NoArgEvent(void (*function)()) : _function(function) {}
+    NoArgEvent(void (*function)(), EventPriority priority = EventPriority::Motion) : Event(priority), _function(function) {}
     void run(void* arg) override {
         if (_function) {
             _function();
@@ -27,7 +42,7 @@ class ArgEvent : public Event {
     void (*_function)(void*) = nullptr;
 
 public:
-    ArgEvent(void (*function)(void*)) : _function(function) {}
+    ArgEvent(void (*function)(void*), EventPriority priority = EventPriority::Motion) : Event(priority), _function(function) {}
     void run(void* arg) override {
         if (_function) {
             _function(arg);
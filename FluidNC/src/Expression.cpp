@@ -0,0 +1,403 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Expression.h"
+#include "ReadFloat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace Expression {
+    struct Frame {
+        float                        locals[nLocals] = {};
+        std::map<std::string, float> named;
+    };
+
+    static std::vector<Frame>           frames(1);    // The top level, then the calls in progress
+    static std::map<int, float>         globals;      // #31-#5000
+    static std::map<std::string, float> namedGlobals;  // The names that start with _
+    static SystemReader                 systemReader = nullptr;
+
+    static std::vector<Frame>           savedFrames;
+    static std::map<int, float>         savedGlobals;
+    static std::map<std::string, float> savedNamedGlobals;
+
+    static const int   maxWritable = 5000;
+    static const float degree      = 3.14159265358979f / 180;
+    static const float tolerance   = 0.0001f;  // For comparisons and integer checks, as LinuxCNC
+
+    void set_system_reader(SystemReader reader) { systemReader = reader; }
+
+    static Error get(int number, float* value) {
+        if (number >= 1 && number <= nLocals) {
+            *value = frames.back().locals[number - 1];
+            return Error::Ok;
+        }
+        if (number > nLocals && number <= maxWritable) {
+            auto it = globals.find(number);
+            *value  = it == globals.end() ? 0.0f : it->second;
+            return Error::Ok;
+        }
+        if (systemReader && systemReader(number, value)) {
+            return Error::Ok;
+        }
+        return Error::ExpressionUnknownParameter;
+    }
+
+    static std::map<std::string, float>& scope(const std::string& name) {
+        return name[0] == '_' ? namedGlobals : frames.back().named;
+    }
+
+    static const float* find(const std::string& name) {
+        auto& map = scope(name);
+        auto  it  = map.find(name);
+        return it == map.end() ? nullptr : &it->second;
+    }
+
+    static Error read_primary(const char* line, size_t* pos, float* value);
+    static Error read_expression(const char* line, size_t* pos, float* value, int minPrecedence);
+
+    // A parameter after its #: <name>, or a value that is its number, as in ##2 or #[#2 + 1]
+    static Error read_ref(const char* line, size_t* pos, int& number, std::string& name) {
+        if (line[*pos] == '<') {
+            const char* start = line + *pos + 1;
+            const char* end   = strchr(start, '>');
+            if (!end || end == start) {
+                return Error::ExpressionSyntaxError;
+            }
+            number = 0;
+            name.assign(start, end);
+            *pos = end - line + 1;
+            return Error::Ok;
+        }
+        float value;
+        Error err = read_primary(line, pos, &value);
+        if (err != Error::Ok) {
+            return err;
+        }
+        number = lroundf(value);
+        if (fabsf(value - number) > tolerance || number < 1) {
+            return Error::ExpressionUnknownParameter;
+        }
+        name.clear();
+        return Error::Ok;
+    }
+
+    static Error check_close(const char* line, size_t* pos) {
+        if (line[*pos] != ']') {
+            return Error::ExpressionSyntaxError;
+        }
+        ++*pos;
+        return Error::Ok;
+    }
+
+    static Error read_function(const char* line, size_t* pos, float* value) {
+        size_t start = *pos;
+        while (line[*pos] >= 'A' && line[*pos] <= 'Z') {
+            ++*pos;
+        }
+        std::string name(line + start, *pos - start);
+        if (line[*pos] != '[') {
+            return Error::BadNumberFormat;  // As for a word letter with no value
+        }
+        ++*pos;
+        Error err;
+        if (name == "EXISTS") {
+            int         number;
+            std::string pname;
+            if (line[*pos] != '#') {
+                return Error::ExpressionSyntaxError;
+            }
+            ++*pos;
+            if ((err = read_ref(line, pos, number, pname)) != Error::Ok) {
+                return err;
+            }
+            float unused;
+            *value = (number ? get(number, &unused) == Error::Ok : find(pname) != nullptr) ? 1.0f : 0.0f;
+            return check_close(line, pos);
+        }
+        float arg;
+        if ((err = read_expression(line, pos, &arg, 1)) != Error::Ok || (err = check_close(line, pos)) != Error::Ok) {
+            return err;
+        }
+        if (name == "ATAN") {
+            float x;
+            if (line[*pos] != '/' || line[*pos + 1] != '[') {
+                return Error::ExpressionSyntaxError;
+            }
+            *pos += 2;
+            if ((err = read_expression(line, pos, &x, 1)) != Error::Ok) {
+                return err;
+            }
+            *value = atan2f(arg, x) / degree;
+            return check_close(line, pos);
+        }
+        if (name == "ABS") {
+            *value = fabsf(arg);
+        } else if (name == "ACOS" || name == "ASIN") {
+            if (arg < -1 || arg > 1) {
+                return Error::ExpressionInvalidArgument;
+            }
+            *value = (name == "ACOS" ? acosf(arg) : asinf(arg)) / degree;
+        } else if (name == "COS") {
+            *value = cosf(arg * degree);
+        } else if (name == "EXP") {
+            *value = expf(arg);
+        } else if (name == "FIX") {
+            *value = floorf(arg);
+        } else if (name == "FUP") {
+            *value = ceilf(arg);
+        } else if (name == "LN") {
+            if (arg <= 0) {
+                return Error::ExpressionInvalidArgument;
+            }
+            *value = logf(arg);
+        } else if (name == "ROUND") {
+            *value = roundf(arg);
+        } else if (name == "SIN") {
+            *value = sinf(arg * degree);
+        } else if (name == "SQRT") {
+            if (arg < 0) {
+                return Error::ExpressionInvalidArgument;
+            }
+            *value = sqrtf(arg);
+        } else if (name == "TAN") {
+            *value = tanf(arg * degree);
+        } else {
+            return Error::ExpressionSyntaxError;
+        }
+        return Error::Ok;
+    }
+
+    static Error read_primary(const char* line, size_t* pos, float* value) {
+        if (read_float(line, pos, value)) {
+            return Error::Ok;
+        }
+        char c = line[*pos];
+        if (c == '-' || c == '+') {
+            // A sign before a parameter, an expression or a function; read_float() took the others
+            ++*pos;
+            Error err = read_primary(line, pos, value);
+            if (c == '-') {
+                *value = -*value;
+            }
+            return err;
+        }
+        if (c == '#') {
+            ++*pos;
+            int         number;
+            std::string name;
+            Error       err = read_ref(line, pos, number, name);
+            if (err != Error::Ok || number) {
+                return err == Error::Ok ? get(number, value) : err;
+            }
+            const float* named = find(name);
+            if (!named) {
+                return Error::ExpressionUnknownParameter;
+            }
+            *value = *named;
+            return Error::Ok;
+        }
+        if (c == '[') {
+            ++*pos;
+            Error err = read_expression(line, pos, value, 1);
+            return err == Error::Ok ? check_close(line, pos) : err;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return read_function(line, pos, value);
+        }
+        return Error::BadNumberFormat;
+    }
+
+    Error read_value(const char* line, size_t* pos, float* value) { return read_primary(line, pos, value); }
+
+    enum class Op : uint8_t { Power, Times, Divide, Mod, Plus, Minus, EQ, NE, GT, GE, LT, LE, And, Or, Xor };
+
+    struct Operator {
+        const char* name;
+        Op          op;
+        int         precedence;
+    };
+
+    // ** before *, and GE before GT and so on, for the first match to be the right one
+    static const Operator operators[] = {
+        { "**", Op::Power, 5 }, { "*", Op::Times, 4 }, { "/", Op::Divide, 4 }, { "MOD", Op::Mod, 4 }, { "+", Op::Plus, 3 },
+        { "-", Op::Minus, 3 },  { "EQ", Op::EQ, 2 },   { "NE", Op::NE, 2 },    { "GT", Op::GT, 2 },    { "GE", Op::GE, 2 },
+        { "LT", Op::LT, 2 },    { "LE", Op::LE, 2 },   { "AND", Op::And, 1 },  { "OR", Op::Or, 1 },    { "XOR", Op::Xor, 1 },
+    };
+
+    static const Operator* read_operator(const char* line, size_t* pos) {
+        for (auto& op : operators) {
+            size_t length = strlen(op.name);
+            if (!strncmp(line + *pos, op.name, length)) {
+                *pos += length;
+                return &op;
+            }
+        }
+        return nullptr;
+    }
+
+    static Error apply(Op op, float a, float b, float* value) {
+        switch (op) {
+            case Op::Power:
+                if (a < 0 && fabsf(b - roundf(b)) > tolerance) {
+                    return Error::ExpressionInvalidArgument;
+                }
+                *value = powf(a, b);
+                break;
+            case Op::Times:
+                *value = a * b;
+                break;
+            case Op::Divide:
+                if (b == 0) {
+                    return Error::ExpressionDivideByZero;
+                }
+                *value = a / b;
+                break;
+            case Op::Mod:
+                if (b == 0) {
+                    return Error::ExpressionDivideByZero;
+                }
+                *value = fmodf(a, b);
+                if (*value < 0) {
+                    *value += fabsf(b);  // The result is never negative, as in LinuxCNC
+                }
+                break;
+            case Op::Plus:
+                *value = a + b;
+                break;
+            case Op::Minus:
+                *value = a - b;
+                break;
+            case Op::EQ:
+                *value = fabsf(a - b) < tolerance;
+                break;
+            case Op::NE:
+                *value = fabsf(a - b) >= tolerance;
+                break;
+            case Op::GT:
+                *value = a > b;
+                break;
+            case Op::GE:
+                *value = a >= b;
+                break;
+            case Op::LT:
+                *value = a < b;
+                break;
+            case Op::LE:
+                *value = a <= b;
+                break;
+            case Op::And:
+                *value = a != 0 && b != 0;
+                break;
+            case Op::Or:
+                *value = a != 0 || b != 0;
+                break;
+            case Op::Xor:
+                *value = (a != 0) != (b != 0);
+                break;
+        }
+        return Error::Ok;
+    }
+
+    // Precedence climbing: the right side of an operator takes only the operators that
+    // bind more tightly, so those of one level are applied from left to right
+    static Error read_expression(const char* line, size_t* pos, float* value, int minPrecedence) {
+        Error err = read_primary(line, pos, value);
+        while (err == Error::Ok) {
+            size_t          next = *pos;
+            const Operator* op   = read_operator(line, &next);
+            if (!op || op->precedence < minPrecedence) {
+                break;
+            }
+            *pos = next;
+            float rhs;
+            if ((err = read_expression(line, pos, &rhs, op->precedence + 1)) == Error::Ok) {
+                err = apply(op->op, *value, rhs, value);
+            }
+        }
+        return err;
+    }
+
+    Error read_assignment(const char* line, size_t* pos, Assignment& assignment) {
+        ++*pos;  // The #
+        Error err = read_ref(line, pos, assignment.number, assignment.name);
+        if (err != Error::Ok) {
+            return err;
+        }
+        if (line[*pos] != '=') {
+            return Error::ExpressionSyntaxError;
+        }
+        ++*pos;
+        return read_value(line, pos, &assignment.value);
+    }
+
+    Error set(const std::string& name, float value) {
+        scope(name)[name] = value;
+        return Error::Ok;
+    }
+
+    Error assign(const Assignment& assignment) {
+        int number = assignment.number;
+        if (!number) {
+            return set(assignment.name, assignment.value);
+        }
+        if (number <= nLocals) {
+            frames.back().locals[number - 1] = assignment.value;
+        } else if (number <= maxWritable) {
+            globals[number] = assignment.value;
+        } else {
+            return Error::ExpressionReadOnlyParameter;
+        }
+        return Error::Ok;
+    }
+
+    bool push_frame(const float* args, size_t nArgs) {
+        if (frames.size() > maxFrames) {
+            return false;
+        }
+        frames.emplace_back();
+        std::copy(args, args + std::min(nArgs, size_t(nLocals)), frames.back().locals);
+        return true;
+    }
+
+    void pop_frame() {
+        if (frames.size() > 1) {
+            frames.pop_back();
+        }
+    }
+
+    void reset() { frames.resize(1); }
+
+    void checkpoint() {
+        savedFrames       = frames;
+        savedGlobals      = globals;
+        savedNamedGlobals = namedGlobals;
+    }
+
+    void rollback() {
+        frames       = savedFrames;
+        globals      = savedGlobals;
+        namedGlobals = savedNamedGlobals;
+    }
+
+    void fingerprint(const std::function<void(const void*, size_t)>& feed) {
+        auto feed_named = [&feed](const std::map<std::string, float>& named) {
+            for (auto const& [name, value] : named) {
+                feed(name.c_str(), name.length() + 1);
+                feed(&value, sizeof(value));
+            }
+        };
+        for (auto const& frame : frames) {
+            feed(frame.locals, sizeof(frame.locals));
+            feed_named(frame.named);
+        }
+        for (auto const& [number, value] : globals) {
+            feed(&number, sizeof(number));
+            feed(&value, sizeof(value));
+        }
+        feed_named(namedGlobals);
+    }
+}
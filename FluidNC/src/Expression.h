@@ -0,0 +1,74 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Expression.h - LinuxCNC-style parameters and expressions for g-code word values
+
+  A word value can be a number, a parameter, an expression in brackets, or a function:
+
+    G1 X#12 Y[#<width> / 2 + 0.5] Z-#<_depth> F[#2 * 60]
+    #3 = [ATAN[#1]/[#2] + SIN[30]]
+
+  A parameter is #n, #<name>, or ##n for the parameter whose number is in #n.  The
+  operators, lowest precedence first, are AND OR XOR; EQ NE GT GE LT LE; + -; * / MOD;
+  and **, and those of a level are taken from left to right.  The functions are ABS ACOS
+  ASIN ATAN COS EXISTS EXP FIX FUP LN ROUND SIN SQRT TAN; the trig functions work in
+  degrees and ATAN takes two arguments, ATAN[y]/[x].  EXISTS[#<name>] is 1 if the named
+  parameter has been set.
+
+  #1-#30, and the named parameters whose names do not start with _, are local to a
+  subroutine call; O-word calls set #1.. to their arguments.  #31-#5000 and the names
+  that start with _ are global.  Numbered parameters that were never set read as 0, named
+  ones are an error.  The numbers above 5000 are the machine's own values, such as #5221
+  for the G54 X offset, and cannot be set.  Lines are collapsed to upper case before they
+  are parsed, so names are not case sensitive.
+*/
+
+#include "Error.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace Expression {
+    // #n=value or #<name>=value, applied once the words of its line have been read, so
+    // that the other words of the line see the value from before
+    struct Assignment {
+        int         number;  // 0 for a named parameter
+        std::string name;
+        float       value;
+    };
+
+    // Reads a word value at line[*pos], advancing *pos past it.  The line is collapsed.
+    Error read_value(const char* line, size_t* pos, float* value);
+
+    // Reads #ref=value at line[*pos], where line[*pos] is the #
+    Error read_assignment(const char* line, size_t* pos, Assignment& assignment);
+
+    Error assign(const Assignment& assignment);
+    Error set(const std::string& name, float value);
+
+    // Subroutine calls get a new set of locals, with #1.. set to the arguments.
+    // push_frame() returns false if the calls are nested too deeply.
+    static const size_t maxFrames = 10;
+    static const int    nLocals   = 30;
+
+    bool push_frame(const float* args, size_t nArgs);
+    void pop_frame();
+
+    // Drops the locals of the calls that were running, after a reset
+    void reset();
+
+    // The machine's parameters, #5001 and up, come from a reader that the g-code parser
+    // installs.  It returns false for a number that it does not know.
+    using SystemReader = bool (*)(int number, float* value);
+    void set_system_reader(SystemReader reader);
+
+    // Sets aside the parameters that g-code can set, and puts them back, around a run in check
+    // mode that must leave them as they were.  fingerprint() passes them to feed, for a
+    // hash of the state that a file runs in.
+    void checkpoint();
+    void rollback();
+    void fingerprint(const std::function<void(const void*, size_t)>& feed);
+}
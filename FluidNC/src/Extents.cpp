@@ -0,0 +1,310 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Extents.h"
+
+#include "InputFile.h"
+#include "GCode.h"  // gc_state, gc_execute_line()
+#include "HashFS.h"
+#include "Limits.h"  // limitsMinPosition(), limitsMaxPosition()
+#include "Logging.h"
+#include "Machine/MachineConfig.h"
+#include "Protocol.h"  // protocol_execute_realtime()
+#include "Settings.h"  // coords
+#include "System.h"    // sys
+#include "Expression.h"
+#include "ToolTable.h"
+
+#include <sys/stat.h>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace Extents {
+    bool scanning    = false;
+    bool lineTrusted = false;
+
+    struct Box {
+        bool  used;
+        float min[MAX_N_AXIS];
+        float max[MAX_N_AXIS];
+    };
+
+    struct Entry {
+        std::string path;  // Empty for an unused entry
+        uint32_t    size;
+        int64_t     mtime;
+        std::string hash;   // Local file system hash, empty if it has none
+        uint32_t    state;  // Fingerprint of the state the scan started from
+        Box         machine;
+    };
+
+    static Entry      cache[nCached];
+    static int        nextEntry  = 0;
+    static InputFile* trustedJob = nullptr;
+
+    // Filled by a scan
+    static Box machine;
+    static Box work[CoordIndex::NWCSystems];
+
+    static void grow(Box& box, size_t axis, float value) {
+        box.min[axis] = std::min(box.min[axis], value);
+        box.max[axis] = std::max(box.max[axis], value);
+    }
+
+    static void start(Box& box) {
+        box.used = false;
+        for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+            box.min[axis] = INFINITY;
+            box.max[axis] = -INFINITY;
+        }
+    }
+
+    // Adds a value of a machine coordinate, and the work coordinate that it is in the
+    // coordinate system in effect
+    static void add(size_t axis, float value) {
+        grow(machine, axis, value);
+        float offset = gc_state.coord_system[axis] + gc_state.coord_offset[axis];
+        if (axis == TOOL_LENGTH_OFFSET_AXIS) {
+            offset += gc_state.tool_length_offset;
+        }
+        grow(work[gc_state.modal.coord_select], axis, value - offset);
+    }
+
+    static void add_point(const float* target) {
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            add(axis, target[axis]);
+        }
+        machine.used = work[gc_state.modal.coord_select].used = true;
+    }
+
+    void line(const float* target) { add_point(target); }
+
+    // The axes other than those of the plane move linearly, so the end points bound them.  In
+    // the plane, the arc also reaches center +/- radius at each multiple of 90 degrees it passes.
+    void arc(const float* position,
+             const float* target,
+             const float* center,
+             float        radius,
+             size_t       axis_0,
+             size_t       axis_1,
+             float        angular_travel) {
+        add_point(position);
+        add_point(target);
+
+        const float quarter     = float(M_PI) / 2;
+        float       start_angle = atan2f(position[axis_1] - center[1], position[axis_0] - center[0]);
+        float       from        = std::min(start_angle, start_angle + angular_travel);
+        float       to          = std::max(start_angle, start_angle + angular_travel);
+        if (to - from >= 4 * quarter) {
+            from = 0;
+            to   = 3 * quarter;
+        }
+        for (int k = int(ceilf(from / quarter)); k <= int(floorf(to / quarter)); k++) {
+            switch (((k % 4) + 4) % 4) {
+                case 0:
+                    add(axis_0, center[0] + radius);
+                    break;
+                case 1:
+                    add(axis_1, center[1] + radius);
+                    break;
+                case 2:
+                    add(axis_0, center[0] - radius);
+                    break;
+                case 3:
+                    add(axis_1, center[1] - radius);
+                    break;
+            }
+        }
+    }
+
+    void trust_line(bool fromJob) { lineTrusted = fromJob && trustedJob; }
+
+    // FNV-1a, over the state that the moves of a file depend on
+    static uint32_t fingerprint() {
+        uint32_t h    = 2166136261u;
+        auto     feed = [&h](const void* data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                h = (h ^ static_cast<const uint8_t*>(data)[i]) * 16777619u;
+            }
+        };
+        feed(&gc_state.modal, sizeof(gc_state.modal));
+        feed(gc_state.position, sizeof(gc_state.position));
+        feed(gc_state.coord_system, sizeof(gc_state.coord_system));
+        feed(gc_state.coord_offset, sizeof(gc_state.coord_offset));
+        feed(&gc_state.tool_length_offset, sizeof(gc_state.tool_length_offset));
+        feed(&gc_state.tool, sizeof(gc_state.tool));
+        feed(&gc_state.tlo_tool, sizeof(gc_state.tlo_tool));
+        for (size_t i = CoordIndex::Begin; i < CoordIndex::End; i++) {
+            feed(coords[i]->get(), MAX_N_AXIS * sizeof(float));
+        }
+        // G43 H and # parameters make the moves depend on these too
+        ToolTable::fingerprint(feed);
+        Expression::fingerprint(feed);
+        return h;
+    }
+
+    static bool identify(InputFile& file, Entry& entry) {
+        struct stat st;
+        if (stat(file.path().c_str(), &st)) {
+            return false;
+        }
+        entry.path  = file.path();
+        entry.size  = st.st_size;
+        entry.mtime = st.st_mtime;
+        entry.hash  = HashFS::hash(file.fpath());
+        entry.state = fingerprint();
+        return true;
+    }
+
+    // Logs the first axis whose extents exceed its soft limits
+    static bool fits(const Box& box, Channel& out) {
+        auto axes   = config->_axes;
+        auto n_axis = axes->_numberAxis;
+        for (size_t axis = 0; box.used && axis < n_axis; axis++) {
+            if (!axes->_axis[axis]->_softLimits) {
+                continue;
+            }
+            if (box.min[axis] < limitsMinPosition(axis)) {
+                log_info_to(out, "Soft limit on " << axes->axisName(axis) << " at " << box.min[axis]);
+                return false;
+            }
+            if (box.max[axis] > limitsMaxPosition(axis)) {
+                log_info_to(out, "Soft limit on " << axes->axisName(axis) << " at " << box.max[axis]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void report(const char* name, const Box& box, Channel& out) {
+        auto        n_axis = config->_axes->_numberAxis;
+        std::string text(name);
+        char        range[40];
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            snprintf(range, sizeof(range), " %c:%.3f..%.3f", config->_axes->axisName(axis), box.min[axis], box.max[axis]);
+            text += range;
+        }
+        log_info_to(out, text);
+    }
+
+    Error scan(InputFile& file, Channel& out) {
+        if (sys.state != State::Idle) {
+            log_string(out, "Busy");
+            return Error::IdleError;
+        }
+        Entry entry;
+        if (!identify(file, entry)) {
+            return Error::FsFailedOpenFile;
+        }
+
+        parser_state_t savedState = gc_state;
+        float          savedCoords[CoordIndex::End][MAX_N_AXIS];
+        for (size_t i = CoordIndex::Begin; i < CoordIndex::End; i++) {
+            coords[i]->get(savedCoords[i]);
+        }
+        ToolTable::checkpoint();
+        Expression::checkpoint();
+        start(machine);
+        for (auto& box : work) {
+            start(box);
+        }
+
+        char  line[Channel::maxLine];
+        Error err;
+        sys.state = State::CheckMode;
+        scanning  = true;
+        while ((err = file.readLine(line, Channel::maxLine - 1)) == Error::Ok) {
+            if ((file.getLineNumber() % 256) == 0) {
+                protocol_execute_realtime();  // For a reset
+                if (sys.abort) {
+                    break;
+                }
+            }
+            char* p = line;
+            while (isspace(*p)) {
+                ++p;
+            }
+            if (*p == '$' || *p == '[') {
+                continue;
+            }
+            if ((err = gc_execute_line(p)) != Error::Ok && err != Error::GcodeUnsupportedCommand) {
+                break;
+            }
+        }
+        scanning  = false;
+        sys.state = State::Idle;
+
+        // A G10 in the file changed the coordinate systems, the tool table and the
+        // parameters only for the scan
+        gc_state = savedState;
+        ToolTable::rollback();
+        Expression::rollback();
+        for (size_t i = CoordIndex::Begin; i < CoordIndex::End; i++) {
+            if (memcmp(coords[i]->get(), savedCoords[i], sizeof(savedCoords[i]))) {
+                coords[i]->set(savedCoords[i]);
+            }
+        }
+
+        if (sys.abort) {
+            return Error::Reset;
+        }
+        if (err != Error::Eof) {
+            log_error_to(out,
+                         static_cast<int>(err) << " (" << errorString(err) << ") in " << file.path() << " at line "
+                                               << file.getLineNumber());
+            return err;
+        }
+        if (!machine.used) {
+            log_info_to(out, file.path() << " has no motion");
+        } else {
+            report("Machine", machine, out);
+            for (size_t i = CoordIndex::Begin; i < CoordIndex::NWCSystems; i++) {
+                if (work[i].used) {
+                    report(("G" + std::to_string(54 + i)).c_str(), work[i], out);
+                }
+            }
+        }
+        log_info_to(out, file.path() << (fits(machine, out) ? " is within the soft limits" : " exceeds the soft limits"));
+
+        entry.machine = machine;
+        for (auto& e : cache) {
+            if (e.path == entry.path) {
+                e = entry;
+                return Error::Ok;
+            }
+        }
+        cache[nextEntry] = entry;
+        nextEntry        = (nextEntry + 1) % nCached;
+        return Error::Ok;
+    }
+
+    Error check_job(InputFile& file, Channel& out) {
+        trustedJob = nullptr;
+        Entry key;
+        if (!config->_kinematics->boxLimits() || !identify(file, key)) {
+            return Error::Ok;
+        }
+        for (auto& e : cache) {
+            if (e.path == key.path && e.size == key.size && e.mtime == key.mtime && e.hash == key.hash && e.state == key.state) {
+                if (!fits(e.machine, out)) {
+                    log_error_to(out, file.path() << " exceeds the soft limits");
+                    return Error::SoftLimitError;
+                }
+                log_debug_to(out, file.path() << " is within the soft limits");
+                trustedJob = &file;
+                break;
+            }
+        }
+        return Error::Ok;
+    }
+
+    void job_ended(InputFile* file) {
+        if (trustedJob == file) {
+            trustedJob = nullptr;
+        }
+    }
+
+    void other_job() { trustedJob = nullptr; }
+}
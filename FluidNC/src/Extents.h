@@ -0,0 +1,70 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Extents.h - the travel of a file job, found once instead of checked line by line
+
+  $SD/Extents=<file> and $LocalFS/Extents=<file> run the file in check mode, as $C
+  would, but mc_linear() and mc_arc() hand each move to this module instead of testing
+  it against the soft limits.  The extents of the moves are reported in machine
+  coordinates and in the coordinates of each work coordinate system that the file
+  uses, with whether they fit in the soft limits.  The parser state, the offsets, the
+  tool table and the parameters are put back afterwards.
+
+  The extents are cached with the size, modification time and local file system hash of
+  the file, and a fingerprint of the state that the moves depend on: the modal state, the
+  offsets, the stored coordinate systems, the position, the tool table and the
+  parameters.  When $SD/Run or the job queue starts the file in that same state, the job
+  is rejected at once if its extents exceed the soft limits, and otherwise its lines skip
+  the soft limit checks.  Only kinematics whose limits are a box in cartesian space, as
+  Cartesian and CoreXY have, use the cache; see KinematicSystem::boxLimits().
+
+  The scan parses the whole file, so it runs in the main task like $SD/Estimate, and
+  the machine must be idle.  A resumed job is checked line by line as before.
+*/
+
+#include "Error.h"
+
+#include <cstddef>
+
+class Channel;
+class InputFile;
+
+namespace Extents {
+    const int nCached = 4;  // Files whose extents are kept; the oldest is replaced
+
+    // True while a scan runs; mc_linear() and mc_arc() pass their moves to line() and arc()
+    extern bool scanning;
+
+    void line(const float* target);
+    void arc(const float* position,
+             const float* target,
+             const float* center,
+             float        radius,
+             size_t       axis_0,
+             size_t       axis_1,
+             float        angular_travel);
+
+    // True while the main loop executes a line of a job whose extents are known to fit,
+    // so the soft limit checks can be skipped
+    extern bool lineTrusted;
+    inline bool trusted() { return lineTrusted; }
+
+    // Called by the main loop around each line, true for the lines of file jobs
+    void trust_line(bool fromJob);
+
+    // $SD/Extents and $LocalFS/Extents
+    Error scan(InputFile& file, Channel& out);
+
+    // Called as a file job starts.  Returns Error::SoftLimitError if the cached extents
+    // of the file exceed the soft limits.
+    Error check_job(InputFile& file, Channel& out);
+
+    // Called as a file job ends
+    void job_ended(InputFile* file);
+
+    // Called as a stream job starts.  Its lines come as allChannels too, like those of a
+    // file job, so a file job that is running is no longer trusted.
+    void other_job();
+}
@@ -0,0 +1,123 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "FileCache.h"
+#include "Logging.h"
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+struct CacheEntry {
+    FileCache::data_t data;
+    size_t            size;
+    time_t            mtime;
+    uint32_t          used;  // When it was last used, in get() calls
+};
+
+// FileStreams are opened by the main loop, the web server and the hash task
+static std::mutex                        cacheMutex;
+static std::map<std::string, CacheEntry> entries;
+static size_t                            totalBytes = 0;
+static uint32_t                          useCount   = 0;
+
+struct OpenTimes {
+    uint32_t count = 0;
+    uint64_t usecs = 0;
+};
+static OpenTimes hitTimes, missTimes;
+
+// Only files in the top directory of the local file system, which is where macros are kept
+static bool cacheable(const std::filesystem::path& path) {
+    int count = 0;
+    for (auto it = path.begin(); it != path.end(); ++it) {
+        ++count;
+    }
+    if (count != 3) {
+        return false;
+    }
+    auto fsname = *++path.begin();
+    return fsname == "littlefs" || fsname == "spiffs" || fsname == "localfs";
+}
+
+static void drop(std::map<std::string, CacheEntry>::iterator it) {
+    totalBytes -= it->second.size;
+    entries.erase(it);
+}
+
+FileCache::data_t FileCache::get(const std::filesystem::path& path, bool& hit) {
+    if (!cacheable(path)) {
+        return nullptr;
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) || S_ISDIR(st.st_mode) || st.st_size == 0 || size_t(st.st_size) > maxFileSize) {
+        forget(path);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto                        it = entries.find(path.string());
+    if (it != entries.end()) {
+        if (it->second.size == size_t(st.st_size) && it->second.mtime == st.st_mtime) {
+            it->second.used = ++useCount;
+            hit             = true;
+            return it->second.data;
+        }
+        drop(it);
+    }
+
+    FILE* fd = fopen(path.c_str(), "r");
+    if (!fd) {
+        return nullptr;
+    }
+    std::string contents(st.st_size, '\0');
+    size_t      length = fread(contents.data(), 1, contents.size(), fd);
+    fclose(fd);
+    if (length != contents.size()) {
+        return nullptr;
+    }
+
+    while (!entries.empty() && totalBytes + length > maxTotal) {
+        auto oldest = entries.begin();
+        for (auto e = entries.begin(); e != entries.end(); ++e) {
+            if (e->second.used < oldest->second.used) {
+                oldest = e;
+            }
+        }
+        drop(oldest);
+    }
+    auto data = std::make_shared<const std::string>(std::move(contents));
+    entries[path.string()] = { data, length, st.st_mtime, ++useCount };
+    totalBytes += length;
+    return data;
+}
+
+void FileCache::forget(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto                        it = entries.find(path.string());
+    if (it != entries.end()) {
+        drop(it);
+    }
+}
+
+void FileCache::timeOpen(bool cached, uint32_t usecs) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto&                       times = cached ? hitTimes : missTimes;
+    times.count++;
+    times.usecs += usecs;
+}
+
+static uint32_t average(const OpenTimes& times) {
+    return times.count ? uint32_t(times.usecs / times.count) : 0;
+}
+
+void FileCache::show(Channel& out) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (const auto& [name, entry] : entries) {
+        log_info_to(out, name << ": " << entry.size << " bytes");
+    }
+    log_info_to(out,
+                "File cache " << entries.size() << " files " << totalBytes << "/" << maxTotal << " bytes; opens cached:" << hitTimes.count
+                              << " avg " << average(hitTimes) << "us, uncached:" << missTimes.count << " avg " << average(missTimes)
+                              << "us");
+}
@@ -0,0 +1,35 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+class Channel;
+
+// Small files on the local file system, such as macros, kept in RAM once they have been
+// read, so that opening one again costs a stat() instead of a littlefs open, a block read
+// and a close.  An entry is used only while the size and modification time of the file
+// still match, and is dropped when FileStream opens the file for writing or HashFS hears
+// that it was changed, deleted or renamed.  The least recently used files are dropped to
+// keep the total under maxTotal.
+class FileCache {
+public:
+    static const size_t maxFileSize = 2048;
+    static const size_t maxTotal    = 16384;
+
+    using data_t = std::shared_ptr<const std::string>;
+
+    // The contents of the file, read into the cache if they are not already there, or
+    // nullptr if the file is not on the local file system, is empty or is too big.  hit is
+    // set if the contents were already cached.
+    static data_t get(const std::filesystem::path& path, bool& hit);
+
+    static void forget(const std::filesystem::path& path);
+
+    // Counts the time taken to open a file for reading, for $LocalFS/Cache
+    static void timeOpen(bool cached, uint32_t usecs);
+
+    static void show(Channel& out);
+};
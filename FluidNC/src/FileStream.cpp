@@ -3,6 +3,9 @@
 
 #include "FileStream.h"
 #include "Machine/MachineConfig.h"  // config->
+#include "FileCache.h"
+
+#include <esp_timer.h>  // esp_timer_get_time()
 
 std::string FileStream::path() {
     return _fpath.c_str();
@@ -48,7 +51,26 @@ size_t FileStream::position() {
     return ftell(_fd);
 }
 
+bool FileStream::seek(size_t position) {
+    return fseek(_fd, position, SEEK_SET) == 0;
+}
+
 void FileStream::setup(const char* mode) {
+    bool reading = !strcmp(mode, "r");
+    if (reading) {
+        // Small local files are read from RAM once they are cached
+        int64_t start = esp_timer_get_time();
+        bool    hit   = false;
+        _cached       = FileCache::get(_fpath, hit);
+        if (_cached && (_fd = fmemopen(const_cast<char*>(_cached->data()), _cached->size(), "r"))) {
+            _size = _cached->size();
+            FileCache::timeOpen(hit, uint32_t(esp_timer_get_time() - start));
+            return;
+        }
+        _cached = nullptr;
+    } else {
+        FileCache::forget(_fpath);
+    }
     _fd = fopen(_fpath.c_str(), mode);
 
     if (!_fd) {
@@ -12,6 +12,7 @@
 
 #include "Channel.h"
 #include "FluidPath.h"
+#include "FileCache.h"
 
 extern "C" {
 #include <stdio.h>
@@ -22,6 +23,8 @@ class FileStream : public Channel {
     FILE*     _fd;
     size_t    _size;
 
+    FileCache::data_t _cached;  // Holds the contents that _fd reads, when they come from the cache
+
     void setup(const char* mode);
 
 public:
@@ -49,6 +52,7 @@ public:
 
     size_t size();
     size_t position();
+    bool   seek(size_t position);
 
     // pollLine() is a required method of the Channel class that
     // FileStream implements as a no-op.
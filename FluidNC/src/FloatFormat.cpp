@@ -0,0 +1,59 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "FloatFormat.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+static const double pow10s[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+
+static int clamp_decimals(int decimals) {
+    return decimals < 0 ? 0 : decimals > 6 ? 6 : decimals;
+}
+
+// Writes units, with decimals digits after the point, and the sign
+static size_t format_units(char* buf, uint64_t units, int decimals, bool negative) {
+    // Build the digits backwards from the least significant one
+    char  digits[fixedFormatMax];
+    char* p = digits + sizeof(digits);
+    for (int i = 0; i < decimals; ++i) {
+        *--p = '0' + units % 10;
+        units /= 10;
+    }
+    if (decimals) {
+        *--p = '.';
+    }
+    do {
+        *--p = '0' + units % 10;
+        units /= 10;
+    } while (units);
+    if (negative) {
+        *--p = '-';
+    }
+
+    size_t length = digits + sizeof(digits) - p;
+    for (size_t i = 0; i < length; ++i) {
+        buf[i] = p[i];
+    }
+    buf[length] = '\0';
+    return length;
+}
+
+size_t format_fixed(char* buf, float value, int decimals) {
+    decimals = clamp_decimals(decimals);
+
+    // A float has a 24-bit mantissa and 1e6 needs 20 bits, so the scaled value is
+    // exact in a double.  nearbyint() then rounds ties to even, as printf() does.
+    double scaled = std::nearbyint(std::fabs(double(value)) * pow10s[decimals]);
+    if (!std::isfinite(value) || scaled >= 1e18) {
+        return snprintf(buf, fixedFormatMax, "%.*f", decimals, value);
+    }
+    return format_units(buf, uint64_t(scaled), decimals, std::signbit(value));
+}
+
+size_t format_scaled(char* buf, int32_t value, int decimals) {
+    // The magnitude of INT32_MIN does not fit in an int32_t
+    uint64_t units = value < 0 ? uint64_t(-int64_t(value)) : uint64_t(value);
+    return format_units(buf, units, clamp_decimals(decimals), value < 0);
+}
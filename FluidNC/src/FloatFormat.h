@@ -0,0 +1,20 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Longest text that format_fixed() can produce, including the terminating null:
+// 39 integer digits for FLT_MAX, a sign, a point and six decimals
+const size_t fixedFormatMax = 48;
+
+// Writes value with exactly decimals (clamped to 0..6) digits after the point into
+// buf, which must hold fixedFormatMax characters, and returns the length.  The
+// result is the same as printf("%.*f") but needs no locale, stream or heap.
+size_t format_fixed(char* buf, float value, int decimals);
+
+// Writes the fixed-point number value / 10^decimals, with decimals (clamped to 0..6)
+// digits after the point, into buf, which must hold fixedFormatMax characters, and
+// returns the length.  Integer math only, for values that are kept scaled already.
+size_t format_scaled(char* buf, int32_t value, int decimals);
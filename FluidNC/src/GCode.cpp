@@ -15,11 +15,18 @@
 #include "Machine/UserOutputs.h"  // setAnalogPercent
 #include "Platform.h"             // WEAK_LINK
 #include "ProcessSettings.h"
+#include "WebHook.h"     // WebHook::post()
+#include "JobStats.h"    // JobStats::job_done()
+#include "ToolTable.h"   // ToolTable::length()
+#include "Expression.h"  // Expression::read_value()
+#include "OWord.h"       // OWord::handle()
 
 #include "Machine/MachineConfig.h"
 
 #include <string.h>  // memset
 #include <math.h>    // sqrt etc.
+#include <algorithm>
+#include <vector>
 
 // Allow iteration over CoordIndex values
 CoordIndex& operator++(CoordIndex& i) {
@@ -40,6 +47,55 @@ parser_block_t gc_block;
 
 #define FAIL(status) return (status);
 
+// The machine's values as parameters, numbered as in LinuxCNC, in the current units
+static bool gc_read_parameter(int number, float* value) {
+    const float scale  = gc_state.modal.units == Units::Inches ? INCH_PER_MM : 1.0f;
+    const int   n_axis = config->_axes->_numberAxis;
+
+    auto axis_of = [&](int first, int& axis) {
+        axis = number - first;
+        return axis >= 0 && axis < n_axis;
+    };
+    // Work coordinates, as in the status report
+    auto work = [&](const float* mpos, int axis) {
+        float wpos = mpos[axis] - gc_state.coord_system[axis] - gc_state.coord_offset[axis];
+        if (axis == TOOL_LENGTH_OFFSET_AXIS) {
+            wpos -= gc_state.tool_length_offset;
+        }
+        return wpos * scale;
+    };
+
+    int axis;
+    if (axis_of(5061, axis)) {  // The last probe position
+        float probe[MAX_N_AXIS];
+        probe_mpos(probe);
+        *value = work(probe, axis);
+    } else if (number == 5070) {
+        *value = probe_succeeded;
+    } else if (axis_of(5161, axis)) {
+        *value = coords[CoordIndex::G28]->get()[axis] * scale;
+    } else if (axis_of(5181, axis)) {
+        *value = coords[CoordIndex::G30]->get()[axis] * scale;
+    } else if (axis_of(5211, axis)) {
+        *value = gc_state.coord_offset[axis] * scale;
+    } else if (number == 5220) {
+        *value = gc_state.modal.coord_select + 1;
+    } else if (number > 5220 && number < 5221 + 20 * CoordIndex::NWCSystems && (number - 5221) % 20 < n_axis) {
+        *value = coords[(number - 5221) / 20]->get()[(number - 5221) % 20] * scale;
+    } else if (number == 5400) {
+        *value = gc_state.tool;
+    } else if (axis_of(5420, axis)) {
+        *value = work(gc_state.position, axis);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// An S word that the step segments are to apply, with the speed that it sets
+static bool     spindleDeferred = false;
+static uint32_t deferredSpeed   = 0;
+
 void gc_init() {
     // Reset parser state:
     memset(&gc_state, 0, sizeof(parser_state_t));
@@ -48,6 +104,19 @@ void gc_init() {
     gc_state.modal.coord_select = CoordIndex::G54;
     gc_state.modal.override     = config->_start->_deactivateParking ? Override::Disabled : Override::ParkingMotion;
     coords[gc_state.modal.coord_select]->get(gc_state.coord_system);
+
+    Expression::set_system_reader(gc_read_parameter);
+    OWord::reset();
+    spindleDeferred = false;
+}
+
+void gc_sync_spindle() {
+    if (spindleDeferred) {
+        spindleDeferred = false;
+        if (gc_state.modal.spindle != SpindleState::Disable) {
+            spindle->setState(gc_state.modal.spindle, deferredSpeed);
+        }
+    }
 }
 
 // Sets g-code parser position in mm. Input in steps. Called by the system abort and hard
@@ -138,6 +207,109 @@ static void gc_wco_changed() {
     allChannels.notifyWco();
 }
 
+static bool is_drill_cycle(Motion motion) {
+    return motion == Motion::DrillChipBreak || motion == Motion::Drill || motion == Motion::DrillDwell || motion == Motion::DrillPeck;
+}
+
+// Moves the drilling axis to level, holding the other axes at target
+static bool drill_move(float* target, size_t axis, float level, bool rapid, plan_line_data_t* pl_data) {
+    target[axis]                = level;
+    pl_data->motion.rapidMotion = rapid;
+    mc_linear(target, pl_data, gc_state.position);
+    copyAxes(gc_state.position, target);
+    return !sys.abort;
+}
+
+// Drills the L holes of a G73/G81/G82/G83 block, queueing the moves that a post would
+// otherwise have sent as G0/G1 lines, so the planner looks ahead across the holes as for
+// any other moves.  The levels are in machine coordinates and the drilling axis points
+// up, from bottom to r_level.  As LinuxCNC, a peck backs off 0.254 mm, 0.010 in, from the
+// previous depth, and G83 clears the hole up to R between pecks.
+static void drill_holes(parser_block_t& block, size_t axis, float r_level, float bottom, plan_line_data_t* pl_data) {
+    const float peck_clearance = 0.254f;
+    bool        peck           = block.modal.motion == Motion::DrillPeck || block.modal.motion == Motion::DrillChipBreak;
+
+    float clear = block.modal.retract == RetractMode::OldZ ? std::max(gc_state.position[axis], r_level) : r_level;
+    float hop[MAX_N_AXIS];  // Between the holes of an L repeat, which only moves in G91
+    for (size_t idx = 0; idx < MAX_N_AXIS; idx++) {
+        hop[idx] = block.modal.distance == Distance::Incremental ? block.values.xyz[idx] - gc_state.position[idx] : 0;
+    }
+    hop[axis] = 0;
+
+    float target[MAX_N_AXIS];
+    copyAxes(target, gc_state.position);
+    if (target[axis] < r_level && !drill_move(target, axis, r_level, true, pl_data)) {
+        return;
+    }
+    for (uint8_t hole = 0; hole < block.values.l; hole++) {
+        for (size_t idx = 0; idx < MAX_N_AXIS; idx++) {
+            if (idx != axis) {
+                target[idx] = hole ? target[idx] + hop[idx] : block.values.xyz[idx];
+            }
+        }
+        if (!drill_move(target, axis, gc_state.position[axis], true, pl_data) || !drill_move(target, axis, r_level, true, pl_data)) {
+            return;
+        }
+        float depth = r_level;
+        while (depth > bottom) {
+            depth = peck ? std::max(depth - block.values.q, bottom) : bottom;
+            if (!drill_move(target, axis, depth, false, pl_data)) {
+                return;
+            }
+            if (depth > bottom) {
+                if (block.modal.motion == Motion::DrillPeck && !drill_move(target, axis, r_level, true, pl_data)) {
+                    return;
+                }
+                if (!drill_move(target, axis, std::min(depth + peck_clearance, r_level), true, pl_data)) {
+                    return;
+                }
+            }
+        }
+        if (block.modal.motion == Motion::DrillDwell) {
+            mc_dwell(int32_t(block.values.p * 1000.0f), pl_data);  // Does nothing in check mode
+        }
+        if (sys.abort || !drill_move(target, axis, clear, true, pl_data)) {
+            return;
+        }
+    }
+}
+
+// Packs the words of a line as letters and binary floats, so a replay does not parse
+// the numbers again.  See GCode.h.
+size_t gc_compile_line(const char* line, char* out) {
+    // Lines that are not g-code, and comments, which may have to be reported, stay text
+    if (line[0] == '$' || line[0] == '[' || strpbrk(line, "();")) {
+        return 0;
+    }
+    char block[LINE_BUFFER_SIZE];
+    strncpy(block, line, sizeof(block) - 1);
+    block[sizeof(block) - 1] = '\0';
+    collapseGCode(block);
+    if (block[0] == 'O') {
+        return 0;  // Flow control, for OWord::handle()
+    }
+
+    size_t n_words      = 0;
+    size_t length       = 2;
+    size_t char_counter = 0;
+    while (block[char_counter]) {
+        char  letter = block[char_counter++];
+        float value;
+        if (letter < 'A' || letter > 'Z' || !read_float(block, &char_counter, &value) || n_words == maxCompiledWords) {
+            return 0;  // Left for gc_execute_line() to report
+        }
+        out[length] = letter;
+        memcpy(&out[length + 1], &value, sizeof(value));
+        length += compiledWordSize;
+        n_words++;
+    }
+    out[0] = compiledLineMarker;
+    out[1] = n_words;
+    return length;
+}
+
+static Error gc_execute(char* line, const char* compiled);
+
 // Executes one line of NUL-terminated G-Code.
 // The line may contain whitespace and comments, which are first removed,
 // and lower case characters, which are converted to upper case.
@@ -147,7 +319,19 @@ static void gc_wco_changed() {
 Error gc_execute_line(char* line) {
     // Step 0 - remove whitespace and comments and convert to upper case
     collapseGCode(line);
+    Error status;
+    if (OWord::handle(line, status)) {
+        return status;
+    }
+    return gc_execute(line, nullptr);
+}
+
+Error gc_execute_compiled(const char* compiled) {
+    return gc_execute(nullptr, compiled);
+}
 
+// Executes either a collapsed line or, if line is null, a compiled one
+static Error gc_execute(char* line, const char* compiled) {
     /* -------------------------------------------------------------------------------------
        STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
        updates these modes and commands as the block line is parser and will only be used and
@@ -174,15 +358,22 @@ Error gc_execute_line(char* line) {
     bool probeNoError  = false;
     bool syncLaser     = false;
     bool disableLaser  = false;
+    bool toolSelected  = false;
     bool laserIsMotion = false;
     bool nonmodalG38   = false;  // Used for G38.6-9
 
+    float cycle_z       = 0;  // Canned cycle Z as programmed, in mm
+    float cycle_r_level = 0;  // Canned cycle R and Z levels in machine coordinates
+    float cycle_bottom  = 0;
+
     auto    n_axis = config->_axes->_numberAxis;
-    float   coord_data[MAX_N_AXIS];  // Used by WCO-related commands
-    uint8_t pValue;                  // Integer value of P word
+    float    coord_data[MAX_N_AXIS];  // Used by WCO-related commands
+    uint8_t  pValue;                  // Integer value of P word
+    uint32_t table_tool   = 0;        // G10 L1/L10 tool number, or 0
+    float    table_length = 0;
 
     // Determine if the line is a jogging motion or a normal g-code block.
-    if (line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
+    if (line && line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
         // Set G1 and G94 enforced modes to ensure accurate error checks.
         jogMotion                = true;
         gc_block.modal.motion    = Motion::Linear;
@@ -205,15 +396,40 @@ Error gc_execute_line(char* line) {
     uint8_t    int_value = 0;
     uint16_t   mantissa  = 0;
     char_counter         = jogMotion ? 3 : 0;  // Start parsing after `$J=` if jogging
-    while (line[char_counter] != 0) {          // Loop until no more g-code words in line.
-        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
-        letter = line[char_counter];
-        if ((letter < 'A') || (letter > 'Z')) {
-            FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
-        }
-        char_counter++;
-        if (!read_float(line, &char_counter, &value)) {
-            FAIL(Error::BadNumberFormat);  // [Expected word value]
+    size_t n_words       = compiled ? uint8_t(compiled[1]) : 0;
+
+    std::vector<Expression::Assignment> assignments;  // Made once all the words are read
+    // Loop until no more g-code words in line.
+    while (compiled ? n_words-- != 0 : line[char_counter] != 0) {
+        if (compiled) {
+            // The words of a compiled line have already passed the checks below
+            const char* word = &compiled[2 + char_counter];
+            letter           = word[0];
+            memcpy(&value, &word[1], sizeof(value));
+            char_counter += compiledWordSize;
+        } else {
+            // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
+            letter = line[char_counter];
+            if (letter == '#') {
+                Expression::Assignment assignment;
+                Error                  err = Expression::read_assignment(line, &char_counter, assignment);
+                if (err != Error::Ok) {
+                    FAIL(err);
+                }
+                assignments.push_back(std::move(assignment));
+                continue;
+            }
+            if ((letter < 'A') || (letter > 'Z')) {
+                FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
+            }
+            char_counter++;
+            if (!read_float(line, &char_counter, &value)) {
+                // If not a number, a parameter, an expression or a function
+                Error err = Expression::read_value(line, &char_counter, &value);
+                if (err != Error::Ok) {
+                    FAIL(err);  // [Expected word value]
+                }
+            }
         }
         // Convert values to smaller uint8 significand and mantissa values for parsing this word.
         // NOTE: Mantissa is multiplied by 100 to catch non-integer command values. This is more
@@ -304,6 +520,15 @@ Error gc_execute_line(char* line) {
                         gc_block.modal.motion = Motion::CcwArc;
                         mg_word_bit           = ModalGroup::MG1;
                         break;
+                    case 33:  // G33 - spindle synchronized motion
+                        // Threading needs the spindle angle, so only spindles with feedback can do it
+                        if (spindle->actualSpeed() < 0) {
+                            FAIL(Error::GcodeSpindleNotSynced);
+                        }
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::SpindleSync;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
                     case 38:  // G38 - probe
                         //only allow G38 "Probe" commands if a probe pin is defined.
                         if (!config->_probe->exists()) {
@@ -353,6 +578,26 @@ Error gc_execute_line(char* line) {
                         gc_block.modal.motion = Motion::None;
                         mg_word_bit           = ModalGroup::MG1;
                         break;
+                    case 73:  // G73 - peck drilling with chip breaking
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::DrillChipBreak;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
+                    case 81:  // G81 - drilling
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::Drill;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
+                    case 82:  // G82 - drilling with dwell
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::DrillDwell;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
+                    case 83:  // G83 - peck drilling
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::DrillPeck;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
                     case 17:
                         gc_block.modal.plane_select = Plane::XY;
                         mg_word_bit                 = ModalGroup::MG2;
@@ -406,6 +651,18 @@ Error gc_execute_line(char* line) {
                         gc_block.modal.feed_rate = FeedRate::UnitsPerMin;
                         mg_word_bit              = ModalGroup::MG5;
                         break;
+                    case 95:
+                        gc_block.modal.feed_rate = FeedRate::UnitsPerRev;
+                        mg_word_bit              = ModalGroup::MG5;
+                        break;
+                    case 98:
+                        gc_block.modal.retract = RetractMode::OldZ;
+                        mg_word_bit            = ModalGroup::MG10;
+                        break;
+                    case 99:
+                        gc_block.modal.retract = RetractMode::RPlane;
+                        mg_word_bit            = ModalGroup::MG10;
+                        break;
                     case 20:
                         gc_block.modal.units = Units::Inches;
                         mg_word_bit          = ModalGroup::MG6;
@@ -434,6 +691,8 @@ Error gc_execute_line(char* line) {
                             gc_block.modal.tool_length = ToolLengthOffset::Cancel;
                         } else if (mantissa == 10) {  // G43.1
                             gc_block.modal.tool_length = ToolLengthOffset::EnableDynamic;
+                        } else if (mantissa == 0) {  // G43
+                            gc_block.modal.tool_length = ToolLengthOffset::Enable;
                         } else {
                             FAIL(Error::GcodeUnsupportedCommand);  // [Unsupported G43.x command]
                         }
@@ -469,8 +728,12 @@ Error gc_execute_line(char* line) {
                         if (mantissa != 0) {
                             FAIL(Error::GcodeUnsupportedCommand);  // [G61.1 not supported]
                         }
-                        // gc_block.modal.control = ControlMode::ExactPath; // G61
-                        mg_word_bit = ModalGroup::MG13;
+                        gc_block.modal.control = ControlMode::ExactPath;  // G61
+                        mg_word_bit            = ModalGroup::MG13;
+                        break;
+                    case 64:
+                        gc_block.modal.control = ControlMode::Blend;
+                        mg_word_bit            = ModalGroup::MG13;
                         break;
                     default:
                         FAIL(Error::GcodeUnsupportedCommand);  // [Unsupported G command]
@@ -521,7 +784,7 @@ Error gc_execute_line(char* line) {
                         if ((s != "") && (StartWithM345) && (!StartURLCalled)) {
                             log_debug("Call URL M345");
                             StartURLCalled = 1;
-                            CallURLWithRetryStrategy(s);
+                            WebHook::post(s);
                         }
 
                         switch (int_value) {
@@ -668,7 +931,10 @@ Error gc_execute_line(char* line) {
                         axis_word_bit     = GCodeWord::F;
                         gc_block.values.f = value;
                         break;
-                    // case 'H': // Not supported
+                    case 'H':
+                        axis_word_bit     = GCodeWord::H;
+                        gc_block.values.h = int_value;
+                        break;
                     case 'I':
                         axis_word_bit               = GCodeWord::I;
                         gc_block.values.ijk[X_AXIS] = value;
@@ -716,6 +982,34 @@ Error gc_execute_line(char* line) {
                         }
                         log_info("Tool No: " << int_value);
                         gc_state.tool = int_value;
+                        toolSelected  = true;
+                        break;
+                    case 'U':
+                        if (U_AXIS < MAX_N_AXIS && n_axis > U_AXIS) {
+                            axis_word_bit               = GCodeWord::U;
+                            gc_block.values.xyz[U_AXIS] = value;
+                            set_bitnum(axis_words, U_AXIS);
+                        } else {
+                            FAIL(Error::GcodeUnsupportedCommand);
+                        }
+                        break;
+                    case 'V':
+                        if (V_AXIS < MAX_N_AXIS && n_axis > V_AXIS) {
+                            axis_word_bit               = GCodeWord::V;
+                            gc_block.values.xyz[V_AXIS] = value;
+                            set_bitnum(axis_words, V_AXIS);
+                        } else {
+                            FAIL(Error::GcodeUnsupportedCommand);
+                        }
+                        break;
+                    case 'W':
+                        if (W_AXIS < MAX_N_AXIS && n_axis > W_AXIS) {
+                            axis_word_bit               = GCodeWord::W;
+                            gc_block.values.xyz[W_AXIS] = value;
+                            set_bitnum(axis_words, W_AXIS);
+                        } else {
+                            FAIL(Error::GcodeUnsupportedCommand);
+                        }
                         break;
                     case 'X':
                         if (n_axis > X_AXIS) {
@@ -756,7 +1050,7 @@ Error gc_execute_line(char* line) {
                 // Check for invalid negative values for words F, N, P, T, and S.
                 // NOTE: Negative value check is done here simply for code-efficiency.
                 if (bitmask & (bitnum_to_mask(GCodeWord::F) | bitnum_to_mask(GCodeWord::N) | bitnum_to_mask(GCodeWord::P) |
-                               bitnum_to_mask(GCodeWord::T) | bitnum_to_mask(GCodeWord::S))) {
+                               bitnum_to_mask(GCodeWord::T) | bitnum_to_mask(GCodeWord::S) | bitnum_to_mask(GCodeWord::H))) {
                     if (value < 0.0) {
                         FAIL(Error::NegativeValue);  // [Word value cannot be negative]
                     }
@@ -764,6 +1058,12 @@ Error gc_execute_line(char* line) {
                 value_words |= bitmask;  // Flag to indicate parameter assigned.
         }
     }
+    for (auto& assignment : assignments) {
+        Error err = Expression::assign(assignment);
+        if (err != Error::Ok) {
+            FAIL(err);
+        }
+    }
     // Parsing complete!
     /* -------------------------------------------------------------------------------------
        STEP 3: Error-check all commands and values passed in this block. This step ensures all of
@@ -843,9 +1143,10 @@ Error gc_execute_line(char* line) {
             // value in the block. If no F word is passed with a motion command that requires a feed rate, this will error
             // out in the motion modes error-checking. However, if no F word is passed with NO motion command that requires
             // a feed rate, we simply move on and the state feed rate value gets updated to zero and remains undefined.
-        } else {  // = G94
+        } else {  // = G94 or G95
             // - In units per mm mode: If F word passed, ensure value is in mm/min, otherwise push last state value.
-            if (gc_state.modal.feed_rate == FeedRate::UnitsPerMin) {  // Last state is also G94
+            //   Units per revolution mode works the same way with mm/rev.
+            if (gc_state.modal.feed_rate == gc_block.modal.feed_rate) {  // Last state is the same mode
                 if (bitnum_is_true(value_words, GCodeWord::F)) {
                     if (!nonmodalG38 && gc_block.modal.units == Units::Inches) {
                         gc_block.values.f *= MM_PER_INCH;
@@ -853,7 +1154,7 @@ Error gc_execute_line(char* line) {
                 } else {
                     gc_block.values.f = gc_state.feed_rate;  // Push last state feed rate
                 }
-            }  // Else, switching to G94 from G93, so don't push last state feed rate. Its undefined or the passed F word value.
+            }  // Else, switching modes, so don't push last state feed rate. Its undefined or the passed F word value.
         }
     }
     // clear_bitnum(value_words, GCodeWord::F); // NOTE: Single-meaning value word. Set at end of error-checking.
@@ -932,17 +1233,28 @@ Error gc_execute_line(char* line) {
     // [G40 Errors]: G2/3 arc is programmed after a G40. The linear move after disabling is less than tool diameter.
     //   NOTE: Since cutter radius compensation is never enabled, these G40 errors don't apply. G40 is supported
     //   only for the purpose of not erroring when G40 is sent with a g-code program header to setup the default modes.
-    // [14. Cutter length compensation ]: G43 NOT SUPPORTED, but G43.1 and G49 are.
+    // [14. Cutter length compensation ]: G43, G43.1 and G49 are supported.
     // [G43.1 Errors]: Motion command in same line.
     //   NOTE: Although not explicitly stated so, G43.1 should be applied to only one valid
     //   axis that is configured (in config.h). There should be an error if the configured axis
     //   is absent or if any of the other axis words are present.
+    // [G43 Errors]: Axis words present. Tool, from H or else the last T, not in the tool table.
+    uint32_t tlo_tool = 0;
     if (axis_command == AxisCommand::ToolLengthOffset) {  // Indicates called in block.
         gc_ngc_changed(CoordIndex::TLO);
         if (gc_block.modal.tool_length == ToolLengthOffset::EnableDynamic) {
             if (axis_words ^ bitnum_to_mask(TOOL_LENGTH_OFFSET_AXIS)) {
                 FAIL(Error::GcodeG43DynamicAxisError);
             }
+        } else if (gc_block.modal.tool_length == ToolLengthOffset::Enable) {
+            if (axis_words) {
+                FAIL(Error::GcodeAxisWordsExist);
+            }
+            tlo_tool = bitnum_is_true(value_words, GCodeWord::H) ? gc_block.values.h : gc_state.tool;
+            if (!ToolTable::length(tlo_tool, gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS])) {
+                FAIL(Error::GcodeToolNotInTable);
+            }
+            clear_bitnum(value_words, GCodeWord::H);
         }
     }
     // [15. Coordinate system selection ]: *N/A. Error, if cutter radius comp is active.
@@ -962,9 +1274,28 @@ Error gc_execute_line(char* line) {
             coords[gc_block.modal.coord_select]->get(block_coord_system);
         }
     }
-    // [16. Set path control mode ]: N/A. Only G61. G61.1 and G64 NOT SUPPORTED.
+    // [16. Set path control mode ]: G61.1 NOT SUPPORTED. P or Q without G64.
+    // NOTE: G64 P is the distance by which corners may be rounded, and G64 Q that by which lines
+    // may be merged; Q defaults to P, and G64 alone keeps the configured junction deviation.
+    if (bitnum_is_true(command_words, ModalGroup::MG13) && gc_block.modal.control == ControlMode::Blend) {
+        if (bitnum_is_false(value_words, GCodeWord::P)) {
+            gc_block.values.p = 0.0;
+        } else if (gc_block.values.p < 0.0) {
+            FAIL(Error::NegativeValue);  // [P cannot be negative]
+        }
+        if (bitnum_is_false(value_words, GCodeWord::Q)) {
+            gc_block.values.q = gc_block.values.p;
+        } else if (gc_block.values.q < 0.0) {
+            FAIL(Error::NegativeValue);  // [Q cannot be negative]
+        }
+        if (gc_block.modal.units == Units::Inches) {
+            gc_block.values.p *= MM_PER_INCH;
+            gc_block.values.q *= MM_PER_INCH;
+        }
+        clear_bits(value_words, (bitnum_to_mask(GCodeWord::P) | bitnum_to_mask(GCodeWord::Q)));
+    }
     // [17. Set distance mode ]: N/A. Only G91.1. G90.1 NOT SUPPORTED.
-    // [18. Set retract mode ]: NOT SUPPORTED.
+    // [18. Set retract mode ]: N/A. Used by the canned cycles.
     // [19. Remaining non-modal actions ]: Check go to predefined position, set G10, or set axis offsets.
     // NOTE: We need to separate the non-modal commands that are axis word-using (G10/G28/G30/G92), as these
     // commands all treat axis words differently. G10 as absolute offsets or computes current position as
@@ -972,15 +1303,33 @@ Error gc_execute_line(char* line) {
     // all the current coordinate system and G92 offsets.
     switch (gc_block.non_modal_command) {
         case NonModal::SetCoordinateData:
-            // [G10 Errors]: L missing and is not 2 or 20. P word missing. (Negative P value done.)
+            // [G10 Errors]: L missing and is not 1, 2, 10 or 20. P word missing. (Negative P value done.)
             // [G10 L2 Errors]: R word NOT SUPPORTED. P value not 0 to nCoordSys(max 9). Axis words missing.
             // [G10 L20 Errors]: P must be 0 to nCoordSys(max 9). Axis words missing.
+            // [G10 L1/L10 Errors]: P is the tool number. Axis words other than the tool length axis.
             if (!axis_words) {
                 FAIL(Error::GcodeNoAxisWords)
             };  // [No axis words]
             if (bits_are_false(value_words, (bitnum_to_mask(GCodeWord::P) | bitnum_to_mask(GCodeWord::L)))) {
                 FAIL(Error::GcodeValueWordMissing);  // [P/L word missing]
             }
+            if (gc_block.values.l == 1 || gc_block.values.l == 10) {
+                if (axis_words ^ bitnum_to_mask(TOOL_LENGTH_OFFSET_AXIS)) {
+                    FAIL(Error::GcodeG43DynamicAxisError);
+                }
+                clear_bits(value_words, (bitnum_to_mask(GCodeWord::L) | bitnum_to_mask(GCodeWord::P)));
+                table_tool = uint32_t(truncf(gc_block.values.p));
+                if (gc_block.values.l == 1) {
+                    // L1: Set the tool length to the programmed value.
+                    table_length = gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS];
+                } else {
+                    // L10: Set the tool length so that the current position reads the programmed value.
+                    // WPos = MPos - WCS - G92 - TLO  ->  TLO = MPos - WCS - G92 - WPos
+                    table_length = gc_state.position[TOOL_LENGTH_OFFSET_AXIS] - block_coord_system[TOOL_LENGTH_OFFSET_AXIS] -
+                                   gc_state.coord_offset[TOOL_LENGTH_OFFSET_AXIS] - gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS];
+                }
+                break;
+            }
             if (gc_block.values.l != 20) {
                 if (gc_block.values.l == 2) {
                     if (bitnum_is_true(value_words, GCodeWord::R)) {
@@ -1133,9 +1482,16 @@ Error gc_execute_line(char* line) {
             // the value must be positive. In inverse time mode, a positive value must be passed with each block.
         } else {
             // Check if feed rate is defined for the motion modes that require it.
-            if (gc_block.values.f == 0.0) {
+            // G33 takes its feed from K and the spindle speed instead.
+            if (gc_block.values.f == 0.0 && gc_block.modal.motion != Motion::SpindleSync) {
                 FAIL(Error::GcodeUndefinedFeedRate);  // [Feed rate undefined]
             }
+            // Feed per revolution needs a turning spindle
+            if (gc_block.modal.motion == Motion::SpindleSync || gc_block.modal.feed_rate == FeedRate::UnitsPerRev) {
+                if (gc_block.modal.spindle == SpindleState::Disable || gc_block.values.s == 0.0) {
+                    FAIL(Error::GcodeUndefinedFeedRate);  // [S undefined or spindle off]
+                }
+            }
             switch (gc_block.modal.motion) {
                 case Motion::None:
                     break;  // Feed rate is unnecessary
@@ -1148,6 +1504,20 @@ Error gc_execute_line(char* line) {
                         axis_command = AxisCommand::None;
                     }
                     break;
+                case Motion::SpindleSync:
+                    // [G33 Errors]: No axis words. K missing or not positive.
+                    // K is the distance travelled along the move per spindle revolution.
+                    if (!axis_words) {
+                        FAIL(Error::GcodeNoAxisWords);  // [No axis words]
+                    }
+                    if (bitnum_is_false(value_words, GCodeWord::K) || gc_block.values.ijk[Z_AXIS] <= 0.0) {
+                        FAIL(Error::GcodeValueWordMissing);  // [K word missing]
+                    }
+                    if (gc_block.modal.units == Units::Inches) {
+                        gc_block.values.ijk[Z_AXIS] *= MM_PER_INCH;
+                    }
+                    clear_bits(value_words, bitnum_to_mask(GCodeWord::K));
+                    break;
                 case Motion::CwArc:
                     clockwiseArc = true;  // No break intentional.
                 case Motion::CcwArc:
@@ -1297,6 +1667,71 @@ Error gc_execute_line(char* line) {
                     }
                     clear_bitnum(value_words, GCodeWord::P);
                     break;
+                case Motion::DrillChipBreak:
+                case Motion::Drill:
+                case Motion::DrillDwell:
+                case Motion::DrillPeck: {
+                    // [G73/G81/G82/G83 Errors]: No axis words. Inverse time feed. Z or R missing at the start of a cycle. Q missing
+                    //   or not positive for a peck cycle. L not positive. R below Z.
+                    // NOTE: Z, R, Q and P carry over to the next blocks of a cycle, so a line of X and Y words drills
+                    // another hole. In G91, R is relative to the starting level and Z to R.
+                    bool  continuing = is_drill_cycle(gc_state.modal.motion);
+                    bool  relative   = gc_block.modal.distance == Distance::Incremental;
+                    float offset     = block_coord_system[axis_linear] + gc_state.coord_offset[axis_linear];
+                    if (axis_linear == TOOL_LENGTH_OFFSET_AXIS) {
+                        offset += gc_state.tool_length_offset;
+                    }
+                    if (!axis_words) {
+                        FAIL(Error::GcodeNoAxisWords);  // [No axis words]
+                    }
+                    if (gc_block.modal.feed_rate == FeedRate::InverseTime) {
+                        FAIL(Error::GcodeUnsupportedCommand);  // [G93 canned cycle]
+                    }
+                    if (bitnum_is_true(axis_words, axis_linear)) {
+                        cycle_z = gc_block.values.xyz[axis_linear] - (relative ? gc_state.position[axis_linear] : offset);
+                    } else if (continuing) {
+                        cycle_z = gc_state.cycle_z;
+                    } else {
+                        FAIL(Error::GcodeValueWordMissing);  // [Z word missing]
+                    }
+                    if (bitnum_is_true(value_words, GCodeWord::R)) {
+                        if (gc_block.modal.units == Units::Inches) {
+                            gc_block.values.r *= MM_PER_INCH;
+                        }
+                    } else if (continuing) {
+                        gc_block.values.r = gc_state.cycle_r;
+                    } else {
+                        FAIL(Error::GcodeValueWordMissing);  // [R word missing]
+                    }
+                    if (bitnum_is_true(value_words, GCodeWord::Q)) {
+                        if (gc_block.modal.units == Units::Inches) {
+                            gc_block.values.q *= MM_PER_INCH;
+                        }
+                    } else {
+                        gc_block.values.q = gc_state.cycle_q;
+                    }
+                    if (bitnum_is_false(value_words, GCodeWord::P)) {
+                        gc_block.values.p = gc_state.cycle_p;
+                    }
+                    if (bitnum_is_false(value_words, GCodeWord::L)) {
+                        gc_block.values.l = 1;
+                    }
+                    bool peck = gc_block.modal.motion == Motion::DrillPeck || gc_block.modal.motion == Motion::DrillChipBreak;
+                    if (peck && gc_block.values.q <= 0.0) {
+                        FAIL(Error::GcodeValueWordMissing);  // [Q word missing]
+                    }
+                    if (gc_block.values.l == 0) {
+                        FAIL(Error::GcodeInvalidTarget);  // [L not positive]
+                    }
+                    cycle_r_level = gc_block.values.r + (relative ? gc_state.position[axis_linear] : offset);
+                    cycle_bottom  = cycle_z + (relative ? cycle_r_level : offset);
+                    if (cycle_bottom > cycle_r_level) {
+                        FAIL(Error::GcodeInvalidTarget);  // [R below Z]
+                    }
+                    clear_bits(value_words,
+                               (bitnum_to_mask(GCodeWord::L) | bitnum_to_mask(GCodeWord::P) | bitnum_to_mask(GCodeWord::Q) |
+                                bitnum_to_mask(GCodeWord::R)));
+                } break;
                 case Motion::ProbeTowardNoError:
                 case Motion::ProbeAwayNoError:
                     probeNoError = true;  // No break intentional.
@@ -1342,7 +1777,8 @@ Error gc_execute_line(char* line) {
     if (axis_command != AxisCommand::None) {
         clear_bits(value_words,
                    (bitnum_to_mask(GCodeWord::X) | bitnum_to_mask(GCodeWord::Y) | bitnum_to_mask(GCodeWord::Z) |
-                    bitnum_to_mask(GCodeWord::A) | bitnum_to_mask(GCodeWord::B) | bitnum_to_mask(GCodeWord::C)));  // Remove axis words.
+                    bitnum_to_mask(GCodeWord::A) | bitnum_to_mask(GCodeWord::B) | bitnum_to_mask(GCodeWord::C) |
+                    bitnum_to_mask(GCodeWord::U) | bitnum_to_mask(GCodeWord::V) | bitnum_to_mask(GCodeWord::W)));  // Remove axis words.
     }
     if (value_words) {
         FAIL(Error::GcodeUnusedWords);  // [Unused words]
@@ -1429,11 +1865,24 @@ Error gc_execute_line(char* line) {
     // [3. Set feed rate ]:
     gc_state.feed_rate = gc_block.values.f;   // Always copy this value. See feed rate error-checking.
     pl_data->feed_rate = gc_state.feed_rate;  // Record data for planner use.
+    if (gc_state.modal.feed_rate == FeedRate::UnitsPerRev) {
+        // The planner works in mm/min at the programmed speed; the stepper follows the measured speed
+        pl_data->feed_rate *= gc_block.values.s;
+        pl_data->motion.spindleSync = 1;
+    }
     // [4. Set spindle speed ]:
     if ((gc_state.spindle_speed != gc_block.values.s) || syncLaser) {
         if (gc_state.modal.spindle != SpindleState::Disable && !laserIsMotion && sys.state != State::CheckMode) {
-            protocol_buffer_synchronize();
-            spindle->setState(gc_state.modal.spindle, disableLaser ? 0 : (uint32_t)gc_block.values.s);
+            uint32_t speed = disableLaser ? 0 : (uint32_t)gc_block.values.s;
+            if (!syncLaser && spindle->segmentSpeed() && plan_get_current_block()) {
+                // The planned moves keep their speed, and the segments of the following
+                // ones set the new one, so the planner does not have to run dry
+                spindleDeferred = true;
+                deferredSpeed   = speed;
+            } else {
+                protocol_buffer_synchronize();
+                spindle->setState(gc_state.modal.spindle, speed);
+            }
             report_ovr_counter = 0;  // Set to report change immediately
         }
         gc_state.spindle_speed = gc_block.values.s;  // Update spindle speed state.
@@ -1447,6 +1896,8 @@ Error gc_execute_line(char* line) {
     // [6. Change tool ]: NOT SUPPORTED
     if (gc_block.modal.tool_change == ToolChange::Enable) {
         user_tool_change(gc_state.tool);
+    } else if (toolSelected && sys.state != State::CheckMode) {
+        user_tool_select(gc_state.tool);
     }
     // [7. Spindle control ]:
     if (gc_state.modal.spindle != gc_block.modal.spindle) {
@@ -1490,8 +1941,7 @@ Error gc_execute_line(char* line) {
                 break;
         }
         if (sys.state != State::CheckMode) {
-            protocol_buffer_synchronize();
-            config->_coolant->set_state(gc_state.modal.coolant);
+            config->_coolant->sync(gc_state.modal.coolant);
             report_ovr_counter = 0;  // Set to report change immediately
         }
     }
@@ -1540,7 +1990,7 @@ Error gc_execute_line(char* line) {
 
     // [10. Dwell ]:
     if (gc_block.non_modal_command == NonModal::Dwell) {
-        mc_dwell(int32_t(gc_block.values.p * 1000.0f));
+        mc_dwell(int32_t(gc_block.values.p * 1000.0f), pl_data);
     }
     // [11. Set active plane ]:
     gc_state.modal.plane_select = gc_block.modal.plane_select;
@@ -1548,18 +1998,20 @@ Error gc_execute_line(char* line) {
     gc_state.modal.units = gc_block.modal.units;
     // [13. Cutter radius compensation ]: G41/42 NOT SUPPORTED
     // gc_state.modal.cutter_comp = gc_block.modal.cutter_comp; // NOTE: Not needed since always disabled.
-    // [14. Cutter length compensation ]: G43.1 and G49 supported. G43 NOT SUPPORTED.
-    // NOTE: If G43 were supported, its operation wouldn't be any different from G43.1 in terms
-    // of execution. The error-checking step would simply load the offset value into the correct
-    // axis of the block XYZ value array.
+    // [14. Cutter length compensation ]: G43, G43.1 and G49 supported.
+    // NOTE: G43 differs from G43.1 only in that the error-checking step loaded the offset value
+    // from the tool table into the correct axis of the block XYZ value array.  The planner holds
+    // machine coordinates, so a new offset only moves the following targets, without a sync.
     if (axis_command == AxisCommand::ToolLengthOffset) {  // Indicates a change.
         gc_state.modal.tool_length = gc_block.modal.tool_length;
         if (gc_state.modal.tool_length == ToolLengthOffset::Cancel) {  // G49
             gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS] = 0.0;
         }
-        // else G43.1
+        // else G43 or G43.1
+        gc_state.tlo_tool = tlo_tool;
         if (gc_state.tool_length_offset != gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS]) {
             gc_state.tool_length_offset = gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS];
+            allChannels.notifyWco();
         }
     }
     // [15. Coordinate system selection ]:
@@ -1568,14 +2020,35 @@ Error gc_execute_line(char* line) {
         copyAxes(gc_state.coord_system, block_coord_system);
         gc_wco_changed();
     }
-    // [16. Set path control mode ]: G61.1/G64 NOT SUPPORTED
-    // gc_state.modal.control = gc_block.modal.control; // NOTE: Always default.
+    // [16. Set path control mode ]: G61.1 NOT SUPPORTED
+    gc_state.modal.control = gc_block.modal.control;
+    if (bitnum_is_true(command_words, ModalGroup::MG13) && gc_state.modal.control == ControlMode::Blend) {
+        gc_state.path_tolerance  = gc_block.values.p;
+        gc_state.merge_tolerance = gc_block.values.q;
+    }
+    if (gc_state.modal.control == ControlMode::Blend) {
+        pl_data->path_tolerance  = gc_state.path_tolerance;
+        pl_data->merge_tolerance = gc_state.merge_tolerance;
+    } else {
+        pl_data->merge_tolerance = config->_mergeTolerance;
+    }
     // [17. Set distance mode ]:
     gc_state.modal.distance = gc_block.modal.distance;
     // [18. Set retract mode ]: NOT SUPPORTED
     // [19. Go to predefined position, Set G10, or Set axis offsets ]:
     switch (gc_block.non_modal_command) {
         case NonModal::SetCoordinateData:
+            if (gc_block.values.l == 1 || gc_block.values.l == 10) {
+                ToolTable::set_length(table_tool, table_length);
+                // A new length for the tool in effect applies to the following moves, without a sync
+                if (gc_state.modal.tool_length == ToolLengthOffset::Enable && gc_state.tlo_tool == table_tool &&
+                    gc_state.tool_length_offset != table_length) {
+                    gc_state.tool_length_offset = table_length;
+                    gc_ngc_changed(CoordIndex::TLO);
+                    allChannels.notifyWco();
+                }
+                break;
+            }
             coords[coord_select]->set(coord_data);
             // Update system coordinate system if currently active.
             if (gc_state.modal.coord_select == coord_select) {
@@ -1624,6 +2097,12 @@ Error gc_execute_line(char* line) {
             GCUpdatePos gc_update_pos = GCUpdatePos::Target;
             if (gc_state.modal.motion == Motion::Linear) {
                 mc_linear(gc_block.values.xyz, pl_data, gc_state.position);
+            } else if (gc_state.modal.motion == Motion::SpindleSync) {
+                // The pitch sets the feed, so overrides would cut the wrong thread
+                pl_data->feed_rate             = gc_block.values.ijk[Z_AXIS] * gc_block.values.s;
+                pl_data->motion.spindleSync    = 1;
+                pl_data->motion.noFeedOverride = 1;
+                mc_spindle_sync(gc_block.values.xyz, pl_data, gc_state.position);
             } else if (gc_state.modal.motion == Motion::Seek) {
                 pl_data->motion.rapidMotion = 1;  // Set rapid motion flag.
                 mc_linear(gc_block.values.xyz, pl_data, gc_state.position);
@@ -1638,6 +2117,13 @@ Error gc_execute_line(char* line) {
                        axis_linear,
                        clockwiseArc,
                        int(gc_block.values.p));
+            } else if (is_drill_cycle(gc_state.modal.motion)) {
+                gc_state.cycle_r = gc_block.values.r;
+                gc_state.cycle_z = cycle_z;
+                gc_state.cycle_q = gc_block.values.q;
+                gc_state.cycle_p = gc_block.values.p;
+                drill_holes(gc_block, axis_linear, cycle_r_level, cycle_bottom, pl_data);
+                gc_update_pos = GCUpdatePos::None;  // drill_holes() keeps the position
             } else {
                 // NOTE: gc_block.values.xyz is returned from mc_probe_cycle with the updated position value. So
                 // upon a successful probing cycle, the machine position and the returned value should be the same.
@@ -1748,7 +2234,7 @@ Error gc_execute_line(char* line) {
    group 4 = {M1} (Optional stop, ignored)
    group 6 = {M6} (Tool change)
    group 7 = {G41, G42} cutter radius compensation (G40 is supported)
-   group 8 = {G43} tool length offset (G43.1/G49 are supported)
+   group 8 = {G43, G43.1, G49} tool length offset
    group 8 = {M7*} enable mist coolant (* Compile-option)
    group 9 = {M48, M49} enable/disable feed and speed override switches
    group 10 = {G98, G99} return mode canned cycles
@@ -1761,10 +2247,10 @@ void WEAK_LINK user_m30() {
     StartURLCalled = 0;
 
     if (s != "")
-        CallURLWithRetryStrategy(s);
+        WebHook::post(s);
 
-    nb_work_done++;
-    String l = "Work done : " + String(nb_work_done) + "      ($RW to raz)";
+    JobStats::job_done();
+    String l = "Work done : " + String(JobStats::jobs()) + "      ($RW to raz)";
     log_info(l.c_str());
 }
 
@@ -1774,7 +2260,7 @@ void WEAK_LINK user_m100() {
 
     if ((s != "") && (StartWitM100)) {
         StartURLCalled = 1;
-        CallURLWithRetryStrategy(s);
+        WebHook::post(s);
     }
 }
 
@@ -1782,3 +2268,8 @@ void WEAK_LINK user_tool_change(uint32_t new_tool) {
     Spindles::Spindle::switchSpindle(new_tool, config->_spindles, spindle);
     report_ovr_counter = 0;  // Set to report change immediately
 }
+
+// T without M6 selects the next tool, so its spindle can be started ahead of the change
+void WEAK_LINK user_tool_select(uint32_t new_tool) {
+    Spindles::Spindle::prestartSpindle(new_tool, config->_spindles, spindle);
+}
@@ -26,22 +26,23 @@ enum class Override : uint8_t {
 
 enum class ModalGroup : uint8_t {
     MG0  = 0,   // [G4,G10,G28,G28.1,G30,G30.1,G53,G92,G92.1] Non-modal
-    MG1  = 1,   // [G0,G1,G2,G3,G38.2,G38.3,G38.4,G38.5,G80] Motion
+    MG1  = 1,   // [G0,G1,G2,G3,G38.2,G38.3,G38.4,G38.5,G73,G80,G81,G82,G83] Motion
     MG2  = 2,   // [G17,G18,G19] Plane selection
     MG3  = 3,   // [G90,G91] Distance mode
     MG4  = 4,   // [G91.1] Arc IJK distance mode
     MG5  = 5,   // [G93,G94] Feed rate mode
     MG6  = 6,   // [G20,G21] Units
     MG7  = 7,   // [G40] Cutter radius compensation mode. G41/42 NOT SUPPORTED.
-    MG8  = 8,   // [G43.1,G49] Tool length offset
+    MG8  = 8,   // [G43,G43.1,G49] Tool length offset
     MG12 = 9,   // [G54,G55,G56,G57,G58,G59] Coordinate system selection
-    MG13 = 10,  // [G61] Control mode
+    MG13 = 10,  // [G61,G64] Control mode
     MM4  = 11,  // [M0,M1,M2,M30] Stopping
     MM6  = 14,  // [M6] Tool change
     MM7  = 12,  // [M3,M4,M5] Spindle turning
     MM8  = 13,  // [M7,M8,M9] Coolant control
     MM9  = 14,  // [M56] Override control
     MM10 = 15,  // [M62, M63, M64, M65, M67, M68] User Defined http://linuxcnc.org/docs/html/gcode/overview.html#_modal_groups
+    MG10 = 16,  // [G98,G99] Canned cycle return mode
 };
 
 // Command actions for within execution-type modal groups (motion, stopping, non-modal). Used
@@ -72,6 +73,11 @@ enum class Motion : uint8_t {
     Linear             = 1,    // G1 (Do not alter value)
     CwArc              = 2,    // G2 (Do not alter value)
     CcwArc             = 3,    // G3 (Do not alter value)
+    SpindleSync        = 33,   // G33 (Do not alter value)
+    DrillChipBreak     = 73,   // G73 (Do not alter value)
+    Drill              = 81,   // G81 (Do not alter value)
+    DrillDwell         = 82,   // G82 (Do not alter value)
+    DrillPeck          = 83,   // G83 (Do not alter value)
     ProbeToward        = 140,  // G38.2 (Do not alter value)
     ProbeTowardNoError = 141,  // G38.3 (Do not alter value)
     ProbeAway          = 142,  // G38.4 (Do not alter value)
@@ -98,6 +104,12 @@ enum class ArcDistance : uint8_t {
     Absolute    = 1,
 };
 
+// Modal Group G10: Canned cycle return mode
+enum class RetractMode : uint8_t {
+    OldZ   = 0,  // G98 (Default: Must be zero)
+    RPlane = 1,  // G99 (Do not alter value)
+};
+
 // Modal Group M4: Program flow
 enum class ProgramFlow : uint8_t {
     Running      = 0,    // (Default: Must be zero)
@@ -112,6 +124,7 @@ enum class ProgramFlow : uint8_t {
 enum class FeedRate : uint8_t {
     UnitsPerMin = 0,  // G94 (Default: Must be zero)
     InverseTime = 1,  // G93 (Do not alter value)
+    UnitsPerRev = 2,  // G95 (Do not alter value)
 };
 
 // Modal Group G6: Units mode
@@ -129,6 +142,7 @@ enum class CutterCompensation : uint8_t {
 // Modal Group G13: Control mode
 enum class ControlMode : uint8_t {
     ExactPath = 0,  // G61 (Default: Must be zero)
+    Blend     = 1,  // G64
 };
 
 // GCodeCoolant is used by the parser, where at most one of
@@ -168,6 +182,7 @@ static const int MaxUserAnalogPin  = 4;
 enum class ToolLengthOffset : uint8_t {
     Cancel        = 0,  // G49 (Default: Must be zero)
     EnableDynamic = 1,  // G43.1
+    Enable        = 2,  // G43, from the tool table
 };
 
 static const uint32_t MaxToolNumber = 99999999;
@@ -200,6 +215,10 @@ enum class GCodeWord : uint8_t {
     A = 15,
     B = 16,
     C = 17,
+    U = 18,
+    V = 19,
+    W = 20,
+    H = 21,
 };
 
 // GCode parser position updating flags
@@ -244,26 +263,28 @@ struct gc_modal_t {
     // ArcDistance distance_arc; // {G91.1} NOTE: Don't track. Only default supported.
     Plane plane_select;  // {G17,G18,G19}
     // CutterCompensation cutter_comp;  // {G40} NOTE: Don't track. Only default supported.
-    ToolLengthOffset tool_length;   // {G43.1,G49}
+    ToolLengthOffset tool_length;   // {G43,G43.1,G49}
     CoordIndex       coord_select;  // {G54,G55,G56,G57,G58,G59}
-    // uint8_t control;      // {G61} NOTE: Don't track. Only default supported.
-    ProgramFlow  program_flow;  // {M0,M1,M2,M30}
-    CoolantState coolant;       // {M7,M8,M9}
-    SpindleState spindle;       // {M3,M4,M5}
-    ToolChange   tool_change;   // {M6}
-    IoControl    io_control;    // {M62, M63, M67}
-    Override     override;      // {M56}
+    RetractMode      retract;       // {G98,G99}
+    ControlMode      control;       // {G61,G64}
+    ProgramFlow      program_flow;  // {M0,M1,M2,M30}
+    CoolantState     coolant;       // {M7,M8,M9}
+    SpindleState     spindle;       // {M3,M4,M5}
+    ToolChange       tool_change;   // {M6}
+    IoControl        io_control;    // {M62, M63, M67}
+    Override         override;      // {M56}
 };
 
 struct gc_values_t {
     uint8_t  e;                // M67
     float    f;                // Feed
+    uint32_t h;                // G43 tool number
     float    ijk[3];           // I,J,K Axis arc offsets - only 3 are possible
     uint8_t  l;                // G10 or canned cycles parameters
     int32_t  n;                // Line number
     float    p;                // G10 or dwell parameters
-    float    q;                // M67
-    float    r;                // Arc radius
+    float    q;                // M67 or peck depth
+    float    r;                // Arc radius or canned cycle R level
     float    s;                // Spindle speed
     uint32_t t;                // Tool selection
     float    xyz[MAX_N_AXIS];  // X,Y,Z Translational axes
@@ -283,7 +304,18 @@ struct parser_state_t {
     // position in mm. Loaded from non-volatile storage when called.
     float coord_offset[MAX_N_AXIS];  // Retains the G92 coordinate offset (work coordinates) relative to
     // machine zero in mm. Non-persistent. Cleared upon reset and boot.
-    float tool_length_offset;  // Tracks tool length offset value when enabled.
+    float    tool_length_offset;  // Tracks tool length offset value when enabled.
+    uint32_t tlo_tool;            // The tool whose table length G43 applied, while it is in effect
+
+    // The canned cycle words that carry over to the following blocks of a cycle, in mm or
+    // seconds, and relative as programmed in G91
+    float cycle_r;  // R level
+    float cycle_z;  // Bottom of the hole
+    float cycle_q;  // Peck depth
+    float cycle_p;  // Dwell at the bottom
+
+    float path_tolerance;   // G64 P, mm
+    float merge_tolerance;  // G64 Q, mm
 };
 
 extern parser_state_t gc_state;
@@ -308,9 +340,33 @@ void gc_init();
 // Execute one block of rs275/ngc/g-code
 Error gc_execute_line(char* line);
 
+// Edits a line in place, removing whitespace and comments and converting to upper case
+void collapseGCode(char* line);
+
+// A compiled line holds the words of a block already split and converted, so that
+// executing it again skips the text processing.  It starts with compiledLineMarker,
+// then a word count, then for each word its letter and its float value.
+const char   compiledLineMarker = '\x01';
+const size_t compiledWordSize   = 1 + sizeof(float);
+const size_t maxCompiledWords   = 50;
+const size_t maxCompiledLength  = 2 + maxCompiledWords * compiledWordSize;
+
+// Compiles a line into out, which must hold maxCompiledLength bytes, and returns its
+// length.  Returns 0 if the line must be kept as text, because it is not plain g-code,
+// has comments, or does not parse.
+size_t gc_compile_line(const char* line, char* out);
+
+// Execute a compiled line, with the same result as for the line it came from
+Error gc_execute_compiled(const char* compiled);
+
 // Set g-code parser position. Input in steps.
 void gc_sync_position();
 
+// Sets the spindle to an S word that was left to the step segments, once the planner
+// has emptied, in case no move came after it to carry it
+void gc_sync_spindle();
+
 void user_tool_change(uint32_t new_tool);
+void user_tool_select(uint32_t new_tool);
 void user_m30();
 void user_m100();
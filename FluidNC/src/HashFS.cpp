@@ -1,28 +1,49 @@
 #include "HashFS.h"
 #include "FileStream.h"
+#include "FileCache.h"
+#include "Config.h"  // HASH_TASK_*
 
 #include <mbedtls/md.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sys/stat.h>
+#include <memory>
+#include <mutex>
+#include <cstdio>
+#include <cstdlib>
 
-std::map<std::string, std::string> HashFS::localFsHashes;
+// The index has a line for each hashed file: name, size, modification time and hash,
+// separated by tabs.  A saved hash is only used while the size and time still match,
+// so files changed behind its back are hashed again.
+static const char* indexName = ".hashes";
+
+static const size_t hashBufferSize = 4096;
+
+std::map<std::string, HashFS::Entry> HashFS::_entries;
+std::string                          HashFS::_dir;
+bool                                 HashFS::_dirty = false;
+
+// The web server, the main loop and the hash task all use the entries
+static std::mutex   hashMutex;
+static TaskHandle_t hashTaskHandle = nullptr;
 
 static char hexNibble(int i) {
     return "0123456789ABCDEF"[i & 0xf];
 }
 
-static Error hashFile(const std::filesystem::path& ipath, std::string& str) {  // No ESP command
+static Error hashFile(const std::filesystem::path& ipath, std::string& str, uint8_t* buf) {  // No ESP command
     mbedtls_md_context_t ctx;
 
     uint8_t shaResult[32];
 
     try {
         FileStream inFile { ipath, "r" };
-        uint8_t    buf[512];
         size_t     len;
 
         mbedtls_md_init(&ctx);
         mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
         mbedtls_md_starts(&ctx);
-        while ((len = inFile.read(buf, 512)) > 0) {
+        while ((len = inFile.read(buf, hashBufferSize)) > 0) {
             mbedtls_md_update(&ctx, buf, len);
         }
         mbedtls_md_finish(&ctx, shaResult);
@@ -47,8 +68,32 @@ void HashFS::report_change() {
     log_msg("Files changed");
 }
 
+bool HashFS::stat_file(const std::string& name, Entry& entry) {
+    struct stat st;
+    if (_dir.empty() || stat((_dir + "/" + name).c_str(), &st) || S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    entry.size  = st.st_size;
+    entry.mtime = st.st_mtime;
+    entry.hash.clear();
+    return true;
+}
+
+void HashFS::wake() {
+    if (hashTaskHandle) {
+        xTaskNotifyGive(hashTaskHandle);
+    }
+}
+
 void HashFS::delete_file(const std::filesystem::path& path, bool report) {
-    localFsHashes.erase(path.filename());
+    FileCache::forget(path);
+    {
+        std::lock_guard<std::mutex> lock(hashMutex);
+        if (_entries.erase(path.filename())) {
+            _dirty = true;
+        }
+    }
+    wake();
     if (report) {
         report_change();
     }
@@ -62,22 +107,27 @@ bool HashFS::file_is_hashed(const std::filesystem::path& path) {
     // The first component is "/", then e.g. "littlefs", then
     // the filename.  If there are more components, there is
     // a subdirectory and we do not hash it.
-    if (count != 3) {
+    if (count != 3 || path.filename() == indexName) {
         return false;
     }
     auto fsname = *++path.begin();
     return fsname == "littlefs" || fsname == "spiffs" || fsname == "localfs";
 }
 
+// The file is hashed again by the task
 void HashFS::rehash_file(const std::filesystem::path& path, bool report) {
+    FileCache::forget(path);
     if (file_is_hashed(path)) {
-        std::string hash;
-        if (hashFile(path, hash) != Error::Ok) {
-            delete_file(path, false);
+        std::lock_guard<std::mutex> lock(hashMutex);
+        Entry                       entry;
+        if (stat_file(path.filename(), entry)) {
+            _entries[path.filename()] = entry;
         } else {
-            localFsHashes[path.filename()] = hash;
+            _entries.erase(path.filename());
         }
+        _dirty = true;
     }
+    wake();
     if (report) {
         report_change();
     }
@@ -87,33 +137,183 @@ void HashFS::rename_file(const std::filesystem::path& ipath, const std::filesyst
     rehash_file(opath, report);
 }
 
-void HashFS::hash_all() {
-    localFsHashes.clear();
+void HashFS::load_index(std::map<std::string, Entry>& saved) {
+    try {
+        FileStream  file(_dir + "/" + indexName, "r");
+        size_t      size = file.size();
+        std::string text(size, '\0');
+        text.resize(file.read(&text[0], size));
+
+        size_t pos = 0;
+        while (pos < text.length()) {
+            size_t      eol  = text.find('\n', pos);
+            std::string line = text.substr(pos, eol == std::string::npos ? std::string::npos : eol - pos);
+            pos              = eol == std::string::npos ? text.length() : eol + 1;
+
+            size_t t1 = line.find('\t');
+            size_t t2 = t1 == std::string::npos ? t1 : line.find('\t', t1 + 1);
+            size_t t3 = t2 == std::string::npos ? t2 : line.find('\t', t2 + 1);
+            if (t3 == std::string::npos) {
+                continue;
+            }
+            Entry entry;
+            entry.size  = strtoul(line.c_str() + t1 + 1, nullptr, 10);
+            entry.mtime = strtoll(line.c_str() + t2 + 1, nullptr, 10);
+            entry.hash  = line.substr(t3 + 1);
+
+            saved[line.substr(0, t1)] = entry;
+        }
+    } catch (const Error err) {
+        // No index yet, so everything is hashed
+    }
+}
 
+void HashFS::save_index() {
+    std::string text;
+    for (const auto& [name, entry] : _entries) {
+        if (entry.hash.length()) {
+            char numbers[48];
+            snprintf(numbers, sizeof(numbers), "\t%u\t%lld\t", unsigned(entry.size), (long long)entry.mtime);
+            text += name;
+            text += numbers;
+            text += entry.hash;
+            text += '\n';
+        }
+    }
+    try {
+        FileStream file(_dir + "/" + indexName, "w");
+        file.write((const uint8_t*)text.c_str(), text.length());
+    } catch (const Error err) {
+        log_debug("Cannot write " << indexName);
+    }
+}
+
+// Hashes one file at a time, without holding the lock while it reads the file.  A file
+// that changes meanwhile has a new entry by the time the hash is ready, so the stale
+// hash is dropped and its new contents hashed on the next pass.
+void HashFS::hashTask(void* arg) {
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[hashBufferSize]);
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (true) {
+            std::string name;
+            Entry       pending;
+            std::string dir;
+            {
+                std::lock_guard<std::mutex> lock(hashMutex);
+                for (const auto& [n, entry] : _entries) {
+                    if (entry.hash.empty()) {
+                        name    = n;
+                        pending = entry;
+                        break;
+                    }
+                }
+                if (name.empty()) {
+                    if (_dirty) {
+                        save_index();
+                        _dirty = false;
+                    }
+                    break;
+                }
+                dir = _dir;
+            }
+
+            std::string hash;
+            Error       err = hashFile(dir + "/" + name, hash, buf.get());
+
+            std::lock_guard<std::mutex> lock(hashMutex);
+            auto                        it = _entries.find(name);
+            if (it != _entries.end() && it->second.size == pending.size && it->second.mtime == pending.mtime && it->second.hash.empty()) {
+                if (err == Error::Ok) {
+                    it->second.hash = hash;
+                } else {
+                    _entries.erase(it);
+                }
+                _dirty = true;
+            }
+        }
+    }
+}
+
+// Finds the files and takes the hashes that are still good from the index.  The task
+// hashes the rest.
+void HashFS::hash_all() {
     std::error_code ec;
     FluidPath       lfspath { "", localfsName, ec };
     if (ec) {
         return;
     }
 
+    std::map<std::string, Entry> saved;
+    std::map<std::string, Entry> found;
+    bool                         changed = false;
+
+    std::lock_guard<std::mutex> lock(hashMutex);
+    _dir = lfspath.string();
+    while (_dir.length() > 1 && _dir.back() == '/') {
+        _dir.pop_back();
+    }
+    load_index(saved);
+
     auto iter = stdfs::directory_iterator { lfspath, ec };
     if (ec) {
         log_error(lfspath << " " << ec.message());
         return;
     }
     for (auto const& dir_entry : iter) {
-        if (!dir_entry.is_directory()) {
-            rehash_file(dir_entry, false);
+        std::string name = dir_entry.path().filename();
+        Entry       entry;
+        if (name == indexName || !stat_file(name, entry)) {
+            continue;
+        }
+        auto it = saved.find(name);
+        if (it != saved.end() && it->second.size == entry.size && it->second.mtime == entry.mtime) {
+            entry.hash = it->second.hash;
+        } else {
+            changed = true;
         }
+        found[name] = entry;
     }
+    _entries = std::move(found);
+    _dirty   = changed || _entries.size() != saved.size();
+
+    if (!hashTaskHandle) {
+        xTaskCreatePinnedToCore(hashTask,            // task
+                                "hashfs",            // name for task
+                                4096,                // size of task stack
+                                nullptr,             // parameters
+                                HASH_TASK_PRIORITY,  // priority
+                                &hashTaskHandle,     // task handle
+                                HASH_TASK_CORE       // core
+        );
+    }
+    wake();
 }
+
 std::string HashFS::hash(const std::filesystem::path& path) {
-    if (file_is_hashed(path)) {
-        std::map<std::string, std::string>::iterator it;
-        it = localFsHashes.find(path.filename());
-        if (it != localFsHashes.end()) {
-            return it->second;
+    if (!file_is_hashed(path)) {
+        return std::string();
+    }
+    std::lock_guard<std::mutex> lock(hashMutex);
+    auto                        it = _entries.find(path.filename());
+    if (it != _entries.end()) {
+        if (it->second.hash.empty()) {
+            wake();
         }
+        return it->second.hash;
+    }
+    // A file that has not been seen, perhaps written by something that did not rehash it
+    Entry entry;
+    if (stat_file(path.filename(), entry)) {
+        _entries[path.filename()] = entry;
+        wake();
     }
     return std::string();
 }
+
+void HashFS::show(Channel& out) {
+    std::lock_guard<std::mutex> lock(hashMutex);
+    for (const auto& [name, entry] : _entries) {
+        log_info_to(out, name << ": " << (entry.hash.length() ? entry.hash : "(pending)"));
+    }
+}
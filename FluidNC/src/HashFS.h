@@ -2,11 +2,16 @@
 #include <string>
 #include <map>
 #include <filesystem>
+#include <ctime>
 
+class Channel;
+
+// SHA-256 hashes of the files in the top directory of the local filesystem, which the
+// web server uses as ETags.  They are kept in an index file there, so that only new and
+// changed files are hashed again, and the hashing is done by a low-priority task that
+// is woken when a file changes or a hash is asked for before it is ready.
 class HashFS {
 public:
-    static std::map<std::string, std::string> localFsHashes;
-
     static bool file_is_hashed(const std::filesystem::path& path);
     static void delete_file(const std::filesystem::path& path, bool report = true);
     static void rehash_file(const std::filesystem::path& path, bool report = true);
@@ -14,7 +19,25 @@ public:
     static void hash_all();
     static void report_change();
 
+    // The quoted hash of the file, or an empty string if it is not hashed yet
     static std::string hash(const std::filesystem::path& path);
 
+    static void show(Channel& out);
+
 private:
+    struct Entry {
+        size_t      size  = 0;
+        time_t      mtime = 0;
+        std::string hash;  // Empty until the task has hashed the file
+    };
+
+    static std::map<std::string, Entry> _entries;
+    static std::string                  _dir;    // Where the hashed files are
+    static bool                         _dirty;  // The index file is out of date
+
+    static bool stat_file(const std::string& name, Entry& entry);
+    static void wake();
+    static void hashTask(void* arg);
+    static void load_index(std::map<std::string, Entry>& saved);
+    static void save_index();
 };
@@ -0,0 +1,184 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "HeapProfile.h"
+
+#ifdef DEBUG_HEAP_PROFILE
+
+#    include "Config.h"  // log_*, to_hex()
+
+#    include <freertos/FreeRTOS.h>
+#    include <freertos/task.h>  // portMUX_TYPE
+#    include <esp_timer.h>      // esp_timer_get_time()
+#    include <algorithm>
+#    include <cstdint>
+#    include <cstdlib>
+#    include <new>
+
+namespace HeapProfile {
+    const int depth  = 3;
+    const int nSites = 128;
+
+    struct Site {
+        void*    callers[depth];
+        uint32_t count;
+        uint32_t bytes;
+        uint32_t liveBytes;
+    };
+
+    // Before each allocation, so that delete finds its site and size
+    struct Header {
+        uint16_t site;
+        uint16_t unused;
+        uint32_t size;
+    };
+    const uint16_t noSite = 0xffff;
+
+    static Site         sites[nSites];
+    static uint32_t     unattributed = 0;  // Allocations made when every site was taken
+    static int64_t      since        = 0;
+    static portMUX_TYPE lock         = portMUX_INITIALIZER_UNLOCKED;
+
+    static uint16_t record(void* const* callers, uint32_t size) {
+        uint32_t hash = 0;
+        for (int i = 0; i < depth; i++) {
+            hash = hash * 31 + (uint32_t(callers[i]) >> 2);
+        }
+        portENTER_CRITICAL(&lock);
+        for (int probe = 0; probe < nSites; probe++) {
+            uint16_t index = (hash + probe) % nSites;
+            Site&    site  = sites[index];
+            if (site.callers[0] == nullptr) {  // Free; no real site has a null caller
+                std::copy(callers, callers + depth, site.callers);
+            } else if (!std::equal(callers, callers + depth, site.callers)) {
+                continue;
+            }
+            site.count++;
+            site.bytes += size;
+            site.liveBytes += size;
+            portEXIT_CRITICAL(&lock);
+            return index;
+        }
+        unattributed++;
+        portEXIT_CRITICAL(&lock);
+        return noSite;
+    }
+
+    static void* allocate(size_t size, void* const* callers) {
+        Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if (!header) {
+            return nullptr;
+        }
+        header->size = size;
+        header->site = record(callers, size);
+        return header + 1;
+    }
+
+    static void release(void* p) {
+        if (!p) {
+            return;
+        }
+        Header* header = static_cast<Header*>(p) - 1;
+        if (header->site != noSite) {
+            portENTER_CRITICAL(&lock);
+            sites[header->site].liveBytes -= header->size;
+            portEXIT_CRITICAL(&lock);
+        }
+        free(header);
+    }
+
+    void reset() {
+        portENTER_CRITICAL(&lock);
+        for (auto& site : sites) {
+            site.count = 0;
+            site.bytes = 0;
+        }
+        unattributed = 0;
+        portEXIT_CRITICAL(&lock);
+        since = esp_timer_get_time();
+    }
+
+    // The return addresses carry the window size in their top bits
+    static uint32_t pc(void* address) {
+        return (uint32_t(address) & 0x3fffffff) | 0x40000000;
+    }
+
+    void report(Channel& out, size_t nTop) {
+        // A copy, since writing the report allocates.  Commands run in one task, so it can be static.
+        static Site copy[nSites];
+        portENTER_CRITICAL(&lock);
+        std::copy(sites, sites + nSites, copy);
+        uint32_t lost = unattributed;
+        portEXIT_CRITICAL(&lock);
+
+        Site* end = std::remove_if(copy, copy + nSites, [](const Site& site) { return site.callers[0] == nullptr; });
+        std::sort(copy, end, [](const Site& a, const Site& b) { return a.bytes > b.bytes; });
+
+        float seconds = (esp_timer_get_time() - since) / 1e6f;
+        log_info_to(out,
+                    "Heap profile: " << int(end - copy) << " sites, " << lost << " allocations unattributed, over " << seconds << " s");
+        for (Site* site = copy; site < end && size_t(site - copy) < nTop; site++) {
+            LogStream line(out, MsgLevelInfo, "[MSG:INFO: ");
+            line << site->bytes << " bytes " << site->count << " allocs " << site->count / seconds << "/s "
+                 << uint32_t(site->bytes / seconds) << " bytes/s live " << site->liveBytes << " at";
+            for (int i = 0; i < depth && site->callers[i]; i++) {
+                line << " " << to_hex(pc(site->callers[i]));
+            }
+        }  // The destructor sends the line
+    }
+}
+
+using HeapProfile::allocate;
+using HeapProfile::release;
+
+// Each operator takes its own return addresses, so the site is where the new was
+#    define CALLERS                                                                                                                        \
+        void* callers[HeapProfile::depth] = { __builtin_return_address(0), __builtin_return_address(1), __builtin_return_address(2) }
+
+void* operator new(size_t size) {
+    CALLERS;
+    void* p = allocate(size, callers);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    CALLERS;
+    void* p = allocate(size, callers);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    CALLERS;
+    return allocate(size, callers);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    CALLERS;
+    return allocate(size, callers);
+}
+
+void operator delete(void* p) noexcept {
+    release(p);
+}
+void operator delete[](void* p) noexcept {
+    release(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    release(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    release(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    release(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    release(p);
+}
+
+#endif
@@ -0,0 +1,37 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  HeapProfile.h - counts the allocations made with operator new by the code that made them
+
+  Built with -DDEBUG_HEAP_PROFILE, as the debug_heap environment does, the global
+  operator new and delete are replaced by ones that keep, for each call site, the
+  number of allocations, the bytes allocated and the bytes still allocated.  A site is
+  the innermost three return addresses of the new, so that the caller of the string,
+  stream or vector that allocated is in it, and $Heap/Top lists the sites that
+  allocated the most, with their rates since $Heap/Top=reset:
+
+    [MSG:INFO: 81234 bytes 2011 allocs 40.2/s 1624 bytes/s live 0 at 0x400e1a2c 0x400d91f3 0x400d8b10]
+
+  The monitor's exception decoder, or xtensa-esp32-elf-addr2line -pfiaC -e firmware.elf,
+  turns the addresses into functions and lines.  Each allocation costs a header of 8
+  bytes and a short spinlock.  Memory from malloc() directly, as in the network stack,
+  is not counted.
+*/
+
+#ifdef DEBUG_HEAP_PROFILE
+
+#    include <cstddef>
+
+class Channel;
+
+namespace HeapProfile {
+    // Lists the nTop sites that allocated the most bytes since the last reset
+    void report(Channel& out, size_t nTop);
+
+    // Starts the counts and the rates again; the live bytes are kept
+    void reset();
+}
+
+#endif
@@ -0,0 +1,321 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "HeightMap.h"
+
+#include "Machine/MachineConfig.h"  // config
+#include "MotionControl.h"          // mc_linear(), mc_probe_cycle()
+#include "GCode.h"                  // gc_state, gc_sync_position()
+#include "System.h"                 // sys, probe_mpos()
+#include "Channel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void HeightMap::group(Configuration::HandlerBase& handler) {
+    handler.item("probe_feed_mm_per_min", _probeFeed, 1.0, 10000.0);
+    handler.item("probe_depth_mm", _probeDepth, 0.1, 100.0);
+    handler.item("clearance_mm", _clearance, 0.1, 100.0);
+    handler.item("tolerance_mm", _tolerance, 0.0001, 1.0);
+}
+
+void HeightMap::clear() {
+    _z.clear();
+    _nx = _ny = 0;
+}
+
+Error HeightMap::enable(bool on) {
+    if (on && _z.empty()) {
+        log_error("No height map has been probed");
+        return Error::InvalidStatement;
+    }
+    _enabled = on;
+    return Error::Ok;
+}
+
+void HeightMap::show(Channel& out) {
+    if (_z.empty()) {
+        log_info_to(out, "No height map");
+        return;
+    }
+    log_info_to(out,
+                "Height map " << _nx << "x" << _ny << " from MPos X:" << _x0 << " Y:" << _y0 << " step X:" << _dx << " Y:" << _dy
+                              << (_enabled ? " enabled" : " disabled"));
+    for (int iy = 0; iy < _ny; iy++) {
+        std::string row;
+        for (int ix = 0; ix < _nx; ix++) {
+            row += ' ';
+            row += std::to_string(at(ix, iy));
+        }
+        log_info_to(out, "  Y" << (_y0 + iy * _dy) << ":" << row);
+    }
+}
+
+// Probing the map is done with the parser position kept up to date, as G-code would, so
+// that the next G-code move starts from where the probing left the tool
+static bool move_to(float* target, plan_line_data_t* pl_data) {
+    if (!mc_linear(target, pl_data, gc_state.position)) {
+        return false;
+    }
+    copyAxes(gc_state.position, target);
+    return !sys.abort;
+}
+
+// Lifts to the travel height, crosses to the point there and probes down from it.  The lift
+// and traverse are queued together, so they blend, and the probe cycle only waits for them
+// to finish before it starts.
+bool HeightMap::probe_point(float x, float y, float travel, float bottom, float& z) {
+    float target[MAX_N_AXIS];
+    copyAxes(target, gc_state.position);
+
+    plan_line_data_t pl_data      = {};
+    pl_data.motion.rapidMotion    = 1;
+    pl_data.motion.noCompensation = 1;
+    if (target[Z_AXIS] < travel) {
+        target[Z_AXIS] = travel;
+        if (!move_to(target, &pl_data)) {
+            return false;
+        }
+    }
+    target[X_AXIS] = x;
+    target[Y_AXIS] = y;
+    if (!move_to(target, &pl_data)) {
+        return false;
+    }
+
+    pl_data.motion.rapidMotion = 0;
+    pl_data.feed_rate          = _probeFeed;
+    target[Z_AXIS]             = bottom;
+    mc_probe_cycle(target, &pl_data, false, false, 0, __FLT_MAX__);
+    gc_sync_position();  // The probe stops short of the target
+    if (!probe_succeeded || sys.abort) {
+        return false;
+    }
+    float contact[MAX_N_AXIS];
+    probe_mpos(contact);
+    z = contact[Z_AXIS];
+    return true;
+}
+
+Error HeightMap::probe(const char* value, Channel& out) {
+    if (sys.state != State::Idle) {
+        return Error::IdleError;
+    }
+    if (!config->_probe->exists()) {
+        log_error_to(out, "Probe pin is not configured");
+        return Error::InvalidStatement;
+    }
+    if (!value) {
+        return Error::InvalidStatement;
+    }
+
+    float       v[6];
+    const char* p = value;
+    for (int i = 0; i < 6; i++) {
+        char* end;
+        v[i] = strtof(p, &end);
+        if (end == p) {
+            return Error::BadNumberFormat;
+        }
+        p = end;
+        if (i < 5 && *p++ != ',') {
+            return Error::InvalidStatement;
+        }
+    }
+    if (*p) {
+        return Error::InvalidStatement;
+    }
+    int nx = int(v[4]);
+    int ny = int(v[5]);
+    if (nx != v[4] || ny != v[5] || nx < 2 || ny < 2 || nx > maxPoints || ny > maxPoints || v[0] == v[2] || v[1] == v[3]) {
+        return Error::NumberRange;
+    }
+
+    // From the current work coordinates to machine coordinates
+    float x0 = v[0] + gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS];
+    float y0 = v[1] + gc_state.coord_system[Y_AXIS] + gc_state.coord_offset[Y_AXIS];
+    float dx = (v[2] - v[0]) / (nx - 1);
+    float dy = (v[3] - v[1]) / (ny - 1);
+
+    // Any old map would correct the probing moves, and is no good if this fails
+    clear();
+
+    // The tool travels clearance_mm above the higher of the last contact and the point
+    // next to this one on the row before, so it stays low while the surface does, without
+    // going back up to the starting height for every point.
+    std::vector<float> z(nx * ny);
+    float              top    = gc_state.position[Z_AXIS];
+    float              bottom = top - _probeDepth;
+    float              last   = top - _clearance;  // Travels at the starting height to the first point
+    for (int iy = 0; iy < ny; iy++) {
+        for (int i = 0; i < nx; i++) {
+            int   ix     = (iy & 1) ? nx - 1 - i : i;  // Back and forth along the rows
+            float known  = iy > 0 ? std::max(last, z[(iy - 1) * nx + ix]) : last;
+            float travel = std::min(top, known + _clearance);
+            if (!probe_point(x0 + ix * dx, y0 + iy * dy, travel, bottom, z[iy * nx + ix])) {
+                log_error_to(out, "Height map probing failed at point " << ix << "," << iy);
+                return sys.abort ? Error::Reset : Error::SystemGcLock;
+            }
+            last = z[iy * nx + ix];
+        }
+    }
+
+    float target[MAX_N_AXIS];
+    copyAxes(target, gc_state.position);
+    target[Z_AXIS]                = top;
+    plan_line_data_t pl_data      = {};
+    pl_data.motion.rapidMotion    = 1;
+    pl_data.motion.noCompensation = 1;
+    move_to(target, &pl_data);
+
+    float base = z[0];
+    for (auto& h : z) {
+        h -= base;
+    }
+    _x0      = x0;
+    _y0      = y0;
+    _dx      = dx;
+    _dy      = dy;
+    _nx      = nx;
+    _ny      = ny;
+    _z       = std::move(z);
+    _enabled = true;
+    show(out);
+    return Error::Ok;
+}
+
+float HeightMap::offset(float x, float y) {
+    float gx = std::clamp((x - _x0) / _dx, 0.0f, float(_nx - 1));
+    float gy = std::clamp((y - _y0) / _dy, 0.0f, float(_ny - 1));
+    int   ix = std::min(int(gx), _nx - 2);
+    int   iy = std::min(int(gy), _ny - 2);
+    float fx = gx - ix;
+    float fy = gy - iy;
+
+    float bottom = at(ix, iy) + (at(ix + 1, iy) - at(ix, iy)) * fx;
+    float top    = at(ix, iy + 1) + (at(ix + 1, iy + 1) - at(ix, iy + 1)) * fx;
+    return bottom + (top - bottom) * fy;
+}
+
+// Where a line crosses the grid lines of one axis, in order along it
+struct GridCrossings {
+    float t    = INFINITY;  // Fraction of the line at the next crossing
+    float step = 0;         // Fraction of the line between crossings
+    int   left = 0;         // Crossings still to come
+
+    GridCrossings(float from, float delta, float origin, float spacing, int lines) {
+        float dg = delta / spacing;
+        if (dg == 0) {
+            return;
+        }
+        float g = (from - origin) / spacing;  // Grid coordinate of the start
+        int   first;
+        if (dg > 0) {
+            first = std::max(int(floorf(g)) + 1, 0);
+            left  = lines - first;
+        } else {
+            first = std::min(int(ceilf(g)) - 1, lines - 1);
+            left  = first + 1;
+        }
+        step = 1 / fabsf(dg);
+        t    = left > 0 ? (first - g) / dg : INFINITY;
+    }
+
+    void next() { t = --left > 0 ? t + step : INFINITY; }
+};
+
+// The correction along the line is sampled where it bends, at grid line crossings, and
+// between them often enough for the curve within each cell to stay within half the
+// tolerance of the chords between the samples.  The pieces are cut as in the swinging door
+// algorithm: each sample narrows the range of slopes that a straight line from the start
+// of the piece can have and stay within the other half of the tolerance of it, and the
+// piece ends at the last sample that is within that range.
+bool HeightMap::follow(float* target, plan_line_data_t* pl_data, float* position, const move_t& move) {
+    auto  n_axis    = config->_axes->_numberAxis;
+    float feed_rate = pl_data->feed_rate;
+    float dx        = target[X_AXIS] - position[X_AXIS];
+    float dy        = target[Y_AXIS] - position[Y_AXIS];
+
+    float start[MAX_N_AXIS];
+    copyAxes(start, position);
+    start[Z_AXIS] += offset(position[X_AXIS], position[Y_AXIS]);
+
+    auto height = [&](float t) { return offset(position[X_AXIS] + dx * t, position[Y_AXIS] + dy * t); };
+
+    // Within a cell the correction is a quadratic in t, whose t^2 coefficient comes from the
+    // twist of the cell.  Outside the grid it is held along one axis, so it is a straight line.
+    auto curvature = [&](float t) {
+        float gx = (position[X_AXIS] + dx * t - _x0) / _dx;
+        float gy = (position[Y_AXIS] + dy * t - _y0) / _dy;
+        if (gx <= 0 || gx >= _nx - 1 || gy <= 0 || gy >= _ny - 1) {
+            return 0.0f;
+        }
+        int   ix    = int(gx);
+        int   iy    = int(gy);
+        float twist = at(ix + 1, iy + 1) - at(ix + 1, iy) - at(ix, iy + 1) + at(ix, iy);
+        return fabsf(twist * dx / _dx * dy / _dy);
+    };
+    float tolerance = _tolerance / 2;
+
+    float from_t = 0, from_h = start[Z_AXIS] - position[Z_AXIS];  // Start of the piece
+    float last_t = 0, last_h = from_h;                            // Furthest sample that the piece can reach
+    float low = -INFINITY, high = INFINITY;                       // Slopes that stay within the samples between
+
+    auto emit = [&]() {
+        float end[MAX_N_AXIS];
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            end[axis] = position[axis] + (target[axis] - position[axis]) * last_t;
+        }
+        end[Z_AXIS] += last_h;
+        if (pl_data->motion.inverseTime) {
+            pl_data->feed_rate = feed_rate / (last_t - from_t);
+        }
+        bool ok = move(end, pl_data, start);
+        copyAxes(start, end);
+        from_t = last_t;
+        from_h = last_h;
+        low    = -INFINITY;
+        high   = INFINITY;
+        return ok;
+    };
+
+    auto sample = [&](float t) {
+        float h = height(t);
+        if (t <= from_t) {
+            return true;
+        }
+        float slope = (h - from_h) / (t - from_t);
+        if ((slope < low || slope > high) && !emit()) {
+            return false;
+        }
+        float span = t - from_t;
+        low        = std::max(low, (h - tolerance - from_h) / span);
+        high       = std::min(high, (h + tolerance - from_h) / span);
+        last_t     = t;
+        last_h     = h;
+        return true;
+    };
+
+    GridCrossings xs(position[X_AXIS], dx, _x0, _dx, _nx);
+    GridCrossings ys(position[Y_AXIS], dy, _y0, _dy, _ny);
+    float         t  = 0;
+    bool          ok = true;
+    while (ok && t < 1.0f) {
+        float next = std::min({ xs.t, ys.t, 1.0f });
+        // A quadratic with coefficient c is within c * d^2 / 4 of its chords d apart
+        int samples = std::max(1, int(ceilf((next - t) * sqrtf(curvature((t + next) / 2) / (2 * tolerance)))));
+        for (int i = 1; ok && i <= samples; i++) {
+            ok = sample(t + (next - t) * i / samples);
+        }
+        if (xs.t <= next) {
+            xs.next();
+        }
+        if (ys.t <= next) {
+            ys.next();
+        }
+        t = next;
+    }
+    ok                 = ok && emit();
+    pl_data->feed_rate = feed_rate;
+    return ok;
+}
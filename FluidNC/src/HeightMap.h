@@ -0,0 +1,86 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  HeightMap.h - Z compensation for an uneven work surface
+
+  $HeightMap/Probe=<x0>,<y0>,<x1>,<y1>,<nx>,<ny> probes an nx by ny grid over the
+  rectangle from (x0, y0) to (x1, y1) in the current work coordinates.  It starts
+  from where the tool is, which should be a little above the surface, and probes
+  down at each point, travelling between them clearance_mm above the surface found
+  so far, but no higher than it started.  The map holds the height of each point
+  above the first one, in machine coordinates, so that the work surface can be
+  zeroed at the first point before or after probing.
+
+  While a map is loaded and enabled, every linear move, including the chords of
+  arcs, is corrected by the height of the surface under it, interpolated bilinearly
+  between the grid points and held at the edge values outside the grid.  The
+  correction along a line bends where it crosses grid lines and curves within a
+  cell, so lines are split there, but only where following the correction with a
+  straight line would be out by more than tolerance_mm.  The pieces are found by
+  walking the grid lines in order along the line, sampling each cell only as often
+  as its twist needs, so flat or planar maps do not split moves at all.
+
+  Probing moves and system motions such as homing and parking are not corrected.
+  The map is held in memory until it is cleared or replaced, or the machine resets.
+*/
+
+#include "Configuration/Configurable.h"
+#include "Planner.h"  // plan_line_data_t
+#include "Error.h"
+
+#include <functional>
+#include <vector>
+
+class Channel;
+
+class HeightMap : public Configuration::Configurable {
+public:
+    static const int maxPoints = 64;  // On each side of the grid
+
+    using move_t = std::function<bool(float* target, plan_line_data_t* pl_data, float* position)>;
+
+    // True if moves are being corrected
+    bool enabled() const { return _enabled && !_z.empty(); }
+
+    // Probes a grid, replacing the map.  value is the $HeightMap/Probe argument.
+    Error probe(const char* value, Channel& out);
+
+    void  show(Channel& out);
+    void  clear();
+    Error enable(bool on);
+
+    // The height of the surface at machine x, y
+    float offset(float x, float y);
+
+    // Calls move() for each piece of the line from position to target, with its Z corrected.
+    // Returns false if a move does.
+    bool follow(float* target, plan_line_data_t* pl_data, float* position, const move_t& move);
+
+    // Configuration handlers:
+    void group(Configuration::HandlerBase& handler) override;
+
+    ~HeightMap() = default;
+
+private:
+    // Configuration
+    float _probeFeed  = 100.0f;  // mm/min
+    float _probeDepth = 5.0f;    // How far below the starting height to probe
+    float _clearance  = 1.0f;    // Height above the probed surface at which the tool travels
+    float _tolerance  = 0.002f;  // Largest error in following the correction
+
+    // The grid, in machine coordinates
+    float              _x0 = 0;
+    float              _y0 = 0;
+    float              _dx = 1;
+    float              _dy = 1;
+    int                _nx = 0;
+    int                _ny = 0;
+    std::vector<float> _z;  // Row by row from y0, nx points each
+    bool               _enabled = false;
+
+    float& at(int ix, int iy) { return _z[iy * _nx + ix]; }
+
+    bool probe_point(float x, float y, float travel, float bottom, float& z);
+};
@@ -0,0 +1,70 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "HomeMemory.h"
+
+#include "Machine/MachineConfig.h"  // config
+#include "Machine/Homing.h"
+#include "Settings.h"  // Setting::_handle
+#include "System.h"    // sys, get_motor_steps()
+#include "GCode.h"     // gc_sync_position()
+#include "Planner.h"   // plan_sync_position()
+#include "Logging.h"
+
+#include <nvs.h>
+
+namespace HomeMemory {
+    static const char*    nvsKey       = "homepos";
+    static const uint32_t storeVersion = 1;
+
+    struct Store {
+        uint32_t version;
+        uint32_t axes;  // AxisMask of the axes whose steps are saved
+        int32_t  steps[MAX_N_AXIS];
+    };
+
+    static void forget() {
+        if (nvs_erase_key(Setting::_handle, nvsKey) == ESP_OK) {
+            nvs_commit(Setting::_handle);
+        }
+    }
+
+    void save() {
+        AxisMask homed = Machine::Axes::homingMask & ~Machine::Homing::unhomed_axes();
+        if (!config->_start->_fastRehome || !homed || homed != Machine::Axes::homingMask ||
+            (sys.state != State::Idle && sys.state != State::Alarm)) {
+            forget();
+            return;
+        }
+
+        Store    store = {};
+        int32_t* steps = get_motor_steps();
+        store.version  = storeVersion;
+        store.axes     = homed;
+        for (size_t axis = 0; axis < config->_axes->_numberAxis; axis++) {
+            store.steps[axis] = steps[axis];
+        }
+        if (nvs_set_blob(Setting::_handle, nvsKey, &store, sizeof(store)) != ESP_OK || nvs_commit(Setting::_handle) != ESP_OK) {
+            log_warn("Cannot save the homed position");
+        }
+    }
+
+    AxisMask restore() {
+        Store  store;
+        size_t len = sizeof(store);
+        if (nvs_get_blob(Setting::_handle, nvsKey, &store, &len) != ESP_OK) {
+            return 0;
+        }
+        forget();
+        if (len != sizeof(store) || store.version != storeVersion || store.axes != Machine::Axes::homingMask) {
+            return 0;  // The saved position is from another configuration
+        }
+        for (size_t axis = 0; axis < config->_axes->_numberAxis; axis++) {
+            if (bitnum_is_true(store.axes, axis)) {
+                set_motor_steps(axis, store.steps[axis]);
+            }
+        }
+        gc_sync_position();
+        plan_sync_position();
+        return store.axes;
+    }
+}
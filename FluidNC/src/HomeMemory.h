@@ -0,0 +1,27 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  HomeMemory.h - the homed position kept across an orderly restart
+
+  With start/fast_rehome, the motor positions are written to NVS just before the
+  controller restarts itself, if every homing axis is homed and the machine is not
+  moving.  At the next start they are read back, and
+  removed, so they are only ever believed once, and never after a crash or a power
+  cut.  The axes are still unhomed, but homing them checks the restored position with
+  a single slow touch of each switch instead of the full search, and falls back to the
+  full search if the switch is not where it should be.
+*/
+
+#include "Types.h"  // AxisMask
+
+namespace HomeMemory {
+    // Writes the motor positions, or removes any that were written if they cannot be
+    // trusted.  Used before a restart.  Requires the NVS handle from settings_init().
+    void save();
+
+    // Sets the motor positions from those written by save() and returns the axes that
+    // it set them for, or 0 if there were none.
+    AxisMask restore();
+}
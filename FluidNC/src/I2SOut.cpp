@@ -15,6 +15,7 @@ uint8_t i2s_out_read(pinnum_t pin) {
     return 0;
 }
 void i2s_out_write(pinnum_t pin, uint8_t val) {}
+void i2s_out_write_mask(uint32_t set, uint32_t clear) {}
 void i2s_out_push_sample(uint32_t usec) {}
 void i2s_out_push() {}
 void i2s_out_delay() {}
@@ -30,6 +31,7 @@ int i2s_out_set_stepping() {
 int i2s_out_set_pulse_period(uint32_t period) {
     return 0;
 }
+void i2s_out_set_fill_length(uint32_t bytes) {}
 int i2s_out_reset() {
     return 0;
 }
@@ -53,6 +55,7 @@ int i2s_out_init() {
 #    include <freertos/queue.h>
 #    include <soc/gpio_periph.h>
 #    include "Driver/fluidnc_gpio.h"
+#    include "Driver/SpiShiftOut.h"
 
 // The <atomic> library routines are not in IRAM so they can crash when called from FLASH
 // The GCC intrinsic versions which are prefixed with __ are compiled inline
@@ -79,22 +82,41 @@ static std::atomic<std::uint32_t> i2s_out_port_data = ATOMIC_VAR_INIT(0);
 //
 // Configrations for DMA connected I2S
 //
-// One DMA buffer transfer takes about 2 ms
-//   I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE x I2S_OUT_USEC_PER_PULSE
+// With the default geometry, one DMA buffer transfer takes about 2 ms
+//   dmabuf_len / I2S_SAMPLE_SIZE x I2S_OUT_USEC_PER_PULSE
 //   = 2000 / 4 x 4
 //   = 2000us = 2ms
-// If I2S_OUT_DMABUF_COUNT is 5, it will take about 10 ms for all the DMA buffer transfers to finish.
+// With 5 buffers, it will take about 10 ms for all the DMA buffer transfers to finish.
 //
-// Increasing I2S_OUT_DMABUF_COUNT has the effect of preventing buffer underflow,
+// Increasing the number of buffers has the effect of preventing buffer underflow,
 // but on the other hand, it leads to a delay with pulse and/or non-pulse-generated I/Os.
-// The number of I2S_OUT_DMABUF_COUNT should be chosen carefully.
+// The count and length are set by i2so/dma_buffer_count and i2so/dma_buffer_bytes
+// and should be chosen carefully.
 //
 // Reference information:
 //   FreeRTOS task time slice = portTICK_PERIOD_MS = 1 ms (ESP32 FreeRTOS port)
 //
-const int I2S_SAMPLE_SIZE   = 4;                                    /* 4 bytes, 32 bits per sample */
-const int DMA_SAMPLE_COUNT  = I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE; /* number of samples per buffer */
-const int SAMPLE_SAFE_COUNT = (20 / I2S_OUT_USEC_PER_PULSE);        /* prevent buffer overrun ($0 should be less than or equal 20) */
+const int I2S_SAMPLE_SIZE   = 4;                             /* 4 bytes, 32 bits per sample */
+const int SAMPLE_SAFE_COUNT = (20 / I2S_OUT_USEC_PER_PULSE); /* prevent buffer overrun ($0 should be less than or equal 20) */
+
+// On the spiso bus, a sample takes spiShiftOutSampleBytes, and each buffer has
+// room for the latch clock that ends its transfer
+static bool     i2s_out_spi = false;
+static uint32_t sample_size = I2S_SAMPLE_SIZE;
+
+static uint32_t          dmabuf_count     = I2S_OUT_DMABUF_COUNT;
+static uint32_t          dmabuf_len       = I2S_OUT_DMABUF_LEN;                    /* size in bytes of each buffer */
+static uint32_t          dma_sample_count = I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE;  /* number of samples per buffer */
+static volatile uint32_t dma_fill_count   = I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE;  /* number of samples filled while streaming */
+
+// Time for one DMA buffer transfer, rounded up so waits never spin on 0
+static uint32_t i2s_out_delay_dmabuf_ms() {
+    return (dmabuf_len / sample_size * I2S_OUT_USEC_PER_PULSE + 999) / 1000;
+}
+// Time for the data in all the DMA buffers to reach the pins
+static uint32_t i2s_out_delay_ms() {
+    return i2s_out_delay_dmabuf_ms() * (dmabuf_count + 1);
+}
 
 typedef struct {
     uint32_t**   buffers;
@@ -179,10 +201,22 @@ static inline void gpio_matrix_out_check(pinnum_t gpio, uint32_t signal_idx, boo
 }
 
 static void IRAM_ATTR set_single_data(uint32_t portData) {
+    if (i2s_out_spi) {
+        spiShiftOutWrite(portData);
+        return;
+    }
     // Apply port data in real-time (static I2S)
     I2S0.conf_single_data = portData << DATA_SHIFT;
 }
 
+static inline void IRAM_ATTR put_sample(uint32_t* buf, uint32_t pos, uint32_t portData) {
+    if (i2s_out_spi) {
+        spiShiftOutEncode(buf + pos * 2, portData);
+    } else {
+        buf[pos] = portData;
+    }
+}
+
 void IRAM_ATTR i2s_out_push() {
     if (i2s_out_pulser_status == PASSTHROUGH) {
         set_single_data(ATOMIC_LOAD(&i2s_out_port_data));
@@ -198,32 +232,36 @@ static inline void i2s_out_reset_fifo_without_lock() {
 
 static int i2s_clear_dma_buffer(lldesc_t* dma_desc, uint32_t port_data) {
     uint32_t* buf = (uint32_t*)dma_desc->buf;
-    for (int i = 0; i < DMA_SAMPLE_COUNT; i++) {
-        buf[i] = port_data;
+    for (int i = 0; i < dma_sample_count; i++) {
+        put_sample(buf, i, port_data);
     }
     // Restore the buffer length.
     // The length may have been changed short when the data was filled in to prevent buffer overrun.
-    dma_desc->length = I2S_OUT_DMABUF_LEN;
+    dma_desc->length = dmabuf_len;
     return 0;
 }
 
 static int i2s_clear_o_dma_buffers(uint32_t port_data) {
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
+    for (int buf_idx = 0; buf_idx < dmabuf_count; buf_idx++) {
         // Initialize DMA descriptor
         o_dma.desc[buf_idx]->owner        = 1;
         o_dma.desc[buf_idx]->eof          = 1;  // set to 1 will trigger the interrupt
         o_dma.desc[buf_idx]->sosf         = 0;
-        o_dma.desc[buf_idx]->length       = I2S_OUT_DMABUF_LEN;
-        o_dma.desc[buf_idx]->size         = I2S_OUT_DMABUF_LEN;
+        o_dma.desc[buf_idx]->length       = dmabuf_len;
+        o_dma.desc[buf_idx]->size         = dmabuf_len + (i2s_out_spi ? spiShiftOutTailBytes : 0);
         o_dma.desc[buf_idx]->buf          = (uint8_t*)o_dma.buffers[buf_idx];
         o_dma.desc[buf_idx]->offset       = 0;
-        o_dma.desc[buf_idx]->qe.stqe_next = (lldesc_t*)((buf_idx < (I2S_OUT_DMABUF_COUNT - 1)) ? (o_dma.desc[buf_idx + 1]) : o_dma.desc[0]);
+        o_dma.desc[buf_idx]->qe.stqe_next = (lldesc_t*)((buf_idx < (dmabuf_count - 1)) ? (o_dma.desc[buf_idx + 1]) : o_dma.desc[0]);
         i2s_clear_dma_buffer(o_dma.desc[buf_idx], port_data);
     }
     return 0;
 }
 
 static int i2s_out_gpio_attach(pinnum_t ws, pinnum_t bck, pinnum_t data) {
+    if (i2s_out_spi) {
+        spiShiftOutAttach(bck, data, ws);
+        return 0;
+    }
     // Route the i2s pins to the appropriate GPIO
     gpio_matrix_out_check(data, I2S0O_DATA_OUT23_IDX, 0, 0);
     gpio_matrix_out_check(bck, I2S0O_BCK_OUT_IDX, 0, 0);
@@ -234,6 +272,10 @@ static int i2s_out_gpio_attach(pinnum_t ws, pinnum_t bck, pinnum_t data) {
 const int I2S_OUT_DETACH_PORT_IDX = 0x100;
 
 static int i2s_out_gpio_detach(pinnum_t ws, pinnum_t bck, pinnum_t data) {
+    if (i2s_out_spi) {
+        spiShiftOutDetach(bck, data, ws);
+        return 0;
+    }
     // Route the i2s pins to the appropriate GPIO
     gpio_matrix_out_check(ws, I2S_OUT_DETACH_PORT_IDX, 0, 0);
     gpio_matrix_out_check(bck, I2S_OUT_DETACH_PORT_IDX, 0, 0);
@@ -254,14 +296,16 @@ static int i2s_out_gpio_shiftout(uint32_t port_data) {
 
 static int i2s_out_stop() {
     I2S_OUT_ENTER_CRITICAL();
-    // Stop FIFO DMA
-    I2S0.out_link.stop = 1;
+    if (!i2s_out_spi) {
+        // Stop FIFO DMA
+        I2S0.out_link.stop = 1;
 
-    // Disconnect DMA from FIFO
-    I2S0.fifo_conf.dscr_en = 0;  //Unset this bit to disable I2S DMA mode. (R/W)
+        // Disconnect DMA from FIFO
+        I2S0.fifo_conf.dscr_en = 0;  //Unset this bit to disable I2S DMA mode. (R/W)
 
-    // stop TX module
-    I2S0.conf.tx_start = 0;
+        // stop TX module
+        I2S0.conf.tx_start = 0;
+    }
 
     // Force WS to LOW before detach
     // This operation prevents unintended WS edge trigger when detach
@@ -270,6 +314,12 @@ static int i2s_out_stop() {
     // Now, detach GPIO pin from I2S
     i2s_out_gpio_detach(i2s_out_ws_pin, i2s_out_bck_pin, i2s_out_data_pin);
 
+    // The SPI transfer in progress goes on into the detached pins, so the
+    // peripheral is stopped after them
+    if (i2s_out_spi) {
+        spiShiftOutStop();
+    }
+
     // Force BCK to LOW
     // After the TX module is stopped, BCK always seems to be in LOW.
     // However, I'm going to do it manually to ensure the BCK's LOW.
@@ -279,8 +329,10 @@ static int i2s_out_stop() {
     uint32_t port_data = ATOMIC_LOAD(&i2s_out_port_data);  // current expanded port value
     i2s_out_gpio_shiftout(port_data);
 
-    //clear pending interrupt
-    I2S0.int_clr.val = I2S0.int_st.val;
+    if (!i2s_out_spi) {
+        //clear pending interrupt
+        I2S0.int_clr.val = I2S0.int_st.val;
+    }
 
     I2S_OUT_EXIT_CRITICAL();
     return 0;
@@ -299,6 +351,15 @@ static int i2s_out_start() {
     // Attach I2S to specified GPIO pin
     i2s_out_gpio_attach(i2s_out_ws_pin, i2s_out_bck_pin, i2s_out_data_pin);
 
+    if (i2s_out_spi) {
+        // In passthrough there is nothing to send until the port data changes
+        if (i2s_out_pulser_status != PASSTHROUGH) {
+            spiShiftOutStart(o_dma.desc[0]);
+        }
+        I2S_OUT_EXIT_CRITICAL();
+        return 0;
+    }
+
     // reest TX/RX module
     I2S0.conf.tx_reset = 1;
     I2S0.conf.tx_reset = 0;
@@ -362,8 +423,9 @@ static int i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
         // the generation of the buffer is interrupted (the buffer length is shortened slightly)
         // and the pulse generation is postponed until the next buffer is filled.
         //
-        o_dma.rw_pos = 0;
-        while (o_dma.rw_pos < (DMA_SAMPLE_COUNT - SAMPLE_SAFE_COUNT)) {
+        o_dma.rw_pos        = 0;
+        uint32_t fill_count = dma_fill_count;
+        while (o_dma.rw_pos < (fill_count - SAMPLE_SAFE_COUNT)) {
             // no data to read (buffer empty)
             if (i2s_out_remain_time_until_next_pulse < I2S_OUT_USEC_PER_PULSE) {
                 // pulser status may change in pulse phase func, so I need to check it every time.
@@ -387,20 +449,32 @@ static int i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
                         // To prevent the pulse function from being called back,
                         // we assume that the buffer is already full.
                         i2s_out_remain_time_until_next_pulse = 0;                 // There is no need to fill the current buffer.
-                        o_dma.rw_pos                         = DMA_SAMPLE_COUNT;  // The buffer is full.
+                        o_dma.rw_pos                         = dma_sample_count;  // The buffer is full.
                         break;
                     }
                     continue;
                 }
             }
             // no pulse data in push buffer (pulse off or idle or callback is not defined)
-            buf[o_dma.rw_pos++] = ATOMIC_LOAD(&i2s_out_port_data);
-            if (i2s_out_remain_time_until_next_pulse >= I2S_OUT_USEC_PER_PULSE) {
-                i2s_out_remain_time_until_next_pulse -= I2S_OUT_USEC_PER_PULSE;
+            // Hold the port data until the next pulse is due, or until the buffer is full.
+            // The stepper can stretch the pulse period over ticks with no steps, so this
+            // run can be long.
+            uint32_t port_data = ATOMIC_LOAD(&i2s_out_port_data);
+            uint32_t room      = (fill_count - SAMPLE_SAFE_COUNT) - o_dma.rw_pos;
+            uint32_t n         = i2s_out_remain_time_until_next_pulse / I2S_OUT_USEC_PER_PULSE;
+            if (n > room) {
+                n = room;
+            }
+            i2s_out_remain_time_until_next_pulse -= n * I2S_OUT_USEC_PER_PULSE;
+            if (n == 0) {
+                n = 1;
             }
+            do {
+                put_sample(buf, o_dma.rw_pos++, port_data);
+            } while (--n);
         }
         // set filled length to the DMA descriptor
-        dma_desc->length = o_dma.rw_pos * I2S_SAMPLE_SIZE;
+        dma_desc->length = o_dma.rw_pos * sample_size;
     } else if (i2s_out_pulser_status == WAITING) {
         i2s_clear_dma_buffer(dma_desc, 0);  // Essentially, no clearing is required. I'll make sure I know when I've written something.
         o_dma.rw_pos           = 0;         // If someone calls i2s_out_push_sample, make sure there is no buffer overflow
@@ -416,11 +490,41 @@ static int i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
     return 0;
 }
 
+//
+// DMA buffer completion, from either interrupt handler
+//
+static void IRAM_ATTR i2s_out_dma_done(lldesc_t* finish_desc, portBASE_TYPE* high_priority_task_awoken) {
+    // If the queue is full it's because we have an underflow,
+    // more than buf_count isr without new data, remove the front buffer
+    if (xQueueIsQueueFullFromISR(o_dma.queue)) {
+        lldesc_t* front_desc;
+        // Remove a descriptor from the DMA complete event queue
+        xQueueReceiveFromISR(o_dma.queue, &front_desc, high_priority_task_awoken);
+        I2S_OUT_PULSER_ENTER_CRITICAL_ISR();
+        uint32_t port_data = 0;
+        if (i2s_out_pulser_status == STEPPING) {
+            port_data = ATOMIC_LOAD(&i2s_out_port_data);
+        }
+        I2S_OUT_PULSER_EXIT_CRITICAL_ISR();
+#    ifdef CONFIG_IDF_TARGET_ESP32
+        // lldesc_t.buf is const for S2.  Perhaps we can get by
+        // without replacing the data in the buffer since we are
+        // already in an error situation.
+        for (int i = 0; i < dma_sample_count; i++) {
+            put_sample((uint32_t*)front_desc->buf, i, port_data);
+        }
+#    endif
+        front_desc->length = dmabuf_len;
+    }
+
+    // Send a DMA complete event to the I2S bitstreamer task with finished buffer
+    xQueueSendFromISR(o_dma.queue, &finish_desc, high_priority_task_awoken);
+}
+
 //
 // I2S out DMA Interrupts handler
 //
 static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
-    lldesc_t*     finish_desc;
     portBASE_TYPE high_priority_task_awoken = pdFALSE;
 
     if (I2S0.int_st.out_eof || I2S0.int_st.out_total_eof) {
@@ -436,33 +540,7 @@ static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
             I2S_OUT_EXIT_CRITICAL_ISR();
         }
         // Get the descriptor of the last item in the linkedlist
-        finish_desc = (lldesc_t*)I2S0.out_eof_des_addr;
-
-        // If the queue is full it's because we have an underflow,
-        // more than buf_count isr without new data, remove the front buffer
-        if (xQueueIsQueueFullFromISR(o_dma.queue)) {
-            lldesc_t* front_desc;
-            // Remove a descriptor from the DMA complete event queue
-            xQueueReceiveFromISR(o_dma.queue, &front_desc, &high_priority_task_awoken);
-            I2S_OUT_PULSER_ENTER_CRITICAL_ISR();
-            uint32_t port_data = 0;
-            if (i2s_out_pulser_status == STEPPING) {
-                port_data = ATOMIC_LOAD(&i2s_out_port_data);
-            }
-            I2S_OUT_PULSER_EXIT_CRITICAL_ISR();
-#    ifdef CONFIG_IDF_TARGET_ESP32
-            // lldesc_t.buf is const for S2.  Perhaps we can get by
-            // without replacing the data in the buffer since we are
-            // already in an error situation.
-            for (int i = 0; i < DMA_SAMPLE_COUNT; i++) {
-                front_desc->buf[i] = port_data;
-            }
-#    endif
-            front_desc->length = I2S_OUT_DMABUF_LEN;
-        }
-
-        // Send a DMA complete event to the I2S bitstreamer task with finished buffer
-        xQueueSendFromISR(o_dma.queue, &finish_desc, &high_priority_task_awoken);
+        i2s_out_dma_done((lldesc_t*)I2S0.out_eof_des_addr, &high_priority_task_awoken);
     }
 
     if (high_priority_task_awoken == pdTRUE) {
@@ -473,6 +551,20 @@ static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
     I2S0.int_clr.val = I2S0.int_st.val;  //clear pending interrupt
 }
 
+//
+// spiso transfer completion, from the SPI interrupt handler.  The SPI driver
+// stops by itself at the tail of the DMA descriptors.
+//
+static void IRAM_ATTR i2s_out_spi_done(lldesc_t* finish_desc, bool last) {
+    portBASE_TYPE high_priority_task_awoken = pdFALSE;
+
+    i2s_out_dma_done(finish_desc, &high_priority_task_awoken);
+
+    if (high_priority_task_awoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
 //
 // I2S bitstream generator task
 //
@@ -498,7 +590,7 @@ static void i2sOutTask(void* parameter) {
             // and the pulse generation is postponed until the next buffer is filled.
             //
             i2s_fillout_dma_buffer(dma_desc);
-            dma_desc->length = o_dma.rw_pos * I2S_SAMPLE_SIZE;
+            dma_desc->length = o_dma.rw_pos * sample_size;
         } else if (i2s_out_pulser_status == WAITING) {
             if (dma_desc->qe.stqe_next == NULL) {
                 // Tail of the DMA descriptor found
@@ -538,13 +630,14 @@ void i2s_out_delay() {
     I2S_OUT_PULSER_ENTER_CRITICAL();
     if (i2s_out_pulser_status == PASSTHROUGH) {
         // Depending on the timing, it may not be reflected immediately,
-        // so wait twice as long just in case.
-        delay_us(I2S_OUT_USEC_PER_PULSE * 2);
+        // so wait twice as long just in case.  On spiso, a write can wait
+        // for the one before it to be sent.
+        delay_us(I2S_OUT_USEC_PER_PULSE * (i2s_out_spi ? 3 : 2));
     } else {
         // Just wait until the data now registered in the DMA descripter
         // is reflected in the I2S TX module via FIFO.
         // XXX perhaps just wait until I2SO.conf1.tx_start == 0
-        delay_ms(I2S_OUT_DELAY_MS);
+        delay_ms(i2s_out_delay_ms());
     }
     I2S_OUT_PULSER_EXIT_CRITICAL();
 }
@@ -558,6 +651,15 @@ void IRAM_ATTR i2s_out_write(pinnum_t pin, uint8_t val) {
     }
 }
 
+void IRAM_ATTR i2s_out_write_mask(uint32_t set, uint32_t clear) {
+    if (set) {
+        ATOMIC_FETCH_OR(&i2s_out_port_data, set);
+    }
+    if (clear) {
+        ATOMIC_FETCH_AND(&i2s_out_port_data, ~clear);
+    }
+}
+
 uint8_t i2s_out_read(pinnum_t pin) {
     uint32_t port_data = ATOMIC_LOAD(&i2s_out_port_data);
     return (!!(port_data & bitnum_to_mask(pin)));
@@ -575,7 +677,7 @@ void IRAM_ATTR i2s_out_push_sample(uint32_t usec) {
     }
     uint32_t port_data = ATOMIC_LOAD(&i2s_out_port_data);
     do {
-        o_dma.current[o_dma.rw_pos++] = port_data;
+        put_sample(o_dma.current, o_dma.rw_pos++, port_data);
     } while (--num);
 }
 
@@ -614,7 +716,7 @@ int i2s_out_set_stepping() {
         // Wait for complete DMAs
         for (;;) {
             I2S_OUT_PULSER_EXIT_CRITICAL();
-            delay_ms(I2S_OUT_DELAY_DMABUF_MS);
+            delay_ms(i2s_out_delay_dmabuf_ms());
             I2S_OUT_PULSER_ENTER_CRITICAL();
             if (i2s_out_pulser_status == WAITING) {
                 continue;
@@ -643,6 +745,14 @@ int i2s_out_set_stepping() {
     return 0;
 }
 
+void i2s_out_set_fill_length(uint32_t bytes) {
+    uint32_t count = bytes / sample_size;
+    if (count == 0 || count > dma_sample_count) {
+        count = dma_sample_count;
+    }
+    dma_fill_count = count;
+}
+
 int IRAM_ATTR i2s_out_set_pulse_period(uint32_t period) {
     i2s_out_pulse_period = period;
     return 0;
@@ -667,82 +777,9 @@ int i2s_out_reset() {
 }
 
 //
-// Initialize function (external function)
+// I2S register setup for i2s_out_init()
 //
-int i2s_out_init(i2s_out_init_t& init_param) {
-    if (i2s_out_initialized) {
-        // already initialized
-        return -1;
-    }
-
-    ATOMIC_STORE(&i2s_out_port_data, init_param.init_val);
-
-    // To make sure hardware is enabled before any hardware register operations.
-    periph_module_reset(PERIPH_I2S0_MODULE);
-    periph_module_enable(PERIPH_I2S0_MODULE);
-
-    // Route the i2s pins to the appropriate GPIO
-    i2s_out_gpio_attach(init_param.ws_pin, init_param.bck_pin, init_param.data_pin);
-
-    /**
-   * Each i2s transfer will take
-   *   fpll = PLL_D2_CLK      -- clka_en = 0
-   *
-   *   fi2s = fpll / N + b/a  -- N + b/a = clkm_div_num
-   *   fi2s = 160MHz / 2
-   *   fi2s = 80MHz
-   *
-   *   fbclk = fi2s / M   -- M = tx_bck_div_num
-   *   fbclk = 80MHz / 2
-   *   fbclk = 40MHz
-   *
-   *   fwclk = fbclk / 32
-   *
-   *   for fwclk = 250kHz(16-bit: 4µS pulse time), 125kHz(32-bit: 8μS pulse time)
-   *      N = 10, b/a = 0
-   *      M = 2
-   *   for fwclk = 500kHz(16-bit: 2µS pulse time), 250kHz(32-bit: 4μS pulse time)
-   *      N = 5, b/a = 0
-   *      M = 2
-   *   for fwclk = 1000kHz(16-bit: 1µS pulse time), 500kHz(32-bit: 2μS pulse time)
-   *      N = 2, b/a = 2/1 (N + b/a = 2.5)
-   *      M = 2
-   */
-
-    // Allocate the array of pointers to the buffers
-    o_dma.buffers = (uint32_t**)malloc(sizeof(uint32_t*) * I2S_OUT_DMABUF_COUNT);
-    if (o_dma.buffers == nullptr) {
-        return -1;
-    }
-
-    // Allocate each buffer that can be used by the DMA controller
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
-        o_dma.buffers[buf_idx] = (uint32_t*)heap_caps_calloc(1, I2S_OUT_DMABUF_LEN, MALLOC_CAP_DMA);
-        if (o_dma.buffers[buf_idx] == nullptr) {
-            return -1;
-        }
-    }
-
-    // Allocate the array of DMA descriptors
-    o_dma.desc = (lldesc_t**)malloc(sizeof(lldesc_t*) * I2S_OUT_DMABUF_COUNT);
-    if (o_dma.desc == nullptr) {
-        return -1;
-    }
-
-    // Allocate each DMA descriptor that will be used by the DMA controller
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
-        o_dma.desc[buf_idx] = (lldesc_t*)heap_caps_malloc(sizeof(lldesc_t), MALLOC_CAP_DMA);
-        if (o_dma.desc[buf_idx] == nullptr) {
-            return -1;
-        }
-    }
-
-    // Initialize
-    i2s_clear_o_dma_buffers(init_param.init_val);
-    o_dma.rw_pos  = 0;
-    o_dma.current = NULL;
-    o_dma.queue   = xQueueCreate(I2S_OUT_DMABUF_COUNT, sizeof(uint32_t*));
-
+static void i2s_out_config(uint32_t init_val) {
     // Set the first DMA descriptor
     I2S0.out_link.addr = (uint32_t)o_dma.desc[0];
 
@@ -801,7 +838,7 @@ int i2s_out_init(i2s_out_init_t& init_param) {
     } else {
         // Static output mode
         I2S0.conf_chan.tx_chan_mod = 3;  // 3:right+constant 4:left+constant (when tx_msb_right = 1)
-        I2S0.conf_single_data      = init_param.init_val;
+        I2S0.conf_single_data      = init_val;
     }
 
 #    if I2S_OUT_NUM_BITS == 16
@@ -878,6 +915,102 @@ int i2s_out_init(i2s_out_init_t& init_param) {
     I2S0.int_ena.out_dscr_err  = 0;  // Triggered when invalid rxlink descriptors are encountered.
     I2S0.int_ena.out_total_eof = 1;  // Triggered when all transmitting linked lists are used up.
     I2S0.int_ena.out_done      = 0;  // Triggered when all transmitted and buffered data have been read.
+}
+
+//
+// Initialize function (external function)
+//
+int i2s_out_init(i2s_out_init_t& init_param) {
+    if (i2s_out_initialized) {
+        // already initialized
+        return -1;
+    }
+
+    ATOMIC_STORE(&i2s_out_port_data, init_param.init_val);
+
+    i2s_out_spi = init_param.spi;
+    sample_size = i2s_out_spi ? spiShiftOutSampleBytes : I2S_SAMPLE_SIZE;
+
+    dmabuf_count     = init_param.dmabuf_count;
+    dmabuf_len       = init_param.dmabuf_len & ~(sample_size - 1);
+    dma_sample_count = dmabuf_len / sample_size;
+    dma_fill_count   = dma_sample_count;
+
+    if (i2s_out_spi) {
+        if (!spiShiftOutInit(i2s_out_spi_done)) {
+            return -1;
+        }
+    } else {
+        // To make sure hardware is enabled before any hardware register operations.
+        periph_module_reset(PERIPH_I2S0_MODULE);
+        periph_module_enable(PERIPH_I2S0_MODULE);
+    }
+
+    // Route the i2s pins to the appropriate GPIO
+    i2s_out_gpio_attach(init_param.ws_pin, init_param.bck_pin, init_param.data_pin);
+
+    /**
+   * Each i2s transfer will take
+   *   fpll = PLL_D2_CLK      -- clka_en = 0
+   *
+   *   fi2s = fpll / N + b/a  -- N + b/a = clkm_div_num
+   *   fi2s = 160MHz / 2
+   *   fi2s = 80MHz
+   *
+   *   fbclk = fi2s / M   -- M = tx_bck_div_num
+   *   fbclk = 80MHz / 2
+   *   fbclk = 40MHz
+   *
+   *   fwclk = fbclk / 32
+   *
+   *   for fwclk = 250kHz(16-bit: 4µS pulse time), 125kHz(32-bit: 8μS pulse time)
+   *      N = 10, b/a = 0
+   *      M = 2
+   *   for fwclk = 500kHz(16-bit: 2µS pulse time), 250kHz(32-bit: 4μS pulse time)
+   *      N = 5, b/a = 0
+   *      M = 2
+   *   for fwclk = 1000kHz(16-bit: 1µS pulse time), 500kHz(32-bit: 2μS pulse time)
+   *      N = 2, b/a = 2/1 (N + b/a = 2.5)
+   *      M = 2
+   */
+
+    // Allocate the array of pointers to the buffers
+    o_dma.buffers = (uint32_t**)malloc(sizeof(uint32_t*) * dmabuf_count);
+    if (o_dma.buffers == nullptr) {
+        return -1;
+    }
+
+    // Allocate each buffer that can be used by the DMA controller
+    for (int buf_idx = 0; buf_idx < dmabuf_count; buf_idx++) {
+        o_dma.buffers[buf_idx] = (uint32_t*)heap_caps_calloc(1, dmabuf_len + (i2s_out_spi ? spiShiftOutTailBytes : 0), MALLOC_CAP_DMA);
+        if (o_dma.buffers[buf_idx] == nullptr) {
+            return -1;
+        }
+    }
+
+    // Allocate the array of DMA descriptors
+    o_dma.desc = (lldesc_t**)malloc(sizeof(lldesc_t*) * dmabuf_count);
+    if (o_dma.desc == nullptr) {
+        return -1;
+    }
+
+    // Allocate each DMA descriptor that will be used by the DMA controller
+    for (int buf_idx = 0; buf_idx < dmabuf_count; buf_idx++) {
+        o_dma.desc[buf_idx] = (lldesc_t*)heap_caps_malloc(sizeof(lldesc_t), MALLOC_CAP_DMA);
+        if (o_dma.desc[buf_idx] == nullptr) {
+            return -1;
+        }
+    }
+
+    // Initialize
+    i2s_clear_o_dma_buffers(init_param.init_val);
+    o_dma.rw_pos  = 0;
+    o_dma.current = NULL;
+    o_dma.queue   = xQueueCreate(dmabuf_count, sizeof(uint32_t*));
+
+    if (!i2s_out_spi) {
+        i2s_out_config(init_param.init_val);
+    }
 
     // default pulse callback period (μsec)
     i2s_out_pulse_period = init_param.pulse_period;
@@ -893,8 +1026,10 @@ int i2s_out_init(i2s_out_init_t& init_param) {
     );
 
     // Allocate and Enable the I2S interrupt
-    esp_intr_alloc(ETS_I2S0_INTR_SOURCE, 0, i2s_out_intr_handler, nullptr, &i2s_out_isr_handle);
-    esp_intr_enable(i2s_out_isr_handle);
+    if (!i2s_out_spi) {
+        esp_intr_alloc(ETS_I2S0_INTR_SOURCE, 0, i2s_out_intr_handler, nullptr, &i2s_out_isr_handle);
+        esp_intr_enable(i2s_out_isr_handle);
+    }
 
     // Remember GPIO pin numbers
     i2s_out_ws_pin      = init_param.ws_pin;
@@ -917,7 +1052,7 @@ int i2s_out_init(i2s_out_init_t& init_param) {
   return -1 ... already initialized
 */
 int i2s_out_init() {
-    auto i2so = config->_i2so;
+    auto i2so = config->i2soBus();
     if (!i2so) {
         return -1;
     }
@@ -943,6 +1078,9 @@ int i2s_out_init() {
         default_param.data_pin     = dataPin.getNative(Pin::Capabilities::Output | Pin::Capabilities::Native);
         default_param.pulse_period = I2S_OUT_USEC_PER_PULSE;
         default_param.init_val     = I2S_OUT_INIT_VAL;
+        default_param.dmabuf_count = i2so->_dmaBufferCount;
+        default_param.dmabuf_len   = i2so->_dmaBufferBytes;
+        default_param.spi          = i2so == config->_spiso;
 
         return i2s_out_init(default_param);
     }
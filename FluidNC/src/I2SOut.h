@@ -31,11 +31,11 @@ const uint32_t I2S_STREAM_MAX_USEC_PER_PULSE = 20;
 
 constexpr uint32_t i2s_out_max_steps_per_sec = 1000000 / (2 * I2S_OUT_USEC_PER_PULSE);
 
-const int I2S_OUT_DMABUF_COUNT = 5;    /* number of DMA buffers to store data */
-const int I2S_OUT_DMABUF_LEN   = 2000; /* maximum size in bytes (4092 is DMA's limit) */
-
-const int I2S_OUT_DELAY_DMABUF_MS = (I2S_OUT_DMABUF_LEN / sizeof(uint32_t) * I2S_OUT_USEC_PER_PULSE / 1000);
-const int I2S_OUT_DELAY_MS        = (I2S_OUT_DELAY_DMABUF_MS * (I2S_OUT_DMABUF_COUNT + 1));
+// The DMA buffer geometry is set by the i2so section of the machine config
+const int I2S_OUT_DMABUF_COUNT   = 5;    /* default number of DMA buffers to store data */
+const int I2S_OUT_DMABUF_LEN     = 2000; /* default size in bytes of each buffer */
+const int I2S_OUT_DMABUF_LEN_MIN = 128;  /* smallest size that leaves room for a pulse */
+const int I2S_OUT_DMABUF_LEN_MAX = 4092; /* DMA's limit */
 
 typedef struct {
     /*
@@ -56,6 +56,9 @@ typedef struct {
     pinnum_t data_pin;
     uint32_t pulse_period;  // aka step rate.
     uint32_t init_val;
+    uint32_t dmabuf_count;  // number of DMA buffers
+    uint32_t dmabuf_len;    // size in bytes of each DMA buffer
+    bool     spi;           // stream over VSPI, with ws_pin as the latch, bck_pin as SCK and data_pin as MOSI
 } i2s_out_init_t;
 
 /*
@@ -92,6 +95,13 @@ void i2s_out_push();
 */
 void i2s_out_write(pinnum_t pin, uint8_t val);
 
+/*
+   Set and clear several bits in the internal pin state var at once. (not written electrically)
+   set:   mask of expanded pins to turn on
+   clear: mask of expanded pins to turn off
+*/
+void i2s_out_write_mask(uint32_t set, uint32_t clear);
+
 /*
     Set current pin state to the I2S bitstream buffer
     (This call will generate a future I2S_OUT_USEC_PER_PULSE μs x N bitstream)
@@ -126,6 +136,13 @@ int i2s_out_set_stepping();
  */
 void i2s_out_delay();
 
+/*
+   Limit how much of each DMA buffer is filled while streaming, to trade
+   throughput for a shorter delay between the pulser and the pins.
+   bytes: fill length in bytes, or 0 to fill the whole buffer
+ */
+void i2s_out_set_fill_length(uint32_t bytes);
+
 /*
    Set the pulse callback period in microseconds
  */
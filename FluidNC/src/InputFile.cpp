@@ -4,9 +4,130 @@
 #include "InputFile.h"
 
 #include "Report.h"
+#include "Machine/MachineConfig.h"  // config->_sdCard
+#include "GCode.h"                  // gc_compile_line()
+#include "HashFS.h"
+#include "Protocol.h"       // protocol_hold_cycle_start()
+#include "MotionControl.h"  // mc_linear()
+#include "System.h"         // sys, get_mpos()
+#include "Spindles/Spindle.h"
+#include "JobQueue.h"   // JobQueue::file_done()
+#include "Extents.h"    // Extents::job_ended()
+#include "Telemetry.h"  // Telemetry::file_done()
+#include "SdArbiter.h"
+
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>  // rename(), remove()
+#include <cstring>
 
 InputFile::InputFile(const char* defaultFs, const char* path, WebUI::AuthenticationLevel auth_level, Channel& out) :
-    FileStream(path, "r", defaultFs), _auth_level(auth_level), _out(out), _line_num(0) {}
+    FileStream(path, "r", defaultFs), _auth_level(auth_level), _out(out), _line_num(0) {
+    SdArbiter::job_opened();
+    size_t bufferSize = config->_sdCard ? config->_sdCard->_readAheadBytes : 0;
+    if (!bufferSize) {
+        return;
+    }
+    for (int i = 0; i < nBuffers; i++) {
+        // Word-aligned buffers let the file system copy whole sectors straight in
+        _buffers[i] = static_cast<char*>(heap_caps_malloc(bufferSize, MALLOC_CAP_8BIT | MALLOC_CAP_32BIT));
+        if (!_buffers[i]) {
+            while (i--) {
+                heap_caps_free(_buffers[i]);
+            }
+            log_warn("No memory for file read-ahead; reading directly");
+            return;
+        }
+    }
+    _bufferSize = bufferSize;
+    _empty      = xQueueCreate(nBuffers, sizeof(int));
+    _filled     = xQueueCreate(nBuffers, sizeof(int));
+    _done       = xSemaphoreCreateBinary();
+    for (int i = 0; i < nBuffers; i++) {
+        xQueueSend(_empty, &i, 0);
+    }
+    xTaskCreatePinnedToCore(reader,                   // task
+                            "file_read",              // name for task
+                            3072,                     // size of task stack
+                            this,                     // parameters
+                            FILE_READ_TASK_PRIORITY,  // priority
+                            nullptr,                  // task handle
+                            FILE_READ_TASK_CORE       // core
+    );
+}
+
+// Fills the empty buffers in turn until the end of the file, or until told to stop.
+// A buffer with length 0 marks the end of the file.
+void InputFile::reader(void* arg) {
+    auto self = static_cast<InputFile*>(arg);
+    int  i;
+    while (xQueueReceive(self->_empty, &i, portMAX_DELAY) && !self->_stop) {
+        auto   buffer     = reinterpret_cast<uint8_t*>(self->_buffers[i]);
+        size_t length     = SdArbiter::read(*self, buffer, self->_bufferSize, SdArbiter::Job);
+        self->_lengths[i] = length;
+        xQueueSend(self->_filled, &i, portMAX_DELAY);
+        if (length == 0) {
+            break;
+        }
+    }
+    xSemaphoreGive(self->_done);
+    vTaskDelete(nullptr);
+}
+
+// Hands the current buffer back to the reader and waits for the next one.
+// Returns false at the end of the file.
+bool InputFile::nextBuffer() {
+    if (_eof) {
+        return false;
+    }
+    if (_current >= 0) {
+        xQueueSend(_empty, &_current, portMAX_DELAY);
+    }
+    xQueueReceive(_filled, &_current, portMAX_DELAY);
+    _offset = 0;
+    if (_lengths[_current] == 0) {
+        _eof     = true;
+        _current = -1;
+        return false;
+    }
+    return true;
+}
+
+Error InputFile::readBufferedLine(char* line, int maxlen) {
+    int len = 0;
+    while (true) {
+        if ((_current < 0 || _offset == _lengths[_current]) && !nextBuffer()) {
+            line[len] = '\0';
+            return len ? Error::Ok : Error::Eof;
+        }
+        char*  start = _buffers[_current] + _offset;
+        size_t n     = _lengths[_current] - _offset;
+        auto   nl    = static_cast<char*>(memchr(start, '\n', n));
+        size_t count = nl ? nl - start : n;
+        for (size_t i = 0; i < count; i++) {
+            if (start[i] == '\r') {
+                continue;
+            }
+            if (len >= maxlen) {
+                return Error::LineLengthExceeded;
+            }
+            line[len++] = start[i];
+        }
+        if (nl) {
+            ++count;  // Past the newline
+        }
+        _offset += count;
+        _consumed += count;
+        if (nl) {
+            line[len] = '\0';
+            return Error::Ok;
+        }
+    }
+}
+
 /*
   Read a line from the file
   Returns Error::Ok if a line was read, even if the line was empty.
@@ -15,6 +136,9 @@ InputFile::InputFile(const char* defaultFs, const char* path, WebUI::Authenticat
 */
 Error InputFile::readLine(char* line, int maxlen) {
     ++_line_num;
+    if (_bufferSize) {
+        return readBufferedLine(line, maxlen);
+    }
     int len = 0;
     int c;
     while ((c = read()) >= 0) {
@@ -33,9 +157,105 @@ Error InputFile::readLine(char* line, int maxlen) {
     return len || c >= 0 ? Error::Ok : Error::Eof;
 }
 
+/*
+  Resuming a job at a line, as after a broken tool.  The lines before it go through the
+  G-code parser in check mode, which keeps the modal state, the work coordinate offsets,
+  the tool and the parser position up to date but plans no motion and changes no outputs,
+  so they go by at the speed of the parser.  $ and [ESP] commands among them are skipped,
+  since check mode does not cover them.  The tool then goes up to the higher of its
+  current height and the resume height, across to the resume point, where the spindle and
+  coolant are restored, and down to it at the feed rate in force there.  A resumed job
+  neither uses nor records the G-code cache.
+*/
+static bool resume_move(float* target, float* position, float feed_rate) {
+    plan_line_data_t pl_data = {};
+    if (feed_rate) {
+        pl_data.feed_rate     = feed_rate;
+        pl_data.spindle       = gc_state.modal.spindle;
+        pl_data.spindle_speed = gc_state.spindle_speed;
+        pl_data.coolant       = gc_state.modal.coolant;
+    } else {
+        pl_data.motion.rapidMotion = 1;  // With the spindle off, as for a laser
+        pl_data.spindle            = SpindleState::Disable;
+    }
+    bool ok = mc_linear(target, &pl_data, position);
+    copyAxes(position, target);
+    return ok && !sys.abort;
+}
+
+Error InputFile::resumeAt(uint32_t line_num) {
+    _cacheChecked = true;
+
+    char  line[Channel::maxLine];
+    Error err = Error::Ok;
+    sys.state = State::CheckMode;
+    while (_line_num + 1 < line_num) {
+        if ((err = readLine(line, Channel::maxLine - 1)) != Error::Ok) {
+            break;
+        }
+        if ((_line_num % 256) == 0) {
+            protocol_execute_realtime();  // For a reset
+            if (sys.abort) {
+                break;
+            }
+        }
+        char* p = line;
+        while (isspace(*p)) {
+            ++p;
+        }
+        if (*p == '$' || *p == '[') {
+            continue;
+        }
+        if ((err = gc_execute_line(p)) != Error::Ok && err != Error::GcodeUnsupportedCommand) {
+            break;
+        }
+        err = Error::Ok;
+    }
+    sys.state = State::Idle;
+    if (sys.abort) {
+        return Error::Reset;
+    }
+    if (err == Error::Eof) {
+        log_error_to(_out, path() << " has only " << _line_num - 1 << " lines");
+        return Error::InvalidValue;
+    }
+    if (err != Error::Ok) {
+        log_error_to(_out, static_cast<int>(err) << " (" << errorString(err) << ") in " << path() << " at line " << _line_num);
+        return err;
+    }
+    log_info_to(_out, "Resuming " << path() << " at line " << line_num);
+
+    auto  n_axis = config->_axes->_numberAxis;
+    float position[MAX_N_AXIS], target[MAX_N_AXIS];
+    copyAxes(position, get_mpos());
+    copyAxes(target, position);
+    target[Z_AXIS] = std::max(position[Z_AXIS], gc_state.position[Z_AXIS]);
+    if (!resume_move(target, position, 0)) {
+        return Error::Reset;
+    }
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (axis != Z_AXIS) {
+            target[axis] = gc_state.position[axis];
+        }
+    }
+    if (!resume_move(target, position, 0)) {
+        return Error::Reset;
+    }
+    protocol_buffer_synchronize();
+    if (!spindle->isRateAdjusted()) {
+        spindle->setState(gc_state.modal.spindle, uint32_t(gc_state.spindle_speed));
+    }
+    config->_coolant->set_state(gc_state.modal.coolant);
+    float feed_rate = gc_state.modal.feed_rate == FeedRate::UnitsPerMin ? gc_state.feed_rate : 0;  // Else a rapid
+    if (!resume_move(gc_state.position, position, feed_rate)) {
+        return Error::Reset;
+    }
+    return Error::Ok;
+}
+
 // return a percentage complete 50.5 = 50.5%
 float InputFile::percent_complete() {
-    return (float)position() / (float)size() * 100.0f;
+    return (float)(_bufferSize ? _consumed : position()) / (float)size() * 100.0f;
 }
 
 void InputFile::ack(Error status) {
@@ -52,10 +272,197 @@ void InputFile::ack(Error status) {
     _readyNext = true;
 }
 
-std::string InputFile::_progress = "";
+const void*      InputFile::_job         = nullptr;
+volatile size_t  InputFile::_jobPosition = 0;
+volatile size_t  InputFile::_jobSize     = 0;
+volatile int32_t InputFile::_jobLines    = 0;
+char             InputFile::_jobPath[128];
+
+// Identifies the source of a .gcb file
+struct CacheHeader {
+    char     magic[4];  // "GCB" and the format version
+    uint32_t size;      // Of the source file
+    int64_t  mtime;     // Of the source file
+    char     hash[68];  // Local file system hash of the source, empty if it has none
+};
+
+void InputFile::startCache() {
+    _cacheChecked = true;
+    if (!config->_sdCard || !config->_sdCard->_gcodeCache) {
+        return;
+    }
+    struct stat st;
+    if (stat(path().c_str(), &st)) {
+        return;
+    }
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "GCB2", sizeof(header.magic));  // GCB1 files could hold O-word blocks
+    header.size  = st.st_size;
+    header.mtime = st.st_mtime;
+    strncpy(header.hash, HashFS::hash(fpath()).c_str(), sizeof(header.hash) - 1);
+
+    std::string cachePath = path() + ".gcb";
+    try {
+        _cache = new FileStream(cachePath, "r");
+        CacheHeader old;
+        if (_cache->read((char*)&old, sizeof(old)) == sizeof(old) && !memcmp(&old, &header, sizeof(old))) {
+            log_debug("Replaying " << cachePath);
+            return;
+        }
+        delete _cache;
+        _cache = nullptr;
+    } catch (Error err) {}
+
+    // Recorded under another name, so that an interrupted run leaves no partial cache
+    try {
+        _recording = new FileStream(cachePath + ".tmp", "w");
+        if (_recording->write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+            endRecording(false);
+        }
+    } catch (Error err) { log_debug("Cannot record " << cachePath); }
+}
+
+void InputFile::endRecording(bool complete) {
+    std::string cachePath = path() + ".gcb";
+    delete _recording;
+    _recording = nullptr;
+    remove(cachePath.c_str());
+    if (complete) {
+        rename((cachePath + ".tmp").c_str(), cachePath.c_str());
+        log_debug("Recorded " << cachePath);
+    } else {
+        remove((cachePath + ".tmp").c_str());
+    }
+}
+
+// True if the line is an O-word, which may start a block that OWord::handle() must
+// receive as text
+static bool is_oword(const char* line) {
+    while (isspace(*line)) {
+        ++line;
+    }
+    if (toupper(*line) == 'N') {
+        do {
+            ++line;
+        } while (isdigit(*line) || isspace(*line));
+    }
+    return toupper(*line) == 'O';
+}
+
+// Reads the next line of a job, from the cache if there is one.  A cached line is
+// either text or a compiled line, preceded by its length.
+Error InputFile::readJobLine(char* line, int maxlen) {
+    if (!_cacheChecked) {
+        startCache();
+    }
+    if (_cache) {
+        ++_line_num;
+        uint8_t length;
+        if (_cache->read(&length, 1) != 1) {
+            return Error::Eof;
+        }
+        if (length > maxlen || _cache->read(line, length) != length) {
+            return Error::FsFailedRead;
+        }
+        line[length] = '\0';
+        return Error::Ok;
+    }
+    Error err = readLine(line, maxlen);
+    if (_recording) {
+        if (err == Error::Ok) {
+            char   compiled[maxCompiledLength];
+            size_t length = gc_compile_line(line, compiled);
+            if (!length && is_oword(line)) {
+                endRecording(false);
+                return err;
+            }
+            char* record = length ? compiled : line;
+            if (!length) {
+                length = strlen(line);
+            }
+            uint8_t prefix = length;
+            if (_recording->write(&prefix, 1) != 1 || _recording->write((const uint8_t*)record, length) != length) {
+                endRecording(false);
+            }
+        } else {
+            endRecording(err == Error::Eof);
+        }
+    }
+    return err;
+}
+
+void InputFile::setProgress(const void* job, const char* path, size_t position, size_t size) {
+    if (_job != job) {
+        // A new job, or a job resumed after a nested one; the size is set last
+        // so a report never sees a path that is being copied
+        _jobSize = 0;
+        strncpy(_jobPath, path, sizeof(_jobPath) - 1);
+        _jobPath[sizeof(_jobPath) - 1] = '\0';
+        _job                            = job;
+        _jobSize                        = size;
+    }
+    _jobPosition = position;
+    _jobLines    = _jobLines + 1;
+}
+
+void InputFile::endProgress(const void* job) {
+    if (_job == job) {
+        _jobSize = 0;
+        _job     = nullptr;
+    }
+}
+
+void InputFile::updateProgress() {
+    size_t done = _cache ? _cache->position() : _bufferSize ? _consumed : position();
+    if (_job == this) {
+        // Saves making the path for every line
+        _jobPosition = done;
+        _jobLines    = _jobLines + 1;
+    } else {
+        setProgress(this, path().c_str(), done, _cache ? _cache->size() : size());
+    }
+}
+
+void InputFile::endProgress() {
+    endProgress(this);
+}
+
+std::string InputFile::progress() {
+    size_t size = _jobSize;
+    if (!size) {
+        return "";
+    }
+    char percent[16];
+    snprintf(percent, sizeof(percent), "SD:%.2f,", (float)_jobPosition / (float)size * 100.0f);
+    return percent + std::string(_jobPath);
+}
+
+bool InputFile::progress(float& percent, const char*& path) {
+    size_t size = _jobSize;
+    if (!size) {
+        return false;
+    }
+    percent = (float)_jobPosition / (float)size * 100.0f;
+    path    = _jobPath;
+    return true;
+}
 
-#include <sstream>
-#include <iomanip>
+uint32_t InputFile::linesPerSecond() {
+    static int32_t  lastLines = 0;
+    static int32_t  lastTicks = 0;
+    static uint32_t rate      = 0;
+
+    int32_t lines = _jobLines;
+    int32_t ticks = int32_t(xTaskGetTickCount());
+    int32_t msecs = (ticks - lastTicks) * portTICK_PERIOD_MS;
+    if (msecs >= 1000) {
+        rate      = uint32_t(lines - lastLines) * 1000 / msecs;
+        lastLines = lines;
+        lastTicks = ticks;
+    }
+    return rate;
+}
 
 Channel* InputFile::pollLine(char* line) {
     // File input never returns realtime characters, so we do nothing
@@ -63,21 +470,26 @@ Channel* InputFile::pollLine(char* line) {
     if (!_readyNext || !line) {
         return nullptr;
     }
-    switch (auto err = readLine(line, Channel::maxLine)) {
-        case Error::Ok: {
-            std::ostringstream s;
-            s << "SD:" << std::fixed << std::setprecision(2) << percent_complete() << "," << path().c_str();
-            _progress = s.str();
-        }
+    if (_line_num == 0 && config->_sdCard && config->_sdCard->_warmup) {
+        _warming = true;
+        protocol_hold_cycle_start(true);
+    }
+    switch (auto err = readJobLine(line, Channel::maxLine)) {
+        case Error::Ok:
+            updateProgress();
             return &allChannels;
         case Error::Eof:
-            _progress = "";
+            endProgress();
+            JobQueue::file_done(this, true);
+            Telemetry::file_done(this, true);
             _notifyf("File job done", "%s file job succeeded", path());
             log_msg(path() << " file job succeeded");
             allChannels.kill(this);
             return nullptr;
         default:
-            _progress = "";
+            endProgress();
+            JobQueue::file_done(this, false);
+            Telemetry::file_done(this, false);
             log_error(static_cast<int>(err) << " (" << errorString(err) << ") in " << path() << " at line " << getLineNumber());
             allChannels.kill(this);
             return nullptr;
@@ -88,10 +500,34 @@ void InputFile::stopJob() {
     //Report print stopped
     _notifyf("File print canceled", "Reset during file job at line: %d", getLineNumber());
     log_info("Reset during file job at line: " << getLineNumber());
-    _progress = "";
+    endProgress();
+    JobQueue::file_done(this, false);
+    Telemetry::file_done(this, false);
     allChannels.kill(this);
 }
 
 InputFile::~InputFile() {
-    _progress = "";
+    Extents::job_ended(this);
+    if (_warming) {
+        protocol_hold_cycle_start(false);
+    }
+    endProgress();
+    if (_recording) {
+        endRecording(false);
+    }
+    delete _cache;
+    if (_bufferSize) {
+        // Wake the reader if it is waiting for a buffer, and wait for it to quit
+        _stop     = true;
+        int dummy = 0;
+        xQueueSend(_empty, &dummy, 0);
+        xSemaphoreTake(_done, portMAX_DELAY);
+        vQueueDelete(_empty);
+        vQueueDelete(_filled);
+        vSemaphoreDelete(_done);
+        for (int i = 0; i < nBuffers; i++) {
+            heap_caps_free(_buffers[i]);
+        }
+    }
+    SdArbiter::job_closed();
 }
@@ -8,6 +8,15 @@
 //  - For reporting the progress of GCode execution, counts the number of lines read and
 //    the percentage of the file size that has currently been read.
 //  - For reporting status, remembers the I/O channel that started the process of using the file.
+//  - With sdcard/read_ahead_bytes set, a task reads the file ahead in large blocks into two
+//    buffers, one being filled while readLine() scans the other for newlines.
+//  - With sdcard/warmup set, the cycle start of a job is held back until its first lines
+//    have filled the planner, as protocol_hold_cycle_start() describes.
+//  - With sdcard/gcode_cache set, the first run of a job records its lines, compiled by
+//    gc_compile_line(), in <file>.gcb, and later runs replay that file instead while the
+//    size, modification time and local file system hash of the source are unchanged.
+//    Files with O-words are not cached, since their blocks are recorded from the text of
+//    their lines, which a replay would not have.
 // FileStream's Channel member is not that same Channel that FileStream ultimately
 // inherits from; rather it is a separate channel that is use for status reporting.
 
@@ -17,6 +26,9 @@
 #include "FileStream.h"  // FileStream and Channel
 #include "Error.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <cstdint>
 
 class InputFile : public FileStream {
@@ -29,9 +41,62 @@ private:
 
     uint32_t _line_num;  // the most recent line number read
     bool     _readyNext = true;
+    bool     _warming   = false;  // This job holds the cycle start
+
+    // Read-ahead state, unused when _bufferSize is 0
+    static const int nBuffers = 2;
+    char*            _buffers[nBuffers];
+    size_t           _lengths[nBuffers];
+
+    size_t            _bufferSize = 0;
+    int               _current    = -1;       // Buffer being scanned, -1 for none
+    size_t            _offset     = 0;        // Scan position in the current buffer
+    size_t            _consumed   = 0;        // Bytes of the file scanned so far
+    bool              _eof        = false;    // The reader has reached the end of the file
+    volatile bool     _stop       = false;    // Tells the reader to quit
+    QueueHandle_t     _empty      = nullptr;  // Buffers for the reader to fill
+    QueueHandle_t     _filled     = nullptr;  // Buffers for readLine() to scan, in file order
+    SemaphoreHandle_t _done       = nullptr;  // Given by the reader when it quits
+
+    static void reader(void* arg);
+    bool        nextBuffer();
+    Error       readBufferedLine(char* line, int maxlen);
+
+    // G-code cache of a file job
+    FileStream* _cache        = nullptr;  // Compiled lines being replayed
+    FileStream* _recording    = nullptr;  // Lines being recorded on the first run
+    bool        _cacheChecked = false;
+
+    void  startCache();
+    void  endRecording(bool complete);
+    Error readJobLine(char* line, int maxlen);
+
+    // Progress of the file job being read, kept as raw numbers so that status
+    // reports, which may run in another task, format it only when they need it
+    static const void*      _job;           // Only compared, never dereferenced
+    static volatile size_t  _jobPosition;   // Bytes read so far
+    static volatile size_t  _jobSize;       // File size, 0 when no job is running
+    static volatile int32_t _jobLines;      // Lines read so far
+    static char             _jobPath[128];  // Copied when the job starts
+
+    void updateProgress();
+    void endProgress();
 
 public:
-    static std::string _progress;
+    // The SD: field of status reports, empty when no file job is running
+    static std::string progress();
+
+    // Reports the progress of a job from another source, such as a network stream, the
+    // same way.  job identifies the source, and size is SIZE_MAX if it is not known.
+    static void setProgress(const void* job, const char* path, size_t position, size_t size);
+    static void endProgress(const void* job);
+
+    // The same progress as numbers, for internal consumers.  Returns false when no
+    // file job is running.
+    static bool progress(float& percent, const char*& path);
+
+    // The rate at which the running file job is read, averaged over a second or more
+    static uint32_t linesPerSecond();
 
     // fsname is the default file system on which the file is located, in case the path does not specify
     // path is the full path to the file
@@ -54,6 +119,11 @@ public:
 
     Error readLine(char* line, int len);
 
+    // Runs the lines before line_num with no motion, so that the job can continue from there
+    // in the state it would have reached, and brings the tool to where that line starts.
+    // Called before the job is started.  See InputFile.cpp.
+    Error resumeAt(uint32_t line_num);
+
     // These are used for feedback about the progress of the operation
     uint32_t getLineNumber() { return _line_num; }
     float    percent_complete();
@@ -68,6 +138,7 @@ public:
     void     ack(Error status) override;
     Channel* pollLine(char* line) override;
     void     stopJob() override;
+    int      linePriority() override { return 0; }
 
     ~InputFile();
 };
@@ -0,0 +1,111 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "InputShaper.h"
+
+#include <cmath>
+
+EnumItem shaperTypes[] = {
+    { InputShaper::NONE, "None" }, { InputShaper::ZV, "ZV" }, { InputShaper::ZVD, "ZVD" }, { InputShaper::MZV, "MZV" }, EnumItem(InputShaper::NONE)
+};
+
+void InputShaper::reset() {
+    _count        = 1;
+    _amplitude[0] = 1.0f;
+    _time[0]      = 0.0f;
+    _duration     = 0.0f;
+}
+
+bool InputShaper::add(int type, float hz, float damping) {
+    float a[3];
+    float t[3];
+    int   n;
+
+    // Damped vibration period, in minutes
+    float root = sqrtf(1.0f - damping * damping);
+    float td   = 1.0f / (hz * root) / 60.0f;
+
+    switch (type) {
+        case ZV: {
+            float k = expf(-damping * float(M_PI) / root);
+            n       = 2;
+            a[0]    = 1.0f;
+            a[1]    = k;
+            t[0]    = 0.0f;
+            t[1]    = 0.5f * td;
+            break;
+        }
+        case ZVD: {
+            float k = expf(-damping * float(M_PI) / root);
+            n       = 3;
+            a[0]    = 1.0f;
+            a[1]    = 2.0f * k;
+            a[2]    = k * k;
+            t[0]    = 0.0f;
+            t[1]    = 0.5f * td;
+            t[2]    = td;
+            break;
+        }
+        case MZV: {
+            float k  = expf(-0.75f * damping * float(M_PI) / root);
+            float a1 = 1.0f - 1.0f / sqrtf(2.0f);
+            n        = 3;
+            a[0]     = a1;
+            a[1]     = (sqrtf(2.0f) - 1.0f) * k;
+            a[2]     = a1 * k * k;
+            t[0]     = 0.0f;
+            t[1]     = 0.375f * td;
+            t[2]     = 0.75f * td;
+            break;
+        }
+        default:
+            return true;
+    }
+    if (_count * n > maxImpulses) {
+        return false;
+    }
+
+    float sum = 0.0f;
+    for (int j = 0; j < n; j++) {
+        sum += a[j];
+    }
+
+    // Convolution: every impulse of this shaper is replaced by a copy of the new one.
+    // Going backwards, impulse i moves to i * n before any impulse below it is overwritten.
+    for (int i = _count - 1; i >= 0; i--) {
+        float amplitude = _amplitude[i];
+        float time      = _time[i];
+        for (int j = 0; j < n; j++) {
+            _amplitude[i * n + j] = amplitude * a[j] / sum;
+            _time[i * n + j]      = time + t[j];
+        }
+    }
+    _count *= n;
+
+    _duration = 0.0f;
+    for (int i = 0; i < _count; i++) {
+        _duration = fmaxf(_duration, _time[i]);
+    }
+    return true;
+}
+
+float InputShaper::fraction(float t, float width) const {
+    float f = 0.0f;
+    for (int i = 0; i < _count; i++) {
+        float u = t - _time[i];
+        if (u > 0.0f) {
+            f += _amplitude[i] * (u < width ? u / width : 1.0f);
+        }
+    }
+    return f;
+}
+
+float InputShaper::distance(float t, float width) const {
+    float d = 0.0f;
+    for (int i = 0; i < _count; i++) {
+        float u = t - _time[i];
+        if (u > 0.0f) {
+            d += _amplitude[i] * (u < width ? 0.5f * u * u / width : u - 0.5f * width);
+        }
+    }
+    return d;
+}
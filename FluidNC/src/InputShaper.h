@@ -0,0 +1,54 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  InputShaper.h - impulse sequences for input shaping of acceleration ramps
+
+  An input shaper is a short sequence of impulses whose amplitudes add up to one.  A
+  motion convolved with it excites no residual vibration at the shaper frequency.  The
+  ZV, ZVD and MZV shapers are the usual ones: ZV is the shortest, lasting half of the
+  damped vibration period; ZVD and MZV tolerate more error in the frequency estimate
+  at the cost of a longer duration.  Shapers can be convolved with each other to cancel
+  several frequencies at once.
+
+  Times are in minutes, the time unit of the segment preparation code.
+*/
+
+#include "EnumItem.h"
+
+class InputShaper {
+public:
+    enum shaper_t {
+        NONE = 0,
+        ZV,
+        ZVD,
+        MZV,
+    };
+
+    static const int maxImpulses = 27;
+
+    // Makes this the identity shaper, a single impulse at time 0
+    void reset();
+
+    // Convolves this shaper with one of the given type, frequency and damping ratio.
+    // Returns false, leaving the shaper unchanged, if the result has too many impulses.
+    bool add(int type, float hz, float damping);
+
+    bool  active() const { return _count > 1; }
+    float duration() const { return _duration; }
+
+    // The response at time t to an acceleration pulse of the given width that starts at
+    // time 0 and has unit area: the fraction of the velocity change made, and the distance
+    // traveled per unit of velocity change.
+    float fraction(float t, float width) const;
+    float distance(float t, float width) const;
+
+private:
+    int   _count = 1;
+    float _amplitude[maxImpulses] = { 1.0f };
+    float _time[maxImpulses]      = { 0.0f };
+    float _duration               = 0.0f;
+};
+
+extern EnumItem shaperTypes[];
@@ -0,0 +1,277 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JobQueue.h"
+
+#include "Extents.h"  // Extents::check_job()
+#include "InputFile.h"
+#include "JobStats.h"  // JobStats::file_started()
+#include "LineQueue.h"
+#include "Logging.h"
+#include "Machine/Macros.h"       // Machine::Macros::_macro
+#include "Planner.h"              // plan_get_current_block()
+#include "Serial.h"               // allChannels
+#include "SettingsDefinitions.h"  // job_setup_macro, job_teardown_macro
+#include "System.h"               // sys
+#include "Telemetry.h"            // Telemetry::job_started()
+#include "WebUI/InputBuffer.h"    // WebUI::inputBuffer
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace JobQueue {
+    struct Entry {
+        std::string                path;  // As given to $Jobs/Add
+        uint32_t                   repeat;
+        uint32_t                   done;  // Runs completed
+        WebUI::AuthenticationLevel auth_level;
+    };
+
+    // What the queue is waiting for to end
+    enum class Step : uint8_t {
+        Stopped,
+        Setup,     // The setup macro
+        File,      // The file job, until it has been read
+        Finish,    // The motion of the last lines of the file
+        Teardown,  // The teardown macro
+    };
+
+    enum FileResult : int8_t {
+        Pending,
+        Succeeded,
+        Failed,
+    };
+
+    // Only touched by the main task
+    static std::vector<Entry> entries;
+    static size_t             current    = 0;  // Entry of the run in progress, or next to run
+    static Step               step       = Step::Stopped;
+    static bool               stopAfter  = false;  // $Jobs/Stop came during a run
+    static InputFile*         prefetched = nullptr;
+    static size_t             prefetchedEntry;
+
+    // Also written by file_done(), in the task that reads the file
+    static std::atomic<InputFile*> runningFile(nullptr);
+    static std::atomic<int8_t>     fileResult(Pending);
+
+    static bool idle() {
+        return sys.state == State::Idle && !WebUI::inputBuffer.running() && !LineQueue::busy() && !plan_get_current_block();
+    }
+
+    static std::string full_path(const Entry& entry) {
+        return entry.path[0] == '/' ? entry.path : "/" + entry.path;
+    }
+
+    static InputFile* open(const Entry& entry) {
+        try {
+            return new InputFile("sd", full_path(entry).c_str(), entry.auth_level, allChannels);
+        } catch (Error err) {
+            log_error("Job queue cannot open " << entry.path << ": " << errorString(err));
+            return nullptr;
+        }
+    }
+
+    static void drop_prefetched() {
+        delete prefetched;
+        prefetched = nullptr;
+    }
+
+    static void halt(const char* why) {
+        log_warn("Job queue stopped: " << why);
+        drop_prefetched();
+        runningFile = nullptr;
+        step        = Step::Stopped;
+    }
+
+    // The entry of the run after the one in progress, or entries.size() if there is none
+    static size_t next_entry() {
+        return entries[current].done + 1 < entries[current].repeat ? current : current + 1;
+    }
+
+    static bool run_macro(IntSetting* setting, Step next) {
+        step  = next;
+        int n = setting->get();
+        if (n >= 0 && !Machine::Macros::_macro[n].run()) {
+            halt(("macro" + std::to_string(n) + " did not start").c_str());
+            return false;
+        }
+        return true;
+    }
+
+    static void start_file() {
+        Entry&     entry = entries[current];
+        InputFile* file  = nullptr;
+        if (prefetched && prefetchedEntry == current) {
+            file       = prefetched;
+            prefetched = nullptr;
+        }
+        drop_prefetched();
+        if (!file && !(file = open(entry))) {
+            halt("the file did not open");
+            return;
+        }
+        if (Extents::check_job(*file, allChannels) != Error::Ok) {
+            delete file;
+            halt("the file exceeds the soft limits");
+            return;
+        }
+        log_info("Job " << entry.path << " run " << entry.done + 1 << " of " << entry.repeat);
+        fileResult  = Pending;
+        runningFile = file;
+        step        = Step::File;
+        JobStats::file_started(entry.path.c_str());
+        Telemetry::job_started(*file);
+        allChannels.registration(file);
+    }
+
+    void poll() {
+        if (step == Step::Stopped) {
+            return;
+        }
+        if (sys.state == State::Alarm || sys.state == State::ConfigAlarm || sys.state == State::Critical) {
+            halt("alarm");
+            return;
+        }
+        switch (step) {
+            case Step::Setup:
+                if (idle()) {
+                    start_file();
+                }
+                break;
+            case Step::File:
+                if (fileResult == Pending) {
+                    break;
+                }
+                runningFile = nullptr;
+                if (fileResult == Failed) {
+                    halt("the file job did not complete");
+                    break;
+                }
+                step = Step::Finish;
+                // The next file reads ahead while the motion of this one ends
+                if (!stopAfter && next_entry() < entries.size()) {
+                    prefetchedEntry = next_entry();
+                    prefetched      = open(entries[prefetchedEntry]);
+                }
+                break;
+            case Step::Finish:
+                if (idle()) {
+                    run_macro(job_teardown_macro, Step::Teardown);
+                }
+                break;
+            case Step::Teardown:
+                if (!idle()) {
+                    break;
+                }
+                if (++entries[current].done == entries[current].repeat) {
+                    ++current;
+                }
+                if (current == entries.size()) {
+                    log_info("Job queue done");
+                    drop_prefetched();
+                    step = Step::Stopped;
+                } else if (stopAfter) {
+                    halt("$Jobs/Stop");
+                } else {
+                    run_macro(job_setup_macro, Step::Setup);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void file_done(InputFile* file, bool succeeded) {
+        int8_t pending = Pending;
+        if (file == runningFile.load()) {
+            // Only the first report counts, as a reset may follow the end of the file
+            fileResult.compare_exchange_strong(pending, succeeded ? Succeeded : Failed);
+        }
+    }
+
+    bool running() { return step != Step::Stopped; }
+
+    Error add(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+        if (!value || !*value) {
+            log_error_to(out, "Use $Jobs/Add=<file>[,<repeat>]");
+            return Error::InvalidValue;
+        }
+        if (entries.size() == maxEntries) {
+            log_error_to(out, "The job queue holds " << maxEntries << " files");
+            return Error::Overflow;
+        }
+        Entry entry { value, 1, 0, auth_level };
+        auto  comma = entry.path.find(',');
+        if (comma != std::string::npos) {
+            int repeat = atoi(entry.path.c_str() + comma + 1);
+            if (repeat < 1) {
+                log_error_to(out, "Invalid repeat count");
+                return Error::InvalidValue;
+            }
+            entry.repeat = repeat;
+            entry.path.erase(comma);
+        }
+        try {
+            FileStream file(full_path(entry), "r", "sd");  // Only checks that it can be opened
+        } catch (Error err) {
+            log_error_to(out, entry.path << ": " << errorString(err));
+            return err;
+        }
+        entries.push_back(entry);
+        return Error::Ok;
+    }
+
+    Error list(Channel& out) {
+        const char* state = !running() ? "stopped" : stopAfter ? "stopping after this run" : "running";
+        log_info_to(out, "Job queue " << state << ", " << entries.size() << " files");
+        for (size_t i = 0; i < entries.size(); i++) {
+            auto&       entry = entries[i];
+            const char* mark  = running() && i == current ? "> " : "  ";
+            log_info_to(out, mark << entry.path << " runs:" << entry.done << "/" << entry.repeat);
+        }
+        return Error::Ok;
+    }
+
+    Error clear(Channel& out) {
+        if (running()) {
+            log_error_to(out, "Stop the job queue first");
+            return Error::IdleError;
+        }
+        entries.clear();
+        current = 0;
+        drop_prefetched();
+        return Error::Ok;
+    }
+
+    Error start(Channel& out) {
+        if (running()) {
+            log_error_to(out, "The job queue is running");
+            return Error::IdleError;
+        }
+        if (entries.empty()) {
+            log_error_to(out, "The job queue is empty");
+            return Error::InvalidValue;
+        }
+        if (sys.state != State::Idle) {
+            log_string(out, "Busy");
+            return Error::IdleError;
+        }
+        if (current == entries.size()) {
+            // A complete queue runs again from the top
+            for (auto& entry : entries) {
+                entry.done = 0;
+            }
+            current = 0;
+        }
+        stopAfter = false;
+        return run_macro(job_setup_macro, Step::Setup) ? Error::Ok : Error::InvalidStatement;
+    }
+
+    Error stop(Channel& out) {
+        if (running()) {
+            stopAfter = true;
+        }
+        return Error::Ok;
+    }
+}
@@ -0,0 +1,45 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  JobQueue.h - files that run back to back without the sender
+
+  $Jobs/Add=<file>[,<repeat>] appends a file, to be run repeat times, and $Jobs/Start
+  runs the list in order: for each run, the macro that Jobs/SetupMacro names, the file,
+  then the macro that Jobs/TeardownMacro names, each as soon as the machine is idle after
+  the one before.  When a file has been read to its end, the next one is opened, which
+  starts its read-ahead while the motion of the last lines is still running.
+
+  A file that fails, a reset or an alarm stops the queue in the run it was in, and
+  $Jobs/Stop stops it at the end of the run.  The list is kept, so $Jobs/Start goes on
+  from the run that did not complete, or from the top once all of them have.  The runs
+  count in JobStats, like those of $SD/Run, and the WebUI controls the queue with the
+  same commands.
+*/
+
+#include "Error.h"
+#include "WebUI/Authentication.h"
+
+class Channel;
+class InputFile;
+
+namespace JobQueue {
+    const int maxEntries = 16;
+
+    // Called from the main loop to start each step as the one before it ends
+    void poll();
+
+    // Called by a file job as it ends, from whichever task that happens in
+    void file_done(InputFile* file, bool succeeded);
+
+    // Whether the queue is running
+    bool running();
+
+    // $Jobs/Add, $Jobs/List, $Jobs/Clear, $Jobs/Start and $Jobs/Stop
+    Error add(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out);
+    Error list(Channel& out);
+    Error clear(Channel& out);
+    Error start(Channel& out);
+    Error stop(Channel& out);
+}
@@ -0,0 +1,201 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JobStats.h"
+
+#include "Settings.h"  // Setting::_handle
+#include "System.h"    // sys
+#include "Channel.h"
+#include "Logging.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <nvs.h>
+#include <cstring>
+#include <cstdio>
+#include <strings.h>  // strcasecmp
+
+namespace JobStats {
+    static const char*      nvsKey        = "jobstats";
+    static const char*      estimatesKey  = "jobtimes";
+    static const uint32_t   storeVersion  = 1;
+    static const TickType_t writeInterval = 10 * 60 * 1000 / portTICK_PERIOD_MS;
+
+    struct FileCount {
+        char     name[48];
+        uint32_t runs;
+    };
+
+    struct Store {
+        uint32_t  version;
+        uint32_t  jobs;            // Since $RW
+        uint32_t  totalJobs;       // Since $Stats=RESET
+        uint32_t  cycleSeconds;    // Time in the Cycle state
+        uint32_t  spindleSeconds;  // Time with the spindle on
+        FileCount files[maxFiles];
+    };
+
+    static Store      store;
+    static uint32_t   estimates[maxFiles];  // Seconds for each of store.files, 0 if not known
+    static int        jobFile       = -1;   // Index in store.files of the running job
+    static uint32_t   jobMs         = 0;    // Time in the Cycle state since the job started
+    static bool       countsChanged = false;  // Written at the next idle moment
+    static bool       timesChanged  = false;  // Written when idle once writeInterval has passed
+    static TickType_t lastWrite     = 0;
+    static TickType_t lastPoll      = 0;
+    static uint32_t   cycleMs       = 0;  // Less than a second, not yet in store
+    static uint32_t   spindleMs     = 0;
+
+    void init() {
+        size_t len = sizeof(store);
+        if (nvs_get_blob(Setting::_handle, nvsKey, &store, &len) != ESP_OK || len != sizeof(store) || store.version != storeVersion) {
+            memset(&store, 0, sizeof(store));
+            store.version = storeVersion;
+        }
+        len = sizeof(estimates);
+        if (nvs_get_blob(Setting::_handle, estimatesKey, estimates, &len) != ESP_OK || len != sizeof(estimates)) {
+            memset(estimates, 0, sizeof(estimates));
+        }
+        lastPoll  = xTaskGetTickCount();
+        lastWrite = lastPoll;
+    }
+
+    void flush() {
+        if (!countsChanged && !timesChanged) {
+            return;
+        }
+        if (nvs_set_blob(Setting::_handle, nvsKey, &store, sizeof(store)) != ESP_OK ||
+            nvs_set_blob(Setting::_handle, estimatesKey, estimates, sizeof(estimates)) != ESP_OK ||
+            nvs_commit(Setting::_handle) != ESP_OK) {
+            log_warn("Cannot save job statistics");
+        }
+        countsChanged = false;
+        timesChanged  = false;
+        lastWrite     = xTaskGetTickCount();
+    }
+
+    void poll() {
+        TickType_t now = xTaskGetTickCount();
+        uint32_t   ms  = (now - lastPoll) * portTICK_PERIOD_MS;
+        lastPoll       = now;
+
+        if (sys.state == State::Cycle) {
+            cycleMs += ms;
+            jobMs += ms;
+        }
+        if (sys.spindle_speed) {
+            spindleMs += ms;
+        }
+        if (cycleMs >= 1000 || spindleMs >= 1000) {
+            store.cycleSeconds += cycleMs / 1000;
+            store.spindleSeconds += spindleMs / 1000;
+            cycleMs %= 1000;
+            spindleMs %= 1000;
+            timesChanged = true;
+        }
+
+        // Flash writes stall the CPU, so they wait until nothing is moving
+        if (sys.state == State::Idle && (countsChanged || (timesChanged && (now - lastWrite) >= writeInterval))) {
+            flush();
+        }
+    }
+
+    void job_done() {
+        ++store.jobs;
+        ++store.totalJobs;
+        // A complete run of a file is the best estimate of the next one
+        if (jobFile >= 0 && jobMs >= 1000) {
+            estimates[jobFile] = jobMs / 1000;
+        }
+        jobFile       = -1;
+        countsChanged = true;
+    }
+
+    // The index of the file's slot, taking over the least run one if it has none
+    static int file_slot(const char* path) {
+        int slot = 0;
+        for (int i = 0; i < maxFiles; i++) {
+            auto& file = store.files[i];
+            if (strncmp(file.name, path, sizeof(file.name) - 1) == 0 && file.name[0]) {
+                return i;
+            }
+            if (file.runs < store.files[slot].runs) {
+                slot = i;
+            }
+        }
+        auto& file = store.files[slot];
+        strncpy(file.name, path, sizeof(file.name) - 1);
+        file.name[sizeof(file.name) - 1] = '\0';
+        file.runs                        = 0;
+        estimates[slot]                  = 0;
+        return slot;
+    }
+
+    void file_started(const char* path) {
+        jobFile = file_slot(path);
+        jobMs   = 0;
+        ++store.files[jobFile].runs;
+        countsChanged = true;
+    }
+
+    void set_estimate(const char* path, uint32_t seconds) {
+        estimates[file_slot(path)] = seconds;
+        countsChanged              = true;
+    }
+
+    bool remaining_seconds(float percent, uint32_t& seconds) {
+        if (jobFile < 0) {
+            return false;
+        }
+        uint32_t elapsed = jobMs / 1000;
+        if (estimates[jobFile]) {
+            seconds = estimates[jobFile] > elapsed ? estimates[jobFile] - elapsed : 0;
+            return true;
+        }
+        // Otherwise from the part of the file read so far, once that is enough to go on
+        if (percent < 1.0f) {
+            return false;
+        }
+        seconds = uint32_t(elapsed * (100.0f - percent) / percent);
+        return true;
+    }
+
+    uint32_t file_runs() { return jobFile < 0 ? 0 : store.files[jobFile].runs; }
+    uint32_t jobs() { return store.jobs; }
+    uint32_t total_jobs() { return store.totalJobs; }
+    uint32_t cycle_seconds() { return store.cycleSeconds; }
+    uint32_t spindle_seconds() { return store.spindleSeconds; }
+
+    void reset_jobs() {
+        store.jobs    = 0;
+        countsChanged = true;
+    }
+
+    static std::string hours(uint32_t seconds) {
+        char buf[20];
+        snprintf(buf, sizeof(buf), "%u:%02u:%02u", unsigned(seconds / 3600), unsigned(seconds / 60 % 60), unsigned(seconds % 60));
+        return buf;
+    }
+
+    Error show(const char* value, Channel& out) {
+        if (value) {
+            if (strcasecmp(value, "RESET") != 0) {
+                return Error::InvalidValue;
+            }
+            memset(&store, 0, sizeof(store));
+            memset(estimates, 0, sizeof(estimates));
+            store.version = storeVersion;
+            jobFile       = -1;
+            countsChanged = true;
+            flush();
+        }
+        log_info_to(out, "Jobs:" << store.jobs << " total:" << store.totalJobs);
+        log_info_to(out, "Cycle time:" << hours(store.cycleSeconds) << " spindle on:" << hours(store.spindleSeconds));
+        for (int i = 0; i < maxFiles; i++) {
+            auto& file = store.files[i];
+            if (file.name[0]) {
+                log_info_to(out, "  " << file.name << " runs:" << file.runs << (estimates[i] ? " time:" + hours(estimates[i]) : ""));
+            }
+        }
+        return Error::Ok;
+    }
+}
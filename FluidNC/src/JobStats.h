@@ -0,0 +1,56 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  JobStats.h - production statistics that survive a restart
+
+  Counts completed jobs (M30), the time spent running motion, the time the spindle is
+  on, how many times each file has been run and how long it takes, and keeps them in
+  NVS, which spreads its writes over the flash.  Changes are collected in RAM and
+  written only while the machine is idle: at the first idle moment after a job count
+  changes, and otherwise no more than once every ten minutes, so a job never waits on a
+  flash write and the flash sees a write per job rather than one per change.
+
+  The time of a file is the time in the Cycle state of its last run to M30, or the
+  motion time that $SD/Estimate or $LocalFS/Estimate found for it, and gives the ETA
+  of the status report while it runs.
+*/
+
+#include "Error.h"
+
+#include <cstdint>
+
+class Channel;
+
+namespace JobStats {
+    const int maxFiles = 16;  // Files with run counts; the least run is replaced by a new one
+
+    // Loads the stored statistics.  Requires the NVS handle from settings_init().
+    void init();
+
+    // Called from the main loop to time the cycle and spindle, and to write changes when idle.
+    void poll();
+
+    // Writes any changes now.  Used before a restart.
+    void flush();
+
+    void     job_done();
+    void     file_started(const char* path);
+    void     set_estimate(const char* path, uint32_t seconds);  // From $SD/Estimate
+    uint32_t file_runs();   // Of the file job running, counting this run
+    uint32_t jobs();        // Since the last $RW
+    uint32_t total_jobs();  // Since $Stats=RESET
+    uint32_t cycle_seconds();
+    uint32_t spindle_seconds();
+    void     reset_jobs();
+
+    // The time left of the file job running, as its estimate or the time of its last
+    // complete run, less the time it has been in the Cycle state, or if neither is known,
+    // extrapolated from percent of the file read.  Returns false if there is no file job
+    // or not enough of it has been read.
+    bool remaining_seconds(float percent, uint32_t& seconds);
+
+    // $Stats, and $Stats=RESET to clear everything
+    Error show(const char* value, Channel& out);
+}
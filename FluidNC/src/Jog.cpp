@@ -8,6 +8,9 @@
 #include "MotionControl.h"  // mc_linear
 #include "Stepper.h"        // st_prep_buffer, st_wake_up
 #include "Limits.h"         // constrainToSoftLimits()
+#include "Protocol.h"       // protocol_notify_main(), motionCancelEvent
+
+#include <cmath>
 
 // Sets up valid jog motion received from g-code parser, checks for soft-limits, and executes the jog.
 // cancelledInflight will be set to true if was not added to parser due to a cancelJog.
@@ -28,3 +31,134 @@ Error jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block, bool* can
     // The motion will be initiated by the cycle start mechanism
     return Error::Ok;
 }
+
+static volatile int8_t jogSpeeds[MAX_N_AXIS] = { 0 };
+static volatile bool   jogChanged            = false;
+static float           jogRates[MAX_N_AXIS]  = { 0 };  // mm/min of each axis along the vector being followed
+static bool            jogFollowing          = false;  // Moves along jogRates are queued
+static bool            jogCancelling         = false;  // Waiting for a jog cancel to stop the machine
+
+const float jogSegmentSecs = 0.02f;  // How long each queued move lasts at speed
+const float jogLeadSecs    = 0.05f;  // Queued beyond the stopping distance, for the main loop's latency
+
+void jog_velocity(size_t axis, int8_t speed) {
+    if (axis < config->_axes->_numberAxis && jogSpeeds[axis] != speed) {
+        jogSpeeds[axis] = speed;
+        jogChanged      = true;
+        protocol_notify_main();
+    }
+}
+
+void jog_velocity_stop() {
+    for (auto& speed : jogSpeeds) {
+        speed = 0;
+    }
+    jogChanged = true;
+}
+
+static float magnitude(float* rates, size_t n_axis) {
+    float sq = 0;
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        sq += rates[axis] * rates[axis];
+    }
+    return sqrtf(sq);
+}
+
+// True if b is a positive multiple of a
+static bool same_line(float* a, float* b, size_t n_axis) {
+    float ma = magnitude(a, n_axis);
+    float mb = magnitude(b, n_axis);
+    if (ma == 0 || mb == 0) {
+        return false;
+    }
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (fabsf(b[axis] - a[axis] * mb / ma) > 1e-4f * mb) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void jog_velocity_cancel() {
+    if (sys.state == State::Jog) {
+        protocol_send_event(&motionCancelEvent);
+        jogCancelling = true;
+    } else if (plan_get_current_block()) {
+        // Queued but not started yet
+        plan_reset();
+        gc_sync_position();
+        plan_sync_position();
+    }
+    jogFollowing = false;
+}
+
+void jog_velocity_poll() {
+    auto axes   = config->_axes;
+    auto n_axis = axes->_numberAxis;
+
+    if (jogChanged) {
+        jogChanged = false;
+        float rates[MAX_N_AXIS];
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            rates[axis] = jogSpeeds[axis] * axes->_axis[axis]->_maxRate / 127.0f;
+        }
+        if (jogFollowing && !same_line(jogRates, rates, n_axis)) {
+            jog_velocity_cancel();
+        }
+        copyAxes(jogRates, rates);
+    }
+
+    if (jogCancelling) {
+        if (sys.state == State::Jog) {
+            return;
+        }
+        jogCancelling = false;
+    }
+    if (jogFollowing && sys.state != State::Jog && !plan_get_current_block()) {
+        jogFollowing = false;  // Stopped at a soft limit, or by something else
+    }
+
+    float rate = magnitude(jogRates, n_axis);  // mm/min
+    if (rate == 0 || !(sys.state == State::Jog || (sys.state == State::Idle && (jogFollowing || !plan_get_current_block())))) {
+        return;
+    }
+
+    // The planner decelerates to a stop at the end of what is queued, so the machine holds
+    // its speed while that is further off than it takes to stop
+    float accel = INFINITY;  // mm/sec^2 along the vector
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (jogRates[axis] != 0) {
+            accel = std::min(accel, axes->_axis[axis]->_acceleration * rate / fabsf(jogRates[axis]));
+        }
+    }
+    float speed   = rate / 60.0f;  // mm/sec
+    float lead    = speed * speed / (2 * accel) + speed * jogLeadSecs;
+    float segment = std::max(speed * jogSegmentSecs, lead / 8);
+    float queued  = vector_distance(get_mpos(), gc_state.position, n_axis);
+
+    plan_line_data_t pl_data      = {};
+    pl_data.spindle_speed         = gc_state.spindle_speed;
+    pl_data.spindle               = gc_state.modal.spindle;
+    pl_data.coolant               = gc_state.modal.coolant;
+    pl_data.feed_rate             = rate;
+    pl_data.motion.noFeedOverride = 1;
+    pl_data.is_jog                = true;
+    pl_data.line_number           = JOG_LINE_NUMBER;
+
+    while (queued < lead && !plan_check_full_buffer()) {
+        float target[MAX_N_AXIS];
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            target[axis] = gc_state.position[axis] + jogRates[axis] * segment / rate;
+        }
+        config->_kinematics->constrain_jog(target, &pl_data, gc_state.position);
+        if (vector_distance(target, gc_state.position, n_axis) < 0.001f) {
+            break;  // At a soft limit
+        }
+        if (!mc_linear(target, &pl_data, gc_state.position)) {
+            break;
+        }
+        copyAxes(gc_state.position, target);
+        queued += segment;
+        jogFollowing = true;
+    }
+}
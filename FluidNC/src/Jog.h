@@ -14,3 +14,14 @@ const int JOG_LINE_NUMBER = 0;
 // Sets up valid jog motion received from g-code parser, checks for soft-limits, and executes the jog.
 // cancelledInflight will be set to true if was not added to parser due to a cancelJog.
 Error jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block, bool* cancelledInflight);
+
+// Velocity jogging, for pendants and joysticks.  A realtime jog velocity code point (see
+// RealtimeCmd.h) sets the velocity of one axis, and the main loop keeps the planner just
+// far enough ahead of the machine along the resulting vector for it to hold its speed.
+// A speed change along the same line takes over from the queued moves, and anything else
+// cancels the jog, so a change never waits for more than the stop from the speed that the
+// machine is at.  The queued moves are clipped by the soft limits, so the machine stops at
+// them as it would at the end of a $J.
+void jog_velocity(size_t axis, int8_t speed);  // speed is in 127ths of max_rate_mm_per_min
+void jog_velocity_stop();                      // Also done by a jog cancel
+void jog_velocity_poll();                      // From the main loop
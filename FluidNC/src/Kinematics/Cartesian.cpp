@@ -192,8 +192,7 @@ namespace Kinematics {
                 if ((!move_positive && (current_position[axis] < limitsMinPosition(axis))) ||
                     (move_positive && (current_position[axis] > limitsMaxPosition(axis)))) {
                     // only allow a nudge if a switch is active
-                    if (bitnum_is_false(lim_pin_state, Machine::Axes::motor_bit(axis, 0)) &&
-                        bitnum_is_false(lim_pin_state, Machine::Axes::motor_bit(axis, 1))) {
+                    if (bitnum_is_false(Machine::Axes::motors_to_axes(lim_pin_state), axis)) {
                         target[axis] = current_position[axis];  // cancel the move on this axis
                         log_debug("Soft limit violation on " << Machine::Axes::_names[axis]);
                         continue;
@@ -295,11 +294,10 @@ namespace Kinematics {
         for (int axis = 0; axis < n_axis; axis++) {
             if (bitnum_is_true(axisMask, axis)) {
                 auto paxis = axes->_axis[axis];
-                if (bitnum_is_true(motors, Machine::Axes::motor_bit(axis, 0))) {
-                    paxis->_motors[0]->unlimit();
-                }
-                if (bitnum_is_true(motors, Machine::Axes::motor_bit(axis, 1))) {
-                    paxis->_motors[1]->unlimit();
+                for (size_t motor = 0; motor < Machine::Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                    if (bitnum_is_true(motors, Machine::Axes::motor_bit(axis, motor))) {
+                        paxis->_motors[motor]->unlimit();
+                    }
                 }
             }
         }
@@ -40,6 +40,8 @@ namespace Kinematics {
         bool         transform_cartesian_to_motors(float* cartesian, float* motors) override;
 
         bool canHome(AxisMask axisMask) override;
+        bool canPlanArcs() override { return true; }
+        bool boxLimits() override { return true; }
         void releaseMotors(AxisMask axisMask, MotorMask motors) override;
         bool limitReached(AxisMask& axisMask, MotorMask& motors, MotorMask limited) override;
         virtual bool kinematics_homing(AxisMask& axisMask) override;
@@ -5,8 +5,11 @@
 #include "../Machine/Homing.h"
 
 #include "../Protocol.h"  // protocol_execute_realtime
+#include "Driver/delay_usecs.h"  // getCpuTicks()
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 
 /*
 Default configuration
@@ -89,29 +92,102 @@ namespace Kinematics {
         target = an n_axis array of target positions (where the move is supposed to go)
         pl_data = planner data (see the definition of this type to see what it is)
         position = an n_axis array of where the machine is starting from for this move
+
+      The transform is linear, so the target goes straight to motor steps, and the feed rate
+      scale comes from the move's delta rather than from transforming both of its ends.
     */
     bool CoreXY::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
-        //        log_debug("cartesian_to_motors position (" << position[X_AXIS] << "," << position[Y_AXIS] << ") target (" << target[X_AXIS] << "," << target[Y_AXIS] << ")");
+        int32_t steps[MAX_N_AXIS];
+        cartesian_to_steps(steps, target);
 
-        auto n_axis = config->_axes->_numberAxis;
+        if (!pl_data->motion.rapidMotion) {
+            // Scale the feed rate by the motor/cartesian ratio
+            pl_data->feed_rate *= feed_scale(target, position);
+        }
 
-        float motors[n_axis];
-        transform_cartesian_to_motors(motors, target);
+        return mc_move_motor_steps(steps, pl_data);
+    }
 
-        if (!pl_data->motion.rapidMotion) {
-            // Calculate vector distance of the motion in cartesian coordinates
-            float cartesian_distance = vector_distance(target, position, n_axis);
+    // Steps per mm are read on every call, not cached, since they can be changed by settings
+    void CoreXY::cartesian_to_steps(int32_t* steps, float* cartesian) {
+        auto  axes    = config->_axes;
+        float x       = _x_scaler * cartesian[X_AXIS];
+        steps[X_AXIS] = lroundf((x + cartesian[Y_AXIS]) * axes->_axis[X_AXIS]->_stepsPerMm);
+        steps[Y_AXIS] = lroundf((x - cartesian[Y_AXIS]) * axes->_axis[Y_AXIS]->_stepsPerMm);
 
-            // Calculate vector distance of the motion in motor coordinates
-            float last_motors[n_axis];
-            transform_cartesian_to_motors(last_motors, position);
-            float motor_distance = vector_distance(motors, last_motors, n_axis);
+        auto n_axis = axes->_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            steps[axis] = lroundf(cartesian[axis] * axes->_axis[axis]->_stepsPerMm);
+        }
+    }
 
-            // Scale the feed rate by the motor/cartesian ratio
-            pl_data->feed_rate *= motor_distance / cartesian_distance;
+    // The ratio of the motor space length of a move to its cartesian length
+    float CoreXY::feed_scale(float* target, float* position) {
+        float dx = target[X_AXIS] - position[X_AXIS];
+        float dy = target[Y_AXIS] - position[Y_AXIS];
+        float mx = _x_scaler * dx + dy;
+        float my = _x_scaler * dx - dy;
+
+        float cartesian_sqr = dx * dx + dy * dy;
+        float motor_sqr     = mx * mx + my * my;
+
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            float d = target[axis] - position[axis];
+            cartesian_sqr += d * d;
+            motor_sqr += d * d;
         }
+        return cartesian_sqr > 0 ? sqrtf(motor_sqr / cartesian_sqr) : 1.0f;
+    }
 
-        return mc_move_motors(motors, pl_data);
+    // Times the conversion of short laser-like segments to motor steps, both as it used to be
+    // done, by transforming both ends and converting each motor position in the planner, and
+    // directly, and reports the largest difference in steps between the two.
+    void CoreXY::benchmark(Channel& out, uint32_t n_points) {
+        auto  n_axis               = config->_axes->_numberAxis;
+        float position[MAX_N_AXIS] = { 0 };
+        float target[MAX_N_AXIS]   = { 0 };
+        float motors[MAX_N_AXIS];
+        float last_motors[MAX_N_AXIS];
+
+        uint32_t ref_ticks  = 0;
+        uint32_t fast_ticks = 0;
+        int32_t  max_diff   = 0;
+        float    max_scale  = 0;
+        for (uint32_t i = 0; i < n_points; i++) {
+            target[X_AXIS] = position[X_AXIS] + 0.1f;
+            target[Y_AXIS] = 5 * sinf(0.01f * i);
+
+            int32_t ref_steps[MAX_N_AXIS];
+            int32_t start = getCpuTicks();
+            transform_cartesian_to_motors(motors, target);
+            transform_cartesian_to_motors(last_motors, position);
+            float ref_scale = vector_distance(motors, last_motors, n_axis) / vector_distance(target, position, n_axis);
+            for (size_t axis = 0; axis < n_axis; axis++) {
+                ref_steps[axis] = mpos_to_steps(motors[axis], axis);
+            }
+            int32_t mid = getCpuTicks();
+
+            int32_t steps[MAX_N_AXIS];
+            cartesian_to_steps(steps, target);
+            float scale = feed_scale(target, position);
+            fast_ticks += uint32_t(getCpuTicks() - mid);
+            ref_ticks += uint32_t(mid - start);
+
+            for (size_t axis = 0; axis < n_axis; axis++) {
+                max_diff = std::max(max_diff, std::abs(steps[axis] - ref_steps[axis]));
+            }
+            max_scale = std::max(max_scale, std::abs(scale - ref_scale));
+            copyAxes(position, target);
+        }
+        uint32_t ref_avg  = ref_ticks / n_points;
+        uint32_t fast_avg = fast_ticks / n_points;
+        log_info_to(out,
+                    "Kinematics " << name() << ": " << n_points << " segments, max difference " << max_diff << " steps, " << max_scale
+                                  << " in feed scale");
+        log_info_to(out,
+                    "  Transform avg " << ref_avg << " ticks, " << (ref_avg ? ticks_per_us * 1000000 / ref_avg : 0) << " segments/sec");
+        log_info_to(out, "  Direct avg " << fast_avg << " ticks, " << (fast_avg ? ticks_per_us * 1000000 / fast_avg : 0) << " segments/sec");
     }
 
     /*
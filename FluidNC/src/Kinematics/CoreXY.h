@@ -32,6 +32,7 @@ namespace Kinematics {
         void         motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
 
         bool canHome(AxisMask axisMask) override;
+        bool canPlanArcs() override { return false; }
         void releaseMotors(AxisMask axisMask, MotorMask motors) override;
         bool limitReached(AxisMask& axisMask, MotorMask& motors, MotorMask limited);
 
@@ -42,6 +43,8 @@ namespace Kinematics {
 
         bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
 
+        void benchmark(Channel& out, uint32_t n_points) override;
+
         // Name of the configurable. Must match the name registered in the cpp file.
         virtual const char* name() const override { return "CoreXY"; }
 
@@ -53,6 +56,9 @@ namespace Kinematics {
 
         void plan_homing_move(AxisMask axisMask, bool approach, bool seek);
 
+        void  cartesian_to_steps(int32_t* steps, float* cartesian);
+        float feed_scale(float* target, float* position);
+
     protected:
         float _x_scaler = 1.0;
     };
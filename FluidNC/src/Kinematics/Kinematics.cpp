@@ -6,6 +6,10 @@
 
 #include "src/Config.h"
 #include "Cartesian.h"
+#include "../Machine/MachineConfig.h"  // config
+#include "Driver/delay_usecs.h"        // getCpuTicks()
+
+#include <algorithm>
 
 namespace Kinematics {
     void Kinematics::constrain_jog(float* target, plan_line_data_t* pl_data, float* position) {
@@ -39,6 +43,16 @@ namespace Kinematics {
         return _system->canHome(axisMask);
     }
 
+    bool Kinematics::canPlanArcs() {
+        Assert(_system != nullptr, "No kinematic system");
+        return _system->canPlanArcs();
+    }
+
+    bool Kinematics::boxLimits() {
+        Assert(_system != nullptr, "No kinematic system");
+        return _system->boxLimits();
+    }
+
     bool Kinematics::kinematics_homing(AxisMask axisMask) {
         Assert(_system != nullptr, "No kinematic system");
         return _system->kinematics_homing(axisMask);
@@ -54,11 +68,67 @@ namespace Kinematics {
         return _system->limitReached(axisMask, motors, limited);
     }
 
+    void Kinematics::flush_held() {
+        Assert(_system != nullptr, "No kinematics system.");
+        _system->flush_held();
+    }
+
+    void Kinematics::drop_held() {
+        Assert(_system != nullptr, "No kinematics system.");
+        _system->drop_held();
+    }
+
+    void Kinematics::benchmark(Channel& out, uint32_t n_points) {
+        Assert(_system != nullptr, "No kinematics system.");
+        _system->benchmark(out, n_points);
+    }
+
     bool Kinematics::transform_cartesian_to_motors(float* motors, float* cartesian) {
         Assert(_system != nullptr, "No kinematics system.");
         return _system->transform_cartesian_to_motors(motors, cartesian);
     }
 
+    bool Kinematics::motor_rates(float* rates, float* cartesian, float* direction) {
+        Assert(_system != nullptr, "No kinematics system.");
+        return _system->motor_rates(rates, cartesian, direction);
+    }
+
+    float KinematicSystem::segment_end(float done, float& step, float minStep, float maxError, const std::function<float(float, float)>& error) {
+        if (maxError > 0) {
+            step = std::max(std::min(step * 2, 1.0f), minStep);
+            // NaN from an unreachable midpoint counts as too far
+            while (step > minStep && !(error(done, std::min(done + step, 1.0f)) <= maxError)) {
+                step = std::max(step / 2, minStep);
+            }
+        } else {
+            step = minStep;
+        }
+        // Rounding must not leave a sliver of a segment at the end
+        float end = done + step;
+        return end > 1.0f - minStep / 2 ? 1.0f : end;
+    }
+
+    // The points lie on a circle about the origin, so nonlinear kinematics work all around it
+    void KinematicSystem::benchmark(Channel& out, uint32_t n_points) {
+        auto  n_axis = config->_axes->_numberAxis;
+        float cartesian[MAX_N_AXIS] = { 0 };
+        float motors[MAX_N_AXIS];
+
+        uint32_t total_ticks = 0;
+        for (uint32_t i = 0; i < n_points; i++) {
+            float angle       = 2 * float(M_PI) * i / n_points;
+            cartesian[X_AXIS] = 10 * cosf(angle);
+            cartesian[Y_AXIS] = 10 * sinf(angle);
+            int32_t start     = getCpuTicks();
+            transform_cartesian_to_motors(motors, cartesian);
+            total_ticks += uint32_t(getCpuTicks() - start);
+        }
+        uint32_t avg = total_ticks / n_points;
+        log_info_to(out,
+                    "Kinematics " << name() << ": " << n_points << " transforms, avg " << avg << " ticks, "
+                                  << (avg ? ticks_per_us * 1000000 / avg : 0) << " segments/sec");
+    }
+
     void Kinematics::group(Configuration::HandlerBase& handler) { ::Kinematics::KinematicsFactory::factory(handler, _system); }
 
     void Kinematics::afterParse() {
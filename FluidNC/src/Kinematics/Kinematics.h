@@ -6,8 +6,11 @@
 #include "../MotionControl.h"
 #include "../Planner.h"
 #include "../Types.h"
+#include "../Channel.h"
 #include "src/Machine/Homing.h"
 
+#include <functional>
+
 /*
 Special types
 
@@ -47,6 +50,7 @@ namespace Kinematics {
         bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position);
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis);
         bool transform_cartesian_to_motors(float* motors, float* cartesian);
+        bool motor_rates(float* rates, float* cartesian, float* direction);
 
         void constrain_jog(float* target, plan_line_data_t* pl_data, float* position);
         bool invalid_line(float* target);
@@ -54,9 +58,14 @@ namespace Kinematics {
             float* target, plan_line_data_t* pl_data, float* position, float center[3], float radius, size_t caxes[3], bool is_clockwise_arc);
 
         bool canHome(AxisMask axisMask);
+        bool canPlanArcs();
+        bool boxLimits();
         bool kinematics_homing(AxisMask axisMask);
         void releaseMotors(AxisMask axisMask, MotorMask motors);
         bool limitReached(AxisMask& axisMask, MotorMask& motors, MotorMask limited);
+        void benchmark(Channel& out, uint32_t n_points);
+        void flush_held();
+        void drop_held();
 
     private:
         ::Kinematics::KinematicSystem* _system = nullptr;
@@ -87,11 +96,29 @@ namespace Kinematics {
 
         virtual bool transform_cartesian_to_motors(float* motors, float* cartesian) = 0;
 
+        // The Jacobian at cartesian times the unit vector direction: the motor travel per mm of
+        // cartesian travel that way.  Returns false if the kinematics do not provide it, or if
+        // cartesian is out of reach or at a singularity.
+        virtual bool motor_rates(float* rates, float* cartesian, float* direction) { return false; }
+
         virtual bool canHome(AxisMask axisMask) { return false; }
+        // True if arcs can be planned natively because motor space is cartesian space
+        virtual bool canPlanArcs() { return false; }
+        // True if invalid_line() and invalid_arc() test the cartesian path against the soft
+        // limits of each axis, so the extents of a job can be checked in their place
+        virtual bool boxLimits() { return false; }
+        // Times transform_cartesian_to_motors() over n_points points, for $Kinematics/Benchmark
+        virtual void benchmark(Channel& out, uint32_t n_points);
+
         virtual void releaseMotors(AxisMask axisMask, MotorMask motors) {}
         virtual bool limitReached(AxisMask& axisMask, MotorMask& motors, MotorMask limited) { return false; }
         virtual bool kinematics_homing(AxisMask& axisMask) { return false; }
 
+        // Kinematics that hold a move back until they see the next one plan it now, as
+        // before the planner is synchronized or runs dry, or forget it, as on a reset
+        virtual void flush_held() {}
+        virtual void drop_held() {}
+
         // Configuration interface.
         void afterParse() override {}
         void group(Configuration::HandlerBase& handler) override {}
@@ -102,6 +129,16 @@ namespace Kinematics {
 
         // Virtual base classes require a virtual destructor.
         virtual ~KinematicSystem() {}
+
+    protected:
+        // Splits lines for kinematics whose motor space is not cartesian.  Given
+        // the fraction of the line already done, returns where the next segment
+        // ends, as a fraction of the line.  step holds the fraction that the last
+        // segment covered; the next one starts from twice that and is halved
+        // until error(done, end), the distance from the line of the midpoint of
+        // the motor space chord, is within maxError.  Segments are not made
+        // shorter than minStep, and with maxError 0 they are all minStep long.
+        float segment_end(float done, float& step, float minStep, float maxError, const std::function<float(float, float)>& error);
     };
 
     using KinematicsFactory = Configuration::GenericFactory<KinematicSystem>;
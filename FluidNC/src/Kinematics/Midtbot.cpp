@@ -5,7 +5,32 @@
 */
 
 namespace Kinematics {
-    void Midtbot::group(Configuration::HandlerBase& handler) {}
+    void Midtbot::group(Configuration::HandlerBase& handler) { handler.section("pen_lift", _penLift); }
+
+    bool Midtbot::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
+        if (_penLift) {
+            return _penLift->line(target, pl_data, position, planner());
+        }
+        return CoreXY::cartesian_to_motors(target, pl_data, position);
+    }
+
+    PenLift::plan_t Midtbot::planner() {
+        return [this](float* target, plan_line_data_t* pl_data, float* position) {
+            return CoreXY::cartesian_to_motors(target, pl_data, position);
+        };
+    }
+
+    void Midtbot::flush_held() {
+        if (_penLift) {
+            _penLift->flush(planner());
+        }
+    }
+
+    void Midtbot::drop_held() {
+        if (_penLift) {
+            _penLift->drop();
+        }
+    }
 
     void Midtbot::init() {
         _x_scaler = 2.0;
@@ -12,6 +12,7 @@
 
 #include "Kinematics.h"
 #include "CoreXY.h"
+#include "PenLift.h"
 
 namespace Kinematics {
     class Midtbot : public CoreXY {
@@ -27,10 +28,18 @@ namespace Kinematics {
 
         void init() override;
         void group(Configuration::HandlerBase& handler) override;
+        bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
+        void flush_held() override;
+        void drop_held() override;
 
         // Name of the configurable. Must match the name registered in the cpp file.
         const char* name() const override { return "midtbot"; }
 
         ~Midtbot() {}
+
+    private:
+        PenLift* _penLift = nullptr;
+
+        PenLift::plan_t planner();
     };
 }  //  namespace Kinematics
@@ -5,8 +5,11 @@
 #include "../Machine/Homing.h"
 
 #include "../Protocol.h"  // protocol_execute_realtime
+#include "Driver/delay_usecs.h"  // getCpuTicks()
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>  // memcpy
 
 /*
   ==================== How it Works ====================================
@@ -17,7 +20,19 @@
 
   To make the moves straight and smooth on a delta, the cartesian moves
   are broken into small segments where the non linearity will not be noticed.
-  This is similar to how Grbl draws arcs.
+  This is similar to how Grbl draws arcs.  With kinematic_segment_error_mm set,
+  the segments are as long as they can be while the tool stays that close to
+  the line, but not shorter than kinematic_segment_len_mm.  Near the middle of
+  the work area, where the arms move nearly linearly, that takes far fewer
+  planner blocks.  With stepper_time_kinematics, lines are not broken up at all;
+  the planner plans each one in cartesian mm and the segment generator converts
+  the end of every step segment to arm angles as it goes.
+
+  The inverse transform runs for every segment, so it uses a float kernel with
+  the geometry terms worked out at init(), one division per point, and
+  polynomial approximations for the square root and arctangent.  Its angles
+  are within 2e-5 radians of the double precision math, closer than the
+  reference version kept for $Kinematics/Benchmark, which compares the two.
 
   For mpos reporting, the motor position in steps is proportional to arm angles 
   in radians, which is then converted to cartesian via the forward kinematics 
@@ -74,6 +89,8 @@ namespace Kinematics {
         handler.item("linkage_mm", re, 20.0, 500.0);
         handler.item("end_effector_triangle_mm", e, 20.0, 500.0);
         handler.item("kinematic_segment_len_mm", _kinematic_segment_len_mm, 0.05, 20.0);  //
+        handler.item("kinematic_segment_error_mm", _kinematic_segment_error_mm, 0.0, 1.0);
+        handler.item("stepper_time_kinematics", _stepper_time);
         handler.item("homing_mpos_radians", _homing_mpos);
         handler.item("soft_limits", _softLimits);
         handler.item("max_z_mm", _max_z, -10000.0, 0.0);  //
@@ -95,7 +112,15 @@ namespace Kinematics {
             }
         }
 
+        _ik_y1      = -0.5f * tan30 * f;
+        _ik_e_shift = 0.5f * tan30 * e;
+        _ik_k       = rf * rf - re * re - _ik_y1 * _ik_y1;
+        _ik_rf2     = rf * rf;
+
         init_position();
+        if (_softLimits) {
+            find_envelope();
+        }
     }
 
     void ParallelDelta::init_position() {
@@ -104,16 +129,15 @@ namespace Kinematics {
         // Calculate the Z offset at the arm zero angles ...
         // Z offset is the z distance from the motor axes to the end effector axes at zero angle
         motors_to_cartesian(cartesian, angles, 3);  // Sets the cartesian values
-        log_info("  Z Offset:" << cartesian[Z_AXIS]);
+        _z_offset = cartesian[Z_AXIS];
+        log_info("  Z Offset:" << _z_offset);
     }
 
     bool ParallelDelta::invalid_line(float* cartesian) {
         if (!_softLimits)
             return false;
 
-        float motors[MAX_N_AXIS] = { 0.0, 0.0, 0.0 };
-
-        if (!transform_cartesian_to_motors(motors, cartesian)) {
+        if (!in_envelope(cartesian, cartesian) && !reachable(cartesian)) {
             limit_error();
             return true;
         }
@@ -121,33 +145,158 @@ namespace Kinematics {
         return false;
     }
 
+    bool ParallelDelta::reachable(float* cartesian) {
+        float motors[MAX_N_AXIS];
+        return transform_cartesian_to_motors(motors, cartesian);
+    }
+
+    // Checks points around a circle about the Z axis, and around the circle of half its radius
+    bool ParallelDelta::ring_reachable(float z, float radius) {
+        const int spokes = 24;
+
+        float point[MAX_N_AXIS] = { 0.0, 0.0, 0.0 };
+        point[Z_AXIS]           = z;
+        for (int i = 0; i < spokes; i++) {
+            float angle = 2 * float(M_PI) * i / spokes;
+            for (float r = radius; r > radius / 4; r /= 2) {
+                point[X_AXIS] = r * cosf(angle);
+                point[Y_AXIS] = r * sinf(angle);
+                if (!reachable(point)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // The Z column is followed in 1mm steps from the Z offset, where the arms are level, to where
+    // it goes out of reach.  Each slice of it then gets the largest radius, found by bisection, at
+    // which circles at its bottom, middle and top are reachable, less a margin, as the checks are
+    // on a grid.
+    void ParallelDelta::find_envelope() {
+        const int bisections = 10;
+
+        float reach             = rf + re;
+        float point[MAX_N_AXIS] = { 0.0, 0.0, 0.0 };
+        _envelope_slice         = 0;
+
+        point[Z_AXIS] = _z_offset;
+        if (!reachable(point)) {
+            return;
+        }
+        float z_max = _z_offset;
+        for (point[Z_AXIS] = z_max + 1; point[Z_AXIS] - _z_offset < reach && reachable(point); point[Z_AXIS] += 1) {
+            z_max = point[Z_AXIS];
+        }
+        float z_min = _z_offset;
+        for (point[Z_AXIS] = z_min - 1; _z_offset - point[Z_AXIS] < reach && reachable(point); point[Z_AXIS] -= 1) {
+            z_min = point[Z_AXIS];
+        }
+        if (z_max - z_min < envelope_slices) {
+            return;
+        }
+
+        _envelope_z_min = z_min;
+        _envelope_slice = (z_max - z_min) / envelope_slices;
+        for (int slice = 0; slice < envelope_slices; slice++) {
+            float bottom = z_min + slice * _envelope_slice;
+            float inside = 0;
+            float beyond = reach;
+            for (int i = 0; i < bisections; i++) {
+                float r = (inside + beyond) / 2;
+                if (ring_reachable(bottom, r) && ring_reachable(bottom + _envelope_slice / 2, r) &&
+                    ring_reachable(bottom + _envelope_slice, r)) {
+                    inside = r;
+                } else {
+                    beyond = r;
+                }
+            }
+            _envelope_radius[slice] = 0.9f * inside;
+        }
+        int level = std::min(int((_z_offset - z_min) / _envelope_slice), envelope_slices - 1);
+        log_debug("  Jog envelope Z:" << z_min << " to " << z_max << " radius at Z offset:" << _envelope_radius[level]);
+    }
+
+    // The distance from the Z axis along a line is never more than at one of its ends, so the line
+    // is inside if both ends are within the smallest radius of the slices that it passes through
+    bool ParallelDelta::in_envelope(float* from, float* to) {
+        if (_envelope_slice == 0) {
+            return false;
+        }
+        float low  = (std::min(from[Z_AXIS], to[Z_AXIS]) - _envelope_z_min) / _envelope_slice;
+        float high = (std::max(from[Z_AXIS], to[Z_AXIS]) - _envelope_z_min) / _envelope_slice;
+        if (low < 0 || high > envelope_slices) {
+            return false;
+        }
+        float radius = rf + re;
+        for (int slice = int(low); slice < envelope_slices && slice <= int(high); slice++) {
+            radius = std::min(radius, _envelope_radius[slice]);
+        }
+        float from_r2 = from[X_AXIS] * from[X_AXIS] + from[Y_AXIS] * from[Y_AXIS];
+        float to_r2   = to[X_AXIS] * to[X_AXIS] + to[Y_AXIS] * to[Y_AXIS];
+        return std::max(from_r2, to_r2) <= radius * radius;
+    }
+
     // TO DO. This is not supported yet. Other levels of protection will prevent "damage"
     bool ParallelDelta::invalid_arc(
         float* target, plan_line_data_t* pl_data, float* position, float center[3], float radius, size_t caxes[3], bool is_clockwise_arc) {
         return false;
     }
 
-    // copied from Cartesian . Needs to be optimized for parallel delta.
+    // A jog that would leave the reachable volume is cut short where it leaves, rather than
+    // rejected.  That point is found by checking a few points along the jog and then bisecting
+    // between the last reachable one and the next, so a check costs at most 17 transforms, and
+    // none at all for a jog inside the envelope found at init().
     void ParallelDelta::constrain_jog(float* target, plan_line_data_t* pl_data, float* position) {
-        // log_debug("Jog Test: from(" << position[X_AXIS] << ")"
-        //                             << " to(" << target[X_AXIS] << ")");
+        const int samples    = 4;
+        const int bisections = 12;
+
         if (!_softLimits)
             return;
 
-        float motors[MAX_N_AXIS] = { 0.0, 0.0, 0.0 };
-
-        // Temp fix
-        // If the target is reachable do nothing
-        if (transform_cartesian_to_motors(motors, target)) {
+        pl_data->limits_checked = true;
+        if (in_envelope(position, target)) {
             return;
-        } else {
+        }
+        if (!reachable(position)) {
             log_warn("Kinematics soft limit jog rejection");
             copyAxes(target, position);
+            return;
         }
 
-        // TO DO better idea
-        // loop back from the target in increments of  kinematic_segment_len_mm unitl the position is valid.
-        // constrain to that target.
+        auto  n_axis = config->_axes->_numberAxis;
+        float point[MAX_N_AXIS];
+        auto  at = [&](float fraction) {
+            for (size_t axis = 0; axis < n_axis; axis++) {
+                point[axis] = position[axis] + (target[axis] - position[axis]) * fraction;
+            }
+            return reachable(point);
+        };
+
+        float good = 0.0f;
+        float bad  = 0.0f;
+        for (int i = 1; i <= samples; i++) {
+            float fraction = float(i) / samples;
+            if (!at(fraction)) {
+                bad = fraction;
+                break;
+            }
+            good = fraction;
+        }
+        if (bad == 0.0f) {
+            return;
+        }
+        for (int i = 0; i < bisections; i++) {
+            float fraction = (good + bad) / 2;
+            if (at(fraction)) {
+                good = fraction;
+            } else {
+                bad = fraction;
+            }
+        }
+        at(good);
+        copyAxes(target, point);
+        log_debug("Jog constrained to reachable volume");
     }
 
     bool ParallelDelta::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
@@ -190,20 +339,55 @@ namespace Kinematics {
         dz         = target[Z_AXIS] - position[Z_AXIS];
         float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
 
-        // determine the number of segments we need	... round up so there is at least 1 (except when dist is 0)
+        if (dist == 0) {
+            return true;
+        }
+
+        if (_stepper_time) {
+            // The segment generator follows the line, so the planner sees it whole and in mm
+            return mc_move_cartesian(target, pl_data, position);
+        }
+
+        // determine the number of segments we need	... round up so there is at least 1
+        // With kinematic_segment_error_mm, segments are longer where the arms move nearly linearly
         uint32_t segment_count = ceil(dist / _kinematic_segment_len_mm);
 
-        float segment_dist = dist / ((float)segment_count);  // distance of each segment...will be used for feedrate conversion
+        float min_step = 1.0f / float(segment_count);
+        float step     = 0.5f;  // The first segment tries the whole move
+        float done     = 0.0f;
+
+        // How far the tool strays from the line at the middle of a segment, when the arms move linearly
+        auto chord_error = [&](float from, float to) {
+            float p0[3], p1[3], pm[3], m0[3], m1[3], mm[3];
+            float c[3] = { INFINITY, INFINITY, INFINITY };  // Stays if the forward transform fails
+            for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+                float d  = target[axis] - position[axis];
+                p0[axis] = position[axis] + d * from;
+                p1[axis] = position[axis] + d * to;
+                pm[axis] = (p0[axis] + p1[axis]) / 2;
+            }
+            if (!transform_cartesian_to_motors(m0, p0) || !transform_cartesian_to_motors(m1, p1)) {
+                return INFINITY;
+            }
+            for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+                mm[axis] = (m0[axis] + m1[axis]) / 2;
+            }
+            motors_to_cartesian(c, mm, 3);
+            return three_axis_dist(c, pm);
+        };
 
-        for (uint32_t segment = 1; segment <= segment_count; segment++) {
+        while (done < 1.0f) {
             if (sys.abort) {
                 return true;
             }
-            //log_debug("Segment:" << segment << " of " << segment_count);
+            float end          = segment_end(done, step, min_step, _kinematic_segment_error_mm, chord_error);
+            float segment_dist = dist * (end - done);  // distance of each segment...will be used for feedrate conversion
+            done               = end;
+
             // determine this segment's target
-            seg_target[X_AXIS] = position[X_AXIS] + (dx / float(segment_count) * segment);
-            seg_target[Y_AXIS] = position[Y_AXIS] + (dy / float(segment_count) * segment);
-            seg_target[Z_AXIS] = position[Z_AXIS] + (dz / float(segment_count) * segment);
+            seg_target[X_AXIS] = position[X_AXIS] + dx * end;
+            seg_target[Y_AXIS] = position[Y_AXIS] + dy * end;
+            seg_target[Z_AXIS] = position[Z_AXIS] + dz * end;
 
             //log_debug("Segment target (" << seg_target[0] << "," << seg_target[1] << "," << seg_target[2] << ")");
 
@@ -326,10 +510,170 @@ namespace Kinematics {
         return true;
     }
 
+    // 1/sqrt(x) from the bit pattern estimate, with three Newton steps for full float precision
+    static inline float fast_rsqrt(float x) {
+        uint32_t i;
+        float    y;
+        memcpy(&i, &x, sizeof(i));
+        i = 0x5f3759df - (i >> 1);
+        memcpy(&y, &i, sizeof(y));
+        float half = 0.5f * x;
+        y          = y * (1.5f - half * y * y);
+        y          = y * (1.5f - half * y * y);
+        y          = y * (1.5f - half * y * y);
+        return y;
+    }
+
+    // Hastings' minimax polynomial for atan on [-1, 1], within 2e-6 radians, and
+    // atan(t) = +-pi/2 - atan(1/t) outside it
+    static inline float fast_atan(float t) {
+        float offset = 0.0f;
+        if (t > 1.0f) {
+            offset = float(M_PI / 2);
+            t      = -1.0f / t;
+        } else if (t < -1.0f) {
+            offset = -float(M_PI / 2);
+            t      = -1.0f / t;
+        }
+        float t2 = t * t;
+        float p  = -0.01172120f;
+        p        = p * t2 + 0.05265332f;
+        p        = p * t2 - 0.11643287f;
+        p        = p * t2 + 0.19354346f;
+        p        = p * t2 - 0.33262347f;
+        p        = p * t2 + 0.99997726f;
+        return offset + t * p;
+    }
+
+    // delta_calcAngleYZ() with the init() constants, and inv_z0 = 1/z0 shared by the towers
+    bool ParallelDelta::fast_calcAngleYZ(float x0, float y0, float z0, float inv_z0, float& theta) {
+        float y1 = _ik_y1;
+        y0 -= _ik_e_shift;
+        // z = a + b*y
+        float a  = (x0 * x0 + y0 * y0 + z0 * z0 + _ik_k) * 0.5f * inv_z0;
+        float b  = (y1 - y0) * inv_z0;
+        float b1 = b * b + 1.0f;
+        float ab = a + b * y1;
+        float d  = _ik_rf2 * b1 - ab * ab;
+        if (!(d > 0.0f)) {
+            return false;
+        }
+        float yj = (y1 - a * b - d * fast_rsqrt(d)) / b1;  // choosing outer point
+        float zj = a + b * yj;
+
+        theta = fast_atan(-zj / (y1 - yj)) + ((yj > y1) ? float(M_PI) : 0.0f);
+        return true;
+    }
+
     void ParallelDelta::releaseMotors(AxisMask axisMask, MotorMask motors) {}
 
     bool ParallelDelta::transform_cartesian_to_motors(float* motors, float* cartesian) {
         motors[0] = motors[1] = motors[2] = 0;
+
+        float x = cartesian[X_AXIS];
+        float y = cartesian[Y_AXIS];
+        float z = cartesian[Z_AXIS];
+        if (z > _max_z) {
+            log_debug("Kinematics transform error. Target:" << z << " exceeds max_z:" << _max_z);
+            return false;
+        }
+        if (z == 0.0f) {
+            return false;  // In the plane of the cranks
+        }
+        float inv_z = 1.0f / z;
+
+        return fast_calcAngleYZ(x, y, z, inv_z, motors[0]) &&
+               fast_calcAngleYZ(x * cos120 + y * sin120, y * cos120 - x * sin120, z, inv_z, motors[1]) &&  // rotate coords to +120 deg
+               fast_calcAngleYZ(x * cos120 - y * sin120, y * cos120 + x * sin120, z, inv_z, motors[2]);    // rotate coords to -120 deg
+    }
+
+    // With the knee of the crank at K(theta) = (0, y1 - rf cos(theta), -rf sin(theta)) and the
+    // effector joint at Q, the linkage keeps |Q - K|^2 = re^2, so moving Q by dQ turns the crank by
+    // dtheta = (Q - K).dQ / ((Q - K).dK/dtheta).  The divisor goes to zero as the linkage lines up
+    // with the crank's travel, where the arm can no longer push the effector that way.
+    bool ParallelDelta::tower_rate(float x0, float y0, float z0, float dx, float dy, float dz, float theta, float& rate) {
+        float s       = sinf(theta);
+        float c       = cosf(theta);
+        float qx      = x0;
+        float qy      = y0 - _ik_e_shift - (_ik_y1 - rf * c);
+        float qz      = z0 + rf * s;
+        float divisor = rf * (qy * s - qz * c);
+        if (fabsf(divisor) < 1e-6f * rf * re) {
+            return false;
+        }
+        rate = (qx * dx + qy * dy + qz * dz) / divisor;
+        return true;
+    }
+
+    bool ParallelDelta::motor_rates(float* rates, float* cartesian, float* direction) {
+        float angles[MAX_N_AXIS];
+        if (!transform_cartesian_to_motors(angles, cartesian)) {
+            return false;
+        }
+        float x      = cartesian[X_AXIS];
+        float y      = cartesian[Y_AXIS];
+        float z      = cartesian[Z_AXIS];
+        float dx     = direction[X_AXIS];
+        float dy     = direction[Y_AXIS];
+        float dz     = direction[Z_AXIS];
+        auto  n_axis = config->_axes->_numberAxis;
+        for (size_t axis = 3; axis < n_axis; axis++) {
+            rates[axis] = direction[axis];
+        }
+        // The towers at +-120 deg see the point and the direction rotated the same way
+        float x1  = x * cos120 + y * sin120, y1 = y * cos120 - x * sin120;
+        float x2  = x * cos120 - y * sin120, y2 = y * cos120 + x * sin120;
+        float dx1 = dx * cos120 + dy * sin120, dy1 = dy * cos120 - dx * sin120;
+        float dx2 = dx * cos120 - dy * sin120, dy2 = dy * cos120 + dx * sin120;
+        return tower_rate(x, y, z, dx, dy, dz, angles[0], rates[0]) && tower_rate(x1, y1, z, dx1, dy1, dz, angles[1], rates[1]) &&
+               tower_rate(x2, y2, z, dx2, dy2, dz, angles[2], rates[2]);
+    }
+
+    // Points on a spiral below the arms at zero angle, where the work area is
+    void ParallelDelta::benchmark(Channel& out, uint32_t n_points) {
+        float cartesian[MAX_N_AXIS] = { 0 };
+        float fast[MAX_N_AXIS];
+        float reference[MAX_N_AXIS];
+
+        uint32_t fast_ticks = 0;
+        uint32_t ref_ticks  = 0;
+        uint32_t reachable  = 0;
+        float    max_diff   = 0;
+        float    radius     = 0.5f * rf;
+        for (uint32_t i = 0; i < n_points; i++) {
+            float angle       = 0.1f * i;
+            float r           = radius * (i % 100) / 100;
+            cartesian[X_AXIS] = r * cosf(angle);
+            cartesian[Y_AXIS] = r * sinf(angle);
+            cartesian[Z_AXIS] = _z_offset - 0.25f * re * (i % 37) / 37;
+
+            int32_t start = getCpuTicks();
+            bool    ok    = reference_cartesian_to_motors(reference, cartesian);
+            int32_t mid   = getCpuTicks();
+            bool    fok   = transform_cartesian_to_motors(fast, cartesian);
+            ref_ticks += uint32_t(mid - start);
+            fast_ticks += uint32_t(getCpuTicks() - mid);
+            if (ok && fok) {
+                ++reachable;
+                for (int axis = 0; axis < 3; axis++) {
+                    max_diff = std::max(max_diff, std::abs(fast[axis] - reference[axis]));
+                }
+            }
+        }
+        uint32_t ref_avg  = ref_ticks / n_points;
+        uint32_t fast_avg = fast_ticks / n_points;
+        log_info_to(out,
+                    "Kinematics parallel_delta: " << n_points << " transforms, " << reachable << " reachable, max difference " << max_diff
+                                                  << " radians");
+        log_info_to(out,
+                    "  Reference avg " << ref_avg << " ticks, " << (ref_avg ? ticks_per_us * 1000000 / ref_avg : 0) << " segments/sec");
+        log_info_to(out,
+                    "  Fast avg " << fast_avg << " ticks, " << (fast_avg ? ticks_per_us * 1000000 / fast_avg : 0) << " segments/sec");
+    }
+
+    // The original double precision transform, for comparison
+    bool ParallelDelta::reference_cartesian_to_motors(float* motors, float* cartesian) {
+        motors[0] = motors[1] = motors[2] = 0;
         bool calc_ok                      = false;
 
         if (cartesian[Z_AXIS] > _max_z) {
@@ -37,8 +37,11 @@ namespace Kinematics {
         bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
         bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool motor_rates(float* rates, float* cartesian, float* direction) override;
         //bool soft_limit_error_exists(float* cartesian) override;
         bool         kinematics_homing(AxisMask& axisMask) override;
+        bool         canPlanArcs() override { return false; }
+        bool         boxLimits() override { return false; }
         virtual void constrain_jog(float* cartesian, plan_line_data_t* pl_data, float* position) override;
         virtual bool invalid_line(float* cartesian) override;
         virtual bool invalid_arc(float*            target,
@@ -51,6 +54,9 @@ namespace Kinematics {
 
         void releaseMotors(AxisMask axisMask, MotorMask motors) override;
 
+        // Times the fast kernel against the reference and reports the largest difference
+        void benchmark(Channel& out, uint32_t n_points) override;
+
         // Configuration handlers:
         //void         validate() const override {}
         virtual void group(Configuration::HandlerBase& handler) override;
@@ -69,13 +75,36 @@ namespace Kinematics {
         float re = 133.50;
         float e  = 86.603;
 
-        float _kinematic_segment_len_mm = 1.0;  // the maximun segment length the move is broken into
-        bool  _softLimits               = false;
-        float _homing_mpos              = 0.0;
-        float _max_z                    = 0.0;
-        bool  _use_servos               = true;  // servo use a special homing
+        float _kinematic_segment_len_mm   = 1.0;  // the segment length the move is broken into, the shortest with an error set
+        float _kinematic_segment_error_mm = 0.0;  // if set, segments are longer while within this of the line
+        bool  _stepper_time               = false;  // convert to arm angles in the segment generator
+        bool  _softLimits                 = false;
+        float _homing_mpos                = 0.0;
+        float _max_z                      = 0.0;
+        bool  _use_servos                 = true;  // servo use a special homing
+
+        // Per tower constants for the fast kernel, from the geometry at init()
+        float _ik_y1;       // Crank axis y, -f/2 * tan 30
+        float _ik_e_shift;  // End effector joint offset, e/2 * tan 30
+        float _ik_k;        // rf^2 - re^2 - y1^2
+        float _ik_rf2;      // rf^2
+        float _z_offset = 0;
+
+        // Slices of the Z column, each with the radius about the Z axis within which init() found
+        // every point reachable, so that most jogs need no transforms to check
+        static const int envelope_slices = 16;
+        float            _envelope_z_min = 0;
+        float            _envelope_slice = 0;  // mm of Z per slice, 0 if none was found
+        float            _envelope_radius[envelope_slices];
 
         bool  delta_calcAngleYZ(float x0, float y0, float z0, float& theta);
+        bool  fast_calcAngleYZ(float x0, float y0, float z0, float inv_z0, float& theta);
+        bool  reference_cartesian_to_motors(float* motors, float* cartesian);
+        bool  reachable(float* cartesian);
+        bool  ring_reachable(float z, float radius);
+        void  find_envelope();
+        bool  in_envelope(float* from, float* to);
+        bool  tower_rate(float x0, float y0, float z0, float dx, float dy, float dz, float theta, float& rate);
         float three_axis_dist(float* point1, float* point2);
 
     protected:
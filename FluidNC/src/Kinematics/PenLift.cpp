@@ -0,0 +1,124 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "PenLift.h"
+
+#include "../Machine/MachineConfig.h"  // config
+
+#include <algorithm>
+#include <cmath>
+
+namespace Kinematics {
+    // Only the pen axis changes
+    bool PenLift::pen_only(float* target, float* position) {
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if ((target[axis] != position[axis]) != (int32_t(axis) == _axis)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A G0 in X and Y only, with the pen where it is
+    bool PenLift::travel(float* target, plan_line_data_t* pl_data, float* position) {
+        if (!pl_data->motion.rapidMotion || pl_data->is_jog) {
+            return false;
+        }
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            if (target[axis] != position[axis]) {
+                return false;
+            }
+        }
+        return target[X_AXIS] != position[X_AXIS] || target[Y_AXIS] != position[Y_AXIS];
+    }
+
+    // The distance that a travel covers at its full rate in ms, up to half of it
+    float PenLift::overlap_mm(float* target, float* position, int32_t ms) {
+        auto  axes = config->_axes->_axis;
+        float dx   = fabsf(target[X_AXIS] - position[X_AXIS]);
+        float dy   = fabsf(target[Y_AXIS] - position[Y_AXIS]);
+        float xy   = hypot_f(dx, dy);
+        float rate = std::min(dx ? axes[X_AXIS]->_maxRate * xy / dx : INFINITY, dy ? axes[Y_AXIS]->_maxRate * xy / dy : INFINITY);
+        return std::min(rate * ms / 60000.0f, xy / 2);
+    }
+
+    // Plans from one point to another, on a copy of the planner data since plan() can change it
+    bool PenLift::plan_piece(float* from, float* to, plan_line_data_t* pl_data, const plan_t& plan) {
+        plan_line_data_t data = *pl_data;
+        float            start[MAX_N_AXIS];
+        float            end[MAX_N_AXIS];
+        copyAxes(start, from);
+        copyAxes(end, to);
+        return plan(end, &data, start);
+    }
+
+    void PenLift::hold(Held held, float* from, float* to, plan_line_data_t* pl_data) {
+        _held = held;
+        copyAxes(_from, from);
+        copyAxes(_to, to);
+        _data = *pl_data;
+    }
+
+    void PenLift::flush(const plan_t& plan) {
+        if (_held != None) {
+            _held = None;
+            plan_piece(_from, _to, &_data, plan);
+        }
+    }
+
+    bool PenLift::line(float* target, plan_line_data_t* pl_data, float* position, const plan_t& plan) {
+        float start[MAX_N_AXIS];
+        copyAxes(start, position);
+
+        if (_held == Tail) {
+            _held = None;
+            if (pen_only(target, start) && target[_axis] < start[_axis]) {
+                // Lower the pen over the end of the travel
+                _to[_axis] = target[_axis];
+                return plan_piece(_from, _to, &_data, plan);
+            }
+            plan_piece(_from, _to, &_data, plan);
+        }
+
+        if (_held == Lift) {
+            _held = None;
+            if (travel(target, pl_data, start)) {
+                // Lift the pen over the start of the travel, which then goes on from there
+                float mm = overlap_mm(target, start, _liftOverlapMs);
+                float xy = hypot_f(target[X_AXIS] - start[X_AXIS], target[Y_AXIS] - start[Y_AXIS]);
+                float lifted[MAX_N_AXIS];
+                copyAxes(lifted, start);
+                lifted[X_AXIS] += (target[X_AXIS] - start[X_AXIS]) * mm / xy;
+                lifted[Y_AXIS] += (target[Y_AXIS] - start[Y_AXIS]) * mm / xy;
+                if (!plan_piece(_from, lifted, pl_data, plan)) {
+                    return false;
+                }
+                copyAxes(start, lifted);
+            } else {
+                plan_piece(_from, _to, &_data, plan);
+            }
+        }
+
+        if (_liftOverlapMs && pen_only(target, start) && target[_axis] > start[_axis]) {
+            hold(Lift, start, target, pl_data);
+            return true;
+        }
+
+        if (_lowerOverlapMs && travel(target, pl_data, start)) {
+            float mm = overlap_mm(target, start, _lowerOverlapMs);
+            float xy = hypot_f(target[X_AXIS] - start[X_AXIS], target[Y_AXIS] - start[Y_AXIS]);
+            float tail[MAX_N_AXIS];
+            copyAxes(tail, target);
+            tail[X_AXIS] -= (target[X_AXIS] - start[X_AXIS]) * mm / xy;
+            tail[Y_AXIS] -= (target[Y_AXIS] - start[Y_AXIS]) * mm / xy;
+            if (!plan_piece(start, tail, pl_data, plan)) {
+                return false;
+            }
+            hold(Tail, tail, target, pl_data);
+            return true;
+        }
+
+        return plan_piece(start, target, pl_data, plan);
+    }
+}
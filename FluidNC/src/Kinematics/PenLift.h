@@ -0,0 +1,73 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  PenLift.h - pen moves that overlap the travel of a plotter
+
+    pen_lift:
+      axis: 2
+      lift_overlap_ms: 60
+      lower_overlap_ms: 40
+
+  A plotter lifts and lowers its pen with moves of the pen axis alone, and each one is a
+  corner of 90 degrees that the planner has to stop at, twice per stroke.  With pen_lift,
+  a lift - a move of only the pen axis, upward - is held until the next line, and if that
+  is a G0 travel, the lift is planned together with the start of the travel, over the
+  distance that the travel covers at full speed in lift_overlap_ms.  The end of each G0
+  travel is held in the same way, and a lower that follows it is planned together with
+  it, over lower_overlap_ms.  The pen axis rate and acceleration still bound those pieces,
+  so a servo gets at least the time that they allow, and the XY motion only slows there as
+  much as that needs.  A 0 overlap turns that side off.
+
+  A held move is planned as it was as soon as the next line cannot take it, and before
+  the planner is synchronized or left to run dry, so nothing waits on a line that may not
+  come.
+*/
+
+#include "../Configuration/Configurable.h"
+#include "../Planner.h"  // plan_line_data_t
+
+#include <functional>
+
+namespace Kinematics {
+    class PenLift : public Configuration::Configurable {
+    public:
+        using plan_t = std::function<bool(float* target, plan_line_data_t* pl_data, float* position)>;
+
+        // Plans a line through plan(), holding back or merging pen moves and travel ends
+        bool line(float* target, plan_line_data_t* pl_data, float* position, const plan_t& plan);
+
+        // Plans the held move, if any
+        void flush(const plan_t& plan);
+
+        // Forgets the held move, as on a reset, when the positions are synchronized anew
+        void drop() { _held = None; }
+
+        bool holding() const { return _held != None; }
+
+        void group(Configuration::HandlerBase& handler) override {
+            handler.item("axis", _axis, 2, MAX_N_AXIS - 1);
+            handler.item("lift_overlap_ms", _liftOverlapMs, 0, 1000);
+            handler.item("lower_overlap_ms", _lowerOverlapMs, 0, 1000);
+        }
+
+    private:
+        enum Held { None, Lift, Tail };
+
+        int32_t _axis           = 2;
+        int32_t _liftOverlapMs  = 0;
+        int32_t _lowerOverlapMs = 0;
+
+        Held             _held = None;
+        float            _from[MAX_N_AXIS];
+        float            _to[MAX_N_AXIS];
+        plan_line_data_t _data;
+
+        bool  pen_only(float* target, float* position);
+        bool  travel(float* target, plan_line_data_t* pl_data, float* position);
+        float overlap_mm(float* target, float* position, int32_t ms);
+        bool  plan_piece(float* from, float* to, plan_line_data_t* pl_data, const plan_t& plan);
+        void  hold(Held held, float* from, float* to, plan_line_data_t* pl_data);
+    };
+}
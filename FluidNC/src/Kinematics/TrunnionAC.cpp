@@ -0,0 +1,253 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "TrunnionAC.h"
+
+#include "../Machine/MachineConfig.h"
+#include "../Limits.h"  // limitsMinPosition(), limit_error()
+#include "../GCode.h"   // gc_state
+#include "../System.h"  // sys
+
+#include <cmath>
+
+/*
+  ==================== How it Works ====================================
+  The table turns the workpiece under the tool, so for the tool tip to follow
+  the programmed path on the workpiece, X, Y and Z have to follow that path as
+  the table moves it.  A point P on the workpiece, given as it is with A and C
+  at zero, is turned by C about the C axis and then that by A about the A axis.
+  The result is where the tool tip has to be in machine coordinates.
+
+  Positive angles turn the table counterclockwise as seen from the positive end
+  of the axis, so a C move of +90 takes a point on +X to +Y.
+
+  The pivots are in machine coordinates of the tool tip with no tool length
+  offset: with A and C at zero, _a_pivot_y and _a_pivot_z are where the A axis
+  crosses the YZ plane and _c_pivot_x and _c_pivot_y where the C axis crosses
+  the XY plane.  A G43 tool length offset moves the controlled point up the
+  tool, so it is taken out before the transform and put back after it.
+
+  A straight move on the workpiece is a curve in machine coordinates whenever
+  A or C moves, so moves are broken into segments.  Each segment is as long as
+  it can be while the middle of the straight segment in machine coordinates
+  stays within segment_error_mm of the curve, but not shorter than
+  segment_len_mm.  Moves that only change X, Y and Z are a single segment.  With
+  stepper_time_kinematics, moves are not broken up at all; the segment generator
+  transforms the end of every step segment instead.
+
+  Feed rates are for the programmed move, all axes together as on a cartesian
+  machine, and each segment gets the rate that takes it the same time.  Inverse
+  time feed rates are divided up the same way.
+
+  Soft limits apply to the machine positions of the axes.
+
+kinematics:
+  TrunnionAC:
+    a_pivot_y_mm: 0.000
+    a_pivot_z_mm: -50.000
+    c_pivot_x_mm: 0.000
+    c_pivot_y_mm: 0.000
+    segment_len_mm: 1.000
+    segment_error_mm: 0.010
+    stepper_time_kinematics: false
+*/
+
+namespace Kinematics {
+    const float dtr = float(M_PI / 180.0);  // degrees to radians
+
+    void TrunnionAC::group(Configuration::HandlerBase& handler) {
+        handler.item("a_pivot_y_mm", _a_pivot_y, -10000.0, 10000.0);
+        handler.item("a_pivot_z_mm", _a_pivot_z, -10000.0, 10000.0);
+        handler.item("c_pivot_x_mm", _c_pivot_x, -10000.0, 10000.0);
+        handler.item("c_pivot_y_mm", _c_pivot_y, -10000.0, 10000.0);
+        handler.item("segment_len_mm", _segment_len, 0.01, 100.0);
+        handler.item("segment_error_mm", _segment_error, 0.0, 1.0);
+        handler.item("stepper_time_kinematics", _stepper_time);
+    }
+
+    void TrunnionAC::init() {
+        log_info("Kinematic system: " << name() << " A pivot Y:" << _a_pivot_y << " Z:" << _a_pivot_z << " C pivot X:" << _c_pivot_x
+                                      << " Y:" << _c_pivot_y);
+        if (config->_axes->_numberAxis <= C_AXIS) {
+            log_error("TrunnionAC kinematics needs the a and c axes");
+        }
+        init_position();
+    }
+
+    bool TrunnionAC::transform_cartesian_to_motors(float* motors, float* cartesian) {
+        auto  n_axis = config->_axes->_numberAxis;
+        float tlo    = gc_state.tool_length_offset;
+        float a      = cartesian[A_AXIS] * dtr;
+        float c      = cartesian[C_AXIS] * dtr;
+
+        // C turns the point about the C axis
+        float dx = cartesian[X_AXIS] - _c_pivot_x;
+        float dy = cartesian[Y_AXIS] - _c_pivot_y;
+        float x  = _c_pivot_x + dx * cosf(c) - dy * sinf(c);
+        float y  = _c_pivot_y + dx * sinf(c) + dy * cosf(c);
+        float z  = cartesian[Z_AXIS] - tlo;
+
+        // A turns that about the A axis
+        dy = y - _a_pivot_y;
+        float dz = z - _a_pivot_z;
+
+        for (size_t axis = A_AXIS; axis < n_axis; axis++) {
+            motors[axis] = cartesian[axis];
+        }
+        motors[X_AXIS] = x;
+        motors[Y_AXIS] = _a_pivot_y + dy * cosf(a) - dz * sinf(a);
+        motors[Z_AXIS] = _a_pivot_z + dy * sinf(a) + dz * cosf(a) + tlo;
+        return true;
+    }
+
+    void TrunnionAC::motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
+        float tlo = gc_state.tool_length_offset;
+        float a   = motors[A_AXIS] * dtr;
+        float c   = motors[C_AXIS] * dtr;
+
+        // Turns the tool back by -A and then by -C
+        float dy = motors[Y_AXIS] - _a_pivot_y;
+        float dz = motors[Z_AXIS] - tlo - _a_pivot_z;
+        float y  = _a_pivot_y + dy * cosf(a) + dz * sinf(a);
+        float z  = _a_pivot_z - dy * sinf(a) + dz * cosf(a);
+
+        float dx = motors[X_AXIS] - _c_pivot_x;
+        dy       = y - _c_pivot_y;
+
+        for (size_t axis = A_AXIS; axis < n_axis; axis++) {
+            cartesian[axis] = motors[axis];
+        }
+        cartesian[X_AXIS] = _c_pivot_x + dx * cosf(c) + dy * sinf(c);
+        cartesian[Y_AXIS] = _c_pivot_y - dx * sinf(c) + dy * cosf(c);
+        cartesian[Z_AXIS] = z + tlo;
+    }
+
+    bool TrunnionAC::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
+        auto n_axis = config->_axes->_numberAxis;
+
+        float total_cartesian_distance = vector_distance(position, target, n_axis);
+        if (total_cartesian_distance == 0) {
+            return true;
+        }
+
+        float motor_start[MAX_N_AXIS];
+        float motor_end[MAX_N_AXIS];
+        transform_cartesian_to_motors(motor_start, position);
+
+        // Without rotation the transform only moves the path, so it stays straight and as long
+        if (target[A_AXIS] == position[A_AXIS] && target[C_AXIS] == position[C_AXIS]) {
+            transform_cartesian_to_motors(motor_end, target);
+            return mc_move_motors(motor_end, pl_data);
+        }
+
+        if (_stepper_time) {
+            // The segment generator follows the move, so the planner sees it whole
+            return mc_move_cartesian(target, pl_data, position);
+        }
+
+        auto lerp = [&](float* point, float fraction) {
+            for (size_t axis = 0; axis < n_axis; axis++) {
+                point[axis] = position[axis] + (target[axis] - position[axis]) * fraction;
+            }
+        };
+
+        // How far the tool strays from the path at the middle of a segment, when the axes move linearly
+        auto chord_error = [&](float from, float to) {
+            float p[MAX_N_AXIS], m0[MAX_N_AXIS], m1[MAX_N_AXIS], mm[MAX_N_AXIS];
+            lerp(p, from);
+            transform_cartesian_to_motors(m0, p);
+            lerp(p, to);
+            transform_cartesian_to_motors(m1, p);
+            lerp(p, (from + to) / 2);
+            transform_cartesian_to_motors(mm, p);
+            float error_sqr = 0;
+            for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+                float d = mm[axis] - (m0[axis] + m1[axis]) / 2;
+                error_sqr += d * d;
+            }
+            return sqrtf(error_sqr);
+        };
+
+        uint32_t segment_count = ceilf(total_cartesian_distance / _segment_len);
+
+        float feed_rate = pl_data->feed_rate;
+        float min_step  = 1.0f / float(segment_count);
+        float step      = 0.5f;  // The first segment tries the whole move
+        float done      = 0.0f;
+
+        while (done < 1.0f) {
+            if (sys.abort) {
+                return true;
+            }
+            float end      = segment_end(done, step, min_step, _segment_error, chord_error);
+            float fraction = end - done;
+            done           = end;
+
+            float cartesian_segment_end[MAX_N_AXIS];
+            lerp(cartesian_segment_end, end);
+            transform_cartesian_to_motors(motor_end, cartesian_segment_end);
+
+            if (pl_data->motion.inverseTime) {
+                pl_data->feed_rate = feed_rate / fraction;
+            } else if (!pl_data->motion.rapidMotion) {
+                pl_data->feed_rate = feed_rate * vector_distance(motor_start, motor_end, n_axis) / (total_cartesian_distance * fraction);
+            }
+
+            // mc_move_motors() returns false if a jog is cancelled.
+            // In that case we stop sending segments to the planner.
+            if (!mc_move_motors(motor_end, pl_data)) {
+                return false;
+            }
+            copyAxes(motor_start, motor_end);
+        }
+        return true;
+    }
+
+    // Returns the first axis whose machine position is outside its soft limits, or -1
+    int TrunnionAC::soft_limit_axis(float* motors) {
+        auto axes   = config->_axes;
+        auto n_axis = axes->_numberAxis;
+        for (int axis = 0; axis < n_axis; axis++) {
+            if (axes->_axis[axis]->_softLimits && (motors[axis] < limitsMinPosition(axis) || motors[axis] > limitsMaxPosition(axis))) {
+                return axis;
+            }
+        }
+        return -1;
+    }
+
+    // Only the end of the move is checked.  The machine path between the ends bulges out as
+    // the table turns, so a move can pass outside the limits when its ends are inside them.
+    bool TrunnionAC::invalid_line(float* cartesian) {
+        float motors[MAX_N_AXIS];
+        transform_cartesian_to_motors(motors, cartesian);
+        int axis = soft_limit_axis(motors);
+        if (axis >= 0) {
+            limit_error(axis, motors[axis]);
+            return true;
+        }
+        return false;
+    }
+
+    bool TrunnionAC::invalid_arc(
+        float* target, plan_line_data_t* pl_data, float* position, float center[3], float radius, size_t caxes[3], bool is_clockwise_arc) {
+        pl_data->limits_checked = true;
+        return invalid_line(target);
+    }
+
+    // The axes cannot be clipped one at a time as on a cartesian machine, since each machine
+    // axis depends on several programmed ones, so a jog that ends outside the limits is dropped.
+    void TrunnionAC::constrain_jog(float* target, plan_line_data_t* pl_data, float* position) {
+        float motors[MAX_N_AXIS];
+        transform_cartesian_to_motors(motors, target);
+        int axis = soft_limit_axis(motors);
+        if (axis >= 0) {
+            log_warn("Jog rejected by soft limit on " << Machine::Axes::_names[axis]);
+            copyAxes(target, position);
+        }
+        pl_data->limits_checked = true;
+    }
+
+    // Configuration registration
+    namespace {
+        KinematicsFactory::InstanceBuilder<TrunnionAC> registration("TrunnionAC");
+    }
+}
@@ -0,0 +1,67 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+	TrunnionAC.h
+
+	Rotary tool center point control for a trunnion table: an A axis that tilts
+	about a line parallel to X, carrying a C axis table that turns about its own
+	Z axis.  G-code gives the tool tip position on the workpiece as it sits with
+	A and C at zero, and the kinematics move X, Y and Z to wherever the table has
+	turned that point to.
+*/
+
+#include "Kinematics.h"
+#include "Cartesian.h"
+
+namespace Kinematics {
+    class TrunnionAC : public Cartesian {
+    public:
+        TrunnionAC() = default;
+
+        TrunnionAC(const TrunnionAC&)            = delete;
+        TrunnionAC(TrunnionAC&&)                 = delete;
+        TrunnionAC& operator=(const TrunnionAC&) = delete;
+        TrunnionAC& operator=(TrunnionAC&&)      = delete;
+
+        // Kinematic Interface
+
+        void init() override;
+        bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
+        void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
+        bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool canPlanArcs() override { return false; }
+        bool boxLimits() override { return false; }  // Its limits are on the motor positions
+
+        void constrain_jog(float* cartesian, plan_line_data_t* pl_data, float* position) override;
+        bool invalid_line(float* cartesian) override;
+        bool invalid_arc(float*            target,
+                         plan_line_data_t* pl_data,
+                         float*            position,
+                         float             center[3],
+                         float             radius,
+                         size_t            caxes[3],
+                         bool              is_clockwise_arc) override;
+
+        // Configuration handlers:
+        void group(Configuration::HandlerBase& handler) override;
+
+        // Name of the configurable. Must match the name registered in the cpp file.
+        const char* name() const override { return "TrunnionAC"; }
+
+        ~TrunnionAC() {}
+
+    private:
+        int soft_limit_axis(float* motors);
+
+        // Parameters
+        float _a_pivot_y     = 0;  // Where the A axis crosses the YZ plane, in machine coordinates
+        float _a_pivot_z     = 0;
+        float _c_pivot_x     = 0;  // Where the C axis crosses the XY plane with A at zero
+        float _c_pivot_y     = 0;
+        float _segment_len   = 1.0;    // The shortest segment, and the length of all of them without an error set
+        float _segment_error = 0.01;   // If set, segments are longer while the tool stays this close to the path
+        bool  _stepper_time  = false;  // Transform in the segment generator
+    };
+}  //  namespace Kinematics
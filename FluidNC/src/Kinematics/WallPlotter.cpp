@@ -15,6 +15,9 @@ namespace Kinematics {
         handler.item("right_anchor_y", _right_anchor_y);
 
         handler.item("segment_length", _segment_length);
+        handler.item("segment_error_mm", _segment_error, 0.0, 10.0);
+        handler.item("stepper_time_kinematics", _stepper_time);
+        handler.section("pen_lift", _penLift);
     }
 
     void WallPlotter::init() {
@@ -47,8 +50,38 @@ namespace Kinematics {
         return false;
     }
 
-    bool WallPlotter::transform_cartesian_to_motors(float* cartesian, float* motors) {
-        log_error("WallPlotter::transform_cartesian_to_motors is broken");
+    bool WallPlotter::transform_cartesian_to_motors(float* motors, float* cartesian) {
+        // Note that the left motor runs backward.
+        float left, right;
+        xy_to_lengths(cartesian[X_AXIS], cartesian[Y_AXIS], left, right);
+        motors[0] = 0 - (left - zero_left);
+        motors[1] = 0 + (right - zero_right);
+
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            motors[axis] = cartesian[axis];
+        }
+        return true;
+    }
+
+    // A cord grows by the part of the motion that points away from its anchor
+    bool WallPlotter::motor_rates(float* rates, float* cartesian, float* direction) {
+        float left_dx  = cartesian[X_AXIS] - _left_anchor_x;
+        float left_dy  = cartesian[Y_AXIS] - _left_anchor_y;
+        float right_dx = cartesian[X_AXIS] - _right_anchor_x;
+        float right_dy = cartesian[Y_AXIS] - _right_anchor_y;
+        float left     = hypot_f(left_dx, left_dy);
+        float right    = hypot_f(right_dx, right_dy);
+        if (left == 0 || right == 0) {
+            return false;
+        }
+        rates[0] = 0 - (left_dx * direction[X_AXIS] + left_dy * direction[Y_AXIS]) / left;
+        rates[1] = 0 + (right_dx * direction[X_AXIS] + right_dy * direction[Y_AXIS]) / right;
+
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            rates[axis] = direction[axis];
+        }
         return true;
     }
 
@@ -63,6 +96,29 @@ namespace Kinematics {
         position = an n_axis array of where the machine is starting from for this move
     */
     bool WallPlotter::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
+        if (_penLift) {
+            return _penLift->line(target, pl_data, position, planner());
+        }
+        return plan_line(target, pl_data, position);
+    }
+
+    PenLift::plan_t WallPlotter::planner() {
+        return [this](float* target, plan_line_data_t* pl_data, float* position) { return plan_line(target, pl_data, position); };
+    }
+
+    void WallPlotter::flush_held() {
+        if (_penLift) {
+            _penLift->flush(planner());
+        }
+    }
+
+    void WallPlotter::drop_held() {
+        if (_penLift) {
+            _penLift->drop();
+        }
+    }
+
+    bool WallPlotter::plan_line(float* target, plan_line_data_t* pl_data, float* position) {
         float    dx, dy, dz;     // segment distances in each cartesian axis
         uint32_t segment_count;  // number of segments the move will be broken in to.
 
@@ -74,37 +130,55 @@ namespace Kinematics {
             return true;
         }
 
+        if (_stepper_time) {
+            // The segment generator follows the line, so the planner sees it whole and in mm
+            return mc_move_cartesian(target, pl_data, position);
+        }
+
         float cartesian_feed_rate = pl_data->feed_rate;
 
         // calculate the total X,Y axis move distance
         // Z axis is the same in both coord systems, so it does not undergo conversion
         float xydist = vector_distance(target, position, 2);  // Only compute distance for both axes. X and Y
         // Segment our G1 and G0 moves based on yaml file. If we choose a small enough _segment_length we can hide the nonlinearity
+        // With segment_error_mm, segments are longer where the cords change length nearly linearly
         segment_count = xydist / _segment_length;
         if (segment_count < 1) {  // Make sure there is at least one segment, even if there is no movement
             // We need to do this to make sure other things like S and M codes get updated properly by
             // the planner even if there is no movement??
             segment_count = 1;
         }
-        float cartesian_segment_length = total_cartesian_distance / segment_count;
-
-        // Calc length of each cartesian segment - the same for all segments
-        float cartesian_segment_components[n_axis];
-        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-            cartesian_segment_components[axis] = (target[axis] - position[axis]) / segment_count;
-        }
+        float min_step = 1.0f / float(segment_count);
+        float step     = 0.5f;  // The first segment tries the whole move
+        float done     = 0.0f;
+
+        // How far the puck strays from the line at the middle of a segment, when the cords change length linearly
+        auto chord_error = [&](float from, float to) {
+            float x0 = position[X_AXIS] + (target[X_AXIS] - position[X_AXIS]) * from;
+            float y0 = position[Y_AXIS] + (target[Y_AXIS] - position[Y_AXIS]) * from;
+            float x1 = position[X_AXIS] + (target[X_AXIS] - position[X_AXIS]) * to;
+            float y1 = position[Y_AXIS] + (target[Y_AXIS] - position[Y_AXIS]) * to;
+            float left0, right0, left1, right1, x, y;
+            xy_to_lengths(x0, y0, left0, right0);
+            xy_to_lengths(x1, y1, left1, right1);
+            lengths_to_xy((left0 + left1) / 2, (right0 + right1) / 2, x, y);
+            return hypot_f(x - (x0 + x1) / 2, y - (y0 + y1) / 2);
+        };
 
         float cartesian_segment_end[n_axis];
-        copyAxes(cartesian_segment_end, position);
 
-        // Calculate desired cartesian feedrate distance ratio. Same for each seg.
-        for (uint32_t segment = 1; segment <= segment_count; segment++) {
+        // Calculate desired cartesian feedrate distance ratio for each seg.
+        while (done < 1.0f) {
             if (sys.abort) {
                 return true;
             }
+            float end                      = segment_end(done, step, min_step, _segment_error, chord_error);
+            float cartesian_segment_length = total_cartesian_distance * (end - done);
+            done                           = end;
+
             // calculate the cartesian end point of the next segment
             for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-                cartesian_segment_end[axis] += cartesian_segment_components[axis];
+                cartesian_segment_end[axis] = position[axis] + (target[axis] - position[axis]) * end;
             }
 
             // Convert cartesian space coords to motor space
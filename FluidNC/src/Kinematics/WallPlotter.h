@@ -10,6 +10,7 @@
 */
 
 #include "Kinematics.h"
+#include "PenLift.h"
 
 namespace Kinematics {
     class WallPlotter : public KinematicSystem {
@@ -28,8 +29,11 @@ namespace Kinematics {
         void init_position() override;
         bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
-        bool transform_cartesian_to_motors(float* cartesian, float* motors) override;
+        bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool motor_rates(float* rates, float* cartesian, float* direction) override;
         bool kinematics_homing(AxisMask& axisMask) override;
+        void flush_held() override;
+        void drop_held() override;
 
         // Configuration handlers:
         void validate() override {}
@@ -45,6 +49,9 @@ namespace Kinematics {
         void lengths_to_xy(float left_length, float right_length, float& x, float& y);
         void xy_to_lengths(float x, float y, float& left_length, float& right_length);
 
+        bool             plan_line(float* target, plan_line_data_t* pl_data, float* position);
+        PenLift::plan_t  planner();
+
         // State
         float zero_left;   //  The left cord offset corresponding to cartesian (0, 0).
         float zero_right;  //  The right cord offset corresponding to cartesian (0, 0).
@@ -59,5 +66,9 @@ namespace Kinematics {
         float _right_anchor_x = 100;
         float _right_anchor_y = 100;
         float _segment_length = 10;
+        float _segment_error  = 0;      // If set, segments are longer while the puck stays within this of the line
+        bool  _stepper_time   = false;  // Convert to cord lengths in the segment generator
+
+        PenLift* _penLift = nullptr;
     };
 }  //  namespace Kinematics
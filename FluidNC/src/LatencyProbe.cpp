@@ -0,0 +1,46 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "LatencyProbe.h"
+
+#include "Config.h"  // log_*
+#include "Driver/fluidnc_gpio.h"
+
+static const char* eventNames[] = { "isr_pin", "segment_pin", "planner_pin", "realtime_pin", "feedhold_pin" };
+
+LatencyProbe::Mask LatencyProbe::_masks[LatencyProbe::nEvents] = {};
+
+void LatencyProbe::group(Configuration::HandlerBase& handler) {
+    for (int event = 0; event < nEvents; event++) {
+        handler.item(eventNames[event], _pins[event]);
+    }
+}
+
+void LatencyProbe::init() {
+    for (int event = 0; event < nEvents; event++) {
+        Pin& pin = _pins[event];
+        if (pin.undefined()) {
+            continue;
+        }
+        if (!pin.capabilities().has(Pin::Capabilities::Native)) {
+            log_error("Latency probe " << eventNames[event] << " " << pin.name() << " is not a native GPIO");
+            continue;
+        }
+        pin.setAttr(Pin::Attr::Output);
+        pinnum_t gpio    = pin.getNative(Pin::Capabilities::Output);
+        _masks[event].lo = gpio < 32 ? 1u << gpio : 0;
+        _masks[event].hi = gpio < 32 ? 0 : 1u << (gpio - 32);
+        _masks[event].on = false;
+        gpio_write_mask(0, _masks[event].lo, 0, _masks[event].hi);  // Low, whatever the pin's :low attribute
+        log_info("Latency probe " << eventNames[event] << " " << pin.name());
+    }
+}
+
+void IRAM_ATTR LatencyProbe::flip(Event event) {
+    Mask& mask = _masks[event];
+    mask.on    = !mask.on;
+    if (mask.on) {
+        gpio_write_mask(mask.lo, 0, mask.hi, 0);
+    } else {
+        gpio_write_mask(0, mask.lo, 0, mask.hi);
+    }
+}
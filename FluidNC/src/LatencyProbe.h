@@ -0,0 +1,70 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  LatencyProbe.h - toggles spare GPIOs at checkpoints of the pipeline, for a logic analyzer
+
+  A latency_probe section assigns a pin to each checkpoint that is to be watched:
+
+    latency_probe:
+      realtime_pin: gpio.32
+      feedhold_pin: gpio.33
+
+  Each pin changes level every time its event happens, so every edge is one event,
+  however close together they come, and the time from one to another, for example from
+  the realtime_pin edge of a cycle start character to the first step pulse, is the
+  latency between them.  The events are:
+
+    isr_pin       The step ISR was entered
+    segment_pin   The step ISR took up a new segment
+    planner_pin   The planner queued a block
+    realtime_pin  A realtime command was received from a channel
+    feedhold_pin  A feed hold started
+
+  Pins must be native GPIOs, so that each change is a single write to a GPIO set or
+  clear register.  With no section, or no pin for an event, the checkpoint costs one
+  load and a branch.
+*/
+
+#include "Configuration/Configurable.h"
+#include "Pin.h"
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+class LatencyProbe : public Configuration::Configurable {
+public:
+    enum Event : uint8_t {
+        Isr = 0,
+        Segment,
+        Planner,
+        Realtime,
+        Feedhold,
+        nEvents,
+    };
+
+    void init();
+
+    // Changes the level of the event's pin, if it has one
+    static inline void IRAM_ATTR toggle(Event event) {
+        if (_masks[event].lo | _masks[event].hi) {
+            flip(event);
+        }
+    }
+
+    void group(Configuration::HandlerBase& handler) override;
+
+private:
+    Pin _pins[nEvents];
+
+    // The GPIO of each event as bits of the low and high output registers
+    struct Mask {
+        uint32_t lo;
+        uint32_t hi;
+        bool     on;
+    };
+    static Mask _masks[nEvents];
+
+    static void IRAM_ATTR flip(Event event);
+};
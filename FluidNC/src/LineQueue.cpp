@@ -0,0 +1,116 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "LineQueue.h"
+
+#include "Channel.h"
+
+#include <cstring>
+#include <mutex>
+
+namespace LineQueue {
+    struct Slot {
+        Channel* channel;  // nullptr for a free slot
+        uint32_t seq;      // Arrival order
+        char     line[Channel::maxLine];
+        char     compiled[maxCompiledLength];
+        size_t   compiledLength;  // 0 when the line is kept as text
+    };
+
+    static Slot       slots[nSlots] = {};
+    static uint32_t   nextSeq       = 0;
+    static Channel*   executing     = nullptr;
+    static std::mutex mutex;
+
+    static size_t waiting(Channel* channel) {
+        size_t n = 0;
+        for (auto& slot : slots) {
+            n += slot.channel == channel;
+        }
+        return n;
+    }
+
+    bool room(Channel* channel) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return waiting(nullptr) && waiting(channel) < perChannel;
+    }
+
+    void push(Channel* channel, const char* line) {
+        // Compiled outside the lock, so the main loop is not held up by it
+        char        compiled[maxCompiledLength];
+        size_t      length;
+        const char* text = line;
+        if (line[0] == compiledLineMarker) {
+            length = 2 + uint8_t(line[1]) * compiledWordSize;  // Its floats may hold NULs
+            memcpy(compiled, line, length);
+            text = "";
+        } else {
+            length = gc_compile_line(line, compiled);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& slot : slots) {
+            if (!slot.channel) {
+                slot.channel = channel;
+                slot.seq     = nextSeq++;
+                strncpy(slot.line, text, Channel::maxLine - 1);
+                slot.line[Channel::maxLine - 1] = '\0';
+                memcpy(slot.compiled, compiled, length);
+                slot.compiledLength = length;
+                return;
+            }
+        }
+    }
+
+    Channel* take(char* line, char* compiled) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot* next = nullptr;
+        for (auto& slot : slots) {
+            if (!slot.channel) {
+                continue;
+            }
+            if (!next) {
+                next = &slot;
+                continue;
+            }
+            int priority = slot.channel->linePriority();
+            int best     = next->channel->linePriority();
+            // The seq difference is signed so that the order survives a wrap
+            if (priority > best || (priority == best && int32_t(slot.seq - next->seq) < 0)) {
+                next = &slot;
+            }
+        }
+        if (!next) {
+            return nullptr;
+        }
+        strcpy(line, next->line);
+        memcpy(compiled, next->compiled, next->compiledLength);
+        if (!next->compiledLength) {
+            compiled[0] = '\0';
+        }
+        executing     = next->channel;
+        next->channel = nullptr;
+        return executing;
+    }
+
+    void done() {
+        std::lock_guard<std::mutex> lock(mutex);
+        executing = nullptr;
+    }
+
+    bool busy() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return executing || waiting(nullptr) != nSlots;
+    }
+
+    bool holds(Channel* channel) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return executing == channel || waiting(channel);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& slot : slots) {
+            slot.channel = nullptr;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  LineQueue.h - lines that the polling task has collected for the main loop
+
+  The polling task puts each complete line here with the channel that it came from, and
+  goes on collecting while the main loop executes the one before, instead of waiting on
+  a single handoff slot.  Each channel may have up to perChannel lines waiting, so one
+  busy sender cannot fill the queue, and its lines are taken in the order they arrived.
+  Between channels, the main loop takes the oldest line of the highest linePriority(),
+  so a pendant or a console is served ahead of a job that streams from a file.
+
+  Plain g-code lines are compiled by gc_compile_line() as they are queued, so the text
+  processing of a line is done by the polling task while the main loop is still busy
+  with the lines before it.  A line is only compiled, not executed, ahead of time: its
+  meaning depends on the modal state that the lines before it leave, so the main loop
+  still runs each one through gc_execute_compiled() in order.
+*/
+
+#include "GCode.h"  // maxCompiledLength
+
+#include <cstddef>
+
+class Channel;
+
+namespace LineQueue {
+    const size_t nSlots     = 4;
+    const size_t perChannel = 2;
+
+    // Whether a line from the channel would fit
+    bool room(Channel* channel);
+
+    // Called by the polling task with a line that room() has made space for
+    void push(Channel* channel, const char* line);
+
+    // Called by the main loop; copies the next line and returns its channel, or
+    // nullptr when there is none.  compiled, which must hold maxCompiledLength bytes,
+    // gets the compiled line, or "" when the line is kept as text.  A line that came
+    // compiled, from the g-code cache of a file job, has "" as its text.  The line is
+    // executing until done() is called.
+    Channel* take(char* line, char* compiled);
+    void     done();
+
+    // Lines are waiting or executing
+    bool busy();
+
+    // A line of the channel is waiting or executing, so it must not be deleted
+    bool holds(Channel* channel);
+
+    // Drops the waiting lines, as on a reset
+    void clear();
+}
@@ -7,6 +7,10 @@
 #include "SettingsDefinitions.h"
 #include "Channel.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 EnumItem messageLevels2[] = { { MsgLevelNone, "None" }, { MsgLevelError, "Error" }, { MsgLevelWarning, "Warn" },
                               { MsgLevelInfo, "Info" }, { MsgLevelDebug, "Debug" }, { MsgLevelVerbose, "Verbose" },
                               EnumItem(MsgLevelNone) };
@@ -15,8 +19,40 @@ bool atMsgLevel(MsgLevel level) {
     return message_level == nullptr || message_level->get() >= level;
 }
 
-LogStream::LogStream(Channel& channel, MsgLevel level) : _channel(channel), _level(level) {
-    _line = new std::string();
+static char                  logPool[logPoolLines][logLineSize];
+static std::atomic<uint32_t> logPoolBusy { 0 };  // One bit per buffer in use
+
+char* log_pool_take() {
+    const uint32_t all  = (uint32_t(1) << logPoolLines) - 1;
+    uint32_t       busy = logPoolBusy.load();
+    while (true) {
+        uint32_t free = ~busy & all;
+        if (!free) {
+            return nullptr;
+        }
+        uint32_t bit = free & -free;
+        if (logPoolBusy.compare_exchange_weak(busy, busy | bit)) {
+            return logPool[__builtin_ctz(bit)];
+        }
+    }
+}
+
+void log_pool_release(const char* line) {
+    if (line < logPool[0] || line >= logPool[logPoolLines]) {
+        return;
+    }
+    size_t index = (line - logPool[0]) / logLineSize;
+    logPoolBusy.fetch_and(~(uint32_t(1) << index));
+}
+
+LogStream::LogStream(Channel& channel, MsgLevel level) : _channel(channel), _length(0), _level(level), _spill(nullptr) {
+    _line = log_pool_take();
+    if (_line) {
+        _limit = logLineSize;
+    } else {
+        _line  = _fallback;
+        _limit = sizeof(_fallback);
+    }
 }
 
 LogStream::LogStream(Channel& channel, MsgLevel level, const char* name) : LogStream(channel, level) {
@@ -26,14 +62,56 @@ LogStream::LogStream(Channel& channel, MsgLevel level, const char* name) : LogSt
 LogStream::LogStream(Channel& channel, const char* name) : LogStream(channel, MsgLevelNone, name) {}
 LogStream::LogStream(MsgLevel level, const char* name) : LogStream(allChannels, level, name) {}
 
+// A line that outgrows its buffer moves to the heap, so long lines such as status
+// reports, which senders parse up to the closing '>', are never cut short.
+void LogStream::spill() {
+    _spill = new std::string(_line, _length);
+    _spill->reserve(2 * logLineSize);
+}
+
 size_t LogStream::write(uint8_t c) {
-    *_line += (char)c;
+    // Leave room for the closing ']' and the terminating null
+    if (!_spill && _length >= _limit - 2) {
+        spill();
+    }
+    if (_spill) {
+        *_spill += char(c);
+    } else {
+        _line[_length++] = c;
+    }
     return 1;
 }
 
+size_t LogStream::write(const uint8_t* buffer, size_t length) {
+    if (!_spill && length > _limit - 2 - _length) {
+        spill();
+    }
+    if (_spill) {
+        _spill->append(reinterpret_cast<const char*>(buffer), length);
+    } else {
+        memcpy(_line + _length, buffer, length);
+        _length += length;
+    }
+    return length;
+}
+
 LogStream::~LogStream() {
-    if ((*_line).length() && (*_line)[0] == '[') {
-        *_line += ']';
+    if (_spill) {
+        if (_spill->length() && (*_spill)[0] == '[') {
+            *_spill += ']';
+        }
+        log_pool_release(_line);
+        _channel.sendLine(_level, _spill);  // The output task deletes it
+        return;
+    }
+    if (_length && _line[0] == '[') {
+        _line[_length++] = ']';
+    }
+    _line[_length] = '\0';
+    if (_line == _fallback) {
+        // The line would not outlive this object on the output queue
+        _channel.print_msg(_level, _line);
+        return;
     }
     _channel.sendLine(_level, _line);
 }
@@ -28,6 +28,17 @@ struct LogMessage {
 
 extern TaskHandle_t outputTask;
 
+// Log lines are built in a fixed pool of buffers rather than on the heap.  A
+// line that does not fit in a buffer moves to the heap.  log_pool_take() returns
+// nullptr when every buffer is in use.  log_pool_release() gives a buffer back
+// once its line has been sent, and ignores pointers that are not from the pool,
+// so it can be applied to any line.
+const size_t logLineSize  = 320;
+const int    logPoolLines = 16;
+
+char* log_pool_take();
+void  log_pool_release(const char* line);
+
 extern xQueueHandle message_queue;
 
 extern EnumItem messageLevels2[];
@@ -54,37 +65,57 @@ public:
     LogStream(Channel& channel, MsgLevel level, const char* name);
     LogStream(MsgLevel level, const char* name);
     size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t length) override;
     ~LogStream();
 
 private:
-    Channel&     _channel;
-    std::string* _line;
-    MsgLevel     _level;
+    Channel& _channel;
+    char*    _line;
+    size_t   _length;
+    size_t   _limit;
+    MsgLevel _level;
+
+    // The line once it is too long for the buffer, sent to the output task as a string
+    std::string* _spill;
+
+    void spill();
+
+    // Used when the pool is exhausted; such lines are printed directly instead
+    // of being queued for the output task, unless they spill.
+    char _fallback[64];
 };
 
 extern bool atMsgLevel(MsgLevel level);
 
+// LOG_LEVEL_MAX removes the code for messages above that level at compile time,
+// e.g. -DLOG_LEVEL_MAX=3 for a production build without debug and verbose
+// messages.  The runtime message level can only lower it further.
+#ifndef LOG_LEVEL_MAX
+#    define LOG_LEVEL_MAX 5  // MsgLevelVerbose
+#endif
+
 // clang-format off
 
 // Note: these '{'..'}' scopes are here for a reason: the destructor should flush.
 
 // #define log_bare(prefix, x) { LogStream ss(prefix); ss << x; }
 #define log_msg(x) { LogStream ss(MsgLevelNone, "[MSG:"); ss << x; }
-#define log_verbose(x) if (atMsgLevel(MsgLevelVerbose)) { LogStream ss(MsgLevelVerbose, "[MSG:VRB: "); ss << x; }
-#define log_debug(x) if (atMsgLevel(MsgLevelDebug)) { LogStream ss(MsgLevelDebug, "[MSG:DBG: "); ss << x; }
-#define log_info(x) if (atMsgLevel(MsgLevelInfo)) { LogStream ss(MsgLevelInfo, "[MSG:INFO: "); ss << x; }
-#define log_warn(x) if (atMsgLevel(MsgLevelWarning)) { LogStream ss(MsgLevelWarning, "[MSG:WARN: "); ss << x; }
-#define log_error(x) if (atMsgLevel(MsgLevelError)) { LogStream ss(MsgLevelError, "[MSG:ERR: "); ss << x; }
+#define log_verbose(x) if (LOG_LEVEL_MAX >= MsgLevelVerbose && atMsgLevel(MsgLevelVerbose)) { LogStream ss(MsgLevelVerbose, "[MSG:VRB: "); ss << x; }
+#define log_debug(x) if (LOG_LEVEL_MAX >= MsgLevelDebug && atMsgLevel(MsgLevelDebug)) { LogStream ss(MsgLevelDebug, "[MSG:DBG: "); ss << x; }
+#define log_info(x) if (LOG_LEVEL_MAX >= MsgLevelInfo && atMsgLevel(MsgLevelInfo)) { LogStream ss(MsgLevelInfo, "[MSG:INFO: "); ss << x; }
+#define log_warn(x) if (LOG_LEVEL_MAX >= MsgLevelWarning && atMsgLevel(MsgLevelWarning)) { LogStream ss(MsgLevelWarning, "[MSG:WARN: "); ss << x; }
+#define log_error(x) if (LOG_LEVEL_MAX >= MsgLevelError && atMsgLevel(MsgLevelError)) { LogStream ss(MsgLevelError, "[MSG:ERR: "); ss << x; }
 #define log_fatal(x) { LogStream ss(MsgLevelNone, "[MSG:FATAL: "); ss << x;  Assert(false, "A fatal error occurred."); }
 
 #define log_msg_to(out, x) { LogStream ss(out, MsgLevelNone, "[MSG:"); ss << x; }
-#define log_verbose_to(out, x) if (atMsgLevel(MsgLevelVerbose)) { LogStream ss(out, MsgLevelVerbose, "[MSG:VRB: "); ss << x; }
-#define log_debug_to(out, x) if (atMsgLevel(MsgLevelDebug)) { LogStream ss(out, MsgLevelDebug, "[MSG:DBG: "); ss << x; }
-#define log_info_to(out, x) if (atMsgLevel(MsgLevelInfo)) { LogStream ss(out, MsgLevelInfo, "[MSG:INFO: "); ss << x; }
-#define log_warn_to(out, x) if (atMsgLevel(MsgLevelWarning)) { LogStream ss(out, MsgLevelWarning, "[MSG:WARN: "); ss << x; }
-#define log_error_to(out, x) if (atMsgLevel(MsgLevelError)) { LogStream ss(out, MsgLevelError, "[MSG:ERR: "); ss << x; }
+#define log_verbose_to(out, x) if (LOG_LEVEL_MAX >= MsgLevelVerbose && atMsgLevel(MsgLevelVerbose)) { LogStream ss(out, MsgLevelVerbose, "[MSG:VRB: "); ss << x; }
+#define log_debug_to(out, x) if (LOG_LEVEL_MAX >= MsgLevelDebug && atMsgLevel(MsgLevelDebug)) { LogStream ss(out, MsgLevelDebug, "[MSG:DBG: "); ss << x; }
+#define log_info_to(out, x) if (LOG_LEVEL_MAX >= MsgLevelInfo && atMsgLevel(MsgLevelInfo)) { LogStream ss(out, MsgLevelInfo, "[MSG:INFO: "); ss << x; }
+#define log_warn_to(out, x) if (LOG_LEVEL_MAX >= MsgLevelWarning && atMsgLevel(MsgLevelWarning)) { LogStream ss(out, MsgLevelWarning, "[MSG:WARN: "); ss << x; }
+#define log_error_to(out, x) if (LOG_LEVEL_MAX >= MsgLevelError && atMsgLevel(MsgLevelError)) { LogStream ss(out, MsgLevelError, "[MSG:ERR: "); ss << x; }
 #define log_fatal_to(out, x) { LogStream ss(out, MsgLevelNone, "[MSG:FATAL: "); ss << x;  Assert(false, "A fatal error occurred."); }
 
 // #define log_to(out, prefix, x) { LogStream ss(out, MsgLevelNone, prefix); ss << x; }
 #define log_stream(out, x) { LogStream ss(out, MsgLevelNone); ss << x; }
 #define log_string(out, x) out.sendLine(MsgLevelNone, x)
+
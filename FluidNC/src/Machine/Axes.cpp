@@ -6,7 +6,12 @@
 #include "../MotionControl.h"
 #include "../Stepper.h"     // stepper_id_t
 #include "MachineConfig.h"  // config->
+#include "Encoder.h"
 #include "../Limits.h"
+#include "../MotionBench.h"
+#include "Driver/RmtBurst.h"
+#include "Driver/DedicGpio.h"
+#include "Driver/TmcSpiChain.h"
 
 EnumItem axisType[] = { { 0, "X" }, { 1, "Y" }, { 2, "Z" }, { 3, "A" }, { 4, "B" }, { 5, "C" }, EnumItem(0) };
 
@@ -48,6 +53,85 @@ namespace Machine {
         }
 
         config_motors();
+
+        init_step_dir_masks();
+        init_rmt_burst();
+        init_dedic_gpio();
+    }
+
+    // When every motor drives its step and direction pins directly from GPIO or
+    // I2SO outputs, step() and unstep() can write all of those pins together from
+    // masks built here, instead of calling into each motor driver.
+    void Axes::init_step_dir_masks() {
+        _fastStepDir = true;
+        _stepOff     = {};
+        for (size_t axis = X_AXIS; axis < _numberAxis; axis++) {
+            Pins::PinMask dirOn;
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                _stepOn[axis][motor] = {};
+                auto m               = _axis[axis]->_motors[motor];
+                if (m) {
+                    if (!m->_driver->step_dir_masks(_stepOn[axis][motor], dirOn)) {
+                        _fastStepDir = false;
+                    }
+                    _stepOff |= _stepOn[axis][motor].inverted();
+                }
+            }
+            _dirOn[axis]  = dirOn;
+            _dirOff[axis] = dirOn.inverted();
+        }
+        log_debug("Step/dir pins use " << (_fastStepDir ? "direct" : "per-motor") << " writes");
+
+        // The pulse timer interrupt can preempt the step ISR, so it may only end
+        // pulses with the GPIO set/clear registers, which need no read-modify-write
+        auto stepping = config->_stepping;
+        if (stepping->_asyncPulse && !(_fastStepDir && _stepOff.gpioOnly())) {
+            log_warn("stepping/pulse_timer needs GPIO step pins on standard steppers; ignored");
+            stepping->_asyncPulse = false;
+        }
+    }
+
+    // The Dedicated_GPIO engine writes every step pin with one CPU instruction.  The
+    // direction pins change rarely, so they keep the GPIO masks, which the engine needs.
+    void Axes::init_dedic_gpio() {
+        _dedicGpio = false;
+        if (Stepping::_engine != Stepping::DEDIC_GPIO) {
+            return;
+        }
+        pinnum_t pins[dedicGpioMaxPins];
+        int      count  = 0;
+        bool     usable = _fastStepDir;
+        _dedicOn        = 0;
+        for (size_t axis = X_AXIS; usable && axis < _numberAxis; axis++) {
+            for (size_t motor = 0; usable && motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                _dedicStep[axis][motor] = 0;
+
+                int  gpio      = -1;
+                bool activeLow = false;
+                auto m         = _axis[axis]->_motors[motor];
+                if (!m) {
+                    continue;
+                }
+                if (!m->_driver->step_counter_pin(gpio, activeLow) || (gpio >= 0 && count == dedicGpioMaxPins)) {
+                    usable = false;
+                } else if (gpio >= 0) {
+                    _dedicStep[axis][motor] = 1 << count;
+                    if (!activeLow) {
+                        _dedicOn |= 1 << count;
+                    }
+                    pins[count++] = gpio;
+                }
+            }
+        }
+        if (!usable || !dedic_gpio_init(pins, count)) {
+            log_error("Dedicated_GPIO stepping needs an ESP32-S3 and at most " << dedicGpioMaxPins
+                                                                                << " GPIO step pins on standard steppers; using Timed");
+            Stepping::_engine = Stepping::TIMED;
+            return;
+        }
+        _dedicAll  = (1 << count) - 1;
+        _dedicGpio = true;
+        dedic_gpio_write(_dedicAll, ~_dedicOn);
     }
 
     void IRAM_ATTR Axes::set_disable(int axis, bool disable) {
@@ -66,6 +150,11 @@ namespace Machine {
 
         _sharedStepperDisable.synchronousWrite(disable);
 
+        if (!disable && _motorsDisabled && Encoder::enabled) {
+            Encoder::sync_all();
+        }
+        _motorsDisabled = disable;
+
         if (!disable && config->_stepping->_disableDelayUsecs) {  // wait for the enable delay
             log_debug("enable delay:" << config->_stepping->_disableDelayUsecs);
             delay_us(config->_stepping->_disableDelayUsecs);
@@ -77,6 +166,8 @@ namespace Machine {
     MotorMask Axes::set_homing_mode(AxisMask axisMask, bool isHoming) {
         MotorMask motorsCanHome = 0;
 
+        // The register writes for all daisy-chained drivers go out together
+        tmcSpiChainBegin();
         for (size_t axis = X_AXIS; axis < _numberAxis; axis++) {
             if (bitnum_is_true(axisMask, axis)) {
                 auto a = _axis[axis];
@@ -93,34 +184,116 @@ namespace Machine {
                 }
             }
         }
+        tmcSpiChainEnd();
 
         return motorsCanHome;
     }
 
-    void IRAM_ATTR Axes::step(uint8_t step_mask, uint8_t dir_mask) {
+    // The RMT_burst engine needs every motor's step pulses to come from an RMT channel.
+    // If some motor cannot do that, the RMT engine is used instead; the channels are set
+    // up the same way for both.
+    void Axes::init_rmt_burst() {
+        if (Stepping::_engine != Stepping::RMT_BURST) {
+            return;
+        }
+        for (size_t axis = X_AXIS; axis < _numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                int  channel = -1;
+                bool invert  = false;
+                auto m       = _axis[axis]->_motors[motor];
+                if (m && !m->_driver->rmt_channel(channel, invert)) {
+                    log_error("RMT_burst stepping needs RMT step pulses on every motor; using RMT");
+                    Stepping::_engine = Stepping::RMT;
+                    return;
+                }
+                _rmtChannel[axis][motor] = channel;
+                _rmtInvert[axis][motor]  = invert;
+            }
+        }
+    }
+
+    void IRAM_ATTR Axes::burst_axis(int axis, bool reverse, const uint32_t* starts, uint32_t count) {
+        auto pulse = config->_stepping->_pulseUsecs;
+        for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+            auto m       = _axis[axis]->_motors[motor];
+            int  channel = _rmtChannel[axis][motor];
+            // The same conditions as Motor::count_step(), which cannot change during a burst
+            if (m && channel >= 0 && !m->_blocked && !m->_limited) {
+                m->_steps += reverse ? -int32_t(count) : int32_t(count);
+                rmtBurstPulses(channel, _rmtInvert[axis][motor], starts, count, pulse);
+            }
+        }
+    }
+
+    void Axes::rmt_single_pulses() {
+        auto stepping = config->_stepping;
+        for (size_t axis = X_AXIS; axis < _numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                int channel = _rmtChannel[axis][motor];
+                if (_axis[axis]->_motors[motor] && channel >= 0) {
+                    rmtBurstSinglePulse(channel, _rmtInvert[axis][motor], stepping->_directionDelayUsecs, stepping->_pulseUsecs);
+                }
+            }
+        }
+    }
+
+    bool IRAM_ATTR Axes::set_direction(AxisMask dir_mask) {
         auto n_axis = _numberAxis;
-        //log_info("motors_set_direction_pins:0x%02X", onMask);
 
         // Set the direction pins, but optimize for the common
         // situation where the direction bits haven't changed.
-        static uint8_t previous_dir = 255;  // should never be this value
+        static AxisMask previous_dir = 0xffff;  // should never be this value
         if (dir_mask != previous_dir) {
             previous_dir = dir_mask;
 
-            for (int axis = X_AXIS; axis < n_axis; axis++) {
-                bool thisDir = bitnum_is_true(dir_mask, axis);
+            if (_fastStepDir) {
+                Pins::PinMask dirs;
+                for (int axis = X_AXIS; axis < n_axis; axis++) {
+                    dirs |= bitnum_is_true(dir_mask, axis) ? _dirOn[axis] : _dirOff[axis];
+                }
+                dirs.write();
+            } else {
+                for (int axis = X_AXIS; axis < n_axis; axis++) {
+                    bool thisDir = bitnum_is_true(dir_mask, axis);
 
-                for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
-                    auto m = _axis[axis]->_motors[motor];
-                    if (m) {
-                        m->_driver->set_direction(thisDir);
+                    for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                        auto m = _axis[axis]->_motors[motor];
+                        if (m) {
+                            m->_driver->set_direction(thisDir);
+                        }
                     }
                 }
             }
             config->_stepping->waitDirection();
+            return true;
+        }
+        return false;
+    }
+
+    void IRAM_ATTR Axes::step(AxisMask step_mask, AxisMask dir_mask) {
+        auto n_axis = _numberAxis;
+        //log_info("motors_set_direction_pins:0x%02X", onMask);
+
+        if (MotionBench::active) {
+            // A motion bench drives no pins and only counts the steps
+            for (size_t axis = X_AXIS; axis < n_axis; axis++) {
+                if (bitnum_is_true(step_mask, axis)) {
+                    for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                        auto m = _axis[axis]->_motors[motor];
+                        if (m) {
+                            m->count_step(bitnum_is_true(dir_mask, axis));
+                        }
+                    }
+                }
+            }
+            return;
         }
 
+        set_direction(dir_mask);
+
         // Turn on step pulses for motors that are supposed to step now
+        Pins::PinMask steps;
+        uint32_t      dedicSteps = 0;
         for (size_t axis = X_AXIS; axis < n_axis; axis++) {
             if (bitnum_is_true(step_mask, axis)) {
                 bool dir = bitnum_is_true(dir_mask, axis);
@@ -129,23 +302,45 @@ namespace Machine {
                 for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
                     auto m = a->_motors[motor];
                     if (m) {
-                        m->step(dir);
+                        if (!_fastStepDir) {
+                            m->step(dir);
+                        } else if (m->count_step(dir)) {
+                            steps |= _stepOn[axis][motor];
+                            dedicSteps |= _dedicStep[axis][motor];
+                        }
                     }
                 }
             }
         }
-        config->_stepping->startPulseTimer();
+        if (_dedicGpio) {
+            dedic_gpio_write(dedicSteps, _dedicOn);
+        } else if (_fastStepDir) {
+            steps.write();
+        }
+        // An asynchronously ended pulse needs the timer only if something stepped
+        if (step_mask || !config->_stepping->_asyncPulse) {
+            config->_stepping->startPulseTimer();
+        }
     }
 
     // Turn all stepper pins off
     void IRAM_ATTR Axes::unstep() {
+        if (MotionBench::active) {
+            return;
+        }
         config->_stepping->waitPulse();
-        auto n_axis = _numberAxis;
-        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
-                auto m = _axis[axis]->_motors[motor];
-                if (m) {
-                    m->_driver->unstep();
+        if (_dedicGpio) {
+            dedic_gpio_write(_dedicAll, ~_dedicOn);
+        } else if (_fastStepDir) {
+            _stepOff.write();
+        } else {
+            auto n_axis = _numberAxis;
+            for (size_t axis = X_AXIS; axis < n_axis; axis++) {
+                for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                    auto m = _axis[axis]->_motors[motor];
+                    if (m) {
+                        m->_driver->unstep();
+                    }
                 }
             }
         }
@@ -154,9 +349,11 @@ namespace Machine {
     }
 
     void Axes::config_motors() {
+        tmcSpiChainBegin();
         for (int axis = 0; axis < _numberAxis; ++axis) {
             _axis[axis]->config_motors();
         }
+        tmcSpiChainEnd();
     }
 
     // Some small helpers to find the axis index and axis motor index for a given motor. This
@@ -195,6 +392,7 @@ namespace Machine {
     void Axes::group(Configuration::HandlerBase& handler) {
         handler.item("shared_stepper_disable_pin", _sharedStepperDisable);
         handler.item("shared_stepper_reset_pin", _sharedStepperReset);
+        handler.item("homing_async", _homingAsync);
 
         // Handle axis names xyzabc.  handler.section is inferred
         // from a template.
@@ -225,6 +423,9 @@ namespace Machine {
         if (_numberAxis < 3) {
             _numberAxis = 3;
         }
+#ifdef FLUIDNC_FIXED_N_AXIS
+        Assert(_numberAxis == FLUIDNC_FIXED_N_AXIS, "This build is for %d axes, not %d", FLUIDNC_FIXED_N_AXIS, _numberAxis);
+#endif
 
         for (size_t i = 0; i < _numberAxis; ++i) {
             if (_axis[i] == nullptr) {
@@ -246,18 +447,15 @@ namespace Machine {
     std::string Axes::motorMaskToNames(MotorMask mask) {
         std::string retval("");
         auto        n_axis = _numberAxis;
-        for (int axis = 0; axis < n_axis; axis++) {
-            if (bitnum_is_true(mask, axis)) {
-                retval += " ";
-                retval += _names[axis];
-            }
-        }
-        mask >>= 16;
-        for (int axis = 0; axis < n_axis; axis++) {
-            if (bitnum_is_true(mask, axis)) {
-                retval += " ";
-                retval += _names[axis];
-                retval += "2";
+        for (int motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+            for (int axis = 0; axis < n_axis; axis++) {
+                if (bitnum_is_true(mask, motor_bit(axis, motor))) {
+                    retval += " ";
+                    retval += _names[axis];
+                    if (motor) {
+                        retval += char('1' + motor);
+                    }
+                }
             }
         }
         return retval;
@@ -268,9 +466,10 @@ namespace Machine {
         for (int i = 0; i < strlen(names); i++) {
             char  axisName = toupper(names[i]);
             char* pos      = index(_names, axisName);
-            if (!pos) {
+            if (!pos || pos - _names >= MAX_N_AXIS) {
                 log_error("Invalid axis name " << names[i]);
                 retval = false;
+                continue;
             }
             set_bitnum(mask, pos - Machine::Axes::_names);
         }
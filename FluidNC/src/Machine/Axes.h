@@ -7,6 +7,7 @@
 #include "../Configuration/Configurable.h"
 #include "Axis.h"
 #include "../EnumItem.h"
+#include "../Pins/PinMask.h"
 
 namespace MotorDrivers {
     class MotorDriver;
@@ -16,8 +17,35 @@ namespace Machine {
     class Axes : public Configuration::Configurable {
         bool _switchedStepper = false;
 
+        // Precomputed pin masks for step() and unstep(), used when every
+        // motor can be driven through them - see init_step_dir_masks()
+        bool          _fastStepDir = false;
+        Pins::PinMask _stepOn[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+        Pins::PinMask _dirOn[MAX_N_AXIS];
+        Pins::PinMask _dirOff[MAX_N_AXIS];
+        Pins::PinMask _stepOff;
+
+        void init_step_dir_masks();
+
+        // RMT channels of the motors for the RMT_burst engine, -1 for none
+        int8_t _rmtChannel[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+        bool   _rmtInvert[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];
+
+        void init_rmt_burst();
+
+        // Dedicated GPIO outputs of the step pins for the Dedicated_GPIO engine
+        bool     _dedicGpio = false;
+        uint8_t  _dedicStep[MAX_N_AXIS][Axis::MAX_MOTORS_PER_AXIS];  // Output bit of each motor, 0 for none
+        uint32_t _dedicOn  = 0;                                      // Output levels of the pulses
+        uint32_t _dedicAll = 0;                                      // Every output in use
+
+        void init_dedic_gpio();
+
+        // The axes may be moved by hand while disabled, so encoders are lined up again on enabling
+        bool _motorsDisabled = true;
+
     public:
-        static constexpr const char* _names = "XYZABC";
+        static constexpr const char* _names = "XYZABCUVW";
 
         Axes();
 
@@ -32,15 +60,55 @@ namespace Machine {
         Pin _sharedStepperDisable;
         Pin _sharedStepperReset;
 
+        bool _homingAsync = false;  // The axes of a homing cycle go through its phases independently
+
         inline char axisName(int index) { return index < MAX_N_AXIS ? _names[index] : '?'; }  // returns axis letter
 
-        static inline size_t    motor_bit(size_t axis, size_t motor) { return motor ? axis + 16 : axis; }
-        static inline AxisMask  motors_to_axes(MotorMask motors) { return (motors & 0xffff) | (motors >> 16); }
-        static inline MotorMask axes_to_motors(AxisMask axes) { return axes | (axes << 16); }
+        // Each motor number has its own MOTOR_MASK_STRIDE bits of a MotorMask,
+        // indexed by axis.  With up to two motors per axis, motor1 is in the top half.
+        static constexpr AxisMask motorMaskField = (1u << MOTOR_MASK_STRIDE) - 1;
+
+        static inline size_t motor_bit(size_t axis, size_t motor) { return motor * MOTOR_MASK_STRIDE + axis; }
+
+        static inline AxisMask motors_to_axes(MotorMask motors) {
+            AxisMask axes = 0;
+            for (int motor = 0; motor < MAX_MOTORS_PER_AXIS; motor++) {
+                axes |= (motors >> (motor * MOTOR_MASK_STRIDE)) & motorMaskField;
+            }
+            return axes;
+        }
+        static inline MotorMask axes_to_motors(AxisMask axes) {
+            MotorMask motors = 0;
+            for (int motor = 0; motor < MAX_MOTORS_PER_AXIS; motor++) {
+                motors |= MotorMask(axes) << (motor * MOTOR_MASK_STRIDE);
+            }
+            return motors;
+        }
+        // Axes that have more than one motor in the mask
+        static inline AxisMask multi_motor_axes(MotorMask motors) {
+            AxisMask seen  = 0;
+            AxisMask multi = 0;
+            for (int motor = 0; motor < MAX_MOTORS_PER_AXIS; motor++) {
+                AxisMask axes = (motors >> (motor * MOTOR_MASK_STRIDE)) & motorMaskField;
+                multi |= seen & axes;
+                seen |= axes;
+            }
+            return multi;
+        }
 
         int   _numberAxis = 0;
         Axis* _axis[MAX_N_AXIS];
 
+        // The axis count for the step ISR and the segment prep, a constant that their
+        // loops unroll over in a build for one machine.  See FLUIDNC_FIXED_N_AXIS.
+        inline int numberAxis() const {
+#ifdef FLUIDNC_FIXED_N_AXIS
+            return FLUIDNC_FIXED_N_AXIS;
+#else
+            return _numberAxis;
+#endif
+        }
+
         // Some small helpers to find the axis index and axis motor number for a given motor. This
         // is helpful for some motors that need this info, as well as debug information.
         size_t findAxisIndex(const MotorDrivers::MotorDriver* const motor) const;
@@ -68,8 +136,16 @@ namespace Machine {
 
         void set_disable(int axis, bool disable);
         void set_disable(bool disable);
-        void step(uint8_t step_mask, uint8_t dir_mask);
+        void step(AxisMask step_mask, AxisMask dir_mask);
         void unstep();
+
+        // Sets the direction pins, returning true if any of them changed
+        bool set_direction(AxisMask dir_mask);
+
+        // RMT_burst engine: stages a burst of pulses for the motors of an axis,
+        // and switches the channels to the single pulses of the RMT engine
+        void burst_axis(int axis, bool reverse, const uint32_t* starts, uint32_t count);
+        void rmt_single_pulses();
         void config_motors();
 
         std::string maskToNames(AxisMask mask);
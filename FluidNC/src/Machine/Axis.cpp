@@ -1,6 +1,7 @@
 #include "Axes.h"
 #include "Axis.h"
 #include "MachineConfig.h"  // config
+#include "../System.h"      // set_axis_scale()
 
 #include <cstring>
 
@@ -10,7 +11,13 @@ namespace Machine {
         handler.item("max_rate_mm_per_min", _maxRate, 0.001, 100000.0);
         handler.item("acceleration_mm_per_sec2", _acceleration, 0.001, 100000.0);
         handler.item("max_travel_mm", _maxTravel, 0.1, 10000000.0);
+        handler.item("max_jerk_mm_per_min", _maxJerk, 0.0, 100000.0);
         handler.item("soft_limits", _softLimits);
+        handler.item("backlash_mm", _backlash, 0.0, 10.0);
+        handler.item("backlash_rate_mm_per_min", _backlashRate, 1.0, 100000.0);
+        handler.item("shaper", _shaper, shaperTypes);
+        handler.item("shaper_hz", _shaperHz, 1.0, 500.0);
+        handler.item("shaper_damping", _shaperDamping, 0.0, 0.9);
         handler.section("homing", _homing);
 
         char tmp[7];
@@ -25,6 +32,8 @@ namespace Machine {
     }
 
     void Axis::afterParse() {
+        set_axis_scale(_axis, _stepsPerMm);
+
         uint32_t stepRate = uint32_t(_stepsPerMm * _maxRate / 60.0);
         auto     maxRate  = config->_stepping->maxPulsesPerSec();
         Assert(stepRate <= maxRate, "Stepping rate %d steps/sec exceeds the maximum rate %d", stepRate, maxRate);
@@ -49,16 +58,21 @@ namespace Machine {
             set_bitnum(Axes::homingMask, _axis);
         }
 
-        if (!_motors[0] && _motors[1]) {
-            sys.state = State::ConfigAlarm;
-            log_error("motor1 defined without motor0");
+        for (size_t i = 1; i < Axis::MAX_MOTORS_PER_AXIS; i++) {
+            if (!_motors[i - 1] && _motors[i]) {
+                sys.state = State::ConfigAlarm;
+                log_error("motor" << i << " defined without motor" << (i - 1));
+            }
         }
 
-        // If dual motors and only one motor has switches, this is the configuration
-        // for a POG style squaring. The switch should report as being on both axes
+        // If multiple motors and only one motor has switches, this is the configuration
+        // for a POG style squaring. The switch should report as being on all the motors
         if (hasDualMotor() && (motorsWithSwitches() == 1)) {
-            _motors[0]->makeDualSwitches();
-            _motors[1]->makeDualSwitches();
+            for (size_t i = 0; i < Axis::MAX_MOTORS_PER_AXIS; i++) {
+                if (_motors[i]) {
+                    _motors[i]->makeDualSwitches();
+                }
+            }
         }
     }
 
@@ -81,8 +95,17 @@ namespace Machine {
         return false;
     }
 
-    // Does this axis have 2 motors?
-    bool Axis::hasDualMotor() { return _motors[0] && _motors[0]->isReal() && _motors[1] && _motors[1]->isReal(); }
+    // Does this axis have more than one real motor?
+    bool Axis::hasDualMotor() {
+        int count = 0;
+        for (size_t i = 0; i < MAX_MOTORS_PER_AXIS; i++) {
+            auto m = _motors[i];
+            if (m && m->isReal()) {
+                count++;
+            }
+        }
+        return count > 1;
+    }
 
     // How many motors have switches defined?
     int Axis::motorsWithSwitches() {
@@ -97,20 +120,30 @@ namespace Machine {
     }
 
     float Axis::commonPulloff() {
-        auto motor0Pulloff = _motors[0]->_pulloff;
+        auto pulloff = _motors[0]->_pulloff;
         if (hasDualMotor()) {
-            auto motor1Pulloff = _motors[1]->_pulloff;
-            return std::min(motor0Pulloff, motor1Pulloff);
-        } else {
-            return motor0Pulloff;
+            for (size_t i = 1; i < MAX_MOTORS_PER_AXIS; i++) {
+                auto m = _motors[i];
+                if (m && m->isReal()) {
+                    pulloff = std::min(pulloff, m->_pulloff);
+                }
+            }
         }
+        return pulloff;
     }
 
-    // returns the offset between the pulloffs
-    // value is positive when motor1 has a larger pulloff
+    // returns how much further than the common pulloff the motors
+    // with the largest pulloff go
     float Axis::extraPulloff() {
         if (hasDualMotor()) {
-            return _motors[1]->_pulloff - _motors[0]->_pulloff;
+            auto pulloff = _motors[0]->_pulloff;
+            for (size_t i = 1; i < MAX_MOTORS_PER_AXIS; i++) {
+                auto m = _motors[i];
+                if (m && m->isReal()) {
+                    pulloff = std::max(pulloff, m->_pulloff);
+                }
+            }
+            return pulloff - commonPulloff();
         } else {
             return 0.0f;
         }
@@ -5,9 +5,11 @@
 #pragma once
 
 #include "../Configuration/Configurable.h"
+#include "../Config.h"  // MAX_MOTORS_PER_AXIS
 // #include "Axes.h"
 #include "Motor.h"
 #include "Homing.h"
+#include "../InputShaper.h"
 
 namespace MotorDrivers {
     class MotorDriver;
@@ -25,7 +27,7 @@ namespace Machine {
             }
         }
 
-        static const int MAX_MOTORS_PER_AXIS = 2;
+        static const int MAX_MOTORS_PER_AXIS = ::MAX_MOTORS_PER_AXIS;
 
         Motor*  _motors[MAX_MOTORS_PER_AXIS];
         Homing* _homing = nullptr;
@@ -35,6 +37,14 @@ namespace Machine {
         float _acceleration = 25.0f;
         float _maxTravel    = 1000.0f;
         bool  _softLimits   = false;
+        float _maxJerk      = 300.0f;  // Instantaneous speed change at a junction, used by the centripetal junction model
+        float _backlash     = 0.0f;    // Lost motion when the axis reverses, taken up by extra steps
+        float _backlashRate = 60.0f;   // Speed at which the lost motion is taken up, on top of the move
+
+        // Input shaping of the acceleration ramps of moves on this axis.  See Stepper.cpp.
+        int   _shaper        = InputShaper::NONE;
+        float _shaperHz      = 40.0f;
+        float _shaperDamping = 0.1f;
 
         // Configuration system helpers:
         void group(Configuration::HandlerBase& handler) override;
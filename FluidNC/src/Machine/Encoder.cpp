@@ -0,0 +1,160 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Encoder.h"
+
+#include "MachineConfig.h"     // config
+#include "../MotionControl.h"  // mc_critical
+#include "../Protocol.h"       // protocol_send_event_from_ISR
+#include "../System.h"         // sys
+#include "Driver/PulseCounter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Machine {
+    bool Encoder::enabled = false;
+
+    EnumItem encoderActions[] = { { Encoder::LOG, "Log" }, { Encoder::ALARM, "Alarm" }, EnumItem(Encoder::ALARM) };
+
+    static NoArgEvent encoderEvent { Encoder::report, EventPriority::Safety };  // It can raise an alarm
+
+    void Encoder::group(Configuration::HandlerBase& handler) {
+        handler.item("a_pin", _aPin);
+        handler.item("b_pin", _bPin);
+        handler.item("counts_per_mm", _countsPerMm, 0.0, 1000000.0);
+        handler.item("tolerance_mm", _toleranceMm, 0.001, 1000.0);
+        handler.item("filter_ns", _filterNs, 0, 12000);
+        handler.item("action", _action, encoderActions);
+    }
+
+    void Encoder::validate() {
+        Assert(_aPin.defined() && _bPin.defined(), "Encoder: a_pin and b_pin must be configured");
+        Assert(_countsPerMm > 0, "Encoder: counts_per_mm must be configured");
+    }
+
+    void Encoder::init(int axis, int motorNum) {
+        _axis     = axis;
+        _motorNum = motorNum;
+
+        auto a = _aPin.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
+        auto b = _bPin.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
+        _aPin.setAttr(Pin::Attr::Input);
+        _bPin.setAttr(Pin::Attr::Input);
+
+        auto axisName = config->_axes->axisName(axis);
+        _unit         = pulse_counter_attach_quadrature(a, b);
+        if (_unit < 0) {
+            log_warn("Encoder: no pulse counter for " << axisName << " motor" << motorNum);
+            return;
+        }
+        if (_filterNs) {
+            pulse_counter_set_filter(_unit, std::min(_filterNs * 80 / 1000, 1023));
+        }
+
+        float stepsPerMm = config->_axes->_axis[axis]->_stepsPerMm;
+        _stepsPerCount   = lroundf(stepsPerMm / _countsPerMm * 65536.0f);
+        _toleranceSteps  = lroundf(_toleranceMm * stepsPerMm);
+        _last            = int16_t(pulse_counter_read(_unit));
+        _counts          = 0;
+        sync(config->_axes->_axis[axis]->_motors[motorNum]->_steps);
+        enabled = true;
+
+        log_info("    Encoder " << axisName << " motor" << motorNum << " A:" << _aPin.name() << " B:" << _bPin.name()
+                                << " Counts/mm:" << _countsPerMm << " Tolerance:" << _toleranceMm << "mm");
+    }
+
+    // The counter goes back to 0 when it reaches either limit, so a step of
+    // more than half its range is really a wrap the other way
+    void IRAM_ATTR Encoder::sample() {
+        int16_t now   = int16_t(pulse_counter_read(_unit));
+        int32_t delta = int32_t(now) - _last;
+        if (delta > int32_t(pulseCounterLimit / 2)) {
+            delta -= pulseCounterLimit;
+        } else if (delta < -int32_t(pulseCounterLimit / 2)) {
+            delta += pulseCounterLimit;
+        }
+        _counts += delta;
+        _last = now;
+    }
+
+    int32_t IRAM_ATTR Encoder::steps() { return int32_t((int64_t(_counts) * _stepsPerCount) >> 16); }
+
+    void IRAM_ATTR Encoder::sync(int32_t motorSteps) {
+        if (_unit >= 0) {
+            sample();
+            _offset = motorSteps - steps();
+            _error  = 0;
+        }
+    }
+
+    bool IRAM_ATTR Encoder::check(int32_t motorSteps) {
+        int32_t error = (motorSteps - _offset) - steps();
+        if (error > _toleranceSteps || error < -_toleranceSteps) {
+            bool fresh = _error == 0;
+            _error     = error;
+            return fresh;
+        }
+        return false;
+    }
+
+    void IRAM_ATTR Encoder::check_all() {
+        auto axes   = config->_axes;
+        bool homing = sys.state == State::Homing;
+        bool found  = false;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m = axes->_axis[axis]->_motors[motor];
+                if (m && m->_encoder && m->_encoder->_unit >= 0) {
+                    m->_encoder->sample();
+                    if (!homing && m->_encoder->check(m->_steps)) {
+                        found = true;
+                    }
+                }
+            }
+        }
+        if (found) {
+            protocol_send_event_from_ISR(&encoderEvent);
+        }
+    }
+
+    void IRAM_ATTR Encoder::sync_all() {
+        auto axes = config->_axes;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m = axes->_axis[axis]->_motors[motor];
+                if (m && m->_encoder) {
+                    m->_encoder->sync(m->_steps);
+                }
+            }
+        }
+    }
+
+    // The reported error is taken into the offset, so the encoder then
+    // measures from where the motor really is, and the same loss is not
+    // reported again while the motion goes on
+    void Encoder::report() {
+        auto axes  = config->_axes;
+        bool alarm = false;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m = axes->_axis[axis]->_motors[motor];
+                if (!m || !m->_encoder) {
+                    continue;
+                }
+                auto    e     = m->_encoder;
+                int32_t error = e->_error;
+                if (!error) {
+                    continue;
+                }
+                e->_offset += error;
+                e->_error = 0;
+                log_error("Position error: " << axes->axisName(axis) << " motor" << motor << " is "
+                                             << (std::abs(error) / axes->_axis[axis]->_stepsPerMm) << "mm from where it was stepped to");
+                alarm = alarm || e->_action == ALARM;
+            }
+        }
+        if (alarm) {
+            mc_critical(ExecAlarm::PositionError);
+        }
+    }
+}
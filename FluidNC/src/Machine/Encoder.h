@@ -0,0 +1,90 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Encoder.h - position feedback for a stepper motor from a quadrature encoder
+
+  A motor with an encoder section gets a PCNT unit that counts every edge of the
+  A and B signals, up or down with the direction.  At each segment boundary, and
+  when stepping stops, the step ISR compares the encoder position, scaled to
+  motor steps, with the steps that the motor was given.  An error beyond the
+  tolerance is logged and, with action: Alarm, stops the machine with a
+  Position Error alarm.
+
+  The two are lined up again whenever the motor position is set, as homing
+  does, and when the motors are enabled after being disabled, since the axis
+  may have been moved by hand.  Homing itself is not checked, as a StallGuard
+  or hard stop approach loses steps by design.  If the encoder counts the wrong
+  way, swap a_pin and b_pin.
+*/
+
+#include "../Configuration/Configurable.h"
+#include "../Pin.h"
+#include "../EnumItem.h"
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+namespace Machine {
+    class Encoder : public Configuration::Configurable {
+        int _axis     = -1;
+        int _motorNum = -1;
+
+        int     _unit = -1;  // PCNT unit
+        int16_t _last = 0;   // Raw count at the last sample
+        int32_t _counts;     // Counts since init
+
+        int32_t _stepsPerCount;  // 16.16 fixed point, so the ISR needs no float math
+        int32_t _toleranceSteps;
+        int32_t _offset = 0;  // Motor steps minus encoder steps when they were last lined up
+
+        volatile int32_t _error = 0;  // Set by the ISR when out of tolerance
+
+    public:
+        enum Action {
+            LOG = 0,
+            ALARM,
+        };
+
+        Pin   _aPin;
+        Pin   _bPin;
+        float _countsPerMm = 0;     // Edges of both signals, four per line
+        float _toleranceMm = 0.5f;  // Largest difference from the stepped position
+        int   _filterNs    = 1000;  // Shorter glitches are not counted
+        int   _action      = ALARM;
+
+        void init(int axis, int motorNum);
+
+        // Counts the edges since the last sample, often enough that the counter cannot wrap in between
+        void sample();
+
+        // Encoder position in motor steps
+        int32_t steps();
+
+        // Takes the motor position as correct, so that the error starts at zero
+        void sync(int32_t motorSteps);
+
+        // Compares the encoder with the motor position, returning true if the
+        // error is newly beyond the tolerance
+        bool check(int32_t motorSteps);
+
+        // True when at least one motor has an encoder
+        static bool enabled;
+
+        // Samples all the encoders and checks them, unless homing.  Called from the step ISR.
+        static void check_all();
+
+        // Lines all the encoders up with their motors
+        static void sync_all();
+
+        // Logs new errors and raises the alarm if configured.  Run as an event.
+        static void report();
+
+        // Configuration handlers:
+        void validate() override;
+        void group(Configuration::HandlerBase& handler) override;
+    };
+
+    extern EnumItem encoderActions[];
+}
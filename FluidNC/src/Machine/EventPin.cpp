@@ -3,13 +3,31 @@
 
 #include "src/Protocol.h"  // protocol_send_event
 
+#include <esp_timer.h>  // esp_timer_get_time()
+
 EventPin::EventPin(Event* event, const char* legend) : _event(event), _legend(legend) {}
 
 void EventPin::trigger(bool active) {
     update(active);
-    log_debug(_legend << " " << active);
-    if (active) {
-        protocol_send_event(_event, this);
+    if (active && _delivered) {
+        _delivered = false;
+        log_debug(_legend << " " << active << " from interrupt " << int32_t(esp_timer_get_time() - _edgeUsecs) << "us ago");
+    } else {
+        log_debug(_legend << " " << active);
+        if (active) {
+            protocol_send_event(_event, this);
+        }
     }
     report_recompute_pin_string();
 }
+
+void EventPin::edgeTrigger(bool active, int64_t usecs) {
+    update(active);
+    if (!active) {
+        _delivered = false;
+    } else if (!_delivered) {
+        _edgeUsecs = usecs;
+        _delivered = true;
+        protocol_send_event_from_ISR(_event, this);
+    }
+}
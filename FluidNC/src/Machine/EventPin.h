@@ -7,14 +7,27 @@ class EventPin {
 protected:
     Event* _event = nullptr;  // Subordinate event that is called conditionally
 
+    volatile bool    _delivered = false;  // The edge interrupt has sent the event for this activation
+    volatile int64_t _edgeUsecs = 0;      // When it did
+
 public:
     std::string _legend;  // The name that appears in init() messages and the name of the configuration item
 
+    // Pins on native GPIOs that set this are also triggered from an edge interrupt, for the
+    // events whose latency matters, and ignore bounces for _debounceMs after each change
+    bool     _edgeDriven = false;
+    uint32_t _debounceMs = 5;
+
     EventPin(Event* event, const char* legend);
 
     virtual void update(bool state) {};
 
     void trigger(bool active);
 
+    // From the edge interrupt, usecs being the esp_timer time of the edge.  update() is
+    // called at once and the event sent, and trigger(), which follows when the input is
+    // polled, does not send it again.
+    void edgeTrigger(bool active, int64_t usecs);
+
     ~EventPin() {}
 };
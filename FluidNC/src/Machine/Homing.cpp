@@ -29,9 +29,6 @@ namespace Machine {
     // Then we scale the travel distances for the other axes so they would complete
     // at the same time.
 
-    const uint32_t MOTOR0 = 0xffff;
-    const uint32_t MOTOR1 = 0xffff0000;
-
     Homing::Phase   Homing::_phase       = Phase::None;
     AxisMask        Homing::_cycleAxes   = 0;
     AxisMask        Homing::_phaseAxes   = 0;
@@ -40,6 +37,16 @@ namespace Machine {
     std::queue<int> Homing::_remainingCycles;
     uint32_t        Homing::_settling_ms;
 
+    bool          Homing::_async = false;
+    Homing::Phase Homing::_axisPhase[MAX_N_AXIS];
+    float         Homing::_axisLeft[MAX_N_AXIS];
+    float         Homing::_axisDir[MAX_N_AXIS];
+    float         Homing::_moveStart[MAX_N_AXIS];
+    uint32_t      Homing::_asyncSettle_ms;
+
+    AxisMask Homing::_trusted    = 0;
+    bool     Homing::_confirming = false;
+
     AxisMask Homing::_unhomed_axes;  // Bitmap of axes whose position is unknown
 
     bool Homing::axis_is_homed(size_t axis) {
@@ -47,12 +54,21 @@ namespace Machine {
     }
     void Homing::set_axis_homed(size_t axis) {
         clear_bitnum(_unhomed_axes, axis);
+        clear_bitnum(_trusted, axis);
     }
     void Homing::set_axis_unhomed(size_t axis) {
         set_bitnum(_unhomed_axes, axis);
+        clear_bitnum(_trusted, axis);
     }
     void Homing::set_all_axes_unhomed() {
         _unhomed_axes = Machine::Axes::homingMask;
+        _trusted      = 0;
+    }
+    void Homing::trust(AxisMask axes) {
+        _trusted = axes & _unhomed_axes;
+        if (_trusted) {
+            log_info("Restored the position of " << config->_axes->maskToNames(_trusted) << "; homing will confirm it");
+        }
     }
     void Homing::set_all_axes_homed() {
         _unhomed_axes = 0;
@@ -70,7 +86,10 @@ namespace Machine {
         float rate;
         float target[config->_axes->_numberAxis];
         axisVector(_phaseAxes, _phaseMotors, _phase, target, rate, _settling_ms);
+        queueMove(target, rate);
+    }
 
+    void Homing::queueMove(float* target, float rate) {
         plan_line_data_t plan_data      = {};
         plan_data.spindle_speed         = 0;
         plan_data.motion                = {};
@@ -93,8 +112,16 @@ namespace Machine {
     }
 
     void Homing::cycleStop() {
+        if (_async) {
+            asyncCycleStop();
+            return;
+        }
         log_debug("CycleStop " << phaseName(_phase));
         if (approach()) {
+            if (_confirming) {
+                fullCycle();
+                return;
+            }
             // Cycle stop while approaching means that we did not hit
             // a limit switch in the programmed distance
             fail(ExecAlarm::HomingFailApproach);
@@ -105,6 +132,10 @@ namespace Machine {
         // Cycle stop in pulloff is success unless
         // the limit switches are still active.
         if (limited() & _phaseMotors) {
+            if (_confirming && _phase == Phase::Pulloff0) {
+                fullCycle();  // The switch is closer than the restored position says
+                return;
+            }
             // Homing failure: Limit switch still engaged after pull-off motion
             fail(ExecAlarm::HomingFailPulloff);
             return;
@@ -154,7 +185,7 @@ namespace Machine {
         AxisMask axesMask = 0;
         // Find the axis that will take the longest
         for (int axis = 0; axis < n_axis; axis++) {
-            if (bitnum_is_false(motors, Machine::Axes::motor_bit(axis, 0)) && bitnum_is_false(motors, Machine::Axes::motor_bit(axis, 1))) {
+            if (bitnum_is_false(Machine::Axes::motors_to_axes(motors), axis)) {
                 continue;
             }
 
@@ -183,13 +214,12 @@ namespace Machine {
                 case Machine::Homing::Phase::Pulloff2:
                     axis_rate = homing->_feedRate;
                     travel    = axisConfig->extraPulloff();
-                    if (travel < 0) {
-                        // Motor0's pulloff is greater than motor1's, so we block motor1
-                        axisConfig->_motors[1]->block();
-                        travel = -travel;
-                    } else if (travel > 0) {
-                        // Motor1's pulloff is greater than motor0's, so we block motor0
-                        axisConfig->_motors[0]->block();
+                    // Only the motors with the largest pulloff move, so we block the others
+                    for (size_t motor = 0; motor < Machine::Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                        auto m = axisConfig->_motors[motor];
+                        if (m && m->_pulloff - axisConfig->commonPulloff() < travel) {
+                            m->block();
+                        }
                     }
                     // All motors will be unblocked later by set_homing_mode()
                     break;
@@ -287,14 +317,188 @@ namespace Machine {
             }
         }
 
+        if (_phase == Phase::FastApproach && asyncCycle()) {
+            startAsync();
+            return;
+        }
+
         config->_kinematics->releaseMotors(_phaseAxes, _phaseMotors);
 
         startMove(_phaseAxes, _phaseMotors, _phase, _settling_ms);
     }
 
+    // Pulloff2 moves only some of the motors of an axis after the others have finished,
+    // so cycles that need it are run in step
+    bool Homing::asyncCycle() {
+        return config->_axes->_homingAsync && !needsPulloff2(_cycleMotors);
+    }
+
+    void Homing::startAsync() {
+        AxisMask axes = Machine::Axes::motors_to_axes(_phaseMotors);
+        log_debug("Homing async " << config->_axes->maskToNames(axes));
+        _async     = true;
+        _phaseAxes = 0;  // Nothing has moved yet
+        for (size_t axis = 0; axis < config->_axes->_numberAxis; axis++) {
+            _axisPhase[axis] = Phase::CycleDone;
+            if (bitnum_is_true(axes, axis)) {
+                asyncPhase(axis, Phase::FastApproach);
+            }
+        }
+        asyncMove();
+    }
+
+    void Homing::asyncPhase(size_t axis, Phase phase) {
+        auto     axisConfig = config->_axes->_axis[axis];
+        auto     homing     = axisConfig->_homing;
+        AxisMask axisMask   = bitnum_to_mask(axis);
+
+        _axisPhase[axis] = phase;
+        log_debug("Homing " << config->_axes->axisName(axis) << " " << phaseName(phase));
+        switch (phase) {
+            case Phase::FastApproach:
+                _axisLeft[axis] = axisConfig->_maxTravel * homing->_seek_scaler;
+                break;
+            case Phase::SlowApproach:
+                _axisLeft[axis] = axisConfig->commonPulloff() * homing->_feed_scaler;
+                break;
+            case Phase::Pulloff0:
+            case Phase::Pulloff1:
+                _axisLeft[axis] = axisConfig->commonPulloff();
+                break;
+            default:
+                return;
+        }
+        _axisDir[axis] = (homing->_positiveDirection == approaching(phase)) ? 1.0f : -1.0f;
+        config->_kinematics->releaseMotors(axisMask, Machine::Axes::axes_to_motors(axisMask) & _cycleMotors);
+    }
+
+    // Takes what the axes moved since the move started off what they have left to go
+    void Homing::asyncProgress() {
+        float* mpos = get_mpos();
+        for (size_t axis = 0; axis < config->_axes->_numberAxis; axis++) {
+            if (bitnum_is_true(_phaseAxes, axis)) {
+                _axisLeft[axis] -= (mpos[axis] - _moveStart[axis]) * _axisDir[axis];
+            }
+        }
+    }
+
+    void Homing::asyncAdvance(AxisMask axes) {
+        _asyncSettle_ms = 0;
+        for (size_t axis = 0; axis < config->_axes->_numberAxis; axis++) {
+            if (bitnum_is_true(axes, axis)) {
+                _asyncSettle_ms = std::max(_asyncSettle_ms, config->_axes->_axis[axis]->_homing->_settle_ms);
+                Phase phase = _axisPhase[axis];
+                asyncPhase(axis, phase == Phase::Pulloff1 ? Phase::CycleDone : static_cast<Phase>(static_cast<int>(phase) + 1));
+            }
+        }
+    }
+
+    void Homing::asyncMove() {
+        auto axes   = config->_axes;
+        auto n_axis = axes->_numberAxis;
+
+        // Axes that are within a step of the end of their phase have finished it
+        AxisMask finished = 0;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (bitnum_is_false(_phaseAxes, axis) || _axisLeft[axis] * axes->_axis[axis]->_stepsPerMm >= 1.0f) {
+                continue;
+            }
+            if (approaching(_axisPhase[axis])) {
+                log_debug("Homing " << axes->axisName(axis) << " did not reach its switch");
+                fail(ExecAlarm::HomingFailApproach);
+                report_realtime_status(allChannels);
+                return;
+            }
+            if (limited() & Machine::Axes::axes_to_motors(bitnum_to_mask(axis)) & _cycleMotors) {
+                // Homing failure: Limit switch still engaged after pull-off motion
+                fail(ExecAlarm::HomingFailPulloff);
+                return;
+            }
+            set_bitnum(finished, axis);
+        }
+        if (finished) {
+            asyncAdvance(finished);
+            delay_ms(_asyncSettle_ms);  // Delay to allow transient dynamics to dissipate.
+        }
+
+        float* mpos = get_mpos();
+        copyAxes(_moveStart, mpos);
+
+        float target[MAX_N_AXIS];
+        float rates[MAX_N_AXIS] = { 0 };
+        float ratesq            = 0;
+        float minutes           = INFINITY;  // Until the first axis finishes its phase
+        _phaseAxes              = 0;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            target[axis] = mpos[axis];
+            Phase phase  = _axisPhase[axis];
+            if (phase == Phase::CycleDone) {
+                continue;
+            }
+            auto homing = axes->_axis[axis]->_homing;
+            rates[axis] = phase == Phase::FastApproach ? homing->_seekRate : homing->_feedRate;
+            ratesq += rates[axis] * rates[axis];
+            minutes = std::min(minutes, _axisLeft[axis] / rates[axis]);
+            set_bitnum(_phaseAxes, axis);
+        }
+        _phaseMotors = Machine::Axes::axes_to_motors(_phaseAxes) & _cycleMotors;
+
+        if (!_phaseAxes) {
+            _async = false;
+            set_mpos();
+            nextCycle();
+            return;
+        }
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (bitnum_is_true(_phaseAxes, axis)) {
+                target[axis] += rates[axis] * minutes * _axisDir[axis];
+            }
+        }
+        log_debug("Planned async move to " << target[0] << "," << target[1] << "," << target[2] << " @ " << sqrtf(ratesq));
+        queueMove(target, sqrtf(ratesq));
+    }
+
+    // The move ended, so at least one axis came to the end of its phase
+    void Homing::asyncCycleStop() {
+        Stepper::reset();
+        asyncProgress();
+        asyncMove();
+    }
+
+    // Limit switch chatter on an axis that is pulling off is ignored, and an axis that is
+    // approaching only changes phase when the kinematics say it has reached its switch
+    void Homing::asyncLimitReached() {
+        AxisMask approachingAxes = 0;
+        for (size_t axis = 0; axis < config->_axes->_numberAxis; axis++) {
+            if (bitnum_is_true(_phaseAxes, axis) && approaching(_axisPhase[axis])) {
+                set_bitnum(approachingAxes, axis);
+            }
+        }
+        AxisMask  stillApproaching = approachingAxes;
+        MotorMask motors           = Machine::Axes::axes_to_motors(approachingAxes) & _cycleMotors;
+        config->_kinematics->limitReached(stillApproaching, motors, limited());
+
+        AxisMask reached = approachingAxes & ~stillApproaching;
+        if (!reached) {
+            return;
+        }
+        log_debug("Homing reached " << config->_axes->maskToNames(reached));
+
+        Stepper::reset();  // Stop moving
+        asyncProgress();
+        asyncAdvance(reached);
+        delay_ms(_asyncSettle_ms);
+        asyncMove();
+    }
+
     void Homing::limitReached() {
         // As limit bits are set, let the kinematics system figure out what that
         // means in terms of axes, motors, and whether to stop and replan
+        if (_async) {
+            asyncLimitReached();
+            return;
+        }
+
         MotorMask limited = Machine::Axes::posLimitMask | Machine::Axes::negLimitMask;
 
         if (!approach()) {
@@ -368,12 +572,66 @@ namespace Machine {
 
         _cycleAxes &= Machine::Axes::homingMask;
         _cycleMotors = config->_axes->set_homing_mode(_cycleAxes, true);
+        _async       = false;
+        _confirming  = _cycleMotors && !(_cycleAxes & ~_trusted) && !needsPulloff2(_cycleMotors);
+        if (_confirming) {
+            startConfirm();
+            return;
+        }
 
         _phase = Phase::PrePulloff;
         runPhase();
     }
 
+    // The homed position is the pulloff distance from the switches, where a full cycle is
+    // at the end of Pulloff0, so a confirming cycle moves there at the seek rates as its
+    // Pulloff0 and carries on from SlowApproach.
+    void Homing::startConfirm() {
+        auto   axes   = config->_axes;
+        auto   n_axis = axes->_numberAxis;
+        float* mpos   = get_mpos();
+
+        log_info("Homing " << axes->maskToNames(_cycleAxes) << " from the restored position");
+
+        float target[MAX_N_AXIS];
+        float distsq  = 0;
+        float minutes = 0;  // For the axis that takes longest at its seek rate
+        _settling_ms  = 0;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            target[axis] = mpos[axis];
+            if (bitnum_is_false(_cycleAxes, axis)) {
+                continue;
+            }
+            auto homing  = axes->_axis[axis]->_homing;
+            target[axis] = homing->_mpos;
+            float d      = target[axis] - mpos[axis];
+            distsq += d * d;
+            minutes      = std::max(minutes, fabsf(d) / homing->_seekRate);
+            _settling_ms = std::max(_settling_ms, homing->_settle_ms);
+        }
+
+        _phase       = Phase::Pulloff0;
+        _phaseAxes   = _cycleAxes;
+        _phaseMotors = _cycleMotors;
+        if (minutes == 0) {
+            nextPhase();  // Already there
+            return;
+        }
+        queueMove(target, sqrtf(distsq) / minutes);
+    }
+
+    void Homing::fullCycle() {
+        log_info("Restored position of " << config->_axes->maskToNames(_cycleAxes) << " not confirmed; homing fully");
+        Stepper::reset();
+        clear_bits(_trusted, _cycleAxes);
+        _confirming = false;
+        _phase      = Phase::PrePulloff;
+        runPhase();
+    }
+
     void Homing::fail(ExecAlarm alarm) {
+        _async = false;
+        clear_bits(_trusted, _cycleAxes);
         Stepper::reset();                                   // Stop moving
         send_alarm(alarm);
         config->_axes->set_homing_mode(_cycleAxes, false);  // tell motors homing is done...failed
@@ -381,7 +639,7 @@ namespace Machine {
     }
 
     bool Homing::needsPulloff2(MotorMask motors) {
-        AxisMask squaredAxes = motors & (motors >> 16);
+        AxisMask squaredAxes = Machine::Axes::multi_motor_axes(motors);
         if (squaredAxes == 0) {
             // No axis has multiple motors
             return false;
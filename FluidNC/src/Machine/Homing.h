@@ -33,12 +33,19 @@ namespace Machine {
         static void set_all_axes_homed();
         static void set_all_axes_unhomed();
 
+        // The axes whose positions HomeMemory restored.  Homing them goes straight to the
+        // homed position and only confirms it with the slow approach and final pulloff,
+        // and does the full search if the switches are not found where they should be.
+        static void trust(AxisMask axes);
+
         Homing() = default;
 
         static const int AllCycles     = 0;   // Must be zero.
         static const int set_mpos_only = -1;  // If homing cycle is this value then don't move, just set mpos
 
-        static bool approach() { return _phase == FastApproach || _phase == SlowApproach; }
+        static bool approaching(Phase phase) { return phase == FastApproach || phase == SlowApproach; }
+        static bool approach() { return approaching(_phase); }
+        static bool approach(size_t axis) { return _async ? approaching(_axisPhase[axis]) : approach(); }
 
         static void fail(ExecAlarm alarm);
         static void cycleStop();
@@ -90,7 +97,13 @@ namespace Machine {
         static void limitReached();
 
     private:
-        static uint32_t planMove(AxisMask axisMask, MotorMask motors, Phase phase, float* target, float& rate);
+        static void queueMove(float* target, float rate);
+
+        static AxisMask _trusted;
+        static bool     _confirming;  // This cycle is confirming restored positions
+
+        static void startConfirm();
+        static void fullCycle();
 
         static void done();
         static void runPhase();
@@ -104,6 +117,26 @@ namespace Machine {
 
         static std::queue<int> _remainingCycles;
 
+        // With homing_async, each axis of a cycle goes from FastApproach through Pulloff1 on
+        // its own, so one that reaches its switch pulls off while the others still approach.
+        // Each move runs every axis at its own rate, until the first of them finishes its
+        // phase or reaches its switch, and the next move is planned from there.
+        static bool     _async;
+        static Phase    _axisPhase[MAX_N_AXIS];
+        static float    _axisLeft[MAX_N_AXIS];   // Distance still to go in the phase
+        static float    _axisDir[MAX_N_AXIS];    // 1 or -1, the direction of the phase
+        static float    _moveStart[MAX_N_AXIS];  // Where the current move started
+        static uint32_t _asyncSettle_ms;         // The longest settling time of the axes that changed phase
+
+        static bool asyncCycle();
+        static void startAsync();
+        static void asyncPhase(size_t axis, Phase phase);
+        static void asyncProgress();
+        static void asyncAdvance(AxisMask axes);
+        static void asyncMove();
+        static void asyncCycleStop();
+        static void asyncLimitReached();
+
         static uint32_t _settling_ms;
 
         static const char* _phaseNames[];
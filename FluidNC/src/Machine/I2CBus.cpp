@@ -3,6 +3,10 @@
 
 #include "I2CBus.h"
 #include "Driver/fluidnc_i2c.h"
+#include "../Config.h"  // I2C_TASK_*
+
+#include <algorithm>
+#include <iterator>
 
 namespace Machine {
     I2CBus::I2CBus(int busNumber) : _busNumber(busNumber) {}
@@ -30,7 +34,16 @@ namespace Machine {
         _error = i2c_master_init(_busNumber, sdaPin, sclPin, _frequency);
         if (_error) {
             log_error("I2C init failed");
+            return;
         }
+        xTaskCreatePinnedToCore(busTask,            // task
+                                "i2c",              // name for task
+                                2048,               // size of task stack
+                                this,               // parameters
+                                I2C_TASK_PRIORITY,  // priority
+                                &_task,             // task handle
+                                I2C_TASK_CORE       // core
+        );
     }
 
     int I2CBus::write(uint8_t address, const uint8_t* data, size_t count) {
@@ -46,4 +59,58 @@ namespace Machine {
         }
         return i2c_read(_busNumber, address, data, count);
     }
+
+    bool I2CBus::submit(const Transaction& transaction) {
+        if (_error || !_task) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            auto slot = std::find_if(std::begin(_queue), std::end(_queue), [](const Queued& q) { return !q.used; });
+            if (slot == std::end(_queue)) {
+                return false;
+            }
+            *slot = { transaction, _sequence++, true };
+        }
+        xTaskNotifyGive(_task);
+        return true;
+    }
+
+    // Takes the queued transaction with the highest priority, and of those the oldest
+    bool I2CBus::take(Transaction& transaction) {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        Queued*                     best = nullptr;
+        for (auto& q : _queue) {
+            if (!q.used) {
+                continue;
+            }
+            if (!best || q.transaction.priority > best->transaction.priority ||
+                (q.transaction.priority == best->transaction.priority && int32_t(q.sequence - best->sequence) < 0)) {
+                best = &q;
+            }
+        }
+        if (!best) {
+            return false;
+        }
+        transaction = best->transaction;
+        best->used  = false;
+        return true;
+    }
+
+    // The driver runs each transfer from its interrupt while this task waits, so the
+    // tasks that submit never wait for the bus
+    void I2CBus::busTask(void* arg) {
+        auto bus = static_cast<I2CBus*>(arg);
+        while (true) {
+            Transaction t;
+            if (!bus->take(t)) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                continue;
+            }
+            int result = i2c_write_read(bus->_busNumber, t.address, t.tx, t.txCount, t.rx, t.rxCount);
+            if (t.done) {
+                t.done(t.arg, result);
+            }
+        }
+    }
 }
@@ -6,14 +6,48 @@
 #include "../Configuration/Configurable.h"
 
 #include <esp_attr.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mutex>
 
 class TwoWire;
 
 namespace Machine {
     class I2CBus : public Configuration::Configurable {
+    public:
+        // A transfer for the bus task.  It writes txCount bytes from tx, then, if rxCount
+        // is not 0, reads rxCount bytes into rx after a repeated start.  The buffers must
+        // stay valid until done, if it is set, is called from the bus task with the number
+        // of bytes transferred or -1.
+        struct Transaction {
+            uint8_t        address;
+            uint8_t        priority;  // Higher goes first; equal ones go in the order submitted
+            const uint8_t* tx;
+            size_t         txCount;
+            uint8_t*       rx;
+            size_t         rxCount;
+            void (*done)(void* arg, int result);
+            void* arg;
+        };
+        static const int queueSize = 32;
+
     private:
         bool _error = false;
 
+        // Transactions waiting for the bus task, with the order they came in
+        struct Queued {
+            Transaction transaction;
+            uint32_t    sequence;
+            bool        used;
+        };
+        Queued       _queue[queueSize] = {};
+        uint32_t     _sequence         = 0;
+        std::mutex   _queueMutex;
+        TaskHandle_t _task = nullptr;
+
+        bool        take(Transaction& transaction);
+        static void busTask(void* arg);
+
     public:
         I2CBus(int busNumber);
 
@@ -26,9 +60,15 @@ namespace Machine {
         void validate() override;
         void group(Configuration::HandlerBase& handler) override;
 
+        // These block the caller until the transfer is done.  The driver serializes them
+        // with the bus task's transfers, but they do not wait in its queue.
         int write(uint8_t address, const uint8_t* data, size_t count);
         int read(uint8_t address, uint8_t* data, size_t count);
 
+        // Queues a transaction for the bus task and returns at once.  Returns false if the
+        // queue is full or the bus failed to start.
+        bool submit(const Transaction& transaction);
+
         ~I2CBus() = default;
     };
 }
@@ -18,10 +18,31 @@ namespace Machine {
         handler.item("bck_pin", _bck);
         handler.item("data_pin", _data);
         handler.item("ws_pin", _ws);
+        dmaItems(handler);
+    }
+
+    void I2SOBus::dmaItems(Configuration::HandlerBase& handler) {
+        handler.item("dma_buffer_count", _dmaBufferCount, 2, 16);
+        handler.item("dma_buffer_bytes", _dmaBufferBytes, I2S_OUT_DMABUF_LEN_MIN, I2S_OUT_DMABUF_LEN_MAX);
+        handler.item("low_latency_buffer_bytes", _lowLatencyBufferBytes, 0, I2S_OUT_DMABUF_LEN_MAX);
+    }
+
+    void I2SOBus::afterParse() {
+        if (_lowLatencyBufferBytes) {
+            if (_lowLatencyBufferBytes < I2S_OUT_DMABUF_LEN_MIN) {
+                log_warn("Increasing i2so/low_latency_buffer_bytes to " << I2S_OUT_DMABUF_LEN_MIN);
+                _lowLatencyBufferBytes = I2S_OUT_DMABUF_LEN_MIN;
+            }
+            if (_lowLatencyBufferBytes > _dmaBufferBytes) {
+                log_warn("Decreasing i2so/low_latency_buffer_bytes to dma_buffer_bytes");
+                _lowLatencyBufferBytes = _dmaBufferBytes;
+            }
+        }
     }
 
     void I2SOBus::init() {
-        log_info("I2SO BCK:" << _bck.name() << " WS:" << _ws.name() << " DATA:" << _data.name());
+        log_info("I2SO BCK:" << _bck.name() << " WS:" << _ws.name() << " DATA:" << _data.name() << " DMA:" << _dmaBufferCount << "x"
+                              << _dmaBufferBytes);
         i2s_out_init();
     }
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../Configuration/Configurable.h"
+#include "../I2SOut.h"  // I2S_OUT_DMABUF_*
 
 namespace Machine {
     class I2SOBus : public Configuration::Configurable {
@@ -15,11 +16,25 @@ namespace Machine {
         Pin _data;
         Pin _ws;
 
+        // DMA buffer geometry for I2S_STREAM.  Deeper buffers ride out longer
+        // stalls of the task that fills them; shorter ones reduce the delay
+        // between the stepper and the pins.
+        uint32_t _dmaBufferCount = I2S_OUT_DMABUF_COUNT;
+        uint32_t _dmaBufferBytes = I2S_OUT_DMABUF_LEN;
+
+        // If nonzero, homing and probing keep streaming with buffers filled
+        // only this far instead of switching to I2S_STATIC
+        uint32_t _lowLatencyBufferBytes = 0;
+
         void validate() override;
+        void afterParse() override;
         void group(Configuration::HandlerBase& handler) override;
 
         void init();
 
         ~I2SOBus() = default;
+
+    protected:
+        void dmaItems(Configuration::HandlerBase& handler);
     };
 }
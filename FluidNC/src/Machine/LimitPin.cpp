@@ -41,6 +41,9 @@ namespace Machine {
         _legend += " ";
         _legend += sDir;
         _legend += " Limit";
+
+        // Stepping stops as soon as the switch closes, not when it is next polled
+        _edgeDriven = true;
     }
 
     void LimitPin::init() {
@@ -55,7 +58,7 @@ namespace Machine {
 
     void LimitPin::update(bool value) {
         if (value) {
-            if (Homing::approach() || (sys.state != State::Homing && _pHardLimits)) {
+            if (Homing::approach(_axis) || (sys.state != State::Homing && _pHardLimits)) {
                 _pLimited = value;
 
                 if (_pExtraLimited != nullptr) {
@@ -14,7 +14,7 @@ namespace Machine {
         bool& _pHardLimits;
 
         // _pLimited is a reference to the _limited member of
-        // the Motor class.  Setting it when the Limit ISR fires
+        // the Motor class.  Setting it from the edge interrupt
         // lets the motor driver respond rapidly to a limit switch
         // touch, increasing the accuracy of homing
         // _pExtraLimited lets the limit control two motors, as with
@@ -33,7 +33,7 @@ namespace Machine {
         void update(bool value) override;
 
         void init();
-        void makeDualMask();  // makes this a mask for motor0 and motor1
+        void makeDualMask();  // makes this a mask for all the motors of the axis
         void setExtraMotorLimit(int axis, int motorNum);
 
         bool isHard() { return _pHardLimits; }
@@ -14,24 +14,33 @@
 
 #include "../SettingsDefinitions.h"  // config_filename
 #include "../FileStream.h"
+#include "Driver/config_partition.h"
 
+#include "../Configuration/Arena.h"
 #include "../Configuration/Parser.h"
 #include "../Configuration/ParserHandler.h"
 #include "../Configuration/Validator.h"
 #include "../Configuration/AfterParse.h"
+#include "../Configuration/PathIndex.h"
 #include "../Configuration/ParseException.h"
 #include "../Config.h"  // ENABLE_*
 
+#include <mbedtls/md.h>
 #include <cstdio>
 #include <cstring>
 #include <atomic>
 #include <memory>
+#include <filesystem>
 
 Machine::MachineConfig* config;
 
 // TODO FIXME: Split this file up into several files, perhaps put it in some folder and namespace Machine?
 
 namespace Machine {
+    EnumItem junctionModels[] = { { MachineConfig::DEVIATION, "Deviation" },
+                                  { MachineConfig::CENTRIPETAL, "Centripetal" },
+                                  EnumItem(MachineConfig::DEVIATION) };
+
     void MachineConfig::group(Configuration::HandlerBase& handler) {
         handler.item("board", _board);
         handler.item("name", _name);
@@ -44,8 +53,10 @@ namespace Machine {
 
         handler.section("uart_channel1", _uart_channels[1], 1);
         handler.section("uart_channel2", _uart_channels[2], 2);
+        handler.section("usb_cdc_channel", _usbCdcChannel);
 
         handler.section("i2so", _i2so);
+        handler.section("spiso", _spiso);
 
         handler.section("i2c0", _i2c[0], 0);
         handler.section("i2c1", _i2c[1], 1);
@@ -62,22 +73,30 @@ namespace Machine {
         handler.section("macros", _macros);
         handler.section("start", _start);
         handler.section("parking", _parking);
+        handler.section("height_map", _heightMap);
 
         handler.section("user_outputs", _userOutputs);
 
         handler.section("oled", _oled);
         handler.section("status_outputs", _stat_out);
+        handler.section("latency_probe", _latencyProbe);
+        handler.section("sync_link", _syncLink);
+        handler.section("mpg", _mpg);
 
         Spindles::SpindleFactory::factory(handler, _spindles);
 
         // TODO: Consider putting these under a gcode: hierarchy level? Or motion control?
         handler.item("arc_tolerance_mm", _arcTolerance, 0.001, 1.0);
+        handler.item("native_arcs", _nativeArcs);
         handler.item("junction_deviation_mm", _junctionDeviation, 0.01, 1.0);
+        handler.item("junction_model", _junctionModel, junctionModels);
+        handler.item("centripetal_max_angle_deg", _centripetalAngle, 1.0, 90.0);
+        handler.item("merge_tolerance_mm", _mergeTolerance, 0.0, 1.0);
         handler.item("verbose_errors", _verboseErrors);
         handler.item("report_inches", _reportInches);
         handler.item("enable_parking_override_control", _enableParkingOverrideControl);
         handler.item("use_line_numbers", _useLineNumbers);
-        handler.item("planner_blocks", _planner_blocks, 10, 120);
+        handler.item("planner_blocks", _planner_blocks, 10, maxPlannerBlocks);
     }
 
     void MachineConfig::afterParse() {
@@ -116,6 +135,7 @@ namespace Machine {
 
         // We do not auto-create an I2SO bus config node
         // Only if an i2so section is present will config->_i2so be non-null
+        Assert(!(_i2so && _spiso), "Only one of i2so and spiso can be configured");
 
         if (_control == nullptr) {
             _control = new Control();
@@ -129,6 +149,10 @@ namespace Machine {
             _parking = new Parking();
         }
 
+        if (_heightMap == nullptr) {
+            _heightMap = new HeightMap();
+        }
+
         if (_spindles.size() == 0) {
             _spindles.push_back(new Spindles::Null());
         }
@@ -174,6 +198,126 @@ namespace Machine {
         return configOkay;
     }
 
+    // The tokens of the config file are kept in compiled form, so that it is only parsed as
+    // YAML when it has changed.  They go in the config partition if there is one, where they
+    // are read in place, or else in a file beside the config file, which is read a piece at
+    // a time.  They start with the SHA-256 of the YAML they came from, so a change made by
+    // any means, even one that keeps the size and time, compiles it again.
+    struct CompiledHeader {
+        char     magic[4];
+        uint32_t length;  // Of the records that follow
+        uint8_t  hash[32];
+    };
+    static const char compiledMagic[4] = { 'F', 'C', 'C', '1' };
+
+    static bool header_matches(const CompiledHeader& header, const uint8_t* hash) {
+        return !memcmp(header.magic, compiledMagic, sizeof(compiledMagic)) && !memcmp(header.hash, hash, sizeof(header.hash));
+    }
+
+    static std::string compiled_path(const std::string& path) {
+        std::filesystem::path p(path);
+        return (p.parent_path() / ("." + p.filename().string() + ".bin")).string();
+    }
+
+    static Configuration::Tokenizer::reader_t file_reader(FileStream& file) {
+        return [&file](char* buf, size_t len) { return file.read(buf, len); };
+    }
+
+    static bool hash_config(FileStream& file, uint8_t* hash) {
+        mbedtls_md_context_t ctx;
+        uint8_t              buf[1024];
+        size_t               len;
+        size_t               total = 0;
+
+        mbedtls_md_init(&ctx);
+        mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+        mbedtls_md_starts(&ctx);
+        while ((len = file.read(buf, sizeof(buf))) > 0) {
+            mbedtls_md_update(&ctx, buf, len);
+            total += len;
+        }
+        mbedtls_md_finish(&ctx, hash);
+        mbedtls_md_free(&ctx);
+        return total == file.size() && file.seek(0);
+    }
+
+    // Returns false if there is no compiled config for this hash, otherwise loads it and
+    // sets okay to the result
+    static bool load_compiled(const std::string& path, const uint8_t* hash, bool& okay) {
+        size_t partitionSize = config_partition_size();
+        if (partitionSize) {
+            const char* flash = config_partition_map();
+            if (!flash) {
+                return false;
+            }
+            CompiledHeader header;
+            memcpy(&header, flash, sizeof(header));
+            bool valid = header_matches(header, hash) && header.length <= partitionSize - sizeof(header);
+            if (valid) {
+                log_debug("Using compiled configuration in the config partition");
+                okay = MachineConfig::load_yaml(std::string_view { flash + sizeof(header), header.length }, true);
+            }
+            config_partition_unmap();
+            return valid;
+        }
+
+        try {
+            FileStream     file(path, "r");
+            CompiledHeader header;
+            if (file.read((char*)&header, sizeof(header)) != sizeof(header) || !header_matches(header, hash) ||
+                file.size() != sizeof(header) + header.length) {
+                return false;
+            }
+            log_debug("Using compiled configuration " << path);
+            Configuration::Parser parser(file_reader(file), true);
+            okay = MachineConfig::load_parser(parser);
+            return true;
+        } catch (...) { return false; }
+    }
+
+    // The header goes in last, so a config that is only partly written is never used
+    static void save_compiled(FileStream& yaml, const std::string& path, const uint8_t* hash) {
+        CompiledHeader header;
+        memcpy(header.magic, compiledMagic, sizeof(compiledMagic));
+        memcpy(header.hash, hash, sizeof(header.hash));
+        header.length = 0;
+
+        Configuration::Tokenizer tokenizer(file_reader(yaml));
+        try {
+            if (config_partition_size()) {
+                size_t offset = sizeof(header);
+                if (!config_partition_erase()) {
+                    log_warn("Cannot erase the config partition");
+                    return;
+                }
+                auto out = [&offset](const char* data, size_t len) {
+                    bool ok = config_partition_write(offset, data, len);
+                    offset += len;
+                    return ok;
+                };
+                if (Configuration::Tokenizer::compile(tokenizer, out)) {
+                    header.length = offset - sizeof(header);
+                    config_partition_write(0, &header, sizeof(header));
+                } else {
+                    log_warn("Compiled configuration does not fit in the config partition");
+                }
+                return;
+            }
+
+            FileStream     file(path, "w");
+            CompiledHeader blank = {};
+            file.write((const uint8_t*)&blank, sizeof(blank));
+
+            auto out = [&file, &header](const char* data, size_t len) {
+                header.length += len;
+                return file.write((const uint8_t*)data, len) == len;
+            };
+            if (Configuration::Tokenizer::compile(tokenizer, out) && file.seek(0)) {
+                file.write((const uint8_t*)&header, sizeof(header));
+            }
+        } catch (...) { log_debug("Cannot save the compiled configuration"); }
+    }
+
     bool MachineConfig::load_file(const std::string_view filename) {
         try {
             FileStream file(std::string { filename }, "r", "");
@@ -184,26 +328,40 @@ namespace Machine {
                 return false;
             }
 
-            auto buffer      = std::make_unique<char[]>(filesize + 1);
-            buffer[filesize] = '\0';
-            auto actual      = file.read(buffer.get(), filesize);
-            if (actual != filesize) {
+            uint8_t hash[32];
+            if (!hash_config(file, hash)) {
                 log_info("Configuration file:" << filename << " read error");
                 return false;
             }
             log_info("Configuration file:" << filename);
-            // Trimming the overall config file could influence indentation, hence false
-            return load_yaml(std::string_view { buffer.get(), filesize });
+
+            bool        okay;
+            std::string compiledPath = compiled_path(file.path());
+            if (load_compiled(compiledPath, hash, okay)) {
+                return okay;
+            }
+
+            // The file is parsed as it is read, so only a line of it is in memory at a time
+            Configuration::Parser parser(file_reader(file));
+            okay = load_parser(parser);
+            if (okay && file.seek(0)) {
+                save_compiled(file, compiledPath, hash);
+            }
+            return okay;
         } catch (...) {
             log_warn("Cannot open configuration file:" << filename);
             return false;
         }
     }
 
-    bool MachineConfig::load_yaml(std::string_view input) {
+    bool MachineConfig::load_yaml(std::string_view input, bool compiled) {
+        Configuration::Parser parser(input, compiled);
+        return load_parser(parser);
+    }
+
+    bool MachineConfig::load_parser(Configuration::Parser& parser) {
         bool successful = false;
         try {
-            Configuration::Parser        parser(input);
             Configuration::ParserHandler handler(parser);
 
             // instance() is by reference, so we can just get rid of an old instance and
@@ -213,6 +371,10 @@ namespace Machine {
                 if (machineConfig != nullptr) {
                     delete machineConfig;
                 }
+                if (!Configuration::Arena::release()) {
+                    log_debug("Keeping the config arena for " << Configuration::Arena::live() << " objects that outlived the config");
+                }
+                Configuration::Arena::open();
                 machineConfig = new MachineConfig();
             }
             config = instance();
@@ -227,6 +389,8 @@ namespace Machine {
                 config->group(afterParse);
             } catch (std::exception& ex) { log_error("Validation error: " << ex.what()); }
 
+            Configuration::PathIndex::build(config);
+
             log_debug("Checking configuration");
 
             try {
@@ -260,6 +424,10 @@ namespace Machine {
             log_error("Unknown error while processing config file");
         }
 
+        Configuration::Arena::close();
+        log_debug("Config arena " << Configuration::Arena::used() << " bytes in " << Configuration::Arena::reserved()
+                                  << " bytes of blocks");
+
         std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);
 
         return successful;
@@ -268,6 +436,7 @@ namespace Machine {
     MachineConfig::~MachineConfig() {
         delete _axes;
         delete _i2so;
+        delete _spiso;
         delete _coolant;
         delete _probe;
         delete _sdCard;
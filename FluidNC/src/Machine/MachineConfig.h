@@ -14,22 +14,32 @@
 #include "../Control.h"
 #include "../Probe.h"
 #include "src/Parking.h"
+#include "src/HeightMap.h"
+#include "src/LatencyProbe.h"
 #include "../SDCard.h"
 #include "../Spindles/Spindle.h"
 #include "../Stepping.h"
 #include "../Stepper.h"
+#include "../SyncLink.h"
+#include "../Mpg.h"
 #include "../Config.h"
 #include "../OLED.h"
 #include "../Status_outputs.h"
+#include "../UsbCdcChannel.h"
 #include "Axes.h"
 #include "SPIBus.h"
 #include "I2CBus.h"
 #include "I2SOBus.h"
+#include "SPISOBus.h"
 #include "UserOutputs.h"
 #include "Macros.h"
 
 #include <string_view>
 
+namespace Configuration {
+    class Parser;
+}
+
 namespace Machine {
     using ::Kinematics::Kinematics;
 
@@ -44,6 +54,10 @@ namespace Machine {
         // Idle and the user will be told to check the limits.
         bool _checkLimits = false;
 
+        // Keep the homed position across a restart, so that homing only needs to
+        // confirm it with a short touch of each switch.  See HomeMemory.h.
+        bool _fastRehome = false;
+
     public:
         Start() {}
 
@@ -51,6 +65,7 @@ namespace Machine {
             handler.item("must_home", _mustHome);
             handler.item("deactivate_parking", _deactivateParking);
             handler.item("check_limits", _checkLimits);
+            handler.item("fast_rehome", _fastRehome);
         }
 
         ~Start() = default;
@@ -65,6 +80,7 @@ namespace Machine {
         SPIBus*               _spi            = nullptr;
         I2CBus*               _i2c[MAX_N_I2C] = { nullptr };
         I2SOBus*              _i2so           = nullptr;
+        SPISOBus*             _spiso          = nullptr;
         Stepping*             _stepping       = nullptr;
         CoolantControl*       _coolant        = nullptr;
         Probe*                _probe          = nullptr;
@@ -74,19 +90,39 @@ namespace Machine {
         Macros*               _macros         = nullptr;
         Start*                _start          = nullptr;
         Parking*              _parking        = nullptr;
+        HeightMap*            _heightMap      = nullptr;
         OLED*                 _oled           = nullptr;
         Status_Outputs*       _stat_out       = nullptr;
+        LatencyProbe*         _latencyProbe   = nullptr;
+        SyncLink*             _syncLink       = nullptr;
+        Mpg*                  _mpg            = nullptr;
         Spindles::SpindleList _spindles;
 
-        UartChannel* _uart_channels[MAX_N_UARTS] = { nullptr };
-        Uart*        _uarts[MAX_N_UARTS]         = { nullptr };
+        UartChannel*   _uart_channels[MAX_N_UARTS] = { nullptr };
+        Uart*          _uarts[MAX_N_UARTS]         = { nullptr };
+        UsbCdcChannel* _usbCdcChannel              = nullptr;
+
+        // Models for the maximum speed through the junction between two blocks
+        enum junction_model_t {
+            DEVIATION = 0,  // Junction deviation, limited by the acceleration along the junction
+            CENTRIPETAL,    // Curve radius for shallow junctions, per-axis velocity change for sharp ones
+        };
 
         float _arcTolerance      = 0.002f;
+        bool  _nativeArcs        = false;  // Plan arcs as single curved blocks instead of chords
         float _junctionDeviation = 0.01f;
+        int   _junctionModel     = DEVIATION;
+        float _centripetalAngle  = 30.0f;  // Largest junction turn, in degrees, treated as part of a curve
+        float _mergeTolerance    = 0.0f;   // Lines that stray less from one line are planned as one, without G64 Q
         bool  _verboseErrors     = false;
         bool  _reportInches      = false;
 
-        size_t _planner_blocks = 16;
+        // The planner buffer is placed in PSRAM when available, so it can be made
+        // much larger than the default on boards that have it.
+        static const size_t defaultPlannerBlocks = 32;
+        static const size_t maxPlannerBlocks     = 1000;
+
+        size_t _planner_blocks = defaultPlannerBlocks;
 
         // Enables a special set of M-code commands that enables and disables the parking motion.
         // These are controlled by `M56`, `M56 P1`, or `M56 Px` to enable and `M56 P0` to disable.
@@ -107,12 +143,16 @@ namespace Machine {
         }
 #endif
 
+        // The bus that carries the I2SO pins, if either is configured
+        I2SOBus* i2soBus() { return _i2so ? _i2so : _spiso; }
+
         void afterParse() override;
         void group(Configuration::HandlerBase& handler) override;
 
         static bool load();
         static bool load_file(std::string_view file);
-        static bool load_yaml(std::string_view yaml_string);
+        static bool load_yaml(std::string_view yaml_string, bool compiled = false);  // compiled is Tokenizer::compile() output
+        static bool load_parser(Configuration::Parser& parser);
 
         ~MachineConfig();
     };
@@ -5,6 +5,11 @@
 #include "src/Serial.h"                 // Cmd
 #include "src/System.h"                 // sys
 #include "src/Machine/MachineConfig.h"  // config
+#include "src/WebUI/InputBuffer.h"      // WebUI::inputBuffer
+#include "src/FileCache.h"
+#include "src/FluidPath.h"
+
+#include <map>
 
 Macro::Macro(const char* name) : _name(name) {}
 
@@ -50,48 +55,134 @@ Cmd findOverride(std::string name) {
     return it == overrideCodes.end() ? Cmd::None : it->second;
 }
 
-bool Macro::run() {
-    if (sys.state != State::Idle) {
-        log_error("Macro can only be used in idle state");
+MacroProgram Macro::compile(const std::string& text, char separator, std::string& error) {
+    auto        steps = std::make_shared<std::vector<MacroStep>>();
+    std::string line;
+    auto        endLine = [&]() {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            steps->push_back({ Cmd::None, line });
+            line.clear();
+        }
+    };
+    for (size_t i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c == separator || c == '\n') {
+            // & is a proxy for newlines in macros, because you cannot
+            // enter a newline directly in a config file string value.
+            endLine();
+            continue;
+        }
+        if (c == '#') {
+            if ((i + 3) > text.length()) {
+                error = "Missing characters after # realtime escape";
+                return nullptr;
+            }
+            Cmd cmd = findOverride(text.substr(i + 1, 2));
+            if (cmd == Cmd::None) {
+                error = "Bad #" + text.substr(i + 1, 2) + " realtime escape";
+                return nullptr;
+            }
+            // In its place among the lines, after the line before it is taken
+            endLine();
+            steps->push_back({ cmd, "" });
+            i += 2;
+            continue;
+        }
+        line += c;
+        if (line.length() >= Channel::maxLine) {
+            error = "Line too long: " + line.substr(0, 20) + "...";
+            return nullptr;
+        }
+    }
+    endLine();
+    return steps;
+}
+
+bool Macro::compile() {
+    _compiledFrom = _gcode;
+    _program      = nullptr;
+    if (_gcode.empty()) {
+        return true;
+    }
+    std::string error;
+    _program = compile(_gcode, '&', error);
+    if (!_program) {
+        log_error("Macro " << _name << ": " << error);
         return false;
     }
+    return true;
+}
 
-    const std::string& s = _gcode;
+bool Macro::queue(const char* name, const MacroProgram& program) {
+    if (sys.state != State::Idle && !WebUI::inputBuffer.running()) {
+        log_error("Macro can only be used in idle state, or from another macro");
+        return false;
+    }
+    log_info("Running macro " << name);
+    WebUI::inputBuffer.queue(program);
+    return true;
+}
+
+bool Macro::run() {
     if (_gcode == "") {
         return false;
     }
+    // The value can be set after the configuration is loaded
+    if (_gcode != _compiledFrom) {
+        compile();
+    }
+    if (!_program) {
+        log_error("Macro " << _name << " is not valid");
+        return false;
+    }
+    return queue(_name, _program);
+}
 
-    log_info("Running macro " << _name << ": " << _gcode);
-    char c;
-    for (int i = 0; i < _gcode.length(); i++) {
-        c = _gcode[i];
-        switch (c) {
-            case '&':
-                // & is a proxy for newlines in macros, because you cannot
-                // enter a newline directly in a config file string value.
-                WebUI::inputBuffer.push('\n');
-                break;
-            case '#':
-                if ((i + 3) > _gcode.length()) {
-                    log_error("Missing characters after # realtime escape in macro");
-                    return false;
-                }
-                {
-                    std::string s1(_gcode.c_str() + i + 1, 2);
-                    Cmd         cmd = findOverride(s1);
-                    if (cmd == Cmd::None) {
-                        log_error("Bad #xx realtime escape in macro");
-                        return false;
-                    }
-                    WebUI::inputBuffer.push(static_cast<uint8_t>(cmd));
-                }
-                i += 3;
-                break;
-            default:
-                WebUI::inputBuffer.push(c);
-                break;
+bool Macro::runFile(const std::string& name) {
+    struct Compiled {
+        FileCache::data_t source;  // Whose contents program was compiled from
+        MacroProgram      program;
+    };
+    // Commands run in one task, so this needs no lock
+    static std::map<std::string, Compiled> compiled;
+
+    std::error_code ec;
+    FluidPath       fpath { name, localfsName, ec };
+    if (ec) {
+        log_error("Macro file " << name << " cannot be opened");
+        return false;
+    }
+    bool              hit;
+    FileCache::data_t source = FileCache::get(fpath, hit);
+    if (!source) {
+        log_error("Macro file " << name << " is missing, empty or too big");
+        compiled.erase(name);
+        return false;
+    }
+    Compiled& entry = compiled[name];
+    if (entry.source != source) {
+        std::string error;
+        entry.source  = source;
+        entry.program = compile(*source, '\n', error);
+        if (!entry.program) {
+            log_error("Macro file " << name << ": " << error);
         }
     }
-    WebUI::inputBuffer.push('\n');
-    return true;
+    MacroProgram program = entry.program;
+    return program && queue(name.c_str(), program);
+}
+
+void Macros::afterParse() {
+    for (auto& macro : _startup_line) {
+        macro.compile();
+    }
+    for (auto& macro : _macro) {
+        macro.compile();
+    }
+    _after_homing.compile();
+    _after_reset.compile();
+    _after_unlock.compile();
 }
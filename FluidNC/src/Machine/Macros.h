@@ -5,10 +5,13 @@
 #pragma once
 
 #include "src/Configuration/Configurable.h"
-#include "src/WebUI/InputBuffer.h"  // WebUI::inputBuffer
 #include "src/UartChannel.h"
 #include "src/Event.h"
+#include "src/RealtimeCmd.h"  // Cmd
 #include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
 
 class MacroEvent : public Event {
     int _num;
@@ -24,12 +27,39 @@ extern MacroEvent macro2Event;
 extern MacroEvent macro3Event;
 
 namespace Machine {
+    // A macro as it runs: its lines, split and checked once, with each #xx realtime escape
+    // as a step of its own, so that running it queues the steps without looking at the text
+    struct MacroStep {
+        Cmd         cmd;   // Cmd::None for a line
+        std::string line;  // Without the newline
+    };
+    using MacroProgram = std::shared_ptr<const std::vector<MacroStep>>;
+
     class Macro {
+        MacroProgram _program;
+        std::string  _compiledFrom;  // The _gcode that _program was compiled from
+
     public:
         std::string _gcode;
         const char* _name;
         Macro(const char* name);
+
+        // Compiles _gcode, where & separates the lines, logging what is wrong with it
+        bool compile();
         bool run();
+
+        // Splits text into lines at separator or at newlines, checking the #xx escapes and
+        // the line lengths.  Returns nullptr, with the reason in error, if text is not valid.
+        static MacroProgram compile(const std::string& text, char separator, std::string& error);
+
+        // Queues a program, or says why it cannot run now.  Macros run in Idle, and in any
+        // other state from a line of a macro, so that one macro can start others that run
+        // back to back after it without the sender.
+        static bool queue(const char* name, const MacroProgram& program);
+
+        // Runs the named file from the top of the local file system, as a macro with one
+        // line per line of the file.  Its program is kept while the file is unchanged.
+        static bool runFile(const std::string& name);
     };
 
     class Macros : public Configuration::Configurable {
@@ -47,7 +77,7 @@ namespace Machine {
 
         // Configuration helpers:
 
-        // TODO: We could validate the startup lines
+        void afterParse() override;
 
         void group(Configuration::HandlerBase& handler) override {
             handler.item(_startup_line[0]._name, _startup_line[0]._gcode);
@@ -8,6 +8,8 @@
 #include "../Motors/MotorDriver.h"
 #include "../Motors/NullMotor.h"
 #include "Axes.h"
+#include "Encoder.h"
+#include "MachineConfig.h"  // config
 
 namespace Machine {
     void Motor::group(Configuration::HandlerBase& handler) {
@@ -15,7 +17,9 @@ namespace Machine {
         handler.item("limit_pos_pin", _posPin);
         handler.item("limit_all_pin", _allPin);
         handler.item("hard_limits", _hardLimits);
+        handler.item("limit_debounce_ms", _limitDebounceMs, 0, 100);
         handler.item("pulloff_mm", _pulloff, 0.1, 100000.0);
+        handler.section("encoder", _encoder);
         MotorDrivers::MotorFactory::factory(handler, _driver);
     }
 
@@ -35,10 +39,18 @@ namespace Machine {
         _posLimitPin = new LimitPin(_posPin, _axis, _motorNum, 1, _hardLimits, _limited);
         _allLimitPin = new LimitPin(_allPin, _axis, _motorNum, 0, _hardLimits, _limited);
 
+        _negLimitPin->_debounceMs = _limitDebounceMs;
+        _posLimitPin->_debounceMs = _limitDebounceMs;
+        _allLimitPin->_debounceMs = _limitDebounceMs;
+
         _negLimitPin->init();
         _posLimitPin->init();
         _allLimitPin->init();
 
+        if (_encoder) {
+            _encoder->init(_axis, _motorNum);
+        }
+
         unblock();
     }
 
@@ -67,18 +79,24 @@ namespace Machine {
 
     bool Motor::isReal() { return _driver->isReal(); }
 
+    // For drivers that sense a stall in place of a switch.  The stall acts as
+    // the limit switch at the end that the axis homes to.
+    void Motor::stallLimit(bool active) {
+        auto homing = config->_axes->_axis[_axis]->_homing;
+        auto pin    = (homing && homing->_positiveDirection) ? _posLimitPin : _negLimitPin;
+        pin->trigger(active);
+    }
+
     void IRAM_ATTR Motor::step(bool reverse) {
-        // Skip steps based on limit pins
-        // _blocked is for asymmetric pulloff
-        // _limited is for limit pins
-        if (_blocked || _limited) {
-            return;
+        if (count_step(reverse)) {
+            _driver->step();
         }
-        _driver->step();
-        _steps += reverse ? -1 : 1;
     }
 
     void IRAM_ATTR Motor::unstep() { _driver->unstep(); }
 
-    Motor::~Motor() { delete _driver; }
+    Motor::~Motor() {
+        delete _driver;
+        delete _encoder;
+    }
 }
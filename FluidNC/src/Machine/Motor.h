@@ -7,12 +7,15 @@
 #include "../Configuration/Configurable.h"
 #include "LimitPin.h"
 
+#include <esp_attr.h>  // IRAM_ATTR
+
 namespace MotorDrivers {
     class MotorDriver;
 }
 
 namespace Machine {
     class Endstops;
+    class Encoder;
 }
 
 namespace Machine {
@@ -28,12 +31,14 @@ namespace Machine {
         Motor(int axis, int motorNum) : _axis(axis), _motorNum(motorNum) {}
 
         MotorDrivers::MotorDriver* _driver  = nullptr;
-        float                      _pulloff = 1.0f;  // mm
+        Encoder*                   _encoder = nullptr;  // Optional position feedback
+        float                      _pulloff = 1.0f;     // mm
 
-        Pin  _negPin;
-        Pin  _posPin;
-        Pin  _allPin;
-        bool _hardLimits = false;
+        Pin      _negPin;
+        Pin      _posPin;
+        Pin      _allPin;
+        bool     _hardLimits      = false;
+        uint32_t _limitDebounceMs = 5;  // Bounces ignored after a limit switch changes
 
         int32_t _steps   = 0;
         bool    _limited = false;  // _limited is set by the LimitPin ISR
@@ -49,10 +54,23 @@ namespace Machine {
         void init();
         void config_motor();
         void step(bool reverse);
+
+        // Accounts for a step and returns true if the motor should be pulsed
+        inline bool IRAM_ATTR count_step(bool reverse) {
+            // Skip steps based on limit pins
+            // _blocked is for asymmetric pulloff
+            // _limited is for limit pins
+            if (_blocked || _limited) {
+                return false;
+            }
+            _steps += reverse ? -1 : 1;
+            return true;
+        }
         void unstep();
         void block() { _blocked = true; }
         void unblock() { _blocked = false; }
         void unlimit() { _limited = false; }
+        void stallLimit(bool active);
         ~Motor();
     };
 }
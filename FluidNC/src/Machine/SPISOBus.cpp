@@ -0,0 +1,29 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "SPISOBus.h"
+#include "../I2SOut.h"
+
+namespace Machine {
+    void SPISOBus::validate() {
+        if (_bck.defined() || _data.defined() || _ws.defined()) {
+            Assert(_bck.defined(), "SPISO SCK pin should be configured once");
+            Assert(_data.defined(), "SPISO MOSI pin should be configured once");
+            Assert(_ws.defined(), "SPISO Latch pin should be configured once");
+        }
+    }
+
+    void SPISOBus::group(Configuration::HandlerBase& handler) {
+        handler.item("sck_pin", _bck);
+        handler.item("mosi_pin", _data);
+        handler.item("latch_pin", _ws);
+        dmaItems(handler);
+    }
+
+    void SPISOBus::init() {
+        log_info("SPISO SCK:" << _bck.name() << " MOSI:" << _data.name() << " Latch:" << _ws.name() << " DMA:" << _dmaBufferCount << "x"
+                               << _dmaBufferBytes);
+        if (i2s_out_init()) {
+            log_error("SPISO init failed");
+        }
+    }
+}
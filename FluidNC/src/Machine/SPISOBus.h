@@ -0,0 +1,28 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include "I2SOBus.h"
+
+namespace Machine {
+    // The I2SO pins on 74HC595 chains that are wired to SPI pins.  The
+    // I2S_STREAM and I2S_STATIC stepping engines and the I2SO pins work the
+    // same as with the i2so section, but the bitstream goes out on VSPI, so
+    // the spi section keeps HSPI for the SD card and SPI drivers.  The sck_pin
+    // and mosi_pin items are as in the spi section, and latch_pin goes to the
+    // RCLK inputs, which the bus drives from its second data line.
+    //
+    // The pins are kept in the I2S roles: latch as WS, SCK as BCK and MOSI as
+    // DATA.  Each sample takes 8 bytes of DMA buffer, twice as many as on I2S.
+    class SPISOBus : public I2SOBus {
+    public:
+        SPISOBus() = default;
+
+        void validate() override;
+        void group(Configuration::HandlerBase& handler) override;
+
+        void init();
+
+        ~SPISOBus() = default;
+    };
+}
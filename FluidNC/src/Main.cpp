@@ -18,26 +18,71 @@
 #    include "MotionControl.h"
 #    include "Platform.h"
 #    include "StartupLog.h"
+#    include "StepCheck.h"
+#    include "JobStats.h"
+#    include "ToolTable.h"
+#    include "CrashContext.h"
 
 #    include "WebUI/TelnetServer.h"
 #    include "WebUI/InputBuffer.h"
 
 #    include "WebUI/WifiConfig.h"
 #    include "Driver/localfs.h"
+#    include "Driver/soft_wdt.h"
+
+#    include <esp_timer.h>
 
 extern void make_user_commands();
 
+// Connecting to an access point takes seconds, so Bluetooth or WiFi is brought up by a
+// task of its own while setup() goes on with the machine.  It starts once the config is
+// parsed, so that web requests never see the machine without one.
+static TaskHandle_t setupTask  = nullptr;
+static bool         netStarted = false;
+static uint32_t     netStartMs = 0;
+
+static void net_begin() {
+    int64_t start = esp_timer_get_time();
+    // Try Bluetooth first so its memory can be released if it is disabled
+    if (!WebUI::bt_config.begin() && WebUI::wifi_config.begin()) {
+        CrashContext::upload();
+    }
+    netStartMs = uint32_t((esp_timer_get_time() - start) / 1000);
+}
+
+static void netStart(void*) {
+    net_begin();
+    xTaskNotifyGive(setupTask);
+    vTaskDelete(nullptr);
+}
+
+static void start_network() {
+    setupTask  = xTaskGetCurrentTaskHandle();
+    netStarted = true;
+    if (xTaskCreatePinnedToCore(netStart, "netstart", 8192, nullptr, NET_START_TASK_PRIORITY, nullptr, NET_START_TASK_CORE) != pdPASS) {
+        net_begin();
+        xTaskNotifyGive(setupTask);
+    }
+}
+
 void setup() {
     disableCore0WDT();
-
-    //Improve startup stability
-    delay_ms(2000);
+    StartupLog::stage("boot");
+
+    // Give the supply time to settle after a power-on or a brown-out.  Other resets,
+    // such as the restart when machine power is detected, go straight on.
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT) {
+        delay_ms(2000);
+        StartupLog::stage("settle");
+    }
 
     try {
         timing_init();
         uartInit();  // Setup serial port
 
         StartupLog::init();
+        CrashContext::init();
 
         // Setup input polling loop after loading the configuration,
         // because the polling may depend on the config
@@ -51,6 +96,10 @@ void setup() {
 
         // Load settings from non-volatile storage
         settings_init();  // requires config
+        JobStats::init();  // requires the settings NVS handle
+        soft_wdt_set_threshold(stall_ms->get());
+        soft_wdt_init();
+        StartupLog::stage("settings");
 
         log_info("FluidNC " << git_info << " " << git_url);
         log_info("Compiled with ESP32 SDK:" << esp_get_idf_version());
@@ -59,11 +108,14 @@ void setup() {
             log_error("Cannot mount a local filesystem");
         } else {
             log_info("Local filesystem type is " << localfsName);
+            ToolTable::init();
         }
 
         bool configOkay = config->load();
+        StartupLog::stage("config");
 
         make_user_commands();
+        start_network();
 
         if (configOkay) {
             log_info("Machine " << config->_name);
@@ -80,10 +132,16 @@ void setup() {
                     config->_uart_channels[i]->init();
                 }
             }
+            if (config->_usbCdcChannel) {
+                config->_usbCdcChannel->init();
+            }
 
             if (config->_i2so) {
                 config->_i2so->init();
             }
+            if (config->_spiso) {
+                config->_spiso->init();
+            }
             if (config->_spi) {
                 config->_spi->init();
 
@@ -105,6 +163,10 @@ void setup() {
                 config->_stat_out->init();
             }
 
+            if (config->_latencyProbe) {
+                config->_latencyProbe->init();
+            }
+
             config->_stepping->init();  // Configure stepper interrupt timers
 
             plan_init();
@@ -113,11 +175,21 @@ void setup() {
 
             config->_axes->init();
 
+            StepCheck::init();
+
             config->_control->init();
 
             config->_kinematics->init();
 
             limits_init();
+
+            if (config->_syncLink) {
+                config->_syncLink->init();
+            }
+
+            if (config->_mpg) {
+                config->_mpg->init();
+            }
         }
 
         // Initialize system state.
@@ -130,8 +202,8 @@ void setup() {
             config->_coolant->init();
             config->_probe->init();
         }
+        StartupLog::stage("machine");
 
-        esp_reset_reason_t reason = esp_reset_reason();
         if (reason == ESP_RST_POWERON) {
             //log_debug("PowerOn reset : Launch reboot to get good limit status after poweron");
             //ESP.restart();
@@ -143,10 +215,13 @@ void setup() {
         sys.state = State::ConfigAlarm;
     }
 
-    // Try Bluetooth first so its memory can be released if it is disabled
-    if (!WebUI::bt_config.begin()) {
-        WebUI::wifi_config.begin();
+    if (!netStarted) {
+        start_network();
     }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    StartupLog::stage("netwait");
+    StartupLog::stage("network", netStartMs);
+    StartupLog::showStages();
 
     allChannels.ready();
     allChannels.deregistration(&startupLog);
@@ -0,0 +1,283 @@
+// Copyright (c) 2020 -	Bart Dring
+// Copyright (c) 2020 -	Stefan de Bruijn
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Modbus.h"
+
+#include "Machine/MachineConfig.h"
+#include "Report.h"  // hex_msg
+
+#include <algorithm>
+
+uint32_t ModbusBus::commsErrors = 0;
+
+static ModbusBus* buses[MAX_N_UARTS] = { nullptr };
+
+static void reportCmdErrors(ModbusCommand& cmd, uint8_t* rx_message, size_t read_length, uint8_t id) {
+#ifdef DEBUG_MODBUS
+    hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
+    hex_msg(rx_message, "RS485 Rx: ", read_length);
+
+    if (read_length != 0) {
+        if (rx_message[0] != id) {
+            log_info("RS485 received message from other modbus device");
+        } else if (read_length != cmd.rx_length) {
+            log_info("RS485 received message of unexpected length; expected:" << int(cmd.rx_length) << " got:" << int(read_length));
+        } else {
+            log_info("RS485 CRC check failed");
+        }
+    } else {
+        log_info("RS485 No response");
+    }
+#endif
+}
+
+ModbusBus::ModbusBus(Uart* uart) : _uart(uart) {
+    // The driver hands bytes over after the line has been idle for idleSymbols, so
+    // once a response has started, waiting a little longer than that with nothing
+    // more arriving means that the frame is complete.  A character is 10 or 11 bits.
+    int gapMs = (idleSymbols * 11 * 1000 + _uart->_baud - 1) / _uart->_baud;
+    _gapTicks = gapMs / portTICK_PERIOD_MS + 2;
+}
+
+ModbusBus* ModbusBus::get(Uart* uart) {
+    ModbusBus** slot = nullptr;
+    for (auto& bus : buses) {
+        if (bus && bus->_uart == uart) {
+            return bus;
+        }
+        if (!bus && !slot) {
+            slot = &bus;
+        }
+    }
+    if (!slot) {
+        log_error("Modbus: Too many buses");
+        return nullptr;
+    }
+
+    if (uart->setHalfDuplex()) {
+        log_info("Modbus: RS485 UART set half duplex failed");
+        return nullptr;
+    }
+    // The RS485 half duplex mode drives RTS from the transmitter, so the direction
+    // needs no software timing.  With the rx timeout set, the driver also reports
+    // the end of each response, so the task sleeps until the whole frame is in.
+    bool frameEvents = false;
+    if (uart->setRxIdleTimeout(idleSymbols)) {
+        log_info("Modbus: RS485 UART set rx timeout failed");
+    } else if (uart->enableFrameEvents()) {
+        log_info("Modbus: RS485 UART frame events failed");
+    } else {
+        frameEvents = true;
+    }
+
+    auto bus          = new ModbusBus(uart);
+    bus->_frameEvents = frameEvents;
+    xTaskCreatePinnedToCore(task,                // task
+                            "modbusTaskHandle",  // name for task
+                            2048,                // size of task stack
+                            bus,                 // parameters
+                            1,                   // priority
+                            &bus->_taskHandle,
+                            SUPPORT_TASK_CORE  // core
+    );
+    *slot = bus;
+    return bus;
+}
+
+void ModbusBus::add(ModbusClient* client) {
+    int n = _nClients.load();
+    if (n == maxClients) {
+        log_error("Modbus: Too many devices on one bus");
+        return;
+    }
+    // Fill the slot before publishing it to the task
+    _clients[n] = client;
+    _due[n]     = xTaskGetTickCount();
+    _nClients.store(n + 1);
+}
+
+void ModbusBus::wake() {
+    xTaskNotifyGive(_taskHandle);
+}
+
+void IRAM_ATTR ModbusBus::wakeFromISR() {
+    vTaskNotifyGiveFromISR(_taskHandle, nullptr);
+}
+
+// The communications task
+void ModbusBus::task(void* pvParameters) {
+    auto bus = static_cast<ModbusBus*>(pvParameters);
+    while (true) {
+        // Sleep until the next client is due, or until a client queues a command
+        int wait_ms = bus->poll();
+        ulTaskNotifyTake(pdTRUE, wait_ms / portTICK_PERIOD_MS);
+    }
+}
+
+// Runs at most one transaction.  Returns how long the task can sleep.
+int ModbusBus::poll() {
+    std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);  // read fence for settings
+
+    ModbusCommand cmd;
+    ModbusClient* client = nullptr;
+    int           n      = _nClients.load();
+
+    // Queued commands from any client go first, critical ones before the rest
+    for (int pass = 0; !client && pass < 2; ++pass) {
+        for (int i = 0; i < n; ++i) {
+            cmd.critical = false;
+            if (_clients[i]->queued_command(cmd, pass == 0)) {
+                client = _clients[i];
+                break;
+            }
+        }
+    }
+
+    // Then the clients that are due take turns at routine work
+    TickType_t now  = xTaskGetTickCount();
+    int        wait = ModbusClient::defaultPollMs;
+    for (int i = 0; !client && i < n; ++i) {
+        _next     = (_next + 1) % n;
+        auto left = int32_t(_due[_next] - now);
+        if (left > 0) {
+            wait = std::min(wait, int(left * portTICK_PERIOD_MS));
+            continue;
+        }
+        int period   = _clients[_next]->poll_ms();
+        _due[_next]  = now + period / portTICK_PERIOD_MS;
+        wait         = std::min(wait, period);
+        cmd.critical = false;
+        if (_clients[_next]->next_command(cmd)) {
+            client = _clients[_next];
+        }
+    }
+
+    if (!client) {
+        return std::max(wait, int(minPeriodMs));
+    }
+
+    uint8_t response[ModbusCommand::maxMessage];
+    bool    ok = transact(*client, cmd, response);
+    client->handle_response(cmd, ok ? response : nullptr, ok);
+
+    // Give the devices time to turn the line around before the next frame
+    return minPeriodMs;
+}
+
+bool ModbusBus::transact(ModbusClient& client, ModbusCommand& cmd, uint8_t* rx_message) {
+    const TickType_t response_ticks = responseMs / portTICK_PERIOD_MS;
+
+    auto& uart = *_uart;
+
+    // Fill in the fields that are the same for all clients
+    cmd.msg[0] = client._modbus_id;
+
+    // Add the CRC16 checksum:
+    auto crc16               = crc(cmd.msg, cmd.tx_length);
+    cmd.msg[cmd.tx_length++] = (crc16 & 0xFF);
+    cmd.msg[cmd.tx_length++] = (crc16 & 0xFF00) >> 8;
+    cmd.rx_length += 2;
+
+#ifdef DEBUG_MODBUS
+    hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
+#endif
+
+    // Assume for the worst, and retry...
+    for (int retry_count = 0; retry_count < maxRetries; ++retry_count) {
+        // Flush the UART and write the data:
+        uart.flushRx();
+        uart.write(cmd.msg, cmd.tx_length);
+        uart.flushTxTimed(response_ticks);
+
+        // Wait for the start of the response, then read until the line goes idle.
+        // Asking for the whole frame at once would wait out the response timeout
+        // whenever the device sends something shorter, like an exception reply.
+        size_t read_length;
+        if (_frameEvents) {
+            read_length = uart.readFrame(rx_message, cmd.rx_length, response_ticks);
+        } else if ((read_length = uart.timedReadBytes(rx_message, 1, response_ticks)) > 0) {
+            size_t current_read;
+            do {
+                current_read = uart.timedReadBytes(rx_message + read_length, cmd.rx_length - read_length, _gapTicks);
+                read_length += current_read;
+            } while (read_length < cmd.rx_length && current_read > 0);
+        }
+
+        // Apparently some Huanyang report modbus errors in the correct way, and the rest not. Sigh.
+        // Let's just check for the condition, and truncate the first byte.
+        if (read_length > 0 && client._modbus_id != 0 && rx_message[0] == 0) {
+            memmove(rx_message + 1, rx_message, read_length - 1);
+        }
+
+        // Generate crc16 for the response:
+        auto crc16response = crc(rx_message, cmd.rx_length - 2);
+
+        if (read_length == cmd.rx_length &&                                  // check expected length
+            rx_message[0] == client._modbus_id &&                            // check address
+            rx_message[read_length - 1] == (crc16response & 0xFF00) >> 8 &&  // check CRC byte 1
+            rx_message[read_length - 2] == (crc16response & 0xFF)) {         // check CRC byte 1
+            return true;
+        }
+
+        ++commsErrors;
+        reportCmdErrors(cmd, rx_message, read_length, client._modbus_id);
+
+        // Let the device settle and any stray bytes drain before we retry
+        delay_ms(retryDelayMs);
+
+#ifdef DEBUG_TASK_STACK
+        static UBaseType_t uxHighWaterMark = 0;
+        reportTaskStackSize(uxHighWaterMark);
+#endif
+    }
+    return false;
+}
+
+// CRC-16/MODBUS (reflected polynomial 0xA001, initial value 0xFFFF), one byte at a time
+// from a table of the CRCs of all byte values instead of one bit at a time.
+// Source: https://ctlsys.com/support/how_to_compute_the_modbus_rtu_message_crc/
+static const uint16_t crcTable[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+// Calculates the CRC of the first msg_len bytes of buf.  The message goes out with
+// the CRC appended low byte first.
+uint16_t ModbusBus::crc(const uint8_t* buf, int msg_len) {
+    uint16_t crc = 0xFFFF;
+    for (int pos = 0; pos < msg_len; pos++) {
+        crc = (crc >> 8) ^ crcTable[(crc ^ buf[pos]) & 0xFF];
+    }
+    return crc;
+}
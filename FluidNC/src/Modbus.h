@@ -0,0 +1,107 @@
+// Copyright (c) 2020 -	Bart Dring
+// Copyright (c) 2020 -	Stefan de Bruijn
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+    Modbus RTU bus shared by several devices on one RS485 UART.
+
+    Each UART that carries Modbus traffic gets one ModbusBus with one task.  Devices
+    such as VFD spindles register with it as ModbusClients.  The task asks the
+    clients for work in turn, sends one transaction at a time with the address and
+    CRC added, retries it, and hands the response back to the client that asked.
+
+    Commands that a client was asked to send go ahead of routine polling, critical
+    ones first.  Clients wake the task when they queue such a command, so it goes
+    out at once rather than at the next poll.  Each client sets its own poll
+    period, so a spindle that is ramping can be watched closely and one at steady
+    speed left alone.  The end of a response is found from the line going idle,
+    as RTU framing defines it, so a short or exception reply does not hold the
+    bus until the response timeout.
+*/
+
+#include "Uart.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <cstdint>
+
+// #define DEBUG_MODBUS
+
+struct ModbusCommand {
+    static const int maxMessage = 16;  // more than enough for a modbus message
+
+    bool critical;  // An unanswered critical command raises an alarm
+
+    uint8_t tx_length;
+    uint8_t rx_length;
+    uint8_t msg[maxMessage];
+};
+
+class ModbusClient {
+public:
+    static const int defaultPollMs = 250;
+
+    uint8_t _modbus_id = 1;
+
+    // The bus asks every client for a queued command, first only for critical ones,
+    // before it asks any of them for routine work.  Each fills in cmd from msg[1] on
+    // - the bus adds the address and the CRC - and returns true if there is
+    // something to send.
+    virtual bool queued_command(ModbusCommand& cmd, bool criticalOnly) { return false; }
+    virtual bool next_command(ModbusCommand& cmd) = 0;
+
+    // How long the bus waits between routine commands to this client
+    virtual int poll_ms() { return defaultPollMs; }
+
+    // Called with the checked response, or with ok false and no response when
+    // the device did not answer properly after all retries.
+    virtual void handle_response(const ModbusCommand& cmd, const uint8_t* response, bool ok) = 0;
+
+    virtual ~ModbusClient() = default;
+};
+
+class ModbusBus {
+    static const int maxClients   = 8;
+    static const int maxRetries   = 5;     // otherwise the client is told that the device is unresponsive
+    static const int retryDelayMs = 50;    // before retrying a failed transaction
+    static const int responseMs   = 1000;  // how long to wait for the start of a response
+    static const int minPeriodMs  = 10;    // between transactions on the bus
+    static const int idleSymbols  = 4;     // RTU frames end after 3.5 idle character times
+
+    Uart*            _uart;
+    ModbusClient*    _clients[maxClients];
+    TickType_t       _due[maxClients];  // When each client is next polled
+    std::atomic<int> _nClients { 0 };
+    int              _next = 0;  // Round-robin position for routine commands
+
+    TickType_t _gapTicks;             // Line idle time that ends a response
+    bool       _frameEvents = false;  // The UART reports the end of each response
+
+    TaskHandle_t _taskHandle = nullptr;
+
+    ModbusBus(Uart* uart);
+
+    static void task(void* pvParameters);
+
+    int  poll();
+    bool transact(ModbusClient& client, ModbusCommand& cmd, uint8_t* response);
+
+public:
+    // Exchanges that failed or gave an unusable response, for /metrics
+    static uint32_t commsErrors;
+
+    // Returns the bus on the given UART, setting it up on first use.  Returns
+    // nullptr if the UART cannot be used for RS485.
+    static ModbusBus* get(Uart* uart);
+
+    void add(ModbusClient* client);
+
+    // Clients call these after queueing a command, so it goes out at once
+    void wake();
+    void wakeFromISR();
+
+    static uint16_t crc(const uint8_t* buf, int msg_len);
+};
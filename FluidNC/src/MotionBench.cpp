@@ -0,0 +1,493 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "MotionBench.h"
+
+#include "Machine/MachineConfig.h"  // config
+#include "Machine/Encoder.h"        // Encoder::enabled
+#include "Spindles/NullSpindle.h"
+#include "Driver/delay_usecs.h"  // getCpuTicks(), ticks_per_us
+#include "Benchmark.h"
+#include "InputFile.h"
+#include "StepCheck.h"
+#include "Stepper.h"
+#include "Stepping.h"
+#include "Planner.h"
+#include "Protocol.h"
+#include "GCode.h"
+#include "System.h"
+#include "MotionControl.h"  // mc_move_motors()
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>  // esp_timer_get_time()
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace MotionBench {
+    volatile bool     active   = false;
+    volatile uint32_t segments = 0;
+
+    // The virtual step timer.  The step task calls the ISR while stepping is set, adding the
+    // period that each call asks for to the clock.
+    static const int64_t  sliceUsecs    = 10000;  // Stepping between yields to the rest of the core
+    static const uint32_t ticksPerCheck = 64;     // ISR calls between checks of the slice time
+
+    static TaskHandle_t      stepTask        = nullptr;
+    static volatile bool     stepping        = false;
+    static volatile uint32_t period          = 0;  // Virtual timer ticks until the next ISR call
+    static uint64_t          clock           = 0;  // Virtual timer ticks since the bench started
+    static uint32_t          cpuPerTimerTick = 1;
+
+    // Feed holds and overrides for the bench to apply at given motion times.  The step task
+    // sends the event and holds the virtual clock until the main loop has acted on it, so
+    // they land at the same point of the motion on every run.
+    enum ActionType { Hold, Feed, Rapid };
+    struct Action {
+        uint64_t   at;  // Virtual timer ticks
+        ActionType type;
+        int        percent;
+    };
+    static const int     maxActions = 8;
+    static Action        actions[maxActions];
+    static int           nActions   = 0;
+    static int           nextAction = 0;
+    static volatile bool holding    = false;  // A feed hold of the bench is to be resumed
+
+    // Planner occupancy, weighted by the motion time
+    static uint64_t blockTicks;  // Sum of the blocks queued times the ticks they were queued for
+    static uint32_t minBlocks;
+    static uint32_t maxBlocks;
+
+    // Stage times in CPU ticks.  The task running the bench charges each moment to the
+    // innermost stage, and other tasks charge the whole of their Timing scopes.
+    static TaskHandle_t owner = nullptr;
+    static Stage        current;
+    static int32_t      since;
+    static uint64_t     ownerTicks[nStages];
+    static uint64_t     taskTicks[nStages];
+
+    void IRAM_ATTR setTimerPeriod(uint16_t timerTicks) { period = timerTicks; }
+
+    void startTimer() {
+        stepping = true;
+        xTaskNotifyGive(stepTask);
+    }
+
+    void IRAM_ATTR stopTimer() { stepping = false; }
+
+    int32_t IRAM_ATTR cpuTicks() { return int32_t(uint32_t(clock) * cpuPerTimerTick); }
+
+    template <typename Done>
+    static void await(Done done) {
+        while (!done() && !sys.abort) {
+            vTaskDelay(1);
+        }
+    }
+
+    static void act(const Action& action) {
+        switch (action.type) {
+            case Hold: {
+                State before = sys.state;
+                holding      = before == State::Cycle;
+                protocol_send_event(&feedHoldEvent);
+                await([before] { return sys.state != before; });
+            } break;
+            case Feed:
+                if (sys.f_override != action.percent) {
+                    protocol_send_event(&feedOverrideEvent, FeedOverride::Default);
+                    protocol_send_event(&feedOverrideEvent, action.percent - FeedOverride::Default);
+                    await([&action] { return sys.f_override == action.percent; });
+                }
+                break;
+            case Rapid:
+                if (sys.r_override != action.percent) {
+                    protocol_send_event(&rapidOverrideEvent, action.percent);
+                    await([&action] { return sys.r_override == action.percent; });
+                }
+                break;
+        }
+    }
+
+    static void tick() {
+        while (nextAction < nActions && clock >= actions[nextAction].at) {
+            act(actions[nextAction++]);
+        }
+
+        uint32_t ticks = period;
+        clock += ticks;
+
+        uint32_t blocks = plan_get_block_buffer_count();
+        blockTicks += uint64_t(blocks) * ticks;
+        minBlocks = std::min(minBlocks, blocks);
+        maxBlocks = std::max(maxBlocks, blocks);
+
+        if (!Stepper::pulse_func()) {
+            stepping = false;
+        }
+    }
+
+    // The position trace is not allowed to drop samples, so while its ring is full the
+    // virtual clock waits for the polling task to send them
+    static void step_loop(void* unused) {
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, holding ? 1 : portMAX_DELAY);
+            if (holding && sys.state == State::Hold && sys.suspend.bit.holdComplete) {
+                holding = false;
+                protocol_send_event(&cycleStartEvent);
+            }
+            while (stepping) {
+                int64_t sliceEnd = esp_timer_get_time() + sliceUsecs;
+                do {
+                    for (uint32_t i = 0; i < ticksPerCheck && stepping && !Stepper::trace_full(); i++) {
+                        tick();
+                    }
+                } while (stepping && !Stepper::trace_full() && esp_timer_get_time() < sliceEnd);
+                vTaskDelay(1);
+            }
+        }
+    }
+
+    // Parses the options after the file name: hold=<ms>, feed=<ms>:<percent> and
+    // rapid=<ms>:<percent>, separated by commas, with the motion time in ms
+    static Error parse_actions(const char* options, Channel& out) {
+        nActions = 0;
+        if (!options) {
+            return Error::Ok;
+        }
+        const char* p = options;
+        while (*p) {
+            if (nActions == maxActions) {
+                log_error_to(out, "The motion bench takes at most " << maxActions << " holds and overrides");
+                return Error::InvalidValue;
+            }
+            Action& action = actions[nActions];
+            if (!strncasecmp(p, "hold=", 5)) {
+                action.type = Hold;
+                p += 5;
+            } else if (!strncasecmp(p, "feed=", 5)) {
+                action.type = Feed;
+                p += 5;
+            } else if (!strncasecmp(p, "rapid=", 6)) {
+                action.type = Rapid;
+                p += 6;
+            } else {
+                log_error_to(out, "Unknown motion bench option " << p);
+                return Error::InvalidValue;
+            }
+            char*    end;
+            uint32_t ms = strtoul(p, &end, 10);
+            if (end == p) {
+                return Error::BadNumberFormat;
+            }
+            p              = end;
+            action.percent = 0;
+            if (action.type != Hold) {
+                if (*p++ != ':') {
+                    return Error::InvalidValue;
+                }
+                action.percent = strtol(p, &end, 10);
+                if (end == p) {
+                    return Error::BadNumberFormat;
+                }
+                p = end;
+                if (action.type == Feed ? (action.percent < FeedOverride::Min || action.percent > FeedOverride::Max)
+                                        : (action.percent != RapidOverride::Default && action.percent != RapidOverride::Medium &&
+                                           action.percent != RapidOverride::Low)) {
+                    return Error::NumberRange;
+                }
+            }
+            if (*p == ',') {
+                ++p;
+            } else if (*p) {
+                return Error::InvalidValue;
+            }
+            action.at = uint64_t(ms) * (Machine::Stepping::fStepperTimer / 1000);
+            ++nActions;
+        }
+        std::stable_sort(actions, actions + nActions, [](const Action& a, const Action& b) { return a.at < b.at; });
+        return Error::Ok;
+    }
+
+    void Timing::enter(Stage stage) {
+        int32_t now = getCpuTicks();
+        _stage      = stage;
+        _nested     = xTaskGetCurrentTaskHandle() == owner;
+        if (_nested) {
+            ownerTicks[current] += uint32_t(now - since);
+            since   = now;
+            _outer  = current;
+            current = stage;
+        } else {
+            _start = now;
+        }
+    }
+
+    void Timing::leave() {
+        int32_t now = getCpuTicks();
+        if (_nested) {
+            ownerTicks[current] += uint32_t(now - since);
+            since   = now;
+            current = _outer;
+        } else {
+            taskTicks[_stage] += uint32_t(now - _start);
+        }
+    }
+
+    void dwell(uint32_t milliseconds) { clock += uint64_t(milliseconds) * (Machine::Stepping::fStepperTimer / 1000); }
+
+    uint32_t motion_ms() { return uint32_t(clock / (Machine::Stepping::fStepperTimer / 1000)); }
+
+    static uint64_t stage_ticks(int stage) { return ownerTicks[stage] + taskTicks[stage]; }
+
+    static uint32_t stage_ms(int stage) { return uint32_t(stage_ticks(stage) / ticks_per_us / 1000); }
+
+    static void report(InputFile& file, Channel& out, uint32_t lines, int64_t wall_us) {
+        uint32_t motion = motion_ms();
+        uint32_t wall   = uint32_t(wall_us / 1000);
+        log_info_to(out,
+                    "Bench " << file.path() << ": " << lines << " GCode lines, motion " << motion << " ms in " << wall << " ms, "
+                             << (wall ? float(motion) / wall : 0.0f) << "x real time");
+
+        auto     stats   = Stepper::isr_stats;
+        uint32_t step_ms = uint32_t(stats.total_ticks / ticks_per_us / 1000);
+        log_info_to(out,
+                    "CPU ms: read " << stage_ms(Read) << " gcode " << stage_ms(GCode) << " planner " << stage_ms(Planner) << " prep "
+                                    << stage_ms(Prep) << " wait " << stage_ms(Wait) << " step " << step_ms);
+
+        if (clock == 0) {
+            return;
+        }
+        log_info_to(out,
+                    "Planner blocks while moving: avg " << float(blockTicks) / clock << " min " << minBlocks << " max " << maxBlocks
+                                                        << " of " << config->_planner_blocks << ", segment underruns " << stats.underruns);
+
+        // The planner is counted in with the parser, since planning is part of executing a line
+        uint64_t line_ticks = stage_ticks(GCode) + stage_ticks(Planner);
+        if (line_ticks) {
+            Benchmark::result(out, "gc_execute_line", float(lines) * ticks_per_us * 1000000 / line_ticks, "lines/s");
+        }
+        if (segments) {
+            Benchmark::result(out, "prep_buffer", float(stage_ticks(Prep)) / ticks_per_us / segments, "us/segment");
+        }
+        if (stats.count) {
+            Benchmark::result(out, "pulse_func", float(stats.total_ticks) / stats.count, "cycles");
+        }
+    }
+
+    // What a run changes, to be put back afterwards, since nothing moved
+    static int32_t            savedSteps[MAX_N_AXIS][Machine::Axis::MAX_MOTORS_PER_AXIS];
+    static parser_state_t     savedGcState;
+    static Percent            savedF;
+    static Percent            savedR;
+    static Spindles::Spindle* savedSpindle;
+    static Spindles::Null     benchSpindle;
+
+    // Starts the virtual step timer and the stage timing
+    static Error begin(Channel& out) {
+        if (StepCheck::enabled || Machine::Encoder::enabled) {
+            log_error_to(out, "The motion bench cannot run with step_check or encoders");
+            return Error::InvalidStatement;
+        }
+        if (!stepTask && xTaskCreatePinnedToCore(step_loop,                   // task
+                                                 "motion_bench",              // name for task
+                                                 4096,                        // size of task stack
+                                                 nullptr,                     // parameters
+                                                 MOTION_BENCH_TASK_PRIORITY,  // priority
+                                                 &stepTask,                   // task handle
+                                                 MOTION_BENCH_TASK_CORE       // core
+                                                 ) != pdPASS) {
+            log_error_to(out, "Cannot start the motion bench task");
+            return Error::InvalidStatement;
+        }
+
+        auto axes   = config->_axes;
+        auto n_axis = axes->_numberAxis;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            for (size_t motor = 0; motor < Machine::Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m                  = axes->_axis[axis]->_motors[motor];
+                savedSteps[axis][motor] = m ? m->_steps : 0;
+            }
+        }
+        savedGcState = gc_state;
+        savedF       = sys.f_override;
+        savedR       = sys.r_override;
+        savedSpindle = spindle;
+        spindle      = &benchSpindle;
+
+        Stepper::reset_isr_stats();
+        std::fill_n(ownerTicks, nStages, 0);
+        std::fill_n(taskTicks, nStages, 0);
+        clock           = 0;
+        period          = 0;
+        segments        = 0;
+        nextAction      = 0;
+        holding         = false;
+        blockTicks      = 0;
+        minBlocks       = UINT32_MAX;
+        maxBlocks       = 0;
+        cpuPerTimerTick = ticks_per_us / (Machine::Stepping::fStepperTimer / 1000000);
+        owner           = xTaskGetCurrentTaskHandle();
+        current         = Wait;
+        since           = getCpuTicks();
+        active          = true;
+        Stepper::restart_trace();
+        return Error::Ok;
+    }
+
+    static void end() {
+        active = false;
+        Stepper::restart_trace();
+
+        auto axes   = config->_axes;
+        auto n_axis = axes->_numberAxis;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            for (size_t motor = 0; motor < Machine::Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m = axes->_axis[axis]->_motors[motor];
+                if (m) {
+                    m->_steps = savedSteps[axis][motor];
+                }
+            }
+        }
+        plan_sync_position();
+        gc_state       = savedGcState;
+        spindle        = savedSpindle;
+        sys.f_override = savedF;
+        sys.r_override = savedR;
+        nActions       = 0;
+    }
+
+    Error run(InputFile& file, Channel& out, const char* options, bool estimate) {
+        if (sys.state != State::Idle) {
+            return Error::IdleError;
+        }
+        Error err = parse_actions(options, out);
+        if (err != Error::Ok) {
+            return err;
+        }
+        auto engine = Machine::Stepping::_engine;
+        if (engine == Machine::Stepping::I2S_STREAM || engine == Machine::Stepping::RMT_BURST) {
+            log_error_to(out, "The motion bench does not support the " << stepTypes[engine].name << " engine");
+            return Error::InvalidStatement;
+        }
+        err = begin(out);
+        if (err != Error::Ok) {
+            return err;
+        }
+
+        if (!estimate) {
+            log_info_to(out, "Bench " << file.path());
+        }
+        int64_t  wall_start = esp_timer_get_time();
+        char     line[Channel::maxLine];
+        uint32_t lines   = 0;
+        bool     jogging = false;
+        while (true) {
+            {
+                Timing timing(Read);
+                err = file.readLine(line, Channel::maxLine - 1);
+            }
+            if (err != Error::Ok) {
+                break;
+            }
+            char* p = line;
+            while (isspace(*p)) {
+                ++p;
+            }
+            // Jogs are run, but no other settings or commands.  A jog cannot start while
+            // GCode motion runs, nor the other way round, so each waits for the other.
+            bool jog = !strncmp(p, "$J=", 3);
+            if (!jog && (*p == '$' || *p == '[')) {
+                continue;
+            }
+            if (jog != jogging) {
+                protocol_buffer_synchronize();
+                jogging = jog;
+            }
+            ++lines;
+            {
+                Timing timing(GCode);
+                err = gc_execute_line(p);
+            }
+            if (spindle != &benchSpindle) {
+                // A tool change selected a real spindle, which it is switched back from
+                spindle->stop();
+                savedSpindle = spindle;
+                spindle      = &benchSpindle;
+            }
+            if (sys.abort) {
+                break;
+            }
+            if (err != Error::Ok && err != Error::GcodeUnsupportedCommand) {
+                log_error_to(out,
+                             static_cast<int>(err) << " (" << errorString(err) << ") in " << file.path() << " at line "
+                                                   << file.getLineNumber());
+                break;
+            }
+        }
+        if (!sys.abort) {
+            protocol_buffer_synchronize();
+        }
+        int64_t wall_us = esp_timer_get_time() - wall_start;
+        end();
+
+        if (sys.abort) {
+            return Error::Reset;
+        }
+        if (!estimate) {
+            report(file, out, lines, wall_us);
+        }
+        return err == Error::Eof ? Error::Ok : err;
+    }
+
+    Error synthetic(Channel& out, uint32_t ms) {
+        if (sys.state != State::Idle) {
+            return Error::IdleError;
+        }
+        // Nothing is stepped, so the engines differ only in the paths of pulse_func() that
+        // the I2S stream and RMT bursts take in place of one call per tick, which drive
+        // their hardware.  The run takes the path of the Timed engine.
+        auto engine                = Machine::Stepping::_engine;
+        Machine::Stepping::_engine = Machine::Stepping::TIMED;
+        nActions                   = 0;
+        Error err                  = begin(out);
+        if (err != Error::Ok) {
+            Machine::Stepping::_engine = engine;
+            return err;
+        }
+
+        // Out and back along a line whose axes all run at their max rates, in blocks short
+        // enough for the planner to keep the segment buffer full
+        auto  axes   = config->_axes;
+        auto  n_axis = axes->_numberAxis;
+        float start[MAX_N_AXIS];
+        float rate[MAX_N_AXIS];
+        float feed = 0;
+        motor_steps_to_mpos(start, get_motor_steps());
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            rate[axis] = axes->_axis[axis]->_maxRate;
+            feed += rate[axis] * rate[axis];
+        }
+        plan_line_data_t pl_data = {};
+        pl_data.feed_rate        = sqrtf(feed);
+        pl_data.is_jog           = true;  // Skip the unhomed-axes check; nothing will move
+
+        const uint32_t blockMs = 20;
+        uint32_t       nBlocks = std::max(ms / blockMs / 2, uint32_t(1));
+        float          target[MAX_N_AXIS];
+        for (uint32_t i = 1; i <= 2 * nBlocks && !sys.abort; i++) {
+            uint32_t along = i <= nBlocks ? i : 2 * nBlocks - i;
+            for (size_t axis = 0; axis < n_axis; axis++) {
+                target[axis] = start[axis] + rate[axis] / 60000.0f * blockMs * along;
+            }
+            mc_move_motors(target, &pl_data);
+        }
+        if (!sys.abort) {
+            protocol_buffer_synchronize();
+        }
+        end();
+        Machine::Stepping::_engine = engine;
+        return sys.abort ? Error::Reset : Error::Ok;
+    }
+}
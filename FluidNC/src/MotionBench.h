@@ -0,0 +1,116 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  MotionBench.h - runs a GCode file through the motion pipeline against a virtual step timer
+
+  $SD/Bench=<file> and $LocalFS/Bench=<file> execute the file through the same path as a
+  job, gc_execute_line(), the planner and the segment generator, but the step ISR is run
+  by a task on the other core, as fast as that can, instead of by the step timer.  A
+  virtual clock adds up the timer periods that the ISR asks for, so it keeps the time
+  that the motion would take on the machine, dwells included, and the axes drive no pins
+  and only count the steps.  Nothing moves, and the machine position, the parser state and the spindle
+  are put back afterwards.
+
+  The report gives the motion time against the wall time that the pipeline needed for
+  it, the CPU time of each stage, the planner occupancy over the motion time and the
+  segment buffer underruns, and sends the per-call figures of the pipeline as Benchmark
+  results; see Benchmark.h.  The step ISR never waits for the timer, so the wall time
+  is what the pipeline can sustain, and the time that the main loop spends waiting for
+  planner space is the margin over that of the rest of the pipeline.  A position trace
+  started by $Stepping/Trace, or the events of $Trace/Motion, record the run as they
+  would a job; the position trace is timed by the virtual clock.
+
+  The virtual clock makes a run repeatable, so the position trace of a file is the same
+  on every run while the motion code behaves the same, and golden-trace.py compares it
+  with one recorded earlier.  To keep it so, the trace holds the clock instead of
+  dropping samples, and $SD/Bench=<file>,<options> takes the feed holds and overrides
+  to apply as a list of hold=<ms>, feed=<ms>:<percent> and rapid=<ms>:<percent>, at
+  motion times in ms.  The bench resumes a hold once it is complete.  $J= jog lines in
+  the file are run too, each run of them after the motion before it has finished.
+
+  The spindle is replaced by a Null spindle for the run, so lasers are planned as
+  spindles are.  Coolant and other outputs act as the file commands them.  The Timed,
+  RMT, I2S_static and Dedicated_GPIO engines are supported, without step_check or
+  encoders, which would see no pulses.
+*/
+
+#include "Error.h"
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+class Channel;
+class InputFile;
+
+namespace MotionBench {
+    // Stages whose CPU time is reported.  Read and GCode are timed by the bench loop, and
+    // the others where they run.
+    enum Stage : uint8_t {
+        Read = 0,  // Reading the file
+        GCode,     // gc_execute_line(), less the stages below it
+        Planner,   // plan_buffer_line()
+        Prep,      // Stepper::prep_buffer()
+        Wait,      // protocol_execute_realtime(), waiting for planner space or the end of motion
+        nStages,
+    };
+
+    // True while a bench runs; tested inline so it costs one load otherwise
+    extern volatile bool active;
+
+    // Segments published by prep_buffer() during the bench
+    extern volatile uint32_t segments;
+
+    // The virtual step timer, called by Stepping in place of the hardware one
+    void IRAM_ATTR setTimerPeriod(uint16_t timerTicks);
+    void           startTimer();
+    void IRAM_ATTR stopTimer();
+
+    // The virtual clock in CPU ticks, wrapping as getCpuTicks() does
+    int32_t IRAM_ATTR cpuTicks();
+
+    // Advances the virtual clock by a dwell, which is not waited for
+    void dwell(uint32_t milliseconds);
+
+    // The motion time of the last run, dwells included
+    uint32_t motion_ms();
+
+    // Charges the time that the current task spends in its scope to stage, and not to the
+    // stage that it interrupts.  Does nothing unless a bench is running.
+    class Timing {
+        Stage   _stage;
+        Stage   _outer;   // The stage that this one interrupted, in the bench task
+        int32_t _start;   // CPU ticks on entry, in other tasks
+        bool    _nested;  // In the bench task
+        bool    _on;
+
+        void enter(Stage stage);
+        void leave();
+
+    public:
+        explicit Timing(Stage stage) : _on(active) {
+            if (_on) {
+                enter(stage);
+            }
+        }
+        ~Timing() {
+            if (_on) {
+                leave();
+            }
+        }
+
+        Timing(const Timing&)            = delete;
+        Timing& operator=(const Timing&) = delete;
+    };
+
+    // Runs the file and reports to out.  options are the holds and overrides after the
+    // file name, or nullptr.  With estimate, only errors are reported, for a caller that
+    // only wants motion_ms().  The machine must be idle.
+    Error run(InputFile& file, Channel& out, const char* options, bool estimate = false);
+
+    // Runs about ms of motion out and back along a line on which every axis moves at its
+    // max rate, for $Stepping/Bench, leaving the figures of the step ISR in
+    // Stepper::isr_stats.  The machine must be idle.
+    Error synthetic(Channel& out, uint32_t ms);
+}
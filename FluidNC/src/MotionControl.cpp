@@ -14,8 +14,11 @@
 #include "I2SOut.h"          // i2s_out_reset
 #include "Platform.h"        // WEAK_LINK
 #include "Settings.h"        // coords
+#include "MotionBench.h"     // MotionBench::dwell()
+#include "Extents.h"         // Extents::scanning
 
 #include <cmath>
+#include <cstring>  // memset
 
 // M_PI is not defined in standard C/C++ but some compilers
 // support it anyway.  The following suppresses Intellisense
@@ -92,6 +95,77 @@ bool mc_move_motors(float* target, plan_line_data_t* pl_data) {
     return submitted_result;
 }
 
+// Like mc_move_motors(), but with the target in motor steps, for kinematics that can convert
+// cartesian positions straight to steps.
+bool mc_move_motor_steps(int32_t* target_steps, plan_line_data_t* pl_data) {
+    bool submitted_result = false;
+    mc_pl_data_inflight   = pl_data;
+
+    // If in check gcode mode, prevent motion by blocking planner.
+    if (sys.state == State::CheckMode) {
+        mc_pl_data_inflight = NULL;
+        return submitted_result;
+    }
+    while (plan_check_full_buffer()) {
+        protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+        protocol_execute_realtime();
+        if (sys.abort) {
+            mc_pl_data_inflight = NULL;
+            return submitted_result;  // Bail, if system abort.
+        }
+    }
+    if (mc_pl_data_inflight == pl_data) {
+        plan_buffer_line_steps(target_steps, pl_data);
+        submitted_result = true;
+    }
+    mc_pl_data_inflight = NULL;
+    return submitted_result;
+}
+
+// Like mc_move_motors(), but target and position are cartesian and the segment generator does
+// the conversion to motor space, so a straight line takes one planner slot on any kinematics.
+bool mc_move_cartesian(float* target, plan_line_data_t* pl_data, float* position) {
+    bool submitted_result = false;
+    mc_pl_data_inflight   = pl_data;
+
+    // If in check gcode mode, prevent motion by blocking planner.
+    if (sys.state == State::CheckMode) {
+        mc_pl_data_inflight = NULL;
+        return submitted_result;
+    }
+    while (plan_check_full_buffer()) {
+        protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+        protocol_execute_realtime();
+        if (sys.abort) {
+            mc_pl_data_inflight = NULL;
+            return submitted_result;  // Bail, if system abort.
+        }
+    }
+    if (mc_pl_data_inflight == pl_data) {
+        submitted_result = plan_buffer_kinematic_line(target, pl_data, position);
+    }
+    mc_pl_data_inflight = NULL;
+    return submitted_result;
+}
+
+// Queues an arc as a single native planner block.  Used instead of chords when motor space
+// is cartesian space, so one arc takes one planner slot.
+static bool mc_move_arc(
+    float* target, plan_line_data_t* pl_data, float* position, float* center, float radius, size_t axis_0, size_t axis_1, float angular_travel) {
+    // If in check gcode mode, prevent motion by blocking planner.
+    if (sys.state == State::CheckMode) {
+        return false;
+    }
+    while (plan_check_full_buffer()) {
+        protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+        protocol_execute_realtime();
+        if (sys.abort) {
+            return false;  // Bail, if system abort.
+        }
+    }
+    return plan_buffer_arc(target, pl_data, position, center, radius, axis_0, axis_1, angular_travel);
+}
+
 void mc_cancel_jog() {
     if (mc_pl_data_inflight != NULL && ((plan_line_data_t*)mc_pl_data_inflight)->is_jog) {
         mc_pl_data_inflight = NULL;
@@ -105,10 +179,21 @@ void mc_cancel_jog() {
 // mc_linear_no_check() is used by mc_arc() which pre-checks the arc limits using
 // a fast algorithm, so checking each segment is unnecessary.
 static bool mc_linear_no_check(float* target, plan_line_data_t* pl_data, float* position) {
+    auto heightMap = config->_heightMap;
+    if (heightMap->enabled() && !pl_data->motion.systemMotion && !pl_data->motion.noCompensation) {
+        return heightMap->follow(target, pl_data, position, [](float* target, plan_line_data_t* pl_data, float* position) {
+            return config->_kinematics->cartesian_to_motors(target, pl_data, position);
+        });
+    }
     return config->_kinematics->cartesian_to_motors(target, pl_data, position);
 }
 bool mc_linear(float* target, plan_line_data_t* pl_data, float* position) {
-    if (!pl_data->is_jog && !pl_data->limits_checked) {  // soft limits for jogs have already been dealt with
+    if (Extents::scanning) {
+        Extents::line(target);
+        return false;
+    }
+    // Soft limits for jogs have already been dealt with, and those of a job that Extents checked
+    if (!pl_data->is_jog && !pl_data->limits_checked && !Extents::trusted()) {
         if (config->_kinematics->invalid_line(target)) {
             return false;
         }
@@ -116,6 +201,36 @@ bool mc_linear(float* target, plan_line_data_t* pl_data, float* position) {
     return mc_linear_no_check(target, pl_data, position);
 }
 
+// Every pass of a thread must start at the same spindle angle, so the motion waits
+// for the previous moves to finish, is queued while the stepper is stopped, and is
+// started as soon as the spindle passes its index.  The wait is taken in short slices
+// with realtime commands serviced in between; an index that passes between slices is
+// not missed, only waited for again on the next revolution.
+bool mc_spindle_sync(float* target, plan_line_data_t* pl_data, float* position) {
+    const uint32_t indexTimeoutMs = 2000;  // Longer than one revolution at any useful speed
+    const uint32_t indexSliceMs   = 10;
+
+    protocol_buffer_synchronize();
+    if (sys.abort || !mc_linear(target, pl_data, position)) {
+        return false;
+    }
+    uint32_t waited = 0;
+    while (!spindle->waitIndex(indexSliceMs)) {
+        protocol_execute_realtime();
+        if (sys.abort) {
+            return false;
+        }
+        waited += indexSliceMs;
+        if (waited >= indexTimeoutMs) {
+            log_error("No spindle index pulse for G33");
+            mc_critical(ExecAlarm::SpindleControl);
+            return false;
+        }
+    }
+    protocol_auto_cycle_start();
+    return true;
+}
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_X defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used
@@ -123,6 +238,8 @@ bool mc_linear(float* target, plan_line_data_t* pl_data, float* position) {
 // The arc is approximated by generating a huge number of tiny, linear segments. The chordal tolerance
 // of each segment is configured in the arc_tolerance setting, which is defined to be the maximum normal
 // distance from segment to the circle when the end points both lie on the circle.
+// With native_arcs set and cartesian kinematics, the arc is instead queued as a single planner block
+// that the stepper segment generator traces directly.
 void mc_arc(float*            target,
             plan_line_data_t* pl_data,
             float*            position,
@@ -137,7 +254,8 @@ void mc_arc(float*            target,
 
     // The first two axes are the circle plane and the third is the orthogonal plane
     size_t caxes[3] = { axis_0, axis_1, axis_linear };
-    if (config->_kinematics->invalid_arc(target, pl_data, position, center, radius, caxes, is_clockwise_arc)) {
+    if (!Extents::scanning && !Extents::trusted() &&
+        config->_kinematics->invalid_arc(target, pl_data, position, center, radius, caxes, is_clockwise_arc)) {
         return;
     }
 
@@ -173,6 +291,17 @@ void mc_arc(float*            target,
         }
     }
 
+    if (Extents::scanning) {
+        Extents::arc(position, target, center, radius, axis_0, axis_1, angular_travel);
+        return;
+    }
+
+    // A native arc would not follow the height map
+    if (config->_nativeArcs && config->_kinematics->canPlanArcs() && !config->_heightMap->enabled()) {
+        mc_move_arc(target, pl_data, position, center, radius, axis_0, axis_1, angular_travel);
+        return;
+    }
+
     // NOTE: Segment end points are on the arc, which can lead to the arc diameter being smaller by up to
     // (2x) arc_tolerance. For 99% of users, this is just fine. If a different arc segment fit
     // is desired, i.e. least-squares, midpoint on arc, just change the mm_per_arc_segment calculation.
@@ -265,12 +394,27 @@ void mc_arc(float*            target,
     mc_linear(target, pl_data, previous_position);
 }
 
-// Execute dwell in seconds.
-bool mc_dwell(int32_t milliseconds) {
+// Execute dwell in milliseconds.
+bool mc_dwell(int32_t milliseconds, plan_line_data_t* pl_data) {
     if (milliseconds <= 0 || sys.state == State::CheckMode) {
         return false;
     }
+    if (pl_data && !MotionBench::active) {
+        config->_kinematics->flush_held();  // A held move comes before the dwell
+        while (plan_check_full_buffer()) {
+            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+            protocol_execute_realtime();
+            if (sys.abort) {
+                return false;
+            }
+        }
+        return plan_buffer_dwell(milliseconds, pl_data);
+    }
     protocol_buffer_synchronize();
+    if (MotionBench::active) {
+        MotionBench::dwell(milliseconds);
+        return !sys.abort;
+    }
     return delay_msec(milliseconds, DwellMode::Dwell);
 }
 
@@ -309,19 +453,23 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, bool away,
         return GCUpdatePos::None;  // Nothing else to do but bail.
     }
     // Setup and queue probing motion. Auto cycle-start should not start the cycle.
+    pl_data->motion.noCompensation = 1;
     mc_linear(target, pl_data, gc_state.position);
     // Activate the probing state monitor in the stepper module.
     probeState = ProbeState::Active;
+    config->_probe->arm();
     // Perform probing cycle. Wait here until probe is triggered or motion completes.
     protocol_send_event(&cycleStartEvent);
     do {
         protocol_execute_realtime();
         if (sys.abort) {
+            config->_probe->disarm();
             config->_stepping->endLowLatency();
             return GCUpdatePos::None;  // Check for system abort
         }
     } while (sys.state != State::Idle);
 
+    config->_probe->disarm();
     config->_stepping->endLowLatency();
 
     // Probing cycle complete!
@@ -329,6 +477,7 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, bool away,
     if (probeState == ProbeState::Active) {
         if (no_error) {
             copyAxes(probe_steps, get_motor_steps());
+            memset(probe_fraction, 0, sizeof(probe_fraction));
         } else {
             send_alarm(ExecAlarm::ProbeFailContact);
         }
@@ -350,7 +499,7 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, bool away,
             float coord_data[MAX_N_AXIS];
             float probe_contact[MAX_N_AXIS];
 
-            motor_steps_to_mpos(probe_contact, probe_steps);
+            probe_mpos(probe_contact);
             coords[gc_state.modal.coord_select]->get(coord_data);  // get a copy of the current coordinate offsets
             auto n_axis = config->_axes->_numberAxis;
             for (int axis = 0; axis < n_axis; axis++) {  // find the axis specified. There should only be one.
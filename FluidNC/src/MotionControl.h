@@ -22,9 +22,19 @@ const int PARKING_MOTION_LINE_NUMBER = 0;
 // Execute a linear motion in cartesian space.
 bool mc_linear(float* target, plan_line_data_t* pl_data, float* position);
 
+// Execute a spindle-synchronized linear motion (G33), starting at the spindle index
+bool mc_spindle_sync(float* target, plan_line_data_t* pl_data, float* position);
+
 // Execute a linear motion in motor space.
 bool mc_move_motors(float* target, plan_line_data_t* pl_data);  // returns true if line was submitted to planner
 
+// Execute a linear motion to a target in motor steps.
+bool mc_move_motor_steps(int32_t* target_steps, plan_line_data_t* pl_data);  // returns true if line was submitted to planner
+
+// Execute a linear motion in cartesian space as one planner block, which the segment
+// generator converts to motor space.  For kinematics that support stepper-time conversion.
+bool mc_move_cartesian(float* target, plan_line_data_t* pl_data, float* position);  // returns true if line was submitted to planner
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, is_clockwise_arc boolean. Used
@@ -40,8 +50,9 @@ void mc_arc(float*            target,
             bool              is_clockwise_arc,
             int               pword_rotations);
 
-// Dwell for a specific number of seconds
-bool mc_dwell(int32_t milliseconds);
+// Dwell for a specific number of milliseconds.  With pl_data, the dwell is queued in the
+// planner, after the moves before it, and the g-code goes on while it runs.
+bool mc_dwell(int32_t milliseconds, plan_line_data_t* pl_data = nullptr);
 
 // Perform tool length probe cycle. Requires probe switch.
 GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, bool away, bool no_error, uint8_t offsetAxis, float offset);
@@ -0,0 +1,62 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "MotionTrace.h"
+
+#include "Channel.h"
+#include "Logging.h"
+
+#include <esp_heap_caps.h>  // heap_caps_malloc()
+#include <esp_timer.h>      // esp_timer_get_time()
+#include <atomic>
+
+namespace MotionTrace {
+    volatile bool enabled = false;
+
+    static Record*               records = nullptr;
+    static std::atomic<uint32_t> next { 0 };  // Total records ever made; the slot is this modulo ringSize
+
+    bool start() {
+        if (!records) {
+            records = static_cast<Record*>(heap_caps_malloc(ringSize * sizeof(Record), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+            if (!records) {
+                return false;
+            }
+        }
+        next.store(0);
+        enabled = true;
+        return true;
+    }
+
+    void stop() { enabled = false; }
+
+    void IRAM_ATTR record(Event event, uint32_t arg) {
+        if (!enabled) {
+            return;
+        }
+        // Each producer claims its own slot, so the tasks and the ISR never share one
+        Record& r  = records[next.fetch_add(1, std::memory_order_relaxed) & (ringSize - 1)];
+        r.usecs    = uint32_t(esp_timer_get_time());
+        r.event    = event;
+        r.reserved = 0;
+        r.arg      = arg > 0xffff ? 0xffff : arg;
+    }
+
+    void dump(Channel& out) {
+        if (!records) {
+            log_info_to(out, "No motion trace has been recorded");
+            return;
+        }
+        bool wasEnabled = enabled;
+        enabled         = false;
+
+        uint32_t end   = next.load();
+        uint32_t begin = end > ringSize ? end - ringSize : 0;
+        log_info_to(out, "Motion trace: " << end - begin << " of " << end << " records");
+        for (uint32_t i = begin; i < end; i++) {
+            const Record& r = records[i & (ringSize - 1)];
+            log_stream(out, "[MTR:" << r.usecs << "," << int(r.event) << "," << int(r.arg));
+        }
+
+        enabled = wasEnabled;
+    }
+}
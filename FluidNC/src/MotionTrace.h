@@ -0,0 +1,56 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  MotionTrace.h - timestamped record of the motion pipeline for offline analysis
+
+  When a job stutters, the question is which stage fell behind: the GCode parser,
+  the planner, the segment generator or the step ISR.  With $Trace/Motion=On, each
+  stage records an event as work passes through it, together with the occupancy of
+  the buffer it feeds.  The events go into a fixed ring that keeps the most recent
+  ones, and $Trace/Dump lists them, to the channel or to a file, for a host tool such
+  as motion-trace.py to turn into buffer occupancy over time.
+
+  Recording is a check of enabled and, when on, one atomic increment and a store of
+  eight bytes, so it is cheap enough for the step ISR.  The ring is in internal RAM
+  rather than PSRAM, because the step ISR must be able to write it while the flash
+  cache is disabled.
+*/
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+class Channel;
+
+namespace MotionTrace {
+    enum Event : uint8_t {
+        LineStart   = 0,  // A GCode line is about to be executed; arg is the planner blocks queued
+        LineEnd     = 1,  // The line has been executed; arg is its Error code
+        PlanBlock   = 2,  // plan_buffer_line() queued a block; arg is the planner blocks queued
+        PrepSegment = 3,  // prep_buffer() published a segment; arg is the segments queued
+        LoadSegment = 4,  // The step ISR took up a segment; arg is the segments still queued
+        Underrun    = 5,  // The segment buffer ran dry in the middle of a block
+    };
+
+    struct Record {
+        uint32_t usecs;  // esp_timer time, wrapping every 71 minutes
+        uint8_t  event;
+        uint8_t  reserved;
+        uint16_t arg;
+    };
+
+    const uint32_t ringSize = 2048;  // Records kept; must be a power of two
+
+    // True while recording; tested inline so disabled tracing costs one load
+    extern volatile bool enabled;
+
+    bool start();  // Returns false if the ring cannot be allocated
+    void stop();
+
+    void IRAM_ATTR record(Event event, uint32_t arg = 0);
+
+    // Lists the records, oldest first, as [MTR:usecs,event,arg] lines.  Recording
+    // is paused meanwhile so the listing is consistent.
+    void dump(Channel& out);
+}
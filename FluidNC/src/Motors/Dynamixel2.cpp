@@ -27,7 +27,12 @@ namespace MotorDrivers {
     Uart*                    Dynamixel2::_uart  = nullptr;
     TimerHandle_t            Dynamixel2::_timer = nullptr;
     std::vector<Dynamixel2*> Dynamixel2::_instances;
-    bool                     Dynamixel2::_has_errors = false;
+    bool                     Dynamixel2::_has_errors   = false;
+    TaskHandle_t             Dynamixel2::_task         = nullptr;
+    TickType_t               Dynamixel2::_lastRead     = 0;
+    bool                     Dynamixel2::_positionSent = false;
+
+    static portMUX_TYPE telemetryMux = portMUX_INITIALIZER_UNLOCKED;
 
     int Dynamixel2::_timer_ms = 75;
 
@@ -53,7 +58,15 @@ namespace MotorDrivers {
                 return;
             }
             _uart_started = true;
-            schedule_update(this, _timer_ms);
+            xTaskCreatePinnedToCore(update_task,  // task
+                                    "dxlTask",    // name for task
+                                    2048,         // size of task stack
+                                    nullptr,      // parameters
+                                    1,            // priority
+                                    &_task,
+                                    SUPPORT_TASK_CORE  // core
+            );
+            log_info("    Update task for " << name() << " at " << _timer_ms << " ms");
         }
 
         config_message();  // print the config
@@ -127,37 +140,133 @@ namespace MotorDrivers {
         finish_write();
     }
 
+    // Runs the updates on a fixed schedule, apart from the timer task, since
+    // waiting for the sync read replies would hold up every other timer
+    void Dynamixel2::update_task(void* pvParameters) {
+        TickType_t last = xTaskGetTickCount();
+        while (true) {
+            vTaskDelayUntil(&last, _timer_ms);
+            update_all();
+        }
+    }
+
     // This is static; it updates the positions of all the Dynamixels on the UART bus
     void Dynamixel2::update_all() {
         if (_has_errors) {
             return;
         }
 
-        start_message(DXL_BROADCAST_ID, DXL_SYNC_WRITE);
-        add_uint16(DXL_GOAL_POSITION);
-        add_uint16(4);  // data length
+        // Nothing has moved if no motor has stepped since the last write
+        bool moved = !_positionSent;
+        for (const auto& instance : _instances) {
+            moved = moved || get_axis_motor_steps(instance->_axis_index) != instance->_sentSteps;
+        }
 
-        float* mpos = get_mpos();
-        float  motors[MAX_N_AXIS];
-        config->_kinematics->transform_cartesian_to_motors(motors, mpos);
+        if (moved) {
+            start_message(DXL_BROADCAST_ID, DXL_SYNC_WRITE);
+            add_uint16(DXL_GOAL_POSITION);
+            add_uint16(4);  // data length
 
-        for (const auto& instance : _instances) {
-            float    dxl_count_min, dxl_count_max;
-            uint32_t dxl_position;
+            for (const auto& instance : _instances) {
+                instance->_sentSteps = get_axis_motor_steps(instance->_axis_index);
+            }
+            float* mpos = get_mpos();
+            float  motors[MAX_N_AXIS];
+            config->_kinematics->transform_cartesian_to_motors(motors, mpos);
+
+            for (const auto& instance : _instances) {
+                float    dxl_count_min, dxl_count_max;
+                uint32_t dxl_position;
 
-            dxl_count_min = float(instance->_countMin);
-            dxl_count_max = float(instance->_countMax);
+                dxl_count_min = float(instance->_countMin);
+                dxl_count_max = float(instance->_countMax);
 
-            // map the mm range to the servo range
-            auto axis_index = instance->_axis_index;
-            dxl_position    = static_cast<uint32_t>(mapConstrain(
-                motors[axis_index], limitsMinPosition(axis_index), limitsMaxPosition(axis_index), dxl_count_min, dxl_count_max));
+                // map the mm range to the servo range
+                auto axis_index = instance->_axis_index;
+                dxl_position    = static_cast<uint32_t>(mapConstrain(
+                    motors[axis_index], limitsMinPosition(axis_index), limitsMaxPosition(axis_index), dxl_count_min, dxl_count_max));
 
-            add_uint8(instance->_id);  // ID of the servo
-            add_uint32(dxl_position);
+                add_uint8(instance->_id);  // ID of the servo
+                add_uint32(dxl_position);
+                instance->_goalCount = dxl_position;
+            }
+            finish_message();
+            _positionSent = true;
+        }
+
+        // The sync write is not answered, so the read goes out right behind it
+        TickType_t now = xTaskGetTickCount();
+        if (moved || now - _lastRead >= DXL_IDLE_READ_MS) {
+            sync_read_telemetry();
+            _lastRead = now;
+        }
+    }
+
+    void Dynamixel2::sync_read_telemetry() {
+        start_message(DXL_BROADCAST_ID, DXL_SYNC_READ);
+        add_uint16(DXL_PRESENT_LOAD);
+        add_uint16(DXL_TELEMETRY_LEN);
+        for (const auto& instance : _instances) {
+            add_uint8(instance->_id);
         }
         finish_message();
+
+        // The servos answer in the order of the IDs in the request.  After a
+        // missing or damaged reply, the ones behind it cannot be lined up.
+        for (const auto& instance : _instances) {
+            if (!instance->parse_telemetry()) {
+                break;
+            }
+        }
+    }
+
+    // Byte stuffing can make a reply longer than expected, which then fails
+    // the CRC check and is dropped until the next read.
+    bool Dynamixel2::parse_telemetry() {
+        const uint16_t len = DXL_STATUS_LEN + DXL_TELEMETRY_LEN;
+        if (dxl_get_response(len) != len || _rx_message[DXL_MSG_ID] != _id) {
+            return false;
+        }
+        uint16_t crc = _rx_message[len - 2] | (_rx_message[len - 1] << 8);
+        if (dxl_update_crc(0, _rx_message, len - 2) != crc) {
+            return false;
+        }
+
+        const uint8_t* data  = &_rx_message[DXL_MSG_START + 1];  // after the error byte
+        auto           reg   = [data](int address) { return data + address - DXL_PRESENT_LOAD; };
+        const uint8_t* load  = reg(DXL_PRESENT_LOAD);
+        const uint8_t* count = reg(DXL_PRESENT_POSITION);
+
+        int32_t present = count[0] | (count[1] << 8) | (count[2] << 16) | (count[3] << 24);
+
+        Telemetry now;
+        now.valid          = true;
+        now.load           = int16_t(load[0] | (load[1] << 8)) / 10.0f;
+        now.temperature    = *reg(DXL_PRESENT_TEMPERATURE);
+        float span         = limitsMaxPosition(_axis_index) - limitsMinPosition(_axis_index);
+        now.followingError = (present - int32_t(_goalCount)) * span / (float(_countMax) - float(_countMin));
+
+        portENTER_CRITICAL(&telemetryMux);
+        _telemetry = now;
+        portEXIT_CRITICAL(&telemetryMux);
+
+        // The goal was sent just before the read, so while moving, the error
+        // includes the distance covered in one update period
+        bool over = _maxFollowingError > 0 && fabsf(now.followingError) > _maxFollowingError;
+        if (over && !_followingWarned) {
+            log_warn(axisName() << " following error " << now.followingError << "mm load " << now.load << "% " << int(now.temperature) << "C");
+        }
+        _followingWarned = over;
+        return true;
+    }
+
+    Dynamixel2::Telemetry Dynamixel2::telemetry() {
+        portENTER_CRITICAL(&telemetryMux);
+        Telemetry copy = _telemetry;
+        portEXIT_CRITICAL(&telemetryMux);
+        return copy;
     }
+
     void Dynamixel2::update() {
         update_all();
     }
@@ -12,11 +12,28 @@
 
 #include "../Uart.h"
 
+#include <freertos/task.h>
 #include <cstdint>
 
 namespace MotorDrivers {
     class Dynamixel2 : public Servo {
+    public:
+        // What the last sync read returned
+        struct Telemetry {
+            bool    valid          = false;
+            float   followingError = 0;  // mm, present position minus goal
+            float   load           = 0;  // % of the maximum torque, signed by direction
+            uint8_t temperature    = 0;  // degrees C
+        };
+
+        // The cached state, which never touches the bus
+        Telemetry   telemetry();
+        std::string motorName() const { return axisName(); }
+
+        static const std::vector<Dynamixel2*>& instances() { return _instances; }
+
     protected:
+        Telemetry _telemetry;
         void config_message() override;
 
         void set_location();
@@ -49,6 +66,24 @@ namespace MotorDrivers {
 
         size_t dxl_get_response(uint16_t length);
 
+        // The positions are sent with a sync write, and the telemetry is read back
+        // with a sync read that follows it at once, from a task of their own at
+        // _timer_ms.  While the motors are not moving, the write is skipped and the
+        // telemetry is only read every DXL_IDLE_READ_MS.
+        static TaskHandle_t _task;
+        static TickType_t   _lastRead;
+        static bool         _positionSent;
+
+        static void update_task(void* pvParameters);
+        static void sync_read_telemetry();
+        bool        parse_telemetry();
+
+        uint32_t _goalCount = 0;
+        int32_t  _sentSteps = 0;  // motor steps of the position last sent
+
+        float _maxFollowingError = 0;  // mm, warn when the error gets larger, 0 for no check
+        bool  _followingWarned   = false;
+
         static uint16_t dxl_update_crc(uint16_t crc_accum, uint8_t* data_blk_ptr, uint8_t data_blk_size);
 
         static TimerHandle_t _timer;
@@ -84,14 +119,22 @@ namespace MotorDrivers {
         static const int  PING_RSP_LEN   = 14;
         static const char DXL_READ       = char(0x02);
         static const char DXL_WRITE      = char(0x03);
+        static const char DXL_SYNC_READ  = char(0x82);
         static const char DXL_SYNC_WRITE = char(0x83);
 
         // protocol 2 register locations
         static const int DXL_OPERATING_MODE   = 11;
         static const int DXL_ADDR_TORQUE_EN   = 64;
         static const int DXL_ADDR_LED_ON      = 65;
-        static const int DXL_GOAL_POSITION    = 116;  // 0x74
-        static const int DXL_PRESENT_POSITION = 132;  // 0x84
+        static const int DXL_GOAL_POSITION       = 116;  // 0x74
+        static const int DXL_PRESENT_LOAD        = 126;  // 0x7E
+        static const int DXL_PRESENT_POSITION    = 132;  // 0x84
+        static const int DXL_PRESENT_TEMPERATURE = 146;  // 0x92
+
+        // The sync read covers the registers from present load to present temperature
+        static const int DXL_TELEMETRY_LEN = DXL_PRESENT_TEMPERATURE + 1 - DXL_PRESENT_LOAD;
+        static const int DXL_STATUS_LEN    = 11;  // status packet without parameters
+        static const int DXL_IDLE_READ_MS  = 1000;
 
         // control modes
         static const int DXL_CONTROL_MODE_POSITION = 3;
@@ -128,6 +171,7 @@ namespace MotorDrivers {
             handler.item("count_min", _countMin);
             handler.item("count_max", _countMax);
             handler.item("timer_ms", _timer_ms);
+            handler.item("max_following_error_mm", _maxFollowingError, 0.0, 1000.0);
 
             Servo::group(handler);
         }
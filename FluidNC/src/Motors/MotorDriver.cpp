@@ -27,7 +27,8 @@
 
 namespace MotorDrivers {
     std::string MotorDriver::axisName() const {
-        return std::string(1, config->_axes->axisName(axis_index())) + (dual_axis_index() ? "2" : "") + " Axis";
+        auto motor = dual_axis_index();
+        return std::string(1, config->_axes->axisName(axis_index())) + (motor ? std::to_string(motor + 1) : "") + " Axis";
     }
 
     void MotorDriver::debug_message() {}
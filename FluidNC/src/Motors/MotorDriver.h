@@ -23,6 +23,7 @@
 */
 
 #include "../Configuration/Configurable.h"
+#include "../Pins/PinMask.h"
 
 #include <cstdint>
 
@@ -78,6 +79,24 @@ namespace MotorDrivers {
         // states of the step pins are unknown.
         virtual void unstep();
 
+        // step_dir_masks() adds the step and direction pins, in their
+        // active states, to masks that Axes writes directly from the
+        // stepping ISR in place of calling step(), unstep() and
+        // set_direction().  Drivers that need those calls, or whose
+        // pins cannot be written that way, return false.
+        virtual bool step_dir_masks(Pins::PinMask& stepOn, Pins::PinMask& dirOn) { return false; }
+
+        // rmt_channel() gives the RMT channel that generates the step
+        // pulses, and whether the step pin is active low, for the
+        // RMT_burst engine.  Drivers without one return false.
+        virtual bool rmt_channel(int& channel, bool& invert) { return false; }
+
+        // step_counter_pin() gives the GPIO number of the step pin, and
+        // whether its pulses start with a falling edge, for counting them
+        // in hardware and for the Dedicated_GPIO engine.  Drivers whose
+        // step pin is not a GPIO return false.
+        virtual bool step_counter_pin(int& gpio, bool& falling) { return false; }
+
         // this is used to configure and test motors. This would be used for Trinamic
         virtual void config_motor() {}
 
@@ -116,7 +135,7 @@ namespace MotorDrivers {
         // TODO Architecture: It might be useful to cache a
         // reference to the axis settings entry.
         size_t axis_index() const;       // X_AXIS, etc
-        size_t dual_axis_index() const;  // motor number 0 or 1
+        size_t dual_axis_index() const;  // motor number on the axis
     };
 
     using MotorFactory = Configuration::GenericFactory<MotorDriver>;
@@ -11,6 +11,17 @@ namespace MotorDrivers {
 
         bool isReal() override { return false; }
 
+        // There are no pins, so nothing stops the fast step path
+        bool step_dir_masks(Pins::PinMask& stepOn, Pins::PinMask& dirOn) override { return true; }
+        bool rmt_channel(int& channel, bool& invert) override {
+            channel = -1;
+            return true;
+        }
+        bool step_counter_pin(int& gpio, bool& falling) override {
+            gpio = -1;
+            return true;
+        }
+
         // Configuration handlers:
         void group(Configuration::HandlerBase& handler) override {}
 
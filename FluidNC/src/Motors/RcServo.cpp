@@ -20,14 +20,19 @@
 #include "../Machine/MachineConfig.h"
 #include "../System.h"  // mpos_to_steps() etc
 #include "../Pin.h"
-#include "../Limits.h"  // limitsMaxPosition
+#include "../Limits.h"   // limitsMaxPosition
+#include "../Stepper.h"  // segment_hook, segment_target
 #include "RcServoSettings.h"
 
 #include <freertos/task.h>  // vTaskDelay
+#include <algorithm>
 
 namespace MotorDrivers {
     // RcServo::RcServo(Pin pwm_pin) : Servo(), _pwm_pin(pwm_pin) {}
 
+    RcServo* RcServo::_followers[MAX_N_AXIS];
+    int      RcServo::_nFollowers = 0;
+
     void RcServo::init() {
         if (_output_pin.undefined()) {
             log_warn("    RC Servo disabled: No output pin");
@@ -47,7 +52,32 @@ namespace MotorDrivers {
 
         _disabled = true;
 
-        schedule_update(this, _timer_ms);
+        if (_nFollowers < MAX_N_AXIS) {
+            _followers[_nFollowers++] = this;
+            Stepper::segment_hook     = follow_segment;
+        }
+        if (_timer_ms > 0) {
+            schedule_update(this, _timer_ms);
+        }
+    }
+
+    // A servo lags the pulse that it is sent, so each one is sent to where the
+    // segment ends as the segment starts, rather than to where the axis is.
+    void IRAM_ATTR RcServo::follow_segment() {
+        for (int i = 0; i < _nFollowers; ++i) {
+            RcServo* servo = _followers[i];
+            if (!servo->_disabled && !servo->_has_errors) {
+                servo->_write_pwm(servo->duty_for(Stepper::segment_target(servo->_axis_index)));
+            }
+        }
+    }
+
+    uint32_t IRAM_ATTR RcServo::duty_for(int32_t steps) {
+        if (_max_steps == _min_steps) {
+            return _min_pulse_cnt;
+        }
+        steps = std::clamp(steps, std::min(_min_steps, _max_steps), std::max(_min_steps, _max_steps));
+        return _min_pulse_cnt + int64_t(steps - _min_steps) * (int64_t(_max_pulse_cnt) - _min_pulse_cnt) / (_max_steps - _min_steps);
     }
 
     void RcServo::config_message() {
@@ -55,7 +85,7 @@ namespace MotorDrivers {
                         << " period:" << _pwm->period() << ")");
     }
 
-    void RcServo::_write_pwm(uint32_t duty) {
+    void IRAM_ATTR RcServo::_write_pwm(uint32_t duty) {
         // to prevent excessive calls to pwmSetDuty, make sure duty has changed
         if (duty == _current_pwm_duty) {
             return;
@@ -74,6 +104,8 @@ namespace MotorDrivers {
         _disabled = disable;
         if (_disabled) {
             _write_pwm(0);
+        } else {
+            _write_pwm(duty_for(Stepper::segment_target(_axis_index)));
         }
     }
 
@@ -103,26 +135,16 @@ namespace MotorDrivers {
             return;
         }
 
-        uint32_t servo_pulse_len;
-        float    servo_pos;
-
         read_settings();
 
-        float mpos = steps_to_mpos(get_axis_motor_steps(_axis_index), _axis_index);  // get the axis machine position in mm
-        servo_pos  = mpos;                                                           // determine the current work position
-
-        // determine the pulse length
-        servo_pulse_len = static_cast<uint32_t>(mapConstrain(
-            servo_pos, limitsMinPosition(_axis_index), limitsMaxPosition(_axis_index), (float)_min_pulse_cnt, (float)_max_pulse_cnt));
-
-        // log_info("su " << servo_pulse_len);
-
-        _write_pwm(servo_pulse_len);
+        _write_pwm(duty_for(get_axis_motor_steps(_axis_index)));
     }
 
     void RcServo::read_settings() {
         _min_pulse_cnt = (_min_pulse_us * ((_pwm_freq * _pwm->period()) / 1000)) / 1000;  // play some math games to prevent overflowing 32 bit
         _max_pulse_cnt = (_max_pulse_us * ((_pwm_freq * _pwm->period()) / 1000)) / 1000;
+        _min_steps     = mpos_to_steps(limitsMinPosition(_axis_index), _axis_index);
+        _max_steps     = mpos_to_steps(limitsMaxPosition(_axis_index), _axis_index);
     }
 
     // Configuration registration
@@ -10,7 +10,13 @@
 namespace MotorDrivers {
     class RcServo : public Servo {
     protected:
-        int _timer_ms = 20;
+        int _timer_ms = 0;  // Update from a timer as well, for positions that change without motion
+
+        // The servos follow the motion from the step ISR, as each segment is loaded
+        static RcServo* _followers[MAX_N_AXIS];
+        static int      _nFollowers;
+
+        static void follow_segment();
 
         void config_message() override;
 
@@ -29,6 +35,12 @@ namespace MotorDrivers {
         uint32_t _min_pulse_cnt = 0;  // microseconds
         uint32_t _max_pulse_cnt = 0;  // microseconds
 
+        // The travel in motor steps, so that the duty can be found without float math
+        int32_t _min_steps = 0;
+        int32_t _max_steps = 0;
+
+        uint32_t duty_for(int32_t steps);
+
         int _axis_index = -1;
 
         bool _has_errors = false;
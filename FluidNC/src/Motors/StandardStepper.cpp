@@ -18,7 +18,10 @@ using namespace Machine;
 
 namespace MotorDrivers {
 
-    static void init_rmt_channel(rmt_channel_t& rmt_chan_num, Pin& step_pin, bool invert_step, uint32_t dir_delay_ms, uint32_t pulse_us) {
+    // For the RMT_burst engine, each channel has its own memory block for the
+    // burst items, and a 1 us tick so that long gaps between pulses fit
+    static void init_rmt_channel(
+        rmt_channel_t& rmt_chan_num, Pin& step_pin, bool invert_step, uint32_t dir_delay_ms, uint32_t pulse_us, bool burst) {
         static rmt_channel_t next_RMT_chan_num = RMT_CHANNEL_0;
         if (rmt_chan_num == RMT_CHANNEL_MAX) {
             if (next_RMT_chan_num == RMT_CHANNEL_MAX) {
@@ -34,8 +37,8 @@ namespace MotorDrivers {
         rmt_config_t rmtConfig = { .rmt_mode      = RMT_MODE_TX,
                                    .channel       = rmt_chan_num,
                                    .gpio_num      = gpio_num_t(step_pin_gpio),
-                                   .clk_div       = 20,
-                                   .mem_block_num = 2,
+                                   .clk_div       = uint8_t(burst ? 80 : 20),
+                                   .mem_block_num = uint8_t(burst ? 1 : 2),
                                    .flags         = 0,
                                    .tx_config     = {
                                        .carrier_freq_hz      = 0,
@@ -50,9 +53,11 @@ namespace MotorDrivers {
                                        .idle_output_en = true,
                                    } };
 
+        uint32_t ticks_per_us = burst ? 1 : 4;
+
         rmt_item32_t rmtItem[2];
-        rmtItem[0].duration0 = dir_delay_ms ? dir_delay_ms * 4 : 1;
-        rmtItem[0].duration1 = 4 * pulse_us;
+        rmtItem[0].duration0 = dir_delay_ms ? dir_delay_ms * ticks_per_us : 1;
+        rmtItem[0].duration1 = ticks_per_us * pulse_us;
         rmtItem[1].duration0 = 0;
         rmtItem[1].duration1 = 0;
 
@@ -78,8 +83,13 @@ namespace MotorDrivers {
         _dir_pin.setAttr(Pin::Attr::Output);
 
         auto stepping = config->_stepping;
-        if (stepping->_engine == Stepping::RMT) {
-            init_rmt_channel(_rmt_chan_num, _step_pin, _invert_step, stepping->_directionDelayUsecs, stepping->_pulseUsecs);
+        if (stepping->_engine == Stepping::RMT || stepping->_engine == Stepping::RMT_BURST) {
+            init_rmt_channel(_rmt_chan_num,
+                             _step_pin,
+                             _invert_step,
+                             stepping->_directionDelayUsecs,
+                             stepping->_pulseUsecs,
+                             stepping->_engine == Stepping::RMT_BURST);
         } else {
             _step_pin.setAttr(Pin::Attr::Output);
         }
@@ -111,13 +121,43 @@ namespace MotorDrivers {
     }
 
     void IRAM_ATTR StandardStepper::unstep() {
-        if (config->_stepping->_engine != Stepping::RMT) {
+        if (config->_stepping->_engine != Stepping::RMT && config->_stepping->_engine != Stepping::RMT_BURST) {
             _step_pin.off();
         }
     }
 
     void IRAM_ATTR StandardStepper::set_direction(bool dir) { _dir_pin.write(dir); }
 
+    bool StandardStepper::step_dir_masks(Pins::PinMask& stepOn, Pins::PinMask& dirOn) {
+        // RMT pulses are started by the RMT peripheral, not by writing the step pin
+        if (config->_stepping->_engine == Stepping::RMT || config->_stepping->_engine == Stepping::RMT_BURST) {
+            return false;
+        }
+        return stepOn.add(_step_pin, true) && dirOn.add(_dir_pin, true);
+    }
+
+    bool StandardStepper::rmt_channel(int& channel, bool& invert) {
+        if (_rmt_chan_num == RMT_CHANNEL_MAX) {
+            return false;
+        }
+        channel = _rmt_chan_num;
+        invert  = _invert_step;
+        return true;
+    }
+
+    bool StandardStepper::step_counter_pin(int& gpio, bool& falling) {
+        if (_step_pin.undefined()) {
+            gpio = -1;
+            return true;
+        }
+        if (_step_pin.name().rfind("gpio", 0) != 0) {
+            return false;
+        }
+        gpio    = _step_pin.getNative(Pin::Capabilities::Output);
+        falling = _step_pin.getAttr().has(Pin::Attr::ActiveLow);
+        return true;
+    }
+
     void IRAM_ATTR StandardStepper::set_disable(bool disable) { _disable_pin.synchronousWrite(disable); }
 
     // Configuration registration
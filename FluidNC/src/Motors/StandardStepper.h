@@ -20,6 +20,9 @@ namespace MotorDrivers {
         void set_direction(bool) override;
         void step() override;
         void unstep() override;
+        bool step_dir_masks(Pins::PinMask& stepOn, Pins::PinMask& dirOn) override;
+        bool rmt_channel(int& channel, bool& invert) override;
+        bool step_counter_pin(int& gpio, bool& falling) override;
         void read_settings() override;
 
         void init_step_dir_pins();
@@ -28,7 +28,8 @@ namespace MotorDrivers {
     private:
         TMC2130Stepper* tmc2130 = nullptr;
 
-        bool test();
+        bool            test();
+        TMC2130Stepper* spi_stepper() override { return tmc2130; }
         void set_registers(bool isHoming) override;
     };
 }
@@ -73,21 +73,16 @@ namespace MotorDrivers {
     }
 
     bool TMC2208Driver::test() {
-        _cs_pin.synchronousWrite(true);
-        if (!checkVersion(0x20, tmc2208->version())) {
-            _cs_pin.synchronousWrite(false);
+        uint8_t version;
+        bool    counted;
+        bus_test(version, counted);
+        if (!checkVersion(0x20, version)) {
             return false;
         }
-        uint8_t ifcnt_before = tmc2208->IFCNT();
-        tmc2208->GSTAT(0);  // clear GSTAT to increase ifcnt
-        uint8_t ifcnt_after = tmc2208->IFCNT();
-        bool    okay        = ((ifcnt_before + 1) & 0xff) == ifcnt_after;
-        if (!okay) {
+        if (!counted) {
             TrinamicBase::reportCommsFailure();
-            _cs_pin.synchronousWrite(false);
             return false;
         }
-        _cs_pin.synchronousWrite(false);
         return true;
     }
 
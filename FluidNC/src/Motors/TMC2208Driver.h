@@ -37,7 +37,8 @@ namespace MotorDrivers {
     private:
         TMC2208Stepper* tmc2208 = nullptr;
 
-        bool test();
-        void set_registers(bool isHoming);
+        bool            test();
+        TMC2208Stepper* uart_stepper() override { return tmc2208; }
+        void            set_registers(bool isHoming);
     };
 }
@@ -21,7 +21,8 @@ namespace MotorDrivers {
             _r_sense = TMC2209_RSENSE_DEFAULT;
         }
 
-        tmc2209 = new TMC2209Stepper(_uart, _r_sense, _addr);
+        tmc2209        = new TMC2209Stepper(_uart, _r_sense, _addr);
+        _hasStallGuard = true;
 
         registration();
     }
@@ -55,6 +56,7 @@ namespace MotorDrivers {
         tmc2209->microsteps(usteps);
         tmc2209->pdn_disable(true);  // powerdown pin is disabled. uses ihold.
 
+        _tcoolthrs = 0;
         switch (_mode) {
             case TrinamicMode ::StealthChop:
                 log_debug(axisName() << " StealthChop");
@@ -73,7 +75,8 @@ namespace MotorDrivers {
                 log_debug(axisName() << " Stallguard");
                 tmc2209->en_spreadCycle(false);
                 tmc2209->pwm_autoscale(true);
-                tmc2209->TCOOLTHRS(calc_tstep(homingFeedRate, 150.0));
+                _tcoolthrs = calc_tstep(homingFeedRate, 150.0);
+                tmc2209->TCOOLTHRS(_tcoolthrs);
                 tmc2209->SGTHRS(_stallguard);
                 break;
             }
@@ -91,6 +94,16 @@ namespace MotorDrivers {
         _cs_pin.synchronousWrite(false);
     }
 
+    // A higher SGTHRS stalls at a lighter load, so it is set to stall when the
+    // load reading falls to half the lowest that was seen running freely
+    bool TMC2209Driver::tune_stallguard(const SgStats& stats) {
+        _stallguard = stats.min / 4;
+        if (_stallguard == 0) {
+            log_warn(axisName() << " StallGuard reading is too low to detect stalls at the homing rates");
+        }
+        return true;
+    }
+
     void TMC2209Driver::debug_message() {
         if (_has_errors) {
             return;
@@ -124,22 +137,16 @@ namespace MotorDrivers {
     }
 
     bool TMC2209Driver::test() {
-        _cs_pin.synchronousWrite(true);
-        if (!checkVersion(0x21, tmc2209->version())) {
-            _cs_pin.synchronousWrite(false);
+        uint8_t version;
+        bool    counted;
+        bus_test(version, counted);
+        if (!checkVersion(0x21, version)) {
             return false;
         }
-
-        uint8_t ifcnt_before = tmc2209->IFCNT();
-        tmc2209->GSTAT(0);  // clear GSTAT to increase ifcnt
-        uint8_t ifcnt_after = tmc2209->IFCNT();
-        bool    okay        = ((ifcnt_before + 1) & 0xff) == ifcnt_after;
-        if (!okay) {
+        if (!counted) {
             TrinamicBase::reportCommsFailure();
-            _cs_pin.synchronousWrite(false);
             return false;
         }
-        _cs_pin.synchronousWrite(false);
         return true;
     }
 
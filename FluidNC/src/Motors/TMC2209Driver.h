@@ -29,6 +29,7 @@ namespace MotorDrivers {
             handler.item("homing_mode", _homing_mode, trinamicModes);
             handler.item("stallguard", _stallguard, 0, 255);
             handler.item("stallguard_debug", _stallguardDebugMode);
+            handler.item("stallguard_poll_ms", _stallguardPollMs, 0, 50);
             handler.item("toff_coolstep", _toff_coolstep, 2, 15);
         }
 
@@ -38,7 +39,10 @@ namespace MotorDrivers {
     private:
         TMC2209Stepper* tmc2209 = nullptr;
 
-        bool test();
-        void set_registers(bool isHoming);
+        bool            test();
+        TMC2208Stepper* uart_stepper() override { return tmc2209; }
+        void            tune_start() override { _stallguard = 0; }
+        bool            tune_stallguard(const SgStats& stats) override;
+        void            set_registers(bool isHoming);
     };
 }
@@ -35,7 +35,8 @@ namespace MotorDrivers {
 
         uint8_t _tpfd = 4;
 
-        bool test();
+        bool            test();
+        TMC2130Stepper* spi_stepper() override { return tmc5160; }
         void set_registers(bool isHoming);
         void trinamic_test_response();
         void trinamic_stepper_enable(bool enable);
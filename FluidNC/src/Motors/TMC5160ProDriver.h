@@ -64,7 +64,8 @@ namespace MotorDrivers {
         uint32_t PWMCONF    = 3289120798;
         uint32_t IHOLD_IRUN = 7948;
 
-        bool test();
+        bool            test();
+        TMC2130Stepper* spi_stepper() override { return tmc5160; }
         void set_registers(bool isHoming);
     };
 }
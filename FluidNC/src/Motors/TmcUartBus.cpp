@@ -0,0 +1,141 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "TmcUartBus.h"
+
+#include "../Machine/MachineConfig.h"  // MAX_N_UARTS
+
+namespace MotorDrivers {
+
+    namespace {
+        const uint8_t syncByte    = 0x05;
+        const uint8_t masterAddr  = 0xFF;  // Replies are addressed to the master
+        const uint8_t writeBit    = 0x80;
+        const int     requestLen  = 4;
+        const int     datagramLen = 8;  // Writes and replies
+
+        TmcUartBus* buses[MAX_N_UARTS] = { nullptr };
+    }
+
+    TmcUartBus* TmcUartBus::get(Uart* uart) {
+        TmcUartBus** slot = nullptr;
+        for (auto& bus : buses) {
+            if (bus && bus->_uart == uart) {
+                return bus;
+            }
+            if (!bus && !slot) {
+                slot = &bus;
+            }
+        }
+        if (!slot) {
+            return nullptr;
+        }
+        *slot = new TmcUartBus(uart);
+        return *slot;
+    }
+
+    // CRC8 with polynomial 0x07, over the bits of each byte from the LSB, as in the datasheets
+    uint8_t TmcUartBus::crc(const uint8_t* datagram, int len) {
+        uint8_t crc = 0;
+        for (int i = 0; i < len; ++i) {
+            uint8_t byte = datagram[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = ((crc >> 7) ^ (byte & 1)) ? (crc << 1) ^ 0x07 : crc << 1;
+                byte >>= 1;
+            }
+        }
+        return crc;
+    }
+
+    TmcUartBus::Op* TmcUartBus::next_op() {
+        if (_nOps == maxOps) {
+            flush();
+        }
+        return &_ops[_nOps++];
+    }
+
+    void TmcUartBus::write(uint8_t addr, uint8_t reg, uint32_t value) {
+        Op* op    = next_op();
+        op->addr  = addr;
+        op->reg   = reg;
+        op->write = true;
+        op->value = value;
+    }
+
+    void TmcUartBus::read(uint8_t addr, uint8_t reg, uint32_t* value, bool* ok) {
+        Op* op     = next_op();
+        op->addr   = addr;
+        op->reg    = reg;
+        op->write  = false;
+        op->result = value;
+        op->ok     = ok;
+    }
+
+    void TmcUartBus::flush() {
+        uint8_t tx[maxOps * datagramLen];
+        int     i = 0;
+        while (i < _nOps) {
+            // The writes up to the next read go out together
+            int len = 0;
+            for (; i < _nOps && _ops[i].write; ++i) {
+                uint8_t* d = tx + len;
+                d[0]       = syncByte;
+                d[1]       = _ops[i].addr;
+                d[2]       = _ops[i].reg | writeBit;
+                d[3]       = _ops[i].value >> 24;
+                d[4]       = _ops[i].value >> 16;
+                d[5]       = _ops[i].value >> 8;
+                d[6]       = _ops[i].value;
+                d[7]       = crc(d, datagramLen - 1);
+                len += datagramLen;
+            }
+            if (len) {
+                _uart->write(tx, len);
+            }
+            if (i < _nOps) {
+                Op& op = _ops[i++];
+                *op.ok = transact_read(op);
+                if (!*op.ok) {
+                    *op.result = 0;
+                }
+            }
+        }
+        _nOps = 0;
+        _uart->flushTxTimed(txTimeoutMs);
+    }
+
+    bool TmcUartBus::transact_read(Op& op) {
+        uint8_t request[requestLen] = { syncByte, op.addr, op.reg, 0 };
+        request[3]                  = crc(request, requestLen - 1);
+
+        // Whatever is still coming in, such as the echo of earlier writes, is
+        // passed over by the search below, so draining the receiver need not
+        // wait for it
+        _uart->flushTxTimed(txTimeoutMs);
+        _uart->flushRx();
+        _uart->write(request, requestLen);
+        _uart->flushTxTimed(txTimeoutMs);
+
+        uint8_t    rx[32];
+        int        n     = 0;
+        TickType_t start = xTaskGetTickCount();
+        do {
+            n += _uart->timedReadBytes(rx + n, sizeof(rx) - n, 1);
+            for (int at = 0; at + datagramLen <= n; ++at) {
+                uint8_t* d = rx + at;
+                if (d[0] == syncByte && d[1] == masterAddr && d[2] == op.reg && d[7] == crc(d, datagramLen - 1)) {
+                    *op.result = (uint32_t(d[3]) << 24) | (uint32_t(d[4]) << 16) | (uint32_t(d[5]) << 8) | d[6];
+                    return true;
+                }
+            }
+        } while (n < int(sizeof(rx)) && (xTaskGetTickCount() - start) <= replyTimeoutMs);
+        return false;
+    }
+
+    void TmcUartBus::flushAll() {
+        for (auto bus : buses) {
+            if (bus && bus->_nOps) {
+                bus->flush();
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+    Register access to the Trinamic UART drivers that share one UART.
+
+    The TMCStepper library waits a fixed time after every datagram it sends, so
+    a pass over several drivers costs a few milliseconds per register.  This
+    queues the datagrams for a pass and then runs them with no fixed waits.
+    Writes are not answered, so a run of them, to any mix of addresses, goes out
+    in one transfer.  The line is half duplex and replies carry no address, so
+    each read request goes out as soon as the reply to the one before it is in,
+    and a reply is known by its register and CRC, with the echo of the request
+    that single-wire wiring returns passed over.
+
+    Only drivers without a CS pin can share a pass.  One with a CS pin gets a
+    pass of its own, with its CS pin held around the flush.
+*/
+
+#include "../Uart.h"
+
+#include <cstdint>
+
+namespace MotorDrivers {
+
+    class TmcUartBus {
+        static const int maxOps         = 32;
+        static const int replyTimeoutMs = 5;    // From the end of a request; a reply starts within 15 bit times
+        static const int txTimeoutMs    = 100;  // For a queue full of writes to go out
+
+        struct Op {
+            uint8_t   addr;
+            uint8_t   reg;
+            bool      write;
+            uint32_t  value;
+            uint32_t* result;
+            bool*     ok;
+        };
+
+        Uart* _uart;
+        Op    _ops[maxOps];
+        int   _nOps = 0;
+
+        TmcUartBus(Uart* uart) : _uart(uart) {}
+
+        Op*  next_op();
+        bool transact_read(Op& op);
+
+    public:
+        // Returns the bus on the given UART, setting it up on first use
+        static TmcUartBus* get(Uart* uart);
+
+        // Queue a register access.  A read fills in value and ok when the
+        // queue is flushed; ok is false if no good reply came back.
+        void write(uint8_t addr, uint8_t reg, uint32_t value);
+        void read(uint8_t addr, uint8_t reg, uint32_t* value, bool* ok);
+
+        // Runs the queued accesses in order, and returns once the last write has been sent
+        void flush();
+
+        // Flushes the queues of all buses
+        static void flushAll();
+
+        static uint8_t crc(const uint8_t* datagram, int len);
+    };
+}
@@ -3,8 +3,17 @@
 
 #include "TrinamicBase.h"
 #include "../Machine/MachineConfig.h"
+#include "../MotionControl.h"  // mc_critical
+#include "../Protocol.h"       // send_alarm, feedHoldEvent
+#include "../GCode.h"          // gc_state
+#include "../Planner.h"        // plan_get_current_block
+#include "../Stepper.h"        // get_realtime_rate, accel_hook
+#include "TmcUartBus.h"
+#include "Driver/TmcSpiChain.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 
 namespace MotorDrivers {
     EnumItem trinamicModes[] = { { TrinamicMode::StealthChop, "StealthChop" },
@@ -14,6 +23,15 @@ namespace MotorDrivers {
 
     std::vector<TrinamicBase*> TrinamicBase::_instances;  // static list of all drivers for stallguard reporting
 
+    TimerHandle_t      TrinamicBase::_stallTimer   = nullptr;
+    int                TrinamicBase::_stallPollers = 0;
+    std::atomic<float> TrinamicBase::_calibrationRate { 0.0f };
+
+    const int   defaultStallPollMs    = 10;
+    const float calibrationMm         = 10.0f;  // Shortest calibration move, unless the travel is shorter
+    const float calibrationSpeedRatio = 0.9f;   // Samples are taken above this fraction of the rate
+    const int   maxCalibrationPasses  = 8;      // Enough for a binary search of the SPI range
+
     // Another approach would be to register a separate timer for each instance.
     // I think that timers are cheap so having only a single timer might not buy us much
     void TrinamicBase::read_sg(TimerHandle_t timer) {
@@ -25,6 +43,276 @@ namespace MotorDrivers {
                 }
             }
         }
+        for (TrinamicBase* t : _instances) {
+            t->monitor_health();
+        }
+    }
+
+    // Readers of the cache may be in other tasks, so it is copied as a whole
+    static portMUX_TYPE healthMux = portMUX_INITIALIZER_UNLOCKED;
+
+    TrinamicBase::Health TrinamicBase::health() {
+        portENTER_CRITICAL(&healthMux);
+        Health copy = _health;
+        portEXIT_CRITICAL(&healthMux);
+        return copy;
+    }
+
+    // Refreshes the cache and raises faults that appeared since the last read.
+    // An overtemperature shutdown has already stopped the motor, so it is a
+    // critical alarm.  A prewarning holds the motion first, so that the alarm
+    // comes with the position intact.
+    void TrinamicBase::monitor_health() {
+        Health now;
+        if (_has_errors || !read_health(now)) {
+            return;
+        }
+        now.valid   = true;
+        Health last = _health;
+        portENTER_CRITICAL(&healthMux);
+        _health = now;
+        portEXIT_CRITICAL(&healthMux);
+
+        if (now.overTemp && !last.overTemp) {
+            log_error(axisName() << " driver overtemperature shutdown");
+            mc_critical(ExecAlarm::DriverShutdown);
+            return;
+        }
+        if (now.overTempWarn && !last.overTempWarn) {
+            log_warn(axisName() << " driver overtemperature warning");
+            _overTempAlarmPending = true;
+        }
+        if (!now.overTempWarn) {
+            _overTempAlarmPending = false;
+        }
+        if (_overTempAlarmPending) {
+            if (inMotionState()) {
+                protocol_send_event(&feedHoldEvent);
+            } else if (sys.state != State::Alarm && sys.state != State::Critical) {
+                _overTempAlarmPending = false;
+                send_alarm(ExecAlarm::DriverOverTemp);
+            }
+        }
+        if (now.shortToGround && !last.shortToGround) {
+            log_warn(axisName() << " driver short to ground");
+        }
+    }
+
+    // The step ISR reports each change, and the current is changed from the timer
+    // task, where the other register traffic of the drivers runs in the background
+    void IRAM_ATTR TrinamicBase::accel_changed(bool accelerating) {
+        xTimerPendFunctionCallFromISR(apply_accel_current, nullptr, accelerating, nullptr);
+    }
+
+    void TrinamicBase::apply_accel_current(void*, uint32_t accelerating) {
+        bool boost = accelerating && sys.state != State::Homing;  // Homing keeps the current that StallGuard was set up for
+        tmcSpiChainBegin();
+        for (TrinamicBase* t : _instances) {
+            if (t->_accelCs != t->_runCs && !t->_has_errors && t->_boosted != boost) {
+                t->write_irun(boost ? t->_accelCs : t->_runCs);
+                t->_boosted = boost;
+            }
+        }
+        tmcSpiChainEnd();
+        TmcUartBus::flushAll();
+    }
+
+    // Called after the registers have been written from the configured currents.
+    // IRUN scales the current in steps of 1/32, so the acceleration current is
+    // set relative to the run current, with sense resistor and vsense unchanged.
+    void TrinamicBase::update_current_scales() {
+        _boosted = false;
+        if (_accel_current <= 0 || _run_current <= 0) {
+            return;
+        }
+        _runCs   = read_irun();
+        int cs   = lroundf((_runCs + 1) * _accel_current / _run_current) - 1;
+        _accelCs = std::clamp(cs, 0, 31);
+        if (_accelCs != cs) {
+            log_warn(axisName() << " accel_amps is out of reach of the run current scale, using " << _accelCs << "/31");
+        }
+    }
+
+    // Watches the drivers that stand in for limit switches while homing, and
+    // samples the drivers being calibrated.  It runs much faster than read_sg(),
+    // and only while there is something for it to do.
+    void TrinamicBase::poll_stall(TimerHandle_t timer) {
+        float rate    = _calibrationRate;
+        bool  atSpeed = rate > 0 && Stepper::get_realtime_rate() >= rate * calibrationSpeedRatio;
+        for (TrinamicBase* t : _instances) {
+            if (!t->_stallPolled && !(t->_calibrating && atSpeed)) {
+                continue;
+            }
+            Health now;
+            if (t->_has_errors || !t->read_health(now)) {
+                continue;
+            }
+            if (t->_calibrating && atSpeed) {
+                t->_sgStats.add(now);
+            }
+            if (t->_stallPolled) {
+                t->stall_limit(now.stalled);
+            }
+        }
+    }
+
+    void TrinamicBase::stall_polling(bool on) {
+        if (on && !_stallTimer) {
+            int ms = 0;
+            for (TrinamicBase* t : _instances) {
+                if (t->_stallguardPollMs && (!ms || t->_stallguardPollMs < ms)) {
+                    ms = t->_stallguardPollMs;
+                }
+            }
+            _stallTimer = xTimerCreate("StallPoll", ms ? ms : defaultStallPollMs, true, nullptr, poll_stall);
+            if (!_stallTimer) {
+                log_error("Failed to create timer for stall polling");
+            }
+        }
+        if (!_stallTimer) {
+            return;
+        }
+        if (on) {
+            if (_stallPollers++ == 0) {
+                xTimerStart(_stallTimer, 0);
+            }
+        } else if (_stallPollers > 0 && --_stallPollers == 0) {
+            xTimerStop(_stallTimer, 0);
+        }
+    }
+
+    // A stall acts as the limit switch at the end that the axis homes to.  It
+    // holds until the approach is over, because a stopped motor no longer
+    // reads as stalled and would otherwise start pushing again.
+    void TrinamicBase::stall_limit(bool stalled) {
+        bool limited = Machine::Homing::approach(axis_index()) && (stalled || _stallLimited);
+        if (limited != _stallLimited) {
+            _stallLimited = limited;
+            config->_axes->_axis[axis_index()]->_motors[dual_axis_index()]->stallLimit(limited);
+        }
+    }
+
+    void TrinamicBase::SgStats::add(const Health& health) {
+        ++samples;
+        sum += health.sgResult;
+        min = std::min(min, health.sgResult);
+        max = std::max(max, health.sgResult);
+        if (health.stalled) {
+            ++stalls;
+        }
+    }
+
+    // Moves the axis away from its homing end and back at rate, sampling the
+    // drivers being calibrated while it runs at speed.  Returns false if the
+    // motion was stopped.
+    bool TrinamicBase::calibration_sweep(size_t axis, float distance, float rate) {
+        float start[MAX_N_AXIS];
+        float away[MAX_N_AXIS];
+        copyAxes(start, gc_state.position);
+        copyAxes(away, gc_state.position);
+        away[axis] += config->_axes->_axis[axis]->_homing->_positiveDirection ? -distance : distance;
+
+        plan_line_data_t plan_data      = {};
+        plan_data.motion.noFeedOverride = 1;
+        plan_data.spindle               = SpindleState::Disable;
+        plan_data.feed_rate             = rate;
+        plan_line_data_t back           = plan_data;
+        if (!mc_linear(away, &plan_data, start)) {
+            log_error("Calibration move is outside the soft limits");
+            return false;
+        }
+        mc_linear(start, &back, away);
+
+        _calibrationRate = rate;
+        protocol_buffer_synchronize();
+        _calibrationRate = 0.0f;
+        return !sys.abort && sys.state == State::Idle;
+    }
+
+    // Finds StallGuard settings for the drivers on an axis that home with
+    // StallGuard.  The axis runs away from its homing end and back at the seek
+    // and feed rates, with the drivers set up for homing, while SG_RESULT is
+    // sampled in the background.  Each driver family picks its setting from
+    // that, over several passes if it has to search.  The settings are used
+    // until the next restart and are logged for the config file.
+    bool TrinamicBase::calibrate_stallguard(size_t axis) {
+        auto axisConfig = config->_axes->_axis[axis];
+        auto homing     = axisConfig->_homing;
+        auto name       = config->_axes->axisName(axis);
+        if (!homing) {
+            log_error(name << " axis has no homing section");
+            return false;
+        }
+
+        std::vector<TrinamicBase*> pending;
+        for (TrinamicBase* t : _instances) {
+            if (t->axis_index() == axis && !t->_has_errors && t->homes_with_stallguard()) {
+                pending.push_back(t);
+            }
+        }
+        if (pending.empty()) {
+            log_error("No driver on the " << name << " axis homes with StallGuard");
+            return false;
+        }
+
+        // Long enough to spend most of the time at speed
+        float rates[] = { homing->_seekRate, homing->_feedRate };
+        float v       = std::max(rates[0], rates[1]) / 60.0f;
+        float ramp    = v * v / (2 * axisConfig->_acceleration);
+        float mm      = std::min(axisConfig->_maxTravel / 4, std::max(calibrationMm, 4 * ramp));
+
+        AxisMask axisMask = bitnum_to_mask(axis);
+        config->_axes->set_homing_mode(axisMask, true);
+        for (TrinamicBase* t : pending) {
+            t->_calibrating = true;
+            t->tune_start();
+            t->set_registers(true);
+            t->update_current_scales();
+        }
+        stall_polling(true);
+
+        bool ok = true;
+        for (int pass = 0; ok && !pending.empty() && pass < maxCalibrationPasses; pass++) {
+            for (TrinamicBase* t : pending) {
+                t->_sgStats = {};
+            }
+            for (float rate : rates) {
+                if (!(ok = calibration_sweep(axis, mm, rate))) {
+                    break;
+                }
+            }
+            for (auto it = pending.begin(); ok && it != pending.end();) {
+                TrinamicBase* t     = *it;
+                auto&         stats = t->_sgStats;
+                if (!stats.samples) {
+                    log_error(t->axisName() << " gave no StallGuard readings at speed");
+                    ok = false;
+                    break;
+                }
+                log_info(t->axisName() << " stallguard " << t->_stallguard << ": SG_RESULT " << stats.min << ".." << stats.max << " mean "
+                                       << stats.sum / stats.samples << " stalls " << stats.stalls << "/" << stats.samples);
+                if (t->tune_stallguard(stats)) {
+                    t->_calibrating = false;
+                    log_info(t->axisName() << " calibrated, use stallguard: " << t->_stallguard);
+                    it = pending.erase(it);
+                } else {
+                    t->set_registers(true);
+                    t->update_current_scales();
+                    ++it;
+                }
+            }
+        }
+        for (TrinamicBase* t : pending) {
+            t->_calibrating = false;
+        }
+        if (ok && !pending.empty()) {
+            log_error("StallGuard calibration did not settle");
+            ok = false;
+        }
+
+        stall_polling(false);
+        config->_axes->set_homing_mode(axisMask, false);
+        return ok;
     }
 
     // calculate a tstep from a rate
@@ -73,7 +361,21 @@ namespace MotorDrivers {
     }
 
     bool TrinamicBase::set_homing_mode(bool isHoming) {
+        bool polled = isHoming && _stallguardPollMs && homes_with_stallguard();
+        if (_stallPolled && !polled) {
+            stall_polling(false);
+            _stallPolled = false;
+            if (_stallLimited) {
+                _stallLimited = false;
+                config->_axes->_axis[axis_index()]->_motors[dual_axis_index()]->stallLimit(false);
+            }
+        }
         set_registers(isHoming);
+        update_current_scales();
+        if (polled && !_stallPolled) {
+            _stallPolled = true;
+            stall_polling(true);
+        }
         return true;
     }
 
@@ -141,12 +443,14 @@ namespace MotorDrivers {
         }
 
         set_registers(false);
+        update_current_scales();
     }
     void TrinamicBase::registration() {
         // Display the stepper library version message once, before the first
         // TMC config message.
         if (_instances.empty()) {
             log_debug("TMCStepper Library Ver. " << to_hex(TMCSTEPPER_VERSION));
+            // The same timer keeps the health cache of every driver up to date
             auto timer = xTimerCreate("Stallguard", 200, true, nullptr, read_sg);
             // Timer failure is not fatal because you can still use the system
             if (!timer) {
@@ -157,6 +461,9 @@ namespace MotorDrivers {
         }
 
         _instances.push_back(this);
+        if (_accel_current > 0) {
+            Stepper::accel_hook = accel_changed;
+        }
 
         config_message();
     }
@@ -6,6 +6,7 @@
 #include "StandardStepper.h"
 #include "../EnumItem.h"
 #include <TMCStepper.h>  // https://github.com/teemuatlut/TMCStepper
+#include <atomic>
 #include <cstdint>
 
 namespace MotorDrivers {
@@ -19,16 +20,70 @@ namespace MotorDrivers {
     extern EnumItem trinamicModes[];
 
     class TrinamicBase : public StandardStepper {
+    public:
+        // Driver state kept up to date in the background, from DRV_STATUS
+        struct Health {
+            bool     valid         = false;  // False until the first good read
+            bool     overTemp      = false;  // The driver has shut down
+            bool     overTempWarn  = false;  // Prewarning, before it shuts down
+            bool     shortToGround = false;
+            bool     openLoad      = false;
+            bool     stalled       = false;  // What the DIAG output shows for a stall
+            uint16_t sgResult      = 0;      // StallGuard load measurement
+            uint8_t  csActual      = 0;      // Current scale, 0..31
+        };
+
+        // SG_RESULT seen while running freely at speed, for calibration
+        struct SgStats {
+            uint32_t samples = 0;
+            uint32_t sum     = 0;
+            uint32_t stalls  = 0;  // Samples that read as a stall
+            uint16_t min     = 0xFFFF;
+            uint16_t max     = 0;
+
+            void add(const Health& health);
+        };
+
     private:
         static void read_sg(TimerHandle_t);
 
         static std::vector<TrinamicBase*> _instances;
 
+        Health _health;
+        bool   _overTempAlarmPending = false;
+
+        void monitor_health();
+
+        // Stalls can be watched by reading the driver when no DIAG pin is wired
+        static TimerHandle_t      _stallTimer;
+        static int                _stallPollers;
+        static std::atomic<float> _calibrationRate;  // Sampling runs while the motion is near this rate
+
+        bool    _stallPolled  = false;  // Homing with stalls read from the driver
+        bool    _stallLimited = false;  // A stall is standing in for the limit switch
+        bool    _calibrating  = false;
+        SgStats _sgStats;
+
+        // IRUN while accelerating, from _accel_current, and at other times
+        uint8_t _accelCs = 0;
+        uint8_t _runCs   = 0;
+        bool    _boosted = false;
+
+        static void accel_changed(bool accelerating);
+        static void apply_accel_current(void*, uint32_t accelerating);
+        void        update_current_scales();
+
+        static void poll_stall(TimerHandle_t);
+        static void stall_polling(bool on);
+        static bool calibration_sweep(size_t axis, float distance, float rate);
+
+        void stall_limit(bool stalled);
+
     protected:
         uint32_t calc_tstep(float speed, float percent);
 
         bool         _disable_state_known = false;  // we need to always set the state least once.
-        bool         _has_errors;
+        bool         _has_errors = false;
         uint16_t     _driver_part_number;  // example: use 2130 for TMC2130
         bool         _disabled = false;
         TrinamicMode _mode     = TrinamicMode::StealthChop;
@@ -41,9 +96,11 @@ namespace MotorDrivers {
 
         float _run_current         = 0.50;
         float _hold_current        = 0.50;
+        float _accel_current       = 0;  // Used in place of run current while accelerating, if set
         int   _microsteps          = 16;
         int   _stallguard          = 0;
         bool  _stallguardDebugMode = false;
+        int   _stallguardPollMs    = 0;  // Read stalls from the driver this often, instead of from DIAG
 
         uint8_t _toff_disable     = 0;
         uint8_t _toff_stealthchop = 5;
@@ -68,15 +125,43 @@ namespace MotorDrivers {
 
         void registration();
 
+        // Reads DRV_STATUS and decodes it for the driver family.  Returns false if
+        // the driver did not answer.
+        virtual bool read_health(Health& health) { return false; }
+
+        // Sets the run current scale, 0..31, without touching the other registers
+        virtual void    write_irun(uint8_t cs) {}
+        virtual uint8_t read_irun() { return 0; }  // From the shadow of the write-only register
+
+        // Read often by the stall poll, while homing or calibrating
+        bool stall_watched() const { return _stallPolled || _calibrating; }
+
+        bool homes_with_stallguard() { return static_cast<TrinamicMode>(trinamicModes[_homing_mode].value) == TrinamicMode::StallGuard; }
+
+        // Calibration picks _stallguard from what SG_RESULT did with the current
+        // setting.  tune_start() sets the first setting to try, and
+        // tune_stallguard() sets the next one and returns true once it is final.
+        virtual void tune_start() {}
+        virtual bool tune_stallguard(const SgStats& stats) { return true; }
+
     public:
         TrinamicBase() = default;
 
+        // The cached state, which never touches the bus
+        Health      health();
+        std::string motorName() const { return axisName(); }
+
+        static const std::vector<TrinamicBase*>& instances() { return _instances; }
+
+        static bool calibrate_stallguard(size_t axis);
+
         void group(Configuration::HandlerBase& handler) override {
             StandardStepper::group(handler);
 
             handler.item("r_sense_ohms", _r_sense, 0.0, 1.00);
             handler.item("run_amps", _run_current, 0.05, 10.0);
             handler.item("hold_amps", _hold_current, 0.05, 10.0);
+            handler.item("accel_amps", _accel_current, 0.0, 10.0);
             handler.item("microsteps", _microsteps, 1, 256);
             handler.item("toff_disable", _toff_disable, 0, 15);
             handler.item("toff_stealthchop", _toff_stealthchop, 2, 15);
@@ -8,12 +8,17 @@
 #include "TrinamicSpiDriver.h"
 #include "../Machine/MachineConfig.h"
 #include <TMCStepper.h>  // https://github.com/teemuatlut/TMCStepper
+#include "Driver/TmcSpiChain.h"
 #include <atomic>
 
 namespace MotorDrivers {
 
     pinnum_t TrinamicSpiDriver::daisy_chain_cs_id = 255;
     uint8_t  TrinamicSpiDriver::spi_index_mask    = 0;
+    int32_t  TrinamicSpiDriver::chain_length      = 0;
+
+    TickType_t TrinamicSpiDriver::chain_status_tick = 0;
+    uint32_t   TrinamicSpiDriver::chain_status[maxChainLength];
 
     void TrinamicSpiDriver::init() {}
 
@@ -43,6 +48,54 @@ namespace MotorDrivers {
                         << " Disable:" << _disable_pin.name() << " Index:" << _spi_index << " R:" << _r_sense);
     }
 
+    // DRV_STATUS is laid out the same way on the TMC2130, TMC2160 and TMC5160
+    bool TrinamicSpiDriver::read_health(Health& health) {
+        uint32_t status;
+        if (_spi_index > 0 && _spi_index <= maxChainLength && chain_length <= maxChainLength) {
+            TickType_t now = xTaskGetTickCount();
+            if (now != chain_status_tick) {
+                tmcSpiChainRead(spi_stepper(), chain_length, 0x6F, chain_status);  // DRV_STATUS
+                chain_status_tick = now;
+            }
+            status = chain_status[_spi_index - 1];
+        } else {
+            status = spi_stepper()->DRV_STATUS();
+        }
+        if (status == 0xFFFFFFFF) {
+            return false;  // MISO floating high, so nothing answered
+        }
+        health.sgResult      = status & 0x3FF;
+        health.csActual      = (status >> 16) & 0x1F;
+        health.stalled       = status & (1 << 24);
+        health.overTemp      = status & (1 << 25);
+        health.overTempWarn  = status & (1 << 26);
+        health.shortToGround = status & (3 << 27);
+        health.openLoad      = status & (3 << 29);
+        return true;
+    }
+
+    void TrinamicSpiDriver::tune_start() {
+        _sgLow      = -64;
+        _sgHigh     = 63;
+        _stallguard = (_sgLow + _sgHigh) / 2;
+    }
+
+    // SG_RESULT reaches 0 at a stall, and higher settings raise it, so stalls
+    // while running freely mean that the setting is too low
+    bool TrinamicSpiDriver::tune_stallguard(const SgStats& stats) {
+        if (stats.stalls || stats.min == 0) {
+            _sgLow = _stallguard + 1;
+        } else {
+            _sgHigh = _stallguard;
+        }
+        if (_sgLow >= _sgHigh) {
+            _stallguard = std::min(_sgLow + 1, 63);  // A step of margin
+            return true;
+        }
+        _stallguard = _sgLow + (_sgHigh - _sgLow) / 2;
+        return false;
+    }
+
     uint8_t TrinamicSpiDriver::toffValue() {
         if (_disabled) {
             return _toff_disable;
@@ -7,6 +7,7 @@
 #include "../Pin.h"
 #include "../PinMapper.h"
 
+#include <algorithm>
 #include <cstdint>
 
 const int NORMAL_TCOOLTHRS = 0xFFFFF;  // 20 bit is max
@@ -35,6 +36,7 @@ namespace MotorDrivers {
                         _cs_mapping       = PinMapper(_cs_pin);
                         daisy_chain_cs_id = _cs_mapping.pinId();
                         set_bitnum(spi_index_mask, _spi_index);
+                        chain_length = std::max(chain_length, _spi_index);
                     } else {
                         // The TMC SPI is not daisy-chained
                     }
@@ -44,6 +46,7 @@ namespace MotorDrivers {
                     Assert(_spi_index != -1, "spi_index: must be configured on all daisy-chained TMCs");
                     Assert(bitnum_is_false(spi_index_mask, _spi_index), "spi_index: must be unique among all daisy-chained TMCs");
                     set_bitnum(spi_index_mask, _spi_index);
+                    chain_length = std::max(chain_length, _spi_index);
                 }
             }
             _spi_setup_done = true;
@@ -61,6 +64,7 @@ namespace MotorDrivers {
             handler.item("homing_mode", _homing_mode, trinamicModes);
             handler.item("stallguard", _stallguard, -64, 63);
             handler.item("stallguard_debug", _stallguardDebugMode);
+            handler.item("stallguard_poll_ms", _stallguardPollMs, 0, 50);
             handler.item("toff_coolstep", _toff_coolstep, 2, 15);
         }
 
@@ -77,11 +81,33 @@ namespace MotorDrivers {
         bool    reportTest(uint8_t result);
         uint8_t toffValue();
 
+        // The library object, for the registers that the whole family shares
+        virtual TMC2130Stepper* spi_stepper() = 0;
+
+        bool    read_health(Health& health) override;
+        void    write_irun(uint8_t cs) override { spi_stepper()->irun(cs); }
+        uint8_t read_irun() override { return spi_stepper()->irun(); }
+        void    tune_start() override;
+        bool    tune_stallguard(const SgStats& stats) override;
+
     private:
+        static const int maxChainLength = 8;  // spi_index_mask has a bit per driver
+
         static pinnum_t daisy_chain_cs_id;
         static uint8_t  spi_index_mask;
+        static int32_t  chain_length;
+
+        // DRV_STATUS of the whole daisy chain, read at once for the first driver
+        // whose health is checked in a tick
+        static TickType_t chain_status_tick;
+        static uint32_t   chain_status[maxChainLength];
 
         PinMapper _cs_mapping;
+
+        // Calibration searches for the lowest, most sensitive, setting that does
+        // not stall while running freely.  It lies in _sgLow.._sgHigh.
+        int _sgLow  = -64;
+        int _sgHigh = 63;
     };
 
 }
@@ -19,11 +19,30 @@
 
 namespace MotorDrivers {
 
+    namespace {
+        // Registers that the TMC2208 and TMC2209 share
+        const uint8_t GSTAT_reg      = 0x01;
+        const uint8_t IFCNT_reg      = 0x02;
+        const uint8_t IOIN_reg       = 0x06;
+        const uint8_t IHOLD_IRUN_reg = 0x10;
+        const uint8_t TSTEP_reg      = 0x12;
+        const uint8_t SG_RESULT_reg  = 0x41;  // TMC2209 only
+        const uint8_t DRV_STATUS_reg = 0x6F;
+
+        const TickType_t testLifetimeMs   = 2000;  // Configuring the other drivers takes a while
+        const TickType_t statusLifetimeMs = 20;
+    }
+
+    std::vector<TrinamicUartDriver*> TrinamicUartDriver::_drivers;
+
     void TrinamicUartDriver::init() {
         _uart = config->_uarts[_uart_num];
         Assert(_uart, "TMC Driver missing uart%d section", _uart_num);
 
         _cs_pin.setAttr(Pin::Attr::Output);
+
+        _bus = TmcUartBus::get(_uart);
+        _drivers.push_back(this);
     }
 
     /*
@@ -36,6 +55,116 @@ namespace MotorDrivers {
                         << " Dir:" << _dir_pin.name() << " Disable:" << _disable_pin.name() << " R:" << _r_sense);
     }
 
+    // Drivers without a CS pin listen whenever the UART talks, so they can share
+    // a pass.  The ones that are not answering are left out, since each of their
+    // reads would only wait out the timeout.  While homing or calibrating, the
+    // stall poll reads a few drivers often, so those are kept apart from the rest.
+    bool TrinamicUartDriver::shares_pass_with(TrinamicUartDriver* other) {
+        if (other == this) {
+            return true;
+        }
+        return _cs_pin.undefined() && other->_cs_pin.undefined() && other->_bus == _bus && !other->_has_errors &&
+               other->stall_watched() == stall_watched();
+    }
+
+    // Takes this driver's result from an earlier pass if there is one, or else
+    // runs a pass for it and the drivers that share it.  The queue function is
+    // called for each phase in turn for all of the drivers, so that the writes
+    // of a phase go out together.  The caller holds the CS pin.
+    void TrinamicUartDriver::run_pass(Pass TrinamicUartDriver::*pass, QueueFn queue, int phases, TickType_t lifetimeMs) {
+        Pass&      mine = this->*pass;
+        TickType_t now  = xTaskGetTickCount();
+        if (mine.pending && now - mine.tick <= lifetimeMs) {
+            mine.pending = false;
+            return;
+        }
+
+        for (int phase = 0; phase < phases; ++phase) {
+            for (auto d : _drivers) {
+                if (shares_pass_with(d)) {
+                    (d->*queue)(d->*pass, phase);
+                }
+            }
+        }
+        _bus->flush();
+
+        for (auto d : _drivers) {
+            if (shares_pass_with(d)) {
+                (d->*pass).pending = d != this;
+                (d->*pass).tick    = now;
+            }
+        }
+    }
+
+    void TrinamicUartDriver::queue_test(Pass& pass, int phase) {
+        switch (phase) {
+            case 0:
+                _bus->read(_addr, IOIN_reg, &pass.value[0], &pass.ok[0]);
+                _bus->read(_addr, IFCNT_reg, &pass.value[1], &pass.ok[1]);
+                break;
+            case 1:
+                _bus->write(_addr, GSTAT_reg, 0);  // a write to GSTAT increases IFCNT
+                break;
+            case 2:
+                _bus->read(_addr, IFCNT_reg, &pass.value[2], &pass.ok[2]);
+                break;
+        }
+    }
+
+    void TrinamicUartDriver::bus_test(uint8_t& version, bool& counted) {
+        run_pass(&TrinamicUartDriver::_testPass, &TrinamicUartDriver::queue_test, 3, testLifetimeMs);
+        const Pass& pass = _testPass;
+        version          = pass.ok[0] ? pass.value[0] >> 24 : 0;
+        counted          = pass.all_ok() && ((pass.value[1] + 1) & 0xff) == (pass.value[2] & 0xff);
+    }
+
+    void TrinamicUartDriver::queue_status(Pass& pass, int) {
+        _bus->read(_addr, DRV_STATUS_reg, &pass.value[0], &pass.ok[0]);
+        pass.value[1] = 0;
+        pass.ok[1]    = true;
+        pass.value[2] = 0;
+        pass.ok[2]    = true;
+        if (_hasStallGuard) {
+            _bus->read(_addr, SG_RESULT_reg, &pass.value[1], &pass.ok[1]);
+        }
+        if (_tcoolthrs) {
+            _bus->read(_addr, TSTEP_reg, &pass.value[2], &pass.ok[2]);
+        }
+    }
+
+    // DRV_STATUS is laid out the same way on the TMC2208 and TMC2209
+    bool TrinamicUartDriver::read_health(Health& health) {
+        _cs_pin.synchronousWrite(true);
+        run_pass(&TrinamicUartDriver::_statusPass, &TrinamicUartDriver::queue_status, 1, statusLifetimeMs);
+        _cs_pin.synchronousWrite(false);
+        const Pass& pass = _statusPass;
+        if (!pass.all_ok()) {
+            return false;
+        }
+        uint32_t status      = pass.value[0];
+        health.sgResult      = pass.value[1];
+        health.stalled       = _tcoolthrs && health.sgResult <= 2 * _stallguard && pass.value[2] <= _tcoolthrs;
+        health.overTempWarn  = status & (1 << 0);
+        health.overTemp      = status & (1 << 1);
+        health.shortToGround = status & (3 << 2);
+        health.openLoad      = status & (3 << 6);
+        health.csActual      = (status >> 16) & 0x1F;
+        return true;
+    }
+
+    // IHOLD_IRUN cannot be read back, so the rest of it comes from the library's
+    // copy.  Drivers without a CS pin only queue the write, so that the changes for
+    // all of them go out together when the caller flushes the buses.
+    void TrinamicUartDriver::write_irun(uint8_t cs) {
+        uint32_t value = (uart_stepper()->IHOLD_IRUN() & ~(0x1Fu << 8)) | (uint32_t(cs) << 8);
+        _bus->write(_addr, IHOLD_IRUN_reg, value);
+        if (!_cs_pin.undefined()) {
+            _cs_pin.synchronousWrite(true);
+            _bus->flush();
+            _cs_pin.synchronousWrite(false);
+        }
+    }
+
     uint8_t TrinamicUartDriver::toffValue() {
         if (_disabled) {
             return _toff_disable;
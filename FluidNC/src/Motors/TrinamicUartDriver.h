@@ -5,10 +5,12 @@
 #pragma once
 
 #include "TrinamicBase.h"
+#include "TmcUartBus.h"
 #include "../Pin.h"
 #include "../Uart.h"
 
 #include <cstdint>
+#include <vector>
 
 namespace MotorDrivers {
 
@@ -37,7 +39,8 @@ namespace MotorDrivers {
         }
 
     protected:
-        Uart* _uart = nullptr;
+        Uart*       _uart = nullptr;
+        TmcUartBus* _bus  = nullptr;
 
         Pin _cs_pin;
 
@@ -48,8 +51,48 @@ namespace MotorDrivers {
 
         uint8_t toffValue();  // TO DO move to Base?
 
+        // The library object, for the registers that the whole family shares
+        virtual TMC2208Stepper* uart_stepper() = 0;
+
+        // Only the TMC2209 has StallGuard.  A stall is read as DIAG shows it:
+        // TSTEP at or below TCOOLTHRS, and SG_RESULT at or below 2 * SGTHRS.
+        bool     _hasStallGuard = false;
+        uint32_t _tcoolthrs     = 0;  // StallGuard works below this TSTEP, 0 when it is off
+
+        // The connection test reads the version, and then checks that a write
+        // counts in IFCNT.  For the drivers that share a pass, it is run for
+        // all of them at once when the first is configured.
+        void bus_test(uint8_t& version, bool& counted);
+
+        bool    read_health(Health& health) override;
+        void    write_irun(uint8_t cs) override;
+        uint8_t read_irun() override { return uart_stepper()->irun(); }
+
     private:
+        static const int passValues = 3;
+
+        // Registers read in a pass over the UART, kept for the drivers that did
+        // not ask for it until they do, unless they are too old by then
+        struct Pass {
+            uint32_t   value[passValues];
+            bool       ok[passValues];
+            bool       pending = false;
+            TickType_t tick;
+
+            bool all_ok() const { return ok[0] && ok[1] && ok[2]; }
+        };
+
+        Pass _testPass;
+        Pass _statusPass;
+
+        static std::vector<TrinamicUartDriver*> _drivers;
+
+        using QueueFn = void (TrinamicUartDriver::*)(Pass& pass, int phase);
 
+        void run_pass(Pass TrinamicUartDriver::*pass, QueueFn queue, int phases, TickType_t lifetimeMs);
+        bool shares_pass_with(TrinamicUartDriver* other);
+        void queue_test(Pass& pass, int phase);
+        void queue_status(Pass& pass, int phase);
     };
 
 }
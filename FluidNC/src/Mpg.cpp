@@ -0,0 +1,210 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Mpg.h"
+
+#include "Jog.h"  // JOG_LINE_NUMBER
+#include "Machine/MachineConfig.h"
+#include "MotionControl.h"  // mc_linear
+#include "Protocol.h"       // protocol_notify_main(), motionCancelEvent
+#include "System.h"         // sys, get_mpos()
+#include "Driver/PulseCounter.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const char* selectPinNames[] = { "select_x_pin", "select_y_pin", "select_z_pin", "select_a_pin", "select_b_pin",
+                                        "select_c_pin", "select_u_pin", "select_v_pin", "select_w_pin" };
+static_assert(sizeof(selectPinNames) / sizeof(selectPinNames[0]) >= MAX_N_AXIS, "Every axis needs a select pin name");
+
+const float mpgLagSecs     = 0.25f;  // Clicks further ahead of the machine than this are dropped
+const float mpgSegmentSecs = 0.02f;  // Clicks are gathered into moves of at least this long while moving
+const float mpgLeadSecs    = 0.05f;  // Queued beyond the stopping distance, for the main loop's latency
+const float mpgResolution  = 1e-4f;  // mm; targets closer than this to the queued position are reached
+
+static int              unit    = -1;  // PCNT unit
+static volatile int16_t checked = 0;   // Raw count when the polling task last looked
+
+void Mpg::group(Configuration::HandlerBase& handler) {
+    handler.item("a_pin", _aPin);
+    handler.item("b_pin", _bPin);
+    handler.item("counts_per_click", _countsPerClick, 1, 16);
+    handler.item("filter_ns", _filterNs, 0, 12000);
+    handler.item("mm_per_click", _mmPerClick, 0.0001, 10.0);
+    handler.item("x10_pin", _x10Pin);
+    handler.item("x100_pin", _x100Pin);
+    for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+        handler.item(selectPinNames[axis], _selectPins[axis]);
+    }
+}
+
+void Mpg::validate() {
+    Assert(_aPin.defined() && _bPin.defined(), "MPG: a_pin and b_pin must be configured");
+    bool selectable = false;
+    for (auto& pin : _selectPins) {
+        selectable = selectable || pin.defined();
+    }
+    Assert(selectable, "MPG: at least one select pin must be configured");
+}
+
+void Mpg::init() {
+    auto a = _aPin.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
+    auto b = _bPin.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
+    _aPin.setAttr(Pin::Attr::Input);
+    _bPin.setAttr(Pin::Attr::Input);
+    _x10Pin.setAttr(Pin::Attr::Input);
+    _x100Pin.setAttr(Pin::Attr::Input);
+    for (auto& pin : _selectPins) {
+        pin.setAttr(Pin::Attr::Input);
+    }
+
+    unit = pulse_counter_attach_quadrature(a, b);
+    if (unit < 0) {
+        log_error("MPG: no pulse counter");
+        return;
+    }
+    if (_filterNs) {
+        pulse_counter_set_filter(unit, std::min(_filterNs * 80 / 1000, 1023));
+    }
+    _last   = int16_t(pulse_counter_read(unit));
+    checked = _last;
+
+    log_info("MPG A:" << _aPin.name() << " B:" << _bPin.name() << " Click:" << _mmPerClick << "mm");
+}
+
+void Mpg::check() {
+    if (unit < 0) {
+        return;
+    }
+    int16_t now = int16_t(pulse_counter_read(unit));
+    if (now != checked) {
+        checked = now;
+        protocol_notify_main();
+    }
+}
+
+int Mpg::selected_axis() {
+    auto n_axis = config->_axes->_numberAxis;
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (_selectPins[axis].defined() && _selectPins[axis].read()) {
+            return axis;
+        }
+    }
+    return -1;
+}
+
+void Mpg::cancel() {
+    if (sys.state == State::Jog) {
+        protocol_send_event(&motionCancelEvent);
+        _cancelling = true;
+    } else if (plan_get_current_block()) {
+        // Queued but not started yet
+        plan_reset();
+        gc_sync_position();
+        plan_sync_position();
+    }
+    _following = false;
+}
+
+void Mpg::poll() {
+    if (unit < 0) {
+        return;
+    }
+
+    // The counter goes back to 0 at either limit, so a step of more than half its range
+    // is really a wrap the other way
+    int16_t now   = int16_t(pulse_counter_read(unit));
+    int32_t delta = int32_t(now) - _last;
+    if (delta > int32_t(pulseCounterLimit / 2)) {
+        delta -= pulseCounterLimit;
+    } else if (delta < -int32_t(pulseCounterLimit / 2)) {
+        delta += pulseCounterLimit;
+    }
+    _last = now;
+    _counts += delta;
+    int32_t clicks = _counts / _countsPerClick;
+    _counts -= clicks * _countsPerClick;
+
+    int axis = selected_axis();
+    if (axis != _axis) {
+        if (_following) {
+            cancel();
+        }
+        _axis = axis;
+        if (axis >= 0) {
+            _target = gc_state.position[axis];
+        }
+        return;
+    }
+    if (axis < 0) {
+        return;
+    }
+
+    if (_cancelling) {
+        if (sys.state == State::Jog) {
+            return;
+        }
+        _cancelling = false;
+    }
+    if (_following && sys.state != State::Jog && !plan_get_current_block()) {
+        _following = false;  // Stopped at a soft limit, or by something else
+    }
+    // Other motion, and other jogs, have the machine to themselves
+    if (!(sys.state == State::Idle || (sys.state == State::Jog && _following)) || (!_following && plan_get_current_block())) {
+        _target = gc_state.position[axis];
+        return;
+    }
+
+    auto  a     = config->_axes->_axis[axis];
+    float rate  = a->_maxRate;     // mm/min
+    float speed = rate / 60.0f;    // mm/sec
+    float mpos  = get_mpos()[axis];
+    float scale = _mmPerClick * (_x100Pin.defined() && _x100Pin.read() ? 100 : _x10Pin.defined() && _x10Pin.read() ? 10 : 1);
+    float lag   = speed * mpgLagSecs;
+    _target     = std::clamp(_target + clicks * scale, mpos - lag, mpos + lag);
+
+    float queuedAt  = gc_state.position[axis];
+    float remaining = _target - queuedAt;
+    if (fabsf(remaining) < mpgResolution) {
+        return;
+    }
+    int8_t direction = remaining > 0 ? 1 : -1;
+    if (_following && direction != _direction) {
+        cancel();  // The target goes on from wherever the machine stops
+        return;
+    }
+
+    // While the queued moves are well ahead of the machine, clicks are gathered up, so the
+    // planner is not fed a tiny block for each one
+    float stop = speed * speed / (2 * a->_acceleration) + speed * mpgLeadSecs;
+    if (_following && fabsf(remaining) < speed * mpgSegmentSecs && fabsf(queuedAt - mpos) > stop) {
+        return;
+    }
+    if (plan_check_full_buffer()) {
+        return;
+    }
+
+    plan_line_data_t pl_data      = {};
+    pl_data.spindle_speed         = gc_state.spindle_speed;
+    pl_data.spindle               = gc_state.modal.spindle;
+    pl_data.coolant               = gc_state.modal.coolant;
+    pl_data.feed_rate             = rate;
+    pl_data.motion.noFeedOverride = 1;
+    pl_data.is_jog                = true;
+    pl_data.line_number           = JOG_LINE_NUMBER;
+
+    float target[MAX_N_AXIS];
+    copyAxes(target, gc_state.position);
+    target[axis] = _target;
+    config->_kinematics->constrain_jog(target, &pl_data, gc_state.position);
+    if (fabsf(target[axis] - queuedAt) < mpgResolution) {
+        _target = queuedAt;  // At a soft limit, where more clicks would only wind up
+        return;
+    }
+    _target = target[axis];
+    if (!mc_linear(target, &pl_data, gc_state.position)) {
+        return;
+    }
+    copyAxes(gc_state.position, target);
+    _following = true;
+    _direction = direction;
+}
@@ -0,0 +1,73 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Mpg.h - a manual pulse generator handwheel, counted in hardware and jogged without g-code
+
+  A handwheel usually goes through a pendant that turns its clicks into $J= lines, which
+  are then parsed and planned, and cancelled whenever the wheel turns back.  An mpg
+  section counts the wheel's quadrature with a PCNT unit instead, and the main loop
+  queues the jog moves itself, as velocity jogging does:
+
+    mpg:
+      a_pin: gpio.34
+      b_pin: gpio.35
+      counts_per_click: 4
+      mm_per_click: 0.001
+      x10_pin: gpio.25:low:pu
+      x100_pin: gpio.26:low:pu
+      select_x_pin: gpio.27:low:pu
+      select_y_pin: gpio.14:low:pu
+      select_z_pin: gpio.12:low:pu
+
+  The select pins are the positions of the axis switch, and the wheel does nothing while
+  none of them is active.  Each click moves the selected axis by mm_per_click, times 10
+  or 100 while x10_pin or x100_pin is active, to an exact target, at the max rate of the
+  axis.  PCNT counts every edge, so counts_per_click is 4 for most wheels.
+
+  The wheel only jogs while the machine is idle or in a jog of its own.  Clicks further
+  ahead of the machine than it can travel in a quarter of a second are dropped, so a
+  fast spin does not leave it running on, and turning back cancels the jog, so the axis
+  reverses from where it can stop rather than at the end of what was queued.  The soft
+  limits clip the target.
+*/
+
+#include "Configuration/Configurable.h"
+#include "Config.h"  // MAX_N_AXIS
+#include "Pin.h"
+
+class Mpg : public Configuration::Configurable {
+public:
+    void init();
+
+    // Wakes the main loop when the wheel has turned.  Called by the polling task.
+    static void check();
+
+    // Queues the jog moves to the target of the clicks.  Called from the main loop.
+    void poll();
+
+    void validate() override;
+    void group(Configuration::HandlerBase& handler) override;
+
+private:
+    Pin   _aPin;
+    Pin   _bPin;
+    Pin   _x10Pin;
+    Pin   _x100Pin;
+    Pin   _selectPins[MAX_N_AXIS];
+    int   _countsPerClick = 4;
+    int   _filterNs       = 1000;  // Shorter glitches are not counted
+    float _mmPerClick     = 0.001f;
+
+    int     _axis       = -1;     // Selected axis, -1 for none
+    float   _target     = 0;      // Of the selected axis, in mm
+    int32_t _counts     = 0;      // Counts short of a whole click
+    int16_t _last       = 0;      // Raw count at the last poll
+    int8_t  _direction  = 0;      // Of the moves that are queued
+    bool    _following  = false;  // Moves to the target are queued
+    bool    _cancelling = false;  // Waiting for a jog cancel to stop the machine
+
+    int  selected_axis();
+    void cancel();
+};
@@ -9,6 +9,7 @@
 #include <string_view>
 
 #include "Pin.h"
+#include "FloatFormat.h"
 
 std::string IP_string(uint32_t ipaddr);
 
@@ -49,8 +50,14 @@ inline Print& operator<<(Print& lhs, uint64_t v) {
     return lhs;
 }
 
+// Floats are formatted like printf("%.*f") without the rounding drift of Print::print(float)
+inline void print_fixed(Print& stream, float v, int decimals) {
+    char buf[fixedFormatMax];
+    stream.write(reinterpret_cast<const uint8_t*>(buf), format_fixed(buf, v, decimals));
+}
+
 inline Print& operator<<(Print& lhs, float v) {
-    lhs.print(v, 3);
+    print_fixed(lhs, v, 3);
     return lhs;
 }
 
@@ -75,7 +82,7 @@ class setprecision {
 public:
     setprecision(int p) : precision(p) {}
 
-    inline void Write(Print& stream, float f) const { stream.print(f, precision); }
+    inline void Write(Print& stream, float f) const { print_fixed(stream, f, precision); }
     inline void Write(Print& stream, double d) const { stream.print(d, precision); }
 };
 
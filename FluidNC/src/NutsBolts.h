@@ -9,6 +9,7 @@
 #include <cstdint>
 #include "Logging.h"
 #include "Driver/delay_usecs.h"
+#include "ReadFloat.h"  // read_float()
 
 enum class DwellMode : uint8_t {
     Dwell      = 0,  // (Default: Must be zero)
@@ -50,11 +51,6 @@ const float INCH_PER_MM = (0.0393701f);
 #define bitnum_is_true(target, num) ((target & bitnum_to_mask(num)) != 0)
 #define bitnum_is_false(target, num) ((target & bitnum_to_mask(num)) == 0)
 
-// Read a floating point value from a string. Line points to the input buffer, char_counter
-// is the indexer pointing to the current character of the line, while float_ptr is
-// a pointer to the result variable. Returns true when it succeeds
-bool read_float(const char* line, size_t* char_counter, float* float_ptr);
-
 // Blocking delay for very short time intervals
 void delay_us(int32_t microseconds);
 
@@ -1,6 +1,7 @@
 #include "OLED.h"
 
 #include "Machine/MachineConfig.h"
+#include "Report.h"  // report_machine_status
 
 void OLED::show(Layout& layout, const char* msg) {
     if (_width < layout._width_required) {
@@ -80,6 +81,15 @@ void OLED::init() {
 
     _oled->display();
 
+    xTaskCreatePinnedToCore(displayTask,         // task
+                            "oled",              // name for task
+                            4096,                // size of task stack
+                            this,                // parameters
+                            OLED_TASK_PRIORITY,  // priority
+                            &_task,              // task handle
+                            OLED_TASK_CORE       // core
+    );
+
     allChannels.registration(this);
     setReportInterval(_report_interval_ms);
 }
@@ -133,7 +143,7 @@ void OLED::show_file() {
         show(percentLayout64, std::to_string(pct) + '%');
     }
 }
-void OLED::show_dro(const float* axes, bool isMpos, bool* limits) {
+void OLED::show_dro(const float* axes, bool isMpos, const bool* limits) {
     if (_state == "Alarm") {
         return;
     }
@@ -168,7 +178,6 @@ void OLED::show_dro(const float* axes, bool isMpos, bool* limits) {
         snprintf(axisVal, 20 - 1, "%.3f", axes[axis]);
         _oled->drawString((_width == 128) ? 60 : 63, oled_y_pos, axisVal);
     }
-    _oled->display();
 }
 
 void OLED::show_radio_info() {
@@ -190,167 +199,98 @@ void OLED::show_radio_info() {
     }
 }
 
-void OLED::parse_numbers(std::string s, float* nums, int maxnums) {
-    size_t pos     = 0;
-    size_t nextpos = -1;
-    size_t i;
-    do {
-        if (i >= maxnums) {
-            return;
-        }
-        nextpos   = s.find_first_of(",", pos);
-        auto num  = s.substr(pos, nextpos - pos);
-        nums[i++] = std::strtof(num.c_str(), nullptr);
-        pos       = nextpos + 1;
-    } while (nextpos != std::string::npos);
+void OLED::reportStatus() {
+    MachineStatus status;
+    report_machine_status(status);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _status = status;
+    _state  = status.stateName;
+    if (status.fileJob) {
+        _percent  = status.filePercent;
+        _filename = status.filename;
+    } else {
+        _filename.clear();
+    }
+    _status.filename = nullptr;  // It is only valid while the job runs, so the task uses _filename
+    wake(Screen::None);
 }
 
-void OLED::parse_axes(std::string s, float* axes) {
-    size_t pos     = 0;
-    size_t nextpos = -1;
-    size_t axis    = 0;
-    do {
-        nextpos  = s.find_first_of(",", pos);
-        auto num = s.substr(pos, nextpos - pos);
-        if (axis < MAX_N_AXIS) {
-            axes[axis++] = std::strtof(num.c_str(), nullptr);
-        }
-        pos = nextpos + 1;
-    } while (nextpos != std::string::npos);
+// Called with _mutex held.  Screen::None asks for the status screen.
+void OLED::wake(Screen screen) {
+    if (screen == Screen::None) {
+        _statusDirty = true;
+    } else {
+        _screen = screen;
+    }
+    xTaskNotifyGive(_task);
 }
 
-void OLED::parse_status_report() {
-    if (_report.back() == '>') {
-        _report.pop_back();
+void OLED::draw_status() {
+    _oled->clear();
+    show_state();
+    show_file();
+    show_limits(_status.probe, _status.limits);
+    show_dro(_status.position, _status.isMpos, _status.limits);
+    show_radio_info();
+}
+
+void OLED::draw_screen(Screen screen) {
+    auto fh = font_height(ArialMT_Plain_10);
+    _oled->clear();
+    switch (screen) {
+        case Screen::STA:
+        case Screen::BT:
+            wrapped_draw_string(0, _radio_info, ArialMT_Plain_10);
+            break;
+        case Screen::IP:
+        case Screen::AP:
+            wrapped_draw_string(0, _radio_info, ArialMT_Plain_10);
+            wrapped_draw_string(fh * 2, _radio_addr, ArialMT_Plain_10);
+            break;
+        case Screen::WebUI:
+            wrapped_draw_string(0, "WebUI from", ArialMT_Plain_10);
+            wrapped_draw_string(fh * 2, _webui_addr, ArialMT_Plain_10);
+            break;
+        default:
+            break;
     }
-    // Now the string is a sequence of field|field|field
-    size_t pos     = 0;
-    auto   nextpos = _report.find_first_of("|", pos);
-    _state         = _report.substr(pos + 1, nextpos - pos - 1);
-
-    bool probe              = false;
-    bool limits[MAX_N_AXIS] = { false };
-
-    float axes[MAX_N_AXIS];
-    bool  isMpos = false;
-    _filename    = "";
-
-    // ... handle it
-    while (nextpos != std::string::npos) {
-        pos        = nextpos + 1;
-        nextpos    = _report.find_first_of("|", pos);
-        auto field = _report.substr(pos, nextpos - pos);
-        // MPos:, WPos:, Bf:, Ln:, FS:, Pn:, WCO:, Ov:, A:, SD: (ISRs:, Heap:)
-        auto colon = field.find_first_of(":");
-        auto tag   = field.substr(0, colon);
-        auto value = field.substr(colon + 1);
-        if (tag == "MPos") {
-            // x,y,z,...
-            parse_axes(value, axes);
-            isMpos = true;
-            continue;
-        }
-        if (tag == "WPos") {
-            // x,y,z...
-            parse_axes(value, axes);
-            isMpos = false;
-            continue;
-        }
-        if (tag == "Bf") {
-            // buf_avail,rx_avail
-            continue;
-        }
-        if (tag == "Ln") {
-            // n
-            auto linenum = std::strtol(value.c_str(), nullptr, 10);
-            continue;
-        }
-        if (tag == "FS") {
-            // feedrate,spindle_speed
-            float fs[2];
-            parse_numbers(value, fs, 2);  // feed in [0], spindle in [1]
-            continue;
-        }
-        if (tag == "Pn") {
-            // PXxYy etc
-            for (char const& c : value) {
-                switch (c) {
-                    case 'P':
-                        probe = true;
-                        break;
-                    case 'X':
-                        limits[X_AXIS] = true;
-                        break;
-                    case 'Y':
-                        limits[Y_AXIS] = true;
-                        break;
-                    case 'Z':
-                        limits[Z_AXIS] = true;
-                        break;
-                    case 'A':
-                        limits[A_AXIS] = true;
-                        break;
-                    case 'B':
-                        limits[B_AXIS] = true;
-                        break;
-                    case 'C':
-                        limits[C_AXIS] = true;
-                        break;
-                }
-                continue;
-            }
-        }
-        if (tag == "WCO") {
-            // x,y,z,...
-            // We do not use the WCO values because the DROs show whichever
-            // position is in the status report
-            // float wcos[MAX_N_AXIS];
-            // auto  wcos = parse_axes(value, wcos);
+}
+
+// Draws whatever was asked for last and sends it.  A radio screen goes first, and the
+// IP, AP and BT screens stay up for radio_delay_ms before anything replaces them.
+void OLED::displayTask(void* arg) {
+    auto       self = static_cast<OLED*>(arg);
+    TickType_t wait = portMAX_DELAY;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        std::unique_lock<std::mutex> lock(self->_mutex);
+        if (self->_screen == Screen::None && !self->_statusDirty) {
+            wait = portMAX_DELAY;
             continue;
         }
-        if (tag == "Ov") {
-            // feed_ovr,rapid_ovr,spindle_ovr
-            float frs[3];
-            parse_numbers(value, frs, 3);  // feed in [0], rapid in [1], spindle in [2]
+        TickType_t now = xTaskGetTickCount();
+        if (int32_t(self->_holdUntil - now) > 0) {
+            wait = self->_holdUntil - now;
             continue;
         }
-        if (tag == "A") {
-            // SCFM
-            int  spindle = 0;
-            bool flood   = false;
-            bool mist    = false;
-            for (char const& c : value) {
-                switch (c) {
-                    case 'S':
-                        spindle = 1;
-                        break;
-                    case 'C':
-                        spindle = 2;
-                        break;
-                    case 'F':
-                        flood = true;
-                        break;
-                    case 'M':
-                        mist = true;
-                        break;
-                }
+        Screen screen = self->_screen;
+        if (screen != Screen::None) {
+            self->draw_screen(screen);
+            self->_screen = Screen::None;
+            if (screen == Screen::IP || screen == Screen::AP || screen == Screen::BT) {
+                self->_holdUntil = now + self->_radio_delay / portTICK_PERIOD_MS;
             }
-            continue;
-        }
-        if (tag == "SD") {
-            auto commaPos = value.find_first_of(",");
-            _percent      = std::strtof(value.substr(0, commaPos).c_str(), nullptr);
-            _filename     = value.substr(commaPos + 1);
-            continue;
+        } else {
+            self->draw_status();
+            self->_statusDirty = false;
         }
+        lock.unlock();
+
+        self->_oled->display();
+        wait = 0;  // Look again for what came in meanwhile
     }
-    _oled->clear();
-    show_state();
-    show_file();
-    show_limits(probe, limits);
-    show_dro(axes, isMpos, limits);
-    show_radio_info();
-    _oled->display();
 }
 
 void OLED::parse_gcode_report() {
@@ -387,25 +327,19 @@ void OLED::parse_gcode_report() {
 // [MSG:INFO: Connecting to STA:SSID foo]
 void OLED::parse_STA() {
     size_t start = strlen("[MSG:INFO: Connecting to STA SSID:");
-    _radio_info  = _report.substr(start, _report.size() - start - 1);
 
-    _oled->clear();
-    auto fh = font_height(ArialMT_Plain_10);
-    wrapped_draw_string(0, _radio_info, ArialMT_Plain_10);
-    _oled->display();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _radio_info = _report.substr(start, _report.size() - start - 1);
+    wake(Screen::STA);
 }
 
 // [MSG:INFO: Connected - IP is 192.168.68.134]
 void OLED::parse_IP() {
     size_t start = _report.rfind(" ") + 1;
-    _radio_addr  = _report.substr(start, _report.size() - start - 1);
 
-    _oled->clear();
-    auto fh = font_height(ArialMT_Plain_10);
-    wrapped_draw_string(0, _radio_info, ArialMT_Plain_10);
-    wrapped_draw_string(fh * 2, _radio_addr, ArialMT_Plain_10);
-    _oled->display();
-    delay_msec(_radio_delay);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _radio_addr = _report.substr(start, _report.size() - start - 1);
+    wake(Screen::IP);
 }
 
 // [MSG:INFO: AP SSID foo IP 192.168.68.134 mask foo channel foo]
@@ -415,49 +349,35 @@ void OLED::parse_AP() {
     size_t ip_end   = _report.rfind(" mask ");
     size_t ip_start = ssid_end + strlen(" IP ");
 
+    std::lock_guard<std::mutex> lock(_mutex);
     _radio_info = "AP: ";
     _radio_info += _report.substr(start, ssid_end - start);
     _radio_addr = _report.substr(ip_start, ip_end - ip_start);
-
-    _oled->clear();
-    auto fh = font_height(ArialMT_Plain_10);
-    wrapped_draw_string(0, _radio_info, ArialMT_Plain_10);
-    wrapped_draw_string(fh * 2, _radio_addr, ArialMT_Plain_10);
-    _oled->display();
-    delay_msec(_radio_delay);
+    wake(Screen::AP);
 }
 
 void OLED::parse_BT() {
     size_t      start  = strlen("[MSG:INFO: BT Started with ");
     std::string btname = _report.substr(start, _report.size() - start - 1);
-    _radio_info        = "BT: ";
-    _radio_info += btname.c_str();
 
-    _oled->clear();
-    wrapped_draw_string(0, _radio_info, ArialMT_Plain_10);
-    _oled->display();
-    delay_msec(_radio_delay);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _radio_info = "BT: ";
+    _radio_info += btname.c_str();
+    wake(Screen::BT);
 }
 
 void OLED::parse_WebUI() {
-    size_t      start  = strlen("[MSG:INFO: WebUI: Request from ");
-    std::string ipaddr = _report.substr(start, _report.size() - start - 1);
+    size_t start = strlen("[MSG:INFO: WebUI: Request from ");
 
-    _oled->clear();
-    auto fh = font_height(ArialMT_Plain_10);
-    wrapped_draw_string(0, "WebUI from", ArialMT_Plain_10);
-    wrapped_draw_string(fh * 2, ipaddr, ArialMT_Plain_10);
-    _oled->display();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _webui_addr = _report.substr(start, _report.size() - start - 1);
+    wake(Screen::WebUI);
 }
 
 void OLED::parse_report() {
     if (_report.length() == 0) {
         return;
     }
-    if (_report.rfind("<", 0) == 0) {
-        parse_status_report();
-        return;
-    }
     if (_report.rfind("[GC:", 0) == 0) {
         parse_gcode_report();
         return;
@@ -5,8 +5,13 @@
 #include "Configuration/Configurable.h"
 
 #include "Channel.h"
+#include "Report.h"  // MachineStatus
 #include "SSD1306_I2C.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mutex>
+
 typedef const uint8_t* font_t;
 
 class OLED : public Channel, public Configuration::Configurable {
@@ -32,8 +37,28 @@ public:
 private:
     std::string _report;
 
+    // The channel side only records what is to be shown and wakes the display task, which
+    // draws it and sends the pages that changed, so neither waits for the I2C bus.  The
+    // mutex guards everything below up to _ticker, which the task reads while it draws.
+    enum class Screen : uint8_t {
+        None,
+        STA,
+        IP,
+        AP,
+        BT,
+        WebUI,
+    };
+    std::mutex   _mutex;
+    TaskHandle_t _task        = nullptr;
+    Screen       _screen      = Screen::None;  // A radio screen to show before the next status
+    bool         _statusDirty = false;
+    TickType_t   _holdUntil   = 0;  // A radio screen stays up until then
+
+    MachineStatus _status;
+
     std::string _radio_info;
     std::string _radio_addr;
+    std::string _webui_addr;
 
     std::string _state;
     std::string _filename;
@@ -46,8 +71,13 @@ private:
 
     uint8_t _i2c_num = 0;
 
+    static void displayTask(void* arg);
+    void        draw_screen(Screen screen);
+    void        draw_status();
+
+    void wake(Screen screen);
+
     void parse_report();
-    void parse_status_report();
     void parse_gcode_report();
     void parse_STA();
     void parse_IP();
@@ -55,13 +85,10 @@ private:
     void parse_BT();
     void parse_WebUI();
 
-    void parse_axes(std::string s, float* axes);
-    void parse_numbers(std::string s, float* nums, int maxnums);
-
     void show_limits(bool probe, const bool* limits);
     void show_state();
     void show_file();
-    void show_dro(const float* axes, bool isMpos, bool* limits);
+    void show_dro(const float* axes, bool isMpos, const bool* limits);
     void show_radio_info();
     void draw_checkbox(int16_t x, int16_t y, int16_t width, int16_t height, bool checked);
 
@@ -108,6 +135,8 @@ public:
     Channel* pollLine(char* line) override;
     void     flushRx() override {}
 
+    void reportStatus() override;
+
     bool   lineComplete(char*, char) override { return false; }
     size_t timedReadBytes(char* buffer, size_t length, TickType_t timeout) override { return 0; }
 
@@ -0,0 +1,505 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "OWord.h"
+#include "Expression.h"
+#include "GCode.h"     // gc_execute_line(), gc_compile_line(), collapseGCode()
+#include "Protocol.h"  // protocol_execute_realtime(), LINE_BUFFER_SIZE
+#include "System.h"    // sys.abort
+#include "Logging.h"
+#include "FileCache.h"
+#include "FluidPath.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace OWord {
+    enum class Kind : uint8_t {
+        Line,  // Not an O-word
+        Sub,
+        EndSub,
+        Call,
+        Return,
+        Do,
+        While,
+        DoWhile,  // The while that closes a do
+        EndWhile,
+        If,
+        ElseIf,
+        Else,
+        EndIf,
+        Repeat,
+        EndRepeat,
+        Break,
+        Continue,
+    };
+
+    struct Keyword {
+        const char* name;
+        Kind        kind;
+    };
+
+    // ELSEIF before ELSE, for the first match to be the right one
+    static const Keyword keywords[] = {
+        { "ENDSUB", Kind::EndSub },   { "ENDWHILE", Kind::EndWhile }, { "ENDIF", Kind::EndIf },   { "ENDREPEAT", Kind::EndRepeat },
+        { "ELSEIF", Kind::ElseIf },   { "ELSE", Kind::Else },         { "SUB", Kind::Sub },       { "CALL", Kind::Call },
+        { "RETURN", Kind::Return },   { "DO", Kind::Do },             { "WHILE", Kind::While },   { "IF", Kind::If },
+        { "REPEAT", Kind::Repeat },   { "BREAK", Kind::Break },       { "CONTINUE", Kind::Continue },
+    };
+
+    struct Op {
+        Kind        kind;
+        std::string label;     // Of an O-word, as 100 or <NAME>
+        std::string text;      // The line, or what follows the keyword
+        std::string compiled;  // The line from gc_compile_line(), if it compiled
+        int         match = -1;  // Where this one jumps to, or the block it closes or leaves
+        int         end   = -1;  // Of an if, elseif or else, the endif
+    };
+
+    using Block    = std::vector<Op>;
+    using BlockPtr = std::shared_ptr<const Block>;
+
+    static const size_t maxOps = 1000;  // In a block that is being received
+
+    struct Sub {
+        BlockPtr          block;
+        FileCache::data_t source;  // The file it came from, if it did
+        uint32_t          checked;  // The generation in which the file was last checked
+    };
+    static std::map<std::string, Sub> subs;
+
+    // Once per O-word at the top level, so that the file of a subroutine is looked at
+    // once for each block that calls it, and not for every call in a loop
+    static uint32_t generation = 0;
+
+    static Error parse(const char* line, Op& op) {
+        if (line[0] != 'O') {
+            char   compiled[2 + maxCompiledWords * compiledWordSize];
+            size_t length = gc_compile_line(line, compiled);
+            op.kind       = Kind::Line;
+            op.text       = line;
+            op.compiled.assign(compiled, length);
+            return Error::Ok;
+        }
+        const char* start = line + 1;
+        const char* p     = start;
+        if (*p == '<') {
+            if (!(p = strchr(p, '>'))) {
+                return Error::FlowControlSyntaxError;
+            }
+            ++p;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                ++p;
+            }
+        }
+        if (p == start) {
+            return Error::FlowControlSyntaxError;
+        }
+        op.label.assign(start, p);
+        for (auto& keyword : keywords) {
+            size_t length = strlen(keyword.name);
+            if (!strncmp(p, keyword.name, length)) {
+                op.kind = keyword.kind;
+                op.text = p + length;
+                return Error::Ok;
+            }
+        }
+        return Error::FlowControlSyntaxError;
+    }
+
+    // Collects the ops of a block, linking each O-word to the ones it jumps to, until the
+    // O-word that closes the one that opened it
+    class Recorder {
+        std::vector<size_t> _open;  // The ops whose blocks are open
+
+        // The innermost open block with the label and one of the kinds, or -1
+        int find(const std::string& label, Kind a, Kind b = Kind::Line, Kind c = Kind::Line) {
+            for (auto it = _open.rbegin(); it != _open.rend(); ++it) {
+                const Op& op = _ops[*it];
+                if (op.label == label && (op.kind == a || op.kind == b || op.kind == c)) {
+                    return *it;
+                }
+            }
+            return -1;
+        }
+
+        Error close(Op& op, Kind opener) {
+            if (_open.empty() || _ops[_open.back()].kind != opener || _ops[_open.back()].label != op.label) {
+                return Error::FlowControlSyntaxError;
+            }
+            op.match                 = _open.back();
+            _ops[_open.back()].match = _ops.size();
+            _open.pop_back();
+            return Error::Ok;
+        }
+
+    public:
+        Block _ops;
+
+        bool active() { return !_open.empty(); }
+
+        void clear() {
+            _ops.clear();
+            _open.clear();
+        }
+
+        // Sets complete when op closes the outermost block
+        Error add(Op&& op, bool& complete) {
+            complete  = false;
+            int index = _ops.size();
+            if (index == maxOps) {
+                log_error("O-word block has more than " << maxOps << " lines");
+                return Error::FlowControlSyntaxError;
+            }
+            Error err = Error::Ok;
+            switch (op.kind) {
+                case Kind::Line:
+                case Kind::Call:
+                    break;
+                case Kind::While:
+                    if (!_open.empty() && _ops[_open.back()].kind == Kind::Do && _ops[_open.back()].label == op.label) {
+                        op.kind = Kind::DoWhile;
+                        err     = close(op, Kind::Do);
+                        break;
+                    }
+                    // Fall through
+                case Kind::Sub:
+                case Kind::Do:
+                case Kind::Repeat:
+                    _open.push_back(index);
+                    break;
+                case Kind::If:
+                    op.end = index;  // The last branch, until the endif
+                    _open.push_back(index);
+                    break;
+                case Kind::ElseIf:
+                case Kind::Else:
+                case Kind::EndIf: {
+                    if (_open.empty() || _ops[_open.back()].kind != Kind::If || _ops[_open.back()].label != op.label) {
+                        return Error::FlowControlSyntaxError;
+                    }
+                    Op& opener = _ops[_open.back()];
+                    Op& last   = _ops[opener.end];
+                    if (last.kind == Kind::Else && op.kind != Kind::EndIf) {
+                        return Error::FlowControlSyntaxError;  // Nothing can follow the else
+                    }
+                    last.match = index;
+                    opener.end = index;
+                    if (op.kind == Kind::EndIf) {
+                        for (int branch = _open.back(); branch != index; branch = _ops[branch].match) {
+                            _ops[branch].end = index;
+                        }
+                        _open.pop_back();
+                    }
+                    break;
+                }
+                case Kind::EndSub:
+                    err = close(op, Kind::Sub);
+                    break;
+                case Kind::EndWhile:
+                    err = close(op, Kind::While);
+                    break;
+                case Kind::EndRepeat:
+                    err = close(op, Kind::Repeat);
+                    break;
+                case Kind::Return:
+                    if ((op.match = find(op.label, Kind::Sub)) < 0) {
+                        return Error::FlowControlSyntaxError;
+                    }
+                    break;
+                case Kind::Break:
+                case Kind::Continue:
+                    if ((op.match = find(op.label, Kind::While, Kind::Do, Kind::Repeat)) < 0) {
+                        return Error::FlowControlSyntaxError;
+                    }
+                    break;
+                case Kind::DoWhile:
+                    break;  // Only made above
+            }
+            if (err == Error::Ok) {
+                _ops.push_back(std::move(op));
+                complete = _open.empty();
+            }
+            return err;
+        }
+    };
+
+    static Recorder recorder;
+
+    static void define(Block&& block, FileCache::data_t source) {
+        std::string label = block[0].label;
+        subs[label]       = { std::make_shared<const Block>(std::move(block)), source, generation };
+    }
+
+    // Defines the subroutines in the lines of text, a file of them
+    static Error define_all(const std::string& text, const FileCache::data_t& source) {
+        Recorder file;
+        size_t   start = 0;
+        while (start < text.length()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) {
+                end = text.length();
+            }
+            char line[LINE_BUFFER_SIZE];
+            snprintf(line, sizeof(line), "%.*s", int(end - start), text.c_str() + start);
+            start = end + 1;
+            collapseGCode(line);
+            if (!file.active() && line[0] != 'O') {
+                continue;  // Like a % or a comment between the subroutines
+            }
+            Op    op;
+            bool  complete;
+            Error err = parse(line, op);
+            if (err == Error::Ok && !file.active() && op.kind != Kind::Sub) {
+                err = Error::FlowControlSyntaxError;
+            }
+            if (err != Error::Ok || (err = file.add(std::move(op), complete)) != Error::Ok) {
+                log_error("Subroutine file: " << errorString(err) << " at " << line);
+                return err;
+            }
+            if (complete) {
+                define(std::move(file._ops), source);
+                file.clear();
+            }
+        }
+        return file.active() ? Error::FlowControlSyntaxError : Error::Ok;
+    }
+
+    // A subroutine that is not defined can come from <name>.ngc on the local file system,
+    // and one that came from there is read again when the file has changed
+    static const Block* find_sub(const std::string& label) {
+        auto it = subs.find(label);
+        if (it != subs.end() && (!it->second.source || it->second.checked == generation)) {
+            return it->second.block.get();
+        }
+        if (label[0] == '<') {
+            std::string name = label.substr(1, label.length() - 2);
+            for (auto& c : name) {
+                c = tolower(c);
+            }
+            name += ".ngc";
+            std::error_code ec;
+            FluidPath       fpath { name, localfsName, ec };
+            bool            hit;
+            auto            source = ec ? nullptr : FileCache::get(fpath, hit);
+            if (source && it != subs.end() && it->second.source == source) {
+                it->second.checked = generation;
+            } else if (source) {
+                define_all(*source, source);
+            }
+        }
+        it = subs.find(label);
+        return it == subs.end() ? nullptr : it->second.block.get();
+    }
+
+    static Error evaluate(const Op& op, float& value) {
+        size_t pos = 0;
+        Error  err = Expression::read_value(op.text.c_str(), &pos, &value);
+        if (err == Error::Ok && op.text[pos]) {
+            err = Error::ExpressionSyntaxError;
+        }
+        return err;
+    }
+
+    static Error execute(const Op& op) {
+        if (!op.compiled.empty()) {
+            return gc_execute_compiled(op.compiled.data());
+        }
+        char line[LINE_BUFFER_SIZE];
+        snprintf(line, sizeof(line), "%s", op.text.c_str());
+        return gc_execute_line(line);
+    }
+
+    static Error run(const Block& ops, size_t pc, size_t end);
+
+    static Error call(const Op& op) {
+        float       args[Expression::nLocals];
+        size_t      nArgs = 0;
+        const char* text  = op.text.c_str();
+        size_t      pos   = 0;
+        while (text[pos]) {
+            if (nArgs == Expression::nLocals) {
+                return Error::FlowControlSyntaxError;
+            }
+            Error err = Expression::read_value(text, &pos, &args[nArgs++]);
+            if (err != Error::Ok) {
+                return err;
+            }
+        }
+        const Block* sub = find_sub(op.label);
+        if (!sub) {
+            log_error("Subroutine O" << op.label << " is not defined");
+            return Error::FlowControlUnknownSub;
+        }
+        if (!Expression::push_frame(args, nArgs)) {
+            return Error::FlowControlTooDeep;
+        }
+        BlockPtr hold = subs[op.label].block;  // In case the subroutine is defined again while it runs
+        Error    err  = run(*sub, 1, sub->size());
+        Expression::pop_frame();
+        return err;
+    }
+
+    // Runs ops[pc] up to ops[end], following the jumps
+    static Error run(const Block& ops, size_t pc, size_t end) {
+        std::map<size_t, int32_t> counts;  // Of the repeats that are running
+        while (pc < end) {
+            const Op& op   = ops[pc];
+            Error     err  = Error::Ok;
+            bool      back = false;  // A jump back, around a loop
+            float     value;
+            switch (op.kind) {
+                case Kind::Line:
+                    err = execute(op);
+                    ++pc;
+                    break;
+                case Kind::Sub: {
+                    // Defined where it is met, with its jumps made relative to its start
+                    Block block(ops.begin() + pc, ops.begin() + op.match + 1);
+                    for (auto& sop : block) {
+                        if (sop.match >= 0) {
+                            sop.match -= pc;
+                        }
+                        if (sop.end >= 0) {
+                            sop.end -= pc;
+                        }
+                    }
+                    define(std::move(block), nullptr);
+                    pc = op.match + 1;
+                    break;
+                }
+                case Kind::Call:
+                    err = call(op);
+                    ++pc;
+                    break;
+                case Kind::Return:
+                case Kind::EndSub:
+                    if (!op.text.empty() && (err = evaluate(op, value)) == Error::Ok) {
+                        Expression::set("_VALUE", value);
+                    }
+                    return err;
+                case Kind::Do:
+                case Kind::EndIf:
+                    ++pc;
+                    break;
+                case Kind::While:
+                    if ((err = evaluate(op, value)) == Error::Ok) {
+                        pc = value != 0 ? pc + 1 : op.match + 1;
+                    }
+                    break;
+                case Kind::DoWhile:
+                    if ((err = evaluate(op, value)) == Error::Ok) {
+                        back = value != 0;
+                        pc   = back ? op.match + 1 : pc + 1;
+                    }
+                    break;
+                case Kind::EndWhile:
+                    pc   = op.match;
+                    back = true;
+                    break;
+                case Kind::If:
+                    // Tests each branch until one is taken, or the else or endif is reached
+                    for (size_t branch = pc;; branch = ops[branch].match) {
+                        const Op& test = ops[branch];
+                        if (test.kind == Kind::Else || test.kind == Kind::EndIf) {
+                            pc = branch + 1;
+                            break;
+                        }
+                        if ((err = evaluate(test, value)) != Error::Ok || value != 0) {
+                            pc = branch + 1;
+                            break;
+                        }
+                    }
+                    break;
+                case Kind::ElseIf:
+                case Kind::Else:
+                    pc = op.end + 1;  // The branch before this one was taken
+                    break;
+                case Kind::Repeat:
+                    if ((err = evaluate(op, value)) == Error::Ok) {
+                        counts[pc] = lroundf(value);
+                        pc         = counts[pc] > 0 ? pc + 1 : op.match + 1;
+                    }
+                    break;
+                case Kind::EndRepeat:
+                    back = --counts[op.match] > 0;
+                    pc   = back ? op.match + 1 : pc + 1;
+                    break;
+                case Kind::Break:
+                    pc = ops[op.match].match + 1;  // Past the endwhile, endrepeat or closing while
+                    break;
+                case Kind::Continue:
+                    // A while tests again, a do goes to its closing while and a repeat counts
+                    pc   = ops[op.match].kind == Kind::While ? op.match : ops[op.match].match;
+                    back = true;
+                    break;
+            }
+            if (err != Error::Ok) {
+                log_info("Stopped at " << (op.kind == Kind::Line ? op.text : "O" + op.label));
+                return err;
+            }
+            if (back) {
+                // A loop whose body only sets parameters never waits for the planner,
+                // which is where realtime commands are otherwise handled
+                protocol_execute_realtime();
+            }
+            if (sys.abort) {
+                return Error::Reset;
+            }
+        }
+        return Error::Ok;
+    }
+
+    bool handle(const char* line, Error& status) {
+        if (line[0] == '$' || (line[0] != 'O' && !recorder.active())) {
+            return false;
+        }
+        Op op;
+        if ((status = parse(line, op)) != Error::Ok) {
+            recorder.clear();
+            return true;
+        }
+        if (!recorder.active()) {
+            ++generation;
+            switch (op.kind) {
+                case Kind::Call:
+                    status = call(op);
+                    return true;
+                case Kind::Sub:
+                case Kind::Do:
+                case Kind::While:
+                case Kind::If:
+                case Kind::Repeat:
+                    break;
+                default:
+                    status = Error::FlowControlSyntaxError;  // Closes or leaves a block that is not open
+                    return true;
+            }
+        }
+        bool complete;
+        if ((status = recorder.add(std::move(op), complete)) != Error::Ok) {
+            recorder.clear();
+            return true;
+        }
+        if (complete) {
+            Block ops = std::move(recorder._ops);
+            recorder.clear();
+            if (ops[0].kind == Kind::Sub) {
+                define(std::move(ops), nullptr);
+            } else {
+                status = run(ops, 0, ops.size());
+            }
+        }
+        return true;
+    }
+
+    bool recording() { return recorder.active(); }
+
+    void reset() {
+        recorder.clear();
+        Expression::reset();
+    }
+}
@@ -0,0 +1,41 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  OWord.h - LinuxCNC-style O-word subroutines and flow control
+
+    O100 sub                 O<name> sub ... O<name> endsub [value]
+      G0 X#1 Y#2             O<name> call [arg1] [arg2] ...
+    O100 endsub              O101 while [cond] ... O101 endwhile
+    O101 repeat [4]          O102 do ... O102 while [cond]
+      O100 call [#3] [0]     O103 if [cond] ... O103 elseif [cond] ... O103 else ... O103 endif
+      #3 = [#3 + 10]         O104 break, O104 continue, inside loop O104
+    O101 endrepeat           O100 return [value], inside subroutine O100
+
+  The lines of a block, from the O-word that opens it to the one that closes it, are kept
+  as they arrive, from a file or from a sender, and nothing runs until the block is
+  complete.  A subroutine is then added to the cache of subroutines, and the other blocks
+  run from memory.  Each line of a block is parsed once: the O-words are linked to the
+  ones they jump to, and plain g-code lines are compiled by gc_compile_line(), so a loop
+  does the text processing of its body only once, however often it goes around.
+
+  A call to a subroutine that has not been defined looks for <name>.ngc at the top of the
+  local file system, as O<name> sub ... O<name> endsub, and keeps it in the cache while
+  the file is unchanged.  The value of a return or endsub is left in #<_value>.
+*/
+
+#include "Error.h"
+
+namespace OWord {
+    // Takes the lines that are O-words, or that belong to a block that is not yet
+    // complete, returning true with the result in status.  Returns false for a line that
+    // is not for it.  The line is collapsed.
+    bool handle(const char* line, Error& status);
+
+    // A block is being received, so lines must go to handle() as text
+    bool recording();
+
+    // Drops a block that was being received, after a reset
+    void reset();
+}
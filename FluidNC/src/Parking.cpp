@@ -7,13 +7,24 @@
 #include "Machine/MachineConfig.h"  // config
 #include "Spindles/Spindle.h"       // spindle
 
-// Plans and executes the single special motion case for parking. Independent of main planner buffer.
-// NOTE: Uses the always free planner ring buffer head to store motion parameters for execution.
-void Parking::moveto(float* target) {
+// Queues a parking move with the current plan_data.  Independent of main planner buffer.
+// The moves queued together are planned as one motion and run by run().
+void Parking::queue(float* target) {
     if (sys.abort) {
         return;  // Block during abort.
     }
-    if (plan_buffer_line(target, &plan_data)) {
+    queued = plan_buffer_park_line(target, &plan_data) || queued;
+}
+
+// Executes the queued moves, blended at their junctions.  When spin_down is set, the spindle
+// is stopped as the tool passes the pullout waypoint, without stopping the motion for it.
+void Parking::run(bool spin_down) {
+    if (sys.abort) {
+        plan_reset_park_queue();
+        return;  // Block during abort.
+    }
+    if (queued) {
+        queued                            = false;
         sys.step_control.executeSysMotion = true;
         sys.step_control.endMotion        = false;  // Allow parking motion to execute, if feed hold is active.
         Stepper::parking_setup_buffer();            // Setup step segment buffer for special parking motion case
@@ -22,9 +33,15 @@ void Parking::moveto(float* target) {
         do {
             protocol_exec_rt_system();
             if (sys.abort) {
+                plan_reset_park_queue();
                 return;
             }
+            if (spin_down && get_mpos()[_axis] >= retract_waypoint) {
+                spin_down = false;
+                spindle->spinDown();
+            }
         } while (sys.step_control.executeSysMotion);
+        plan_reset_park_queue();            // A hold leaves the rest of the moves
         Stepper::parking_restore_buffer();  // Restore step segment buffer to normal run state.
     } else {
         sys.step_control.executeSysMotion = false;
@@ -32,6 +49,11 @@ void Parking::moveto(float* target) {
     }
 }
 
+void Parking::moveto(float* target) {
+    queue(target);
+    run();
+}
+
 bool Parking::can_park() {
     if (!_enable) {
         return false;
@@ -91,16 +113,25 @@ void Parking::park(bool restart) {
     }
 
     if (can_park() && parking_target[_axis] < _target_mpos) {
+        // A spindle that stops at once is stopped during the parking motion, so the pullout
+        // can run straight on into it.  Otherwise the motion waits for it to spin down.
+        bool blend = spindle->_spindown_ms == 0 || saved_spindle == SpindleState::Disable;
+
         // Retract spindle by pullout distance. Ensure retraction motion moves away from
         // the workpiece and waypoint motion doesn't exceed the parking target location.
-        if (parking_target[_axis] < retract_waypoint) {
+        bool pullout = parking_target[_axis] < retract_waypoint;
+        if (pullout) {
             log_debug("Parking pullout");
             parking_target[_axis]   = retract_waypoint;
             plan_data.feed_rate     = _pullout_rate;
             plan_data.coolant       = saved_coolant;
             plan_data.spindle       = saved_spindle;
             plan_data.spindle_speed = saved_spindle_speed;
-            moveto(parking_target);
+            if (blend) {
+                queue(parking_target);
+            } else {
+                moveto(parking_target);
+            }
         }
 
         // NOTE: Clear accessory state after retract and after an aborted restore motion.
@@ -111,8 +142,10 @@ void Parking::park(bool restart) {
         plan_data.motion.noFeedOverride = 1;
         plan_data.spindle_speed         = 0.0;
 
-        log_debug("Spin down");
-        spindle->spinDown();
+        if (!(blend && pullout)) {
+            log_debug("Spin down");
+            spindle->spinDown();
+        }
         report_ovr_counter = 0;  // Set to report change immediately
 
         // Execute fast parking retract motion to parking target location.
@@ -120,7 +153,11 @@ void Parking::park(bool restart) {
             log_debug("Parking motion");
             parking_target[_axis] = _target_mpos;
             plan_data.feed_rate   = _rate;
-            moveto(parking_target);
+            queue(parking_target);
+        }
+        run(blend && pullout);
+        if (blend && pullout && spindle->_current_state != SpindleState::Disable) {
+            spindle->spinDown();  // The motion ended before the waypoint
         }
     } else {
         log_debug("Spin down only");
@@ -134,13 +171,21 @@ void Parking::park(bool restart) {
 void Parking::unpark(bool restart) {
     // Execute fast restore motion to the pull-out position. Parking requires homing enabled.
     // NOTE: State is will remain DOOR, until the de-energizing and retract is complete.
+    // With nothing to restart at the pull-out position, the return runs straight on into
+    // the plunge.
+    bool blend = !restart && gc_state.modal.spindle == SpindleState::Disable && !gc_state.modal.coolant.Flood &&
+                 !gc_state.modal.coolant.Mist;
     if (can_park()) {
         // Check to ensure the motion doesn't move below pull-out position.
         if (parking_target[_axis] <= _target_mpos) {
             log_debug("Parking return to pullout position");
             parking_target[_axis] = retract_waypoint;
             plan_data.feed_rate   = _rate;
-            moveto(parking_target);
+            if (blend) {
+                queue(parking_target);
+            } else {
+                moveto(parking_target);
+            }
         }
     }
 
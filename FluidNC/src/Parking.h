@@ -35,6 +35,10 @@ private:
 
     plan_block_t* block;
 
+    bool queued = false;  // Parking moves are waiting for run()
+
+    void queue(float* target);
+    void run(bool spin_down = false);
     void moveto(float* target);
 
     bool can_park();
@@ -42,6 +46,8 @@ private:
 public:
     Parking() {}
 
+    bool enabled() const { return _enable; }
+
     void setup();       // Called when suspend start
     void set_target();  // Called when motion has stopped after suspend
 
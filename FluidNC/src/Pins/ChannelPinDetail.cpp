@@ -27,12 +27,8 @@ namespace Pins {
         if (high == _value) {
             return;
         }
-        _value        = high;
-        std::string s = "io.";
-        s += std::to_string(_index);
-        s += "=";
-        s += std::to_string(high);
-        _channel->out(s, "SET:");
+        _value = high;
+        _channel->writePin(_index, high);
     }
     int  ChannelPinDetail::read() { return _value; }
     void ChannelPinDetail::setAttr(PinAttributes attr) {
@@ -181,8 +181,17 @@ namespace Pins {
         obj->trigger(active);
     }
 
+    // Called from the edge interrupt of pins whose EventPin is _edgeDriven
+    void GPIOPinDetail::gpioEdgeAction(int gpio_num, void* arg, bool active) {
+        EventPin* obj = static_cast<EventPin*>(arg);
+        obj->edgeTrigger(active, gpio_edge_usecs(gpio_num));
+    }
+
     void GPIOPinDetail::registerEvent(EventPin* obj) {
         gpio_set_action(_index, gpioAction, (void*)obj, _attributes.has(Pin::Attr::ActiveLow));
+        if (obj->_edgeDriven) {
+            gpio_set_edge_action(_index, gpioEdgeAction, obj->_debounceMs);
+        }
     }
 
     std::string GPIOPinDetail::toString() {
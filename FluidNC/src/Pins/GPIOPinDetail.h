@@ -18,6 +18,7 @@ namespace Pins {
         bool _lastWrittenValue = false;
 
         static void gpioAction(int, void*, bool);
+        static void gpioEdgeAction(int, void*, bool);
 
     public:
         static const int nGPIOPins = 40;
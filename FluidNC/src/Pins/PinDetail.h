@@ -7,6 +7,7 @@
 #include "PinAttributes.h"
 #include "PinOptionsParser.h"
 #include "src/Machine/EventPin.h"
+#include "src/Configuration/Arena.h"
 
 #include <cstdint>
 #include <cstring>
@@ -18,7 +19,7 @@ typedef uint8_t pinnum_t;
 namespace Pins {
 
     // Implementation details of pins.
-    class PinDetail {
+    class PinDetail : public Configuration::ArenaAllocated {
     protected:
     public:
         int _index;
@@ -0,0 +1,51 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "PinMask.h"
+
+#include "../Pin.h"
+#include "../I2SOut.h"            // i2s_out_write_mask
+#include "Driver/fluidnc_gpio.h"  // gpio_write_mask
+
+namespace Pins {
+    bool PinMask::add(const Pin& pin, bool on) {
+        if (pin.undefined()) {
+            return true;
+        }
+
+        bool     high = on ^ pin.getAttr().has(PinAttributes::ActiveLow);
+        auto     name = pin.name();
+        uint32_t num  = pin.getNative(PinCapabilities::Output);
+
+        if (name.rfind("gpio", 0) == 0) {
+            uint32_t bank = num / 32;
+            uint32_t bit  = 1u << (num % 32);
+            (high ? _gpioSet : _gpioClear)[bank] |= bit;
+            return true;
+        }
+        if (name.rfind("I2SO", 0) == 0) {
+            (high ? _i2soSet : _i2soClear) |= 1u << num;
+            return true;
+        }
+        return false;
+    }
+
+    PinMask PinMask::inverted() const {
+        PinMask m;
+        for (int bank = 0; bank < 2; bank++) {
+            m._gpioSet[bank]   = _gpioClear[bank];
+            m._gpioClear[bank] = _gpioSet[bank];
+        }
+        m._i2soSet   = _i2soClear;
+        m._i2soClear = _i2soSet;
+        return m;
+    }
+
+    void IRAM_ATTR PinMask::write() const {
+        if (_gpioSet[0] | _gpioClear[0] | _gpioSet[1] | _gpioClear[1]) {
+            gpio_write_mask(_gpioSet[0], _gpioClear[0], _gpioSet[1], _gpioClear[1]);
+        }
+        if (_i2soSet | _i2soClear) {
+            i2s_out_write_mask(_i2soSet, _i2soClear);
+        }
+    }
+}
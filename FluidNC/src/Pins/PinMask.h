@@ -0,0 +1,43 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+class Pin;
+
+namespace Pins {
+    // A set of output levels that is written with a few register writes instead of a
+    // virtual write() per pin.  Only GPIO and I2SO pins can be part of a PinMask.
+    // Writes through a PinMask bypass the pin objects, so a pin whose level is kept
+    // in a mask must not also be written through its Pin.
+    struct PinMask {
+        uint32_t _gpioSet[2]   = { 0, 0 };  // GPIO 0..31 and 32..63
+        uint32_t _gpioClear[2] = { 0, 0 };
+        uint32_t _i2soSet      = 0;
+        uint32_t _i2soClear    = 0;
+
+        // Adds the pin, driven to the logical level "on" with ActiveLow taken into
+        // account.  Undefined pins are ignored.  Returns false if the pin is neither
+        // a GPIO nor an I2SO pin.
+        bool add(const Pin& pin, bool on);
+
+        // The same pins driven to the opposite levels
+        PinMask inverted() const;
+
+        bool gpioOnly() const { return !(_i2soSet | _i2soClear); }
+
+        inline PinMask& IRAM_ATTR operator|=(const PinMask& o) {
+            _gpioSet[0]   |= o._gpioSet[0];
+            _gpioSet[1]   |= o._gpioSet[1];
+            _gpioClear[0] |= o._gpioClear[0];
+            _gpioClear[1] |= o._gpioClear[1];
+            _i2soSet      |= o._i2soSet;
+            _i2soClear    |= o._i2soClear;
+            return *this;
+        }
+
+        void write() const;
+    };
+}
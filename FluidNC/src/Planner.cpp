@@ -10,21 +10,63 @@
 
 #include "Planner.h"
 #include "Machine/MachineConfig.h"
+#include "SpscRing.h"
+#include "Raster.h"
+#include "MotionTrace.h"
+#include "MotionBench.h"
+#include "LatencyProbe.h"
 
-#include <cstdlib>  // PSoc Required for labs
+#include <esp_heap_caps.h>  // heap_caps_malloc()
+#include <esp32-hal-psram.h>  // psramFound()
+#include <cstdlib>            // PSoc Required for labs
 #include <cmath>
+#include <algorithm>
 
-static plan_block_t* block_buffer = nullptr;  // A ring buffer for motion instructions
-static uint8_t       block_buffer_tail;       // Index of the block to process now
-static uint8_t       block_buffer_head;       // Index of the next block to be pushed
-static uint8_t       next_buffer_head;        // Index of the next buffer head
-static uint8_t       block_buffer_planned;    // Index of the optimally planned block
+static plan_block_t*           block_buffer = nullptr;  // Storage for block_queue
+static SpscRing<plan_block_t> block_queue;            // A ring buffer for motion instructions
+static uint32_t               block_buffer_planned;   // Index of the optimally planned block
 
+// Parking moves.  While the tool parks, the planner buffer holds the program that the hold
+// interrupted, so the moves of each step of the parking sequence are queued in a small ring
+// of their own.  They are planned together from and to a stop, as a program is, so that one
+// move carries its speed into the next instead of stopping at the junction.
+static const uint32_t         parkQueueSize = 4;  // Holds one less than this
+static plan_block_t           park_blocks[parkQueueSize];
+static SpscRing<plan_block_t> park_queue;
+
+static struct {
+    int32_t position[MAX_N_AXIS];           // End of the last queued parking move, in steps
+    float   previous_unit_vec[MAX_N_AXIS];  // Direction of the last queued parking move
+    float   previous_nominal_speed;         // Nominal speed of the last queued parking move
+} park;
+
+// The planner buffer is only touched by the main task - the stepper ISR works from
+// its own copies in the segment buffer - so it can live in the slower PSRAM when the
+// board has it.  That leaves internal RAM free and permits hundreds of blocks.
 void plan_init() {
     if (block_buffer) {
-        delete[] block_buffer;
+        heap_caps_free(block_buffer);
+        block_buffer = nullptr;
+    }
+    size_t size = config->_planner_blocks * sizeof(plan_block_t);
+    if (psramFound()) {
+        block_buffer = static_cast<plan_block_t*>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        if (block_buffer) {
+            log_debug("Planner buffer: " << config->_planner_blocks << " blocks in PSRAM");
+        }
+    }
+    if (!block_buffer) {
+        block_buffer = static_cast<plan_block_t*>(heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
     }
-    block_buffer = new plan_block_t[config->_planner_blocks];
+    if (!block_buffer) {
+        log_error("Cannot allocate " << config->_planner_blocks << " planner blocks; using " << Machine::MachineConfig::defaultPlannerBlocks);
+        config->_planner_blocks = Machine::MachineConfig::defaultPlannerBlocks;
+        size                    = config->_planner_blocks * sizeof(plan_block_t);
+        block_buffer            = static_cast<plan_block_t*>(heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    }
+    Assert(block_buffer, "Planner buffer allocation failed");
+    block_queue.init(block_buffer, config->_planner_blocks);
+    park_queue.init(park_blocks, parkQueueSize);
 }
 
 // Define planner variables
@@ -34,27 +76,21 @@ typedef struct {
     // i.e. arcs, canned cycles, and backlash compensation.
     float previous_unit_vec[MAX_N_AXIS];  // Unit vector of previous path line segment
     float previous_nominal_speed;         // Nominal speed of previous path line segment
+    float previous_millimeters;           // Length of previous path line segment
+
+    // The last queued line, while the next one may be merged into it
+    struct {
+        bool    valid;
+        int32_t start[MAX_N_AXIS];                   // Start of the line in steps
+        float   points[maxMergedLines][MAX_N_AXIS];  // Starts of the lines merged into it (mm)
+        uint8_t n_points;
+        float   entry_unit_vec[MAX_N_AXIS];  // The previous_ values from before the line was queued
+        float   entry_nominal_speed;
+        float   entry_millimeters;
+    } merge;
 } planner_t;
 static planner_t pl;
 
-// Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-static uint8_t plan_next_block_index(uint8_t block_index) {
-    block_index++;
-    if (block_index == config->_planner_blocks) {
-        block_index = 0;
-    }
-    return block_index;
-}
-
-// Returns the index of the previous block in the ring buffer
-static uint8_t plan_prev_block_index(uint8_t block_index) {
-    if (block_index == 0) {
-        block_index = config->_planner_blocks;
-    }
-    block_index--;
-    return block_index;
-}
-
 /*                            PLANNER SPEED DEFINITION
                                      +--------+   <- current->nominal_speed
                                     /          \
@@ -96,15 +132,15 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
   recomputed as stated in the general guidelines.
 
   Planner buffer index mapping:
-  - block_buffer_tail: Points to the beginning of the planner buffer. First to be executed or being executed.
-  - block_buffer_head: Points to the buffer block after the last block in the buffer. Used to indicate whether
-      the buffer is full or empty. As described for standard ring buffers, this block is always empty.
-  - next_buffer_head: Points to next planner buffer block after the buffer head block. When equal to the
-      buffer tail, this indicates the buffer is full.
+  - block_queue.tail(): Points to the beginning of the planner buffer. First to be executed or being executed.
+      Advanced by the segment generator, the consumer of the queue.
+  - block_queue.head(): Points to the buffer block after the last block in the buffer. Used to indicate whether
+      the buffer is full or empty. As described for standard ring buffers, this block is always empty,
+      except while a system motion is planned in it. Advanced by plan_buffer_line(), the producer.
   - block_buffer_planned: Points to the first buffer block after the last optimally planned block for normal
       streaming operating conditions. Use for planning optimizations by avoiding recomputing parts of the
       planner buffer that don't change with the addition of a new block, as describe above. In addition,
-      this block can never be less than block_buffer_tail and will always be pushed forward and maintain
+      this block can never be less than block_queue.tail() and will always be pushed forward and maintain
       this requirement when encountered by the plan_discard_current_block() routine during a cycle.
 
   NOTE: Since the planner only computes on what's in the planner buffer, some motions with lots of short
@@ -119,10 +155,17 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
   to compute an optimal plan, so select carefully. The Arduino 328p memory is already maxed out, but future
   ARM versions should have enough memory and speed for look-ahead blocks numbering up to a hundred or more.
 
+  When a block is streamed in, the reverse pass can also quit as soon as it reaches a block whose entry
+  speed it does not raise. Appending a block can only increase the reverse-computed entry speeds, and each
+  one depends only on its successor, so an unchanged block means all earlier blocks are unchanged too. This
+  keeps the cost of plan_buffer_line() independent of the buffer size in steady streaming. The early exit
+  is not valid after an override or feed hold changes the speed limits of the queued blocks, so
+  plan_cycle_reinitialize() asks for a full pass.
+
 */
-static void planner_recalculate() {
+static void planner_recalculate(bool streaming) {
     // Initialize block index to the last block in the planner buffer.
-    uint8_t block_index = plan_prev_block_index(block_buffer_head);
+    uint32_t block_index = block_queue.prev(block_queue.head());
     // Bail. Can't do anything with one only one plan-able block.
     if (block_index == block_buffer_planned) {
         return;
@@ -135,37 +178,39 @@ static void planner_recalculate() {
     plan_block_t* current = &block_buffer[block_index];
     // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
     current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
-    block_index              = plan_prev_block_index(block_index);
+    block_index              = block_queue.prev(block_index);
     if (block_index == block_buffer_planned) {  // Only two plannable blocks in buffer. Reverse pass complete.
         // Check if the first block is the tail. If so, notify stepper to update its current parameters.
-        if (block_index == block_buffer_tail) {
+        if (block_index == block_queue.tail()) {
             Stepper::update_plan_block_parameters();
         }
     } else {  // Three or more plan-able blocks
         while (block_index != block_buffer_planned) {
             next        = current;
             current     = &block_buffer[block_index];
-            block_index = plan_prev_block_index(block_index);
+            block_index = block_queue.prev(block_index);
             // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
-            if (block_index == block_buffer_tail) {
+            if (block_index == block_queue.tail()) {
                 Stepper::update_plan_block_parameters();
             }
             // Compute maximum entry speed decelerating over the current block from its exit speed.
             if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
                 entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
-                if (entry_speed_sqr < current->max_entry_speed_sqr) {
-                    current->entry_speed_sqr = entry_speed_sqr;
-                } else {
-                    current->entry_speed_sqr = current->max_entry_speed_sqr;
+                if (entry_speed_sqr > current->max_entry_speed_sqr) {
+                    entry_speed_sqr = current->max_entry_speed_sqr;
+                }
+                if (streaming && entry_speed_sqr == current->entry_speed_sqr) {
+                    break;  // Not raised by the new block, so nothing before it can change.
                 }
+                current->entry_speed_sqr = entry_speed_sqr;
             }
         }
     }
     // Forward Pass: Forward plan the acceleration curve from the planned pointer onward.
     // Also scans for optimal plan breakpoints and appropriately updates the planned pointer.
     next        = &block_buffer[block_buffer_planned];  // Begin at buffer planned pointer
-    block_index = plan_next_block_index(block_buffer_planned);
-    while (block_index != block_buffer_head) {
+    block_index = block_queue.next(block_buffer_planned);
+    while (block_index != block_queue.head()) {
         current = next;
         next    = &block_buffer[block_index];
         // Any acceleration detected in the forward pass automatically moves the optimal planned
@@ -186,7 +231,7 @@ static void planner_recalculate() {
         if (next->entry_speed_sqr == next->max_entry_speed_sqr) {
             block_buffer_planned = block_index;
         }
-        block_index = plan_next_block_index(block_index);
+        block_index = block_queue.next(block_index);
     }
 }
 
@@ -196,48 +241,67 @@ void plan_reset() {
 }
 
 void plan_reset_buffer() {
-    block_buffer_tail    = 0;
-    block_buffer_head    = 0;  // Empty = tail
-    next_buffer_head     = 1;  // plan_next_block_index(block_buffer_head)
-    block_buffer_planned = 0;  // = block_buffer_tail;
+    Stepper::PrepLock lock;
+
+    block_queue.reset();
+    block_buffer_planned = 0;  // = block_queue.tail();
+    park_queue.reset();
 }
 
 // Called from stepper pulse function when the block is complete
 void plan_discard_current_block() {
-    if (block_buffer_head != block_buffer_tail) {  // Discard non-empty buffer.
-        uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    if (!block_queue.empty()) {  // Discard non-empty buffer.
+        uint32_t block_index = block_queue.tail();
         // Push block_buffer_planned pointer, if encountered.
-        if (block_buffer_tail == block_buffer_planned) {
-            block_buffer_planned = block_index;
+        if (block_index == block_buffer_planned) {
+            block_buffer_planned = block_queue.next(block_index);
         }
-        block_buffer_tail = block_index;
+        block_queue.pop();
     }
 }
 
 // Returns address of planner buffer block used by system motions. Called by segment generator.
 plan_block_t* plan_get_system_motion_block() {
-    return &block_buffer[block_buffer_head];
+    if (!park_queue.empty()) {
+        return park_queue.front();
+    }
+    return block_queue.back();
+}
+
+float plan_get_system_exit_speed_sqr() {
+    if (park_queue.size() < 2) {
+        return 0.0f;
+    }
+    return park_queue[park_queue.next(park_queue.tail())].entry_speed_sqr;
 }
 
 // Returns address of first planner block, if available. Called by various main program functions.
 plan_block_t* plan_get_current_block() {
-    if (block_buffer_head == block_buffer_tail) {
+    if (block_queue.empty()) {
         return NULL;  // Buffer empty
     }
-    return &block_buffer[block_buffer_tail];
+    return block_queue.front();
+}
+
+int32_t plan_get_block_line_number(const plan_block_t* block) {
+    int32_t line_number = block->line_number;
+    for (uint8_t i = 0; i < block->n_merged && block->millimeters <= block->merged[i].from_end; i++) {
+        line_number = block->merged[i].line_number;
+    }
+    return line_number;
 }
 
 float plan_get_exec_block_exit_speed_sqr() {
-    uint8_t block_index = plan_next_block_index(block_buffer_tail);
-    if (block_index == block_buffer_head) {
+    uint32_t block_index = block_queue.next(block_queue.tail());
+    if (block_index == block_queue.head()) {
         return 0.0f;
     }
     return block_buffer[block_index].entry_speed_sqr;
 }
 
 // Returns the availability status of the block ring buffer. True, if full.
-uint8_t plan_check_full_buffer() {
-    return block_buffer_tail == next_buffer_head;
+bool plan_check_full_buffer() {
+    return block_queue.full();
 }
 
 // Computes and returns block nominal speed based on running condition and override values.
@@ -277,23 +341,54 @@ static void plan_compute_profile_parameters(plan_block_t* block, float nominal_s
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters() {
-    uint8_t       block_index = block_buffer_tail;
+    Stepper::PrepLock lock;
+
+    uint32_t      block_index = block_queue.tail();
     plan_block_t* block;
     float         nominal_speed;
     float         prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
-    while (block_index != block_buffer_head) {
+    while (block_index != block_queue.head()) {
         block         = &block_buffer[block_index];
         nominal_speed = plan_compute_profile_nominal_speed(block);
         plan_compute_profile_parameters(block, nominal_speed, prev_nominal_speed);
         prev_nominal_speed = nominal_speed;
-        block_index        = plan_next_block_index(block_index);
+        block_index        = block_queue.next(block_index);
     }
     pl.previous_nominal_speed = prev_nominal_speed;  // Update prev nominal speed for next incoming block.
 }
 
-bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
-    // Prepare and initialize new block. Copy relevant pl_data for block execution.
-    plan_block_t* block = &block_buffer[block_buffer_head];
+// Alternative to junction deviation, selected by junction_model: Centripetal.
+// CAM output that linearizes a smooth curve produces long runs of junctions that each turn by a
+// small angle.  Such a polyline is treated as the curve it approximates; the radius is estimated
+// from the shorter segment length and the turn angle, and the junction speed is that at which the
+// centripetal acceleration along the junction direction reaches its limit.  Sharper corners are
+// limited by the instantaneous speed change that each axis can tolerate, so a slow rotary or Z
+// axis with a small direction change does not hold back cornering on the other axes.
+// junction_vec is the difference of the two unit vectors; it is normalized on return.
+static float centripetal_junction_speed_sqr(float* junction_vec, float prev_millimeters, float millimeters) {
+    auto n_axis = config->_axes->_numberAxis;
+
+    float jerk_limit = SOME_LARGE_VALUE;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        float delta = fabsf(junction_vec[idx]);  // Speed change of this axis per unit of path speed
+        if (delta > 0.0f) {
+            jerk_limit = MIN(jerk_limit, config->_axes->_axis[idx]->_maxJerk / delta);
+        }
+    }
+
+    // |u2 - u1| = 2 sin(turn/2)
+    float chord = convert_delta_vector_to_unit_vector(junction_vec);
+    float turn  = 2.0f * asinf(MIN(0.5f * chord, 1.0f));
+    if (turn > config->_centripetalAngle * float(M_PI / 180.0)) {
+        return jerk_limit * jerk_limit;
+    }
+    float radius = MIN(millimeters, prev_millimeters) / turn;
+    // The jerk limit still applies, in case the segments are long enough to give a large radius
+    return MIN(jerk_limit * jerk_limit, limit_acceleration_by_axis_maximum(junction_vec) * radius);
+}
+
+// Clears a block and copies the relevant pl_data for its execution
+static void plan_init_block(plan_block_t* block, plan_line_data_t* pl_data) {
     memset(block, 0, sizeof(plan_block_t));  // Zero all block values.
     block->motion        = pl_data->motion;
     block->coolant       = pl_data->coolant;
@@ -301,10 +396,15 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     block->spindle_speed = pl_data->spindle_speed;
     block->line_number   = pl_data->line_number;
     block->is_jog        = pl_data->is_jog;
+}
+
+// Initializes the block at the buffer head from pl_data and copies the start position in steps.
+// Returns nullptr if the motion must not be planned.
+static plan_block_t* plan_start_block(plan_line_data_t* pl_data, int32_t* position_steps) {
+    // Prepare and initialize new block. Copy relevant pl_data for block execution.
+    plan_block_t* block = block_queue.back();
+    plan_init_block(block, pl_data);
 
-    // Compute and store initial move distance data.
-    int32_t target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
-    float   unit_vec[MAX_N_AXIS], delta_mm;
     // Copy position data based on type of motion being planned.
     if (block->motion.systemMotion) {
         copyAxes(position_steps, get_motor_steps());
@@ -312,37 +412,50 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         if (!block->is_jog && Homing::unhomed_axes()) {
             log_info("Unhomed axes: " << config->_axes->maskToNames(Homing::unhomed_axes()));
             send_alarm(ExecAlarm::Unhomed);
-            return false;
+            return nullptr;
         }
         copyAxes(position_steps, pl.position);
     }
-    auto n_axis = config->_axes->_numberAxis;
+    return block;
+}
+
+// The highest speed, squared, at which the path can turn from the direction prev_unit_vec to
+// unit_vec at the start of a block of the given length.  A G64 P tolerance takes the place of
+// the junction deviation, whichever junction model is configured, since the corner that the
+// deviation describes is rounded by at most that distance.
+static float plan_junction_speed_sqr(float* prev_unit_vec, float prev_millimeters, float* unit_vec, float millimeters, float tolerance) {
+    auto  n_axis = config->_axes->_numberAxis;
+    float junction_unit_vec[MAX_N_AXIS];
+    float junction_cos_theta = 0.0;
     for (size_t idx = 0; idx < n_axis; idx++) {
-        // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
-        // Also, compute individual axes distance for move and prep unit vector calculations.
-        // NOTE: Computes true distance from converted step values.
-        target_steps[idx]       = mpos_to_steps(target[idx], idx);
-        block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
-        block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
-        delta_mm                = steps_to_mpos((target_steps[idx] - position_steps[idx]), idx);
-        unit_vec[idx]           = delta_mm;  // Store unit vector numerator
-        // Set direction bits. Bit enabled always means direction is negative.
-        if (delta_mm < 0.0) {
-            block->direction_bits |= bitnum_to_mask(idx);
-        }
+        junction_cos_theta -= prev_unit_vec[idx] * unit_vec[idx];
+        junction_unit_vec[idx] = unit_vec[idx] - prev_unit_vec[idx];
     }
-    // Bail if this is a zero-length block. Highly unlikely to occur.
-    if (block->step_event_count == 0) {
-        return false;
+    // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
+    if (junction_cos_theta > 0.999999) {
+        //  For a 0 degree acute junction, just set minimum junction speed.
+        return MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED;
+    }
+    if (junction_cos_theta < -0.999999) {
+        // Junction is a straight line or 180 degrees. Junction speed is infinite.
+        return SOME_LARGE_VALUE;
     }
+    if (tolerance == 0.0f && config->_junctionModel == Machine::MachineConfig::CENTRIPETAL) {
+        return MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
+                   centripetal_junction_speed_sqr(junction_unit_vec, prev_millimeters, millimeters));
+    }
+    convert_delta_vector_to_unit_vector(junction_unit_vec);
+    float junction_acceleration = limit_acceleration_by_axis_maximum(junction_unit_vec);
+    float sin_theta_d2          = sqrtf(0.5f * (1.0f - junction_cos_theta));  // Trig half angle identity. Always positive.
+    float deviation             = tolerance > 0.0f ? tolerance : config->_junctionDeviation;
+    return MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED, (junction_acceleration * deviation * sin_theta_d2) / (1.0f - sin_theta_d2));
+}
 
-    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
-    // down such that no individual axes maximum values are exceeded with respect to the line direction.
-    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
-    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
-    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
-    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+// Computes the junction speed of a block whose path starts in the direction unit_vec,
+// then queues it and replans.  exit_vec is the direction at the end of the block, which
+// differs from unit_vec only for arcs.
+static bool plan_queue_block(plan_block_t* block, plan_line_data_t* pl_data, float* unit_vec, float* exit_vec, int32_t* target_steps) {
+    pl.merge.valid = false;
     // Store programmed rate.
     if (block->motion.rapidMotion) {
         block->programmed_rate = block->rapid_rate;
@@ -353,7 +466,7 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         }
     }
     // TODO: Need to check this method handling zero junction speeds when starting from rest.
-    if ((block_buffer_head == block_buffer_tail) || (block->motion.systemMotion)) {
+    if (block_queue.empty() || (block->motion.systemMotion)) {
         // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
         // If system motion, the system motion block always is assumed to start from rest and end at a complete stop.
         block->entry_speed_sqr        = 0.0;
@@ -380,29 +493,8 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         // changed dynamically during operation nor can the line move geometry. This must be kept in
         // memory in the event of a feedrate override changing the nominal speeds of blocks, which can
         // change the overall maximum entry speed conditions of all blocks.
-        float junction_unit_vec[MAX_N_AXIS];
-        float junction_cos_theta = 0.0;
-        for (size_t idx = 0; idx < n_axis; idx++) {
-            junction_cos_theta -= pl.previous_unit_vec[idx] * unit_vec[idx];
-            junction_unit_vec[idx] = unit_vec[idx] - pl.previous_unit_vec[idx];
-        }
-        // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
-        if (junction_cos_theta > 0.999999) {
-            //  For a 0 degree acute junction, just set minimum junction speed.
-            block->max_junction_speed_sqr = MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED;
-        } else {
-            if (junction_cos_theta < -0.999999) {
-                // Junction is a straight line or 180 degrees. Junction speed is infinite.
-                block->max_junction_speed_sqr = SOME_LARGE_VALUE;
-            } else {
-                convert_delta_vector_to_unit_vector(junction_unit_vec);
-                float junction_acceleration = limit_acceleration_by_axis_maximum(junction_unit_vec);
-                float sin_theta_d2          = sqrtf(0.5f * (1.0f - junction_cos_theta));  // Trig half angle identity. Always positive.
-                block->max_junction_speed_sqr =
-                    MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
-                        (junction_acceleration * config->_junctionDeviation * sin_theta_d2) / (1.0f - sin_theta_d2));
-            }
-        }
+        block->max_junction_speed_sqr = plan_junction_speed_sqr(
+            pl.previous_unit_vec, pl.previous_millimeters, unit_vec, block->millimeters, pl_data->path_tolerance);
     }
     // Block system motion from updating this data to ensure next g-code motion is computed correctly.
     if (!(block->motion.systemMotion)) {
@@ -410,17 +502,454 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         plan_compute_profile_parameters(block, nominal_speed, pl.previous_nominal_speed);
         pl.previous_nominal_speed = nominal_speed;
         // Update previous path unit_vector and planner position.
-        copyAxes(pl.previous_unit_vec, unit_vec);
+        copyAxes(pl.previous_unit_vec, exit_vec);
+        pl.previous_millimeters = block->millimeters;
         copyAxes(pl.position, target_steps);
-        // New block is all set. Update buffer head and next buffer head indices.
-        block_buffer_head = next_buffer_head;
-        next_buffer_head  = plan_next_block_index(block_buffer_head);
+        block->raster = Raster::take();
+        // New block is all set. Publish it by advancing the buffer head.
+        block_queue.push();
+        LatencyProbe::toggle(LatencyProbe::Planner);
+        if (MotionTrace::enabled) {
+            MotionTrace::record(MotionTrace::PlanBlock, block_queue.size());
+        }
         // Finish up by recalculating the plan with the new block.
-        planner_recalculate();
+        planner_recalculate(true);
+        Stepper::notify_prep();
     }
     return true;
 }
 
+bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+    int32_t target_steps[MAX_N_AXIS];
+    auto    n_axis = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        target_steps[idx] = mpos_to_steps(target[idx], idx);
+    }
+    return plan_buffer_line_steps(target_steps, pl_data);
+}
+
+// Sets the steps, direction bits and axis limits of a line block from position_steps to
+// target_steps, and its direction in unit_vec.  Returns false for a zero-length line.
+static bool plan_line_geometry(plan_block_t* block, int32_t* position_steps, int32_t* target_steps, float* unit_vec) {
+    float delta_mm;
+    auto  n_axis = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        // Calculate the number of steps for each axis, and determine max step events.
+        // Also, compute individual axes distance for move and prep unit vector calculations.
+        // NOTE: Computes true distance from converted step values.
+        block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
+        block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
+        delta_mm                = steps_to_mpos((target_steps[idx] - position_steps[idx]), idx);
+        unit_vec[idx]           = delta_mm;  // Store unit vector numerator
+        // Set direction bits. Bit enabled always means direction is negative.
+        if (delta_mm < 0.0) {
+            block->direction_bits |= bitnum_to_mask(idx);
+        }
+    }
+    // Bail if this is a zero-length block. Highly unlikely to occur.
+    if (block->step_event_count == 0) {
+        return false;
+    }
+
+    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
+    // down such that no individual axes maximum values are exceeded with respect to the line direction.
+    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
+    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
+    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
+    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
+    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+    return true;
+}
+
+// G64 Q or merge_tolerance_mm: extends the last queued line to target_steps instead of queueing another block, when
+// the ends of the lines that the longer line then replaces are all within the tolerance of it.
+// The last block must be waiting behind the one that the stepper is running, move the same way,
+// and keep the entry speed that the blocks before it were planned for, if it is the planned one.
+static bool plan_merge_line(int32_t* target_steps, plan_line_data_t* pl_data) {
+    auto& merge = pl.merge;
+    if (!merge.valid || pl_data->merge_tolerance <= 0.0f || merge.n_points == maxMergedLines || block_queue.size() < 2) {
+        return false;
+    }
+    uint32_t      index = block_queue.prev(block_queue.head());
+    plan_block_t* last  = &block_buffer[index];
+    if (pl_data->motion.rapidMotion || pl_data->motion.inverseTime || pl_data->is_jog ||
+        memcmp(&last->motion, &pl_data->motion, sizeof(PlMotion)) || last->programmed_rate != pl_data->feed_rate ||
+        last->spindle != pl_data->spindle || last->spindle_speed != pl_data->spindle_speed ||
+        memcmp(&last->coolant, &pl_data->coolant, sizeof(CoolantState))) {
+        return false;
+    }
+
+    auto  n_axis = config->_axes->_numberAxis;
+    float start[MAX_N_AXIS], chord[MAX_N_AXIS];
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        start[idx] = steps_to_mpos(merge.start[idx], idx);
+        chord[idx] = steps_to_mpos(target_steps[idx], idx) - start[idx];
+        merge.points[merge.n_points][idx] = steps_to_mpos(pl.position[idx], idx);
+    }
+    float length = convert_delta_vector_to_unit_vector(chord);
+    if (length == 0.0f) {
+        return false;
+    }
+    float tolerance_sqr = pl_data->merge_tolerance * pl_data->merge_tolerance;
+    float along_chord[maxMergedLines];
+    for (uint8_t i = 0; i <= merge.n_points; i++) {
+        float along = 0.0f, distance_sqr = 0.0f;
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            float d = merge.points[i][idx] - start[idx];
+            along += d * chord[idx];
+            distance_sqr += d * d;
+        }
+        if (along < 0.0f || along > length || distance_sqr - along * along > tolerance_sqr) {
+            return false;
+        }
+        along_chord[i] = along;
+    }
+
+    plan_block_t merged = *last;
+    float        unit_vec[MAX_N_AXIS];
+    memset(merged.steps, 0, sizeof(merged.steps));
+    merged.step_event_count = 0;
+    merged.direction_bits   = 0;
+    if (!plan_line_geometry(&merged, merge.start, target_steps, unit_vec)) {
+        return false;
+    }
+    merged.merged[merge.n_points].line_number = pl_data->line_number;
+    merged.n_merged                            = merge.n_points + 1;
+    for (uint8_t i = 0; i < merged.n_merged; i++) {
+        merged.merged[i].from_end = merged.millimeters - along_chord[i];
+    }
+    if (merged.max_junction_speed_sqr > 0.0f) {  // Else it starts from rest
+        merged.max_junction_speed_sqr = plan_junction_speed_sqr(
+            merge.entry_unit_vec, merge.entry_millimeters, unit_vec, merged.millimeters, pl_data->path_tolerance);
+    }
+    float nominal_speed = plan_compute_profile_nominal_speed(&merged);
+    plan_compute_profile_parameters(&merged, nominal_speed, merge.entry_nominal_speed);
+    if (merged.entry_speed_sqr > merged.max_entry_speed_sqr) {
+        if (index == block_buffer_planned) {
+            return false;
+        }
+        merged.entry_speed_sqr = merged.max_entry_speed_sqr;
+    }
+
+    *last = merged;
+    merge.n_points++;
+    pl.previous_nominal_speed = nominal_speed;
+    copyAxes(pl.previous_unit_vec, unit_vec);
+    pl.previous_millimeters = merged.millimeters;
+    copyAxes(pl.position, target_steps);
+    planner_recalculate(false);  // The block is longer, but its entry limit may have dropped
+    Stepper::notify_prep();
+    return true;
+}
+
+bool plan_buffer_line_steps(int32_t* target_steps, plan_line_data_t* pl_data) {
+    Stepper::PrepLock   lock;
+    MotionBench::Timing timing(MotionBench::Planner);
+
+    if (plan_merge_line(target_steps, pl_data)) {
+        return true;
+    }
+
+    // Compute and store initial move distance data.
+    int32_t position_steps[MAX_N_AXIS];
+    float   unit_vec[MAX_N_AXIS];
+
+    plan_block_t* block = plan_start_block(pl_data, position_steps);
+    if (!block || !plan_line_geometry(block, position_steps, target_steps, unit_vec)) {
+        return false;
+    }
+    // What a line merged into this one later needs, from before plan_queue_block() changes it
+    auto& merge = pl.merge;
+    copyAxes(merge.entry_unit_vec, pl.previous_unit_vec);
+    merge.entry_nominal_speed = pl.previous_nominal_speed;
+    merge.entry_millimeters   = pl.previous_millimeters;
+    copyAxes(merge.start, position_steps);
+    merge.n_points = 0;
+
+    bool queued = plan_queue_block(block, pl_data, unit_vec, unit_vec, target_steps);
+    // Merged lines are straight in motor space, which is only the programmed path when it is cartesian
+    merge.valid = queued && pl_data->merge_tolerance > 0.0f && !block->motion.systemMotion && !block->raster &&
+                  config->_kinematics->canPlanArcs();
+    return queued;
+}
+
+bool plan_buffer_dwell(uint32_t ms, plan_line_data_t* pl_data) {
+    Stepper::PrepLock lock;
+
+    plan_block_t* block = block_queue.back();
+    plan_init_block(block, pl_data);
+    block->motion.dwell = 1;
+    block->dwell_ms     = ms;
+    block->acceleration = 1.0f;  // Not used, but the segment generator divides by it
+    // The zero length and entry speed limit make the block before it stop at its start,
+    // and the zero nominal speed makes the block after it start from a stop
+    pl.merge.valid            = false;
+    pl.previous_nominal_speed = 0.0f;
+
+    block_queue.push();
+    if (MotionTrace::enabled) {
+        MotionTrace::record(MotionTrace::PlanBlock, block_queue.size());
+    }
+    planner_recalculate(true);
+    Stepper::notify_prep();
+    return true;
+}
+
+// Plans the queued parking moves from and to a stop, with the passes of planner_recalculate()
+// over so few blocks that they are simply done in full
+static void plan_park_recalculate() {
+    uint32_t first = park_queue.tail();
+    uint32_t last  = park_queue.prev(park_queue.head());
+
+    // Reverse pass, from a stop at the end of the last move
+    float exit_speed_sqr = 0.0f;
+    for (uint32_t index = last;; index = park_queue.prev(index)) {
+        plan_block_t& block   = park_queue[index];
+        block.entry_speed_sqr = MIN(block.max_entry_speed_sqr, exit_speed_sqr + 2 * block.acceleration * block.millimeters);
+        exit_speed_sqr        = block.entry_speed_sqr;
+        if (index == first) {
+            break;
+        }
+    }
+
+    // Forward pass, from a stop at the start of the first move
+    park_queue[first].entry_speed_sqr = 0.0f;
+    for (uint32_t index = first; index != last; index = park_queue.next(index)) {
+        plan_block_t& block = park_queue[index];
+        plan_block_t& next  = park_queue[park_queue.next(index)];
+        next.entry_speed_sqr = MIN(next.entry_speed_sqr, block.entry_speed_sqr + 2 * block.acceleration * block.millimeters);
+    }
+}
+
+bool plan_buffer_park_line(float* target, plan_line_data_t* pl_data) {
+    Stepper::PrepLock lock;
+
+    if (park_queue.full()) {
+        return false;
+    }
+    if (park_queue.empty()) {
+        copyAxes(park.position, get_motor_steps());
+    }
+
+    int32_t target_steps[MAX_N_AXIS];
+    float   unit_vec[MAX_N_AXIS];
+    auto    n_axis = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        target_steps[idx] = mpos_to_steps(target[idx], idx);
+    }
+
+    plan_block_t* block = park_queue.back();
+    plan_init_block(block, pl_data);
+    if (!plan_line_geometry(block, park.position, target_steps, unit_vec)) {
+        return false;
+    }
+    block->programmed_rate = pl_data->feed_rate;
+
+    // Each move follows on from the one before, as in a program, without the feed override
+    float nominal_speed = plan_compute_profile_nominal_speed(block);
+    if (park_queue.empty()) {
+        block->max_junction_speed_sqr = 0.0f;
+        park.previous_nominal_speed   = 0.0f;
+    } else {
+        block->max_junction_speed_sqr =
+            plan_junction_speed_sqr(park.previous_unit_vec, pl.previous_millimeters, unit_vec, block->millimeters, 0.0f);
+    }
+    plan_compute_profile_parameters(block, nominal_speed, park.previous_nominal_speed);
+    park.previous_nominal_speed = nominal_speed;
+    copyAxes(park.previous_unit_vec, unit_vec);
+    copyAxes(park.position, target_steps);
+
+    park_queue.push();
+    plan_park_recalculate();
+    return true;
+}
+
+bool plan_next_park_block() {
+    if (!park_queue.empty()) {
+        park_queue.pop();
+    }
+    return !park_queue.empty();
+}
+
+void plan_reset_park_queue() {
+    Stepper::PrepLock lock;
+    park_queue.reset();
+}
+
+bool plan_buffer_arc(float*            target,
+                     plan_line_data_t* pl_data,
+                     float*            position,
+                     float*            center,
+                     float             radius,
+                     size_t            axis_0,
+                     size_t            axis_1,
+                     float             angular_travel) {
+    Stepper::PrepLock   lock;
+    MotionBench::Timing timing(MotionBench::Planner);
+
+    int32_t target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
+    float   unit_vec[MAX_N_AXIS], exit_vec[MAX_N_AXIS], limit_vec[MAX_N_AXIS];
+
+    plan_block_t* block = plan_start_block(pl_data, position_steps);
+    if (!block) {
+        return false;
+    }
+    block->is_arc = true;
+
+    plan_arc_t& arc = block->arc;
+    copyAxes(arc.start_steps, position_steps);
+    arc.center[0]      = center[0];
+    arc.center[1]      = center[1];
+    arc.radius         = radius;
+    arc.start_angle    = atan2f(position[axis_1] - center[1], position[axis_0] - center[0]);
+    arc.angular_travel = angular_travel;
+    arc.axis_0         = axis_0;
+    arc.axis_1         = axis_1;
+
+    // The steps and direction bits describe the chord from start to end, which is the net motion.
+    // The step event count instead bounds the steps that any axis can take over any part of the
+    // arc, so the segment generator always has enough step events for the chords it traces.
+    float plane_mm   = fabsf(angular_travel) * radius;
+    float length_sqr = plane_mm * plane_mm;
+    auto  n_axis     = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        target_steps[idx]   = mpos_to_steps(target[idx], idx);
+        int32_t delta_steps = target_steps[idx] - position_steps[idx];
+        block->steps[idx]   = labs(delta_steps);
+        float   travel_mm   = plane_mm;
+        if (idx == axis_0 || idx == axis_1) {
+            arc.delta[idx] = 0.0f;
+        } else {
+            arc.delta[idx] = steps_to_mpos(delta_steps, idx);
+            travel_mm      = fabsf(arc.delta[idx]);
+            length_sqr += travel_mm * travel_mm;
+        }
+        block->step_event_count = MAX(block->step_event_count, uint32_t(ceilf(travel_mm * config->_axes->_axis[idx]->_stepsPerMm)));
+        if (delta_steps < 0) {
+            block->direction_bits |= bitnum_to_mask(idx);
+        }
+    }
+    if (block->step_event_count == 0) {
+        return false;
+    }
+    arc.length         = sqrtf(length_sqr);
+    block->millimeters = arc.length;
+
+    // The entry junction is computed from the tangent at the start of the arc, and the next
+    // block's junction from the tangent at the end.  For the axis limits, the in-plane part of
+    // the tangent may lie along either plane axis.
+    float plane_rate = angular_travel * radius / arc.length;  // Signed in-plane travel per mm of path
+    float end_angle  = arc.start_angle + angular_travel;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        unit_vec[idx]  = arc.delta[idx] / arc.length;
+        exit_vec[idx]  = unit_vec[idx];
+        limit_vec[idx] = fabsf(unit_vec[idx]);
+    }
+    unit_vec[axis_0]  = -sinf(arc.start_angle) * plane_rate;
+    unit_vec[axis_1]  = cosf(arc.start_angle) * plane_rate;
+    exit_vec[axis_0]  = -sinf(end_angle) * plane_rate;
+    exit_vec[axis_1]  = cosf(end_angle) * plane_rate;
+    limit_vec[axis_0] = fabsf(plane_rate);
+    limit_vec[axis_1] = fabsf(plane_rate);
+
+    // Split the acceleration equally between the tangential and centripetal components so that
+    // their vector sum stays within the axis limits.  The centripetal part, v^2/r, caps the speed.
+    block->acceleration = limit_acceleration_by_axis_maximum(limit_vec) * 0.70710678f;  // 1/sqrt(2)
+    block->rapid_rate   = MIN(limit_rate_by_axis_maximum(limit_vec), sqrtf(block->acceleration * radius));
+
+    return plan_queue_block(block, pl_data, unit_vec, exit_vec, target_steps);
+}
+
+bool plan_buffer_kinematic_line(float* target, plan_line_data_t* pl_data, float* position) {
+    // Points along the line that are converted to motor space to find how far the motors travel
+    const int samples = 8;
+
+    Stepper::PrepLock   lock;
+    MotionBench::Timing timing(MotionBench::Planner);
+
+    int32_t  target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
+    float    unit_vec[MAX_N_AXIS], limit_vec[MAX_N_AXIS];
+    uint32_t path_steps[MAX_N_AXIS];
+
+    plan_block_t* block = plan_start_block(pl_data, position_steps);
+    if (!block) {
+        return false;
+    }
+    block->is_kinematic = true;
+
+    plan_kinematic_t& kin        = block->kinematic;
+    auto              n_axis     = config->_axes->_numberAxis;
+    float             length_sqr = 0.0f;
+    copyAxes(kin.start_steps, position_steps);
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        kin.start[idx]  = position[idx];
+        kin.delta[idx]  = target[idx] - position[idx];
+        limit_vec[idx]  = 0.0f;
+        path_steps[idx] = 0;
+        length_sqr += kin.delta[idx] * kin.delta[idx];
+    }
+    kin.length = sqrtf(length_sqr);
+    if (kin.length == 0.0f) {
+        return false;
+    }
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        unit_vec[idx] = kin.delta[idx] / kin.length;
+    }
+
+    // The motors can travel further than from start to end, and faster in some parts of the
+    // line than in others.  The step event count covers the steps along the whole path, and
+    // the limits are taken from the fastest part.  The travel over each chord gives only the
+    // average rate between the samples, which misses the peak near a singularity, so where
+    // the kinematics provide the Jacobian the exact rates at the samples are taken as well.
+    auto  kinematics = config->_kinematics;
+    float rates[MAX_N_AXIS];
+    if (kinematics->motor_rates(rates, kin.start, unit_vec)) {
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            limit_vec[idx] = fabsf(rates[idx]);
+        }
+    }
+    copyAxes(target_steps, position_steps);
+    for (int i = 1; i <= samples; i++) {
+        float cartesian[MAX_N_AXIS], motors[MAX_N_AXIS];
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            cartesian[idx] = kin.start[idx] + kin.delta[idx] * i / samples;
+        }
+        copyAxes(motors, cartesian);  // For the axes that the kinematics do not convert
+        if (!kinematics->transform_cartesian_to_motors(motors, cartesian)) {
+            log_warn("Kinematics error. Line passes out of reach");
+            return false;
+        }
+        bool exact = kinematics->motor_rates(rates, cartesian, unit_vec);
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            int32_t  steps = mpos_to_steps(motors[idx], idx);
+            uint32_t moved = labs(steps - target_steps[idx]);
+            path_steps[idx] += moved;
+            limit_vec[idx] = MAX(limit_vec[idx], steps_to_mpos(moved, idx) * samples / kin.length);
+            if (exact) {
+                limit_vec[idx] = MAX(limit_vec[idx], fabsf(rates[idx]));
+            }
+            target_steps[idx] = steps;
+        }
+    }
+
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        int32_t delta_steps     = target_steps[idx] - position_steps[idx];
+        block->steps[idx]       = labs(delta_steps);
+        block->step_event_count = MAX(block->step_event_count, path_steps[idx]);
+        if (delta_steps < 0) {
+            block->direction_bits |= bitnum_to_mask(idx);
+        }
+    }
+    if (block->step_event_count == 0) {
+        return false;
+    }
+    block->millimeters  = kin.length;
+    block->acceleration = limit_acceleration_by_axis_maximum(limit_vec);
+    block->rapid_rate   = limit_rate_by_axis_maximum(limit_vec);
+
+    return plan_queue_block(block, pl_data, unit_vec, unit_vec, target_steps);
+}
+
 // Reset the planner position vectors. Called by the system abort/initialization routine.
 void plan_sync_position() {
     // TODO: For motor configurations not in the same coordinate frame as the machine position,
@@ -432,19 +961,108 @@ void plan_sync_position() {
 
 // Returns the number of available blocks are in the planner buffer.
 // Called from report_realtime_status
-uint8_t plan_get_block_buffer_available() {
-    if (block_buffer_head >= block_buffer_tail) {
-        return (config->_planner_blocks - 1) - (block_buffer_head - block_buffer_tail);
-    } else {
-        return block_buffer_tail - block_buffer_head - 1;
+uint32_t plan_get_block_buffer_available() {
+    return block_queue.available();
+}
+
+uint32_t plan_get_block_buffer_count() {
+    return block_queue.size();
+}
+
+// The time in minutes to cover mm with the trapezoid that the stepper follows: from the
+// entry speed to nominal at the acceleration, at nominal, and down to the exit speed, or,
+// when the block is too short for nominal, up to the peak that it can reach and down.
+static float plan_trapezoid_minutes(float mm, float entry_sqr, float exit_sqr, float nominal, float accel) {
+    float entry    = sqrtf(entry_sqr);
+    float exit     = sqrtf(exit_sqr);
+    float ramps_mm = (fabsf(nominal * nominal - entry_sqr) + fabsf(nominal * nominal - exit_sqr)) / (2 * accel);
+    if (ramps_mm <= mm) {
+        return (fabsf(nominal - entry) + fabsf(nominal - exit)) / accel + (mm - ramps_mm) / nominal;
+    }
+    float peak = sqrtf(std::max((2 * accel * mm + entry_sqr + exit_sqr) / 2, std::max(entry_sqr, exit_sqr)));
+    return (2 * peak - entry - exit) / accel;
+}
+
+// Estimates how long the buffered motion will take, in ms, by integrating the trapezoid
+// of each block from its planned entry speed to that of the next, and to a stop after the
+// last.  The block being executed has its remaining length and its speed where the
+// segment generator has reached, so the segments already generated are not counted.
+// Called by the main program to schedule accessories ahead of time, and for the ETA.
+uint32_t plan_get_buffered_ms() {
+    float minutes = 0;
+    for (uint32_t index = block_queue.tail(); index != block_queue.head(); index = block_queue.next(index)) {
+        plan_block_t* block    = &block_buffer[index];
+        uint32_t      next     = block_queue.next(index);
+        float         exit_sqr = next == block_queue.head() ? 0.0f : block_buffer[next].entry_speed_sqr;
+        float         nominal  = plan_compute_profile_nominal_speed(block);
+        if (block->motion.dwell) {
+            minutes += block->dwell_ms / 60000.0f;
+        } else if (block->acceleration > 0) {
+            minutes += plan_trapezoid_minutes(block->millimeters, block->entry_speed_sqr, exit_sqr, nominal, block->acceleration);
+        } else {
+            minutes += block->millimeters / nominal;
+        }
     }
+    return uint32_t(minutes * 60000.0f);
 }
 
 // Re-initialize buffer plan with a partially completed block, assumed to exist at the buffer tail.
 // Called after a steppers have come to a complete stop for a feed hold and the cycle is stopped.
 void plan_cycle_reinitialize() {
+    Stepper::PrepLock lock;
+
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
     Stepper::update_plan_block_parameters();
-    block_buffer_planned = block_buffer_tail;
-    planner_recalculate();
+    block_buffer_planned = block_queue.tail();
+    planner_recalculate(false);
+}
+
+// Measures plan_buffer_line() throughput by planning a stream of short zig-zag segments
+// that are never executed.  Every segment advances the first axis and moves each of the
+// other n_axes back and forth.  Once the buffer is full, the oldest block is discarded as if
+// the stepper had consumed it, so every call pays the look-ahead cost of a full buffer.
+// The planner is reset afterwards, so this must only be used when the machine is idle.
+uint32_t plan_benchmark(Channel& out, uint32_t n_segments, float segment_mm, size_t n_axes) {
+    planner_t saved_pl = pl;
+    plan_reset_buffer();
+
+    float target[MAX_N_AXIS];
+    auto  n_axis = config->_axes->_numberAxis;
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        target[axis] = steps_to_mpos(pl.position[axis], axis);
+    }
+
+    plan_line_data_t pl_data = {};
+    pl_data.feed_rate        = config->_axes->_axis[X_AXIS]->_maxRate;
+    pl_data.is_jog           = true;  // Skip the unhomed-axes check; nothing will move
+
+    uint64_t total_ticks = 0;
+    uint32_t max_ticks   = 0;
+    for (uint32_t i = 0; i < n_segments; i++) {
+        target[X_AXIS] += segment_mm;
+        for (size_t axis = Y_AXIS; axis < n_axes; axis++) {
+            target[axis] += (i & 1) ? segment_mm : -segment_mm;
+        }
+        if (plan_check_full_buffer()) {
+            plan_discard_current_block();
+        }
+        int32_t start = getCpuTicks();
+        plan_buffer_line(target, &pl_data);
+        uint32_t ticks = uint32_t(getCpuTicks() - start);
+        total_ticks += ticks;
+        if (ticks > max_ticks) {
+            max_ticks = ticks;
+        }
+    }
+
+    plan_reset_buffer();
+    pl = saved_pl;
+
+    uint32_t avg_ticks = uint32_t(total_ticks / n_segments);
+    uint32_t avg_us    = avg_ticks / ticks_per_us;
+    log_info_to(out,
+                "Planner: " << n_segments << " segments on " << n_axes << " axes, " << config->_planner_blocks << " blocks, avg "
+                            << avg_ticks << " ticks (" << avg_us << " us), max " << max_ticks << " ticks, "
+                            << (avg_us ? 1000000 / avg_us : 0) << " segments/sec");
+    return avg_ticks;
 }
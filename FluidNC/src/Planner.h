@@ -14,31 +14,80 @@
 #include "GCode.h"             // CoolantState
 #include "Types.h"             // AxisMask
 
+#include <cstddef>  // offsetof
 #include <cstdint>
 
+class Channel;
+
 // Define planner data condition flags. Used to denote running conditions of a block.
 struct PlMotion {
     uint8_t rapidMotion : 1;
     uint8_t systemMotion : 1;    // Single motion. Circumvents planner state. Used by home/park.
     uint8_t noFeedOverride : 1;  // Motion does not honor feed override.
     uint8_t inverseTime : 1;     // Interprets feed rate value as inverse time when set.
+    uint8_t spindleSync : 1;     // Paced by the measured spindle speed (G33, G95)
+    uint8_t noCompensation : 1;  // Not corrected by the height map, as for probing
+    uint8_t dwell : 1;           // A pause of plan_block_t::dwell_ms, with no motion
+};
+
+// Geometry of a native arc block.  The segment generator traces the arc from this data,
+// so a whole G2/G3 move occupies a single planner block instead of a run of chords.
+struct plan_arc_t {
+    int32_t start_steps[MAX_N_AXIS];  // Step position at the start of the arc
+    float   delta[MAX_N_AXIS];        // Travel of the axes outside the arc plane (mm)
+    float   center[2];                // Arc center in the arc plane (mm)
+    float   radius;                   // Arc radius (mm)
+    float   start_angle;              // Angle of the start point about the center (radians)
+    float   angular_travel;           // Signed angular travel, positive for counterclockwise (radians)
+    float   length;                   // Total path length including helical travel (mm)
+    uint8_t axis_0;                   // First axis of the arc plane
+    uint8_t axis_1;                   // Second axis of the arc plane
+};
+
+// Geometry of a cartesian line on a machine whose motor space is not cartesian space.  The
+// segment generator converts points along the line to motor positions as it traces it, so
+// the line occupies a single planner block instead of a run of short motor space segments.
+struct plan_kinematic_t {
+    int32_t start_steps[MAX_N_AXIS];  // Step position at the start of the line
+    float   start[MAX_N_AXIS];        // Cartesian start of the line (mm)
+    float   delta[MAX_N_AXIS];        // Cartesian travel of the line (mm)
+    float   length;                   // Cartesian length of the line (mm)
+};
+
+// Lines that can be merged into one line block, see plan_line_data_t::merge_tolerance
+const uint8_t maxMergedLines = 8;
+
+// A line merged into the block before it, for reporting its line number
+struct plan_merged_line_t {
+    float   from_end;     // Distance from its start to the end of the block (mm)
+    int32_t line_number;  // Copied from pl_line_data
 };
 
 // This struct stores a linear movement of a g-code block motion with its critical "nominal" values
 // are as specified in the source g-code.
+//
+// The byte-sized fields are kept together after direction_bits so that they pack without
+// padding, and the data of the kinds of block - arc, kinematic line, merged lines and
+// dwell - share a union, since a block is only one of them.  That halves the size of a
+// block, so the same RAM holds twice as many on boards without PSRAM.
 struct plan_block_t {
     // Fields used by the bresenham algorithm for tracing the line
     // NOTE: Used by stepper algorithm to execute the block correctly. Do not alter these values.
 
     uint32_t steps[MAX_N_AXIS];  // Step count along each axis
     uint32_t step_event_count;   // The maximum step axis count and number of steps required to complete this block.
-    uint8_t  direction_bits;     // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
+    AxisMask direction_bits;     // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
 
     // Block condition data to ensure correct execution depending on states and overrides.
-    PlMotion     motion;       // Block bitflag motion conditions. Copied from pl_line_data.
-    SpindleState spindle;      // Spindle enable state
-    CoolantState coolant;      // Coolant state
-    int32_t      line_number;  // Block line number for real-time reporting. Copied from pl_line_data.
+    PlMotion     motion;            // Block bitflag motion conditions. Copied from pl_line_data.
+    SpindleState spindle;           // Spindle enable state
+    CoolantState coolant;           // Coolant state
+    bool         is_jog : 1;        // Copied from pl_line_data
+    bool         is_arc : 1;        // true if this block is a native arc described by arc
+    bool         is_kinematic : 1;  // true if this block is a cartesian line described by kinematic
+    uint8_t      raster;            // Raster line slot of this block, 0 if none. See Raster.h
+    uint8_t      n_merged;          // Lines after the first that were merged into this block
+    int32_t      line_number;       // Block line number for real-time reporting. Copied from pl_line_data.
 
     // Fields used by the motion planner to manage acceleration. Some of these values may be updated
     // by the stepper module during execution of special motion cases for replanning purposes.
@@ -57,19 +106,28 @@ struct plan_block_t {
     // Stored spindle speed data used by spindle overrides and resuming methods.
     SpindleSpeed spindle_speed;  // Block spindle speed. Copied from pl_line_data.
 
-    bool is_jog;
+    union {
+        plan_arc_t         arc;                     // When is_arc
+        plan_kinematic_t   kinematic;               // When is_kinematic
+        plan_merged_line_t merged[maxMergedLines];  // The first n_merged, for a line block
+        uint32_t           dwell_ms;                // Time left of a dwell block; see plan_buffer_dwell()
+    };
 };
+static_assert(sizeof(PlMotion) == 1, "PlMotion has outgrown its byte");
+static_assert(offsetof(plan_block_t, arc) == sizeof(uint32_t) * (MAX_N_AXIS + 12), "plan_block_t has padding before its union");
 
 // Planner data prototype. Must be used when passing new motions to the planner.
 struct plan_line_data_t {
-    float        feed_rate;       // Desired feed rate for line motion. Value is ignored, if rapid motion.
-    SpindleSpeed spindle_speed;   // Desired spindle speed through line motion.
-    PlMotion     motion;          // Bitflag variable to indicate motion conditions. See defines above.
-    SpindleState spindle;         // Spindle enable state
-    CoolantState coolant;         // Coolant state
-    int32_t      line_number;     // Desired line number to report when executing.
-    bool         is_jog;          // true if this was generated due to a jog command
-    bool         limits_checked;  // true if soft limits already checked
+    float        feed_rate;        // Desired feed rate for line motion. Value is ignored, if rapid motion.
+    SpindleSpeed spindle_speed;    // Desired spindle speed through line motion.
+    PlMotion     motion;           // Bitflag variable to indicate motion conditions. See defines above.
+    SpindleState spindle;          // Spindle enable state
+    CoolantState coolant;          // Coolant state
+    int32_t      line_number;      // Desired line number to report when executing.
+    bool         is_jog;           // true if this was generated due to a jog command
+    bool         limits_checked;   // true if soft limits already checked
+    float        path_tolerance;   // G64 P: corner rounding allowed (mm), 0 for junction_deviation_mm
+    float        merge_tolerance;  // G64 Q or merge_tolerance_mm: lines this close to one line (mm) become one block
 };
 
 void plan_init();
@@ -84,6 +142,34 @@ void plan_reset_buffer();  // Reset buffer only.
 // Returns true on success.
 bool plan_buffer_line(float* target, plan_line_data_t* pl_data);
 
+// Like plan_buffer_line(), but with the target already converted to absolute motor steps.
+bool plan_buffer_line_steps(int32_t* target_steps, plan_line_data_t* pl_data);
+
+// Adds a dwell of ms to the buffer, as a block without motion that the segment generator
+// times in segments without steps, so G4 does not have to wait for the buffer to empty.
+// The moves before it stop at its start, and those after it start from a stop.
+bool plan_buffer_dwell(uint32_t ms, plan_line_data_t* pl_data);
+
+// Add a native arc to the buffer as a single block.  position[] is the start of the arc,
+// center[] is the arc center in the plane of axis_0 and axis_1, and angular_travel is the
+// signed angle swept, positive for counterclockwise.  Axes outside the plane move linearly.
+// Only valid when motor space is cartesian space.  Returns true on success.
+bool plan_buffer_arc(float*            target,
+                     plan_line_data_t* pl_data,
+                     float*            position,
+                     float*            center,
+                     float             radius,
+                     size_t            axis_0,
+                     size_t            axis_1,
+                     float             angular_travel);
+
+// Add a cartesian line to the buffer as a single block, for kinematics that let the segment
+// generator convert it to motor space.  position[] and target[] are cartesian.  The block is
+// planned in cartesian mm, with its rate and acceleration limited by the fastest that each
+// motor moves per mm of the line, from the kinematics' Jacobian where it is provided.
+// Returns false if part of the line cannot be reached.
+bool plan_buffer_kinematic_line(float* target, plan_line_data_t* pl_data, float* position);
+
 // Called when the current block is no longer needed. Discards the block and makes the memory
 // availible for new blocks.
 void plan_discard_current_block();
@@ -91,11 +177,28 @@ void plan_discard_current_block();
 // Gets the planner block for the special system motion cases. (Parking/Homing)
 plan_block_t* plan_get_system_motion_block();
 
+// Called by the step segment buffer for the exit speed of a system motion block, which is
+// only more than zero between parking moves.
+float plan_get_system_exit_speed_sqr();
+
+// Queues a parking move, a system motion, after the parking moves queued so far.  The moves
+// are planned together, so they blend at their junctions.  Returns false if the queue is
+// full or the move has no length.
+bool plan_buffer_park_line(float* target, plan_line_data_t* pl_data);
+
+// Called by the step segment buffer when it has prepped all of a parking move.  Moves on to
+// the next one and returns true if there is one.
+bool plan_next_park_block();
+
+// Drops the parking moves that have not been run
+void plan_reset_park_queue();
+
 // Gets the current block. Returns NULL if buffer empty
 plan_block_t* plan_get_current_block();
 
-// Increment block index with wrap-around
-static uint8_t plan_next_block_index(uint8_t block_index);
+// The line number of the part of block that is being prepped, which for merged lines is not
+// always that of the first
+int32_t plan_get_block_line_number(const plan_block_t* block);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
@@ -113,9 +216,20 @@ void plan_sync_position();
 void plan_cycle_reinitialize();
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available();
+uint32_t plan_get_block_buffer_available();
+
+// Returns the number of blocks queued in the planner buffer
+uint32_t plan_get_block_buffer_count();
+
+// Returns the estimated time in ms to run the buffered blocks
+uint32_t plan_get_buffered_ms();
 
 // Returns the status of the block ring buffer. True, if buffer is full.
-uint8_t plan_check_full_buffer();
+bool plan_check_full_buffer();
+
+// Times plan_buffer_line() over a stream of short segments moving n_axes, which must not
+// be more than the machine has, and reports the result.  Returns the average CPU ticks per
+// segment.  Resets the planner, so it must only be called when idle.
+uint32_t plan_benchmark(Channel& out, uint32_t n_segments, float segment_mm, size_t n_axes = 2);
 
 void plan_get_planner_mpos(float* target);
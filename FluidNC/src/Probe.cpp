@@ -5,6 +5,10 @@
 #include "Probe.h"
 
 #include "Pin.h"
+#include "Stepper.h"             // Stepper::probe_tripped()
+#include "Stepping.h"            // Machine::Stepping::_engine
+#include "MotionControl.h"       // probeState
+#include "Driver/fluidnc_gpio.h"  // gpio_add_interrupt()
 
 // Probe pin initialization routine.
 void Probe::init() {
@@ -47,10 +51,52 @@ bool IRAM_ATTR Probe::tripped() {
     return (_probePin.read() || _toolsetter_Pin.read()) ^ _isProbeAway;
 }
 
+// Either edge, since the pins can be active low and G38.4 probes away
+void IRAM_ATTR Probe::probeISR(void* arg) {
+    auto probe = static_cast<Probe*>(arg);
+    if (probeState == ProbeState::Active && probe->tripped()) {
+        Stepper::probe_tripped(true);
+    }
+}
+
+void Probe::arm() {
+    if (!_latch) {
+        return;
+    }
+    // A streamed I2S engine has counted steps that are still in the DMA buffer
+    if (Machine::Stepping::_engine == Machine::Stepping::I2S_STREAM) {
+        log_debug("Probe latch is not used with the I2S stream engine");
+        return;
+    }
+    for (auto pin : { &_probePin, &_toolsetter_Pin }) {
+        if (pin->defined()) {
+            gpio_add_interrupt(pin->getNative(Pin::Capabilities::Input | Pin::Capabilities::Native), gpioAnyEdge, probeISR, this);
+        }
+    }
+    _latching = true;
+    // In case it tripped before the interrupts were on
+    if (tripped()) {
+        probeISR(this);
+    }
+}
+
+void Probe::disarm() {
+    if (!_latching) {
+        return;
+    }
+    _latching = false;
+    for (auto pin : { &_probePin, &_toolsetter_Pin }) {
+        if (pin->defined()) {
+            gpio_remove_interrupt(pin->getNative(Pin::Capabilities::Input | Pin::Capabilities::Native));
+        }
+    }
+}
+
 void Probe::validate() {}
 
 void Probe::group(Configuration::HandlerBase& handler) {
     handler.item("pin", _probePin);
     handler.item("toolsetter_pin", _toolsetter_Pin);
     handler.item("check_mode_start", _check_mode_start);
+    handler.item("latch", _latch);
 }
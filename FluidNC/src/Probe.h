@@ -23,6 +23,10 @@ class Probe : public Configuration::Configurable {
     Pin _probePin;
     Pin _toolsetter_Pin;
 
+    bool _latch = false;
+
+    static void probeISR(void* arg);
+
 public:
     // Configurable
     bool _check_mode_start = true;
@@ -30,6 +34,11 @@ public:
     // during check mode. false sets the position to the probe target,
     // true sets the position to the start position.
 
+    // With latch set, the trip is caught by an interrupt on the edge of the pin instead
+    // of being sampled at each step tick, and the position is interpolated from the step
+    // timer to a fraction of a step.  True while a probing cycle is watching that way.
+    volatile bool _latching = false;
+
     Probe() = default;
 
     bool exists() const { return _probePin.defined() || _toolsetter_Pin.defined(); }
@@ -45,6 +54,11 @@ public:
     // Returns true if the probe pin is tripped, depending on the direction (away or not)
     bool IRAM_ATTR tripped();
 
+    // Start and stop watching the pins with interrupts, if latch is set, around a probing
+    // motion.  probeState must be Active before arm() is called.
+    void arm();
+    void disarm();
+
     // Configuration handlers.
     void validate() override;
     void group(Configuration::HandlerBase& handler) override;
@@ -6,6 +6,7 @@
 #include "Machine/MachineConfig.h"
 #include "Configuration/RuntimeSetting.h"
 #include "Configuration/AfterParse.h"
+#include "Configuration/PathIndex.h"
 #include "Configuration/Validator.h"
 #include "Configuration/ParseException.h"
 #include "Machine/Axes.h"
@@ -14,30 +15,40 @@
 #include "WebUI/WifiConfig.h"
 #include "Report.h"
 #include "MotionControl.h"
+#include "Planner.h"  // plan_benchmark()
+#include "Stepper.h"  // isr_stats
+#include "Raster.h"   // Raster::load()
 #include "System.h"
 #include "Limits.h"               // homingAxes
 #include "SettingsDefinitions.h"  // build_info
 #include "Protocol.h"             // LINE_BUFFER_SIZE
 #include "UartChannel.h"          // Uart0.write()
 #include "FileStream.h"           // FileStream()
-#include "xmodem.h"               // xmodemReceive(), xmodemTransmit()
+#include "xmodem.h"               // xmodemReceive(), xmodemTransmit(), ymodemReceive()
 #include "StartupLog.h"           // startupLog
+#include "CrashContext.h"         // CrashContext::dump()
 #include "WebUI\Commands.h"
 #include "Driver/fluidnc_gpio.h"  // gpio_dump()
+#include "Driver/soft_wdt.h"      // soft_wdt_stats()
 #include "ProcessSettings.h"
 
 #include "FluidPath.h"
 #include "HTTPClient.h"
 #include "HashFS.h"
+#include "MotionTrace.h"
+#include "JobStats.h"
+#include "JobQueue.h"
+#include "ToolTable.h"
+#include "Benchmark.h"
+#include "HeapProfile.h"
+#include "Motors/TrinamicBase.h"  // calibrate_stallguard()
 
 #include <cstring>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <filesystem>
 
-#include <esp_wifi.h>
-
-int nb_work_done = 0;
-
 // WG Readable and writable as guest
 // WU Readable and writable as user and admin
 // WA Readable as user and admin, writable as admin
@@ -445,6 +456,7 @@ static Error cmd_log_debug(const char* value, WebUI::AuthenticationLevel auth_le
     }
     return Error::Ok;
 }
+
 static Error cmd_log_verbose(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
     if (value) {
         if (*value == '*') {
@@ -568,14 +580,13 @@ static Error home_c(const char* value, WebUI::AuthenticationLevel auth_level, Ch
     return home(bitnum_to_mask(C_AXIS));
 }
 static std::string limit_set(uint32_t mask) {
-    const char* motor0AxisName = "xyzabc";
+    // Motor0 in lower case, the other motors in upper case
     std::string s;
-    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
-        s += bitnum_is_true(mask, Machine::Axes::motor_bit(axis, 0)) ? char(motor0AxisName[axis]) : ' ';
-    }
-    const char* motor1AxisName = "XYZABC";
-    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
-        s += bitnum_is_true(mask, Machine::Axes::motor_bit(axis, 1)) ? char(motor1AxisName[axis]) : ' ';
+    for (int motor = 0; motor < Machine::Axis::MAX_MOTORS_PER_AXIS; motor++) {
+        for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+            char name = Machine::Axes::_names[axis];
+            s += bitnum_is_true(mask, Machine::Axes::motor_bit(axis, motor)) ? (motor ? name : char(tolower(name))) : ' ';
+        }
     }
     return s;
 }
@@ -666,6 +677,36 @@ static Error doJog(const char* value, WebUI::AuthenticationLevel auth_level, Cha
     return gc_execute_line(jogLine);
 }
 
+// $RL=<words>:<base64> runs G1<words> with the decoded row of laser powers.
+// It is a $ command so that the case of the base64 data is kept.
+static Error rasterLine(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    // Like other gcode, blocked in alarm or jog mode
+    if (sys.state == State::Alarm || sys.state == State::ConfigAlarm || sys.state == State::Jog) {
+        return Error::SystemGcLock;
+    }
+    if (!value) {
+        return Error::InvalidStatement;
+    }
+    const char* data = strchr(value, ':');
+    if (!data || (data - value) > LINE_BUFFER_SIZE - 3) {
+        return Error::InvalidStatement;
+    }
+    if (!Raster::enabled()) {
+        log_error_to(out, "Raster lines need a laser spindle");
+        return Error::InvalidStatement;
+    }
+    if (!Raster::load(data + 1)) {
+        return sys.abort ? Error::Reset : Error::BadNumberFormat;
+    }
+    char line[LINE_BUFFER_SIZE];
+    strcpy(line, "G1");
+    strncat(line, value, data - value);
+    Error err = gc_execute_line(line);
+    // The row is dropped if the line did not queue a move
+    Raster::drop();
+    return err;
+}
+
 static Error listAlarms(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
     if (sys.state == State::ConfigAlarm) {
         log_string(out, "Configuration alarm is active. Check the boot messages for 'ERR'.");
@@ -750,86 +791,8 @@ int GetResetWhenPowerOn() {
 }
 
 void ReconnectWifi() {
-    log_debug("Try to reconnext to Wifi");
-    WiFi.mode(WIFI_OFF);
-    esp_wifi_restore();
-
-    delay(100);
-}
-
-void CallURLWithRetryStrategy(String cmd) {
-    const char NB_RTETRY_MAX = 9;
-    char       NbRetry       = NB_RTETRY_MAX;
-
-    if (WiFi.getMode() != WIFI_MODE_NULL) {
-        while ((NbRetry--) && (CallURL(cmd) == NOT_SUCCESSFUL)) {
-            log_info("Retry URL call : " + std::to_string(NB_RTETRY_MAX - NbRetry) + "/" + std::to_string(NB_RTETRY_MAX));
-
-            if (!(WiFi.status() == WL_CONNECTED) || (NbRetry % 3 == 0))
-                ReconnectWifi();
-
-            delay(500);
-        }
-    }
-}
-
-urlFeedback CallURL(String cmd) {
-    HTTPClient       http;
-    WiFiClientSecure client;
-
-    String url, urlDebug;
-    String host = WebUI::URL_ToCall->get();
-
-    client.setInsecure();
-    client.connect(host.c_str(), 443);
-    //if (!client.connect(host.c_str(), 443))
-    //    log_info("Connection to server failed! - Wifi status : " + std::to_string(WiFi.status()) + " - Wifi Mode : " +std::to_string(WiFi.getMode()) )
-
-    {
-        //log_info("Connection succesfully to server !");
-
-        log_debug("Start calling URL");
-        url = host;
-        if (cmd != "") {
-            url += "?";
-            url += cmd;
-        }
-
-        urlDebug = "URL to call  : " + url;
-        host     = "Host : '" + host + "'";
-
-        log_debug(urlDebug.c_str());
-        log_debug(host.c_str());
-
-        if (((WiFi.status() == WL_CONNECTED)) && ((WiFi.getMode() == WIFI_MODE_STA) || (WiFi.getMode() == WIFI_MODE_APSTA))) {
-            if (host != "") {
-                http.begin(client, url.c_str());  //Specify the URL and certificate
-                int httpCode = http.GET();        //Make the request
-
-                if (httpCode > 0) {  //Check for the returning code
-                    log_info("URL call successful");
-                    http.end();
-                    client.stop();
-                    return URL_CALL_OK;
-
-                } else {
-                    log_info("Failed to call URL");
-                    http.end();
-                    client.stop();
-                    return NOT_SUCCESSFUL;
-                }
-
-            } else {
-                log_debug("No URL to call");
-                client.stop();
-                return NO_URL;
-            }
-        } else {
-            log_debug("Wifi is not connected in STA Mode");
-            client.stop();
-            return NO_GOOD_MODE;
-        }
-    }
+    log_debug("Try to reconnect to Wifi");
+    WebUI::WiFiConfig::reconnect();
 }
 
 static Error motor_control(const char* value, bool disable) {
@@ -877,23 +840,69 @@ static Error motors_init(const char* value, WebUI::AuthenticationLevel auth_leve
     return Error::Ok;
 }
 
+static Error stallguard_calibrate(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (sys.state != State::Idle) {
+        return Error::IdleError;
+    }
+    if (!value || !*value) {
+        log_error("$SG/Calibrate requires axis letters");
+        return Error::InvalidStatement;
+    }
+    auto axes = config->_axes;
+    for (int i = 0; i < axes->_numberAxis; i++) {
+        char axisName = axes->axisName(i);
+        if ((strchr(value, axisName) || strchr(value, tolower(axisName))) && !MotorDrivers::TrinamicBase::calibrate_stallguard(i)) {
+            return Error::InvalidStatement;
+        }
+    }
+    return Error::Ok;
+}
+
 static Error raz_work_done(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
-    nb_work_done = 0;
+    JobStats::reset_jobs();
 
     log_info("Raz done - work done : 0");
 
     return Error::Ok;
 }
 
+static Error show_job_stats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return JobStats::show(value, out);
+}
+
+static Error show_tool_table(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return ToolTable::show(value, out);
+}
+
+static Error jobs_add(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return JobQueue::add(value, auth_level, out);
+}
+static Error jobs_list(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return JobQueue::list(out);
+}
+static Error jobs_clear(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return JobQueue::clear(out);
+}
+static Error jobs_start(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return JobQueue::start(out);
+}
+static Error jobs_stop(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return JobQueue::stop(out);
+}
+
+// $Macros/Run=N runs macroN from the configuration; any other value is the name of a
+// file on the local file system, run as a macro
 static Error macros_run(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
-    if (value) {
-        log_info("Running macro" << *value);
+    if (!value || !*value) {
+        log_error("$Macros/Run requires a macro number or file name argument");
+        return Error::InvalidStatement;
+    }
+    if (value[0] >= '0' && value[0] < '0' + Machine::Macros::n_macros && !value[1]) {
         size_t macro_num = (*value) - '0';
         config->_macros->_macro[macro_num].run();
         return Error::Ok;
     }
-    log_error("$Macros/Run requires a macro number argument");
-    return Error::InvalidStatement;
+    return Machine::Macro::runFile(value) ? Error::Ok : Error::InvalidStatement;
 }
 
 static Error xmodem_receive(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
@@ -936,6 +945,52 @@ static Error xmodem_receive(const char* value, WebUI::AuthenticationLevel auth_l
     return size < 0 ? Error::UploadFailed : Error::Ok;
 }
 
+// Receives a YMODEM batch into the directory given, or the top of the local file system.
+// Nothing is logged until the transfer is over, since it would go to the sender.
+static Error ymodem_receive(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    std::string dir = value ? value : "";
+    if (!dir.empty() && dir.back() != '/') {
+        dir += '/';
+    }
+
+    std::vector<std::pair<std::string, int>> received;
+
+    pollingPaused = true;
+    bool oldCr    = out.setCr(false);
+    delay_ms(1000);
+    int files = ymodemReceive(
+        &out,
+        [&dir](const char* name) -> FileStream* {
+            // Any directories in the name are the sender's, not ours
+            std::string fname = dir + std::filesystem::path(name).filename().string();
+            try {
+                return new FileStream(fname, "w");
+            } catch (...) { return nullptr; }
+        },
+        [&received](FileStream* file, int size) {
+            std::filesystem::path fname = file->fpath();
+            received.emplace_back(file->path(), size);
+            delete file;
+            HashFS::rehash_file(fname);
+        });
+    out.setCr(oldCr);
+    pollingPaused = false;
+
+    for (auto& [path, size] : received) {
+        if (size >= 0) {
+            log_info("Received " << size << " bytes to file " << path);
+        } else {
+            log_info("Reception of " << path << " failed or was canceled");
+        }
+    }
+    if (files < 0) {
+        log_info("Batch reception failed or was canceled");
+        return Error::UploadFailed;
+    }
+    log_info("Received " << files << " files");
+    return Error::Ok;
+}
+
 static Error xmodem_send(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
     if (!value || !*value) {
         value = "config.yaml";
@@ -1008,6 +1063,11 @@ static Error showStartupLog(const char* value, WebUI::AuthenticationLevel auth_l
     return Error::Ok;
 }
 
+static Error showCrashContext(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    CrashContext::dump(out);
+    return Error::Ok;
+}
+
 static Error showGPIOs(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
     gpio_dump(out);
     return Error::Ok;
@@ -1044,11 +1104,314 @@ static Error setReportInterval(const char* value, WebUI::AuthenticationLevel aut
     return Error::Ok;
 }
 
+static Error setDeltaStatus(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (value) {
+        if (!strcasecmp(value, "ON")) {
+            out.setDeltaStatus(true);
+        } else if (!strcasecmp(value, "OFF")) {
+            out.setDeltaStatus(false);
+        } else {
+            return Error::InvalidValue;
+        }
+    }
+    log_info_to(out, out.name() << " delta status reports are " << (out.deltaStatus() ? "on" : "off"));
+    return Error::Ok;
+}
+
+static Error setStreamWindow(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (!value) {
+        uint32_t actual = out.getStreamWindow();
+        if (actual) {
+            log_info_to(out, out.name() << " streaming with a " << actual << " byte window and batched acks");
+        } else {
+            log_info_to(out, out.name() << " streaming is off");
+        }
+        return Error::Ok;
+    }
+    char*    endptr;
+    uint32_t intValue = strtol(value, &endptr, 10);
+
+    if (endptr == value || *endptr != '\0') {
+        return Error::BadNumberFormat;
+    }
+
+    uint32_t actual = out.setStreamWindow(intValue);
+    if (actual) {
+        log_info_to(out, out.name() << " streaming window set to " << actual << " bytes");
+    } else {
+        log_info_to(out, out.name() << " streaming turned off");
+    }
+    return Error::Ok;
+}
+
+static Error planner_benchmark(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    uint32_t n_segments = 1000;
+    if (value) {
+        char* endptr;
+        n_segments = strtol(value, &endptr, 10);
+        if (endptr == value || *endptr != '\0' || n_segments == 0) {
+            return Error::BadNumberFormat;
+        }
+    }
+    plan_benchmark(out, n_segments, 0.05f);
+    return Error::Ok;
+}
+
+static Error kinematics_benchmark(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    uint32_t n_points = 10000;
+    if (value) {
+        char* endptr;
+        n_points = strtol(value, &endptr, 10);
+        if (endptr == value || *endptr != '\0' || n_points == 0) {
+            return Error::BadNumberFormat;
+        }
+    }
+    config->_kinematics->benchmark(out, n_points);
+    return Error::Ok;
+}
+
+static Error run_benchmarks(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return Benchmark::run(out);
+}
+
+static Error stepping_bench(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    uint32_t ms = 2000;
+    if (value) {
+        char* endptr;
+        ms = strtol(value, &endptr, 10);
+        if (endptr == value || *endptr != '\0') {
+            return Error::BadNumberFormat;
+        }
+        if (ms < 100 || ms > 60000) {
+            return Error::NumberRange;
+        }
+    }
+    return config->_stepping->bench(out, ms);
+}
+
+static Error stepping_stats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (value) {
+        if (strcasecmp(value, "reset")) {
+            return Error::InvalidValue;
+        }
+        Stepper::reset_isr_stats();
+        return Error::Ok;
+    }
+    auto stats = Stepper::isr_stats;  // Copy, since the ISR keeps updating it
+    if (stats.count == 0) {
+        log_info_to(out, "No step interrupts since reset");
+        return Error::Ok;
+    }
+    uint32_t avg_ticks = stats.total_ticks / stats.count;
+    log_info_to(out,
+                "ISR: " << stats.count << " calls, min/avg/max " << stats.min_ticks << "/" << avg_ticks << "/" << stats.max_ticks
+                        << " ticks (" << stats.min_ticks / ticks_per_us << "/" << avg_ticks / ticks_per_us << "/"
+                        << stats.max_ticks / ticks_per_us << " us), underruns " << stats.underruns);
+    log_info_to(out,
+                "Flash cache off: " << stats.cache_off << " calls, max " << stats.cache_off_max_ticks << " ticks ("
+                                    << stats.cache_off_max_ticks / ticks_per_us << " us)");
+
+    {
+        LogStream latency(out, MsgLevelInfo, "[MSG:INFO: Latency us:");
+        for (int bin = 0; bin < Stepper::isrLatencyBins; bin++) {
+            if (bin == Stepper::isrLatencyBins - 1) {
+                latency << " >=" << (1 << (bin - 1));
+            } else {
+                latency << " <" << (1 << bin);
+            }
+            latency << ":" << stats.latency[bin];
+        }
+    }  // The destructor sends the line
+
+    // At maxPulsesPerSec() the ISR runs for every pulse, so its longest run must fit in one period
+    // In ns, since the period is under a microsecond on the faster engines
+    uint32_t max_pulses = config->_stepping->maxPulsesPerSec();
+    if (max_pulses == 0) {
+        return Error::Ok;
+    }
+    uint32_t period_ns = 1000000000 / max_pulses;
+    uint32_t max_ns    = uint32_t(uint64_t(stats.max_ticks) * 1000 / ticks_per_us);
+    log_info_to(out,
+                "Budget: longest ISR " << max_ns << " ns of " << period_ns << " ns at " << max_pulses << " pulses/sec ("
+                                       << max_ns * 100 / period_ns << "%)");
+    return Error::Ok;
+}
+
+static Error stepping_trace(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (!value) {
+        log_info_to(out, "Position trace is " << (Stepper::tracing() ? "running" : "off"));
+        return Error::Ok;
+    }
+    if (!strcasecmp(value, "off")) {
+        Stepper::stop_trace();
+        return Error::Ok;
+    }
+    char*    endptr;
+    uint32_t rate = strtol(value, &endptr, 10);
+    if (endptr == value || *endptr != '\0') {
+        return Error::BadNumberFormat;
+    }
+    if (rate == 0) {
+        Stepper::stop_trace();
+        return Error::Ok;
+    }
+    if (rate > Stepper::maxTraceRate) {
+        return Error::InvalidValue;
+    }
+
+    // Each [TRACE:usecs,steps...] line has the step counts of every axis, which these convert to mm
+    {
+        LogStream msg(out, "[MSG:INFO: Position trace at ");
+        msg << rate << " Hz, steps/mm";
+        auto n_axis = config->_axes->_numberAxis;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            msg << " " << config->_axes->axisName(axis) << ":" << config->_axes->_axis[axis]->_stepsPerMm;
+        }
+    }
+    Stepper::start_trace(out, rate);
+    return Error::Ok;
+}
+
+static Error motion_trace(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (value) {
+        if (!strcasecmp(value, "ON")) {
+            if (!MotionTrace::start()) {
+                log_error_to(out, "No memory for the motion trace");
+                return Error::InvalidValue;
+            }
+        } else if (!strcasecmp(value, "OFF")) {
+            MotionTrace::stop();
+        } else {
+            return Error::InvalidValue;
+        }
+    }
+    log_info_to(out, "Motion trace is " << (MotionTrace::enabled ? "on" : "off"));
+    return Error::Ok;
+}
+
+// Changing the map while moves are queued would step Z, so this is only for idle
+static Error height_map(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    auto heightMap = config->_heightMap;
+    if (value) {
+        Error err = Error::Ok;
+        if (!strcasecmp(value, "ON")) {
+            err = heightMap->enable(true);
+        } else if (!strcasecmp(value, "OFF")) {
+            err = heightMap->enable(false);
+        } else if (!strcasecmp(value, "CLEAR")) {
+            heightMap->clear();
+        } else {
+            return Error::InvalidValue;
+        }
+        if (err != Error::Ok) {
+            return err;
+        }
+    }
+    heightMap->show(out);
+    return Error::Ok;
+}
+
+static Error height_map_probe(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    return config->_heightMap->probe(value, out);
+}
+
+static Error motion_trace_dump(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (!value) {
+        MotionTrace::dump(out);
+        return Error::Ok;
+    }
+    // Use a file on the local file system unless there is an explicit prefix like /sd/
+    Channel* ss;
+    try {
+        ss = new FileStream(value, "w", "");
+    } catch (Error err) { return err; }
+    MotionTrace::dump(*ss);
+    drain_messages();
+    delete ss;
+    return Error::Ok;
+}
+
 static Error showHeap(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
     log_info("Heap free: " << xPortGetFreeHeapSize() << " min: " << heapLowWater);
     return Error::Ok;
 }
 
+#ifdef DEBUG_HEAP_PROFILE
+// $Heap/Top lists the 10 call sites that allocated the most, $Heap/Top=<n> the top n,
+// and $Heap/Top=reset starts the counts again
+static Error showHeapTop(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    if (value && strcasecmp(value, "reset") == 0) {
+        HeapProfile::reset();
+        return Error::Ok;
+    }
+    int nTop = 10;
+    if (value) {
+        char* end;
+        nTop = strtol(value, &end, 10);
+        if (*end || nTop <= 0) {
+            return Error::InvalidValue;
+        }
+    }
+    HeapProfile::report(out, nTop);
+    return Error::Ok;
+}
+#endif
+
+// Lists every FreeRTOS task with its priority, core, free stack and, when the build has
+// run-time stats, its share of one core since the previous $System/Tasks.
+static Error showTasks(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
+#if configUSE_TRACE_FACILITY
+    std::vector<TaskStatus_t> tasks(uxTaskGetNumberOfTasks() + 4);  // Room for tasks created meanwhile
+    uint32_t                  totalRuntime;
+    tasks.resize(uxTaskGetSystemState(tasks.data(), tasks.size(), &totalRuntime));
+    std::sort(tasks.begin(), tasks.end(), [](const TaskStatus_t& a, const TaskStatus_t& b) {
+        return a.uxCurrentPriority > b.uxCurrentPriority;
+    });
+
+#    if configGENERATE_RUN_TIME_STATS
+    static std::map<TaskHandle_t, uint32_t> lastRuntime;
+    static uint32_t                         lastTotal = 0;
+    uint32_t                                interval  = totalRuntime - lastTotal;
+
+    lastTotal = totalRuntime;
+#    endif
+
+    for (auto& task : tasks) {
+        LogStream msg(out, MsgLevelInfo, "[MSG:INFO: ");
+        msg << task.pcTaskName << " pri " << int(task.uxCurrentPriority);
+#    if configTASKLIST_INCLUDE_COREID
+        if (task.xCoreID == tskNO_AFFINITY) {
+            msg << " core any";
+        } else {
+            msg << " core " << int(task.xCoreID);
+        }
+#    endif
+        msg << " stack free " << int(task.usStackHighWaterMark);
+#    if configGENERATE_RUN_TIME_STATS
+        uint32_t runtime          = task.ulRunTimeCounter - lastRuntime[task.xHandle];
+        lastRuntime[task.xHandle] = task.ulRunTimeCounter;
+        if (interval) {
+            msg << " cpu " << setprecision(1) << runtime * 100.0f / interval << "%";
+        }
+#    endif
+    }
+#    if !configGENERATE_RUN_TIME_STATS
+    log_info_to(out, "CPU use is not shown because this build has no FreeRTOS run-time stats");
+#    endif
+#else
+    log_info_to(out, "Task listing needs a build with the FreeRTOS trace facility");
+#endif
+    log_info_to(out, "Segment buffer underruns: " << Stepper::isr_stats.underruns);
+
+    // The longest gaps since the previous $System/Tasks, which are then reset
+    SoftWdtStats realtime = soft_wdt_stats(SoftWdtRealtime);
+    SoftWdtStats prep     = soft_wdt_stats(SoftWdtPrep);
+    soft_wdt_reset_stats();
+    log_info_to(out, "Longest gap between realtime checks " << realtime.maxGapUs << " us, " << realtime.stalls << " stalls");
+    log_info_to(out, "Longest gap between segment refills " << prep.maxGapUs << " us, " << prep.stalls << " stalls");
+    return Error::Ok;
+}
+
 // Commands use the same syntax as Settings, but instead of setting or
 // displaying a persistent value, a command causes some action to occur.
 // That action could be anything, from displaying a run-time parameter
@@ -1060,10 +1423,14 @@ void make_user_commands() {
     new UserCommand("CI", "Channel/Info", showChannelInfo, anyState);
     new UserCommand("XR", "Xmodem/Receive", xmodem_receive, anyState);
     new UserCommand("XS", "Xmodem/Send", xmodem_send, anyState);
+    new UserCommand("YR", "Ymodem/Receive", ymodem_receive, anyState);
     new UserCommand("CD", "Config/Dump", dump_config, anyState);
     new UserCommand("", "Help", show_help, anyState);
     new UserCommand("T", "State", showState, anyState);
     new UserCommand("J", "Jog", doJog, notIdleOrJog);
+    new UserCommand("RL", "Raster/Line", rasterLine, anyState);
+    new UserCommand("HM", "HeightMap", height_map, notIdleOrAlarm);
+    new UserCommand("HMP", "HeightMap/Probe", height_map_probe, notIdleOrAlarm);
 
     new UserCommand("$", "GrblSettings/List", report_normal_settings, cycleOrHold);
     new UserCommand("L", "GrblNames/List", list_grbl_names, cycleOrHold);
@@ -1083,9 +1450,18 @@ void make_user_commands() {
     new UserCommand("MD", "Motor/Disable", motor_disable, notIdleOrAlarm);
     new UserCommand("ME", "Motor/Enable", motor_enable, notIdleOrAlarm);
     new UserCommand("MI", "Motors/Init", motors_init, notIdleOrAlarm);
+    new UserCommand("SGC", "SG/Calibrate", stallguard_calibrate, notIdleOrAlarm);
     new UserCommand("RW", "Raz number of work done", raz_work_done, anyState);
+    new UserCommand("ST", "Stats", show_job_stats, anyState);
+    new UserCommand("TT", "Tools", show_tool_table, anyState);
+
+    new UserCommand("JA", "Jobs/Add", jobs_add, anyState);
+    new UserCommand("JL", "Jobs/List", jobs_list, anyState);
+    new UserCommand("JC", "Jobs/Clear", jobs_clear, anyState);
+    new UserCommand("JS", "Jobs/Start", jobs_start, anyState);  // JobQueue::start() checks the state
+    new UserCommand("JX", "Jobs/Stop", jobs_stop, anyState);
 
-    new UserCommand("RM", "Macros/Run", macros_run, notIdleOrAlarm);
+    new UserCommand("RM", "Macros/Run", macros_run, anyState);  // Macro::queue() checks the state
 
     new UserCommand("HX", "Home/X", home_x, anyState);
     new UserCommand("HY", "Home/Y", home_y, anyState);
@@ -1105,14 +1481,29 @@ void make_user_commands() {
     new UserCommand("LV  ", "Log/Verbose", cmd_log_verbose, anyState);
 
     new UserCommand("SLP", "System/Sleep", go_to_sleep, notIdleOrAlarm);
+    new UserCommand("TASKS", "System/Tasks", showTasks, anyState);
     new UserCommand("I", "Build/Info", get_report_build_info, notIdleOrAlarm);
     new UserCommand("N", "GCode/StartupLines", show_startup_lines, notIdleOrAlarm);
     new UserCommand("RST", "Settings/Restore", restore_settings, notIdleOrAlarm, WA);
 
     new UserCommand("Heap", "Heap/Show", showHeap, anyState);
+#ifdef DEBUG_HEAP_PROFILE
+    new UserCommand("HT", "Heap/Top", showHeapTop, anyState);
+#endif
+    new UserCommand("PB", "Planner/Benchmark", planner_benchmark, notIdleOrAlarm);
+    new UserCommand("KB", "Kinematics/Benchmark", kinematics_benchmark, notIdleOrAlarm);
+    new UserCommand("BM", "Benchmark", run_benchmarks, notIdleOrAlarm);
+    new UserCommand("STS", "Stepping/Stats", stepping_stats, anyState);
+    new UserCommand("STB", "Stepping/Bench", stepping_bench, notIdleOrAlarm);
+    new UserCommand("STT", "Stepping/Trace", stepping_trace, anyState);
+    new UserCommand("TM", "Trace/Motion", motion_trace, anyState);
+    new UserCommand("TD", "Trace/Dump", motion_trace_dump, anyState);
     new UserCommand("SS", "Startup/Show", showStartupLog, anyState);
+    new UserCommand("CS", "Crash/Show", showCrashContext, anyState);
 
     new UserCommand("RI", "Report/Interval", setReportInterval, anyState);
+    new UserCommand("RD", "Report/Delta", setDeltaStatus, anyState);
+    new UserCommand("SW", "Stream/Window", setStreamWindow, anyState);
 
     new UserCommand("30", "FakeMaxSpindleSpeed", fakeMaxSpindleSpeed, notIdleOrAlarm);
     new UserCommand("32", "FakeLaserMode", fakeLaserMode, notIdleOrAlarm);
@@ -1164,8 +1555,10 @@ Error do_command_or_setting(const char* key, char* value, WebUI::AuthenticationL
     // First search the yaml settings by name. If found, set a new
     // value if one is given, otherwise display the current value
     try {
-        Configuration::RuntimeSetting rts(key, value, out);
-        config->group(rts);
+        const char*                   leaf;
+        auto                          section = Configuration::PathIndex::find(key, leaf);
+        Configuration::RuntimeSetting rts(key, value, out, section ? leaf : nullptr);
+        (section ? section : config)->group(rts);
 
         if (rts.isHandled_) {
             if (value) {
@@ -1182,6 +1575,7 @@ Error do_command_or_setting(const char* key, char* value, WebUI::AuthenticationL
                 Configuration::AfterParse afterParseHandler;
                 config->afterParse();
                 config->group(afterParseHandler);
+                Configuration::PathIndex::build(config);
             }
             return Error::Ok;
         }
@@ -1193,47 +1587,40 @@ Error do_command_or_setting(const char* key, char* value, WebUI::AuthenticationL
         return Error::ConfigurationInvalid;
     }
 
-    // Next search the settings list by text name. If found, set a new
+    // Next look for a setting by text name. If found, set a new
     // value if one is given, otherwise display the current value
-    for (Setting* s : Setting::List) {
-        if (strcasecmp(s->getName(), key) == 0) {
-            if (auth_failed(s, value, auth_level)) {
-                return Error::AuthenticationFailed;
-            }
-            if (value) {
-                return s->setStringValue(uriDecode(value));
-            } else {
-                show_setting(s->getName(), s->getStringValue(), NULL, out);
-                return Error::Ok;
-            }
+    if (Setting* s = Setting::find(key)) {
+        if (auth_failed(s, value, auth_level)) {
+            return Error::AuthenticationFailed;
         }
+        if (value) {
+            return s->setStringValue(uriDecode(value));
+        }
+        show_setting(s->getName(), s->getStringValue(), NULL, out);
+        return Error::Ok;
     }
 
-    // Then search the setting list by compatible name.  If found, set a new
+    // Then look for a setting by compatible name.  If found, set a new
     // value if one is given, otherwise display the current value in compatible mode
-    for (Setting* s : Setting::List) {
-        if (s->getGrblName() && strcasecmp(s->getGrblName(), key) == 0) {
-            if (auth_failed(s, value, auth_level)) {
-                return Error::AuthenticationFailed;
-            }
-            if (value) {
-                return s->setStringValue(uriDecode(value));
-            } else {
-                show_setting(s->getGrblName(), s->getCompatibleValue(), NULL, out);
-                return Error::Ok;
-            }
+    if (Setting* s = Setting::findGrbl(key)) {
+        if (auth_failed(s, value, auth_level)) {
+            return Error::AuthenticationFailed;
         }
+        if (value) {
+            return s->setStringValue(uriDecode(value));
+        }
+        show_setting(s->getGrblName(), s->getCompatibleValue(), NULL, out);
+        return Error::Ok;
     }
+
     // If we did not find a setting, look for a command.  Commands
     // handle values internally; you cannot determine whether to set
     // or display solely based on the presence of a value.
-    for (Command* cp : Command::List) {
-        if ((strcasecmp(cp->getName(), key) == 0) || (cp->getGrblName() && strcasecmp(cp->getGrblName(), key) == 0)) {
-            if (auth_failed(cp, value, auth_level)) {
-                return Error::AuthenticationFailed;
-            }
-            return cp->action(value, auth_level, out);
+    if (Command* cp = Command::find(key)) {
+        if (auth_failed(cp, value, auth_level)) {
+            return Error::AuthenticationFailed;
         }
+        return cp->action(value, auth_level, out);
     }
 
     // If we did not find an exact match and there is no value,
@@ -1320,6 +1707,10 @@ Error execute_line(char* line, Channel& channel, WebUI::AuthenticationLevel auth
     if (sys.state == State::Alarm || sys.state == State::ConfigAlarm || sys.state == State::Jog) {
         return Error::SystemGcLock;
     }
+    if (line[0] == compiledLineMarker) {
+        // From the g-code cache of a file job, which reports errors with the line number
+        return gc_execute_compiled(line);
+    }
     Error result = gc_execute_line(line);
     if (result != Error::Ok) {
         log_debug_to(channel, "Bad GCode: " << line);
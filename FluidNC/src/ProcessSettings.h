@@ -7,11 +7,9 @@ typedef enum : unsigned char {
     NOT_SUCCESSFUL,
 } urlFeedback;
 
-urlFeedback CallURL(String cmd);
-void        CallURLWithRetryStrategy(String cmd);
+void        ReconnectWifi();
 String      GetCMDEndPrg();
 String      GetCMDStartPrg();
 int         GetStartURLWithM345();
 int         GetStartURLWithM100();
 int         GetResetWhenPowerOn();
-extern int  nb_work_done;
\ No newline at end of file
@@ -22,6 +22,22 @@
 #include "Logging.h"
 #include "Machine/LimitPin.h"
 #include "ProcessSettings.h"
+#include "MotionTrace.h"
+#include "MotionBench.h"
+#include "LatencyProbe.h"
+#include "JobStats.h"
+#include "JobQueue.h"
+#include "Extents.h"
+#include "Telemetry.h"
+#include "ToolTable.h"
+#include "HomeMemory.h"
+#include "CrashContext.h"
+#include "LineQueue.h"
+#include "OWord.h"  // OWord::recording()
+#include "SettingsDefinitions.h"  // stall_ms
+#include "Driver/soft_wdt.h"
+#include "Jog.h"  // jog_velocity_poll()
+#include <cstring>
 
 volatile ExecAlarm lastAlarm;  // The most recent alarm code
 
@@ -42,6 +58,11 @@ std::map<ExecAlarm, const char*> AlarmNames = {
     { ExecAlarm::HardStop, "Hard Stop" },
     { ExecAlarm::Unhomed, "Unhomed" },
     { ExecAlarm::Init, "Init" },
+    { ExecAlarm::StepLoss, "Step Loss" },
+    { ExecAlarm::DriverShutdown, "Driver Shutdown" },
+    { ExecAlarm::DriverOverTemp, "Driver Over Temp" },
+    { ExecAlarm::PositionError, "Position Error" },
+    { ExecAlarm::LinkLost, "Sync Link Lost" },
 };
 
 const char* alarmString(ExecAlarm alarmNumber) {
@@ -95,54 +116,127 @@ TaskHandle_t outputTask = nullptr;
 
 xQueueHandle message_queue;
 
-void drain_messages() {
-    while (uxQueueMessagesWaiting(message_queue)) {
+// When messages arrive in a burst, the output task holds them for up to
+// outputFlushMs so that each channel receives the whole burst in one write(),
+// which is one packet or frame for network channels.  A lone message is
+// sent at once.
+static const TickType_t outputFlushMs       = 5;
+static const int        maxOutputBatchChans = 8;
+
+static volatile bool outputPending = false;
+
+bool drain_messages(uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    while (uxQueueMessagesWaiting(message_queue) || outputPending) {
+        if (timeout_ms != UINT32_MAX && (xTaskGetTickCount() - start) * portTICK_PERIOD_MS >= timeout_ms) {
+            return false;
+        }
         vTaskDelay(1);  // Let the output task finish sending data
     }
+    return true;
 }
 
 void output_loop(void* unused) {
+    Channel* batched[maxOutputBatchChans];
     while (true) {
         // Block until a message is received
         LogMessage message;
-        if (xQueueReceive(message_queue, &message, portMAX_DELAY)) {
+        if (!xQueueReceive(message_queue, &message, portMAX_DELAY)) {
+            continue;
+        }
+        outputPending = true;
+
+        int        nBatched = 0;
+        int        count    = 0;
+        TickType_t wait     = 0;
+        TickType_t deadline = 0;
+        do {
+            Channel* channel = message.channel;
+            if (std::find(batched, batched + nBatched, channel) == batched + nBatched && nBatched < maxOutputBatchChans) {
+                batched[nBatched++] = channel;
+                channel->beginOutputBatch();
+            }
             if (message.isString) {
                 std::string* s = static_cast<std::string*>(message.line);
-                message.channel->print_msg(message.level, s->c_str());
+                channel->print_msg(message.level, s->c_str());
                 delete s;
             } else {
                 const char* cp = static_cast<const char*>(message.line);
-                message.channel->print_msg(message.level, cp);
+                channel->print_msg(message.level, cp);
+                log_pool_release(cp);
+            }
+            // A second message means a burst, so wait a little for the rest of it
+            if (++count == 2) {
+                deadline = xTaskGetTickCount() + outputFlushMs / portTICK_PERIOD_MS;
+            }
+            if (count >= 2) {
+                int32_t left = int32_t(deadline - xTaskGetTickCount());
+                wait         = left > 0 ? left : 0;
             }
+        } while (xQueueReceive(message_queue, &message, wait));
+
+        for (int i = 0; i < nBatched; ++i) {
+            batched[i]->flushOutputBatch();
         }
+        outputPending = false;
     }
 }
 
-Channel* activeChannel = nullptr;  // Channel associated with the input line
+Channel* activeChannel = nullptr;  // Channel associated with the line that is executing
 
 TaskHandle_t pollingTask = nullptr;
+TaskHandle_t mainTask    = nullptr;
+
+// Longest sleeps between polls of the input channels and between passes of
+// the idle main loop.  Sources that cannot notify, like the UART driver's
+// receive buffer, are serviced at least this often.
+static const TickType_t pollTicks     = 1;
+static const TickType_t mainIdleTicks = 10;
+
+void protocol_notify_polling() {
+    if (pollingTask) {
+        xTaskNotifyGive(pollingTask);
+    }
+}
 
-char activeLine[Channel::maxLine];
+void protocol_notify_main() {
+    if (mainTask) {
+        xTaskNotifyGive(mainTask);
+    }
+}
+
+void IRAM_ATTR protocol_notify_main_from_ISR() {
+    if (mainTask) {
+        vTaskNotifyGiveFromISR(mainTask, NULL);
+    }
+}
+
+char        activeLine[Channel::maxLine];
+static char activeCompiled[maxCompiledLength];
+static char polledLine[Channel::maxLine];
 
 bool pollingPaused = false;
+
+static volatile bool cycleStartHeld = false;  // See protocol_hold_cycle_start()
 void polling_loop(void* unused) {
-    // Poll the input sources waiting for a complete line to arrive
+    // Poll the input sources for complete lines, queueing them for the primary loop
     for (; true; /*feedLoopWDT(), */ vTaskDelay(0)) {
         // Polling is paused when xmodem is using a channel for binary upload
         if (pollingPaused) {
             vTaskDelay(100);
             continue;
         }
-        if (activeChannel) {
-            // Poll for realtime characters when waiting for the primary loop
-            // (in another thread) to pick up the line.
-            pollChannels();
-            continue;
+        // Polling both checks for realtime characters and returns a line-oriented
+        // command from a channel that has room in the line queue, if one is ready.
+        Channel* channel = pollChannels(polledLine);
+        if (channel) {
+            LineQueue::push(channel, polledLine);
+            protocol_notify_main();
+            continue;  // Look for more lines before sleeping
         }
-
-        // Polling without an argument both checks for realtime characters and
-        // returns a line-oriented command if one is ready.
-        activeChannel = pollChannels(activeLine);
+        // Sleep until the primary loop is done with a line, a push-style channel
+        // receives data, or it is time to poll again.
+        ulTaskNotifyTake(pdTRUE, pollTicks);
     }
 }
 
@@ -176,73 +270,124 @@ void start_polling() {
     }
 }
 
+// The main loop waits for the alarm to reach the channels before it goes on, but no longer
+// than alarmDrainMs, so a slow channel cannot hold up a reset or an unlock.
+static const uint32_t alarmDrainMs = 100;
+
 static void alarm_msg(ExecAlarm alarm_code) {
     log_info_to(allChannels, "ALARM: " << alarmString(alarm_code));
     log_stream(allChannels, "ALARM:" << static_cast<int>(alarm_code));
-    delay_ms(500);  // Force delay to ensure message clears serial write buffer.
+    drain_messages(alarmDrainMs);
 }
 
 static void check_startup_state() {}
 
 bool GetPowerLineValue() {
-    for (auto pin : config->_control->_pins)
-        if (pin->_legend == "power_pin")
-            return !(pin->get());
-
-    return 1;
-}
-
-void Check_Power_Presence_And_Reset() {
-    static int v_old        = 1;
-    static int Autorisation = 0;
-    static int n            = 0;
-
-    int v = GetPowerLineValue();
-
-    if ((v == 1) && (v_old == 0)) {
-        Autorisation = 1;
-    }
-    v_old = v;
-
-    if (Autorisation) {
-        n++;
-        delay_ms(1);
-        if (n > 100) {
-            Autorisation = 0;
-            n            = 0;
-            if (v == 1) {
-                log_info("POWER ON DETECTED");
-                if (GetResetWhenPowerOn()) {
-                    log_info("BOARD RESET - see $ResetOnPowerON if you want to disable this feature");
-                    delay_ms(2000);
-                    ESP.restart();
-                }
-            }
-        }
-    }
+    return config->_control->powered();
 }
 
 const uint32_t heapWarnThreshold      = 15000;
 uint32_t       heapLowWater           = UINT_MAX;
 uint32_t       heapLowWaterReported   = UINT_MAX;
+uint32_t       linesExecuted          = 0;
 int32_t        heapLowWaterReportTime = 0;
-void           protocol_main_loop() {
+
+// Segment buffer underruns mean that the main loop did not keep up with the step ISR.
+// They are checked once per underrunCheckTicks, so a struggling job is not made worse
+// by a flood of warnings.
+const TickType_t  underrunCheckTicks = 1000;
+static uint32_t   underrunsReported  = 0;
+static TickType_t underrunCheckTime  = 0;
+
+static void check_underruns() {
+    TickType_t now = xTaskGetTickCount();
+    if ((now - underrunCheckTime) < underrunCheckTicks) {
+        return;
+    }
+    underrunCheckTime  = now;
+    uint32_t underruns = Stepper::isr_stats.underruns;
+    if (underruns > underrunsReported) {
+        log_warn("Segment buffer ran dry " << underruns - underrunsReported << " times; see $System/Tasks");
+    }
+    underrunsReported = underruns;  // Also follows a reset of the stats
+}
+
+// The soft watchdog catches a stall while it happens, but the stalled code cannot
+// report it, so it is reported from here once the point is reached again.
+static void log_stall(const char* what, const SoftWdtStall& stall) {
+    if (!strcmp(stall.state, "preempted")) {
+        log_warn(what << " for " << stall.gapUs / 1000 << " ms, preempted by " << stall.task << "; last line "
+                      << CrashContext::last_line());
+    } else {
+        log_warn(what << " for " << stall.gapUs / 1000 << " ms, " << stall.task << " " << stall.state << "; last line "
+                      << CrashContext::last_line());
+    }
+}
+
+static void check_stalls() {
+    soft_wdt_set_threshold(stall_ms->get());
+    SoftWdtStall stall;
+    if (soft_wdt_take_stall(SoftWdtRealtime, stall)) {
+        log_stall("Realtime commands went unchecked", stall);
+    }
+    if (soft_wdt_take_stall(SoftWdtPrep, stall)) {
+        log_stall("The segment buffer went unfilled", stall);
+    }
+}
+
+void protocol_main_loop() {
     start_polling();
 
     // ---------------------------------------------------------------------------------
     // Primary loop! Upon a system abort, this exits back to main() to reset the system.
     // This is also where the system idles while waiting for something to do.
     // ---------------------------------------------------------------------------------
-    for (;; vTaskDelay(0)) {
-        Check_Power_Presence_And_Reset();
+    mainTask = xTaskGetCurrentTaskHandle();
+
+    for (;;) {
+        JobStats::poll();
+        JobQueue::poll();
+        Telemetry::poll();
+        Coordinates::flush();
+        ToolTable::poll();
+        if (!plan_get_current_block()) {
+            config->_kinematics->flush_held();  // Nothing else would move the machine
+            if (!plan_get_current_block() && sys.state != State::Cycle) {
+                gc_sync_spindle();
+            }
+        }
+        jog_velocity_poll();
+        if (config->_mpg) {
+            config->_mpg->poll();
+        }
 
+        activeChannel = LineQueue::take(activeLine, activeCompiled);
         if (activeChannel) {
             // The input polling task has collected a line of input
 #ifdef DEBUG_REPORT_ECHO_RAW_LINE_RECEIVED
             report_echo_line_received(activeLine, *activeChannel);
 #endif
 
-            Error status_code = execute_line(activeLine, *activeChannel, WebUI::AuthenticationLevel::LEVEL_GUEST);
+            uint32_t plannerBlocks = config->_planner_blocks - 1 - plan_get_block_buffer_available();
+            CrashContext::line(activeLine, plannerBlocks);
+            if (MotionTrace::enabled) {
+                MotionTrace::record(MotionTrace::LineStart, plannerBlocks);
+            }
+            // A line that the polling task compiled skips the text processing, unless
+            // an O-word block is being received and needs it as text.  A line from a
+            // g-code cache has no text, as before.
+            bool  compiled = activeCompiled[0] && (!OWord::recording() || !activeLine[0]);
+            char* line     = compiled ? activeCompiled : activeLine;
+            Extents::trust_line(activeChannel == &allChannels);  // File jobs send their lines as allChannels
+            Error status_code = execute_line(line, *activeChannel, WebUI::AuthenticationLevel::LEVEL_GUEST);
+            Extents::trust_line(false);
+            if (compiled && status_code != Error::Ok && activeLine[0]) {
+                log_debug_to(*activeChannel, "Bad GCode: " << activeLine);
+            }
+            ++linesExecuted;
+            if (MotionTrace::enabled) {
+                MotionTrace::record(MotionTrace::LineEnd, uint32_t(status_code));
+            }
 
             // Tell the channel that the line has been processed.
             // If the line was aborted, the channel could be invalid
@@ -251,12 +396,19 @@ void           protocol_main_loop() {
             }
 
             // Tell the input polling task that the line has been processed,
-            // so it can give us another one when available
+            // so it can queue another one from the channel when available
             activeChannel = nullptr;
+            LineQueue::done();
+            protocol_notify_polling();
         }
 
         // Auto-cycle start any queued moves.
-        protocol_auto_cycle_start();
+        if (cycleStartHeld && plan_check_full_buffer()) {
+            cycleStartHeld = false;
+        }
+        if (!cycleStartHeld) {
+            protocol_auto_cycle_start();
+        }
         protocol_execute_realtime();  // Runtime command check point.
         if (sys.abort) {
             sys.abort = false;
@@ -296,6 +448,20 @@ void           protocol_main_loop() {
                 heapLowWaterReportTime = getCpuTicks();
             }
         }
+
+        check_underruns();
+        check_stalls();
+
+        // When there is no motion to feed, sleep until the polling task hands over
+        // a line or an event arrives, instead of spinning.
+        bool idle = (sys.state == State::Idle || sys.state == State::Alarm || sys.state == State::ConfigAlarm) && !LineQueue::busy() &&
+                    !plan_get_current_block();
+        if (idle) {
+            soft_wdt_pause(SoftWdtRealtime);
+            ulTaskNotifyTake(pdTRUE, mainIdleTicks);
+        } else {
+            vTaskDelay(0);
+        }
     }
     return; /* Never reached */
 }
@@ -303,6 +469,10 @@ void           protocol_main_loop() {
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void protocol_buffer_synchronize() {
+    if (sys.state == State::CheckMode) {
+        return;  // Nothing is queued, so a job resume can run through the lines at full speed
+    }
+    config->_kinematics->flush_held();
     do {
         // Restart motion if there are blocks in the planner queue
         protocol_auto_cycle_start();
@@ -311,6 +481,27 @@ void protocol_buffer_synchronize() {
             return;  // Check for system abort
         }
     } while (plan_get_current_block() || (sys.state == State::Cycle));
+    gc_sync_spindle();
+}
+
+// Like protocol_buffer_synchronize(), but returns once the buffered motion is estimated
+// to end within ms.  Returns that estimate.
+uint32_t protocol_buffer_anticipate(uint32_t ms) {
+    uint32_t left;
+    config->_kinematics->flush_held();
+    do {
+        protocol_auto_cycle_start();
+        protocol_execute_realtime();
+        if (sys.abort) {
+            return 0;
+        }
+        left = plan_get_buffered_ms();
+    } while (left > ms);
+    return left;
+}
+
+void protocol_hold_cycle_start(bool hold) {
+    cycleStartHeld = hold;
 }
 
 // Auto-cycle start triggers when there is a motion ready to execute and if the main program is not
@@ -338,6 +529,8 @@ void protocol_auto_cycle_start() {
 // NOTE: The sys_rt_exec_state.bit variable flags are set by any process, step or serial interrupts, pinouts,
 // limit switches, or the main program.
 void protocol_execute_realtime() {
+    MotionBench::Timing timing(MotionBench::Wait);
+    soft_wdt_feed(SoftWdtRealtime);
     protocol_exec_rt_system();
     if (sys.suspend.value) {
         protocol_exec_rt_suspend();
@@ -352,6 +545,42 @@ static void protocol_do_power_detection() {
     log_info("No power detected");
 }
 
+// The motor drivers lost their settings with the power, and the motors may have been
+// moved by hand, so the drivers are configured again and the axes must be homed, as
+// after a restart.  With start/fast_rehome, homing only confirms the position that was
+// held when the power went, if the machine was homed and stopped then, as HomeMemory
+// does across a restart.
+static void protocol_do_power_restored() {
+    delay_ms(100);  // Let the supply settle
+    if (!GetPowerLineValue()) {
+        return;
+    }
+    log_info("POWER ON DETECTED");
+    if (!GetResetWhenPowerOn()) {
+        return;
+    }
+    log_info("Reinitializing the motors - see $ResetOnPowerON if you want to disable this feature");
+    if (sys.state != State::Idle && sys.state != State::Alarm && sys.state != State::ConfigAlarm) {
+        mc_critical(ExecAlarm::AbortCycle);
+        return;  // The motors are configured again by the reset that must follow
+    }
+    if (sys.state == State::ConfigAlarm) {
+        return;
+    }
+    spindle->stop();
+    Spindles::Spindle::stopPrestarted(config->_spindles);
+    config->_axes->config_motors();
+
+    AxisMask homed = Machine::Axes::homingMask & ~Homing::unhomed_axes();
+    if (config->_start->_mustHome && Machine::Axes::homingMask) {
+        Homing::set_all_axes_unhomed();
+        if (config->_start->_fastRehome && homed == Machine::Axes::homingMask) {
+            Homing::trust(homed);
+        }
+        send_alarm(ExecAlarm::Unhomed);
+    }
+}
+
 static void protocol_do_restart() {
     // Reset primary systems.
     system_reset();
@@ -363,10 +592,12 @@ static void protocol_do_restart() {
     // possibility of crashing at this point.
 
     plan_reset();  // Clear block buffer and planner variables
+    config->_kinematics->drop_held();
 
     if (sys.state != State::ConfigAlarm) {
         if (spindle) {
             spindle->stop();
+            Spindles::Spindle::stopPrestarted(config->_spindles);
             report_ovr_counter = 0;  // Set to report change immediately
         }
         Stepper::reset();  // Clear stepper subsystem variables
@@ -376,6 +607,7 @@ static void protocol_do_restart() {
     plan_sync_position();
     gc_sync_position();
     allChannels.flushRx();
+    LineQueue::clear();
     report_init_message(allChannels);
     mc_init();
 
@@ -410,6 +642,9 @@ static void protocol_do_start() {
     Homing::set_all_axes_homed();
     if (config->_start->_mustHome && Machine::Axes::homingMask) {
         Homing::set_all_axes_unhomed();
+        if (config->_start->_fastRehome) {
+            Homing::trust(HomeMemory::restore());
+        }
         // If there is an axis with homing configured, enter Alarm state on startup
         send_alarm(ExecAlarm::Unhomed);
     } else {
@@ -423,8 +658,10 @@ static void protocol_do_alarm(void* alarmVoid) {
     if (spindle->_off_on_alarm) {
         spindle->stop();
     }
+    Spindles::Spindle::stopPrestarted(config->_spindles);
     alarm_msg(lastAlarm);
-    if (lastAlarm == ExecAlarm::HardLimit || lastAlarm == ExecAlarm::HardStop) {
+    if (lastAlarm == ExecAlarm::HardLimit || lastAlarm == ExecAlarm::HardStop || lastAlarm == ExecAlarm::StepLoss ||
+        lastAlarm == ExecAlarm::DriverShutdown || lastAlarm == ExecAlarm::LinkLost) {
         sys.state = State::Critical;  // Set system alarm state
         report_error_message(Message::CriticalEvent);
         protocol_disable_steppers();
@@ -525,10 +762,13 @@ static void protocol_do_feedhold() {
             break;
 
         case State::Cycle:
+            LatencyProbe::toggle(LatencyProbe::Feedhold);
             protocol_start_holding();
+            Stepper::fast_hold();
             break;
 
         case State::Jog:
+            LatencyProbe::toggle(LatencyProbe::Feedhold);
             protocol_start_holding();
             protocol_cancel_jogging();
             return;  // Do not change the state to Hold
@@ -785,11 +1025,36 @@ static void update_velocities() {
     plan_cycle_reinitialize();
 }
 
+// A pendant wheel sends dozens of override commands a second, and those that arrive
+// together are handled in one protocol_handle_events() call.  Each one only changes the
+// override, and the replan and the spindle update are done once for the lot of them.
+static bool velocitiesChanged = false;
+static bool spindleOvrChanged = false;
+
+static void apply_overrides() {
+    if (velocitiesChanged) {
+        velocitiesChanged = false;
+        update_velocities();
+    }
+    if (spindleOvrChanged) {
+        spindleOvrChanged                   = false;
+        sys.step_control.updateSpindleSpeed = true;
+        report_ovr_counter                  = 0;  // Set to report change immediately
+
+        // If spindle is on, tell it the RPM has been overridden
+        // When moving, the override is handled by the stepping code
+        if (gc_state.modal.spindle != SpindleState::Disable && !inMotionState()) {
+            spindle->setState(gc_state.modal.spindle, gc_state.spindle_speed);
+        }
+    }
+}
+
 // This is the final phase of the shutdown activity for a reset
 // The stuff herein is not necessarily safe to do in an ISR.
 static void protocol_do_late_reset() {
     // Kill spindle and coolant.
     spindle->stop();
+    Spindles::Spindle::stopPrestarted(config->_spindles);
     report_ovr_counter = 0;  // Set to report change immediately
     config->_coolant->stop();
 
@@ -804,12 +1069,40 @@ static void protocol_do_late_reset() {
     sys.abort = true;
 }
 
+struct StateHookEntry {
+    StateHook hook;
+    void*     arg;
+};
+static const int      maxStateHooks = 4;
+static StateHookEntry stateHooks[maxStateHooks];
+static int            nStateHooks = 0;
+
+void protocol_add_state_hook(StateHook hook, void* arg) {
+    Assert(nStateHooks < maxStateHooks, "Too many state hooks");
+    stateHooks[nStateHooks++] = { hook, arg };
+    hook(arg);  // Start out in step with the current state
+}
+
+static void protocol_check_state_change() {
+    static State   lastState   = State::Idle;
+    static uint8_t lastSuspend = 0;
+    if (sys.state == lastState && sys.suspend.value == lastSuspend) {
+        return;
+    }
+    lastState   = sys.state;
+    lastSuspend = sys.suspend.value;
+    for (int i = 0; i < nStateHooks; i++) {
+        stateHooks[i].hook(stateHooks[i].arg);
+    }
+}
+
 void protocol_exec_rt_system() {
     if (rtSafetyDoor) {
         protocol_do_safety_door();
     }
 
     protocol_handle_events();
+    protocol_check_state_change();
 
     // Reload step segment buffer
     switch (sys.state) {
@@ -818,6 +1111,7 @@ void protocol_exec_rt_system() {
         case State::CheckMode:
         case State::Idle:
         case State::Sleep:
+            soft_wdt_pause(SoftWdtPrep);
             break;
         case State::Cycle:
         case State::Hold:
@@ -959,16 +1253,16 @@ static void protocol_do_feed_override(void* incrementvp) {
         }
     }
     if (percent != sys.f_override) {
-        sys.f_override = percent;
-        update_velocities();
+        sys.f_override    = percent;
+        velocitiesChanged = true;
     }
 }
 
 static void protocol_do_rapid_override(void* percentvp) {
     int percent = int(percentvp);
     if (percent != sys.r_override) {
-        sys.r_override = percent;
-        update_velocities();
+        sys.r_override    = percent;
+        velocitiesChanged = true;
     }
 }
 
@@ -986,16 +1280,8 @@ static void protocol_do_spindle_override(void* incrementvp) {
         }
     }
     if (percent != sys.spindle_speed_ovr) {
-        sys.spindle_speed_ovr               = percent;
-        sys.step_control.updateSpindleSpeed = true;
-        report_ovr_counter                  = 0;  // Set to report change immediately
-
-        // If spindle is on, tell it the RPM has been overridden
-        // When moving, the override is handled by the stepping code
-        if (gc_state.modal.spindle != SpindleState::Disable && !inMotionState()) {
-            spindle->setState(gc_state.modal.spindle, gc_state.spindle_speed);
-            report_ovr_counter = 0;  // Set to report change immediately
-        }
+        sys.spindle_speed_ovr = percent;
+        spindleOvrChanged     = true;
     }
 }
 
@@ -1070,53 +1356,66 @@ void protocol_do_rt_reset() {
     protocol_send_event(&restartEvent);
 }
 
-ArgEvent feedOverrideEvent { protocol_do_feed_override };
-ArgEvent rapidOverrideEvent { protocol_do_rapid_override };
-ArgEvent spindleOverrideEvent { protocol_do_spindle_override };
-ArgEvent accessoryOverrideEvent { protocol_do_accessory_override };
-ArgEvent limitEvent { protocol_do_limit };
-ArgEvent faultPinEvent { protocol_do_fault_pin };
+ArgEvent feedOverrideEvent { protocol_do_feed_override, EventPriority::Override };
+ArgEvent rapidOverrideEvent { protocol_do_rapid_override, EventPriority::Override };
+ArgEvent spindleOverrideEvent { protocol_do_spindle_override, EventPriority::Override };
+ArgEvent accessoryOverrideEvent { protocol_do_accessory_override, EventPriority::Override };
+ArgEvent limitEvent { protocol_do_limit, EventPriority::Safety };
+ArgEvent faultPinEvent { protocol_do_fault_pin, EventPriority::Safety };
 
-ArgEvent reportStatusEvent { (void (*)(void*))report_realtime_status };
+ArgEvent reportStatusEvent { (void (*)(void*))report_realtime_status, EventPriority::Report };
 
-NoArgEvent safetyDoorEvent { request_safety_door };
-NoArgEvent feedHoldEvent { protocol_do_feedhold };
+NoArgEvent safetyDoorEvent { request_safety_door, EventPriority::Safety };
+NoArgEvent feedHoldEvent { protocol_do_feedhold, EventPriority::Safety };
 NoArgEvent cycleStartEvent { protocol_do_cycle_start };
 NoArgEvent cycleStopEvent { protocol_do_cycle_stop };
-NoArgEvent motionCancelEvent { protocol_do_motion_cancel };
+NoArgEvent motionCancelEvent { protocol_do_motion_cancel, EventPriority::Safety };
 NoArgEvent sleepEvent { protocol_do_sleep };
-NoArgEvent debugEvent { report_realtime_debug };
+NoArgEvent debugEvent { report_realtime_debug, EventPriority::Report };
 NoArgEvent startEvent { protocol_do_start };
 NoArgEvent restartEvent { protocol_do_restart };
 NoArgEvent runStartupLinesEvent { protocol_run_startup_lines };
 NoArgEvent PowerDetectionEvent { protocol_do_power_detection };
+NoArgEvent powerRestoredEvent { protocol_do_power_restored };
 
-NoArgEvent rtResetEvent { protocol_do_rt_reset };
+NoArgEvent rtResetEvent { protocol_do_rt_reset, EventPriority::Safety };
 
 // The problem is that report_realtime_status needs a channel argument
 // Event statusReportEvent { protocol_do_status_report(XXX) };
-ArgEvent alarmEvent { (void (*)(void*))protocol_do_alarm };
+ArgEvent alarmEvent { (void (*)(void*))protocol_do_alarm, EventPriority::Safety };
 
-xQueueHandle event_queue;
+xQueueHandle event_queues[nEventPriorities];
 
 void protocol_init() {
-    event_queue   = xQueueCreate(10, sizeof(EventItem));
+    for (int i = 0; i < nEventPriorities; i++) {
+        event_queues[i] = xQueueCreate(10, sizeof(EventItem));
+    }
     message_queue = xQueueCreate(10, sizeof(LogMessage));
 }
 
 void IRAM_ATTR protocol_send_event_from_ISR(Event* evt, void* arg) {
     EventItem item { evt, arg };
-    xQueueSendFromISR(event_queue, &item, NULL);
+    xQueueSendFromISR(event_queues[int(evt->_priority)], &item, NULL);
+    protocol_notify_main_from_ISR();
 }
 void protocol_send_event(Event* evt, void* arg) {
     EventItem item { evt, arg };
-    xQueueSend(event_queue, &item, 0);
+    xQueueSend(event_queues[int(evt->_priority)], &item, 0);
+    protocol_notify_main();
 }
+// After each event the queues are scanned again from the top, since running it may
+// have taken long enough for something more urgent to arrive
 void protocol_handle_events() {
     EventItem item;
-    while (xQueueReceive(event_queue, &item, 0)) {
-        item.event->run(item.arg);
+    for (int i = 0; i < nEventPriorities;) {
+        if (xQueueReceive(event_queues[i], &item, 0)) {
+            item.event->run(item.arg);
+            i = 0;
+        } else {
+            ++i;
+        }
     }
+    apply_overrides();
 }
 void send_alarm(ExecAlarm alarm) {
     protocol_send_event(&alarmEvent, (void*)alarm);
@@ -37,9 +37,17 @@ void protocol_exec_rt_system();
 // Executes the auto cycle feature, if enabled.
 void protocol_auto_cycle_start();
 
+// Keeps the main loop from starting the cycle after each line until the planner is full
+// or the hold is released, so that a file job does not start moving with one block queued.
+// Buffer syncs, which wait for the motion to run, still start it.
+void protocol_hold_cycle_start(bool hold);
+
 // Block until all buffered steps are executed
 void protocol_buffer_synchronize();
 
+// Block until the buffered steps are estimated to finish within ms
+uint32_t protocol_buffer_anticipate(uint32_t ms);
+
 // Disables the stepper motors or schedules it to happen
 void protocol_disable_steppers();
 void protocol_cancel_disable_steppers();
@@ -68,6 +76,11 @@ enum class ExecAlarm : uint8_t {
     HardStop              = 13,
     Unhomed               = 14,
     Init                  = 15,
+    StepLoss              = 16,
+    DriverShutdown        = 17,
+    DriverOverTemp        = 18,
+    PositionError         = 19,
+    LinkLost              = 20,
 };
 
 extern volatile ExecAlarm lastAlarm;
@@ -105,12 +118,13 @@ extern NoArgEvent unhomedEvent;
 extern NoArgEvent startEvent;
 extern NoArgEvent restartEvent;
 extern NoArgEvent PowerDetectionEvent;
+extern NoArgEvent powerRestoredEvent;
 
 extern NoArgEvent runStartupLinesEvent;
 
 // extern NoArgEvent statusReportEvent;
 
-extern xQueueHandle event_queue;
+extern xQueueHandle event_queues[nEventPriorities];  // One for each EventPriority
 
 extern bool pollingPaused;
 
@@ -120,6 +134,12 @@ struct EventItem {
 };
 
 void protocol_send_event(Event*, void* arg = 0);
+
+// Consumers that follow the machine state, like status pins, register a hook here
+// instead of polling.  The main task calls each hook with its argument as soon as it
+// sees sys.state or sys.suspend change.
+using StateHook = void (*)(void* arg);
+void protocol_add_state_hook(StateHook hook, void* arg);
 void protocol_handle_events();
 
 void send_alarm(ExecAlarm alarm);
@@ -131,6 +151,15 @@ inline void protocol_send_event(Event* evt, int arg) {
 
 void protocol_send_event_from_ISR(Event* evt, void* arg = 0);
 
-void drain_messages();
+// The polling task and the main loop sleep when they have nothing to do.
+// These wake them up early when new work arrives for them.
+void protocol_notify_polling();
+void protocol_notify_main();
+void protocol_notify_main_from_ISR();
+
+// Waits until the output task has sent the queued messages, or for at most timeout_ms.
+// Returns false if it timed out.
+bool drain_messages(uint32_t timeout_ms = UINT32_MAX);
 
 extern uint32_t heapLowWater;
+extern uint32_t linesExecuted;  // GCode and $ lines, for /metrics
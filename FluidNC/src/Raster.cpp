@@ -0,0 +1,130 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Raster.h"
+
+#include "Protocol.h"  // protocol_execute_realtime
+#include "System.h"    // sys
+
+#include <algorithm>
+
+namespace Raster {
+    enum : uint8_t {
+        FREE = 0,
+        FILLED,  // Decoded, waiting for its move
+        QUEUED,  // In a block, until the step ISR finishes the block
+    };
+
+    static Line*   lines   = nullptr;
+    static size_t  n_lines = 0;
+    static uint8_t pending = 0;
+
+    void init(size_t count) {
+        if (lines) {
+            delete[] lines;
+        }
+        n_lines = std::min(count, maxSlots);
+        lines   = n_lines ? new Line[n_lines] : nullptr;
+        reset();
+    }
+
+    bool enabled() { return n_lines != 0; }
+
+    void reset() {
+        for (size_t i = 0; i < n_lines; i++) {
+            lines[i].state = FREE;
+        }
+        pending = 0;
+    }
+
+    static int base64_value(char c) {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+') {
+            return 62;
+        }
+        if (c == '/') {
+            return 63;
+        }
+        return -1;
+    }
+
+    static bool decode(const char* base64, Line& l) {
+        uint32_t bits   = 0;
+        int      nbits  = 0;
+        size_t   length = 0;
+        for (; *base64 && *base64 != '='; base64++) {
+            int v = base64_value(*base64);
+            if (v < 0) {
+                return false;
+            }
+            bits = (bits << 6) | v;
+            nbits += 6;
+            if (nbits >= 8) {
+                nbits -= 8;
+                if (length == maxPixels) {
+                    return false;
+                }
+                l.pixels[length++] = uint8_t(bits >> nbits);
+            }
+        }
+        l.length = length;
+        return length != 0;
+    }
+
+    static int find_free() {
+        for (size_t i = 0; i < n_lines; i++) {
+            if (lines[i].state == FREE) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool load(const char* base64) {
+        drop();
+        if (!n_lines) {
+            return false;
+        }
+        int i;
+        // Like a full planner, wait for the step ISR to finish with a row
+        while ((i = find_free()) < 0) {
+            protocol_execute_realtime();
+            if (sys.abort) {
+                return false;
+            }
+        }
+        if (!decode(base64, lines[i])) {
+            return false;
+        }
+        lines[i].state = FILLED;
+        pending        = i + 1;
+        return true;
+    }
+
+    uint8_t take() {
+        uint8_t slot = pending;
+        if (slot) {
+            lines[slot - 1].state = QUEUED;
+            pending               = 0;
+        }
+        return slot;
+    }
+
+    void drop() {
+        if (pending) {
+            lines[pending - 1].state = FREE;
+            pending                  = 0;
+        }
+    }
+
+    Line& IRAM_ATTR line(uint8_t slot) { return lines[slot - 1]; }
+
+    void IRAM_ATTR release(uint8_t slot) { lines[slot - 1].state = FREE; }
+}
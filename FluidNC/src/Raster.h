@@ -0,0 +1,63 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Raster.h - scanlines of laser power values for raster engraving
+
+  $RL=<words>:<base64> (Raster/Line) queues the linear move given by <words>, as in
+  G1<words>, with a row of 8-bit power values that are spread evenly over the move.
+  Value 255 is the S word speed, 0 is off.  Instead of one G-code line per pixel
+  change, a whole row takes one line, and the step ISR changes the laser power when
+  the move reaches the next pixel.  The move should be at constant speed, with any
+  overscan for acceleration done by the sender, since the power does not follow the
+  speed.
+
+  Each row is held in a slot from the time the command is parsed until the step ISR
+  has finished its block.
+*/
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+#include <cstddef>
+
+namespace Raster {
+    // Pixels that fit in one line, after the command and the move words
+    const size_t maxPixels = 192;
+
+    struct Line {
+        volatile uint8_t state;
+        uint16_t         length;
+        uint8_t          pixels[maxPixels];
+    };
+
+    // Slot numbers are bytes, so that plan_block_t packs.  With more blocks than this, a row
+    // waits for a slot as a line waits for a planner block.
+    const size_t maxSlots = 255;
+
+    // Allocates the slots, enough for every planner and stepper block up to maxSlots, or
+    // none if count is 0
+    void init(size_t count);
+
+    // True if there are slots, which there are only on machines with a laser
+    bool enabled();
+
+    // Frees every slot, when motion is aborted
+    void reset();
+
+    // Decodes a base64 row into a free slot and makes it the pending row of the next
+    // linear move.  Returns false if the row is invalid or too long.  Waits for a free
+    // slot, returning false if motion is aborted meanwhile.
+    bool load(const char* base64);
+
+    // Called by the planner for each new block: returns the slot number of the pending
+    // row, 0 if none, and clears it, so that only the first block of a move gets the row
+    uint8_t take();
+
+    // Drops the pending row if no block took it
+    void drop();
+
+    // Accessors for the step ISR, by slot number
+    Line& line(uint8_t slot);
+    void  release(uint8_t slot);
+}
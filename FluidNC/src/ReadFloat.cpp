@@ -0,0 +1,95 @@
+// Copyright (c) 2011-2016 Sungeun K. Jeon for Gnea Research LLC
+// Copyright (c) 2009-2011 Simen Svale Skogsrud
+// Copyright (c) 2018 -	Bart Dring
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "ReadFloat.h"
+
+#include <cstdint>
+#include <cmath>
+
+const int MAX_INT_DIGITS = 9;  // Maximum number of digits in uint32
+
+// Powers of ten that are exact in a float, since 5^10 < 2^24
+static const float exactPowersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+const int          maxExactPower     = 10;
+const uint32_t     maxExactInt       = 1 << 24;
+
+// Extracts a floating point value from a string. The following code is based loosely on
+// the avr-libc strtod() function by Michael Stumpf and Dmitry Xmelkov and many freely
+// available conversion method examples, but has been highly optimized for Grbl. For known
+// CNC applications, the typical decimal value is expected to be in the range of E0 to E-4.
+// Scientific notation is officially not supported by g-code, and the 'E' character may
+// be a g-code word on some CNC systems. So, 'E' notation will not be recognized.
+// NOTE: Thanks to Radu-Eosif Mihailescu for identifying the issues with using strtod().
+//
+// The digits are gathered into an integer with no floating point work.  With up to
+// 7 significant digits, which covers g-code values, the integer and the power of ten
+// that scales it are both exact floats, so one float division or multiplication gives
+// the correctly rounded result, the same as strtof().  Longer numbers are scaled in
+// double precision.
+bool read_float(const char* line, size_t* char_counter, float* float_ptr) {
+    const char*   ptr = line + *char_counter;
+    unsigned char c;
+    // Grab first character and increment pointer. No spaces assumed in line.
+    c = *ptr++;
+    // Capture initial positive/minus character
+    bool isnegative = false;
+    if (c == '-') {
+        isnegative = true;
+        c          = *ptr++;
+    } else if (c == '+') {
+        c = *ptr++;
+    }
+
+    // Extract number into fast integer. Track decimal in terms of exponent value.
+    uint32_t intval    = 0;
+    int      exp       = 0;
+    int      ndigit    = 0;
+    int      nsig      = 0;  // Significant digits, after any leading zeros
+    bool     isdecimal = false;
+    while (1) {
+        c -= '0';
+        if (c <= 9) {
+            ndigit++;
+            if (nsig || c) {
+                nsig++;
+            }
+            if (nsig <= MAX_INT_DIGITS) {
+                if (isdecimal) {
+                    exp--;
+                }
+                intval = intval * 10 + c;
+            } else {
+                if (!(isdecimal)) {
+                    exp++;  // Drop overflow digits
+                }
+            }
+        } else if (c == (('.' - '0') & 0xff) && !(isdecimal)) {
+            isdecimal = true;
+        } else {
+            break;
+        }
+        c = *ptr++;
+    }
+    // Return if no digits have been read.
+    if (!ndigit) {
+        return false;
+    }
+
+    // Convert integer into floating point.
+    float fval;
+    if (intval <= maxExactInt && exp >= -maxExactPower && exp <= maxExactPower) {
+        fval = exp < 0 ? float(intval) / exactPowersOf10[-exp] : float(intval) * exactPowersOf10[exp];
+    } else {
+        fval = float(double(intval) * pow(10.0, exp));
+    }
+    // Assign floating point value with correct sign.
+    if (isnegative) {
+        *float_ptr = -fval;
+    } else {
+        *float_ptr = fval;
+    }
+    *char_counter = ptr - line - 1;  // Set char_counter to next statement
+    return true;
+}
@@ -5,9 +5,12 @@
 #include "Report.h"
 #include "System.h"
 #include "Machine/Macros.h"  // macroNEvent
+#include "Jog.h"             // jog_velocity_stop()
+#include "LatencyProbe.h"
 
 // Act upon a realtime character
 void execute_realtime_command(Cmd command, Channel& channel) {
+    LatencyProbe::toggle(LatencyProbe::Realtime);
     switch (command) {
         case Cmd::Reset:
             protocol_send_event(&rtResetEvent);
@@ -26,6 +29,7 @@ void execute_realtime_command(Cmd command, Channel& channel) {
             protocol_send_event(&safetyDoorEvent);
             break;
         case Cmd::JogCancel:
+            jog_velocity_stop();
             if (sys.state == State::Jog) {  // Block all other states from invoking motion cancel.
                 protocol_send_event(&motionCancelEvent);
             }
@@ -84,6 +88,9 @@ void execute_realtime_command(Cmd command, Channel& channel) {
         case Cmd::CoolantMistOvrToggle:
             protocol_send_event(&accessoryOverrideEvent, AccessoryOverride::MistToggle);
             break;
+        case Cmd::BinaryStatus:
+            channel.setBinaryStatus(!channel.binaryStatus());
+            break;
         case Cmd::Macro0:
             protocol_send_event(&macro0Event);
             break;
@@ -44,9 +44,17 @@ enum class Cmd : uint8_t {
     SpindleOvrStop        = 0x9E,
     CoolantFloodOvrToggle = 0xA0,
     CoolantMistOvrToggle  = 0xA1,
+    BinaryStatus          = 0xA8,  // Toggles binary status frames on channels that support them
     // Channel Extender uses the Bx range; see Channel.h
 };
 
+// Velocity jogging uses the code points from JogVelocityFirst, arriving UTF-8 encoded:
+// JogVelocityFirst + axis * 0x100 + speed sets the velocity of the axis, speed being a
+// signed byte giving it in 127ths of the axis's max_rate_mm_per_min.  Zero stops the
+// axis, and JogCancel stops them all.  See jog_velocity().
+const uint32_t JogVelocityFirst = 0x400;
+const uint32_t JogVelocityLast  = JogVelocityFirst + 9 * 0x100;  // For up to nine axes
+
 class Channel;
 
 bool is_realtime_command(uint8_t data);
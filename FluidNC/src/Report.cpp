@@ -31,15 +31,17 @@
 #include "WebUI/WifiConfig.h"            // wifi_config
 #include "WebUI/BTConfig.h"              // bt_config
 #include "WebUI/WebSettings.h"
+#include "Motors/TrinamicBase.h"  // MotorDrivers::TrinamicBase
 #include "InputFile.h"
+#include "JobStats.h"  // JobStats::remaining_seconds()
+#include "FloatFormat.h"
 
 #include <map>
+#include <mutex>
 #include <freertos/task.h>
 #include <cstring>
 #include <cstdio>
 #include <cstdarg>
-#include <sstream>
-#include <iomanip>
 
 #ifdef DEBUG_REPORT_HEAP
 EspClass esp;
@@ -81,13 +83,12 @@ void _notifyf(const char* title, const char* format, ...) {
 Counter report_ovr_counter = 0;
 Counter report_wco_counter = 0;
 
-static const int coordStringLen = 20;
-static const int axesStringLen  = coordStringLen * MAX_N_AXIS;
+static const int axesStringLen = fixedFormatMax * MAX_N_AXIS;
 
-// Sends the axis values to the output channel
-static std::string report_util_axis_values(const float* axis_value) {
-    std::ostringstream msg;
-    auto               n_axis = config->_axes->_numberAxis;
+// Formats the axis values, comma separated, into buf, which must hold axesStringLen characters
+static const char* report_util_axis_values(const float* axis_value, char* buf) {
+    char* p      = buf;
+    auto  n_axis = config->_axes->_numberAxis;
     for (size_t idx = 0; idx < n_axis; idx++) {
         int   decimals;
         float value = axis_value[idx];
@@ -105,12 +106,34 @@ static std::string report_util_axis_values(const float* axis_value) {
                 decimals = 3;  // Report mm to 3 decimal places
             }
         }
-        msg << std::fixed << std::setprecision(decimals) << value;
+        p += format_fixed(p, value, decimals);
         if (idx < (n_axis - 1)) {
-            msg << ",";
+            *p++ = ',';
         }
     }
-    return msg.str();
+    *p = '\0';
+    return buf;
+}
+
+// The same from integer microns, or millidegrees on rotary axes, without float math
+static const char* report_util_axis_um(const int32_t* axis_um, char* buf) {
+    char* p      = buf;
+    auto  n_axis = config->_axes->_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        int32_t value = axis_um[idx];
+        if ((idx >= A_AXIS && idx <= C_AXIS) || !config->_reportInches) {
+            p += format_scaled(p, value, 3);
+        } else {
+            // Ten-thousandths of an inch, rounded half away from zero
+            int64_t tenths = int64_t(value) * 100;
+            p += format_scaled(p, int32_t((tenths + (tenths < 0 ? -127 : 127)) / 254), 4);
+        }
+        if (idx < (n_axis - 1)) {
+            *p++ = ',';
+        }
+    }
+    *p = '\0';
+    return buf;
 }
 
 std::map<Message, const char*> MessageText = {
@@ -207,9 +230,10 @@ void report_probe_parameters(Channel& channel) {
     // Report in terms of machine position.
     // get the machine position and put them into a string and append to the probe report
     float print_position[MAX_N_AXIS];
-    motor_steps_to_mpos(print_position, probe_steps);
+    probe_mpos(print_position);
 
-    log_stream(channel, "[PRB:" << report_util_axis_values(print_position) << ":" << probe_succeeded);
+    char axes[axesStringLen];
+    log_stream(channel, "[PRB:" << report_util_axis_values(print_position, axes) << ":" << probe_succeeded);
 }
 
 // Prints NGC parameters (coordinate offsets, probing)
@@ -224,19 +248,18 @@ void report_ngc_coord(CoordIndex coord, Channel& channel) {
             tlo *= INCH_PER_MM;
             decimals = 4;
         }
-        std::ostringstream msg;
-        msg << std::fixed << std::setprecision(decimals) << tlo;
-        log_stream(channel, "[TLO:" << msg.str());
+        char value[fixedFormatMax];
+        format_fixed(value, tlo, decimals);
+        log_stream(channel, "[TLO:" << value);
         return;
     }
+    char axes[axesStringLen];
     if (coord == CoordIndex::G92) {  // Non-persistent G92 offset
-        log_stream(channel, "[G92:" << report_util_axis_values(gc_state.coord_offset));
+        log_stream(channel, "[G92:" << report_util_axis_values(gc_state.coord_offset, axes));
         return;
     }
     // Persistent offsets G54 - G59, G28, and G30
-    std::string name(coords[coord]->getName());
-    name += ":";
-    log_stream(channel, "[" << name << report_util_axis_values(coords[coord]->get()));
+    log_stream(channel, "[" << coords[coord]->getName() << ":" << report_util_axis_values(coords[coord]->get(), axes));
 }
 void report_ngc_parameters(Channel& channel) {
     for (auto coord = CoordIndex::Begin; coord < CoordIndex::End; ++coord) {
@@ -246,7 +269,7 @@ void report_ngc_parameters(Channel& channel) {
 
 // Print current gcode parser mode state
 void report_gcode_modes(Channel& channel) {
-    std::ostringstream msg;
+    LogStream msg(channel, "[GC:");
     switch (gc_state.modal.motion) {
         case Motion::None:
             msg << "G80";
@@ -263,6 +286,21 @@ void report_gcode_modes(Channel& channel) {
         case Motion::CcwArc:
             msg << "G3";
             break;
+        case Motion::SpindleSync:
+            msg << "G33";
+            break;
+        case Motion::DrillChipBreak:
+            msg << "G73";
+            break;
+        case Motion::Drill:
+            msg << "G81";
+            break;
+        case Motion::DrillDwell:
+            msg << "G82";
+            break;
+        case Motion::DrillPeck:
+            msg << "G83";
+            break;
         case Motion::ProbeToward:
             msg << "G38.2";
             break;
@@ -323,6 +361,9 @@ void report_gcode_modes(Channel& channel) {
         case FeedRate::InverseTime:
             msg << " G93";
             break;
+        case FeedRate::UnitsPerRev:
+            msg << " G95";
+            break;
     }
 
     //report_util_gcode_modes_M();
@@ -378,9 +419,10 @@ void report_gcode_modes(Channel& channel) {
 
     msg << " T" << gc_state.tool;
     int digits = config->_reportInches ? 1 : 0;
-    msg << " F" << std::fixed << std::setprecision(digits) << gc_state.feed_rate;
+    char feed[fixedFormatMax];
+    format_fixed(feed, gc_state.feed_rate, digits);
+    msg << " F" << feed;
     msg << " S" << uint32_t(gc_state.spindle_speed);
-    log_stream(channel, "[GC:" << msg.str())
 }
 
 // Prints build info line
@@ -505,8 +547,7 @@ void report_recompute_pin_string() {
     if (lim_pin_state) {
         auto n_axis = config->_axes->_numberAxis;
         for (size_t axis = 0; axis < n_axis; axis++) {
-            if (bitnum_is_true(lim_pin_state, Machine::Axes::motor_bit(axis, 0)) ||
-                bitnum_is_true(lim_pin_state, Machine::Axes::motor_bit(axis, 1))) {
+            if (bitnum_is_true(Machine::Axes::motors_to_axes(lim_pin_state), axis)) {
                 report_pin_string += config->_axes->axisName(axis);
             }
         }
@@ -521,38 +562,173 @@ void report_recompute_pin_string() {
 // Define this to do something if a debug request comes in over serial
 void report_realtime_debug() {}
 
-// Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
-// and the actual location of the CNC machine. Users may change the following function to their
-// specific needs, but the desired real-time data report must be as short as possible. This is
-// requires as it minimizes the computational overhead to keep running smoothly,
-// especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
-void report_realtime_status(Channel& channel) {
-    LogStream msg(channel, "<");
-    msg << state_name();
+// Typed status for channels that report it themselves.  See Report.h.
+void report_machine_status(MachineStatus& status) {
+    status.state     = sys.state;
+    status.stateName = state_name();
+
+    auto   n_axis   = config->_axes->_numberAxis;
+    float* position = get_mpos();
+    status.isMpos   = bits_are_true(status_mask->get(), RtStatus::Position);
+    if (!status.isMpos) {
+        mpos_to_wpos(position);
+    }
+    for (size_t idx = 0; idx < MAX_N_AXIS; idx++) {
+        float value = idx < n_axis ? position[idx] : 0.0f;
+        // Rotary axes are in degrees regardless of the units
+        if (config->_reportInches && !(idx >= A_AXIS && idx <= C_AXIS)) {
+            value /= MM_PER_INCH;
+        }
+        status.position[idx] = value;
+    }
+
+    status.feedRate = Stepper::get_realtime_rate();
+    if (config->_reportInches) {
+        status.feedRate /= MM_PER_INCH;
+    }
+    status.spindleSpeed    = sys.spindle_speed;
+    status.feedOverride    = sys.f_override;
+    status.rapidOverride   = sys.r_override;
+    status.spindleOverride = sys.spindle_speed_ovr;
+
+    status.probe            = config->_probe->get_state();
+    AxisMask lim_axes       = Machine::Axes::motors_to_axes(limits_get_state());
+    for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+        status.limits[axis] = axis < n_axis && bitnum_is_true(lim_axes, axis);
+    }
+
+    status.filename = "";
+    status.fileJob  = InputFile::progress(status.filePercent, status.filename);
+    if (!status.fileJob) {
+        status.filePercent = 0.0f;
+    }
+    status.hasEta = report_eta(status.etaSeconds);
+}
+
+bool report_eta(uint32_t& seconds) {
+    float       percent;
+    const char* path;
+    if (InputFile::progress(percent, path)) {
+        return JobStats::remaining_seconds(percent, seconds);
+    }
+    if (sys.state != State::Cycle && sys.state != State::Hold && sys.state != State::Jog) {
+        return false;
+    }
+    seconds = (plan_get_buffered_ms() + 500) / 1000;
+    return true;
+}
+
+// Appends whatever is printed to it to a string, whose capacity is reused
+class StringPrint : public Print {
+    std::string& _s;
+
+public:
+    StringPrint(std::string& s) : _s(s) { _s.clear(); }
+    size_t write(uint8_t c) override {
+        _s += char(c);
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t length) override {
+        _s.append((const char*)buffer, length);
+        return length;
+    }
+};
+
+// A status report is formatted once and then shared by every channel that asks
+// for one in the same tick, as long as nothing it depends on has visibly changed.
+// Each field is kept separately, so that the Bf: field, which differs between
+// channels, can be inserted and delta reports can pick the fields that changed.
+enum StatusField {
+    PositionField,
+    BufferField,  // Per channel, so never captured
+    LineNumberField,
+    FeedSpeedField,
+    SpindleRpmField,
+    PinsField,
+    WcoField,
+    OverridesField,
+    AccessoriesField,
+    FileJobField,
+    LinesPerSecondField,
+    EtaField,
+    IsrStatsField,
+    HeapField,
+    DriverField,
+    NumStatusFields,
+};
+
+struct StatusSnapshot {
+    uint32_t    version = 0;  // Incremented on every capture
+    bool        valid   = false;
+    TickType_t  tick;
+    State       state;
+    uint8_t     suspend;
+    std::string pins;
+    int         plannerAvailable;
+    std::string stateText;  // '<' and the state name
+    std::string fields[NumStatusFields];
+    bool        withWco;  // Whether ordinary reports from this capture carry WCO:
+    bool        withOvr;  // and Ov: and A:, as set by the refresh counters
+};
+
+static StatusSnapshot statusSnapshot;
+static std::mutex     statusMutex;
+
+// The snapshot is stale once the tick has passed or something that triggers an
+// immediate report has changed.  A refresh counter that has run down to zero
+// means that this report must carry WCO: or Ov:, so it needs a new capture.
+static bool status_snapshot_fresh() {
+    auto& snap = statusSnapshot;
+    return snap.valid && snap.tick == xTaskGetTickCount() && snap.state == sys.state && snap.suspend == sys.suspend.value &&
+           snap.pins == report_pin_string && report_wco_counter > 0 && report_ovr_counter > 0;
+}
+
+static void status_capture_fields(StatusSnapshot& snap);
+
+static void status_capture() {
+    auto& snap            = statusSnapshot;
+    snap.tick             = xTaskGetTickCount();
+    snap.state            = sys.state;
+    snap.suspend          = sys.suspend.value;
+    snap.pins             = report_pin_string;
+    snap.plannerAvailable = plan_get_block_buffer_available();
+
+    StringPrint state(snap.stateText);
+    state << "<" << state_name();
 
     // Report position
-    float* print_position = get_mpos();
+    StringPrint msg(snap.fields[PositionField]);
+    int32_t*    print_position;
+    int32_t     wpos[MAX_N_AXIS];
     if (bits_are_true(status_mask->get(), RtStatus::Position)) {
         msg << "|MPos:";
+        print_position = get_mpos_um();
     } else {
         msg << "|WPos:";
-        mpos_to_wpos(print_position);
+        float* position = get_mpos();
+        mpos_to_wpos(position);
+        mpos_to_um(position, wpos);
+        print_position = wpos;
     }
-    msg << report_util_axis_values(print_position).c_str();
+    char axes[axesStringLen];
+    msg << report_util_axis_um(print_position, axes);
 
-    // Returns planner and serial read buffer states.
+    // The planner and serial read buffer states are per channel
 
-    if (bits_are_true(status_mask->get(), RtStatus::Buffer)) {
-        msg << "|Bf:" << plan_get_block_buffer_available() << "," << channel.rx_buffer_available();
-    }
+    status_capture_fields(snap);
+    snap.valid = true;
+    ++snap.version;
+}
 
+static void status_capture_fields(StatusSnapshot& snap) {
+    StringPrint lineNumber(snap.fields[LineNumberField]);
     if (config->_useLineNumbers) {
         // Report current line number
         plan_block_t* cur_block = plan_get_current_block();
         if (cur_block != NULL) {
-            uint32_t ln = cur_block->line_number;
+            uint32_t ln = plan_get_block_line_number(cur_block);
             if (ln > 0) {
-                msg << "|Ln:" << ln;
+                lineNumber << "|Ln:" << ln;
             }
         }
     }
@@ -562,12 +738,22 @@ void report_realtime_status(Channel& channel) {
     if (config->_reportInches) {
         rate /= MM_PER_INCH;
     }
-    msg << "|FS:" << setprecision(0) << rate << "," << sys.spindle_speed;
+    StringPrint feedSpeed(snap.fields[FeedSpeedField]);
+    feedSpeed << "|FS:" << setprecision(0) << rate << "," << sys.spindle_speed;
 
+    // FS: carries the programmed speed; a spindle with a tach also reports what it measures
+    StringPrint spindleRpm(snap.fields[SpindleRpmField]);
+    int32_t     actual = spindle->actualSpeed();
+    if (actual >= 0) {
+        spindleRpm << "|RPM:" << actual;
+    }
+
+    StringPrint pins(snap.fields[PinsField]);
     if (report_pin_string.length()) {
-        msg << "|Pn:" << report_pin_string;
+        pins << "|Pn:" << report_pin_string;
     }
 
+    snap.withWco = report_wco_counter == 0;
     if (report_wco_counter > 0) {
         report_wco_counter--;
     } else {
@@ -585,9 +771,13 @@ void report_realtime_status(Channel& channel) {
         if (report_ovr_counter == 0) {
             report_ovr_counter = 1;  // Set override on next report.
         }
-        msg << "|WCO:" << report_util_axis_values(get_wco()).c_str();
     }
+    // WCO:, Ov: and A: are always captured, because delta reports send them whenever they change
+    StringPrint wco(snap.fields[WcoField]);
+    char        axes[axesStringLen];
+    wco << "|WCO:" << report_util_axis_values(get_wco(), axes);
 
+    snap.withOvr = report_ovr_counter == 0;
     if (report_ovr_counter > 0) {
         report_ovr_counter--;
     } else {
@@ -602,47 +792,161 @@ void report_realtime_status(Channel& channel) {
                 report_ovr_counter = (REPORT_OVR_REFRESH_IDLE_COUNT - 1);
                 break;
         }
+    }
+    StringPrint overrides(snap.fields[OverridesField]);
+    overrides << "|Ov:" << int(sys.f_override) << "," << int(sys.r_override) << "," << int(sys.spindle_speed_ovr);
 
-        msg << "|Ov:" << int(sys.f_override) << "," << int(sys.r_override) << "," << int(sys.spindle_speed_ovr);
-        SpindleState sp_state      = spindle->get_state();
-        CoolantState coolant_state = config->_coolant->get_state();
-        if (sp_state != SpindleState::Disable || coolant_state.Mist || coolant_state.Flood) {
-            msg << "|A:";
-            switch (sp_state) {
-                case SpindleState::Disable:
-                    break;
-                case SpindleState::Cw:
-                    msg << "S";
-                    break;
-                case SpindleState::Ccw:
-                    msg << "C";
-                    break;
-                case SpindleState::Unknown:
-                    break;
-            }
+    StringPrint  accessories(snap.fields[AccessoriesField]);
+    SpindleState sp_state      = spindle->get_state();
+    CoolantState coolant_state = config->_coolant->get_state();
+    if (sp_state != SpindleState::Disable || coolant_state.Mist || coolant_state.Flood) {
+        accessories << "|A:";
+        switch (sp_state) {
+            case SpindleState::Disable:
+                break;
+            case SpindleState::Cw:
+                accessories << "S";
+                break;
+            case SpindleState::Ccw:
+                accessories << "C";
+                break;
+            case SpindleState::Unknown:
+                break;
+        }
 
-            auto coolant = coolant_state;
-            if (coolant.Flood) {
-                msg << "F";
-            }
-            if (coolant.Mist) {
-                msg << "M";
-            }
+        auto coolant = coolant_state;
+        if (coolant.Flood) {
+            accessories << "F";
+        }
+        if (coolant.Mist) {
+            accessories << "M";
         }
     }
-    if (InputFile::_progress.length()) {
-        msg << "|" + InputFile::_progress;
+
+    StringPrint fileJob(snap.fields[FileJobField]);
+    StringPrint linesPerSecond(snap.fields[LinesPerSecondField]);
+    std::string progress = InputFile::progress();
+    if (progress.length()) {
+        fileJob << "|" << progress;
+        linesPerSecond << "|Lps:" << InputFile::linesPerSecond();
     }
-#ifdef DEBUG_STEPPER_ISR
-    msg << "|ISRs:" << Stepper::isr_count;
-#endif
+
+    // In whole seconds, so that delta reports carry it once a second
+    StringPrint eta(snap.fields[EtaField]);
+    uint32_t    etaSeconds;
+    if (report_eta(etaSeconds)) {
+        eta << "|ETA:" << etaSeconds;
+    }
+
+    StringPrint isrStats(snap.fields[IsrStatsField]);
+    if (config->_stepping->_reportIsrStats) {
+        auto& stats = Stepper::isr_stats;
+        isrStats << "|Isr:" << stats.max_ticks / ticks_per_us << "," << stats.underruns;
+    }
+
+    StringPrint heap(snap.fields[HeapField]);
 #ifdef DEBUG_REPORT_HEAP
-    msg << "|Heap:" << xPortGetFreeHeapSize();
+    heap << "|Heap:" << xPortGetFreeHeapSize();
 #endif
+
+    // Trinamic drivers that report a fault, from the cached health, e.g. |Drv:XW,Y2G
+    StringPrint drivers(snap.fields[DriverField]);
+    char        sep = ':';
+    for (auto driver : MotorDrivers::TrinamicBase::instances()) {
+        auto health = driver->health();
+        if (!health.valid || !(health.overTemp || health.overTempWarn || health.shortToGround || health.openLoad)) {
+            continue;
+        }
+        std::string name = driver->motorName();
+        drivers << (sep == ':' ? "|Drv" : "") << sep << name.substr(0, name.find(' '));
+        if (health.overTemp) {
+            drivers << "T";
+        }
+        if (health.overTempWarn) {
+            drivers << "W";
+        }
+        if (health.shortToGround) {
+            drivers << "G";
+        }
+        if (health.openLoad) {
+            drivers << "O";
+        }
+        sep = ',';
+    }
+}
+
+// Sends the fields that differ from what the channel last got, or all present
+// ones for a keyframe, and remembers what was sent
+static void status_send_delta(LogStream& msg, StatusDelta& delta, const char* buffer, bool keyframe) {
+    auto& snap = statusSnapshot;
+    delta.fields.resize(NumStatusFields);
+    for (int i = 0; i < NumStatusFields; i++) {
+        std::string& last = delta.fields[i];
+        const char*  now  = i == BufferField ? buffer : snap.fields[i].c_str();
+        if (last == now && !(keyframe && *now)) {
+            continue;
+        }
+        if (*now) {
+            msg << now;
+        } else {
+            // Gone away, so send the key with no value
+            msg << std::string_view(last).substr(0, last.find(':') + 1);
+        }
+        last = now;
+    }
+}
+
+static void status_send(Channel& channel, bool allowDelta) {
+    std::lock_guard<std::mutex> lock(statusMutex);
+    if (!status_snapshot_fresh()) {
+        status_capture();
+    }
+    auto& snap = statusSnapshot;
+
+    char buffer[32] = "";
+    if (bits_are_true(status_mask->get(), RtStatus::Buffer)) {
+        snprintf(buffer, sizeof(buffer), "|Bf:%d,%d", snap.plannerAvailable, channel.rx_buffer_available());
+    }
+
+    LogStream msg(channel, "");
+    msg << snap.stateText;
+    StatusDelta& delta = channel.statusDelta();
+    if (delta.on) {
+        int32_t now      = int32_t(xTaskGetTickCount());
+        bool    keyframe = !allowDelta || delta.fields.empty() || (now - delta.nextKeyframe) >= 0;
+        if (keyframe) {
+            delta.nextKeyframe = now + statusKeyframeMs;
+        }
+        status_send_delta(msg, delta, buffer, keyframe);
+    } else {
+        auto& fields = snap.fields;
+        msg << fields[PositionField] << buffer << fields[LineNumberField] << fields[FeedSpeedField] << fields[SpindleRpmField]
+            << fields[PinsField];
+        if (snap.withWco) {
+            msg << fields[WcoField];
+        }
+        if (snap.withOvr) {
+            msg << fields[OverridesField] << fields[AccessoriesField];
+        }
+        msg << fields[FileJobField] << fields[LinesPerSecondField] << fields[IsrStatsField] << fields[HeapField] << fields[DriverField];
+    }
     msg << ">";
     // The destructor sends the line when msg goes out of scope
 }
 
+// Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
+// and the actual location of the CNC machine. Users may change the following function to their
+// specific needs, but the desired real-time data report must be as short as possible. This is
+// requires as it minimizes the computational overhead to keep running smoothly,
+// especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
+void report_realtime_status(Channel& channel) {
+    status_send(channel, false);
+}
+
+void report_realtime_delta(Channel& channel) {
+    status_send(channel, true);
+}
+
 void hex_msg(uint8_t* buf, const char* prefix, int len) {
     char report[200];
     char temp[20];
@@ -10,7 +10,9 @@
 
 #include "Error.h"
 #include "Config.h"
-#include "Serial.h"  // CLIENT_xxx
+#include "Serial.h"            // CLIENT_xxx
+#include "Types.h"             // State, Percent
+#include "SpindleDatatypes.h"  // SpindleSpeed
 
 #include <cstdint>
 #include <freertos/FreeRTOS.h>  // UBaseType_t
@@ -60,9 +62,47 @@ void report_init_message(Channel& channel);
 // Prints an echo of the pre-parsed line received right before execution.
 void report_echo_line_received(char* line, Channel& channel);
 
-// Prints realtime status report
+// Prints realtime status report.  On a channel in delta status mode it is a keyframe.
 void report_realtime_status(Channel& channel);
 
+// Prints the status report for an automatic report.  On a channel in delta status
+// mode it has only the fields that changed since the last report on that channel,
+// except for a keyframe every statusKeyframeMs that has all of them.  A field that
+// has gone away is sent with an empty value, e.g. "|Pn:".
+const int32_t statusKeyframeMs = 2000;
+void          report_realtime_delta(Channel& channel);
+
+// The content of a status report as values, for internal consumers like displays
+// and status pins.  Positions are in report units, as in the MPos:/WPos: field.
+struct MachineStatus {
+    State        state;
+    const char*  stateName;  // As in status reports, e.g. "Idle" or "Hold:0"
+    bool         isMpos;
+    float        position[MAX_N_AXIS];
+    float        feedRate;
+    SpindleSpeed spindleSpeed;
+    Percent      feedOverride;
+    Percent      rapidOverride;
+    Percent      spindleOverride;
+    bool         probe;
+    bool         limits[MAX_N_AXIS];
+    bool         fileJob;
+    float        filePercent;
+    const char*  filename;  // Valid while the file job runs
+    bool         hasEta;
+    uint32_t     etaSeconds;
+};
+
+// Fills status with the current values.  Channel::autoReport() calls the
+// channel's reportStatus() when they change, so a consumer that overrides
+// reportStatus() to use this gets typed updates at its report interval.
+void report_machine_status(MachineStatus& status);
+
+// The time until the work in hand is done, as in the ETA: field.  For a file job it is
+// the time left from JobStats, and otherwise the time of the buffered motion.  Returns
+// false if there is neither.
+bool report_eta(uint32_t& seconds);
+
 // Prints recorded probe position
 void report_probe_parameters(Channel& channel);
 
@@ -12,6 +12,10 @@
 #include "src/SettingsDefinitions.h"
 #include "FluidPath.h"
 
+#include <algorithm>
+
+EnumItem sdModes[] = { { SDCard::SPI, "SPI" }, { SDCard::SDMMC1, "SDMMC1" }, { SDCard::SDMMC4, "SDMMC4" }, EnumItem(SDCard::SPI) };
+
 SDCard::SDCard() : _state(State::Idle) {}
 
 void SDCard::init() {
@@ -19,11 +23,26 @@ void SDCard::init() {
     pinnum_t    csPin;
     int         csFallback;
 
+    if (_mode != SPI) {
+        int cdPin = -1;
+        if (_cardDetect.defined()) {
+            _cardDetect.setAttr(Pin::Attr::Input);
+            cdPin = _cardDetect.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
+        }
+        log_info("SD Card SDMMC " << _mode << "-bit detect:" << _cardDetect.name() << " freq:" << _frequency_hz);
+        init_message = false;
+        sd_init_sdmmc(_frequency_hz, _mode, cdPin);
+        return;
+    }
+
+    // SPI mode cards are only specified up to 20 MHz
+    uint32_t frequency = std::min(_frequency_hz, uint32_t(20000000));
+
     if (_cs.defined()) {
         if (!config->_spi->defined()) {
             log_error("SD needs SPI defined");
         } else {
-            log_info("SD Card cs_pin:" << _cs.name() << " detect:" << _cardDetect.name() << " freq:" << _frequency_hz);
+            log_info("SD Card cs_pin:" << _cs.name() << " detect:" << _cardDetect.name() << " freq:" << frequency);
             init_message = false;
         }
         _cs.setAttr(Pin::Attr::Output);
@@ -39,9 +58,9 @@ void SDCard::init() {
     if (_cardDetect.defined()) {
         _cardDetect.setAttr(Pin::Attr::Input);
         auto cdPin = _cardDetect.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
-        sd_init_slot(_frequency_hz, csPin, cdPin);
+        sd_init_slot(frequency, csPin, cdPin);
     } else {
-        sd_init_slot(_frequency_hz, csPin);
+        sd_init_slot(frequency, csPin);
     }
 }
 
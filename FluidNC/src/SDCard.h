@@ -16,15 +16,31 @@
  *    VSS      GND
  *    D0       MISO
  *    D1       -
+ *
+ * With mode: SDMMC1 or SDMMC4 the card is run by the native SD host, which
+ * moves the data by DMA instead of through SPI transactions, over one or all
+ * four data lines.  Its pins are fixed on the ESP32, and cs_pin is not used:
+ *
+ * SD Card | ESP32
+ *    CLK      GPIO14
+ *    CMD      GPIO15
+ *    D0       GPIO2
+ *    D1       GPIO4   (SDMMC4 only)
+ *    D2       GPIO12  (SDMMC4 only; a strapping pin, so its pullup must not
+ *                      pull it high at reset on 3.3V flash modules)
+ *    D3       GPIO13  (SDMMC4 only)
  */
 
 #include "Configuration/Configurable.h"
 #include "WebUI/Authentication.h"
 #include "Pin.h"
 #include "Error.h"
+#include "EnumItem.h"
 
 #include <cstdint>
 
+extern EnumItem sdModes[];
+
 class SDCard : public Configuration::Configurable {
 public:
     enum class State : uint8_t {
@@ -37,14 +53,37 @@ public:
         BusyReading   = 6,
     };
 
+    enum Mode : int {
+        SPI    = 0,
+        SDMMC1 = 1,  // Native host, one data line
+        SDMMC4 = 4,  // Native host, four data lines
+    };
+
 private:
     State _state;
     Pin   _cardDetect;
     Pin   _cs;
 
     uint32_t _frequency_hz = 8000000;  // Set to nonzero to override the default
+    int      _mode         = SPI;
 
 public:
+    // Size of each of the two read-ahead buffers of a file job, 0 to read the
+    // file directly.  Applies to files on every file system; see InputFile.h.
+    uint32_t _readAheadBytes = 0;
+
+    // Compiles file jobs on their first run into a .gcb file next to them, and
+    // replays that on later runs while the source is unchanged; see InputFile.h.
+    bool _gcodeCache = false;
+
+    // Holds a file job's cycle start until the planner is full, so that the first
+    // moves do not wait for the reads and parsing of the ones after them.
+    bool _warmup = false;
+
+    // Samples the state of the machine this often during file jobs, 0 not to, and
+    // writes the samples next to the job; see Telemetry.h.
+    uint32_t _telemetryMs = 0;
+
     SDCard();
     SDCard(const SDCard&) = delete;
     SDCard& operator=(const SDCard&) = delete;
@@ -60,7 +99,12 @@ public:
     void group(Configuration::HandlerBase& handler) override {
         handler.item("cs_pin", _cs);
         handler.item("card_detect_pin", _cardDetect);
-        handler.item("frequency_hz", _frequency_hz, 400000, 20000000);
+        handler.item("mode", _mode, sdModes);
+        handler.item("frequency_hz", _frequency_hz, 400000, 40000000);
+        handler.item("read_ahead_bytes", _readAheadBytes, 0, 32768);
+        handler.item("gcode_cache", _gcodeCache);
+        handler.item("warmup", _warmup);
+        handler.item("telemetry_ms", _telemetryMs, 0, 60000);
     }
 
     ~SDCard();
@@ -4,6 +4,8 @@
 #include <OLEDDisplay.h>
 #include "Machine/I2CBus.h"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 
 using namespace Machine;
 
@@ -14,6 +16,45 @@ private:
     int     _frequency;
     bool    _error = false;
 
+    uint8_t* _sent    = nullptr;  // What the display shows, as of the last display()
+    bool     _sentAll = false;    // The first display() sends every page
+
+    // What goes out for a page: the commands, with the control byte for a command stream,
+    // and the data, with the control byte for data
+    struct Stage {
+        uint8_t commands[7];
+        uint8_t data[1 + 128];
+    };
+    Stage*           _stage = nullptr;
+    std::atomic<int> _inflight { 0 };
+
+    static const uint8_t priority = 0;  // Behind anything that is waiting for a value
+
+    static void transferred(void* arg, int result) {
+        auto self = static_cast<SSD1306_I2C*>(arg);
+        if (result < 0 && !self->_error) {
+            log_error("OLED is not responding");
+            self->_error = true;
+        }
+        --self->_inflight;
+    }
+
+    void queue(const uint8_t* data, size_t count) {
+        ++_inflight;
+        I2CBus::Transaction t = { _address, priority, data, count, nullptr, 0, transferred, this };
+        for (int tries = 0; !_i2c->submit(t); tries++) {
+            if (_error || tries == 100) {  // The queue stays full, or the bus did not start
+                if (!_error) {
+                    log_error("OLED cannot queue I2C transfers");
+                    _error = true;
+                }
+                --_inflight;
+                return;
+            }
+            vTaskDelay(1);
+        }
+    }
+
 public:
     SSD1306_I2C(uint8_t address, OLEDDISPLAY_GEOMETRY g, I2CBus* i2c, int frequency) :
         _address(address), _i2c(i2c), _frequency(frequency), _error(false) {
@@ -29,76 +70,57 @@ public:
         return true;
     }
 
+    // Sends only the pages, the 8-pixel bands, that changed since the last display(),
+    // and of each page only the columns from the first to the last that changed, so a
+    // status screen where a digit or two changed costs a few short transfers instead of
+    // the whole frame.  The transfers are queued on the bus, from staging buffers, so this
+    // returns as soon as they are queued, and waits only for those of the frame before.
     void display(void) {
         if (_error) {
             return;
         }
         const int x_offset = (128 - this->width()) / 2;
-#ifdef OLEDDISPLAY_DOUBLE_BUFFER
-        uint8_t minBoundY = UINT8_MAX;
-        uint8_t maxBoundY = 0;
-
-        uint8_t minBoundX = UINT8_MAX;
-        uint8_t maxBoundX = 0;
-        uint8_t x, y;
-
-        // Calculate the Y bounding box of changes
-        // and copy buffer[pos] to buffer_back[pos];
-        for (y = 0; y < (this->height() / 8); y++) {
-            for (x = 0; x < this->width(); x++) {
-                uint16_t pos = x + y * this->width();
-                if (buffer[pos] != buffer_back[pos]) {
-                    minBoundY = std::min(minBoundY, y);
-                    maxBoundY = std::max(maxBoundY, y);
-                    minBoundX = std::min(minBoundX, x);
-                    maxBoundX = std::max(maxBoundX, x);
-                }
-                buffer_back[pos] = buffer[pos];
-            }
-            yield();
+        const int pages    = this->height() / 8;
+        const int width    = this->width();
+        if (!_sent) {
+            _sent    = new uint8_t[displayBufferSize]();
+            _stage   = new Stage[pages];
+            _sentAll = true;
         }
-
-        // If the minBoundY wasn't updated
-        // we can savely assume that buffer_back[pos] == buffer[pos]
-        // holdes true for all values of pos
-
-        if (minBoundY == UINT8_MAX)
-            return;
-
-        sendCommand(COLUMNADDR);
-        sendCommand(x_offset + minBoundX);  // column start address (0 = reset)
-        sendCommand(x_offset + maxBoundX);  // column end address (127 = reset)
-
-        sendCommand(PAGEADDR);
-        sendCommand(minBoundY);  // page start address
-        sendCommand(maxBoundY);  // page end address
-
-        for (y = minBoundY; y <= maxBoundY; y++) {
-            uint8_t* start = &buffer[(minBoundX + y * this->width()) - 1];
-            uint8_t  save  = *start;
-
-            *start = 0x40;  // control
-            _i2c->write(_address, start, (maxBoundX - minBoundX) + 1 + 1);
-            *start = save;
+        while (_inflight.load()) {
+            vTaskDelay(1);
         }
-#else
-
-        sendCommand(COLUMNADDR);
-        sendCommand(x_offset);                        // column start address (0 = reset)
-        sendCommand(x_offset + (this->width() - 1));  // column end address (127 = reset)
 
-        sendCommand(PAGEADDR);
-        sendCommand(0x0);  // page start address (0 = reset)
-
-        if (geometry == GEOMETRY_128_64) {
-            sendCommand(0x7);
-        } else if (geometry == GEOMETRY_128_32) {
-            sendCommand(0x3);
+        for (int page = 0; page < pages; page++) {
+            uint8_t* now  = &buffer[page * width];
+            uint8_t* sent = &_sent[page * width];
+            int      x0   = 0;
+            int      x1   = width - 1;
+            if (!_sentAll) {
+                while (x0 < width && now[x0] == sent[x0]) {
+                    x0++;
+                }
+                if (x0 == width) {
+                    continue;
+                }
+                while (now[x1] == sent[x1]) {
+                    x1--;
+                }
+            }
+            int    count = x1 - x0 + 1;
+            Stage& stage = _stage[page];
+            uint8_t commands[] = {
+                0x00, COLUMNADDR, uint8_t(x_offset + x0), uint8_t(x_offset + x1), PAGEADDR, uint8_t(page), uint8_t(page),
+            };
+            memcpy(stage.commands, commands, sizeof(commands));
+            stage.data[0] = 0x40;  // control
+            memcpy(stage.data + 1, now + x0, count);
+            memcpy(sent + x0, now + x0, count);
+
+            queue(stage.commands, sizeof(stage.commands));
+            queue(stage.data, count + 1);
         }
-
-        buffer[-1] = 0x40;  // control
-        _i2c->write(_address, (char*)&buffer[-1], displayBufferSize + 1);
-#endif
+        _sentAll = false;
     }
 
 private:
@@ -0,0 +1,86 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "SdArbiter.h"
+
+#include "FileStream.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace SdArbiter {
+    static std::atomic<int> waiting[nClients];  // Clients of each class waiting for an Access
+    static std::atomic<int> jobsOpen(0);
+
+    // A mutex rather than a binary semaphore, so a lower class holding it runs at the
+    // priority of the job waiting for it
+    static SemaphoreHandle_t lock() {
+        static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+        return mutex;
+    }
+
+    static bool higher_waiting(Client client) {
+        for (int c = Job; c < client; c++) {
+            if (waiting[c].load()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Access::Access(Client client) {
+        if (client != Job && job_open()) {
+            vTaskDelay(pauseMs / portTICK_PERIOD_MS);
+        }
+        ++waiting[client];
+        while (true) {
+            xSemaphoreTake(lock(), portMAX_DELAY);
+            if (!higher_waiting(client)) {
+                break;
+            }
+            // The mutex goes to the highest priority task waiting, which need not be of
+            // the highest class, so the others step aside until that one has it
+            xSemaphoreGive(lock());
+            vTaskDelay(1);
+        }
+        --waiting[client];
+    }
+
+    Access::~Access() { xSemaphoreGive(lock()); }
+
+    size_t chunk_size(Client client) { return client == Job || !job_open() ? SIZE_MAX : chunkBytes; }
+
+    size_t read(FileStream& file, uint8_t* buffer, size_t length, Client client) {
+        size_t done = 0;
+        while (done < length) {
+            Access sd(client);
+            size_t n = file.read(buffer + done, std::min(length - done, chunk_size(client)));
+            if (!n) {
+                break;
+            }
+            done += n;
+        }
+        return done;
+    }
+
+    size_t write(FileStream& file, const uint8_t* data, size_t length, Client client) {
+        size_t done = 0;
+        while (done < length) {
+            Access sd(client);
+            size_t want = std::min(length - done, chunk_size(client));
+            size_t n    = file.write(data + done, want);
+            done += n;
+            if (n != want) {
+                break;
+            }
+        }
+        return done;
+    }
+
+    void job_opened() { ++jobsOpen; }
+    void job_closed() { --jobsOpen; }
+    bool job_open() { return jobsOpen.load() > 0; }
+}
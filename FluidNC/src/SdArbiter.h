@@ -0,0 +1,67 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  SdArbiter.h - the order in which the tasks that use the card get to it
+
+  A file job, its telemetry and the WebUI's file operations all go through the one SPI
+  bus and file system lock, which serve whoever asks first, so a browser listing or
+  downloading files could hold up the reads of a running job until its motion starved.
+  Each of those clients now takes an Access of its class around every transfer, and an
+  Access waits while a client of a higher class is waiting: the read-ahead of a file
+  job first, then telemetry, then the WebUI.
+
+  While a file job is open, the lower classes are held to transfers of at most
+  chunkBytes, found with chunk_size(), and wait pauseMs before each one, so the job
+  never waits for more than one of them, and a job that reads without read-ahead, from
+  the main task, finds the bus free most of the time.  An Access must not be held while
+  waiting on the network, since the job would wait with it.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+class FileStream;
+
+namespace SdArbiter {
+    enum Client : uint8_t {
+        Job,        // Read-ahead of a file job
+        Telemetry,  // Telemetry of a file job
+        Web,        // WebUI listings, downloads, uploads and file management
+        nClients,
+    };
+
+    const size_t   chunkBytes = 1024;  // Largest transfer of a lower class while a job is open
+    const uint32_t pauseMs    = 2;     // Before each transfer of a lower class while a job is open
+
+    class Access {
+    public:
+        explicit Access(Client client);
+        ~Access();
+
+        Access(const Access&)            = delete;
+        Access& operator=(const Access&) = delete;
+    };
+
+    // The largest transfer that the client should make under one Access
+    size_t chunk_size(Client client);
+
+    // Transfers in pieces of chunk_size(), each under an Access of its own.  They return
+    // the bytes transferred, less than length if the file ran out or a transfer failed.
+    size_t read(FileStream& file, uint8_t* buffer, size_t length, Client client);
+    size_t write(FileStream& file, const uint8_t* data, size_t length, Client client);
+
+    // Runs fn under an Access and returns what it returns, for a single operation such as
+    // opening a file or reading a directory entry
+    template <typename F>
+    auto with(Client client, F fn) -> decltype(fn()) {
+        Access sd(client);
+        return fn();
+    }
+
+    // Called as file jobs are opened and closed
+    void job_opened();
+    void job_closed();
+    bool job_open();
+}
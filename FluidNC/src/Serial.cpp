@@ -43,6 +43,7 @@
 #include "WebUI/InputBuffer.h"
 #include "WebUI/Commands.h"
 #include "WebUI/WifiServices.h"
+#include "WebUI/WifiConfig.h"
 #include "MotionControl.h"
 #include "Report.h"
 #include "System.h"
@@ -51,6 +52,9 @@
 #include "WebUI/InputBuffer.h"  // XXX could this be a StringStream ?
 #include "Main.h"               // display()
 #include "StartupLog.h"         // startupLog
+#include "Stepper.h"            // poll_trace
+#include "Mpg.h"                // Mpg::check
+#include "LineQueue.h"
 
 #include "Driver/fluidnc_gpio.h"
 
@@ -120,7 +124,11 @@ void AllChannels::listChannels(Channel& out) {
     _mutex_general.lock();
     std::string retval;
     for (auto channel : _channelq) {
-        log_stream(out, channel->name());
+        if (channel->pinFrames()) {
+            log_stream(out, channel->name() << " pin frames, oldest input edge " << channel->pinEdgeMaxAge() << " us");
+        } else {
+            log_stream(out, channel->name());
+        }
     }
     _mutex_general.unlock();
 }
@@ -180,6 +188,22 @@ void AllChannels::print_msg(MsgLevel level, const char* msg) {
     _mutex_general.unlock();
 }
 
+void AllChannels::beginOutputBatch() {
+    _mutex_general.lock();
+    for (auto channel : _channelq) {
+        channel->beginOutputBatch();
+    }
+    _mutex_general.unlock();
+}
+
+void AllChannels::flushOutputBatch() {
+    _mutex_general.lock();
+    for (auto channel : _channelq) {
+        channel->flushOutputBatch();
+    }
+    _mutex_general.unlock();
+}
+
 Channel* AllChannels::find(const std::string& name) {
     _mutex_general.lock();
     for (auto channel : _channelq) {
@@ -193,8 +217,11 @@ Channel* AllChannels::find(const std::string& name) {
 }
 Channel* AllChannels::pollLine(char* line) {
     Channel* deadChannel;
-    while (xQueueReceive(_killQueue, &deadChannel, 0)) {
+    // A channel whose lines are still queued is deleted once they have run
+    while (xQueuePeek(_killQueue, &deadChannel, 0) && !LineQueue::holds(deadChannel)) {
+        xQueueReceive(_killQueue, &deadChannel, 0);
         deregistration(deadChannel);
+        Stepper::stop_trace(deadChannel);
         delete deadChannel;
     }
 
@@ -203,9 +230,11 @@ Channel* AllChannels::pollLine(char* line) {
     // one that returned a line.
     _mutex_pollLine.lock();
 
+    // A channel that already has its share of the line queue is only polled
+    // for realtime characters.
     for (auto channel : _channelq) {
         // Skip the last channel in the loop
-        if (channel != _lastChannel && channel && channel->pollLine(line)) {
+        if (channel != _lastChannel && channel && channel->pollLine(line && LineQueue::room(channel) ? line : nullptr) && line) {
             _lastChannel = channel;
             _mutex_pollLine.unlock();
             return _lastChannel;
@@ -213,7 +242,7 @@ Channel* AllChannels::pollLine(char* line) {
     }
     _mutex_pollLine.unlock();
     // If no other channel returned a line, try the last one
-    if (_lastChannel && _lastChannel->pollLine(line)) {
+    if (_lastChannel && _lastChannel->pollLine(line && LineQueue::room(_lastChannel) ? line : nullptr) && line) {
         return _lastChannel;
     }
     _lastChannel = nullptr;
@@ -224,24 +253,16 @@ AllChannels allChannels;
 
 Channel* pollChannels(char* line) {
     poll_gpios();
-    // Throttle polling when we are not ready for a line, thus preventing
-    // planner buffer starvation due to not calling Stepper::prep_buffer()
-    // frequently enough, which is normally called periodically at the end
-    // of protocol_exec_rt_system() via protocol_execute_realtime().
-    static int counter = 0;
-    if (line) {
-        counter = 0;
-    }
-    if (counter > 0) {
-        --counter;
-        return nullptr;
-    }
-    counter = 50;
 
+    // The polling task sleeps between calls, so no throttling is needed here
+    // to leave time for Stepper::prep_buffer() in the primary loop.
     Channel* retval = allChannels.pollLine(line);
 
+    Stepper::poll_trace();
+    Mpg::check();
+
     WebUI::COMMANDS::handle();      // Handles ESP restart
-    WebUI::wifi_services.handle();  // OTA, webServer, telnetServer polling
+    WebUI::WiFiConfig::handle();  // OTA, telnetServer polling, power saving
 
     return retval;
 }
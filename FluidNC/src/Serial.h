@@ -46,6 +46,8 @@ public:
     size_t write(const uint8_t* buffer, size_t length) override;
 
     void print_msg(MsgLevel level, const char* msg) override;
+    void beginOutputBatch() override;
+    void flushOutputBatch() override;
 
     void flushRx();
 
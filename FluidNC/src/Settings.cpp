@@ -4,14 +4,17 @@
 #include "WebUI/WifiConfig.h"   // WebUI::WiFiConfig
 #include "WebUI/Commands.h"     // WebUI::COMMANDS
 #include "System.h"             // sys
-#include "Protocol.h"           // protocol_buffer_synchronize
+#include "Planner.h"            // plan_get_current_block
 #include "Machine/MachineConfig.h"
 
 #include <map>
 #include <limits>
+#include <cctype>
 #include <cstring>
 #include <vector>
 #include <nvs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>  // xTaskGetTickCount()
 
 std::vector<Setting*> Setting::List __attribute__((init_priority(101))) = {};
 std::vector<Command*> Command::List __attribute__((init_priority(102))) = {};
@@ -32,11 +35,82 @@ bool cycleOrHold() {
 Word::Word(type_t type, permissions_t permissions, const char* description, const char* grblName, const char* fullName) :
     _description(description), _grblName(grblName), _fullName(fullName), _type(type), _permissions(permissions) {}
 
+// FNV-1a of the lower case name
+uint32_t NameIndex::hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (; *name; ++name) {
+        h = (h ^ uint8_t(tolower(*name))) * 16777619u;
+    }
+    return h;
+}
+
+// Kept at most three quarters full, so probe runs stay short
+void NameIndex::grow() {
+    std::vector<Slot> old;
+    old.swap(_slots);
+    _slots.assign(old.empty() ? 64 : old.size() * 2, Slot { nullptr, nullptr });
+    _count = 0;
+    for (auto& slot : old) {
+        if (slot.name) {
+            add(slot.name, slot.word);
+        }
+    }
+}
+
+void NameIndex::add(const char* name, Word* word) {
+    if ((_count + 1) * 4 > _slots.size() * 3) {
+        grow();
+    }
+    size_t mask = _slots.size() - 1;
+    for (size_t i = hash(name) & mask;; i = (i + 1) & mask) {
+        if (!_slots[i].name) {
+            _slots[i] = { name, word };
+            ++_count;
+            return;
+        }
+        if (strcasecmp(_slots[i].name, name) == 0) {
+            _slots[i].word = word;
+            return;
+        }
+    }
+}
+
+Word* NameIndex::find(const char* name) const {
+    if (_slots.empty()) {
+        return nullptr;
+    }
+    size_t mask = _slots.size() - 1;
+    for (size_t i = hash(name) & mask; _slots[i].name; i = (i + 1) & mask) {
+        if (strcasecmp(_slots[i].name, name) == 0) {
+            return _slots[i].word;
+        }
+    }
+    return nullptr;
+}
+
+// The indexes are made on first use, since words can be constructed during static initialization
+NameIndex& Command::index() {
+    static NameIndex names;
+    return names;
+}
+NameIndex& Setting::index() {
+    static NameIndex names;
+    return names;
+}
+NameIndex& Setting::grblIndex() {
+    static NameIndex names;
+    return names;
+}
+
 Command::Command(
     const char* description, type_t type, permissions_t permissions, const char* grblName, const char* fullName, bool (*cmdChecker)()) :
     Word(type, permissions, description, grblName, fullName),
     _cmdChecker(cmdChecker) {
     List.insert(List.begin(), this);
+    index().add(fullName, this);
+    if (grblName) {
+        index().add(grblName, this);
+    }
 }
 
 Setting::Setting(
@@ -44,6 +118,10 @@ Setting::Setting(
     Word(type, permissions, description, grblName, fullName),
     _checker(checker) {
     List.insert(List.begin(), this);
+    index().add(fullName, this);
+    if (grblName) {
+        grblIndex().add(grblName, this);
+    }
 
     // NVS keys are limited to 15 characters, so if the setting name is longer
     // than that, we derive a 15-character name from a hash function
@@ -425,12 +503,49 @@ bool Coordinates::load() {
     }
 };
 
+bool    Coordinates::_pending    = false;
+int32_t Coordinates::_lastChange = 0;
+
+void Coordinates::write() {
+    nvs_set_blob(Setting::_handle, _name, _currentValue, sizeof(_currentValue));
+    _dirty = false;
+}
+
+// NVS keeps its own journal in flash, so a write is safe from power loss once it returns,
+// but it stalls the flash cache, which is why the planner has to be emptied first.  G10,
+// G28.1 and G30.1 only change the value in memory, which is what GCode reads, and the
+// main loop writes it back once the machine has stopped and the values have settled, so
+// neither the motion nor a probing cycle that sets an offset per part waits on flash, and
+// a job that sets the same offset over and over writes it once.  A value that does not
+// change is not written.
 void Coordinates::set(float value[MAX_N_AXIS]) {
+    if (!memcmp(_currentValue, value, sizeof(_currentValue))) {
+        return;
+    }
     memcpy(&_currentValue, value, sizeof(_currentValue));
-    if (FORCE_BUFFER_SYNC_DURING_NVS_WRITE) {
-        protocol_buffer_synchronize();
+    _dirty      = true;
+    _pending    = true;
+    _lastChange = xTaskGetTickCount();
+}
+
+void Coordinates::flush(bool force) {
+    if (!_pending) {
+        return;
     }
-    nvs_set_blob(Setting::_handle, _name, _currentValue, sizeof(_currentValue));
+    if (!force) {
+        if (FORCE_BUFFER_SYNC_DURING_NVS_WRITE && (plan_get_current_block() || inMotionState())) {
+            return;
+        }
+        if (int32_t(xTaskGetTickCount() - _lastChange) < int32_t(COORD_WRITE_HOLDOFF_MS / portTICK_PERIOD_MS)) {
+            return;
+        }
+    }
+    for (auto c : coords) {
+        if (c && c->_dirty) {
+            c->write();
+        }
+    }
+    _pending = false;
 }
 
 IPaddrSetting::IPaddrSetting(const char*   description,
@@ -77,15 +77,40 @@ public:
     const char*   getDescription() { return _description; }
 };
 
+// An open-addressed hash table of words by name, ignoring case, so that a $ line finds its
+// setting or command in constant time however many are registered.  A word can be added
+// under each of its names.  Adding a name again replaces the word, so the latest one wins,
+// as it did when the lists were searched from the front.
+class NameIndex {
+    struct Slot {
+        const char* name;
+        Word*       word;
+    };
+    std::vector<Slot> _slots;
+    size_t            _count = 0;
+
+    static uint32_t hash(const char* name);
+    void            grow();
+
+public:
+    void  add(const char* name, Word* word);
+    Word* find(const char* name) const;
+};
+
 class Command : public Word {
 protected:
     bool (*_cmdChecker)();
 
+    static NameIndex& index();
+
 public:
     // Command::List is a vector of all commands,
     // so common code can enumerate them.
     static std::vector<Command*> List;
 
+    // The command with either name, or nullptr
+    static Command* find(const char* name) { return static_cast<Command*>(index().find(name)); }
+
     ~Command() {}
     Command(const char* description, type_t type, permissions_t permissions, const char* grblName, const char* fullName, bool (*cmdChecker)());
 
@@ -105,6 +130,9 @@ protected:
     bool (*_checker)(char*);
     const char* _keyName;
 
+    static NameIndex& index();
+    static NameIndex& grblIndex();
+
 public:
     static nvs_handle _handle;
     static void       init();
@@ -113,6 +141,10 @@ public:
     // so common code can enumerate them.
     static std::vector<Setting*> List;
 
+    // The setting with the full name, or with the compatible name, or nullptr
+    static Setting* find(const char* name) { return static_cast<Setting*>(index().find(name)); }
+    static Setting* findGrbl(const char* grblName) { return static_cast<Setting*>(grblIndex().find(grblName)); }
+
     Error check(char* s);
 
     static Error report_nvs_stats(const char* value, WebUI::AuthenticationLevel auth_level, Channel& out) {
@@ -222,6 +254,12 @@ class Coordinates {
 private:
     float       _currentValue[MAX_N_AXIS];
     const char* _name;
+    bool        _dirty = false;  // Changed, and not written yet
+
+    static bool    _pending;     // Some instance is dirty
+    static int32_t _lastChange;  // Tick count of the last change to any instance
+
+    void write();
 
 public:
     Coordinates(const char* name) : _name(name) {}
@@ -239,6 +277,10 @@ public:
     // Return a pointer to the array
     const float* get() { return _currentValue; }
     void         set(float* value);
+
+    // Writes the values that set() held back, once the machine has stopped and nothing
+    // has changed for COORD_WRITE_HOLDOFF_MS, or at once if force is set, as before a restart
+    static void flush(bool force = false);
 };
 
 extern Coordinates* coords[CoordIndex::End];
@@ -15,6 +15,10 @@ StringSetting* start_message;
 IntSetting* status_mask;
 
 IntSetting* sd_fallback_cs;
+IntSetting* stall_ms;
+
+IntSetting* job_setup_macro;
+IntSetting* job_teardown_macro;
 
 EnumSetting* message_level;
 
@@ -76,6 +80,30 @@ void make_settings() {
 
     sd_fallback_cs = new IntSetting("SD CS pin if not configured", EXTENDED, WG, NULL, "SD/FallbackCS", -1, -1, 40, NULL);
 
+    stall_ms =
+        new IntSetting("Main loop stall warning threshold in ms, 0 to disable", EXTENDED, WG, NULL, "System/StallMs", 200, 0, 10000, NULL);
+
+    // Macros 0 to 3, run around each run of a file in the job queue; see JobQueue.h
+    int lastMacro = Machine::Macros::n_macros - 1;
+    job_setup_macro    = new IntSetting("Macro to run before each queued job, -1 for none",
+                                     EXTENDED,
+                                     WG,
+                                     NULL,
+                                     "Jobs/SetupMacro",
+                                     -1,
+                                     -1,
+                                     lastMacro,
+                                     NULL);
+    job_teardown_macro = new IntSetting("Macro to run after each queued job, -1 for none",
+                                        EXTENDED,
+                                        WG,
+                                        NULL,
+                                        "Jobs/TeardownMacro",
+                                        -1,
+                                        -1,
+                                        lastMacro,
+                                        NULL);
+
     build_info = new StringSetting("OEM build info for $I command", EXTENDED, WG, NULL, "Firmware/Build", "", 0, 20, NULL);
 
     start_message =
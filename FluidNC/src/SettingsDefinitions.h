@@ -12,4 +12,9 @@ extern IntSetting* status_mask;
 
 extern IntSetting* sd_fallback_cs;
 
+extern IntSetting* stall_ms;
+
+extern IntSetting* job_setup_macro;
+extern IntSetting* job_teardown_macro;
+
 extern EnumSetting* message_level;
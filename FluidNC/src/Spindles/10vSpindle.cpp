@@ -48,6 +48,7 @@ namespace Spindles {
         stop();
 
         config_message();
+        init_tach();
 
         is_reversable = true;  // these VFDs are always reversable
     }
@@ -57,6 +57,7 @@ namespace Spindles {
         setupSpeeds(_pwm->period());       // Map the entire pulse width period in counts
         stop();
         config_message();
+        init_tach();
     }
 
     void IRAM_ATTR BESC::set_output(uint32_t duty) {
@@ -28,6 +28,10 @@ namespace Spindles {
         void init() override;
         void set_direction(bool Clockwise) override {};
         bool use_delay_settings() const override { return false; }
+
+        uint32_t powerUpdates() override { return _powerUpdates; }
+        int32_t  powerLeadUsecs() override { return _powerLeadUsecs; }
+        bool     ratePower() override { return _ratePower; }
         // Name of the configurable. Must match the name registered in the cpp file.
         const char* name() const override { return "Laser"; }
 
@@ -36,9 +40,24 @@ namespace Spindles {
             // We cannot call PWM::group() because that would pick up
             // direction_pin, which we do not want in Laser
             handler.item("pwm_hz", _pwm_freq, 1000, 100000);
+            handler.item("power_updates", _powerUpdates, 1, 32);
+            handler.item("power_lead_us", _powerLeadUsecs, -20000, 20000);
+            handler.item("rate_power", _ratePower);
             OnOff::groupCommon(handler);
         }
 
         ~Laser() {}
+
+    protected:
+        // In M4, the number of power levels per step segment, following the speed within
+        // the segment, and how far ahead of the motion the power is taken.  A negative
+        // lead makes the power lag the motion.
+        uint32_t _powerUpdates   = 1;
+        int32_t  _powerLeadUsecs = 0;
+
+        // In M4, take the power from the step rate of each ISR tick instead, so the energy
+        // per mm holds through acceleration and fast holds.  power_updates and power_lead_us
+        // are then not used, and the power stops rising at the programmed rate.
+        bool _ratePower = false;
     };
 }
@@ -220,6 +220,46 @@ namespace Spindles {
         };
     }
 
+    VFD::response_parser NowForever::get_current_state(ModbusCommand& data) {
+        data.tx_length = 6;
+        data.rx_length = 9;
+
+        data.msg[1] = 0x03;  // READ
+        data.msg[2] = 0x05;  // Register address, high byte (inverter running state)
+        data.msg[3] = 0x00;  // Register address, low byte (inverter running state)
+        data.msg[4] = 0x00;  // Number of elements, high byte
+        data.msg[5] = 0x03;  // Number of elements, low byte (0x0500 to 0x0502)
+
+        /*
+        Contents of register 0x0500: running state, as for get_current_direction
+        Contents of register 0x0502: current output frequency in hz * 100
+        */
+
+        return [](const uint8_t* response, Spindles::VFD* vfd) -> bool {
+            if (response[1] != 0x03) {
+                return false;
+            }
+
+            // We expect a result length of 6 bytes
+            if (response[2] != 6) {
+                return false;
+            }
+
+            bool running   = response[4] & 0b00000001;
+            bool direction = response[4] & 0b00000010;  // false = cw, true = ccw
+
+            if (running) {
+                log_debug("VFD: Got direction " << (direction ? "CCW" : "CW"));
+            } else {
+                log_debug("VFD: Got spindle not running");
+            }
+
+            vfd->_sync_dev_speed = (uint16_t(response[7]) << 8) | uint16_t(response[8]);
+
+            return true;
+        };
+    }
+
     VFD::response_parser NowForever::get_status_ok(ModbusCommand& data) {
         data.tx_length = 6;
         data.rx_length = 5;
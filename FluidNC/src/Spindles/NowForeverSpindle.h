@@ -16,6 +16,7 @@ namespace Spindles {
         response_parser initialization_sequence(int index, ModbusCommand& data) override;
         response_parser get_current_speed(ModbusCommand& data) override;
         response_parser get_current_direction(ModbusCommand& data) override;
+        response_parser get_current_state(ModbusCommand& data) override;
         response_parser get_status_ok(ModbusCommand& data) override;
         bool            safety_polling() const { return true; }
 
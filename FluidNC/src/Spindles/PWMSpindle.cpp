@@ -10,6 +10,10 @@
 #include "../System.h"  // sys
 #include "../GCode.h"   // gc_state.modal
 
+#include "Driver/PulseCounter.h"
+
+#include <algorithm>
+
 // ======================= PWM ==============================
 /*
     This gets called at startup or whenever a spindle setting changes
@@ -43,10 +47,93 @@ namespace Spindles {
         }
         setupSpeeds(_pwm->period());
         config_message();
+        init_tach();
+    }
+
+    void PWM::init_tach() {
+        if (!_tach_pin.defined()) {
+            return;
+        }
+        _tach_pin.setAttr(Pin::Attr::Input);
+        auto pin   = _tach_pin.getNative(Pin::Capabilities::Input | Pin::Capabilities::Native);
+        _tach_unit = pulse_counter_attach(pin, false);
+        if (_tach_unit < 0) {
+            log_error(name() << " no pulse counter is free for the tach pin");
+            return;
+        }
+        // Tach sensors are slow and often noisy, so ignore glitches shorter than 10us
+        pulse_counter_set_filter(_tach_unit, 800);
+        _tach_count = pulse_counter_read(_tach_unit);
+
+        auto timer = xTimerCreate("Tach", tachPeriodMs / portTICK_PERIOD_MS, true, this, tach_timer);
+        if (!timer || xTimerStart(timer, 0) == pdFAIL) {
+            log_error(name() << " failed to start the tach timer");
+            _tach_unit = -1;
+            return;
+        }
+        log_info("    Tach:" << _tach_pin.name() << " PPR:" << _tach_ppr << " P:" << _tach_kp << " I:" << _tach_ki);
+    }
+
+    // With one tach pulse per revolution, as threading needs, each pulse is the index.
+    // With more, this waits for the next pulse, so passes line up only to 1/ppr of a turn.
+    // The wait spins rather than sleeps so that the motion starts promptly after the pulse.
+    bool PWM::waitIndex(uint32_t timeout_ms) {
+        if (_tach_unit < 0) {
+            return false;
+        }
+        uint32_t   start    = pulse_counter_read(_tach_unit);
+        TickType_t deadline = xTaskGetTickCount() + timeout_ms / portTICK_PERIOD_MS;
+        while (pulse_counter_read(_tach_unit) == start) {
+            if (int32_t(xTaskGetTickCount() - deadline) > 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PWM::tach_timer(TimerHandle_t timer) {
+        static_cast<PWM*>(pvTimerGetTimerID(timer))->update_tach();
+    }
+
+    // Runs every tachPeriodMs in the timer task.  The counter does the counting, so
+    // the estimate costs one register read and a little integer arithmetic.
+    void PWM::update_tach() {
+        uint32_t count  = pulse_counter_read(_tach_unit);
+        uint32_t pulses = (count + pulseCounterLimit - _tach_count) % pulseCounterLimit;
+        _tach_count     = count;
+
+        // Averaging with the previous estimate halves the count quantization noise at low speeds
+        int32_t rpm = pulses * (60000 / tachPeriodMs) / _tach_ppr;
+        _tach_rpm   = (_tach_rpm + rpm) / 2;
+
+        // Correct only at a steady programmed speed; _current_state changes after the spin-up delay
+        int32_t target = sys.spindle_speed;
+        if ((_tach_kp == 0 && _tach_ki == 0) || _current_state == SpindleState::Disable || target == 0 || isRateAdjusted()) {
+            _tach_integral = 0;
+            return;
+        }
+
+        int32_t error = target - _tach_rpm;
+        int32_t limit = target * int32_t(_tach_max_correction) / 100;
+        if (_tach_ki) {
+            // Stop integrating once the integral alone would exceed the correction limit
+            int32_t windup = limit * 1000 / int32_t(_tach_ki);
+            _tach_integral = std::clamp(_tach_integral + error, -windup, windup);
+        }
+        int32_t correction = (int32_t(_tach_kp) * error + int32_t(_tach_ki) * _tach_integral) / 1000;
+        correction         = std::clamp(correction, -limit, limit);
+
+        set_output(speedToDev(target + correction));
     }
 
     void IRAM_ATTR PWM::setSpeedfromISR(uint32_t dev_speed) {
-        set_enable(gc_state.modal.spindle != SpindleState::Disable);
+        // The enable pin is only written when it changes, so that a laser power
+        // update during a raster line is just the duty register write.
+        int8_t enable = gc_state.modal.spindle != SpindleState::Disable;
+        if (_disable_with_zero_speed || enable != _isr_enable) {
+            _isr_enable = enable;
+            set_enable(enable);
+        }
         set_output(dev_speed);
     }
 
@@ -86,6 +173,7 @@ namespace Spindles {
         }
 
         set_enable(state != SpindleState::Disable);
+        _isr_enable = state != SpindleState::Disable;
         spindleDelay(state, speed);
     }
 
@@ -11,6 +11,8 @@
 #include "OnOffSpindle.h"
 #include "Driver/PwmPin.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>  // TimerHandle_t
 #include <cstdint>
 
 namespace Spindles {
@@ -32,6 +34,9 @@ namespace Spindles {
         void setSpeedfromISR(uint32_t dev_speed) override;
         void setState(SpindleState state, SpindleSpeed speed) override;
         void config_message() override;
+
+        int32_t actualSpeed() override { return _tach_unit < 0 ? -1 : _tach_rpm; }
+        bool    waitIndex(uint32_t timeout_ms) override;
         // Configuration handlers:
         void validate() override { Spindle::validate(); }
 
@@ -50,6 +55,14 @@ namespace Spindles {
             // user choose.
             handler.item("pwm_hz", _pwm_freq, 1, 20000000);
 
+            // A tachometer pin gives the measured speed, and with nonzero gains, a
+            // PI loop trims the output toward the programmed speed.
+            handler.item("tach_pin", _tach_pin);
+            handler.item("tach_pulses_per_rev", _tach_ppr, 1, 1000);
+            handler.item("tach_p_gain", _tach_kp, 0, 10000);
+            handler.item("tach_i_gain", _tach_ki, 0, 10000);
+            handler.item("tach_max_correction_percent", _tach_max_correction, 0, 50);
+
             OnOff::group(handler);
         }
 
@@ -61,11 +74,32 @@ namespace Spindles {
     protected:
         uint32_t _current_pwm_duty = 0;
         PwmPin* _pwm              = nullptr;
+        int8_t   _isr_enable       = -1;  // Enable last written, or -1 if unknown
 
         // Configurable
         uint32_t _pwm_freq = 5000;
 
+        Pin      _tach_pin;
+        uint32_t _tach_ppr            = 1;   // Pulses per revolution
+        uint32_t _tach_kp             = 0;   // Thousandths of an RPM of correction per RPM of error
+        uint32_t _tach_ki             = 0;   // The same, per RPM of error summed over tach periods
+        uint32_t _tach_max_correction = 10;  // Percent of the programmed speed
+
         void         set_output(uint32_t duty) override;
         virtual void deinit();
+
+        // Subclasses that do not use PWM::init() call this from their own init()
+        void init_tach();
+
+    private:
+        static const int tachPeriodMs = 100;
+
+        int              _tach_unit     = -1;  // Pulse counter unit, or -1 without a tach
+        uint32_t         _tach_count    = 0;   // Count at the previous update
+        volatile int32_t _tach_rpm      = 0;
+        int32_t          _tach_integral = 0;
+
+        static void tach_timer(TimerHandle_t timer);
+        void        update_tach();
     };
 }
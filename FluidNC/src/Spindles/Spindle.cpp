@@ -8,20 +8,26 @@
 
 #include "../System.h"  //sys.spindle_speed_ovr
 #include <esp32-hal.h>  // delay()
+#include <algorithm>
 
 Spindles::Spindle* spindle = nullptr;
 
 namespace Spindles {
     // ========================= Spindle ==================================
 
-    void Spindle::switchSpindle(uint32_t new_tool, SpindleList spindles, Spindle*& spindle) {
-        // Find the spindle whose tool number is closest to and below the new tool number
+    // Finds the spindle whose tool number is closest to and below the tool number
+    Spindle* Spindle::forTool(uint32_t tool, SpindleList spindles) {
         Spindle* candidate = nullptr;
         for (auto s : spindles) {
-            if (s->_tool <= new_tool && (!candidate || candidate->_tool < s->_tool)) {
+            if (s->_tool <= tool && (!candidate || candidate->_tool < s->_tool)) {
                 candidate = s;
             }
         }
+        return candidate;
+    }
+
+    void Spindle::switchSpindle(uint32_t new_tool, SpindleList spindles, Spindle*& spindle) {
+        Spindle* candidate = forTool(new_tool, spindles);
         if (candidate) {
             if (candidate != spindle) {
                 if (spindle != nullptr) {
@@ -38,9 +44,45 @@ namespace Spindles {
                 spindle = spindles[0];
             }
         }
+        if (spindle->_prestarted) {
+            // Let a prestarted spindle finish the part of its spin-up that has
+            // not already passed while the previous tool was cutting.
+            spindle->_prestarted = false;
+            uint32_t spinup      = spindle->_spinup_ms * spindle->_current_speed / std::max(spindle->maxSpeed(), uint32_t(1));
+            uint32_t elapsed     = millis() - spindle->_prestart_ms;
+            if (elapsed < spinup) {
+                delay(spinup - elapsed);
+            }
+        }
         log_info("Using spindle " << spindle->name());
     }
 
+    void Spindle::prestartSpindle(uint32_t next_tool, SpindleList spindles, Spindle* spindle) {
+        Spindle* next = forTool(next_tool, spindles);
+        stopPrestarted(spindles, next);
+
+        if (!next || next == spindle || next->_prestarted || !next->_prestart_speed || next->isRateAdjusted()) {
+            return;
+        }
+        log_info("Prestarting spindle " << next->name() << " at " << next->_prestart_speed);
+
+        // mapSpeed() records the speed in sys.spindle_speed, which belongs to the spindle in use
+        SpindleSpeed active = sys.spindle_speed;
+        next->setState(SpindleState::Cw, next->_prestart_speed);
+        sys.spindle_speed  = active;
+        next->_prestarted  = true;
+        next->_prestart_ms = millis();
+    }
+
+    void Spindle::stopPrestarted(SpindleList spindles, Spindle* except) {
+        for (auto s : spindles) {
+            if (s->_prestarted && s != except) {
+                s->_prestarted = false;
+                s->stop();
+            }
+        }
+    }
+
     bool Spindle::isRateAdjusted() {
         return false;  // default for basic spindle is false
     }
@@ -77,6 +119,16 @@ namespace Spindles {
         _speeds[i].offset = offset;
         scaler            = 0;
         _speeds[i].scale  = scaler;
+
+        _devTable.clear();
+        SpindleSpeed max = maxSpeed();
+        if (isRateAdjusted() && max <= maxDevTableSpeed) {
+            std::vector<uint32_t> table(max + 1);
+            for (SpindleSpeed speed = 0; speed <= max; speed++) {
+                table[speed] = speedToDev(speed);
+            }
+            _devTable = std::move(table);
+        }
     }
 
     void Spindle::afterParse() {
@@ -117,6 +169,17 @@ namespace Spindles {
         }
         speed             = speed * sys.spindle_speed_ovr / 100;
         sys.spindle_speed = speed;
+        return speedToDev(speed);
+    }
+
+    // Like mapSpeed(), but without the override and without touching sys.spindle_speed
+    uint32_t IRAM_ATTR Spindle::speedToDev(SpindleSpeed speed) {
+        if (_speeds.size() == 0) {
+            return 0;
+        }
+        if (!_devTable.empty()) {
+            return _devTable[speed < _devTable.size() ? speed : _devTable.size() - 1];
+        }
         if (speed < _speeds[0].speed) {
             return _speeds[0].offset;
         }
@@ -205,10 +268,11 @@ namespace Spindles {
                         break;
                 }
         }
-        if (down) {
+        // A spindle that is not in use, as when it is prestarted, never holds up the G-code
+        if (down && this == spindle) {
             delay(down < maxSpeed() ? _spindown_ms * down / maxSpeed() : _spindown_ms);
         }
-        if (up) {
+        if (up && this == spindle) {
             delay(up < maxSpeed() ? _spinup_ms * up / maxSpeed() : _spinup_ms);
         }
         _current_state = state;
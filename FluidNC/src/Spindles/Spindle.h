@@ -33,11 +33,18 @@ namespace Spindles {
         uint32_t offSpeed() { return _speeds[0].offset; }
         uint32_t maxSpeed();
         uint32_t mapSpeed(SpindleSpeed speed);
+        uint32_t speedToDev(SpindleSpeed speed);
         void     setupSpeeds(uint32_t max_dev_speed);
         void     shelfSpeeds(SpindleSpeed min, SpindleSpeed max);
         void     linearSpeeds(SpindleSpeed maxSpeed, float maxPercent);
 
-        static void switchSpindle(uint32_t new_tool, SpindleList spindles, Spindle*& spindle);
+        static Spindle* forTool(uint32_t tool, SpindleList spindles);
+        static void     switchSpindle(uint32_t new_tool, SpindleList spindles, Spindle*& spindle);
+
+        // Starts the spindle for next_tool at its prestart_speed while the current
+        // one is still cutting, so that it is already turning at the tool change.
+        static void prestartSpindle(uint32_t next_tool, SpindleList spindles, Spindle* spindle);
+        static void stopPrestarted(SpindleList spindles, Spindle* except = nullptr);
 
         void         spindleDelay(SpindleState state, SpindleSpeed speed);
         virtual void init() = 0;  // not in constructor because this also gets called when $$ settings change
@@ -50,6 +57,27 @@ namespace Spindles {
         virtual bool isRateAdjusted();
         virtual bool use_delay_settings() const { return true; }
 
+        // The measured speed in RPM, or -1 if the spindle has no speed feedback
+        virtual int32_t actualSpeed() { return -1; }
+
+        // Returns at the start of the next revolution, or false if none began within
+        // timeout_ms or the spindle has no feedback
+        virtual bool waitIndex(uint32_t timeout_ms) { return false; }
+
+        // Rate-adjusted spindles can have their speed updated several times per step
+        // segment, at a time offset from the motion
+        virtual uint32_t powerUpdates() { return 1; }
+        virtual int32_t  powerLeadUsecs() { return 0; }
+
+        // Rate-adjusted spindles can instead take their speed from the rate that the steps
+        // actually run at, in the stepper ISR
+        virtual bool ratePower() { return false; }
+
+        // A change of speed can reach the spindle from the step segments, as they get to
+        // the blocks that carry it, so an S word need not wait for the planner to empty.
+        // Not when a spin-up or spin-down time has to be waited out.
+        virtual bool segmentSpeed() { return !_spinup_ms && !_spindown_ms; }
+
         virtual void setSpeedfromISR(uint32_t dev_speed) = 0;
 
         void spinDown() { setState(SpindleState::Disable, 0); }
@@ -67,8 +95,19 @@ namespace Spindles {
 
         std::vector<Configuration::speedEntry> _speeds;
 
+        // Rate-adjusted spindles with a small speed range have the device value for
+        // every integer speed precomputed, so a laser's per-segment power is one lookup.
+        static const SpindleSpeed maxDevTableSpeed = 1024;
+        std::vector<uint32_t>     _devTable;
+
         bool _off_on_alarm = true;
 
+        // Speed at which the spindle is started when its tool is selected with T
+        // ahead of the M6, or 0 to wait for the M6.  Never used for lasers.
+        SpindleSpeed _prestart_speed = 0;
+        bool         _prestarted     = false;
+        uint32_t     _prestart_ms    = 0;
+
         // Name is required for the configuration factory to work.
         virtual const char* name() const = 0;
 
@@ -87,6 +126,9 @@ namespace Spindles {
             handler.item("tool_num", _tool, 0, MaxToolNumber);
             handler.item("speed_map", _speeds);
             handler.item("off_on_alarm", _off_on_alarm);
+            if (!isRateAdjusted()) {
+                handler.item("prestart_speed", _prestart_speed);
+            }
         }
 
         // Virtual base classes require a virtual destructor.
@@ -26,228 +26,150 @@
 #include "src/Report.h"         // hex message
 #include "src/Configuration/HandlerType.h"
 
-#include <freertos/task.h>
 #include <freertos/queue.h>
-#include <atomic>
 
-const int        VFD_RS485_BUF_SIZE   = 127;
-const int        VFD_RS485_QUEUE_SIZE = 10;                                     // number of commands that can be queued up.
-const int        RESPONSE_WAIT_MS     = 1000;                                   // how long to wait for a response
-const int        VFD_RS485_POLL_RATE  = 250;                                    // in milliseconds between commands
-const TickType_t response_ticks       = RESPONSE_WAIT_MS / portTICK_PERIOD_MS;  // in milliseconds between commands
+const int VFD_RS485_QUEUE_SIZE = 10;  // number of commands that can be queued up.
 
 namespace Spindles {
-    QueueHandle_t VFD::vfd_cmd_queue     = nullptr;
-    TaskHandle_t  VFD::vfd_cmdTaskHandle = nullptr;
-
-    void VFD::reportParsingErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length) {
+    void VFD::reportParsingErrors(const ModbusCommand& cmd, const uint8_t* rx_message, size_t read_length) {
 #ifdef DEBUG_VFD
-        hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
-        hex_msg(rx_message, "RS485 Rx: ", read_length);
+        hex_msg(const_cast<uint8_t*>(cmd.msg), "RS485 Tx: ", cmd.tx_length);
+        hex_msg(const_cast<uint8_t*>(rx_message), "RS485 Rx: ", read_length);
 #endif
     }
-    void VFD::reportCmdErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length, uint8_t id) {
-#ifdef DEBUG_VFD
-        hex_msg(cmd.msg, "RS485 Tx: ", cmd.tx_length);
-        hex_msg(rx_message, "RS485 Rx: ", read_length);
-
-        if (read_length != 0) {
-            if (rx_message[0] != id) {
-                log_info("RS485 received message from other modbus device");
-            } else if (read_length != cmd.rx_length) {
-                log_info("RS485 received message of unexpected length; expected:" << int(cmd.rx_length) << " got:" << int(read_length));
-            } else {
-                log_info("RS485 CRC check failed");
+
+    // ================== Bus task callbacks =============================
+
+    // Takes commands off the queue until one needs sending
+    bool VFD::take_queued(ModbusCommand& cmd) {
+        VFDaction action;
+        while (xQueueReceive(_cmd_queue, &action, 0)) {
+            _parser = nullptr;
+            switch (action.action) {
+                case actionSetSpeed:
+                    // prepareSetSpeedCommand() can return false if the speed
+                    // change is unnecessary - already at that speed.
+                    // In that case we just discard the command.
+                    if (!prepareSetSpeedCommand(action.arg, cmd)) {
+                        continue;
+                    }
+                    break;
+                case actionSetMode:
+                    log_debug("vfd_cmd_task mode:" << action.action);
+                    if (!prepareSetModeCommand(SpindleState(action.arg), cmd)) {
+                        continue;
+                    }
+                    break;
             }
-        } else {
-            log_info("RS485 No response");
+            cmd.critical = action.critical;
+            return true;
         }
-#endif
+        return false;
     }
 
-    // The communications task
-    void VFD::vfd_cmd_task(void* pvParameters) {
-        static bool unresponsive = false;  // to pop off a message once each time it becomes unresponsive
-        static int  pollidx      = -1;
-
-        VFD*          instance = static_cast<VFD*>(pvParameters);
-        auto&         uart     = *instance->_uart;
-        ModbusCommand next_cmd;
-        uint8_t       rx_message[VFD_RS485_MAX_MSG_SIZE];
-        bool          safetyPollingEnabled = instance->safety_polling();
+    bool VFD::queued_command(ModbusCommand& cmd, bool criticalOnly) {
+        // The initialization sequence goes first, so it is not jumped by queued commands
+        VFDaction action;
+        if (_pollidx < 0 || !_cmd_queue || !xQueuePeek(_cmd_queue, &action, 0) || (criticalOnly && !action.critical)) {
+            return false;
+        }
+        return take_queued(cmd);
+    }
 
-        for (; true; delay_ms(VFD_RS485_POLL_RATE)) {
-            std::atomic_thread_fence(std::memory_order::memory_order_seq_cst);  // read fence for settings
-            response_parser parser = nullptr;
+    bool VFD::next_command(ModbusCommand& cmd) {
+        if (!_cmd_queue) {
+            return false;
+        }
 
-            // First check if we should ask the VFD for the speed parameters as part of the initialization.
-            if (pollidx < 0 && (parser = instance->initialization_sequence(pollidx, next_cmd)) != nullptr) {
-            } else {
-                pollidx = 1;  // Done with initialization. Main sequence.
+        // First check if we should ask the VFD for the speed parameters as part of the initialization.
+        if (_pollidx < 0) {
+            if ((_parser = initialization_sequence(_pollidx, cmd)) != nullptr) {
+                return true;
             }
-            next_cmd.critical = false;
+            _pollidx = 1;  // Done with initialization. Main sequence.
+        }
 
-            VFDaction action;
-            if (parser == nullptr) {
-                // If we don't have a parser, the queue goes first.
-                if (xQueueReceive(vfd_cmd_queue, &action, 0)) {
-                    switch (action.action) {
-                        case actionSetSpeed:
-                            if (!instance->prepareSetSpeedCommand(action.arg, next_cmd)) {
-                                // prepareSetSpeedCommand() can return false if the speed
-                                // change is unnecessary - already at that speed.
-                                // In that case we just discard the command.
-                                continue;  // main loop
-                            }
-                            next_cmd.critical = action.critical;
-                            break;
-                        case actionSetMode:
-                            log_debug("vfd_cmd_task mode:" << action.action);
-                            if (!instance->prepareSetModeCommand(SpindleState(action.arg), next_cmd)) {
-                                continue;  // main loop
-                            }
-                            next_cmd.critical = action.critical;
-                            break;
+        // Commands queued during initialization go before polling
+        if (take_queued(cmd)) {
+            return true;
+        }
+
+        // There is nothing in the queue, so we cycle through the set of periodic queries.
+
+        // We poll in a cycle. Note that the switch will fall through unless we encounter a hit.
+        // The weakest form here is 'get_status_ok' which should be implemented if the rest fails.
+        _parser = nullptr;
+        if (_syncing) {
+            _parser = get_current_speed(cmd);
+        } else if (safety_polling()) {
+            switch (_pollidx) {
+                case 1:
+                    _parser = get_current_state(cmd);
+                    if (_parser) {
+                        _pollidx = 3;
+                        break;
                     }
-                } else {
-                    // We do not have a parser and there is nothing in the queue, so we cycle
-                    // through the set of periodic queries.
-
-                    // We poll in a cycle. Note that the switch will fall through unless we encounter a hit.
-                    // The weakest form here is 'get_status_ok' which should be implemented if the rest fails.
-                    if (instance->_syncing) {
-                        parser = instance->get_current_speed(next_cmd);
-                    } else if (safetyPollingEnabled) {
-                        switch (pollidx) {
-                            case 1:
-                                parser = instance->get_current_speed(next_cmd);
-                                if (parser) {
-                                    pollidx = 2;
-                                    break;
-                                }
-                                // fall through if get_current_speed did not return a parser
-                            case 2:
-                                parser = instance->get_current_direction(next_cmd);
-                                if (parser) {
-                                    pollidx = 3;
-                                    break;
-                                }
-                                // fall through if get_current_direction did not return a parser
-                            case 3:
-                            default:
-                                parser  = instance->get_status_ok(next_cmd);
-                                pollidx = 1;
-
-                                // we could complete this in case parser == nullptr with some ifs, but let's
-                                // just keep it easy and wait an iteration.
-                                break;
-                        }
+                    _parser = get_current_speed(cmd);
+                    if (_parser) {
+                        _pollidx = 2;
+                        break;
                     }
-
-                    // If we have no parser, that means get_status_ok is not implemented (and we have
-                    // nothing resting in our queue). Let's fall back on a simple continue.
-                    if (parser == nullptr) {
-                        continue;  // main loop
+                    // fall through if get_current_speed did not return a parser
+                case 2:
+                    _parser = get_current_direction(cmd);
+                    if (_parser) {
+                        _pollidx = 3;
+                        break;
                     }
-                }
+                    // fall through if get_current_direction did not return a parser
+                case 3:
+                default:
+                    _parser  = get_status_ok(cmd);
+                    _pollidx = 1;
+
+                    // we could complete this in case _parser == nullptr with some ifs, but let's
+                    // just keep it easy and wait an iteration.
+                    break;
             }
+        }
 
-            // At this point next_cmd has been filled with a command block
-            {
-                // Fill in the fields that are the same for all protocol variants
-                next_cmd.msg[0] = instance->_modbus_id;
-
-                // Grabbed the command. Add the CRC16 checksum:
-                auto crc16                         = ModRTU_CRC(next_cmd.msg, next_cmd.tx_length);
-                next_cmd.msg[next_cmd.tx_length++] = (crc16 & 0xFF);
-                next_cmd.msg[next_cmd.tx_length++] = (crc16 & 0xFF00) >> 8;
-                next_cmd.rx_length += 2;
+        // If we have no parser, that means get_status_ok is not implemented (and we have
+        // nothing resting in our queue), so there is nothing to send this time round.
+        return _parser != nullptr;
+    }
 
-#ifdef DEBUG_VFD_ALL
-                if (parser == nullptr) {
-                    hex_msg(next_cmd.msg, "RS485 Tx: ", next_cmd.tx_length);
-                }
-#endif
+    void VFD::handle_response(const ModbusCommand& cmd, const uint8_t* response, bool ok) {
+        if (!ok) {
+            if (!_unresponsive) {
+                log_info("VFD RS485 Unresponsive");
+                _unresponsive = true;
+                _pollidx      = -1;
             }
-
-            // Assume for the worst, and retry...
-            int retry_count = 0;
-            for (; retry_count < MAX_RETRIES; ++retry_count) {
-                // Flush the UART and write the data:
-                uart.flush();
-                uart.write(next_cmd.msg, next_cmd.tx_length);
-                uart.flushTxTimed(response_ticks);
-
-                // Read the response
-                size_t read_length  = 0;
-                size_t current_read = uart.timedReadBytes(rx_message, next_cmd.rx_length, response_ticks);
-                read_length += current_read;
-
-                // Apparently some Huanyang report modbus errors in the correct way, and the rest not. Sigh.
-                // Let's just check for the condition, and truncate the first byte.
-                if (read_length > 0 && instance->_modbus_id != 0 && rx_message[0] == 0) {
-                    memmove(rx_message + 1, rx_message, read_length - 1);
-                }
-
-                while (read_length < next_cmd.rx_length && current_read > 0) {
-                    // Try to read more; we're not there yet...
-                    current_read = uart.timedReadBytes(rx_message + read_length, next_cmd.rx_length - read_length, response_ticks);
-                    read_length += current_read;
-                }
-
-                // Generate crc16 for the response:
-                auto crc16response = ModRTU_CRC(rx_message, next_cmd.rx_length - 2);
-
-                if (read_length == next_cmd.rx_length &&                             // check expected length
-                    rx_message[0] == instance->_modbus_id &&                         // check address
-                    rx_message[read_length - 1] == (crc16response & 0xFF00) >> 8 &&  // check CRC byte 1
-                    rx_message[read_length - 2] == (crc16response & 0xFF)) {         // check CRC byte 1
-
-                    // Success
-                    unresponsive = false;
-                    retry_count  = MAX_RETRIES + 1;  // stop retry'ing
-
-                    // Should we parse this?
-                    if (parser != nullptr) {
-                        if (parser(rx_message, instance)) {
-                            // If we're initializing, move to the next initialization command:
-                            if (pollidx < 0) {
-                                --pollidx;
-                            }
-                        } else {
-                            // Parsing failed
-                            reportParsingErrors(next_cmd, rx_message, read_length);
-
-                            // If we were initializing, move back to where we started.
-                            unresponsive = true;
-                            pollidx      = -1;  // Re-initializing the VFD seems like a plan
-                            log_info("Spindle RS485 did not give a satisfying response");
-                        }
-                    }
-                } else {
-                    reportCmdErrors(next_cmd, rx_message, read_length, instance->_modbus_id);
-
-                    // Wait a bit before we retry. Set the delay to poll-rate. Not sure
-                    // if we should use a different value...
-                    delay_ms(VFD_RS485_POLL_RATE);
-
-#ifdef DEBUG_TASK_STACK
-                    static UBaseType_t uxHighWaterMark = 0;
-                    reportTaskStackSize(uxHighWaterMark);
-#endif
-                }
+            if (cmd.critical) {
+                mc_critical(ExecAlarm::SpindleControl);
+                log_error("Critical VFD RS485 Unresponsive");
             }
+            return;
+        }
 
-            if (retry_count == MAX_RETRIES) {
-                if (!unresponsive) {
-                    log_info("VFD RS485 Unresponsive");
-                    unresponsive = true;
-                    pollidx      = -1;
-                }
-                if (next_cmd.critical) {
-                    mc_critical(ExecAlarm::SpindleControl);
-                    log_error("Critical VFD RS485 Unresponsive");
+        _unresponsive = false;
+
+        // Should we parse this?
+        if (_parser != nullptr) {
+            if (_parser(response, this)) {
+                // If we're initializing, move to the next initialization command:
+                if (_pollidx < 0) {
+                    --_pollidx;
                 }
+            } else {
+                // Parsing failed
+                ++ModbusBus::commsErrors;
+                reportParsingErrors(cmd, response, cmd.rx_length);
+
+                // If we were initializing, move back to where we started.
+                _unresponsive = true;
+                _pollidx      = -1;  // Re-initializing the VFD seems like a plan
+                log_info("Spindle RS485 did not give a satisfying response");
             }
         }
     }
@@ -270,8 +192,9 @@ namespace Spindles {
             }
         }
 
-        if (_uart->setHalfDuplex()) {
-            log_info("VFD: RS485 UART set half duplex failed");
+        // VFDs and other Modbus devices that use the same UART share one bus
+        _bus = ModbusBus::get(_uart);
+        if (!_bus) {
             return;
         }
 
@@ -282,17 +205,18 @@ namespace Spindles {
 
         _current_state = SpindleState::Disable;
 
-        // Initialization is complete, so now it's okay to run the queue task:
-        if (!vfd_cmd_queue) {  // init can happen many times, we only want to start one task
-            vfd_cmd_queue = xQueueCreate(VFD_RS485_QUEUE_SIZE, sizeof(VFDaction));
-            xTaskCreatePinnedToCore(vfd_cmd_task,         // task
-                                    "vfd_cmdTaskHandle",  // name for task
-                                    2048,                 // size of task stack
-                                    this,                 // parameters
-                                    1,                    // priority
-                                    &vfd_cmdTaskHandle,
-                                    SUPPORT_TASK_CORE  // core
-            );
+        if (_learn_ramp) {
+            ModbusCommand probe;
+            if (get_current_speed(probe) == nullptr) {
+                log_warn(name() << " cannot learn its ramp without speed feedback; using spinup_ms and spindown_ms");
+                _learn_ramp = false;
+            }
+        }
+
+        // Initialization is complete, so now it's okay for the bus to poll us:
+        if (!_cmd_queue) {  // init can happen many times, we only want to join the bus once
+            _cmd_queue = xQueueCreate(VFD_RS485_QUEUE_SIZE, sizeof(VFDaction));
+            _bus->add(this);
         }
 
         config_message();
@@ -325,56 +249,85 @@ namespace Spindles {
                 setSpeed(dev_speed);
             }
         }
-        if (use_delay_settings()) {
+        if (use_delay_settings() && !_learn_ramp) {
             spindleDelay(state, speed);
         } else {
-            // _sync_dev_speed is set by a callback that handles
-            // responses from periodic get_current_speed() requests.
-            // It changes as the actual speed ramps toward the target.
+            syncSpeed(state == SpindleState::Disable ? 0 : dev_speed);
 
-            _syncing = true;  // poll for speed
+            // spindleDelay() sets these when it is used
+            _current_state = state;
+            _current_speed = speed;
+        }
+    }
+
+    // Waits for the speed that the VFD reports to reach dev_speed
+    void VFD::syncSpeed(uint32_t dev_speed) {
+        uint32_t  from  = _ramp_from;
+        bool      up    = dev_speed > from;
+        uint32_t  delta = up ? dev_speed - from : from - dev_speed;
+        uint32_t& rate  = up ? _ramp_up_ms_per_k : _ramp_down_ms_per_k;
+        _ramp_from      = dev_speed;
+
+        if (this != spindle) {
+            return;  // A prestarted spindle is brought up to speed when it comes into use
+        }
+
+        TickType_t start = xTaskGetTickCount();
+        if (_learn_ramp && rate) {
+            // Sit out most of the ramp that the learned profile predicts without
+            // polling, and let the speed feedback finish it off
+            delay_ms(delta * rate / 1000 * 3 / 4);
+        }
 
-            auto minSpeedAllowed = dev_speed > _slop ? (dev_speed - _slop) : 0;
-            auto maxSpeedAllowed = dev_speed + _slop;
+        // _sync_dev_speed is set by a callback that handles
+        // responses from periodic get_current_speed() requests.
+        // It changes as the actual speed ramps toward the target.
 
-            int       unchanged = 0;
-            const int limit     = 20;  // 20 * 0.5s = 10 sec
-            auto      last      = _sync_dev_speed;
+        _syncing = true;  // poll for speed
 
-            while ((_last_override_value == sys.spindle_speed_ovr) &&  // skip if the override changes
-                   ((_sync_dev_speed < minSpeedAllowed || _sync_dev_speed > maxSpeedAllowed) && unchanged < limit)) {
+        auto minSpeedAllowed = dev_speed > _slop ? (dev_speed - _slop) : 0;
+        auto maxSpeedAllowed = dev_speed + _slop;
+
+        int       unchanged = 0;
+        const int limit     = 10000 / syncPollMs;  // 10 sec
+        auto      last      = _sync_dev_speed;
+
+        while ((_last_override_value == sys.spindle_speed_ovr) &&  // skip if the override changes
+               ((_sync_dev_speed < minSpeedAllowed || _sync_dev_speed > maxSpeedAllowed) && unchanged < limit)) {
 #ifdef DEBUG_VFD
-                log_debug("Syncing speed. Requested: " << int(dev_speed) << " current:" << int(_sync_dev_speed));
+            log_debug("Syncing speed. Requested: " << int(dev_speed) << " current:" << int(_sync_dev_speed));
 #endif
-                // if (!mc_dwell(500)) {
-                //     // Something happened while we were dwelling, like a safety door.
-                //     unchanged = limit;
-                //     last      = _sync_dev_speed;
-                //     break;
-                // }
-                delay_ms(500);
-
-                // unchanged counts the number of consecutive times that we see the same speed
-                unchanged = (_sync_dev_speed == last) ? unchanged + 1 : 0;
-                last      = _sync_dev_speed;
-            }
-            _last_override_value = sys.spindle_speed_ovr;
+            // if (!mc_dwell(500)) {
+            //     // Something happened while we were dwelling, like a safety door.
+            //     unchanged = limit;
+            //     last      = _sync_dev_speed;
+            //     break;
+            // }
+            delay_ms(syncPollMs);
+
+            // unchanged counts the number of consecutive times that we see the same speed
+            unchanged = (_sync_dev_speed == last) ? unchanged + 1 : 0;
+            last      = _sync_dev_speed;
+        }
+        _last_override_value = sys.spindle_speed_ovr;
 
 #ifdef DEBUG_VFD
-            log_debug("Synced speed. Requested:" << int(dev_speed) << " current:" << int(_sync_dev_speed));
+        log_debug("Synced speed. Requested:" << int(dev_speed) << " current:" << int(_sync_dev_speed));
 #endif
 
-            if (unchanged == limit) {
-                mc_critical(ExecAlarm::SpindleControl);
-                log_error(name() << " spindle did not reach device units " << dev_speed << ". Reported value is " << _sync_dev_speed);
-            }
-
-            _syncing = false;
-            // spindleDelay() sets these when it is used
-            _current_state = state;
-            _current_speed = speed;
+        if (unchanged == limit) {
+            mc_critical(ExecAlarm::SpindleControl);
+            log_error(name() << " spindle did not reach device units " << dev_speed << ". Reported value is " << _sync_dev_speed);
+        } else if (_learn_ramp && delta > _slop) {
+            // Fold this ramp into the profile, weighting the history 3:1 so that one
+            // slow or quick ramp does not swing it too far
+            uint32_t ms       = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+            uint32_t measured = ms * 1000 / delta;
+            rate              = rate ? (rate * 3 + measured) / 4 : measured;
+            log_debug(name() << " ramp " << (up ? "up " : "down ") << delta << " units in " << ms << "ms, profile " << rate << "ms/1000");
         }
-        //        }
+
+        _syncing = false;
     }
 
     bool VFD::prepareSetModeCommand(SpindleState mode, ModbusCommand& data) {
@@ -382,7 +335,7 @@ namespace Spindles {
         direction_command(mode, data);
 
         if (mode == SpindleState::Disable) {
-            if (!xQueueReset(vfd_cmd_queue)) {
+            if (!xQueueReset(_cmd_queue)) {
                 log_info(name() << " spindle off, queue could not be reset");
             }
         }
@@ -393,14 +346,15 @@ namespace Spindles {
 
     void VFD::set_mode(SpindleState mode, bool critical) {
         _last_override_value = sys.spindle_speed_ovr;  // sync these on mode changes
-        if (vfd_cmd_queue) {
+        if (_cmd_queue) {
             VFDaction action;
             action.action   = actionSetMode;
             action.arg      = uint32_t(mode);
             action.critical = critical;
-            if (xQueueSend(vfd_cmd_queue, &action, 0) != pdTRUE) {
+            if (xQueueSend(_cmd_queue, &action, 0) != pdTRUE) {
                 log_info("VFD Queue Full");
             }
+            _bus->wake();
         }
     }
 
@@ -411,26 +365,28 @@ namespace Spindles {
 
         _last_speed = dev_speed;
 
-        if (vfd_cmd_queue) {
+        if (_cmd_queue) {
             VFDaction action;
             action.action   = actionSetSpeed;
             action.arg      = dev_speed;
             action.critical = (dev_speed == 0);
             // Ignore errors because reporting is not safe from an ISR.
             // Perhaps set a flag instead?
-            xQueueSendFromISR(vfd_cmd_queue, &action, 0);
+            xQueueSendFromISR(_cmd_queue, &action, 0);
+            _bus->wakeFromISR();
         }
     }
 
     void VFD::setSpeed(uint32_t dev_speed) {
-        if (vfd_cmd_queue) {
+        if (_cmd_queue) {
             VFDaction action;
             action.action   = actionSetSpeed;
             action.arg      = dev_speed;
             action.critical = dev_speed == 0;
-            if (xQueueSend(vfd_cmd_queue, &action, 0) != pdTRUE) {
+            if (xQueueSend(_cmd_queue, &action, 0) != pdTRUE) {
                 log_info("VFD Queue Full");
             }
+            _bus->wake();
         }
     }
 
@@ -454,27 +410,6 @@ namespace Spindles {
         return true;
     }
 
-    // Calculate the CRC on all of the byte except the last 2
-    // It then added the CRC to those last 2 bytes
-    // full_msg_len This is the length of the message including the 2 crc bytes
-    // Source: https://ctlsys.com/support/how_to_compute_the_modbus_rtu_message_crc/
-    uint16_t VFD::ModRTU_CRC(uint8_t* buf, int msg_len) {
-        uint16_t crc = 0xFFFF;
-        for (int pos = 0; pos < msg_len; pos++) {
-            crc ^= uint16_t(buf[pos]);  // XOR byte into least sig. byte of crc.
-
-            for (int i = 8; i != 0; i--) {  // Loop over each bit
-                if ((crc & 0x0001) != 0) {  // If the LSB is set
-                    crc >>= 1;              // Shift right and XOR 0xA001
-                    crc ^= 0xA001;
-                } else {        // Else LSB is not set
-                    crc >>= 1;  // Just shift right
-                }
-            }
-        }
-
-        return crc;
-    }
     void VFD::validate() {
         Spindle::validate();
         Assert(_uart != nullptr || _uart_num != -1, "VFD: missing UART configuration");
@@ -492,6 +427,9 @@ namespace Spindles {
             handler.item("uart_num", _uart_num);
         }
         handler.item("modbus_id", _modbus_id, 0, 247);  // per https://modbus.org/docs/PI_MBUS_300.pdf
+        if (use_delay_settings()) {
+            handler.item("learn_ramp", _learn_ramp);
+        }
 
         Spindle::group(handler);
     }
@@ -8,17 +8,18 @@
 #include "../Types.h"
 
 #include "../Uart.h"
+#include "../Modbus.h"
+
+#include <freertos/queue.h>
 
 // #define DEBUG_VFD
-// #define DEBUG_VFD_ALL
 
 namespace Spindles {
     extern Uart _uart;
 
-    class VFD : public Spindle {
+    class VFD : public Spindle, public ModbusClient {
     private:
-        static const int VFD_RS485_MAX_MSG_SIZE = 16;  // more than enough for a modbus message
-        static const int MAX_RETRIES            = 5;   // otherwise the spindle is marked 'unresponsive'
+        static const int syncPollMs = 50;  // Speed polling while waiting for the spindle to reach speed
 
         void set_mode(SpindleState mode, bool critical);
 
@@ -26,35 +27,28 @@ namespace Spindles {
         uint32_t _last_speed          = 0;
         Percent  _last_override_value = 100;  // no override is 100 percent
 
-        static QueueHandle_t vfd_cmd_queue;
-        static TaskHandle_t  vfd_cmdTaskHandle;
-        static void          vfd_cmd_task(void* pvParameters);
-
-        static uint16_t ModRTU_CRC(uint8_t* buf, int msg_len);
         enum VFDactionType : uint8_t { actionSetSpeed, actionSetMode };
         struct VFDaction {
             VFDactionType action;
             bool          critical;
             uint32_t      arg;
         };
+        QueueHandle_t _cmd_queue = nullptr;
 
-    protected:
-        struct ModbusCommand {
-            bool critical;  // TODO SdB: change into `uint8_t critical : 1;`: We want more flags...
+        bool take_queued(ModbusCommand& cmd);
 
-            uint8_t tx_length;
-            uint8_t rx_length;
-            uint8_t msg[VFD_RS485_MAX_MSG_SIZE];
-        };
-
-    private:
         bool prepareSetModeCommand(SpindleState mode, ModbusCommand& data);
         bool prepareSetSpeedCommand(uint32_t speed, ModbusCommand& data);
 
-        static void reportParsingErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length);
-        static void reportCmdErrors(ModbusCommand cmd, uint8_t* rx_message, size_t read_length, uint8_t id);
+        static void reportParsingErrors(const ModbusCommand& cmd, const uint8_t* rx_message, size_t read_length);
 
     protected:
+        // ModbusClient
+        bool queued_command(ModbusCommand& cmd, bool criticalOnly) override;
+        bool next_command(ModbusCommand& cmd) override;
+        int  poll_ms() override { return _syncing ? syncPollMs : defaultPollMs; }
+        void handle_response(const ModbusCommand& cmd, const uint8_t* response, bool ok) override;
+
         // Commands:
         virtual void direction_command(SpindleState mode, ModbusCommand& data) = 0;
         virtual void set_speed_command(uint32_t rpm, ModbusCommand& data)      = 0;
@@ -65,14 +59,38 @@ namespace Spindles {
         virtual response_parser initialization_sequence(int index, ModbusCommand& data) { return nullptr; }
         virtual response_parser get_current_speed(ModbusCommand& data) { return nullptr; }
         virtual response_parser get_current_direction(ModbusCommand& data) { return nullptr; }
+
+        // Drives whose register map allows it can read the speed and the direction in one
+        // function 03 transaction.  When this returns a parser, routine polling uses it in
+        // place of get_current_speed() and get_current_direction().
+        virtual response_parser get_current_state(ModbusCommand& data) { return nullptr; }
         virtual response_parser get_status_ok(ModbusCommand& data) = 0;
         virtual bool            safety_polling() const { return true; }
         bool                    use_delay_settings() const override { return true; }
+        bool                    segmentSpeed() override { return !_learn_ramp && Spindle::segmentSpeed(); }
+
+    private:
+        // State of the exchange with the bus task
+        ModbusBus*      _bus          = nullptr;
+        response_parser _parser       = nullptr;  // For the response to the command in flight
+        int             _pollidx      = -1;       // Negative while initializing
+        bool            _unresponsive = false;    // To pop off a message once each time it becomes unresponsive
+
+        // Learned ramp profile in ms per 1000 device speed units, zero until measured
+        uint32_t _ramp_up_ms_per_k   = 0;
+        uint32_t _ramp_down_ms_per_k = 0;
+        uint32_t _ramp_from          = 0;  // Device speed of the last ramp's target
 
+        void syncSpeed(uint32_t dev_speed);
+
+    protected:
         // The constructor sets these
-        int     _uart_num  = -1;
-        Uart*   _uart      = nullptr;
-        uint8_t _modbus_id = 1;
+        int   _uart_num = -1;
+        Uart* _uart     = nullptr;
+
+        // Instead of waiting spinup_ms or spindown_ms, wait for the speed feedback
+        // and learn how long each ramp takes
+        bool _learn_ramp = false;
 
         void setSpeed(uint32_t dev_speed);
 
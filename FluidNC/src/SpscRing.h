@@ -0,0 +1,74 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  SpscRing.h - lock-free single-producer single-consumer ring buffer
+
+  The producer fills the slot at the head in place and then publishes it with push().
+  The consumer works on the slot at the tail in place and then frees it with pop().
+  Publishing uses release ordering and observing uses acquire ordering, so the slot
+  contents are visible to the other side before the index that hands it over, even when
+  producer and consumer run on different cores or one of them is an ISR.
+
+  One slot is always left unused to tell a full ring from an empty one, so a ring with
+  capacity N holds at most N-1 items.  The storage is supplied by the owner, so it can be
+  placed in whichever memory suits it.
+*/
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class SpscRing {
+    T*                    _items    = nullptr;
+    uint32_t              _capacity = 0;
+    std::atomic<uint32_t> _head { 0 };  // Next slot to be filled. Written only by the producer.
+    std::atomic<uint32_t> _tail { 0 };  // Slot being consumed. Written only by the consumer.
+
+public:
+    void init(T* items, uint32_t capacity) {
+        _items    = items;
+        _capacity = capacity;
+        reset();
+    }
+
+    // Empties the ring.  Neither side may be using it at the time.
+    void reset() {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_release);
+    }
+
+    uint32_t capacity() const { return _capacity; }
+
+    // Index arithmetic with wrap-around
+    inline uint32_t IRAM_ATTR next(uint32_t index) const { return ++index == _capacity ? 0 : index; }
+    inline uint32_t prev(uint32_t index) const { return (index == 0 ? _capacity : index) - 1; }
+
+    inline T& IRAM_ATTR operator[](uint32_t index) { return _items[index]; }
+
+    inline uint32_t IRAM_ATTR head() const { return _head.load(std::memory_order_acquire); }
+    inline uint32_t IRAM_ATTR tail() const { return _tail.load(std::memory_order_acquire); }
+
+    inline bool IRAM_ATTR empty() const { return head() == tail(); }
+    inline bool full() const { return next(head()) == tail(); }
+
+    // Number of items waiting to be popped
+    inline uint32_t IRAM_ATTR size() const { return (_capacity - 1) - available(); }
+
+    // Number of items that can still be pushed
+    inline uint32_t IRAM_ATTR available() const {
+        uint32_t h = head();
+        uint32_t t = tail();
+        return h >= t ? (_capacity - 1) - (h - t) : t - h - 1;
+    }
+
+    // Producer side: the slot to fill, and publishing it once filled
+    inline T*   back() { return &_items[_head.load(std::memory_order_relaxed)]; }
+    inline void push() { _head.store(next(_head.load(std::memory_order_relaxed)), std::memory_order_release); }
+
+    // Consumer side: the oldest item, and freeing its slot once done with it
+    inline T* IRAM_ATTR front() { return &_items[_tail.load(std::memory_order_relaxed)]; }
+    inline void IRAM_ATTR pop() { _tail.store(next(_tail.load(std::memory_order_relaxed)), std::memory_order_release); }
+};
@@ -16,6 +16,13 @@ public:
 
     static void init();
     static void dump(Channel& channel);
+
+    // Boot profiling: stage() notes how long the stage that ends now took, counting from
+    // the end of the previous one, or takes the time of a stage that ran alongside the
+    // others.  showStages() logs them all on one line.
+    static void stage(const char* name);
+    static void stage(const char* name, uint32_t ms);
+    static void showStages();
 };
 
 extern StartupLog startupLog;
@@ -8,6 +8,8 @@
 */
 #include "Status_outputs.h"
 #include "Machine/MachineConfig.h"
+#include "Report.h"    // state_name
+#include "Protocol.h"  // protocol_add_state_hook
 
 void Status_Outputs::init() {
     if (_Idle_pin.defined()) {
@@ -27,51 +29,21 @@ void Status_Outputs::init() {
     }
 
     log_info("Status outputs"
-             << " Interval:" << _report_interval_ms << " Idle:" << _Idle_pin.name() << " Cycle:" << _Run_pin.name()
-             << " Hold:" << _Hold_pin.name() << " Alarm:" << _Alarm_pin.name());
+             << " Idle:" << _Idle_pin.name() << " Cycle:" << _Run_pin.name() << " Hold:" << _Hold_pin.name()
+             << " Alarm:" << _Alarm_pin.name());
 
-    allChannels.registration(this);
-    setReportInterval(_report_interval_ms);
+    protocol_add_state_hook(onStateChange, this);
 }
 
-void Status_Outputs::parse_report() {
-    if (_report.rfind("<", 0) == 0) {
-        parse_status_report();
-        return;
-    }
-}
-
-// This is how the OLED driver receives channel data
-size_t Status_Outputs::write(uint8_t data) {
-    char c = data;
-    if (c == '\r') {
-        return 1;
-    }
-    if (c == '\n') {
-        parse_report();
-        _report = "";
-        return 1;
-    }
-    _report += c;
-    return 1;
+void Status_Outputs::onStateChange(void* arg) {
+    static_cast<Status_Outputs*>(arg)->update();
 }
 
-Channel* Status_Outputs::pollLine(char* line) {
-    autoReport();
-    return nullptr;
-}
-
-void Status_Outputs::parse_status_report() {
-    if (_report.back() == '>') {
-        _report.pop_back();
-    }
-    // Now the string is a sequence of field|field|field
-    size_t pos     = 0;
-    auto   nextpos = _report.find_first_of("|", pos);
-    _state         = _report.substr(pos + 1, nextpos - pos - 1);
-
-    _Idle_pin.write(_state == "Idle");
-    _Run_pin.write(_state == "Run");
-    _Hold_pin.write(_state.substr(0, 4) == "Hold");
-    _Alarm_pin.write(_state == "Alarm");
+void Status_Outputs::update() {
+    // The pins follow the state names that status reports show
+    const char* state = state_name();
+    _Idle_pin.write(strcmp(state, "Idle") == 0);
+    _Run_pin.write(strcmp(state, "Run") == 0);
+    _Hold_pin.write(strncmp(state, "Hold", 4) == 0);
+    _Alarm_pin.write(strcmp(state, "Alarm") == 0);
 }
@@ -2,28 +2,26 @@
 
 #include "Config.h"
 #include "Configuration/Configurable.h"
-#include "Channel.h"
 
 typedef const uint8_t* font_t;
 
-class Status_Outputs : public Channel, public Configuration::Configurable {
+class Status_Outputs : public Configuration::Configurable {
     Pin _Idle_pin;
     Pin _Run_pin;
     Pin _Hold_pin;
     Pin _Alarm_pin;
 
-public:
-private:
-    std::string _report;
-    std::string _state;
-
+    // The pins now follow state changes as they happen; the interval is still
+    // accepted so that existing config files load, but it is no longer used.
     int _report_interval_ms = 500;
 
-    void parse_report();
-    void parse_status_report();
+    // Called from the main task whenever sys.state or sys.suspend changes
+    static void onStateChange(void* arg);
+
+    void update();
 
 public:
-    Status_Outputs() : Channel("status_outputs") {}
+    Status_Outputs() = default;
 
     Status_Outputs(const Status_Outputs&) = delete;
     Status_Outputs(Status_Outputs&&)      = delete;
@@ -34,14 +32,6 @@ public:
 
     void init();
 
-    size_t write(uint8_t data) override;
-
-    Channel* pollLine(char* line) override;
-    void     flushRx() override {}
-
-    bool   lineComplete(char*, char) override { return false; }
-    size_t timedReadBytes(char* buffer, size_t length, TickType_t timeout) override { return 0; }
-
     // Configuration handlers:
     void validate() override {}
     void afterParse() override {};
@@ -0,0 +1,175 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "StepCheck.h"
+
+#include "Machine/MachineConfig.h"  // config
+#include "Motors/MotorDriver.h"
+#include "MotionControl.h"          // mc_critical
+#include "Protocol.h"               // protocol_send_event_from_ISR
+#include "System.h"                 // sys
+#include "Driver/PulseCounter.h"
+
+namespace StepCheck {
+    bool enabled = false;
+
+    static const int MAX_MOTORS = Machine::Axis::MAX_MOTORS_PER_AXIS;
+
+    struct Counter {
+        int             unit  = -1;       // PCNT unit, -1 if the motor is not checked
+        Machine::Motor* motor = nullptr;  // For its _blocked and _limited flags
+        uint32_t        last;             // Raw count at the last sample
+        uint32_t        pulses;           // Pulses counted in hardware
+        int32_t         lost;             // Total of the differences found, written only by the ISR
+        int32_t         reported;         // The part of lost that has been reported
+        bool            excused;          // Steps were held back from the motor since the last comparison
+    };
+
+    static Counter  counters[MAX_N_AXIS][MAX_MOTORS];
+    static uint32_t issued[MAX_N_AXIS];  // Steps issued by the step ISR
+
+    static volatile bool pending   = false;
+    static volatile bool reporting = false;
+
+    static void report() {
+        reporting = false;
+
+        auto axes  = config->_axes;
+        bool found = false;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            for (size_t motor = 0; motor < MAX_MOTORS; motor++) {
+                auto&   c    = counters[axis][motor];
+                int32_t diff = c.lost - c.reported;
+                if (diff) {
+                    c.reported += diff;
+                    log_error("Step check: " << axes->axisName(axis) << " motor" << motor << " had " << (diff < 0 ? -diff : diff)
+                                             << (diff < 0 ? " fewer" : " more") << " pulses than steps");
+                    found = true;
+                }
+            }
+        }
+        if (found && config->_stepping->_stepCheck == Machine::Stepping::CHECK_ALARM) {
+            mc_critical(ExecAlarm::StepLoss);
+        }
+    }
+
+    static NoArgEvent stepCheckEvent { report };
+
+    void init() {
+        enabled = false;
+        if (config->_stepping->_stepCheck == Machine::Stepping::CHECK_OFF) {
+            return;
+        }
+
+        auto axes = config->_axes;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            for (size_t motor = 0; motor < MAX_MOTORS; motor++) {
+                auto m = axes->_axis[axis]->_motors[motor];
+                if (!m) {
+                    continue;
+                }
+                int  pin;
+                bool falling;
+                if (!m->_driver->step_counter_pin(pin, falling)) {
+                    log_warn("Step check: " << axes->axisName(axis) << " motor" << motor << " step pin cannot be counted");
+                    continue;
+                }
+                if (pin < 0) {
+                    continue;
+                }
+                auto& c = counters[axis][motor];
+                c.unit  = pulse_counter_attach(pinnum_t(pin), falling);
+                if (c.unit < 0) {
+                    log_warn("Step check: no pulse counter for " << axes->axisName(axis) << " motor" << motor);
+                    continue;
+                }
+                c.motor = m;
+                c.last  = pulse_counter_read(c.unit);
+                enabled = true;
+            }
+        }
+        if (enabled) {
+            log_info("Step check: on");
+        }
+    }
+
+    void reset() {
+        sample();
+        for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+            issued[axis] = 0;
+            for (size_t motor = 0; motor < MAX_MOTORS; motor++) {
+                counters[axis][motor].pulses  = 0;
+                counters[axis][motor].excused = false;
+            }
+        }
+        pending = false;
+    }
+
+    // Motor::count_step() drops the steps of a motor that is blocked, or stopped at a
+    // limit, so its pulses fall short of the axis steps without any being lost
+    static inline void IRAM_ATTR excuse(int axis) {
+        for (size_t motor = 0; motor < MAX_MOTORS; motor++) {
+            auto& c = counters[axis][motor];
+            if (c.motor && (c.motor->_blocked || c.motor->_limited)) {
+                c.excused = true;
+            }
+        }
+    }
+
+    void IRAM_ATTR count(AxisMask step_bits) {
+        for (int axis = 0; step_bits; axis++, step_bits >>= 1) {
+            if (step_bits & 1) {
+                issued[axis]++;
+                excuse(axis);
+            }
+        }
+    }
+
+    void IRAM_ATTR count(int axis, uint32_t n) {
+        issued[axis] += n;
+        excuse(axis);
+    }
+
+    void IRAM_ATTR sample() {
+        for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+            for (size_t motor = 0; motor < MAX_MOTORS; motor++) {
+                auto& c = counters[axis][motor];
+                if (c.unit >= 0) {
+                    uint32_t now = pulse_counter_read(c.unit);
+                    c.pulses += now >= c.last ? now - c.last : now + pulseCounterLimit - c.last;
+                    c.last = now;
+                }
+            }
+        }
+    }
+
+    void IRAM_ATTR mark() { pending = true; }
+
+    void IRAM_ATTR verify() {
+        if (!pending) {
+            return;
+        }
+        pending = false;
+        sample();
+
+        // Homing blocks single motors of an axis, so the counts differ by design
+        bool homing = sys.state == State::Homing;
+        bool found  = false;
+        for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+            for (size_t motor = 0; motor < MAX_MOTORS; motor++) {
+                auto& c = counters[axis][motor];
+                if (c.unit >= 0 && c.pulses != issued[axis]) {
+                    if (!homing && !c.excused) {
+                        c.lost += int32_t(c.pulses - issued[axis]);
+                        found = true;
+                    }
+                    c.pulses = issued[axis];
+                }
+                c.excused = false;
+            }
+        }
+        if (found && !reporting) {
+            reporting = true;
+            protocol_send_event_from_ISR(&stepCheckEvent);
+        }
+    }
+}
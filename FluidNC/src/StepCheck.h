@@ -0,0 +1,44 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  StepCheck.h - hardware cross-check of the steps issued by the step ISR
+
+  When stepping/step_check is enabled, each motor whose step pin is a GPIO gets a PCNT
+  unit counting the pulses that actually appear on the pin.  The step ISR counts the
+  steps it issues for each axis, and the two are compared whenever a block ends or
+  stepping stops.  The comparison is done at the start of the following ISR, so the
+  last pulses have had time to finish even when they come from RMT.  Mismatches are
+  logged and, with step_check: Alarm, stop the machine with a Step Loss alarm.  A motor
+  whose steps were held back, while it was blocked or stopped at a hard limit, is not
+  compared until the next block.
+*/
+
+#include "Types.h"  // AxisMask
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstdint>
+
+namespace StepCheck {
+    // True when at least one motor is being checked
+    extern bool enabled;
+
+    void init();
+
+    // Drops any difference, after stepping has been aborted part way
+    void reset();
+
+    // Counts the steps of the axes in step_bits, or n steps of one axis, as they are output
+    void count(AxisMask step_bits);
+    void count(int axis, uint32_t n);
+
+    // Accumulates the hardware counts, often enough that the counters cannot wrap in between
+    void sample();
+
+    // Requests a comparison at the next verify()
+    void mark();
+
+    // Compares the counts if requested, reporting any difference
+    void verify();
+}
@@ -15,13 +15,46 @@
 #include "StepperPrivate.h"
 #include "Planner.h"
 #include "Protocol.h"
+#include "SpscRing.h"
+#include "InputShaper.h"
+#include "StepCheck.h"
+#include "Machine/Encoder.h"
+#include "MotionTrace.h"
+#include "MotionBench.h"
+#include "LatencyProbe.h"
+#include "Raster.h"
+#include "SyncLink.h"
+#include "Driver/RmtBurst.h"
+#include "Driver/soft_wdt.h"
 #include <esp_attr.h>  // IRAM_ATTR
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 
 using namespace Stepper;
 
 static bool awake = false;
 
+// Position trace state.  The ISR is the producer of the ring and the polling task,
+// in poll_trace(), is its consumer.
+static const uint32_t           traceRingSize        = 256;
+static const int                maxTraceLinesPerPoll = 32;
+static PositionSample           traceSamples[traceRingSize];
+static SpscRing<PositionSample> traceRing;
+static std::atomic<bool>        traceOn { false };
+static uint32_t                 tracePeriod;        // CPU ticks between samples
+static int32_t                  traceStart;         // CPU ticks when the trace started
+static int32_t                  traceNext;          // CPU ticks when the next sample is due
+static uint32_t                 traceOverruns = 0;  // Samples dropped because the ring was full
+static Channel*                 traceChannel  = nullptr;
+
+// With laser rate_power, the power of each step rate is looked up in a table over the
+// programmed rate, in this many parts, and interpolated between its entries
+static const uint32_t rateLutParts = 16;
+
 // Stores the planner block Bresenham algorithm execution data for the segments in the segment
 // buffer. Normally, this buffer is partially in-use, but, for the worst case scenario, it will
 // never exceed the number of accessible stepper buffer segments (config->_stepping->_segments-1).
@@ -31,9 +64,18 @@ static bool awake = false;
 struct st_block_t {
     uint32_t steps[MAX_N_AXIS];
     uint32_t step_event_count;
-    uint8_t  direction_bits;
-    bool     is_pwm_rate_adjusted;  // Tracks motions that require constant laser power/rate
+    AxisMask direction_bits;
+    bool     is_pwm_rate_adjusted;        // Tracks motions that require constant laser power/rate
+    uint8_t  raster;                      // Raster line slot, 0 if none
+    bool     backlash;                    // Has backlash take-up steps
+    uint32_t raster_off;                  // Device speed of pixel value 0
+    uint32_t pixel_span;                  // Bresenham units per pixel, whole part
+    uint32_t pixel_rem;                   // Bresenham units per pixel, remainder in 1/length units
+    int32_t  backlash_steps[MAX_N_AXIS];  // Take-up steps in the block, signed
+    uint32_t rate_inv;                    // Table index per segment speed unit, in 2^-24 parts; 0 if unused
+    uint32_t rate_lut[rateLutParts + 1];  // Device speed at each part of the programmed rate
 };
+static_assert(offsetof(st_block_t, raster_off) == sizeof(uint32_t) * (MAX_N_AXIS + 3), "st_block_t has padding between its flags");
 static volatile st_block_t* st_block_buffer = nullptr;
 
 // Primary stepper segment ring buffer. Contains small, short line segments for the stepper
@@ -45,12 +87,137 @@ struct segment_t {
     uint16_t     isrPeriod;          // Time to next ISR tick, in units of timer ticks
     uint8_t      st_block_index;     // Stepper block data index. Uses this information to execute this segment.
     uint8_t      amass_level;        // AMASS level for the ISR to execute this segment
+    uint16_t     linkPeriod;         // isrPeriod at the coordinator's clock, for SyncLink::ticked()
     uint32_t     spindle_dev_speed;  // Spindle speed scaled to the device
     SpindleSpeed spindle_speed;      // Spindle speed in GCode units
+    int32_t      spindle_dev_step;   // Change of spindle_dev_speed at each power update
+    uint16_t     power_ticks;        // ISR ticks between power updates
+    uint8_t      power_updates;      // Number of power updates after the start of the segment
+    bool         accelerating;       // The speed rises over the segment
+    uint32_t     speed;              // Speed, in 1/256 mm/min, for the fast hold speed cap
+    uint32_t     cap_rate;           // Change of the speed cap per timer tick, in 2^-16 speed units
+};
+static segment_t*          segment_buffer = nullptr;
+static SpscRing<segment_t> segments;  // Filled by prep_buffer(), consumed by the stepper ISR
+
+// Stepper block of the last segment sent to a sync link follower.  The follower's ISR starts
+// a new block where this changes, as the ISR here does where st.exec_block_index changes.
+static uint8_t linkBlockIndex = 0;
+
+// Backlash compensation.  When a move reverses an axis that has backlash_mm, the motor has to
+// turn that much further before the machine follows, so take-up steps are added to the
+// segments after the reversal, at no more than backlash_rate_mm_per_min on top of the move.
+// A line block gets a stepper block for each of those segments, as the chords of an arc do,
+// and one for the rest of it once the take-up is done.  The ISR counts the take-up steps in
+// backlash_steps as it loads them, so that they can be left out of the machine position.
+// The directions are kept apart from prep, since Stepper::reset() does not move the machine.
+// System motions such as homing and parking do not add take-up or change the directions.
+static bool backlashOn = false;  // Some axis has backlash_mm
+
+static struct {
+    int32_t  target[MAX_N_AXIS];   // Take-up steps that the reversals so far need
+    int32_t  prepped[MAX_N_AXIS];  // Take-up steps added to prepped segments
+    AxisMask negative;             // Direction of the last move on each axis, set for negative
+    AxisMask known;                // Axes that have moved since they were homed
+} lash;
+
+int32_t Stepper::backlash_steps[MAX_N_AXIS];
+
+// Segment durations in minutes, from stepping/segment_us and stepping/cruise_segment_us
+static float dt_segment;
+static float dt_cruise_segment;
+
+// Shortest ISR tick that AMASS may overdrive to, from the step rate of the stepping engine
+static uint32_t amassMinTicks;
+
+// With stepping/prep_task, prep_buffer() also runs in its own task on another core, so that
+// slow work in the main loop - parsing, file reads, channel polling - cannot starve the
+// segment buffer.  prep_mutex serializes it with the main loop's changes to the planner.
+static SemaphoreHandle_t prep_mutex = nullptr;
+
+// Fast hold.  A feed hold normally has to wait for the segments that are already in the
+// buffer, which run at the speeds they were prepped for, so the machine coasts for up to a
+// buffer's worth of time before it starts to slow down.  With stepping/fast_hold, the step
+// ISR instead caps the speed of every segment, stretching its tick period as needed.  The cap
+// starts at the speed of the executing segment and falls at its block acceleration, in fixed
+// point so that the ISR does no float math, and the steppers stop when it reaches zero.  The
+// rest of the buffer is kept, and on resume the cap rises again from zero at the same rate
+// until it no longer holds back the executing segment.  The prepped profile then takes over,
+// including the rest of the deceleration that prep worked out for the hold.
+enum CapMode : uint8_t {
+    CapOff = 0,
+    CapFalling,
+    CapStopped,
+    CapRising,
 };
-static segment_t* segment_buffer = nullptr;
+static volatile bool holdCapRequested = false;  // Set by fast_hold(), taken up by the ISR
+
+// Speed units of the cap per 2^16 timer ticks, for each mm/min^2 of acceleration
+static const float capRateScale = 256.0f * 65536.0f / (60.0f * Machine::Stepping::fStepperTimer);
+static TaskHandle_t      prep_task  = nullptr;
+
+Stepper::PrepLock::PrepLock() {
+    if (prep_mutex) {
+        xSemaphoreTakeRecursive(prep_mutex, portMAX_DELAY);
+    }
+}
+
+Stepper::PrepLock::~PrepLock() {
+    if (prep_mutex) {
+        xSemaphoreGiveRecursive(prep_mutex);
+    }
+}
+
+static void prep_loop(void* unused) {
+    while (true) {
+        // Woken early by notify_prep() when a block is queued, otherwise every tick
+        ulTaskNotifyTake(pdTRUE, 1);
+        switch (sys.state) {
+            case State::Cycle:
+            case State::Hold:
+            case State::SafetyDoor:
+            case State::Homing:
+            case State::Jog:
+                Stepper::prep_buffer();
+                break;
+            default:
+                soft_wdt_pause(SoftWdtPrep);
+                break;
+        }
+    }
+}
+
+void Stepper::notify_prep() {
+    if (prep_task) {
+        xTaskNotifyGive(prep_task);
+    }
+}
 
 void Stepper::init() {
+    reset_isr_stats();
+    traceRing.init(traceSamples, traceRingSize);
+    if (config->_stepping->_prepTask && !prep_task) {
+        prep_mutex = xSemaphoreCreateRecursiveMutex();
+        xTaskCreatePinnedToCore(prep_loop,                // task
+                                "step_prep",              // name for task
+                                4096,                     // size of task stack
+                                0,                        // parameters
+                                STEP_PREP_TASK_PRIORITY,  // priority
+                                &prep_task,               // task handle
+                                STEP_PREP_TASK_CORE       // core
+        );
+    }
+
+    auto axes  = config->_axes;
+    backlashOn = false;
+    for (size_t axis = 0; axis < axes->numberAxis(); axis++) {
+        backlashOn = backlashOn || axes->_axis[axis]->_backlash > 0;
+    }
+
+    auto stepping     = config->_stepping;
+    dt_segment        = stepping->_segmentUsecs / 60e6f;
+    dt_cruise_segment = stepping->_cruiseSegmentUsecs ? stepping->_cruiseSegmentUsecs / 60e6f : dt_segment;
+
     if (st_block_buffer) {
         delete[] st_block_buffer;
     }
@@ -59,6 +226,15 @@ void Stepper::init() {
         delete[] segment_buffer;
     }
     segment_buffer = new segment_t[config->_stepping->_segments];
+    segments.init(segment_buffer, config->_stepping->_segments);
+
+    // A raster line is held from its command until its stepper block is reused.  Only
+    // a laser can use one, so other machines keep the memory.
+    auto& spindles = config->_spindles;
+    bool  laser    = std::any_of(spindles.begin(), spindles.end(), [](Spindles::Spindle* s) { return s->isRateAdjusted(); });
+    Raster::init(laser ? config->_planner_blocks + config->_stepping->_segments : 0);
+
+    amassMinTicks = Machine::Stepping::fStepperTimer / stepping->maxPulsesPerSec();
 }
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
@@ -69,10 +245,25 @@ typedef struct {
 
     uint8_t  step_bits;     // Stores out_bits output to complete the step pulse delay
     uint8_t  execute_step;  // Flags step execution for each interrupt.
-    uint8_t  step_outbits;  // The next stepping-bits to be output
-    uint8_t  dir_outbits;
+    AxisMask step_outbits;  // The next stepping-bits to be output
+    AxisMask dir_outbits;
     uint32_t steps[MAX_N_AXIS];
 
+    uint32_t spindle_dev;      // Device speed last output during the segment
+    uint32_t power_full;       // Device speed of the segment, before raster pixels scale it
+    uint16_t power_countdown;  // Ticks until the next power update
+    uint8_t  power_updates;    // Power updates left in the segment
+
+    Raster::Line* raster_line;   // Pixels of the raster block being executed, nullptr if none
+    uint32_t      raster_inc;    // Bresenham units per ISR tick at the AMASS level of the segment
+    uint32_t      raster_pos;    // Progress through the raster block in Bresenham units
+    uint32_t      raster_next;   // Progress at which the next pixel starts
+    uint32_t      raster_err;    // Remainder of raster_next in 1/length units
+    uint16_t      raster_pixel;  // Pixel being output
+
+    bool                 accelerating;      // The executing segment speeds up
+    uint8_t              cap_mode;          // CapMode of the fast hold speed cap
+    uint32_t             cap;               // Fast hold speed cap, in 1/256 mm/min
     uint16_t             step_count;        // Steps remaining in line segment motion
     uint8_t              exec_block_index;  // Tracks the current st_block index. Change indicates new block.
     volatile st_block_t* exec_block;        // Pointer to the block data for the segment being executed
@@ -80,11 +271,6 @@ typedef struct {
 } stepper_t;
 static stepper_t st;
 
-// Step segment ring buffer indices
-static volatile uint32_t segment_buffer_tail;
-static volatile uint32_t segment_buffer_head;
-static uint32_t          segment_next_head;
-
 // Pointers for the step segment being prepped from the planner buffer. Accessed only by the
 // main program. Pointers may be planning segments or planner blocks ahead of what being executed.
 static plan_block_t*        pl_block;       // Pointer to the planner block being prepped
@@ -118,6 +304,24 @@ typedef struct {
     float        inv_rate;  // Used by PWM laser mode to speed up segment calculations.
     SpindleSpeed current_spindle_speed;
 
+    // Shaped ramp state, used instead of constant acceleration when stepping/s_curve is set
+    // or an axis of the block has an input shaper
+    float ramp_entry_speed;  // Speed at the start of the current ramp (mm/min)
+    float ramp_exit_speed;   // Speed at the end of the current ramp (mm/min)
+    float ramp_duration;     // Duration of the current ramp (min)
+    float ramp_elapsed;      // Time since the start of the current ramp (min)
+    float ramp_width;        // Width of the input-shaped acceleration pulse, 0 for an S-curve (min)
+    bool  shape_accel;       // The acceleration ramp of the block is input-shaped
+    bool  shape_decel;       // The deceleration ramp of the block is input-shaped
+
+    // Native arc and kinematic line state
+    int32_t chord_steps[MAX_N_AXIS];  // Step position at the end of the last prepped chord
+    bool    first_chord;              // The first chord of a block uses the stepper block loaded with it
+
+    // Line blocks with backlash take-up are split into a stepper block per segment
+    bool     line_split;             // The segments of the line block are split off
+    uint32_t line_done[MAX_N_AXIS];  // Steps of the line block in the segments split off
+
 } st_prep_t;
 static st_prep_t prep;
 
@@ -181,9 +385,529 @@ void IRAM_ATTR Stepper::stop_stepping() {
     st.step_outbits = 0;
 }
 
-#ifdef DEBUG_STEPPER_ISR
-uint32_t Stepper::isr_count;  // for debugging only
-#endif
+Stepper::IsrStats Stepper::isr_stats;
+
+void (*Stepper::accel_hook)(bool accelerating) = nullptr;
+void (*Stepper::segment_hook)()                 = nullptr;
+
+void Stepper::reset_isr_stats() {
+    memset(&isr_stats, 0, sizeof(isr_stats));
+    isr_stats.min_ticks = UINT32_MAX;
+}
+
+// Records the execution time and latency of one ISR invocation
+static inline void IRAM_ATTR record_isr_stats(int32_t start, uint32_t latency) {
+    uint32_t ticks = uint32_t(getCpuTicks() - start);
+    isr_stats.count++;
+    isr_stats.total_ticks += ticks;
+    if (ticks < isr_stats.min_ticks) {
+        isr_stats.min_ticks = ticks;
+    }
+    if (ticks > isr_stats.max_ticks) {
+        isr_stats.max_ticks = ticks;
+    }
+    if (!stepTimerFlashCacheOn()) {
+        isr_stats.cache_off++;
+        if (ticks > isr_stats.cache_off_max_ticks) {
+            isr_stats.cache_off_max_ticks = ticks;
+        }
+    }
+    if (Machine::Stepping::_engine != Machine::Stepping::I2S_STREAM) {
+        uint32_t us  = latency / (Machine::Stepping::fStepperTimer / 1000000);
+        int      bin = us ? 32 - __builtin_clz(us) : 0;
+        isr_stats.latency[bin < isrLatencyBins ? bin : isrLatencyBins - 1]++;
+    }
+}
+
+// Records the step counts if a trace sample is due.  The motor step counts are
+// only changed by the ISR, so they are consistent with each other here.
+// A motion bench runs the trace on its virtual clock
+static inline int32_t IRAM_ATTR trace_clock() {
+    return MotionBench::active ? MotionBench::cpuTicks() : getCpuTicks();
+}
+
+static inline void IRAM_ATTR sample_position(int n_axis) {
+    if (!traceOn.load(std::memory_order_acquire)) {
+        return;
+    }
+    int32_t now = trace_clock();
+    if ((now - traceNext) < 0) {
+        return;
+    }
+    traceNext += tracePeriod;
+    if ((now - traceNext) >= 0) {
+        // The steppers were idle or the ISR ran late, so restart the cadence
+        traceNext = now + tracePeriod;
+    }
+    if (traceRing.full()) {
+        traceOverruns++;
+        return;
+    }
+    PositionSample* sample = traceRing.back();
+    sample->usecs          = uint32_t(now - traceStart) / ticks_per_us;
+    auto axes              = config->_axes;
+    for (int axis = 0; axis < n_axis; axis++) {
+        auto m              = axes->_axis[axis]->_motors[0];
+        sample->steps[axis] = m ? m->_steps : 0;
+    }
+    traceRing.push();
+}
+
+void Stepper::start_trace(Channel& channel, uint32_t rate) {
+    stop_trace();
+    // Discard what is left of an earlier trace; only the consumer side is touched
+    while (!traceRing.empty()) {
+        traceRing.pop();
+    }
+    traceOverruns = 0;
+    tracePeriod   = ticks_per_us * (1000000 / rate);
+    traceStart    = trace_clock();
+    traceNext     = traceStart;
+    traceChannel  = &channel;
+    traceOn.store(true, std::memory_order_release);
+}
+
+void Stepper::stop_trace(Channel* channel) {
+    if (channel && channel != traceChannel) {
+        return;
+    }
+    traceOn.store(false, std::memory_order_release);
+    if (traceChannel && traceOverruns) {
+        log_warn("Position trace dropped " << traceOverruns << " samples");
+    }
+    traceChannel = nullptr;
+}
+
+void Stepper::restart_trace() {
+    traceStart = trace_clock();
+    traceNext  = traceStart;
+}
+
+bool Stepper::trace_full() {
+    return traceOn.load(std::memory_order_acquire) && traceRing.full();
+}
+
+bool Stepper::tracing() {
+    return traceChannel != nullptr;
+}
+
+void Stepper::poll_trace() {
+    if (!traceChannel) {
+        return;
+    }
+    auto n_axis = config->_axes->numberAxis();
+    for (int i = 0; i < maxTraceLinesPerPoll && !traceRing.empty(); i++) {
+        PositionSample* sample = traceRing.front();
+        LogStream       msg(*traceChannel, "[TRACE:");
+        msg << sample->usecs;
+        for (int axis = 0; axis < n_axis; axis++) {
+            msg << "," << int(sample->steps[axis]);
+        }
+        traceRing.pop();
+    }
+}
+
+// Outputs the power of the current raster pixel, scaled between off and the segment power
+static inline void IRAM_ATTR raster_output() {
+    int32_t off    = st.exec_block->raster_off;
+    int32_t full   = st.power_full;
+    st.spindle_dev = off + (full - off) * st.raster_line->pixels[st.raster_pixel] / 255;
+    spindle->setSpeedfromISR(st.spindle_dev);
+}
+
+// The rate_power device speed at a speed, in the 1/256 mm/min of segment_t::speed.  The
+// table index has 8 fraction bits, and speeds above the programmed rate take the last entry.
+static inline uint32_t IRAM_ATTR rate_power(uint32_t speed) {
+    auto     block = st.exec_block;
+    uint32_t q     = uint32_t(std::min<uint64_t>((uint64_t(speed) * block->rate_inv) >> 16, rateLutParts << 8));
+    uint32_t i     = q >> 8;
+    if (i == rateLutParts) {
+        return block->rate_lut[rateLutParts];
+    }
+    int32_t lo = block->rate_lut[i];
+    int32_t hi = block->rate_lut[i + 1];
+    return lo + (((hi - lo) * int32_t(q & 0xff)) >> 8);
+}
+
+// Outputs the rate_power device speed for the speed that the steps run at, if it changed
+static inline void IRAM_ATTR output_rate_power(uint32_t speed) {
+    uint32_t dev = rate_power(speed);
+    if (dev == st.power_full) {
+        return;
+    }
+    st.power_full = dev;
+    if (st.raster_line) {
+        raster_output();
+    } else {
+        st.spindle_dev = dev;
+        spindle->setSpeedfromISR(dev);
+    }
+}
+
+// Moves the raster block forward by some ISR ticks, changing the power at pixel boundaries
+static inline void IRAM_ATTR advance_raster(uint32_t ticks) {
+    st.raster_pos += ticks * st.raster_inc;
+    if (st.raster_pos < st.raster_next) {
+        return;
+    }
+    uint16_t length = st.raster_line->length;
+    while (st.raster_pos >= st.raster_next) {
+        if (++st.raster_pixel == length - 1) {
+            st.raster_next = UINT32_MAX;  // The last pixel lasts to the end of the block
+            break;
+        }
+        st.raster_next += st.exec_block->pixel_span;
+        st.raster_err += st.exec_block->pixel_rem;
+        if (st.raster_err >= length) {
+            st.raster_err -= length;
+            st.raster_next++;
+        }
+    }
+    raster_output();
+}
+
+// One tick of the Bresenham line tracer: each axis adds its steps to its counter, and steps
+// when the counter passes step_event_count, which is then taken off it.  The comparison result
+// is used as a number rather than a branch, so the loop has no data-dependent branches and
+// compiles to conditional moves, and the counters and step_event_count are passed in so the
+// compiler can keep them in registers instead of reloading them through st for every axis.
+static inline AxisMask IRAM_ATTR bresenham_tick(uint32_t* counter, const uint32_t* steps, int n_axis, uint32_t step_event_count) {
+    AxisMask bits = 0;
+    for (int axis = 0; axis < n_axis; axis++) {
+        uint32_t c    = counter[axis] + steps[axis];
+        uint32_t step = c > step_event_count;
+        counter[axis] = c - (step_event_count & -step);
+        bits |= step << axis;
+    }
+    return bits;
+}
+
+uint32_t Stepper::bresenham_benchmark(size_t n_axes, uint32_t n_ticks) {
+    // Steps at different ratios to the step events, like those of a slanted line
+    const uint32_t step_event_count = 100000;
+    uint32_t       counter[MAX_N_AXIS];
+    uint32_t       steps[MAX_N_AXIS];
+    for (size_t axis = 0; axis < n_axes; axis++) {
+        counter[axis] = step_event_count >> 1;
+        steps[axis]   = step_event_count - axis * 7919;
+    }
+    AxisMask bits  = 0;
+    int32_t  start = getCpuTicks();
+    for (uint32_t tick = 0; tick < n_ticks; tick++) {
+        bits ^= bresenham_tick(counter, steps, n_axes, step_event_count);
+    }
+    uint32_t ticks = uint32_t(getCpuTicks() - start);
+    volatile AxisMask sink = bits;  // Keeps the loop from being optimized away
+    (void)sink;
+    return ticks / n_ticks;
+}
+
+// Loads the next step segment from the segment buffer.  Returns false if the buffer is empty.
+static inline bool IRAM_ATTR load_segment(int n_axis) {
+    if (segments.empty()) {
+        return false;
+    }
+    // Initialize new step segment and load number of steps to execute
+    st.exec_segment = segments.front();
+    st.step_count   = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
+    LatencyProbe::toggle(LatencyProbe::Segment);
+    if (st.exec_segment->accelerating != st.accelerating) {
+        st.accelerating = st.exec_segment->accelerating;
+        if (Stepper::accel_hook) {
+            Stepper::accel_hook(st.accelerating);
+        }
+    }
+    if (MotionTrace::enabled) {
+        MotionTrace::record(MotionTrace::LoadSegment, segments.size() - 1);
+    }
+    // If the new segment starts a new planner block, initialize stepper variables and counters.
+    // NOTE: When the segment data index changes, this indicates a new planner block.
+    if (st.exec_block_index != st.exec_segment->st_block_index) {
+        if (StepCheck::enabled) {
+            StepCheck::mark();  // The previous block is complete
+        }
+        st.exec_block_index = st.exec_segment->st_block_index;
+        st.exec_block       = &st_block_buffer[st.exec_block_index];
+        // Initialize Bresenham line and distance counters
+        for (int axis = 0; axis < n_axis; axis++) {
+            st.counter[axis] = st.exec_block->step_event_count >> 1;
+        }
+        if (st.exec_block->backlash) {
+            for (int axis = 0; axis < n_axis; axis++) {
+                Stepper::backlash_steps[axis] += st.exec_block->backlash_steps[axis];
+            }
+        }
+        st.raster_line = NULL;
+        if (st.exec_block->raster) {
+            st.raster_line  = &Raster::line(st.exec_block->raster);
+            st.raster_pixel = 0;
+            st.raster_pos   = 0;
+            st.raster_err   = 0;
+            st.raster_next  = st.raster_line->length > 1 ? st.exec_block->pixel_span : UINT32_MAX;
+        }
+    }
+
+    st.dir_outbits = st.exec_block->direction_bits;
+    // Adjust Bresenham axis increment counters according to AMASS level.
+    for (int axis = 0; axis < n_axis; axis++) {
+        st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
+    }
+    if (StepCheck::enabled) {
+        StepCheck::sample();
+    }
+    if (Stepper::segment_hook) {
+        Stepper::segment_hook();
+    }
+    if (Machine::Encoder::enabled) {
+        Machine::Encoder::check_all();
+    }
+    // Set real-time spindle output as segment is loaded, just prior to the first step.
+    st.spindle_dev     = st.exec_segment->spindle_dev_speed;
+    st.power_countdown = st.exec_segment->power_ticks;
+    st.power_updates   = st.exec_segment->power_updates;
+    if (st.exec_block->rate_inv) {
+        st.spindle_dev = rate_power(st.exec_segment->speed);
+    }
+    st.power_full = st.spindle_dev;
+    if (st.raster_line) {
+        st.raster_inc = (1 << maxAmassLevel) >> st.exec_segment->amass_level;
+        raster_output();
+    } else {
+        spindle->setSpeedfromISR(st.spindle_dev);
+    }
+    return true;
+}
+
+// The Bresenham counter of an axis passes step_event_count once per step, so the steps
+// left in the segment follow from the counter and the ticks that the segment has left.
+int32_t IRAM_ATTR Stepper::segment_target(size_t axis) {
+    auto    m     = config->_axes->_axis[axis]->_motors[0];
+    int32_t steps = m ? m->_steps : 0;
+    if (st.exec_segment == NULL) {
+        return steps;
+    }
+    uint32_t n = (uint64_t(st.counter[axis]) + uint64_t(st.step_count) * st.steps[axis]) / st.exec_block->step_event_count;
+    return bitnum_is_true(st.dir_outbits, axis) ? steps - int32_t(n) : steps + int32_t(n);
+}
+
+// Steps the laser power schedule of the segment forward by some ISR ticks
+static inline void IRAM_ATTR advance_power(uint32_t ticks) {
+    while (st.power_updates && ticks >= st.power_countdown) {
+        ticks -= st.power_countdown;
+        st.power_countdown = st.exec_segment->power_ticks;
+        st.power_updates--;
+        st.spindle_dev += st.exec_segment->spindle_dev_step;
+        spindle->setSpeedfromISR(st.spindle_dev);
+    }
+    st.power_countdown -= ticks;
+}
+
+// Shuts stepping down when the segment buffer has run dry
+static inline void IRAM_ATTR end_stepping() {
+    Stepper::stop_stepping();
+    if (StepCheck::enabled) {
+        StepCheck::mark();
+    }
+    if (Machine::Encoder::enabled) {
+        Machine::Encoder::check_all();
+    }
+    if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
+        // Ensure pwm is set properly upon completion of rate-controlled motion.
+        if (st.exec_block != NULL && (st.exec_block->is_pwm_rate_adjusted || st.exec_block->raster)) {
+            spindle->setSpeedfromISR(0);
+        }
+    }
+
+    protocol_send_event_from_ISR(&cycleStopEvent);
+    awake       = false;
+    st.cap_mode = CapOff;
+    if (pl_block != NULL && !sys.step_control.endMotion) {
+        isr_stats.underruns++;  // The segment generator fell behind in the middle of a block
+        if (MotionTrace::enabled) {
+            MotionTrace::record(MotionTrace::Underrun);
+        }
+    }
+}
+
+// Sets the tick period for the fast hold speed cap, and moves the cap on by that period.
+// Returns false when a falling cap reaches zero.
+static inline bool IRAM_ATTR cap_speed() {
+    auto segment = st.exec_segment;
+    if (holdCapRequested) {
+        holdCapRequested = false;
+        st.cap_mode      = CapFalling;
+        st.cap           = segment->speed;
+    }
+    uint32_t period = segment->isrPeriod;
+    if (segment->speed > st.cap) {
+        period = st.cap ? uint32_t(std::min<uint64_t>(uint64_t(period) * segment->speed / st.cap, 0xffff)) : 0xffff;
+    }
+    uint32_t change = uint32_t((uint64_t(segment->cap_rate) * period) >> 16);
+    if (st.cap_mode == CapFalling) {
+        if (st.cap <= change) {
+            st.cap      = 0;
+            st.cap_mode = CapStopped;
+            return false;
+        }
+        st.cap -= change;
+    } else {
+        st.cap += change;
+        if (st.cap >= segment->speed) {
+            st.cap_mode = CapOff;
+        }
+    }
+    config->_stepping->setTimerPeriod(period);
+    if (st.exec_block->rate_inv) {
+        output_rate_power(std::min(uint32_t(segment->speed), st.cap));
+    }
+    return true;
+}
+
+// Stops stepping where the fast hold speed cap falls to zero.  Unlike end_stepping(), the
+// segments that are left stay in the buffer, for the resume.
+static inline void IRAM_ATTR end_fast_hold() {
+    Stepper::stop_stepping();
+    if (st.exec_block != NULL && (st.exec_block->is_pwm_rate_adjusted || st.exec_block->raster)) {
+        spindle->setSpeedfromISR(0);
+    }
+    protocol_send_event_from_ISR(&cycleStopEvent);
+    awake = false;
+}
+
+/*
+   The RMT_burst engine runs each segment as one or more bursts instead of one ISR per tick.
+   Each call works out from the Bresenham counters the tick at which every axis steps during
+   the next stretch of ticks, exactly as the per-tick algorithm would, and loads those times
+   into the RMT channels of the axis motors.  The RMT hardware then plays the pulses out while
+   the ISR is idle, and the step timer is set to call again when the stretch is over.  The
+   stretch is limited so that no motor has more pulses than its RMT memory holds.
+   Homing and probing need per-step reactions, so they switch to the RMT engine.
+*/
+static bool IRAM_ATTR burst_func() {
+    uint32_t latency = stepTimerGetTicks();
+    int32_t  start   = getCpuTicks();
+
+    // The previous burst is over, so every pulse staged so far has started
+    if (StepCheck::enabled) {
+        StepCheck::verify();
+    }
+
+    auto n_axis = config->_axes->numberAxis();
+
+    if (st.exec_segment == NULL && !load_segment(n_axis)) {
+        end_stepping();
+        sample_position(n_axis);
+        record_isr_stats(start, latency);
+        return false;
+    }
+
+    const uint32_t ticksPerUsec = Machine::Stepping::fStepperTimer / 1000000;
+    uint32_t       period       = st.exec_segment->isrPeriod;
+    uint32_t       sec          = st.exec_block->step_event_count;
+
+    // In n ticks an axis steps at most n * steps / sec + 1 times
+    uint32_t ticks    = st.step_count;
+    uint32_t maxTicks = rmtBurstMaxUsecs * ticksPerUsec / period;
+    uint32_t capacity = rmtBurstCapacity();
+    for (int axis = 0; axis < n_axis; axis++) {
+        if (st.steps[axis]) {
+            uint32_t n = uint64_t(capacity - 1) * sec / st.steps[axis];
+            if (n < maxTicks) {
+                maxTicks = n;
+            }
+        }
+    }
+    if (ticks > maxTicks) {
+        ticks = maxTicks;
+    }
+    if (ticks == 0) {
+        ticks = 1;  // A segment with no ticks still takes one
+    }
+
+    // Step drivers need time between a direction change and a pulse
+    uint32_t lead = config->_axes->set_direction(st.dir_outbits) ? config->_stepping->_directionDelayUsecs : 0;
+
+    static uint32_t starts[rmtBurstMaxPulses];
+    for (int axis = 0; axis < n_axis; axis++) {
+        uint32_t steps = st.steps[axis];
+        if (steps == 0) {
+            continue;
+        }
+        uint32_t counter = st.counter[axis];
+        uint32_t tick    = 0;
+        uint32_t count   = 0;
+        while (true) {
+            // Ticks until the counter passes sec
+            uint32_t n = (sec - counter) / steps + 1;
+            if (tick + n > ticks) {
+                counter += (ticks - tick) * steps;
+                break;
+            }
+            tick += n;
+            counter += n * steps - sec;
+            // The per-tick algorithm outputs a step one tick after it is computed
+            starts[count++] = lead + (tick - 1) * period / ticksPerUsec;
+        }
+        st.counter[axis] = counter;
+        if (count) {
+            config->_axes->burst_axis(axis, bitnum_is_true(st.dir_outbits, axis), starts, count);
+            if (StepCheck::enabled) {
+                StepCheck::count(axis, count);
+            }
+        }
+    }
+    rmtBurstStart();
+    stepTimerSetTicks(ticks * period + lead * ticksPerUsec);
+    SyncLink::ticked(ticks * st.exec_segment->linkPeriod);
+
+    st.step_count = st.step_count > ticks ? st.step_count - ticks : 0;
+    if (st.power_updates) {
+        advance_power(ticks);
+    }
+    if (st.raster_line) {
+        advance_raster(ticks);
+    }
+    if (st.step_count == 0) {
+        // Segment is complete. Discard current segment and advance segment indexing.
+        st.exec_segment = NULL;
+        segments.pop();
+    }
+
+    sample_position(n_axis);
+    record_isr_stats(start, latency);
+    return true;
+}
+
+// Between ticks the motor counts are those of the last tick, and the Bresenham counters
+// and st.step_outbits are already those of the next one.  An axis ideally moves
+// st.steps / step_event_count steps per tick, and the counter, less the half that it
+// starts at, is how far ahead of its output steps the ideal position is, so the position
+// at fraction f of the way to the next tick is that, less the ideal movement in the
+// rest of the tick, relative to the next tick's steps.
+void IRAM_ATTR Stepper::probe_tripped(bool latched) {
+    probeState = ProbeState::Off;
+
+    auto axes    = config->_axes;
+    auto n_axis  = axes->numberAxis();
+    auto segment = st.exec_segment;
+    auto block   = st.exec_block;
+    bool between = latched && segment && block && block->step_event_count && segment->isrPeriod;
+    float f      = between ? std::min(float(stepTimerGetTicks()) / segment->isrPeriod, 1.0f) : 0.0f;
+    for (int axis = 0; axis < n_axis; axis++) {
+        auto m               = axes->_axis[axis]->_motors[0];
+        probe_steps[axis]    = (m ? m->_steps : 0) - Stepper::backlash_steps[axis];
+        probe_fraction[axis] = 0.0f;
+        if (between && st.steps[axis]) {
+            float sec   = float(block->step_event_count);
+            float ahead = (float(st.counter[axis]) - float(block->step_event_count >> 1) - (1.0f - f) * st.steps[axis]) / sec;
+            if (bitnum_is_true(st.step_outbits, axis)) {
+                ahead += 1.0f;
+            }
+            probe_fraction[axis] = bitnum_is_true(st.dir_outbits, axis) ? -ahead : ahead;
+        }
+    }
+    protocol_send_event_from_ISR(&motionCancelEvent);
+}
 
 /**
  * This phase of the ISR should ONLY create the pulses for the steppers.
@@ -194,91 +918,114 @@ uint32_t Stepper::isr_count;  // for debugging only
  * Returns true if step interrupts should continue
  */
 bool IRAM_ATTR Stepper::pulse_func() {
-#ifdef DEBUG_STEPPER_ISR
-    isr_count++;
-#endif
     // This is a precaution in case we get a spurious interrupt
     if (!awake) {
         return false;
     }
-    auto n_axis = config->_axes->_numberAxis;
+    if (Machine::Stepping::_engine == Machine::Stepping::RMT_BURST) {
+        return burst_func();
+    }
+    auto n_axis = config->_axes->numberAxis();
+
+    // The pulses of the previous tick have started by now, and those of this
+    // tick have not, so the counts can be compared here
+    if (StepCheck::enabled) {
+        StepCheck::verify();
+        StepCheck::count(st.step_outbits);
+    }
 
     config->_axes->step(st.step_outbits, st.dir_outbits);
 
+    // Instrumentation starts after the pulses so it does not add to their jitter
+    LatencyProbe::toggle(LatencyProbe::Isr);
+    uint32_t latency = stepTimerGetTicks();
+    int32_t  start   = getCpuTicks();
+
     // If there is no step segment, attempt to pop one from the stepper buffer
     if (st.exec_segment == NULL) {
         // Anything in the buffer? If so, load and initialize next step segment.
-        if (segment_buffer_head != segment_buffer_tail) {
-            // Initialize new step segment and load number of steps to execute
-            st.exec_segment = &segment_buffer[segment_buffer_tail];
-            // Initialize step segment timing per step and load number of steps to execute.
+        if (load_segment(n_axis)) {
+            // Initialize step segment timing per step
             config->_stepping->setTimerPeriod(st.exec_segment->isrPeriod);
-            st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
-            // If the new segment starts a new planner block, initialize stepper variables and counters.
-            // NOTE: When the segment data index changes, this indicates a new planner block.
-            if (st.exec_block_index != st.exec_segment->st_block_index) {
-                st.exec_block_index = st.exec_segment->st_block_index;
-                st.exec_block       = &st_block_buffer[st.exec_block_index];
-                // Initialize Bresenham line and distance counters
-                for (int axis = 0; axis < n_axis; axis++) {
-                    st.counter[axis] = st.exec_block->step_event_count >> 1;
-                }
-            }
-
-            st.dir_outbits = st.exec_block->direction_bits;
-            // Adjust Bresenham axis increment counters according to AMASS level.
-            for (int axis = 0; axis < n_axis; axis++) {
-                st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
-            }
-            // Set real-time spindle output as segment is loaded, just prior to the first step.
-            spindle->setSpeedfromISR(st.exec_segment->spindle_dev_speed);
         } else {
             // Segment buffer empty. Shutdown.
-            stop_stepping();
-            if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
-                // Ensure pwm is set properly upon completion of rate-controlled motion.
-                if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
-                    spindle->setSpeedfromISR(0);
-                }
-            }
-
-            protocol_send_event_from_ISR(&cycleStopEvent);
-            awake = false;
+            end_stepping();
+            sample_position(n_axis);
+            record_isr_stats(start, latency);
             return false;  // Nothing to do but exit.
         }
     }
 
-    // Check probing state.
-    if (probeState == ProbeState::Active && config->_probe->tripped()) {
-        probeState = ProbeState::Off;
-        auto axes  = config->_axes;
-        for (int axis = 0; axis < n_axis; axis++) {
-            auto m            = axes->_axis[axis]->_motors[0];
-            probe_steps[axis] = m ? m->_steps : 0;
+    if (st.cap_mode != CapOff || holdCapRequested) {
+        if (!cap_speed()) {
+            end_fast_hold();
+            sample_position(n_axis);
+            record_isr_stats(start, latency);
+            return false;
         }
-        protocol_send_event_from_ISR(&motionCancelEvent);
     }
 
-    // Reset step out bits.
-    st.step_outbits = 0;
+    // Check probing state, unless the probe pin interrupt is watching it
+    if (probeState == ProbeState::Active && !config->_probe->_latching && config->_probe->tripped()) {
+        probe_tripped(false);
+    }
 
-    for (int axis = 0; axis < n_axis; axis++) {
-        // Execute step displacement profile by Bresenham line algorithm
-        st.counter[axis] += st.steps[axis];
-        if (st.counter[axis] > st.exec_block->step_event_count) {
-            set_bitnum(st.step_outbits, axis);
-            st.counter[axis] -= st.exec_block->step_event_count;
+    // Execute step displacement profile by Bresenham line algorithm
+    st.step_outbits = bresenham_tick(st.counter, st.steps, n_axis, st.exec_block->step_event_count);
+
+    st.step_count--;  // Decrement step events count
+    SyncLink::ticked(st.exec_segment->linkPeriod);
+    if (st.power_updates) {
+        advance_power(1);
+    }
+    if (st.raster_line) {
+        advance_raster(1);
+    }
+
+    // The I2S stream is rendered ahead of time, so instead of one call per tick, a run
+    // of ticks with no steps is passed over at once by working out from the Bresenham
+    // counters how many ticks remain before the next step.  The DMA buffer is then
+    // filled with the unchanged port data for that long.  Probing is left at one call
+    // per tick so the trip position is captured as before.
+    if (Machine::Stepping::_engine == Machine::Stepping::I2S_STREAM) {
+        uint32_t idle = 0;
+        if (st.step_outbits == 0 && st.step_count != 0 && probeState != ProbeState::Active) {
+            idle = st.step_count;
+            for (int axis = 0; axis < n_axis; axis++) {
+                if (st.steps[axis]) {
+                    uint32_t n = (st.exec_block->step_event_count - st.counter[axis]) / st.steps[axis];
+                    if (n < idle) {
+                        idle = n;
+                    }
+                }
+            }
+            for (int axis = 0; axis < n_axis; axis++) {
+                st.counter[axis] += idle * st.steps[axis];
+            }
+            st.step_count -= idle;
+            SyncLink::ticked(idle * st.exec_segment->linkPeriod);
+            if (st.power_updates) {
+                advance_power(idle);
+            }
+            if (st.raster_line) {
+                advance_raster(idle);
+            }
         }
+        config->_stepping->setStreamTicks(st.exec_segment->isrPeriod, idle + 1);
     }
 
-    st.step_count--;  // Decrement step events count
     if (st.step_count == 0) {
         // Segment is complete. Discard current segment and advance segment indexing.
-        st.exec_segment     = NULL;
-        segment_buffer_tail = segment_buffer_tail >= (config->_stepping->_segments - 1) ? 0 : segment_buffer_tail + 1;
+        st.exec_segment = NULL;
+        segments.pop();
     }
 
-    config->_axes->unstep();
+    // The pulse timer ends the pulses by itself, so the ISR need not wait for them
+    if (!config->_stepping->_asyncPulse) {
+        config->_axes->unstep();
+    }
+    sample_position(n_axis);
+    record_isr_stats(start, latency);
     return true;
 }
 
@@ -288,6 +1035,12 @@ void Stepper::wake_up() {
         return;
     }
     awake = true;
+    if (SyncLink::coordinating()) {
+        SyncLink::started();
+    }
+    if (st.cap_mode == CapStopped) {
+        st.cap_mode = CapRising;  // Resuming from a fast hold
+    }
     // Cancel any pending stepper disable
     protocol_cancel_disable_steppers();
     // Enable stepper drivers.
@@ -297,6 +1050,15 @@ void Stepper::wake_up() {
     config->_stepping->startTimer();
 }
 
+void Stepper::fast_hold() {
+    // Parking would run the segments left in the buffer before the parking motion, and the
+    // boards of a sync link would not hold back the same segments
+    bool linked = SyncLink::coordinating() || SyncLink::following();
+    if (config->_stepping->_fastHold && awake && !config->_parking->enabled() && !linked) {
+        holdCapRequested = true;
+    }
+}
+
 void Stepper::go_idle() {
     awake = false;
     stop_stepping();
@@ -305,26 +1067,55 @@ void Stepper::go_idle() {
 
 // Reset and clear stepper subsystem variables
 void Stepper::reset() {
+    PrepLock lock;
+
     // Initialize Stepping driver idle state.
     config->_stepping->reset();
 
     go_idle();
 
+    if (StepCheck::enabled) {
+        StepCheck::reset();
+    }
+
+    // Every raster line is dropped with the blocks that held it
+    Raster::reset();
+    if (st_block_buffer) {
+        for (size_t i = 0; i < config->_stepping->_segments - 1; i++) {
+            st_block_buffer[i].raster = 0;
+        }
+    }
+
+    // The take-up in segments that were dropped is still to be done
+    copyAxes(lash.prepped, Stepper::backlash_steps);
+
     // Initialize stepper algorithm variables.
     memset(&prep, 0, sizeof(st_prep_t));
     memset(&st, 0, sizeof(stepper_t));
-    st.exec_segment     = NULL;
-    pl_block            = NULL;  // Planner block pointer used by segment buffer
-    segment_buffer_tail = 0;
-    segment_buffer_head = 0;  // empty = tail
-    segment_next_head   = 1;
-    st.step_outbits     = 0;
-    st.dir_outbits      = 0;  // Initialize direction bits to default.
+    holdCapRequested = false;
+    st.exec_segment = NULL;
+    pl_block        = NULL;  // Planner block pointer used by segment buffer
+    segments.reset();
+    linkBlockIndex = 0;  // As st.exec_block_index
+    if (SyncLink::coordinating()) {
+        SyncLink::reset();
+    }
+    st.step_outbits = 0;
+    st.dir_outbits  = 0;  // Initialize direction bits to default.
     // TODO do we need to turn step pins off?
 }
 
+void Stepper::reset_backlash(size_t axis) {
+    PrepLock lock;
+    lash.target[axis]    = 0;
+    lash.prepped[axis]   = 0;
+    backlash_steps[axis] = 0;
+    clear_bitnum(lash.known, axis);
+}
+
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 bool Stepper::update_plan_block_parameters() {
+    PrepLock lock;
     if (pl_block != NULL) {  // Ignore if at start of a new block.
         prep.recalculate_flag.recalculate = 1;
         pl_block->entry_speed_sqr         = prep.current_speed * prep.current_speed;  // Update entry speed.
@@ -336,6 +1127,8 @@ bool Stepper::update_plan_block_parameters() {
 
 // Changes the run state of the step segment buffer to execute the special parking motion.
 void Stepper::parking_setup_buffer() {
+    PrepLock lock;
+
     // Store step execution data of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         prep.last_st_block_index  = prep.st_block_index;
@@ -351,6 +1144,8 @@ void Stepper::parking_setup_buffer() {
 
 // Restores the step segment buffer to the normal run state after a parking motion.
 void Stepper::parking_restore_buffer() {
+    PrepLock lock;
+
     // Restore step execution data and flags of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         st_prep_block                          = &st_block_buffer[prep.last_st_block_index];
@@ -368,12 +1163,381 @@ void Stepper::parking_restore_buffer() {
     pl_block = NULL;  // Set to reload next block.
 }
 
+/* S-curve ramps replace the constant acceleration of the trapezoid ramps with a velocity that
+   follows v = v0 + (v1 - v0) * (10u^3 - 15u^4 + 6u^5), u = t / T, which has zero acceleration
+   and zero jerk at both ends of the ramp.  The ramp duration T is the same as that of the
+   constant-acceleration ramp it replaces, so the ramp covers exactly the same distance and the
+   planner's block timing is unchanged.  The average acceleration is the planner acceleration;
+   the peak, in the middle of the ramp, is 1.875 times higher.
+
+   Input-shaped ramps instead convolve a constant-acceleration pulse of width W with the impulses
+   of the block shaper, which combines the shapers of the axes that move in the block.  The
+   velocity change is then made as a staircase of accelerations that excites no vibration at the
+   shaper frequencies.  W is the duration of the planned ramp, so the peak acceleration is at most
+   the planner acceleration, and the ramp lasts longer by the shaper duration.  The extra distance
+   that it covers is taken from the cruise of the block, moving the end of the acceleration ramp
+   and the start of the deceleration ramp; a ramp with no cruise to take it from, such as those
+   of a triangle profile or a feed hold, is left unshaped.  Within a block every axis moves in
+   proportion to the path, so shaping the path speed is the same as shaping each axis; the speed
+   change at a junction between blocks is not shaped.
+*/
+static InputShaper block_shaper;  // Shaper of the block being prepped
+
+static const InputShaper* ramp_shaper;  // Shaper of the current ramp, nullptr for an S-curve
+
+// Combines the shapers of the axes that move in the block being prepped
+static void shaper_begin_block() {
+    block_shaper.reset();
+    auto axes = config->_axes;
+    for (size_t axis = 0; axis < axes->numberAxis(); axis++) {
+        auto a = axes->_axis[axis];
+        if (a->_shaper == InputShaper::NONE || pl_block->steps[axis] == 0) {
+            continue;
+        }
+        // Axes with the same shaper need it only once
+        bool seen = false;
+        for (size_t prev = 0; prev < axis; prev++) {
+            auto p = axes->_axis[prev];
+            seen |= pl_block->steps[prev] && p->_shaper == a->_shaper && p->_shaperHz == a->_shaperHz &&
+                    p->_shaperDamping == a->_shaperDamping;
+        }
+        if (!seen) {
+            block_shaper.add(a->_shaper, a->_shaperHz, a->_shaperDamping);
+        }
+    }
+}
+
+static bool shaped_ramps() {
+    return config->_stepping->_sCurve || block_shaper.active();
+}
+
+// The distance that an input-shaped ramp from v0 to v1 covers beyond the constant-acceleration
+// ramp that the planner planned
+static float shaped_ramp_extra(float v0, float v1, float acceleration) {
+    float width    = fabsf(v1 - v0) / acceleration;
+    float duration = width + block_shaper.duration();
+    return duration * v0 + (v1 - v0) * block_shaper.distance(duration, width) - 0.5f * (v0 + v1) * width;
+}
+
+// Decides which ramps of the block being prepped are input-shaped, and moves their ends into
+// the cruise by the extra distance that they cover.  A ramp with no cruise to take it from is
+// not shaped.
+static void shaper_fit_ramps(bool cruise) {
+    prep.shape_accel = false;
+    prep.shape_decel = false;
+    if (!block_shaper.active() || !cruise) {
+        return;
+    }
+    float accel = 0.0f;
+    float decel = 0.0f;
+    if (prep.ramp_type == RAMP_ACCEL) {
+        accel = shaped_ramp_extra(prep.current_speed, prep.maximum_speed, pl_block->acceleration);
+    }
+    if (prep.maximum_speed > prep.exit_speed) {
+        decel = shaped_ramp_extra(prep.maximum_speed, prep.exit_speed, pl_block->acceleration);
+    }
+    float room = prep.accelerate_until - prep.decelerate_after;
+    if (accel + decel <= room) {
+        prep.shape_accel = prep.ramp_type == RAMP_ACCEL;
+        prep.shape_decel = prep.maximum_speed > prep.exit_speed;
+    } else if (decel <= room) {
+        prep.shape_decel = true;  // The stop is the ramp that excites the most vibration
+    } else if (accel <= room) {
+        prep.shape_accel = true;
+    }
+    if (prep.shape_accel) {
+        prep.accelerate_until -= accel;
+    }
+    if (prep.shape_decel) {
+        prep.decelerate_after += decel;
+    }
+}
+
+static void ramp_begin(float exit_speed, float acceleration, bool shape) {
+    prep.ramp_entry_speed = prep.current_speed;
+    prep.ramp_exit_speed  = exit_speed;
+    prep.ramp_duration    = fabsf(exit_speed - prep.current_speed) / acceleration;
+    prep.ramp_elapsed     = 0.0f;
+    prep.ramp_width       = 0.0f;
+    ramp_shaper           = nullptr;
+
+    if (block_shaper.active()) {
+        static const InputShaper unshaped;
+
+        if (shape) {
+            // The pulse is as wide as the planned ramp, so the peak stays within the acceleration
+            ramp_shaper        = &block_shaper;
+            prep.ramp_width    = prep.ramp_duration;
+            prep.ramp_duration = prep.ramp_width + block_shaper.duration();
+        } else if (!config->_stepping->_sCurve) {
+            ramp_shaper     = &unshaped;
+            prep.ramp_width = prep.ramp_duration;
+        }
+    }
+}
+
+// Distance traveled from the start of the current shaped ramp after time t (mm)
+static float ramp_mm(float t) {
+    float delta = prep.ramp_exit_speed - prep.ramp_entry_speed;
+    if (ramp_shaper) {
+        return t * prep.ramp_entry_speed + delta * ramp_shaper->distance(t, prep.ramp_width);
+    }
+    float u = t / prep.ramp_duration;
+    return t * prep.ramp_entry_speed + delta * prep.ramp_duration * (u * u * u * u * (2.5f + u * (-3.0f + u)));
+}
+
+// Speed after time t from the start of the current shaped ramp (mm/min)
+static float ramp_speed(float t) {
+    float delta = prep.ramp_exit_speed - prep.ramp_entry_speed;
+    if (ramp_shaper) {
+        return prep.ramp_entry_speed + delta * ramp_shaper->fraction(t, prep.ramp_width);
+    }
+    float u = t / prep.ramp_duration;
+    return prep.ramp_entry_speed + delta * (u * u * u * (10.0f + u * (-15.0f + 6.0f * u)));
+}
+
 // Increments the step segment buffer block data ring buffer.
 static uint8_t next_block_index(uint8_t block_index) {
     block_index++;
     return block_index == (config->_stepping->_segments - 1) ? 0 : block_index;
 }
 
+// Computes the AMASS level of a segment whose step events are timerTicks apart.  An axis whose
+// step count divides the step event count steps every so many ticks exactly, so smoothing
+// only helps when some axis does not; a single-axis move never needs it.  Every segment
+// still gets the level that fits its ISR period in 16 bits, so slow moves are not clamped
+// to a faster step rate.
+static int amass_level(uint32_t timerTicks) {
+    uint32_t sec    = st_prep_block->step_event_count;
+    bool     uneven = false;
+    for (size_t axis = 0; axis < config->_axes->numberAxis(); axis++) {
+        uint32_t steps = st_prep_block->steps[axis];
+        if (steps && sec % steps) {
+            uneven = true;
+            break;
+        }
+    }
+    int level = 0;
+    while (level < maxAmassLevel &&
+           (timerTicks > 0xffff || (uneven && timerTicks >= amassThreshold && (timerTicks >> 1) >= amassMinTicks))) {
+        timerTicks >>= 1;
+        level++;
+    }
+    return level;
+}
+
+// Sets the raster line of the stepper block being prepped.  The line that the block had
+// last time round the buffer is done with, since the ISR executes the blocks in order.
+static void prep_raster(uint8_t slot) {
+    if (st_prep_block->raster) {
+        Raster::release(st_prep_block->raster);
+    }
+    st_prep_block->raster = slot;
+    if (slot) {
+        uint32_t length           = Raster::line(slot).length;
+        st_prep_block->raster_off = spindle->mapSpeed(0);
+        st_prep_block->pixel_span = st_prep_block->step_event_count / length;
+        st_prep_block->pixel_rem  = st_prep_block->step_event_count % length;
+    }
+}
+
+// Prepares the Bresenham data for the chord of an arc or kinematic line block that ends
+// mm_remaining from the end of the block.  Each chord gets its own stepper block, since its
+// directions and step ratios differ from those of its neighbors.  Returns the largest axis
+// step count of the chord.
+// Notes a move on an axis, adding the lash to be taken up if it reverses the axis
+static void backlash_direction(size_t axis, bool negative) {
+    if (bitnum_is_true(lash.known, axis) && bitnum_is_true(lash.negative, axis) != negative) {
+        auto    a     = config->_axes->_axis[axis];
+        int32_t steps = lroundf(a->_backlash * a->_stepsPerMm);
+        lash.target[axis] += negative ? -steps : steps;
+    }
+    set_bitnum(lash.known, axis);
+    if (negative) {
+        set_bitnum(lash.negative, axis);
+    } else {
+        clear_bitnum(lash.negative, axis);
+    }
+}
+
+static bool backlash_due() {
+    auto n_axis = config->_axes->numberAxis();
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (lash.target[axis] != lash.prepped[axis]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Adds the take-up for a segment of dt minutes to the signed steps of each axis in it,
+// and records it in the stepper block of the segment
+static void backlash_take(int32_t* delta, float dt) {
+    auto axes               = config->_axes;
+    auto n_axis             = axes->numberAxis();
+    st_prep_block->backlash = false;
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        int32_t due  = lash.target[axis] - lash.prepped[axis];
+        int32_t take = 0;
+        if (due) {
+            auto    a    = axes->_axis[axis];
+            int32_t most = std::max(int32_t(a->_backlashRate * a->_stepsPerMm * dt), int32_t(1));
+            take         = std::clamp(due, -most, most);
+            delta[axis] += take;
+            lash.prepped[axis] += take;
+            st_prep_block->backlash = true;
+        }
+        st_prep_block->backlash_steps[axis] = take;
+    }
+}
+
+// Fills the rate_power table of a block, from no power at standstill to the power of its S
+// word at the programmed rate, through the speed map of the laser.  The ISR then takes the
+// power from the speed that each tick's steps actually run at, where the segment power here
+// is that of the speed at the end of the segment.
+static void prep_rate_power() {
+    for (uint32_t i = 0; i <= rateLutParts; i++) {
+        st_prep_block->rate_lut[i] = spindle->mapSpeed(pl_block->spindle_speed * i / rateLutParts);
+    }
+    st_prep_block->rate_inv = uint32_t(rateLutParts * 65536.0f / pl_block->programmed_rate);
+}
+
+// Moves on to a new stepper block for the next segment, except for the first segment of a
+// block, which uses the one loaded with the block
+static void next_segment_block() {
+    if (prep.first_chord) {
+        prep.first_chord = false;
+    } else {
+        auto previous                       = st_prep_block;
+        prep.st_block_index                 = next_block_index(prep.st_block_index);
+        st_prep_block                       = &st_block_buffer[prep.st_block_index];
+        st_prep_block->is_pwm_rate_adjusted = previous->is_pwm_rate_adjusted;
+        st_prep_block->rate_inv             = previous->rate_inv;
+        for (uint32_t i = 0; i <= rateLutParts; i++) {
+            st_prep_block->rate_lut[i] = previous->rate_lut[i];
+        }
+        st_prep_block->backlash = false;
+        prep_raster(0);
+    }
+}
+
+// Sets the steps and directions of the stepper block from the signed steps of each axis.
+// Returns the most steps on any axis.
+static uint32_t segment_block_steps(int32_t* delta) {
+    auto     n_axis               = config->_axes->numberAxis();
+    uint32_t most                 = 0;
+    st_prep_block->direction_bits = 0;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        uint32_t steps = labs(delta[idx]);
+        if (delta[idx] < 0) {
+            set_bitnum(st_prep_block->direction_bits, idx);
+        }
+        st_prep_block->steps[idx] = steps << maxAmassLevel;
+        most                      = MAX(most, steps);
+    }
+    return most;
+}
+
+// The steps of a line block from its start to where events_left step events remain.  The
+// dominant axis is exact, and every axis is exact at the end, so the rest of the block fits
+// one stepper block whatever is split off before it.
+static uint32_t line_steps_done(size_t axis, uint32_t events_left) {
+    uint32_t events = pl_block->step_event_count;
+    return (uint64_t(pl_block->steps[axis]) * (events - events_left) + events / 2) / events;
+}
+
+// Splits the next segment of a line block, up to where events_left step events remain, into
+// a stepper block of its own with the take-up added.  Returns its most steps on any axis.
+static uint32_t prep_line_split(uint32_t events_left, float dt) {
+    next_segment_block();
+
+    auto    n_axis = config->_axes->numberAxis();
+    int32_t delta[MAX_N_AXIS];
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        uint32_t done       = line_steps_done(idx, events_left);
+        int32_t  steps      = done - prep.line_done[idx];
+        delta[idx]          = bitnum_is_true(pl_block->direction_bits, idx) ? -steps : steps;
+        prep.line_done[idx] = done;
+    }
+    backlash_take(delta, dt);
+    return segment_block_steps(delta);
+}
+
+// Gives the rest of a split line block, events_left step events from its end, one stepper
+// block, once the take-up is done
+static void prep_line_rest(uint32_t events_left) {
+    prep.line_split = false;
+    next_segment_block();
+
+    auto n_axis = config->_axes->numberAxis();
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        st_prep_block->steps[idx] = (pl_block->steps[idx] - prep.line_done[idx]) << maxAmassLevel;
+    }
+    st_prep_block->direction_bits   = pl_block->direction_bits;
+    st_prep_block->step_event_count = events_left << maxAmassLevel;
+}
+
+static uint32_t prep_chord(float mm_remaining, float dt) {
+    next_segment_block();
+
+    auto    n_axis = config->_axes->numberAxis();
+    int32_t target_steps[MAX_N_AXIS];
+    if (mm_remaining == 0.0) {
+        // End exactly at the planned target, which is where the next block starts.
+        const int32_t* start_steps = pl_block->is_arc ? pl_block->arc.start_steps : pl_block->kinematic.start_steps;
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            int32_t steps     = pl_block->steps[idx];
+            target_steps[idx] = start_steps[idx] + (bitnum_is_true(pl_block->direction_bits, idx) ? -steps : steps);
+        }
+    } else if (pl_block->is_arc) {
+        const plan_arc_t& arc = pl_block->arc;
+
+        float fraction = 1.0f - mm_remaining / arc.length;
+        float angle    = arc.start_angle + fraction * arc.angular_travel;
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            target_steps[idx] = arc.start_steps[idx] + mpos_to_steps(fraction * arc.delta[idx], idx);
+        }
+        target_steps[arc.axis_0] = mpos_to_steps(arc.center[0] + arc.radius * cosf(angle), arc.axis_0);
+        target_steps[arc.axis_1] = mpos_to_steps(arc.center[1] + arc.radius * sinf(angle), arc.axis_1);
+    } else {
+        const plan_kinematic_t& kin = pl_block->kinematic;
+
+        float fraction = 1.0f - mm_remaining / kin.length;
+        float cartesian[MAX_N_AXIS], motors[MAX_N_AXIS];
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            cartesian[idx] = kin.start[idx] + fraction * kin.delta[idx];
+        }
+        copyAxes(motors, cartesian);  // For the axes that the kinematics do not convert
+        if (config->_kinematics->transform_cartesian_to_motors(motors, cartesian)) {
+            for (size_t idx = 0; idx < n_axis; idx++) {
+                target_steps[idx] = mpos_to_steps(motors[idx], idx);
+            }
+        } else {
+            // The planner checked points along the line, so this is a sliver between them.
+            // The motors wait here and catch up with the next chord.
+            copyAxes(target_steps, prep.chord_steps);
+        }
+    }
+
+    int32_t delta[MAX_N_AXIS];
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        delta[idx] = target_steps[idx] - prep.chord_steps[idx];
+    }
+    copyAxes(prep.chord_steps, target_steps);
+
+    // The axes of an arc or a kinematic line can reverse within it, so the directions are
+    // followed chord by chord
+    if (backlashOn && !sys.step_control.executeSysMotion) {
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            if (delta[idx]) {
+                backlash_direction(idx, delta[idx] < 0);
+            }
+        }
+        backlash_take(delta, dt);
+    }
+    return segment_block_steps(delta);
+}
+
 /* Prepares step segment buffer. Continuously called from main program.
 
    The segment buffer is an intermediary buffer interface between the execution of steps
@@ -387,13 +1551,128 @@ static uint8_t next_block_index(uint8_t block_index) {
    Currently, the segment buffer conservatively holds roughly up to 40-50 msec of steps.
    NOTE: Computation units are in steps, millimeters, and minutes.
 */
+// Spindle-synchronized blocks (G33, G95) were planned at the programmed spindle speed.
+// Stretching or shrinking each segment's step timing by programmed/measured speed
+// keeps the distance per revolution while the spindle sags under load or follows an
+// override.  The scale is limited so that a sensor dropout cannot run the axes much
+// past their planned rates or stall them outright.
+static float spindle_sync_scale(plan_block_t* pl_block) {
+    const float maxSpeedup  = 1.25f;
+    const float maxSlowdown = 4.0f;
+
+    int32_t actual = spindle->actualSpeed();
+    if (actual < 0 || pl_block->spindle_speed == 0) {
+        return 1.0f;
+    }
+    float scale = float(pl_block->spindle_speed) / std::max(actual, int32_t(1));
+    return std::clamp(scale, 1.0f / maxSpeedup, maxSlowdown);
+}
+
+// Sends a segment to a sync link follower, with its stepper block if the segment starts one
+static void link_segment(const volatile segment_t* segment) {
+    Stepper::LinkBlock block;
+    bool               newBlock = segment->st_block_index != linkBlockIndex;
+    if (newBlock) {
+        auto from = &st_block_buffer[segment->st_block_index];
+        for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+            block.steps[axis]          = from->steps[axis];
+            block.backlash_steps[axis] = from->backlash_steps[axis];
+        }
+        block.step_event_count = from->step_event_count;
+        block.direction_bits   = from->direction_bits;
+        block.backlash         = from->backlash;
+        linkBlockIndex         = segment->st_block_index;
+    }
+    Stepper::LinkSegment link;
+    link.n_step       = segment->n_step;
+    link.isrPeriod    = segment->isrPeriod;
+    link.amass_level  = segment->amass_level;
+    link.accelerating = segment->accelerating;
+    link.running      = awake;
+    SyncLink::segment(newBlock ? &block : nullptr, link);
+}
+
+// Hands a prepped segment to the stepper ISR, and to a sync link follower
+static void publish_segment(volatile segment_t* segment) {
+    segment->linkPeriod = segment->isrPeriod;
+    segments.push();
+    if (SyncLink::coordinating()) {
+        link_segment(segment);
+    }
+}
+
+// A dwell block gets a stepper block without steps, so the ISR runs its segments as
+// ticks that step no axis.  A dwell that a hold or a replan interrupted goes on with
+// the time it had left, in pl_block->dwell_ms.
+static void begin_dwell() {
+    prep.st_block_index = next_block_index(prep.st_block_index);
+    st_prep_block       = &st_block_buffer[prep.st_block_index];
+
+    st_prep_block->direction_bits = pl_block->direction_bits;
+    for (size_t idx = 0; idx < MAX_N_AXIS; idx++) {
+        st_prep_block->steps[idx] = 0;
+    }
+    st_prep_block->step_event_count     = 0;
+    st_prep_block->backlash             = false;
+    st_prep_block->is_pwm_rate_adjusted = false;
+    st_prep_block->rate_inv             = 0;
+    prep_raster(0);
+    prep.current_speed = 0.0f;
+}
+
+// Queues a segment of the dwell block, of one ISR tick per ms, up to the segment time.
+// Returns false if a hold stops the dwell here instead.
+static bool prep_dwell() {
+    if (sys.step_control.executeHold) {
+        sys.step_control.endMotion = true;
+        if (!(prep.recalculate_flag.parking)) {
+            prep.recalculate_flag.holdPartialBlock = 1;
+        }
+        return false;
+    }
+    // Lasers are off while nothing moves, as at the end of a move, unless they have constant power
+    bool         laserOff = spindle->isRateAdjusted() && pl_block->spindle == SpindleState::Ccw;
+    SpindleSpeed speed    = pl_block->spindle == SpindleState::Disable || laserOff ? 0 : pl_block->spindle_speed;
+    uint32_t     ms       = std::min(pl_block->dwell_ms, std::max(uint32_t(dt_segment * 60000.0f), uint32_t(1)));
+
+    volatile segment_t* prep_segment = segments.back();
+    prep_segment->st_block_index     = prep.st_block_index;
+    prep_segment->n_step             = ms;
+    prep_segment->isrPeriod          = Machine::Stepping::fStepperTimer / 1000;
+    prep_segment->amass_level        = 0;
+    prep_segment->spindle_speed      = speed;
+    prep_segment->spindle_dev_speed  = spindle->mapSpeed(speed);
+    prep_segment->spindle_dev_step   = 0;
+    prep_segment->power_ticks        = 0;
+    prep_segment->power_updates      = 0;
+    prep_segment->accelerating       = false;
+    prep_segment->speed              = 0;
+    prep_segment->cap_rate           = 0;
+    publish_segment(prep_segment);
+    if (MotionTrace::enabled) {
+        MotionTrace::record(MotionTrace::PrepSegment, segments.size());
+    }
+
+    pl_block->dwell_ms -= ms;
+    if (!pl_block->dwell_ms) {
+        pl_block = NULL;
+        plan_discard_current_block();
+    }
+    return true;
+}
+
 void Stepper::prep_buffer() {
+    PrepLock            lock;
+    MotionBench::Timing timing(MotionBench::Prep);
+    soft_wdt_feed(SoftWdtPrep);
+
     // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
-    if (sys.step_control.endMotion) {
+    // A sync link follower queues the coordinator's segments instead.
+    if (sys.step_control.endMotion || SyncLink::following()) {
         return;
     }
 
-    while (segment_buffer_tail != segment_next_head) {  // Check if we need to fill the buffer.
+    while (!segments.full()) {  // Check if we need to fill the buffer.
         // Determine if we need to load a new planner block or if the block needs to be recomputed.
         if (pl_block == NULL) {
             // Query planner for a queued block
@@ -414,6 +1693,8 @@ void Stepper::prep_buffer() {
                 } else {
                     prep.recalculate_flag = {};
                 }
+            } else if (pl_block->motion.dwell) {
+                begin_dwell();
             } else {
                 // Load the Bresenham stepping data for the block.
                 prep.st_block_index = next_block_index(prep.st_block_index);
@@ -423,7 +1704,7 @@ void Stepper::prep_buffer() {
                 st_prep_block                 = &st_block_buffer[prep.st_block_index];
                 st_prep_block->direction_bits = pl_block->direction_bits;
                 uint8_t idx;
-                auto    n_axis = config->_axes->_numberAxis;
+                auto    n_axis = config->_axes->numberAxis();
 
                 // Bit-shift multiply all Bresenham data by the max AMASS level so that
                 // we never divide beyond the original data anywhere in the algorithm.
@@ -432,12 +1713,34 @@ void Stepper::prep_buffer() {
                     st_prep_block->steps[idx] = pl_block->steps[idx] << maxAmassLevel;
                 }
                 st_prep_block->step_event_count = pl_block->step_event_count << maxAmassLevel;
+                st_prep_block->backlash         = false;
+                prep_raster(pl_block->raster);
 
                 // Initialize segment buffer data for generating the segments.
                 prep.steps_remaining  = (float)pl_block->step_event_count;
                 prep.step_per_mm      = prep.steps_remaining / pl_block->millimeters;
                 prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR / prep.step_per_mm;
                 prep.dt_remainder     = 0.0;  // Reset for new segment block
+                if (pl_block->is_arc) {
+                    copyAxes(prep.chord_steps, pl_block->arc.start_steps);
+                    prep.first_chord = true;
+                } else if (pl_block->is_kinematic) {
+                    copyAxes(prep.chord_steps, pl_block->kinematic.start_steps);
+                    prep.first_chord = true;
+                } else if (backlashOn && !sys.step_control.executeSysMotion) {
+                    // A raster line keeps its one stepper block, and the take-up waits for the next block
+                    for (idx = 0; idx < n_axis; idx++) {
+                        if (pl_block->steps[idx]) {
+                            backlash_direction(idx, bitnum_is_true(pl_block->direction_bits, idx));
+                        }
+                    }
+                    prep.line_split = !pl_block->raster && backlash_due();
+                    if (prep.line_split) {
+                        memset(prep.line_done, 0, sizeof(prep.line_done));
+                        prep.first_chord = true;
+                    }
+                }
+                shaper_begin_block();
                 if ((sys.step_control.executeHold) || prep.recalculate_flag.decelOverride) {
                     // New block loaded mid-hold. Override planner block entry speed to enforce deceleration.
                     prep.current_speed                  = prep.exit_speed;
@@ -449,12 +1752,16 @@ void Stepper::prep_buffer() {
 
                 // prep.inv_rate is only used if is_pwm_rate_adjusted is true
                 st_prep_block->is_pwm_rate_adjusted = false;  // set default value
+                st_prep_block->rate_inv             = 0;
 
                 if (spindle->isRateAdjusted()) {
                     if (pl_block->spindle == SpindleState::Ccw) {
                         // Pre-compute inverse programmed rate to speed up PWM updating per step segment.
                         prep.inv_rate                       = 1.0f / pl_block->programmed_rate;
                         st_prep_block->is_pwm_rate_adjusted = true;
+                        if (spindle->ratePower() && pl_block->programmed_rate > 0.0f) {
+                            prep_rate_power();
+                        }
                     }
                 }
             }
@@ -466,6 +1773,7 @@ void Stepper::prep_buffer() {
             */
             prep.mm_complete  = 0.0;  // Default velocity profile complete at 0.0mm from end of block.
             float inv_2_accel = 0.5f / pl_block->acceleration;
+            bool  cruise      = false;  // The profile has a cruise, which shaped ramps can lengthen into
             if (sys.step_control.executeHold) {  // [Forced Deceleration to Zero Velocity]
                 // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
                 // the planner block profile, enforcing a deceleration to zero speed.
@@ -486,7 +1794,9 @@ void Stepper::prep_buffer() {
                 float exit_speed_sqr;
                 float nominal_speed;
                 if (sys.step_control.executeSysMotion) {
-                    prep.exit_speed = exit_speed_sqr = 0.0;  // Enforce stop at end of system motion.
+                    // Enforce stop at end of system motion, unless another parking move follows
+                    exit_speed_sqr  = plan_get_system_exit_speed_sqr();
+                    prep.exit_speed = sqrtf(exit_speed_sqr);
                 } else {
                     exit_speed_sqr  = plan_get_exec_block_exit_speed_sqr();
                     prep.exit_speed = sqrtf(exit_speed_sqr);
@@ -512,6 +1822,7 @@ void Stepper::prep_buffer() {
                         prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
                         prep.maximum_speed    = nominal_speed;
                         prep.ramp_type        = RAMP_DECEL_OVERRIDE;
+                        cruise                = true;
                     }
                 } else if (intersect_distance > 0.0) {
                     if (intersect_distance < pl_block->millimeters) {  // Either trapezoid or triangle types
@@ -519,6 +1830,7 @@ void Stepper::prep_buffer() {
                         prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
                         if (prep.decelerate_after < intersect_distance) {  // Trapezoid type
                             prep.maximum_speed = nominal_speed;
+                            cruise             = true;
                             if (pl_block->entry_speed_sqr == nominal_speed_sqr) {
                                 // Cruise-deceleration or cruise-only type.
                                 prep.ramp_type = RAMP_CRUISE;
@@ -543,30 +1855,51 @@ void Stepper::prep_buffer() {
                 }
             }
 
+            if (shaped_ramps()) {
+                shaper_fit_ramps(cruise);
+                if (prep.ramp_type == RAMP_ACCEL) {
+                    ramp_begin(prep.maximum_speed, pl_block->acceleration, prep.shape_accel);
+                } else if (prep.ramp_type == RAMP_DECEL) {
+                    ramp_begin(prep.exit_speed, pl_block->acceleration, prep.shape_decel);
+                }
+            }
+
             sys.step_control.updateSpindleSpeed = true;  // Force update whenever updating block.
         }
 
+        if (pl_block->motion.dwell) {
+            if (!prep_dwell()) {
+                return;
+            }
+            continue;
+        }
+
         // Initialize new segment
-        volatile segment_t* prep_segment = &segment_buffer[segment_buffer_head];
+        volatile segment_t* prep_segment = segments.back();
 
         // Set new segment to point to the current segment data block.
         prep_segment->st_block_index = prep.st_block_index;
 
         /*------------------------------------------------------------------------------------
             Compute the average velocity of this new segment by determining the total distance
-          traveled over the segment time DT_SEGMENT. The following code first attempts to create
+          traveled over the segment time dt_segment. The following code first attempts to create
           a full segment based on the current ramp conditions. If the segment time is incomplete
           when terminating at a ramp state change, the code will continue to loop through the
           progressing ramp states to fill the remaining segment execution time. However, if
           an incomplete segment terminates at the end of the velocity profile, the segment is
-          considered completed despite having a truncated execution time less than DT_SEGMENT.
+          considered completed despite having a truncated execution time less than dt_segment.
+            Segments that start in the cruising state use the longer dt_cruise_segment, since the
+          velocity does not change. Such a segment ends at the start of the deceleration ramp, so
+          the ramp itself is still traced at the dt_segment resolution.
             The velocity profile is always assumed to progress through the ramp sequence:
           acceleration ramp, cruising state, and deceleration ramp. Each ramp's travel distance
           may range from zero to the length of the block. Velocity profiles can end either at
           the end of planner block (typical) or mid-block at the end of a forced deceleration,
           such as from a feed hold.
         */
-        float dt_max   = DT_SEGMENT;                                // Maximum segment time
+        float entry_speed = prep.current_speed;  // Speed at the start of the segment
+
+        float dt_max   = dt_segment;                                // Maximum segment time
         float dt       = 0.0;                                       // Initialize segment time
         float time_var = dt_max;                                    // Time worker variable
         float mm_var;                                               // mm-Distance worker variable
@@ -577,6 +1910,13 @@ void Stepper::prep_buffer() {
         if (minimum_mm < 0.0) {
             minimum_mm = 0.0;
         }
+        if (prep.ramp_type == RAMP_CRUISE) {
+            // The velocity is constant, so a longer segment loses nothing.
+            dt_max   = dt_cruise_segment;
+            time_var = dt_max;
+        }
+
+        bool shaped = shaped_ramps();
 
         do {
             switch (prep.ramp_type) {
@@ -596,20 +1936,40 @@ void Stepper::prep_buffer() {
                     break;
                 case RAMP_ACCEL:
                     // NOTE: Acceleration ramp only computes during first do-while loop.
-                    speed_var = pl_block->acceleration * time_var;
-                    mm_remaining -= time_var * (prep.current_speed + 0.5f * speed_var);
-                    if (mm_remaining < prep.accelerate_until) {  // End of acceleration ramp.
-                        // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+                    if (shaped) {
+                        speed_var = prep.ramp_elapsed + time_var;  // Used as ramp time at end of segment (min)
+                        if (speed_var < prep.ramp_duration) {
+                            mm_var = mm_remaining - (ramp_mm(speed_var) - ramp_mm(prep.ramp_elapsed));
+                            if (mm_var > prep.accelerate_until) {  // Acceleration only.
+                                mm_remaining       = mm_var;
+                                prep.ramp_elapsed  = speed_var;
+                                prep.current_speed = ramp_speed(speed_var);
+                                break;
+                            }
+                        }
+                        // End of acceleration ramp.
+                        time_var     = prep.ramp_duration - prep.ramp_elapsed;
+                        mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
+                    } else {
+                        speed_var = pl_block->acceleration * time_var;
+                        mm_remaining -= time_var * (prep.current_speed + 0.5f * speed_var);
+                        if (mm_remaining >= prep.accelerate_until) {  // Acceleration only.
+                            prep.current_speed += speed_var;
+                            break;
+                        }
+                        // End of acceleration ramp.
                         mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
                         time_var     = 2.0f * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
-                        if (mm_remaining == prep.decelerate_after) {
-                            prep.ramp_type = RAMP_DECEL;
-                        } else {
-                            prep.ramp_type = RAMP_CRUISE;
+                    }
+                    // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+                    prep.current_speed = prep.maximum_speed;
+                    if (mm_remaining == prep.decelerate_after) {
+                        prep.ramp_type = RAMP_DECEL;
+                        if (shaped) {
+                            ramp_begin(prep.exit_speed, pl_block->acceleration, prep.shape_decel);
                         }
-                        prep.current_speed = prep.maximum_speed;
-                    } else {  // Acceleration only.
-                        prep.current_speed += speed_var;
+                    } else {
+                        prep.ramp_type = RAMP_CRUISE;
                     }
                     break;
                 case RAMP_CRUISE:
@@ -622,20 +1982,39 @@ void Stepper::prep_buffer() {
                         time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
                         mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
                         prep.ramp_type = RAMP_DECEL;
+                        if (dt_max > dt_segment) {
+                            dt_max = dt + time_var;  // End a long cruise segment where the ramp begins
+                        }
+                        if (shaped) {
+                            ramp_begin(prep.exit_speed, pl_block->acceleration, prep.shape_decel);
+                        }
                     } else {  // Cruising only.
                         mm_remaining = mm_var;
                     }
                     break;
                 default:  // case RAMP_DECEL:
                     // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
-                    speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
-                    if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
-                        // Compute distance from end of segment to end of block.
-                        mm_var = mm_remaining - time_var * (prep.current_speed - 0.5f * speed_var);  // (mm)
-                        if (mm_var > prep.mm_complete) {                                             // Typical case. In deceleration ramp.
-                            mm_remaining = mm_var;
-                            prep.current_speed -= speed_var;
-                            break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
+                    if (shaped) {
+                        speed_var = prep.ramp_elapsed + time_var;  // Used as ramp time at end of segment (min)
+                        if (speed_var < prep.ramp_duration) {
+                            mm_var = mm_remaining - (ramp_mm(speed_var) - ramp_mm(prep.ramp_elapsed));  // (mm)
+                            if (mm_var > prep.mm_complete) {  // Typical case. In deceleration ramp.
+                                mm_remaining       = mm_var;
+                                prep.ramp_elapsed  = speed_var;
+                                prep.current_speed = ramp_speed(speed_var);
+                                break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
+                            }
+                        }
+                    } else {
+                        speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
+                        if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
+                            // Compute distance from end of segment to end of block.
+                            mm_var = mm_remaining - time_var * (prep.current_speed - 0.5f * speed_var);  // (mm)
+                            if (mm_var > prep.mm_complete) {  // Typical case. In deceleration ramp.
+                                mm_remaining = mm_var;
+                                prep.current_speed -= speed_var;
+                                break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
+                            }
                         }
                     }
                     // Otherwise, at end of block or end of forced-deceleration.
@@ -651,7 +2030,7 @@ void Stepper::prep_buffer() {
                 if (mm_remaining > minimum_mm) {  // Check for very slow segments with zero steps.
                     // Increase segment time to ensure at least one step in segment. Override and loop
                     // through distance calculations until minimum_mm or mm_complete.
-                    dt_max += DT_SEGMENT;
+                    dt_max += dt_segment;
                     time_var = dt_max - dt;
                 } else {
                     break;  // **Complete** Exit loop. Segment execution time maxed.
@@ -683,6 +2062,29 @@ void Stepper::prep_buffer() {
         }
         prep_segment->spindle_speed     = prep.current_spindle_speed;
         prep_segment->spindle_dev_speed = spindle->mapSpeed(prep.current_spindle_speed);  // Reload segment PWM value
+        prep_segment->power_updates     = 0;
+        prep_segment->accelerating      = prep.current_speed > entry_speed;
+
+        // A laser can follow the speed within the segment, instead of taking the speed at its end.
+        // The power is scheduled at the middle of equal parts of the segment, shifted by the lead
+        // time of the laser, from the speed interpolated between the ends of the segment.
+        uint32_t power_parts = 1;
+        if (st_prep_block->is_pwm_rate_adjusted && pl_block->spindle != SpindleState::Disable && !st_prep_block->raster &&
+            !st_prep_block->rate_inv) {
+            power_parts = spindle->powerUpdates();
+        }
+        if (power_parts > 1 && dt > 0.0f) {
+            float lead    = spindle->powerLeadUsecs() / 60e6f;
+            float slope   = (prep.current_speed - entry_speed) / dt;
+            auto  powerAt = [&](uint32_t part) {
+                float speed = entry_speed + slope * ((part + 0.5f) * dt / power_parts + lead);
+                return spindle->mapSpeed(pl_block->spindle_speed * fmaxf(speed, 0.0f) * prep.inv_rate);
+            };
+            uint32_t first                  = powerAt(0);
+            prep_segment->spindle_dev_speed = first;
+            prep_segment->spindle_dev_step  = (int32_t(powerAt(power_parts - 1)) - int32_t(first)) / int32_t(power_parts - 1);
+            prep_segment->power_updates     = power_parts - 1;
+        }
 
         /* -----------------------------------------------------------------------------------
            Compute segment step rate, steps to execute, and apply necessary rate corrections.
@@ -728,26 +2130,62 @@ void Stepper::prep_buffer() {
         // Compute CPU cycles per step for the prepped segment.
         // fStepperTimer is in units of timerTicks/sec, so the dimensional analysis is
         // timerTicks/sec * 60 sec/minute * minutes = timerTicks
-        uint32_t timerTicks = uint32_t(ceilf((Machine::Stepping::fStepperTimer * 60) * inv_rate));  // (timerTicks/step)
-        int      level;
-
-        // Compute step timing and multi-axis smoothing level.
-        for (level = 0; level < maxAmassLevel; level++) {
-            if (timerTicks < amassThreshold) {
-                break;
+        // Arc and kinematic line blocks count step events along the path.  The chord traced by this segment takes,
+        // on rare occasions, a step or two more than that on one axis, so the step events are
+        // stretched to fit within the segment time.  Backlash take-up can add steps in the same way.
+        float step_time = inv_rate;
+        bool  split     = prep.line_split && !sys.step_control.executeSysMotion;
+        if (split && !backlash_due()) {
+            prep_line_rest(uint32_t(last_n_steps_remaining));
+            prep_segment->st_block_index = prep.st_block_index;
+            split                        = false;
+        }
+        if (pl_block->is_arc || pl_block->is_kinematic || split) {
+            uint32_t chord_steps = split ? prep_line_split(uint32_t(n_steps_remaining), dt) : prep_chord(mm_remaining, dt);
+            if (chord_steps > prep_segment->n_step) {
+                if (prep_segment->n_step) {
+                    step_time *= float(prep_segment->n_step) / chord_steps;
+                }
+                prep_segment->n_step = chord_steps;
             }
-            timerTicks >>= 1;
+            st_prep_block->step_event_count = prep_segment->n_step << maxAmassLevel;
+            prep_segment->st_block_index    = prep.st_block_index;
         }
+
+        if (pl_block->motion.spindleSync && !pl_block->motion.rapidMotion) {
+            step_time *= spindle_sync_scale(pl_block);
+        }
+
+        uint32_t timerTicks = uint32_t(ceilf((Machine::Stepping::fStepperTimer * 60) * step_time));  // (timerTicks/step)
+
+        // Compute step timing and multi-axis smoothing level.
+        int level = amass_level(timerTicks);
+        timerTicks >>= level;
         prep_segment->amass_level = level;
         prep_segment->n_step <<= level;
-        // isrPeriod is stored as 16 bits, so limit timerTicks to the
-        // largest value that will fit in a uint16_t.
+        if (prep_segment->power_updates) {
+            prep_segment->power_ticks = prep_segment->n_step / (prep_segment->power_updates + 1);
+            if (prep_segment->power_ticks == 0) {
+                prep_segment->power_updates = 0;  // Too few ticks to divide
+            }
+        }
+        // isrPeriod is stored as 16 bits.  amass_level() has made timerTicks fit unless the
+        // step rate is below fStepperTimer / (0xffff << maxAmassLevel), about 5 steps/sec.
         prep_segment->isrPeriod = timerTicks > 0xffff ? 0xffff : timerTicks;
 
-        // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
-        auto lastseg        = segment_next_head;
-        segment_next_head   = segment_next_head >= (config->_stepping->_segments - 1) ? 0 : segment_next_head + 1;
-        segment_buffer_head = lastseg;
+        // The speed that the segment runs at, and the acceleration to stop from it, for fast holds
+        float ticks_per_mm     = float(std::max<uint32_t>(prep_segment->isrPeriod, 1) << level) * prep.step_per_mm;
+        prep_segment->speed    = uint32_t((Machine::Stepping::fStepperTimer * 60 * 256.0f) / ticks_per_mm);
+        prep_segment->cap_rate = uint32_t(pl_block->acceleration * capRateScale);
+
+        // Segment complete! Publish it, so stepper ISR can immediately execute it.
+        publish_segment(prep_segment);
+        if (MotionTrace::enabled) {
+            MotionTrace::record(MotionTrace::PrepSegment, segments.size());
+        }
+        if (MotionBench::active) {
+            MotionBench::segments++;
+        }
 
         // Update the appropriate planner and segment data.
         pl_block->millimeters = mm_remaining;
@@ -768,8 +2206,12 @@ void Stepper::prep_buffer() {
             } else {     // End of planner block
                 // The planner block is complete. All steps are set to be executed in the segment buffer.
                 if (sys.step_control.executeSysMotion) {
-                    sys.step_control.endMotion = true;
-                    return;
+                    if (!plan_next_park_block()) {
+                        sys.step_control.endMotion = true;
+                        return;
+                    }
+                    pl_block = NULL;  // Load the next parking move
+                    continue;
                 }
                 pl_block = NULL;  // Set pointer to indicate check and load next planner block.
                 plan_discard_current_block();
@@ -782,6 +2224,58 @@ void Stepper::prep_buffer() {
 // however is not exactly the current speed, but the speed computed in the last step segment
 // in the segment buffer. It will always be behind by up to the number of segment blocks (-1)
 // divided by the ACCELERATION TICKS PER SECOND in seconds.
+uint32_t Stepper::segments_queued() {
+    return segments.size();
+}
+
+bool Stepper::stepping() {
+    return awake;
+}
+
+// A follower has no planner, so prep.st_block_index only tracks the stepper block that the
+// coordinator's segments go into.  As in prep_buffer(), a new block needs a free slot in the
+// segment buffer, so that no queued segment can still be using the stepper block it takes.
+bool Stepper::follow_block(const LinkBlock& block) {
+    if (segments.full()) {
+        return false;
+    }
+    prep.st_block_index = next_block_index(prep.st_block_index);
+    auto to             = &st_block_buffer[prep.st_block_index];
+    for (size_t axis = 0; axis < MAX_N_AXIS; axis++) {
+        to->steps[axis]          = block.steps[axis];
+        to->backlash_steps[axis] = block.backlash_steps[axis];
+    }
+    to->step_event_count     = block.step_event_count;
+    to->direction_bits       = block.direction_bits;
+    to->backlash             = block.backlash;
+    to->is_pwm_rate_adjusted = false;
+    to->raster               = 0;
+    to->rate_inv             = 0;
+    return true;
+}
+
+bool Stepper::follow_segment(const LinkSegment& segment, uint16_t period) {
+    if (segments.full()) {
+        return false;
+    }
+    volatile segment_t* to = segments.back();
+    to->st_block_index     = prep.st_block_index;
+    to->n_step             = segment.n_step;
+    to->isrPeriod          = period;
+    to->linkPeriod         = segment.isrPeriod;
+    to->amass_level        = segment.amass_level;
+    to->spindle_speed      = 0;
+    to->spindle_dev_speed  = 0;
+    to->spindle_dev_step   = 0;
+    to->power_ticks        = 0;
+    to->power_updates      = 0;
+    to->accelerating       = segment.accelerating;
+    to->speed              = 0;
+    to->cap_rate           = 0;
+    segments.push();
+    return true;
+}
+
 float Stepper::get_realtime_rate() {
     switch (sys.state) {
         case State::Cycle:
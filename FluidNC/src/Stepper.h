@@ -10,9 +10,13 @@
 */
 
 #include "EnumItem.h"
+#include "Config.h"  // MAX_N_AXIS
+#include "Types.h"   // AxisMask
 
 #include <cstdint>
 
+class Channel;
+
 namespace Stepper {
     void init();
 
@@ -27,6 +31,14 @@ namespace Stepper {
     // Stops stepping (ISR-safe)
     void stop_stepping();
 
+    // Records the probe position and cancels the probing motion.  With latched, from the
+    // probe pin interrupt, the position is interpolated between step ticks.
+    void probe_tripped(bool latched);
+
+    // Called as a feed hold starts.  With stepping/fast_hold, the step ISR brings the motion
+    // to a stop at the block acceleration, whatever is still in the segment buffer.
+    void fast_hold();
+
     // Reset the stepper subsystem variables
     void reset();
 
@@ -36,14 +48,118 @@ namespace Stepper {
     // Restores the step segment buffer to the normal run state after a parking motion.
     void parking_restore_buffer();
 
-    // Reloads step segment buffer. Called continuously by realtime execution system.
+    // Reloads step segment buffer. Called continuously by realtime execution system,
+    // and also by the step preparation task when stepping/prep_task is set.
     void prep_buffer();
 
+    // Wakes the step preparation task, if there is one, to take up a new planner block.
+    void notify_prep();
+
+    // Held while changing state that prep_buffer() uses, so that the step preparation task
+    // does not run concurrently.  Does nothing when there is no step preparation task.
+    class PrepLock {
+    public:
+        PrepLock();
+        ~PrepLock();
+    };
+
     // Called by planner_recalculate() when the executing block is updated by the new plan.
     bool update_plan_block_parameters();
 
+    // Backlash take-up steps in the segments that the ISR has loaded, by axis.  They turn the
+    // motors without moving the machine, so they are left out of the machine position.
+    extern int32_t backlash_steps[MAX_N_AXIS];
+
+    // Forgets the backlash state of an axis, when homing sets its position.
+    void reset_backlash(size_t axis);
+
+    // The segments that prep_buffer() has queued for the step ISR
+    uint32_t segments_queued();
+
+    // True while the step ISR runs
+    bool stepping();
+
+    // A stepper block and a segment as a sync link carries them, without the spindle and
+    // laser power, which stay with the coordinator.  See SyncLink.h.
+    struct __attribute__((packed)) LinkBlock {
+        uint32_t steps[MAX_N_AXIS];
+        uint32_t step_event_count;
+        AxisMask direction_bits;
+        uint8_t  backlash;
+        int32_t  backlash_steps[MAX_N_AXIS];
+    };
+
+    struct __attribute__((packed)) LinkSegment {
+        uint16_t n_step;
+        uint16_t isrPeriod;
+        uint8_t  amass_level;
+        uint8_t  accelerating;
+        uint8_t  running;  // The coordinator was stepping when it sent the segment
+    };
+
+    // On a sync link follower, queue what the coordinator sends, in place of prep_buffer().
+    // A segment runs at period ticks, its isrPeriod steered to the coordinator's clock.
+    // They return false if the segment buffer is full.
+    bool follow_block(const LinkBlock& block);
+    bool follow_segment(const LinkSegment& segment, uint16_t period);
+
     // Called by realtime status reporting if realtime rate reporting is enabled in config.h.
     float get_realtime_rate();
 
-    extern uint32_t isr_count;
+    // Called from the step ISR when the executing segment starts or stops speeding up,
+    // for motor drivers that raise the current while accelerating.  Must be ISR-safe.
+    extern void (*accel_hook)(bool accelerating);
+
+    // Called from the step ISR as each segment is loaded, for motors such as RC servos that
+    // are driven to a position instead of being stepped.  segment_target() gives the motor
+    // position, in steps, that an axis reaches at the end of the loaded segment, so the
+    // servo can be sent there as the segment starts.  Must be ISR-safe; no float math.
+    extern void (*segment_hook)();
+    int32_t segment_target(size_t axis);
+
+    // Step ISR instrumentation, reported by $Stepping/Stats.  Latency is the time from the step
+    // timer alarm to the step pulse edge; it is not measured with the I2S_STREAM engine, which
+    // does not run from the step timer.
+    const int isrLatencyBins = 8;  // Bin n counts latencies below 2^n us; the last bin counts the rest
+
+    struct IsrStats {
+        uint32_t count;                    // ISR invocations
+        uint32_t min_ticks;                // Shortest ISR, in CPU ticks
+        uint32_t max_ticks;                // Longest ISR, in CPU ticks
+        uint64_t total_ticks;              // Sum of all ISR times, in CPU ticks
+        uint32_t underruns;                // Times the segment buffer ran dry in the middle of a block
+        uint32_t latency[isrLatencyBins];  // Histogram of alarm-to-pulse latencies
+        uint32_t cache_off;                // ISR runs while the flash cache was off for a flash write
+        uint32_t cache_off_max_ticks;      // Longest of those, which stalls if anything it touches is in flash
+    };
+    extern IsrStats isr_stats;
+
+    void reset_isr_stats();
+
+    // Times the Bresenham tick of the step ISR over n_axes, which may be up to MAX_N_AXIS
+    // whatever the machine has, for n_ticks.  Returns the average CPU ticks per tick.
+    uint32_t bresenham_benchmark(size_t n_axes, uint32_t n_ticks);
+
+    // Position trace, started by $Stepping/Trace.  While it runs, the step ISR copies the
+    // motor step counts into a lock-free ring once per trace period, so the samples are
+    // never torn and cost the ISR only a time comparison in between.  Samples are taken
+    // only while the steppers run, since the position cannot change otherwise.
+    struct PositionSample {
+        uint32_t usecs;  // Since the trace started
+        int32_t  steps[MAX_N_AXIS];
+    };
+    const uint32_t maxTraceRate = 10000;  // Samples per second
+
+    void start_trace(Channel& channel, uint32_t rate);
+    void stop_trace(Channel* channel = nullptr);  // Stops only a trace to channel, if given
+    bool tracing();
+
+    // Restarts the time of the trace, when its clock changes to or from a motion bench's
+    void restart_trace();
+
+    // True if the next sample would be dropped
+    bool trace_full();
+
+    // Sends the recorded samples to the trace channel.  Called by the polling task.
+    void poll_trace();
 }
@@ -4,7 +4,6 @@
 #pragma once
 
 // Some useful constants.
-const float DT_SEGMENT              = (1.0f / (float(ACCELERATION_TICKS_PER_SECOND) * 60.0f));  // min/segment
 const float REQ_MM_INCREMENT_SCALAR = 1.25f;
 const int   RAMP_ACCEL              = 0;
 const int   RAMP_CRUISE             = 1;
@@ -18,16 +17,15 @@ struct PrepFlag {
     uint8_t decelOverride : 1;
 };
 
-// Define Adaptive Multi-Axis Step-Smoothing(AMASS) levels and cutoff frequencies. The highest level
-// frequency bin starts at 0Hz and ends at its cutoff frequency. The next lower level frequency bin
-// starts at the next higher cutoff frequency, and so on. The cutoff frequencies for each level must
-// be considered carefully against how much it over-drives the stepper ISR, the accuracy of the 16-bit
-// timer, and the CPU overhead. Level 0 (no AMASS, normal operation) frequency bin starts at the
-// Level 1 cutoff frequency and up to as fast as the CPU allows (over 30kHz in limited testing).
-// For efficient computation, each cutoff frequency is twice the previous one.
-// NOTE: AMASS cutoff frequency multiplied by ISR overdrive factor must not exceed maximum step frequency.
-// NOTE: Current settings are set to overdrive the ISR to no more than 16kHz, balancing CPU overhead
-// and timer accuracy.  Do not alter these settings unless you know what you are doing.
+// Adaptive Multi-Axis Step-Smoothing(AMASS) parameters. The level of each segment is computed
+// when it is prepared: while the ISR tick is longer than amassThreshold, and halving it stays
+// within the step rate that the stepping engine can sustain, the tick is halved and the level
+// raised, up to maxAmassLevel.  Segments in which every moving axis steps at a whole-number
+// ratio to the step events are not smoothed, since their steps are already evenly spaced,
+// and only take the level that fits their ISR period in its 16 bits.
+// NOTE: amassThreshold keeps the ISR overdrive to no more than 16kHz, balancing CPU overhead
+// and timer accuracy.  Do not alter it unless you know what you are doing.
+// NOTE: Block step counts are shifted by maxAmassLevel, so a block is limited to 2^26 steps.
 
 const uint32_t amassThreshold = Machine::Stepping::fStepperTimer / 8000;
-const int      maxAmassLevel  = 3;  // Each level increase doubles the threshold
+const int      maxAmassLevel  = 6;  // Each level increase doubles the threshold
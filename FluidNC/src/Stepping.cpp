@@ -3,8 +3,17 @@
 #include "Stepping.h"
 #include "Stepper.h"
 #include "Machine/MachineConfig.h"  // config
+#include "Motors/MotorDriver.h"        // step_counter_pin()
+#include "Driver/RmtBurst.h"
+#include "Driver/DedicGpio.h"    // dedicGpioMaxPins
+#include "Driver/delay_usecs.h"  // ticks_per_us
+#include "MotionBench.h"
+#include "Benchmark.h"  // Benchmark::result()
 
+#include <soc/soc_caps.h>
+#include <algorithm>
 #include <atomic>
+#include <string>
 
 namespace Machine {
 
@@ -14,11 +23,18 @@ namespace Machine {
                              { Stepping::RMT, "RMT" },
                              { Stepping::I2S_STATIC, "I2S_static" },
                              { Stepping::I2S_STREAM, "I2S_stream" },
+                             { Stepping::RMT_BURST, "RMT_burst" },
+                             { Stepping::DEDIC_GPIO, "Dedicated_GPIO" },
                              EnumItem(Stepping::RMT) };
 
+    EnumItem stepCheckTypes[] = { { Stepping::CHECK_OFF, "Off" },
+                                  { Stepping::CHECK_LOG, "Log" },
+                                  { Stepping::CHECK_ALARM, "Alarm" },
+                                  EnumItem(Stepping::CHECK_OFF) };
+
     void Stepping::init() {
         log_info("Stepping:" << stepTypes[_engine].name << " Pulse:" << _pulseUsecs << "us Dsbl Delay:" << _disableDelayUsecs
-                             << "us Dir Delay:" << _directionDelayUsecs << "us Idle Delay:" << _idleMsecs << "ms");
+                             << "us Dir Delay:" << _directionDelayUsecs << "us Idle Delay:" << _idleMsecs << "ms" << (_sCurve ? " S-curve" : ""));
 
         // Prepare stepping interrupt callbacks.  The one that is actually
         // used is determined by timerStart() and timerStop()
@@ -26,6 +42,12 @@ namespace Machine {
         // Setup a timer for direct stepping
         stepTimerInit(fStepperTimer, Stepper::pulse_func);
 
+        // Axes::init() clears _asyncPulse if the step pins cannot be ended this way
+        _asyncPulse = (_engine == TIMED || _engine == DEDIC_GPIO) && _pulseTimer;
+        if (_asyncPulse) {
+            pulseTimerInit(fStepperTimer, onPulseTimer);
+        }
+
         // Register pulse_func with the I2S subsystem
         // This could be done via the linker.
         //        i2s_out_set_pulse_callback(Stepper::pulse_func);
@@ -37,10 +59,31 @@ namespace Machine {
         if (_engine == I2S_STREAM) {
             i2s_out_reset();
         }
+        if (_engine == RMT_BURST) {
+            rmtBurstStop();
+        }
     }
 
     void Stepping::beginLowLatency() {
-        _switchedStepper = _engine == I2S_STREAM;
+        // Bursts are committed ahead of time, so homing and probing
+        // trigger each pulse from the step ISR instead
+        if (_engine == RMT_BURST) {
+            config->_axes->rmt_single_pulses();
+            _engine        = RMT;
+            _switchedBurst = true;
+        }
+        if (_switchedBurst) {
+            return;
+        }
+
+        // With a low-latency buffer length configured, keep streaming
+        // but with short buffers, instead of switching to I2S_STATIC
+        auto i2so        = config->i2soBus();
+        _shortenedStream = _engine == I2S_STREAM && i2so && i2so->_lowLatencyBufferBytes;
+        if (_shortenedStream) {
+            i2s_out_set_fill_length(i2so->_lowLatencyBufferBytes);
+        }
+        _switchedStepper = _engine == I2S_STREAM && !_shortenedStream;
         if (_switchedStepper) {
             _engine = I2S_STATIC;
             i2s_out_set_passthrough();
@@ -49,6 +92,14 @@ namespace Machine {
     }
 
     void Stepping::endLowLatency() {
+        if (_switchedBurst) {
+            _engine        = RMT_BURST;
+            _switchedBurst = false;
+        }
+        if (_shortenedStream) {
+            i2s_out_set_fill_length(0);
+            _shortenedStream = false;
+        }
         if (_switchedStepper) {
             if (i2s_out_get_pulser_status() != PASSTHROUGH) {
                 // Called during streaming. Stop streaming.
@@ -59,9 +110,11 @@ namespace Machine {
             _engine = I2S_STREAM;
         }
     }
+    void IRAM_ATTR Stepping::onPulseTimer() { config->_axes->unstep(); }
+
     // Called only from Axes::unstep()
     void IRAM_ATTR Stepping::waitPulse() {
-        if (_engine == I2S_STATIC || _engine == TIMED) {
+        if (_engine == I2S_STATIC || ((_engine == TIMED || _engine == DEDIC_GPIO) && !_asyncPulse)) {
             spinUntil(_stepPulseEndTime);
         }
     }
@@ -78,7 +131,7 @@ namespace Machine {
                 // Commit the pin changes to the hardware immediately
                 i2s_out_push();
                 delay_us(_directionDelayUsecs);
-            } else if (_engine == stepper_id_t::TIMED) {
+            } else if (_engine == stepper_id_t::TIMED || _engine == stepper_id_t::DEDIC_GPIO) {
                 // If we are using RMT, we can't delay here.
                 delay_us(_directionDelayUsecs);
             }
@@ -94,8 +147,12 @@ namespace Machine {
         } else if (_engine == stepper_id_t::I2S_STATIC) {
             i2s_out_push();
             _stepPulseEndTime = usToEndTicks(_pulseUsecs);
-        } else if (_engine == stepper_id_t::TIMED) {
-            _stepPulseEndTime = usToEndTicks(_pulseUsecs);
+        } else if (_engine == stepper_id_t::TIMED || _engine == stepper_id_t::DEDIC_GPIO) {
+            if (_asyncPulse) {
+                pulseTimerStart(_pulseUsecs * ticksPerMicrosecond);
+            } else {
+                _stepPulseEndTime = usToEndTicks(_pulseUsecs);
+            }
         }
     }
 
@@ -109,7 +166,9 @@ namespace Machine {
     // Called only from Stepper::pulse_func when a new segment is loaded
     // The argument is in units of ticks of the timer that generates ISRs
     void IRAM_ATTR Stepping::setTimerPeriod(uint16_t timerTicks) {
-        if (_engine == I2S_STREAM) {
+        if (MotionBench::active) {
+            MotionBench::setTimerPeriod(timerTicks);
+        } else if (_engine == I2S_STREAM) {
             // Pulse ISR is called for each tick of alarm_val.
             // The argument to i2s_out_set_pulse_period is in units of microseconds
             i2s_out_set_pulse_period(((uint32_t)timerTicks) / ticksPerMicrosecond);
@@ -118,9 +177,17 @@ namespace Machine {
         }
     }
 
+    // Called only from Stepper::pulse_func in I2S_STREAM mode, to make the
+    // next call come after count ticks instead of one
+    void IRAM_ATTR Stepping::setStreamTicks(uint16_t timerTicks, uint32_t count) {
+        i2s_out_set_pulse_period(((uint32_t)timerTicks) / ticksPerMicrosecond * count);
+    }
+
     // Called only from Stepper::wake_up which is not used in ISR context
     void Stepping::startTimer() {
-        if (_engine == I2S_STREAM) {
+        if (MotionBench::active) {
+            MotionBench::startTimer();
+        } else if (_engine == I2S_STREAM) {
             i2s_out_set_stepping();
         } else {
             stepTimerStart();
@@ -128,7 +195,9 @@ namespace Machine {
     }
     // Called only from Stepper::stop_stepping, used in both ISR and foreground contexts
     void IRAM_ATTR Stepping::stopTimer() {
-        if (_engine == I2S_STREAM) {
+        if (MotionBench::active) {
+            MotionBench::stopTimer();
+        } else if (_engine == I2S_STREAM) {
             i2s_out_set_passthrough();
         } else {
             stepTimerStop();
@@ -142,11 +211,27 @@ namespace Machine {
         handler.item("dir_delay_us", _directionDelayUsecs, 0, 10);
         handler.item("disable_delay_us", _disableDelayUsecs, 0, 1000000);  // max 1 second
         handler.item("segments", _segments, 6, 20);
+        handler.item("segment_us", _segmentUsecs, 1000, 50000);
+        handler.item("cruise_segment_us", _cruiseSegmentUsecs, 0, 100000);
+        handler.item("s_curve", _sCurve);
+        handler.item("prep_task", _prepTask);
+        handler.item("report_isr_stats", _reportIsrStats);
+        handler.item("step_check", _stepCheck, stepCheckTypes);
+        handler.item("pulse_timer", _pulseTimer);
+        handler.item("fast_hold", _fastHold);
     }
 
     void Stepping::afterParse() {
+        if (_cruiseSegmentUsecs && _cruiseSegmentUsecs < _segmentUsecs) {
+            log_warn("Increasing stepping/cruise_segment_us to stepping/segment_us " << _segmentUsecs);
+            _cruiseSegmentUsecs = _segmentUsecs;
+        }
+        if (_fastHold && (_engine == I2S_STREAM || _engine == RMT_BURST)) {
+            log_warn("stepping/fast_hold is not supported by this stepping engine");
+            _fastHold = false;
+        }
         if (_engine == I2S_STREAM || _engine == I2S_STATIC) {
-            Assert(config->_i2so, "I2SO bus must be configured for this stepping type");
+            Assert(config->i2soBus(), "I2SO or SPISO bus must be configured for this stepping type");
             if (_pulseUsecs < I2S_OUT_USEC_PER_PULSE) {
                 log_warn("Increasing stepping/pulse_us to the IS2 minimum value " << I2S_OUT_USEC_PER_PULSE);
                 _pulseUsecs = I2S_OUT_USEC_PER_PULSE;
@@ -158,16 +243,138 @@ namespace Machine {
         }
     }
 
-    uint32_t Stepping::maxPulsesPerSec() {
-        switch (_engine) {
+    uint32_t Stepping::maxPulsesPerSec() { return maxPulsesPerSec(_engine); }
+
+    uint32_t Stepping::maxPulsesPerSec(int engine) {
+        switch (engine) {
             case stepper_id_t::I2S_STREAM:
             case stepper_id_t::I2S_STATIC:
                 return i2s_out_max_steps_per_sec;
             case stepper_id_t::RMT:
                 return 1000000 / (2 * _pulseUsecs + _directionDelayUsecs);
+            case stepper_id_t::RMT_BURST:
+                // There is no ISR per pulse and the direction delay is taken once per burst
+                return 1000000 / (2 * (_pulseUsecs ? _pulseUsecs : 1));
             case stepper_id_t::TIMED:
             default:
                 return 80000;  // based on testing
         }
     }
+
+    const char* Stepping::unavailable(int engine) {
+        int  gpioPins  = 0;
+        int  otherPins = 0;
+        auto axes      = config->_axes;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            for (size_t motor = 0; motor < Axis::MAX_MOTORS_PER_AXIS; motor++) {
+                auto m = axes->_axis[axis]->_motors[motor];
+                if (!m) {
+                    continue;
+                }
+                int  gpio;
+                bool falling;
+                if (!m->_driver->step_counter_pin(gpio, falling)) {
+                    ++otherPins;
+                } else if (gpio >= 0) {
+                    ++gpioPins;
+                }
+            }
+        }
+        if (engine == I2S_STATIC || engine == I2S_STREAM) {
+            if (!config->i2soBus()) {
+                return "there is no I2SO or SPISO bus";
+            }
+            return gpioPins ? "step pins are GPIOs" : nullptr;
+        }
+        if (otherPins) {
+            return "step pins are not GPIOs";
+        }
+        if (engine == DEDIC_GPIO) {
+#if SOC_DEDICATED_GPIO_SUPPORTED
+            if (gpioPins > dedicGpioMaxPins) {
+                return "more step pins than dedicated outputs";
+            }
+#else
+            return "the chip has no dedicated GPIO";
+#endif
+        }
+        if ((engine == RMT || engine == RMT_BURST) && gpioPins > SOC_RMT_TX_CANDIDATES_PER_GROUP) {
+            return "more step pins than RMT channels";
+        }
+        return nullptr;
+    }
+
+    // Each engine is charged the measured ISR time per call, plus the time that it spins
+    // in the ISR for the pulse length.  The stream and burst engines pass over ticks with
+    // no steps, so their shares are upper bounds.
+    Error Stepping::bench(Channel& out, uint32_t ms) {
+        Error err = MotionBench::synthetic(out, ms);
+        if (err != Error::Ok) {
+            return err;
+        }
+        auto stats = Stepper::isr_stats;
+        if (!stats.count) {
+            log_info_to(out, "The step ISR did not run; are there axes with motors?");
+            return Error::Ok;
+        }
+        float isrUs = float(stats.total_ticks) / stats.count / ticks_per_us;
+
+        // The fastest step rate that the max rates of the axes call for
+        float needed = 0;
+        auto  axes   = config->_axes;
+        for (size_t axis = 0; axis < axes->_numberAxis; axis++) {
+            auto a = axes->_axis[axis];
+            needed = std::max(needed, a->_maxRate / 60 * a->_stepsPerMm);
+        }
+        log_info_to(out,
+                    "Step ISR: avg " << isrUs << " us, max " << stats.max_ticks / ticks_per_us << " us over " << stats.count
+                                     << " calls; the max rates need " << uint32_t(needed) << " pulses/s");
+
+        int   best      = -1;
+        float bestRate  = 0;
+        float bestShare = 0;
+        for (int engine = TIMED; engine <= DEDIC_GPIO; engine++) {
+            const char* name = stepTypes[engine].name;
+            const char* why  = unavailable(engine);
+            if (why) {
+                log_info_to(out, name << ": not available, " << why);
+                continue;
+            }
+            bool  spins  = engine == I2S_STATIC || ((engine == TIMED || engine == DEDIC_GPIO) && !_pulseTimer);
+            float callUs = isrUs + (spins ? _pulseUsecs : 0);
+
+            // The GPIO engines are bound by the ISR, and by a pulse and a gap of pulse_us
+            float limit = (engine == TIMED || engine == DEDIC_GPIO) ? 1000000.0f / (2 * std::max(_pulseUsecs, uint32_t(1)))
+                                                                    : maxPulsesPerSec(engine);
+            float rate  = std::min(limit, 1000000.0f / callUs);
+            float share = std::min(needed, rate) * callUs / 10000;  // Percent of a core
+            log_info_to(out,
+                        name << ": " << uint32_t(rate) << " pulses/s, ISR " << share << "% of a core at "
+                             << uint32_t(std::min(needed, rate)) << " pulses/s" << (engine == _engine ? " (configured)" : ""));
+            Benchmark::result(out, (std::string("stepping_") + name).c_str(), rate, "pulses/s");
+
+            // The lowest ISR share among the engines that reach the needed rate, else the fastest
+            bool better;
+            if (best < 0) {
+                better = true;
+            } else if ((rate >= needed) != (bestRate >= needed)) {
+                better = rate >= needed;
+            } else if (rate >= needed) {
+                better = share < bestShare || (share == bestShare && engine == _engine);
+            } else {
+                better = rate > bestRate;
+            }
+            if (better) {
+                best      = engine;
+                bestRate  = rate;
+                bestShare = share;
+            }
+        }
+        if (best >= 0) {
+            log_info_to(out,
+                        "Recommended engine: " << stepTypes[best].name
+                                               << (bestRate >= needed ? "" : ", which still falls short of the max rates"));
+        }
+        return Error::Ok;
+    }
 }
@@ -6,6 +6,9 @@
 
 #include "Configuration/Configurable.h"
 #include "Driver/StepTimer.h"
+#include "Error.h"
+
+class Channel;
 
 namespace Machine {
     class Stepping : public Configuration::Configurable {
@@ -15,10 +18,13 @@ namespace Machine {
 
     private:
         static bool onStepperDriverTimer();
+        static void onPulseTimer();
 
         static const int ticksPerMicrosecond = fStepperTimer / 1000000;
 
         bool    _switchedStepper = false;
+        bool    _shortenedStream = false;
+        bool    _switchedBurst   = false;
         int32_t _stepPulseEndTime;
 
     public:
@@ -27,19 +33,62 @@ namespace Machine {
             RMT,
             I2S_STATIC,
             I2S_STREAM,
+            RMT_BURST,
+            DEDIC_GPIO,
+        };
+
+        enum step_check_t {
+            CHECK_OFF = 0,
+            CHECK_LOG,
+            CHECK_ALARM,
         };
 
         Stepping() = default;
 
         // _segments is the number of entries in the step segment buffer between the step execution algorithm
         // and the planner blocks. Each segment is set of steps executed at a constant velocity over a
-        // fixed time defined by ACCELERATION_TICKS_PER_SECOND. They are computed such that the planner
-        // block velocity profile is traced exactly. The size of this buffer governs how much step
-        // execution lead time there is for other processes to run.  The latency for a feedhold or other
-        // override is roughly 10 ms times _segments.
+        // time of _segmentUsecs. They are computed such that the planner block velocity profile is
+        // traced exactly. The size of this buffer governs how much step execution lead time there is
+        // for other processes to run.  The latency for a feedhold or other override is roughly the
+        // segment time times _segments.
 
         size_t _segments = 12;
 
+        // _segmentUsecs is the temporal resolution of the acceleration ramps.  A shorter time gives
+        // smoother acceleration, particularly noticeable at very high feedrates, at the cost of more
+        // CPU time.  Shortening it also shortens the time stored in the segment buffer, so _segments
+        // may need to be increased to match.  When _cruiseSegmentUsecs is longer, segments in the
+        // cruise part of a block are lengthened up to that time, saving CPU time when the velocity
+        // does not change.  Zero means the same as _segmentUsecs.
+        uint32_t _segmentUsecs       = 10000;
+        uint32_t _cruiseSegmentUsecs = 0;
+
+        // Replaces the constant-acceleration ramps of each block with jerk-limited S-curves
+        // of the same duration.  See Stepper.cpp for details.
+        bool _sCurve = false;
+
+        // Runs step segment preparation in its own task.  See Stepper.cpp.
+        bool _prepTask = false;
+
+        // Adds the longest step ISR time in us and the segment buffer underrun count
+        // to status reports, as |Isr:max,underruns
+        bool _reportIsrStats = false;
+
+        // Counts the pulses on GPIO step pins in hardware and compares them with the
+        // steps issued by the step ISR.  See StepCheck.h.
+        int _stepCheck = CHECK_OFF;
+
+        // With the Timed and Dedicated_GPIO engines, ends step pulses from a second hardware
+        // timer instead of spinning in the step ISR for the pulse length.  Needs every step
+        // pin to be a GPIO; _asyncPulse tells whether it is in use.
+        bool _pulseTimer = false;
+        bool _asyncPulse = false;
+
+        // Stops a feed hold within the stopping distance of the block acceleration by
+        // slowing the step ISR itself, instead of first running the segments that are
+        // already prepped.  Not with the I2S_STREAM or RMT_burst engines.  See Stepper.cpp.
+        bool _fastHold = false;
+
         uint32_t _idleMsecs           = 255;
         uint32_t _pulseUsecs          = 4;
         uint32_t _directionDelayUsecs = 0;
@@ -60,9 +109,21 @@ namespace Machine {
         void finishPulse();    // Cleanup after unstep
 
         uint32_t maxPulsesPerSec();
+        uint32_t maxPulsesPerSec(int engine);
+
+        // Why an engine cannot drive the step pins of the configured motors, or nullptr
+        const char* unavailable(int engine);
+
+        // $Stepping/Bench: times the step ISR on about ms of synthetic motion of the
+        // configured axes and motors, and works out for each engine that the pins allow
+        // the pulse rate that it reaches and the share of a core that the ISR takes.
+        // The engine itself is only changed in the config file, since the motors claim
+        // their RMT channels or pins for it when they start.
+        Error bench(Channel& out, uint32_t ms);
 
         // Timers
         void        setTimerPeriod(uint16_t timerTicks);
+        void        setStreamTicks(uint16_t timerTicks, uint32_t count);
         void        startTimer();
         static void stopTimer();
 
@@ -72,3 +133,4 @@ namespace Machine {
     };
 }
 extern EnumItem stepTypes[];
+extern EnumItem stepCheckTypes[];
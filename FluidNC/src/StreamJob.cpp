@@ -0,0 +1,202 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "StreamJob.h"
+
+#include "InputFile.h"  // InputFile::setProgress()
+#include "Config.h"     // FILE_READ_TASK_*
+#include "Logging.h"
+#include "Serial.h"  // allChannels
+#include "Report.h"  // _notifyf()
+#include "Extents.h"  // Extents::other_job()
+
+#include <freertos/task.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+StreamJob::StreamJob(const char* url, WebUI::AuthenticationLevel auth_level, Channel& out) :
+    Channel("stream"), _url(url), _auth_level(auth_level), _out(out) {}
+
+Error StreamJob::run(const char* url, WebUI::AuthenticationLevel auth_level, Channel& out) {
+    auto job = new StreamJob(url, auth_level, out);
+    auto err = job->connect();
+    if (err != Error::Ok) {
+        delete job;
+        return err;
+    }
+    log_info("Streaming job from " << url);
+    Extents::other_job();
+    allChannels.registration(job);
+    return Error::Ok;
+}
+
+Error StreamJob::connect() {
+    if (_url.rfind("tcp://", 0) == 0) {
+        std::string hostPort = _url.substr(6);
+        auto        colon    = hostPort.rfind(':');
+        if (colon == std::string::npos) {
+            log_error_to(_out, "The TCP stream needs a port");
+            return Error::InvalidValue;
+        }
+        int port = atoi(hostPort.c_str() + colon + 1);
+        hostPort.resize(colon);
+        if (!_tcp.connect(hostPort.c_str(), port)) {
+            log_error_to(_out, "Cannot connect to " << _url);
+            return Error::FsFailedOpenFile;
+        }
+        _stream = &_tcp;
+    } else if (_url.rfind("http://", 0) == 0) {
+        // HTTP/1.0 keeps the server from chunking the body, which the stream would show raw
+        _http.useHTTP10(true);
+        if (!_http.begin(_url.c_str())) {
+            log_error_to(_out, "Bad URL " << _url);
+            return Error::InvalidValue;
+        }
+        int code = _http.GET();
+        if (code != HTTP_CODE_OK) {
+            log_error_to(_out, "GET " << _url << " failed: " << code);
+            _http.end();
+            return Error::FsFailedOpenFile;
+        }
+        int size = _http.getSize();
+        if (size >= 0) {
+            _size = size;
+        }
+        _stream = _http.getStreamPtr();
+    } else {
+        log_error_to(_out, "The URL must start with http:// or tcp://");
+        return Error::InvalidValue;
+    }
+
+    for (size_t capacity = bufferSize; !_buffer && capacity >= minBufferSize; capacity /= 2) {
+        _buffer   = static_cast<char*>(malloc(capacity));
+        _capacity = capacity;
+    }
+    if (!_buffer) {
+        log_error_to(_out, "No memory for the stream buffer");
+        return Error::FsFailedOpenFile;
+    }
+    _done = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(reader,                   // task
+                            "stream_read",            // name for task
+                            3072,                     // size of task stack
+                            this,                     // parameters
+                            FILE_READ_TASK_PRIORITY,  // priority
+                            nullptr,                  // task handle
+                            FILE_READ_TASK_CORE       // core
+    );
+    return Error::Ok;
+}
+
+// Copies the stream into the free part of the ring until the stream ends or the job stops
+void StreamJob::reader(void* arg) {
+    auto   self     = static_cast<StreamJob*>(arg);
+    auto   stream   = self->_stream;
+    size_t capacity = self->_capacity;
+    while (!self->_stop) {
+        size_t written = self->_written.load(std::memory_order_relaxed);
+        if (written == self->_size) {
+            break;
+        }
+        size_t space = capacity - (written - self->_read.load(std::memory_order_acquire));
+        if (!space) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (!stream->available()) {
+            if (!stream->connected()) {
+                // A connection closed early is a failure unless the length was not known
+                self->_failed = self->_size != SIZE_MAX;
+                break;
+            }
+            vTaskDelay(1);
+            continue;
+        }
+        size_t index = written % capacity;
+        size_t n     = std::min(space, capacity - index);  // Up to the end of the buffer
+        int    got   = stream->read(reinterpret_cast<uint8_t*>(self->_buffer + index), n);
+        if (got > 0) {
+            self->_written.store(written + got, std::memory_order_release);
+        }
+    }
+    self->_eof = true;
+    xSemaphoreGive(self->_done);
+    vTaskDelete(nullptr);
+}
+
+void StreamJob::finish(const char* why) {
+    InputFile::endProgress(this);
+    allChannels.kill(this);
+    log_info(_url << " " << why << " at line " << _line_num);
+}
+
+Channel* StreamJob::pollLine(char* line) {
+    // A stream job never returns realtime characters, so we do nothing
+    // if line is null.
+    if (!line) {
+        return nullptr;
+    }
+    // Checked before the data, so that the last of it is seen after the reader is done
+    bool   eof     = _eof;
+    size_t read    = _read.load(std::memory_order_relaxed);
+    size_t written = _written.load(std::memory_order_acquire);
+
+    size_t len = 0;
+    size_t pos = read;
+    for (; pos != written; ++pos) {
+        char c = _buffer[pos % _capacity];
+        if (c == '\n') {
+            break;
+        }
+        if (c == '\r') {
+            continue;
+        }
+        if (len >= Channel::maxLine - 1) {
+            log_error(static_cast<int>(Error::LineLengthExceeded) << " (" << errorString(Error::LineLengthExceeded) << ") in " << _url
+                                                                   << " at line " << _line_num + 1);
+            finish("stopped");
+            return nullptr;
+        }
+        line[len++] = c;
+    }
+    if (pos == written) {
+        // No whole line yet.  At the end of the stream the rest is the last line.
+        if (!eof) {
+            return nullptr;
+        }
+        if (_failed) {
+            _notifyf("Stream job failed", "%s closed at line %d", _url.c_str(), _line_num);
+            finish("closed early");
+            return nullptr;
+        }
+        if (pos == read) {
+            _notifyf("Stream job done", "%s stream job succeeded", _url.c_str());
+            finish("stream job succeeded");
+            return nullptr;
+        }
+    } else {
+        ++pos;  // Past the newline
+    }
+    line[len] = '\0';
+    _read.store(pos, std::memory_order_release);
+    ++_line_num;
+    InputFile::setProgress(this, _url.c_str(), pos, _size);
+    return &allChannels;
+}
+
+void StreamJob::stopJob() {
+    _notifyf("Stream job canceled", "Reset during stream job at line: %d", _line_num);
+    finish("canceled by reset");
+}
+
+StreamJob::~StreamJob() {
+    InputFile::endProgress(this);
+    if (_done) {
+        _stop = true;
+        xSemaphoreTake(_done, portMAX_DELAY);
+        vSemaphoreDelete(_done);
+    }
+    free(_buffer);
+    _http.end();
+    _tcp.stop();
+}
@@ -0,0 +1,82 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  StreamJob.h - runs a G-code job straight from the network
+
+  $Stream/Run=http://host[:port]/path fetches the job with an HTTP GET, and
+  $Stream/Run=tcp://host:port reads it from a raw TCP connection until the other end
+  closes it.  Either way the job starts as soon as its first line arrives, instead of
+  after it has been saved to a file.
+
+  A task reads the stream ahead into a ring buffer while the job runs lines from it, so
+  the download overlaps the cutting and only has to keep ahead of it.  If the buffer runs
+  dry the job waits for more, as a sender's job would; if the connection fails or closes
+  early the job stops.  Lines run as those of a file job do, and progress shows in the SD:
+  field of status reports, as a percentage when the server gives the length.
+
+  HTTPS is not supported; a TLS session needs more heap than the buffer can spare.
+*/
+
+#include "Channel.h"
+#include "Error.h"
+#include "WebUI/Authentication.h"
+
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+
+class StreamJob : public Channel {
+public:
+    static const size_t bufferSize    = 32768;
+    static const size_t minBufferSize = 4096;  // Used when there is not enough heap for bufferSize
+
+    // Connects to url and starts the job
+    static Error run(const char* url, WebUI::AuthenticationLevel auth_level, Channel& out);
+
+    StreamJob(const StreamJob&)            = delete;
+    StreamJob& operator=(const StreamJob&) = delete;
+
+    // Channel methods
+    size_t   write(uint8_t c) override { return 0; }
+    void     flush() override {}
+    Channel* pollLine(char* line) override;
+    void     stopJob() override;
+    int      linePriority() override { return 0; }
+
+    ~StreamJob();
+
+private:
+    StreamJob(const char* url, WebUI::AuthenticationLevel auth_level, Channel& out);
+
+    Error connect();
+
+    std::string                _url;
+    WebUI::AuthenticationLevel _auth_level;
+    Channel&                   _out;  // Where the job was started
+
+    WiFiClient  _tcp;
+    HTTPClient  _http;
+    WiFiClient* _stream = nullptr;  // _tcp, or the HTTP response body
+    size_t      _size   = SIZE_MAX;  // Length of the stream, if known
+
+    // The ring, written only by the reader task and read only by pollLine().  The counts
+    // only grow, and the buffer index is the count modulo _capacity.
+    char*               _buffer   = nullptr;
+    size_t              _capacity = 0;
+    std::atomic<size_t> _written { 0 };
+    std::atomic<size_t> _read { 0 };
+
+    std::atomic<bool> _eof { false };     // The reader has everything it will get
+    std::atomic<bool> _failed { false };  // ... because the connection failed
+    std::atomic<bool> _stop { false };    // Tells the reader to quit
+    SemaphoreHandle_t _done = nullptr;    // Given by the reader when it quits
+
+    uint32_t _line_num = 0;
+
+    static void reader(void* arg);
+    void        finish(const char* why);
+};
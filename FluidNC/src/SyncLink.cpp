@@ -0,0 +1,386 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "SyncLink.h"
+
+#include "Config.h"  // SYNC_LINK_TASK_*
+#include "Logging.h"
+#include "Machine/MachineConfig.h"  // config->_uarts
+#include "Modbus.h"                 // ModbusBus::crc()
+#include "MotionControl.h"          // mc_critical
+#include "Protocol.h"               // protocol_send_event
+#include "Stepping.h"               // fStepperTimer
+#include "System.h"                 // inMotionState()
+#include "Uart.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+EnumItem syncLinkRoles[] = { { SyncLink::Coordinator, "Coordinator" },
+                             { SyncLink::Follower, "Follower" },
+                             EnumItem(SyncLink::Coordinator) };
+
+bool              SyncLink::_coordinating = false;
+bool              SyncLink::_following    = false;
+volatile uint32_t SyncLink::_motionTicks  = 0;
+
+// A frame is startByte, its type, the length of its payload, the payload, and the Modbus
+// CRC of the type, length and payload, low byte first
+static const uint8_t startByte     = 0xa5;
+static const size_t  maxPayload    = sizeof(Stepper::LinkBlock);
+static const size_t  frameOverhead = 5;
+static const size_t  maxFrame      = maxPayload + frameOverhead;
+static_assert(maxPayload <= UINT8_MAX, "A sync link payload length is one byte");
+
+enum FrameType : uint8_t {
+    ResetFrame = 1,  // Hello, from the coordinator
+    StartFrame,      // The coordinator's motion ticks as it starts stepping
+    BlockFrame,      // Stepper::LinkBlock
+    SegmentFrame,    // Stepper::LinkSegment
+    SyncFrame,       // The coordinator's motion ticks as the frame arrives
+    FaultFrame,      // Fault, from the follower
+    JoinFrame,       // From a follower that has just started, for a reset frame
+};
+
+struct __attribute__((packed)) Hello {
+    uint8_t version;
+    uint8_t maxAxes;  // MAX_N_AXIS, which sizes the block frames
+};
+
+enum Fault : uint8_t {
+    BadFrame = 1,
+    Overrun,
+    Mismatch,
+    Drift,
+};
+static const char* faultNames[] = { "", "a bad frame", "a full segment buffer", "a different build", "losing the coordinator's clock" };
+
+// Received bytes are handed to the task once the line has been idle for this many
+// character times, which the sync stamps include as part of the latency
+static const int rxIdleSymbols = 2;
+
+// A follower further off the coordinator's motion time than this has lost it
+static const uint32_t maxErrorUs = 2000;
+
+// The clock loop: the proportional term takes up an error over proportionalSecs, and the
+// integral term, which learns the difference between the crystals, over integralSecs
+static const float proportionalSecs = 1.0f;
+static const float integralSecs     = 4.0f;
+
+static Uart*             uart     = nullptr;
+static SemaphoreHandle_t sendLock = nullptr;
+static TaskHandle_t      task     = nullptr;
+
+// Coordinator
+static TickType_t           syncPeriod;         // Between sync frames
+static TickType_t           lastSync      = 0;  // When the last sync frame was sent
+static uint32_t             lastSyncTicks = 0;  // Motion ticks at the last sync frame
+static uint32_t             stampLead;          // Motion ticks from sending a sync frame to its arrival
+static std::atomic<uint8_t> followerFault(0);
+
+// Follower, run by the receive task.  It waits for a reset frame at first, since it cannot
+// know where in the coordinator's blocks a stream that is already running has got to.
+static bool     failed     = true;   // Stopped until the next reset frame
+static float    syncSecs;            // sync_ms in seconds
+static float    maxCorrection;       // max_ppm as a fraction
+static float    integral   = 0;      // Integral term of the clock loop
+static int32_t  correction = 0;      // Of the segment periods, in parts per billion
+static int64_t  carry      = 0;      // Ticks left over from rounding the steered periods
+static uint32_t underruns  = 0;
+
+static void write_frame(FrameType type, const void* payload, uint8_t length) {
+    uint8_t frame[maxFrame];
+    frame[0] = startByte;
+    frame[1] = type;
+    frame[2] = length;
+    if (length) {
+        memcpy(frame + 3, payload, length);
+    }
+    uint16_t crc      = ModbusBus::crc(frame + 1, length + 2);
+    frame[length + 3] = crc & 0xff;
+    frame[length + 4] = crc >> 8;
+    uart->write(frame, length + frameOverhead);
+}
+
+static void send(FrameType type, const void* payload, uint8_t length) {
+    xSemaphoreTake(sendLock, portMAX_DELAY);
+    write_frame(type, payload, length);
+    xSemaphoreGive(sendLock);
+}
+
+// Raised by the coordinator's receive task, so the alarm is raised from the main loop
+static void report_fault() {
+    uint8_t reason = followerFault.exchange(0);
+    log_error("Sync link: the follower stopped on " << faultNames[reason]);
+    mc_critical(ExecAlarm::LinkLost);
+}
+
+static NoArgEvent faultEvent { report_fault };
+
+// A follower that started after the coordinator gets a reset frame, with the stepper reset
+// that goes with it, unless the machine is moving without it
+static void join() {
+    if (inMotionState()) {
+        log_error("Sync link: the follower started during a motion");
+        mc_critical(ExecAlarm::LinkLost);
+        return;
+    }
+    log_info("Sync link: the follower joined");
+    Stepper::reset();
+}
+
+static NoArgEvent joinEvent { join };
+
+// On the follower.  It stops until the coordinator's reset, and tells the coordinator why.
+static void fault(Fault reason) {
+    Stepper::reset();
+    failed = true;
+    log_error("Sync link: stopped on " << faultNames[reason] << ", until the coordinator resets");
+    send(FaultFrame, &reason, sizeof(reason));
+}
+
+// The period of a segment, scaled by the clock loop.  The rounding is carried over to the
+// next segment, since a few hundred ppm of a short period is a fraction of a tick.
+static uint16_t steer(const Stepper::LinkSegment& segment) {
+    if (!segment.n_step) {
+        return segment.isrPeriod;
+    }
+    int64_t  total  = int64_t(segment.n_step) * segment.isrPeriod;
+    int64_t  ticks  = total - total * correction / 1000000000 + carry;
+    uint32_t period = std::clamp<int64_t>((ticks + segment.n_step / 2) / segment.n_step, 1, UINT16_MAX);
+    carry           = std::clamp<int64_t>(ticks - int64_t(period) * segment.n_step, -UINT16_MAX, UINT16_MAX);
+    return period;
+}
+
+void SyncLink::follow(uint8_t type, const uint8_t* payload, size_t length) {
+    if (type == ResetFrame) {
+        Hello hello;
+        memcpy(&hello, payload, std::min(length, sizeof(hello)));
+        Stepper::reset();
+        failed = false;
+        carry  = 0;
+        if (length != sizeof(hello) || hello.version != protocolVersion || hello.maxAxes != MAX_N_AXIS) {
+            fault(Mismatch);
+        }
+        return;
+    }
+    if (failed) {
+        return;
+    }
+    switch (type) {
+        case StartFrame: {
+            uint32_t ticks;
+            if (length != sizeof(ticks)) {
+                fault(BadFrame);
+                return;
+            }
+            // Still stepping means that the coordinator ran out and started again before
+            // the segments here ran out, and the count goes on
+            if (!Stepper::stepping()) {
+                memcpy(&ticks, payload, sizeof(ticks));
+                _motionTicks = ticks;
+            }
+            Stepper::wake_up();
+            break;
+        }
+        case BlockFrame: {
+            Stepper::LinkBlock block;
+            if (length != sizeof(block)) {
+                fault(BadFrame);
+                return;
+            }
+            memcpy(&block, payload, sizeof(block));
+            if (!Stepper::follow_block(block)) {
+                fault(Overrun);
+            }
+            break;
+        }
+        case SegmentFrame: {
+            Stepper::LinkSegment segment;
+            if (length != sizeof(segment)) {
+                fault(BadFrame);
+                return;
+            }
+            memcpy(&segment, payload, sizeof(segment));
+            if (!Stepper::follow_segment(segment, steer(segment))) {
+                fault(Overrun);
+                return;
+            }
+            // The segments here ran out while the coordinator's did not.  They go on from
+            // this one, and the clock loop takes up the time that was lost.
+            if (segment.running && !Stepper::stepping()) {
+                underruns++;
+                log_warn("Sync link: the follower ran out of segments, " << underruns << " times");
+                Stepper::wake_up();
+            }
+            break;
+        }
+        case SyncFrame: {
+            uint32_t stamp;
+            if (length != sizeof(stamp)) {
+                fault(BadFrame);
+                return;
+            }
+            if (!Stepper::stepping()) {
+                return;
+            }
+            memcpy(&stamp, payload, sizeof(stamp));
+            // Seconds behind the coordinator
+            float error = int32_t(stamp - _motionTicks) / float(Machine::Stepping::fStepperTimer);
+            if (std::fabs(error) > maxErrorUs * 1e-6f) {
+                fault(Drift);
+                return;
+            }
+            integral   = std::clamp(integral + error * syncSecs / (integralSecs * integralSecs), -maxCorrection, maxCorrection);
+            correction = lroundf(std::clamp(error / proportionalSecs + integral, -maxCorrection, maxCorrection) * 1e9f);
+            break;
+        }
+        default:
+            fault(BadFrame);
+            break;
+    }
+}
+
+void SyncLink::receive_task(void* unused) {
+    uint8_t frame[maxFrame];
+    size_t  have = 0;  // Bytes of the frame so far
+    uint8_t buffer[64];
+    while (true) {
+        size_t n = uart->timedReadBytes(buffer, 1, portMAX_DELAY);
+        if (!n) {
+            continue;
+        }
+        n += uart->read(buffer + 1, sizeof(buffer) - 1);
+        for (size_t i = 0; i < n; i++) {
+            uint8_t c = buffer[i];
+            if (have == 0 && c != startByte) {
+                if (_following && !failed) {
+                    fault(BadFrame);
+                }
+                continue;
+            }
+            frame[have++] = c;
+            if (have == 3 && frame[2] > maxPayload) {
+                have = 0;
+                if (_following && !failed) {
+                    fault(BadFrame);
+                }
+                continue;
+            }
+            if (have < 3 || have < size_t(frame[2]) + frameOverhead) {
+                continue;
+            }
+            size_t   length = frame[2];
+            uint16_t crc    = ModbusBus::crc(frame + 1, length + 2);
+            have            = 0;
+            if (frame[length + 3] != (crc & 0xff) || frame[length + 4] != (crc >> 8)) {
+                if (_following && !failed) {
+                    fault(BadFrame);
+                }
+                continue;
+            }
+            if (_following) {
+                follow(frame[1], frame + 3, length);
+            } else if (frame[1] == FaultFrame && length == 1 && frame[3] && frame[3] <= Drift) {
+                followerFault = frame[3];
+                protocol_send_event(&faultEvent);
+            } else if (frame[1] == JoinFrame) {
+                protocol_send_event(&joinEvent);
+            }
+        }
+    }
+}
+
+void SyncLink::reset() {
+    if (!uart) {
+        return;
+    }
+    Hello hello = { protocolVersion, uint8_t(MAX_N_AXIS) };
+    send(ResetFrame, &hello, sizeof(hello));
+}
+
+void SyncLink::started() {
+    if (!uart) {
+        return;
+    }
+    uint32_t ticks = _motionTicks;
+    send(StartFrame, &ticks, sizeof(ticks));
+}
+
+void SyncLink::segment(const Stepper::LinkBlock* block, const Stepper::LinkSegment& segment) {
+    if (!uart) {
+        return;
+    }
+    xSemaphoreTake(sendLock, portMAX_DELAY);
+    if (block) {
+        write_frame(BlockFrame, block, sizeof(*block));
+    }
+    write_frame(SegmentFrame, &segment, sizeof(segment));
+
+    // Only while stepping, since the stamp assumes that the motion goes on until it arrives
+    TickType_t now   = xTaskGetTickCount();
+    uint32_t   ticks = _motionTicks;
+    if (ticks != lastSyncTicks && now - lastSync >= syncPeriod) {
+        lastSync      = now;
+        lastSyncTicks = ticks;
+        // The stamp is only right if the frame goes out at once, not behind the others
+        if (!uart->flushTxTimed(1)) {
+            uint32_t stamp = _motionTicks + stampLead;
+            write_frame(SyncFrame, &stamp, sizeof(stamp));
+        }
+    }
+    xSemaphoreGive(sendLock);
+}
+
+void SyncLink::validate() {
+    Assert(_uartNum >= 1 && _uartNum < MAX_N_UARTS, "sync_link: uart_num must name one of the uart sections");
+}
+
+void SyncLink::group(Configuration::HandlerBase& handler) {
+    handler.item("role", _role, syncLinkRoles);
+    handler.item("uart_num", _uartNum);
+    handler.item("sync_ms", _syncMs, 1, 1000);
+    handler.item("max_ppm", _maxPpm, 1, 2000);
+}
+
+void SyncLink::init() {
+    Uart* link = config->_uarts[_uartNum];
+    if (!link) {
+        log_error("SyncLink: Missing uart" << _uartNum << " section");
+        return;
+    }
+    link->setRxIdleTimeout(rxIdleSymbols);
+    sendLock = xSemaphoreCreateMutex();
+
+    syncPeriod    = std::max<TickType_t>(_syncMs / portTICK_PERIOD_MS, 1);
+    syncSecs      = _syncMs / 1000.0f;
+    maxCorrection = _maxPpm * 1e-6f;
+    // 10 bits a character, as with 8N1
+    uint32_t chars = sizeof(uint32_t) + frameOverhead + rxIdleSymbols;
+    stampLead      = uint64_t(chars) * 10 * Machine::Stepping::fStepperTimer / link->_baud;
+
+    // The stepper only sends once the link is set up
+    uart          = link;
+    _coordinating = _role == Coordinator;
+    _following    = _role == Follower;
+
+    xTaskCreatePinnedToCore(receive_task,             // task
+                            "sync_link",              // name for task
+                            3072,                     // size of task stack
+                            nullptr,                  // parameters
+                            SYNC_LINK_TASK_PRIORITY,  // priority
+                            &task,                    // task handle
+                            SYNC_LINK_TASK_CORE       // core
+    );
+
+    log_info("Sync link " << (_coordinating ? "coordinator" : "follower") << " on uart" << _uartNum << " at " << uart->_baud << " baud");
+    if (_coordinating) {
+        reset();  // The follower drops whatever it had from before this start
+    } else {
+        send(JoinFrame, nullptr, 0);
+    }
+}
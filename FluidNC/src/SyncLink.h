@@ -0,0 +1,91 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  SyncLink.h - drives more axes than one board has, from one planner, over a UART
+
+  A coordinator plans all of the motion.  Its stepper blocks and segments go over the
+  link as they are prepped, and a follower queues them in its own segment buffer in
+  place of a planner, so each board steps the same segments through the same Bresenham
+  tracer.  Each axis is stepped by whichever board has motors for it: the coordinator
+  declares every axis, with no motors on those of the follower, and the follower
+  declares at least as many axes, with the same steps_per_mm, and motors on its own.
+
+    uart2:
+      txd_pin: gpio.17
+      rxd_pin: gpio.16
+      baud: 2000000
+    sync_link:
+      role: Coordinator
+      uart_num: 2
+
+  The follower starts its steps when the coordinator does.  While they run, the
+  coordinator sends the motion time that it has stepped every sync_ms, as it will be
+  once the frame has arrived, and the follower steers its own to it by scaling the
+  periods of the segments that it queues, by at most max_ppm, so the crystals of the
+  two boards cannot drift apart.  The frames are checked with a CRC.  A follower that
+  loses a frame, overruns its buffer or loses the clock stops, and the coordinator
+  raises a Sync Link Lost alarm when it hears of it, until a reset of the coordinator
+  restarts both.  A follower that starts after the coordinator asks it for that reset,
+  which it gets at once unless the machine is moving.  The follower's segment buffer
+  should be a few segments longer than the coordinator's, since it runs a little
+  behind until the clock loop takes up the link latency.
+
+  The spindle and laser power of the segments stay with the coordinator, and a fast
+  hold, which the ISR works out by itself, is not used while the link is up.  The
+  follower takes no motion of its own, and its axes are not homed.  The link is a
+  UART rather than ESP-NOW, whose latency varies too much to discipline a clock to.
+*/
+
+#include "Configuration/Configurable.h"
+#include "Stepper.h"
+
+#include <esp_attr.h>  // IRAM_ATTR
+#include <cstddef>
+#include <cstdint>
+
+class Uart;
+
+class SyncLink : public Configuration::Configurable {
+public:
+    enum Role : uint8_t {
+        Coordinator = 0,
+        Follower,
+    };
+
+    static const uint8_t protocolVersion = 1;
+
+    void init();
+
+    // The roles of this board, for the stepper
+    static bool coordinating() { return _coordinating; }
+    static bool following() { return _following; }
+
+    // Called by the coordinator's stepper.  reset() drops what the follower has queued,
+    // started() starts its steps, and segment() queues a segment, with its stepper block
+    // if the segment starts one.
+    static void reset();
+    static void started();
+    static void segment(const Stepper::LinkBlock* block, const Stepper::LinkSegment& segment);
+
+    // Called from the step ISR with the ticks that it steps, at the coordinator's periods.
+    // The count is the motion time that the two boards compare.
+    static inline void IRAM_ATTR ticked(uint32_t ticks) { _motionTicks += ticks; }
+
+    void validate() override;
+    void group(Configuration::HandlerBase& handler) override;
+
+private:
+    int      _role    = Coordinator;
+    int      _uartNum = 1;
+    uint32_t _syncMs  = 10;
+    uint32_t _maxPpm  = 200;
+
+    static bool              _coordinating;
+    static bool              _following;
+    static volatile uint32_t _motionTicks;
+
+    static void receive_task(void* unused);
+    static void follow(uint8_t type, const uint8_t* payload, size_t length);
+};
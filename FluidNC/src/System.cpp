@@ -10,13 +10,16 @@
 #include "Report.h"                 // report_ovr_counter
 #include "Config.h"                 // MAX_N_AXIS
 #include "Machine/MachineConfig.h"  // config
+#include "Machine/Encoder.h"        // Encoder::sync
+#include "Stepper.h"                 // Stepper::backlash_steps
 
 #include <cstring>  // memset
 #include <cmath>    // roundf
 
 // Declare system global variable structure
 system_t sys;
-int32_t  probe_steps[MAX_N_AXIS];  // Last probe position in steps.
+int32_t  probe_steps[MAX_N_AXIS];     // Last probe position in steps.
+float    probe_fraction[MAX_N_AXIS];  // And the fraction of a step beyond it
 
 void system_reset() {
     // Reset system variables.
@@ -29,15 +32,23 @@ void system_reset() {
     sys.r_override        = RapidOverride::Default;         // Set to 100%
     sys.spindle_speed_ovr = SpindleSpeedOverride::Default;  // Set to 100%
     memset(probe_steps, 0, sizeof(probe_steps));            // Clear probe position.
+    memset(probe_fraction, 0, sizeof(probe_fraction));
     report_ovr_counter = 0;
     report_wco_counter = 0;
 }
 
+AxisScale axis_scales[MAX_N_AXIS];
+
+void set_axis_scale(size_t axis, float stepsPerMm) {
+    axis_scales[axis].stepsPerMm = stepsPerMm;
+    axis_scales[axis].mmPerStep  = 1.0f / stepsPerMm;
+}
+
 float steps_to_mpos(int32_t steps, size_t axis) {
-    return float(steps / config->_axes->_axis[axis]->_stepsPerMm);
+    return steps * axis_scales[axis].mmPerStep;
 }
 int32_t mpos_to_steps(float mpos, size_t axis) {
-    return lroundf(mpos * config->_axes->_axis[axis]->_stepsPerMm);
+    return lroundf(mpos * axis_scales[axis].stepsPerMm);
 }
 
 void motor_steps_to_mpos(float* position, int32_t* steps) {
@@ -50,14 +61,28 @@ void motor_steps_to_mpos(float* position, int32_t* steps) {
     config->_kinematics->motors_to_cartesian(position, motor_mpos, n_axis);
 }
 
+void probe_mpos(float* position) {
+    float motor_mpos[MAX_N_AXIS];
+    auto  a      = config->_axes;
+    auto  n_axis = a ? a->_numberAxis : 0;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        motor_mpos[idx] = (probe_steps[idx] + probe_fraction[idx]) * axis_scales[idx].mmPerStep;
+    }
+    config->_kinematics->motors_to_cartesian(position, motor_mpos, n_axis);
+}
+
 void set_motor_steps(size_t axis, int32_t steps) {
     auto a = config->_axes->_axis[axis];
     for (size_t motor = 0; motor < Machine::Axis::MAX_MOTORS_PER_AXIS; motor++) {
         auto m = a->_motors[motor];
         if (m) {
             m->_steps = steps;
+            if (m->_encoder) {
+                m->_encoder->sync(steps);
+            }
         }
     }
+    Stepper::reset_backlash(axis);
 }
 
 void set_motor_steps_from_mpos(float* mpos) {
@@ -81,7 +106,7 @@ int32_t* get_motor_steps() {
     auto n_axis = axes->_numberAxis;
     for (size_t axis = 0; axis < n_axis; axis++) {
         auto m            = axes->_axis[axis]->_motors[0];
-        motor_steps[axis] = m ? m->_steps : 0;
+        motor_steps[axis] = (m ? m->_steps : 0) - Stepper::backlash_steps[axis];
     }
     return motor_steps;
 }
@@ -93,6 +118,20 @@ float* get_mpos() {
     return position;
 };
 
+void mpos_to_um(const float* mpos, int32_t* um) {
+    auto n_axis = config->_axes->_numberAxis;
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        um[axis] = lroundf(mpos[axis] * 1000.0f);
+    }
+}
+
+int32_t* get_mpos_um() {
+    static int32_t position[MAX_N_AXIS];
+
+    mpos_to_um(get_mpos(), position);
+    return position;
+}
+
 float* get_wco() {
     static float wco[MAX_N_AXIS];
     auto         n_axis = config->_axes->_numberAxis;
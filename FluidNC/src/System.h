@@ -55,9 +55,23 @@ extern system_t sys;
 // NOTE: These position variables may need to be declared as volatiles, if problems arise.
 extern int32_t motor_steps[MAX_N_AXIS];  // Real-time machine (aka home) position vector in steps.
 extern int32_t probe_steps[MAX_N_AXIS];  // Last probe position in machine coordinates and steps.
+extern float   probe_fraction[MAX_N_AXIS];  // Fraction of a step past probe_steps, when the trip was latched
+
+// The last probe position in machine coordinates, including probe_fraction
+void probe_mpos(float* position);
 
 void system_reset();
 
+// steps/mm of each axis and its reciprocal, refreshed by Axis::afterParse() whenever
+// the config changes, so that conversions multiply and need no pointers into config
+struct AxisScale {
+    float stepsPerMm;
+    float mmPerStep;
+};
+extern AxisScale axis_scales[MAX_N_AXIS];
+
+void set_axis_scale(size_t axis, float stepsPerMm);
+
 float   steps_to_mpos(int32_t steps, size_t axis);
 int32_t mpos_to_steps(float mpos, size_t axis);
 
@@ -70,6 +84,11 @@ int32_t* get_motor_steps();
 void motor_steps_to_mpos(float* position, int32_t* steps);
 
 float* get_mpos();
+
+// Positions in integer microns, or millidegrees on rotary axes, for reports and
+// telemetry that format or send them without float math
+void     mpos_to_um(const float* mpos, int32_t* um);
+int32_t* get_mpos_um();
 float* get_wco();
 
 bool inMotionState();  // True if moving, i.e. the stepping engine is active
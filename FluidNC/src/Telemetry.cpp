@@ -0,0 +1,238 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Telemetry.h"
+
+#include "Config.h"  // TELEMETRY_TASK_*
+#include "FileStream.h"
+#include "InputFile.h"
+#include "JobStats.h"  // JobStats::file_runs()
+#include "Logging.h"
+#include "Machine/MachineConfig.h"  // config->_sdCard
+#include "Planner.h"                // plan_get_current_block()
+#include "Protocol.h"               // lastAlarm
+#include "SdArbiter.h"
+#include "SpscRing.h"
+#include "Spindles/Spindle.h"
+#include "Stepper.h"  // Stepper::get_realtime_rate()
+#include "System.h"   // sys
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace Telemetry {
+    // Who moves the recording on: job_started() to Recording, poll() to Ending, the
+    // sampler to Draining after its last sample, and the writer back to Idle
+    enum Phase : uint8_t {
+        Idle,
+        Recording,
+        Ending,
+        Draining,
+    };
+
+    enum FileResult : int8_t {
+        Pending,
+        Succeeded,
+        Failed,
+    };
+
+    static std::atomic<uint8_t>    phase(Idle);
+    static std::atomic<InputFile*> job(nullptr);
+    static std::atomic<int8_t>     fileResult(Pending);
+
+    // Set by job_started() while Idle, then read by the sampler and the writer
+    static Header      header;
+    static std::string outPath;
+    static TickType_t  startTick;
+    static uint32_t    dropped;  // Written by the sampler
+    static bool        jobSucceeded;
+
+    static Record*          records = nullptr;
+    static SpscRing<Record> ring;  // Filled by the sampler, emptied by the writer
+    static TimerHandle_t    timer  = nullptr;
+    static TaskHandle_t     writer = nullptr;
+
+    static uint16_t clamp16(float value) { return value <= 0 ? 0 : value >= 0xffff ? 0xffff : uint16_t(value); }
+
+    // Runs in the timer task, the only producer of the ring
+    static void sample(TimerHandle_t) {
+        uint8_t p = phase.load();
+        if (p != Recording && p != Ending) {
+            return;
+        }
+        if (ring.full()) {
+            ++dropped;
+        } else {
+            Record&       r     = *ring.back();
+            plan_block_t* block = plan_get_current_block();
+            int32_t       rpm   = spindle ? spindle->actualSpeed() : -1;
+            r.ms                = (xTaskGetTickCount() - startTick) * portTICK_PERIOD_MS;
+            r.line              = block ? plan_get_block_line_number(block) : 0;
+            r.feed              = clamp16(Stepper::get_realtime_rate());
+            r.speed             = clamp16(sys.spindle_speed);
+            r.actualSpeed       = rpm < 0 ? 0xffff : std::min<int32_t>(rpm, 0xfffe);
+            r.state             = uint8_t(sys.state);
+            r.alarm             = sys.state == State::Alarm ? uint8_t(lastAlarm) : 0;
+            r.feedOverride      = sys.f_override;
+            r.spindleOverride   = sys.spindle_speed_ovr;
+            r.reserved          = 0;
+            ring.push();
+        }
+        if (p == Ending) {
+            xTimerStop(timer, 0);
+            phase = Draining;
+            xTaskNotifyGive(writer);
+        }
+    }
+
+    static bool write(FileStream* file, const void* data, size_t length) {
+        return SdArbiter::write(*file, static_cast<const uint8_t*>(data), length, SdArbiter::Telemetry) == length;
+    }
+
+    static void close(FileStream*& file) {
+        SdArbiter::with(SdArbiter::Telemetry, [file] { delete file; });
+        file = nullptr;
+    }
+
+    // Writes the oldest samples in one piece, up to the end of the ring storage.  Without a
+    // file, as after a failed write, they are only dropped.
+    static void write_chunk(FileStream*& file, uint32_t& written) {
+        uint32_t n = std::min(std::min(ring.size(), chunkRecords), ring.capacity() - ring.tail());
+        if (file && !write(file, ring.front(), n * sizeof(Record))) {
+            log_error("Telemetry write to " << outPath << " failed");
+            close(file);
+        }
+        if (file) {
+            written += n;
+        }
+        while (n--) {
+            ring.pop();
+        }
+    }
+
+    static void write_task(void*) {
+        FileStream* file    = nullptr;
+        bool        opened  = false;  // Whether this recording has tried to open its file
+        uint32_t    written = 0;
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, 200 / portTICK_PERIOD_MS);
+            uint8_t p = phase.load();
+            if (p == Idle) {
+                continue;
+            }
+            if (!opened) {
+                opened  = true;
+                written = 0;
+                try {
+                    file = SdArbiter::with(SdArbiter::Telemetry, [] { return new FileStream(outPath, "w"); });
+                } catch (Error err) {
+                    log_error("Cannot write telemetry to " << outPath << ": " << errorString(err));
+                }
+                if (file && !write(file, &header, sizeof(header))) {
+                    log_error("Cannot write telemetry to " << outPath);
+                    close(file);
+                }
+            }
+            // Full chunks only while recording, so the card sees few and large writes
+            bool draining = p == Draining;
+            while (ring.size() >= chunkRecords || (draining && !ring.empty())) {
+                write_chunk(file, written);
+            }
+            if (!draining) {
+                continue;
+            }
+            if (file) {
+                Trailer trailer;
+                memset(&trailer, 0, sizeof(trailer));
+                memcpy(trailer.magic, "FEND", sizeof(trailer.magic));
+                trailer.records   = written;
+                trailer.dropped   = dropped;
+                trailer.ms        = (xTaskGetTickCount() - startTick) * portTICK_PERIOD_MS;
+                trailer.succeeded = jobSucceeded;
+                write(file, &trailer, sizeof(trailer));
+                close(file);
+                log_info("Telemetry: " << written << " samples in " << outPath << ", " << dropped << " lost");
+            }
+            opened = false;
+            phase  = Idle;
+        }
+    }
+
+    static bool setup() {
+        if (!records) {
+            records = static_cast<Record*>(malloc(ringRecords * sizeof(Record)));
+            if (!records) {
+                return false;
+            }
+            ring.init(records, ringRecords);
+        }
+        if (!timer && !(timer = xTimerCreate("Telemetry", 1, true, nullptr, sample))) {
+            return false;
+        }
+        return writer ||
+               xTaskCreatePinnedToCore(write_task,               // task
+                                       "telemetry",              // name for task
+                                       3072,                     // size of task stack
+                                       nullptr,                  // parameters
+                                       TELEMETRY_TASK_PRIORITY,  // priority
+                                       &writer,                  // task handle
+                                       TELEMETRY_TASK_CORE       // core
+                                       ) == pdPASS;
+    }
+
+    void job_started(InputFile& file) {
+        uint32_t periodMs = config->_sdCard ? config->_sdCard->_telemetryMs : 0;
+        if (!periodMs) {
+            return;
+        }
+        if (phase != Idle) {
+            log_warn("The telemetry of the last job is still being written, so this job has none");
+            return;
+        }
+        if (!setup()) {
+            log_error("No memory for telemetry");
+            return;
+        }
+        periodMs = std::max(periodMs, minPeriodMs);
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "FTLM", sizeof(header.magic));
+        header.version    = formatVersion;
+        header.recordSize = sizeof(Record);
+        header.periodMs   = periodMs;
+        header.run        = JobStats::file_runs();
+        strncpy(header.job, file.path().c_str(), sizeof(header.job) - 1);
+
+        outPath = file.path() + "." + std::to_string(header.run) + ".tlm";
+        ring.reset();
+        dropped    = 0;
+        startTick  = xTaskGetTickCount();
+        fileResult = Pending;
+        job        = &file;
+        phase      = Recording;
+        xTimerChangePeriod(timer, std::max<TickType_t>(periodMs / portTICK_PERIOD_MS, 1), 0);  // Also starts it
+        xTaskNotifyGive(writer);
+    }
+
+    void file_done(InputFile* file, bool succeeded) {
+        int8_t pending = Pending;
+        if (file && file == job.load()) {
+            fileResult.compare_exchange_strong(pending, succeeded ? Succeeded : Failed);
+        }
+    }
+
+    void poll() {
+        // The motion of the last lines runs on after the file has been read
+        if (phase != Recording || fileResult == Pending || plan_get_current_block()) {
+            return;
+        }
+        jobSucceeded = fileResult == Succeeded;
+        job          = nullptr;
+        phase        = Ending;
+    }
+}
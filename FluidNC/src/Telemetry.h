@@ -0,0 +1,77 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  Telemetry.h - a binary record of the state of the machine through each file job
+
+  With sdcard/telemetry_ms set, each file job started by $SD/Run, $LocalFS/Run or the job
+  queue is sampled at that period: the feed rate, the programmed and measured spindle
+  speed, the overrides, the state and any alarm, and the line being executed.  The samples
+  go into a ring in RAM, and a task below the priority of the file read tasks writes them
+  out a chunk at a time, so the card sees a few large sequential writes rather than one
+  per sample, and a job's reads come first at the card, as SdArbiter.h describes.  Each
+  run of a job gets its own file, <job>.<run>.tlm next to the job, where run is the count
+  of runs of the file that $Stats shows.  The file is complete once the motion of the job
+  has ended; telemetry.py turns it into CSV.
+
+  The file is a Header, a Record per sample, and a Trailer of the same size as a Record.
+  A file that ends without the trailer was cut short by a restart.  Samples that find the
+  ring full, as when the card is slow, are counted in the trailer rather than written.
+  There is no spindle load sensor in the machine model, so the load is not recorded.
+*/
+
+#include <cstdint>
+
+class InputFile;
+
+namespace Telemetry {
+    const uint16_t formatVersion = 1;
+    const uint32_t minPeriodMs   = 10;    // A shorter sdcard/telemetry_ms is taken as this
+    const uint32_t ringRecords   = 1024;  // Samples held in RAM
+    const uint32_t chunkRecords  = 256;   // Samples per write to the file
+
+    struct Header {
+        char     magic[4];  // "FTLM"
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t periodMs;
+        uint32_t run;  // Of the job file, as $Stats counts them
+        char     job[112];
+    };
+
+    struct Record {
+        uint32_t ms;            // Since the job started
+        uint32_t line;          // Line number of the block being executed, 0 for none
+        uint16_t feed;          // mm/min
+        uint16_t speed;         // Programmed spindle speed, RPM
+        uint16_t actualSpeed;   // Measured spindle speed, RPM, 0xffff without a tach
+        uint8_t  state;         // State
+        uint8_t  alarm;         // ExecAlarm while in the Alarm state, otherwise 0
+        uint8_t  feedOverride;  // Percent
+        uint8_t  spindleOverride;
+        uint16_t reserved;
+    };
+
+    struct Trailer {
+        char     magic[4];  // "FEND"
+        uint32_t records;   // Written
+        uint32_t dropped;   // Lost to a full ring
+        uint32_t ms;        // Length of the job
+        uint8_t  succeeded;
+        uint8_t  reserved[3];
+    };
+
+    static_assert(sizeof(Header) == 128, "The telemetry header is a fixed 128 bytes");
+    static_assert(sizeof(Record) == 20, "The telemetry format has 20 byte records");
+    static_assert(sizeof(Trailer) == sizeof(Record), "The trailer takes the place of a record");
+
+    // Called as a file job starts, after JobStats::file_started()
+    void job_started(InputFile& file);
+
+    // Called by a file job as it ends, from whichever task that happens in
+    void file_done(InputFile* file, bool succeeded);
+
+    // Called from the main loop to end the recording once the motion of the job has ended
+    void poll();
+}
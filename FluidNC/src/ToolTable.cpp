@@ -0,0 +1,179 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "ToolTable.h"
+
+#include "FileStream.h"
+#include "HashFS.h"  // HashFS::rehash_file()
+#include "Logging.h"
+#include "Planner.h"      // plan_get_current_block()
+#include "System.h"       // inMotionState()
+#include "ReadFloat.h"    // read_float()
+#include "FloatFormat.h"  // format_fixed()
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>  // xTaskGetTickCount()
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+
+namespace ToolTable {
+    static const char*    fileName  = "tool.tbl";
+    static const uint32_t holdoffMs = 2000;
+
+    static std::map<uint32_t, float> lengths;  // mm, by tool number
+    static bool                      dirty      = false;
+    static int32_t                   lastChange = 0;
+
+    static std::map<uint32_t, float> savedLengths;
+    static bool                      savedDirty      = false;
+    static int32_t                   savedLastChange = 0;
+
+    // Takes the T and Z words of a line, up to a ; comment
+    static void parse_line(const char* line) {
+        uint32_t tool     = 0;
+        float    z        = 0;
+        bool     haveTool = false;
+        bool     haveZ    = false;
+        for (size_t pos = 0; line[pos] && line[pos] != ';';) {
+            char  letter = toupper(line[pos++]);
+            float value;
+            if ((letter != 'T' && letter != 'Z') || !read_float(line, &pos, &value)) {
+                continue;
+            }
+            if (letter == 'T') {
+                haveTool = value >= 0;
+                tool     = uint32_t(value);
+            } else {
+                haveZ = true;
+                z     = value;
+            }
+        }
+        if (haveTool && haveZ) {
+            lengths[tool] = z;
+        }
+    }
+
+    static Error load() {
+        std::string text;
+        try {
+            FileStream file(fileName, "r");
+            char       buf[256];
+            size_t     n;
+            while ((n = file.read(buf, sizeof(buf))) > 0) {
+                text.append(buf, n);
+            }
+        } catch (...) { return Error::FsFailedOpenFile; }
+
+        lengths.clear();
+        for (size_t start = 0; start < text.length();) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) {
+                end = text.length();
+            }
+            std::string line = text.substr(start, end - start);
+            parse_line(line.c_str());
+            start = end + 1;
+        }
+        dirty = false;
+        return Error::Ok;
+    }
+
+    static void save() {
+        dirty = false;
+        try {
+            std::filesystem::path fpath;
+            {
+                FileStream file(fileName, "w");
+                for (auto const& [tool, mm] : lengths) {
+                    char value[fixedFormatMax];
+                    format_fixed(value, mm, 4);
+                    std::string line = "T" + std::to_string(tool) + " Z" + value + "\n";
+                    file.write(reinterpret_cast<const uint8_t*>(line.data()), line.length());
+                }
+                fpath = file.fpath();
+            }
+            HashFS::rehash_file(fpath);
+        } catch (...) { log_error("Cannot write the tool table to " << fileName); }
+    }
+
+    void init() {
+        if (load() == Error::Ok) {
+            log_info("Tool table has " << lengths.size() << " tools");
+        }
+    }
+
+    void poll() {
+        if (!dirty || plan_get_current_block() || inMotionState()) {
+            return;
+        }
+        if (int32_t(xTaskGetTickCount() - lastChange) < int32_t(holdoffMs / portTICK_PERIOD_MS)) {
+            return;
+        }
+        save();
+    }
+
+    void flush() {
+        if (dirty) {
+            save();
+        }
+    }
+
+    bool length(uint32_t tool, float& mm) {
+        auto it = lengths.find(tool);
+        if (it == lengths.end()) {
+            return false;
+        }
+        mm = it->second;
+        return true;
+    }
+
+    void set_length(uint32_t tool, float mm) {
+        auto it = lengths.find(tool);
+        if (it != lengths.end() && it->second == mm) {
+            return;
+        }
+        lengths[tool] = mm;
+        dirty         = true;
+        lastChange    = xTaskGetTickCount();
+    }
+
+    void checkpoint() {
+        savedLengths    = lengths;
+        savedDirty      = dirty;
+        savedLastChange = lastChange;
+    }
+
+    void rollback() {
+        lengths    = savedLengths;
+        dirty      = savedDirty;
+        lastChange = savedLastChange;
+    }
+
+    void fingerprint(const std::function<void(const void*, size_t)>& feed) {
+        for (auto const& [tool, mm] : lengths) {
+            feed(&tool, sizeof(tool));
+            feed(&mm, sizeof(mm));
+        }
+    }
+
+    Error show(const char* value, Channel& out) {
+        if (value && *value) {
+            if (strcasecmp(value, "LOAD")) {
+                return Error::InvalidValue;
+            }
+            Error err = load();
+            if (err != Error::Ok) {
+                log_error_to(out, "Cannot read " << fileName);
+                return err;
+            }
+        }
+        for (auto const& [tool, mm] : lengths) {
+            char length[fixedFormatMax];
+            format_fixed(length, mm, 4);
+            log_stream(out, "[TOOL:" << tool << "," << length);
+        }
+        return Error::Ok;
+    }
+}
@@ -0,0 +1,58 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  ToolTable.h - tool lengths kept on the local file system
+
+  The table is read from tool.tbl at startup, one tool per line in the LinuxCNC form
+
+    T1 Z-12.3450 ; 6mm end mill
+
+  of which only the T and Z words are used.  G43 Hn takes the length of tool n, or of
+  the tool last selected with T if there is no H word, as the tool length offset.
+  G10 L1 Pn Z sets the length of tool n, and G10 L10 Pn Z sets it so that the current
+  position reads Z with the current offsets, which is what touching off on the
+  toolsetter needs: G38.2 down to it, then G10 L10 Pn Z<height of the toolsetter>.
+  If tool n is the one that G43 applied, the new length becomes the offset at once.
+
+  The offset only changes the targets of the following moves, which the planner holds
+  in machine coordinates, so no change waits for the planner to empty.  The file is
+  written back, without comments, once the machine has stopped and the table has not
+  changed for a couple of seconds, so a cycle that touches off one tool after another
+  writes it once.
+*/
+
+#include "Error.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+class Channel;
+
+namespace ToolTable {
+    // Reads the table from the local file system, which must be mounted
+    void init();
+
+    // Called from the main loop to write changes when idle
+    void poll();
+
+    // Writes any changes now.  Used before a restart.
+    void flush();
+
+    // The length of a tool in mm, returning false if the tool is not in the table
+    bool length(uint32_t tool, float& mm);
+
+    void set_length(uint32_t tool, float mm);
+
+    // Sets the table aside, and puts it back, around a run in check mode that must leave it as
+    // it was.  fingerprint() passes the lengths to feed, for a hash of the state that a
+    // file runs in.
+    void checkpoint();
+    void rollback();
+    void fingerprint(const std::function<void(const void*, size_t)>& feed);
+
+    // $Tools lists the table, and $Tools=LOAD reads it again from the file
+    Error show(const char* value, Channel& out);
+}
@@ -84,32 +84,36 @@ bool UTF8::decode(const std::vector<uint8_t>& input, uint32_t& value) {
     // Reached end of input without finishing the decode
     return false;
 }
-std::vector<uint8_t> UTF8::encode(const uint32_t value) {
-    std::vector<uint8_t> output;
+size_t UTF8::encode(uint32_t value, uint8_t* out) {
     if (value >= 0x110000) {
-        // In this case, the returned vector will be empty
-        return output;
+        return 0;
     }
-    if (value >= 0x100000) {
-        output.push_back(0xf0 | ((value >> 18) & 0x07));
-        output.push_back(0x80 | ((value >> 12) & 0x3f));
-        output.push_back(0x80 | ((value >> 6) & 0x3f));
-        output.push_back(0x80 | (value & 0x3f));
-        return output;
+    if (value >= 0x10000) {
+        out[0] = 0xf0 | ((value >> 18) & 0x07);
+        out[1] = 0x80 | ((value >> 12) & 0x3f);
+        out[2] = 0x80 | ((value >> 6) & 0x3f);
+        out[3] = 0x80 | (value & 0x3f);
+        return 4;
     }
     if (value >= 0x800) {
-        output.push_back(0xe0 | ((value >> 12) & 0x0f));
-        output.push_back(0x80 | ((value >> 6) & 0x3f));
-        output.push_back(0x80 | (value & 0x3f));
-        return output;
+        out[0] = 0xe0 | ((value >> 12) & 0x0f);
+        out[1] = 0x80 | ((value >> 6) & 0x3f);
+        out[2] = 0x80 | (value & 0x3f);
+        return 3;
     }
     if (value >= 0x80) {
-        output.push_back(0xc0 | ((value >> 6) & 0x01f));
-        output.push_back(0x80 | (value & 0x3f));
-        return output;
+        out[0] = 0xc0 | ((value >> 6) & 0x01f);
+        out[1] = 0x80 | (value & 0x3f);
+        return 2;
     }
-    output.push_back(value);
-    return output;
+    out[0] = value;
+    return 1;
+}
+
+std::vector<uint8_t> UTF8::encode(const uint32_t value) {
+    // In the case of an invalid value, the returned vector will be empty
+    uint8_t bytes[4];
+    return std::vector<uint8_t>(bytes, bytes + encode(value, bytes));
 }
 
 #ifdef TEST_UTF8
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -21,6 +22,10 @@ public:
 
     // Encode to vector
     std::vector<uint8_t> encode(const uint32_t value);
+
+    // Encode into out, which must have room for 4 bytes, without allocating.  Returns
+    // the length, which is 0 if the value is not a code point.
+    static size_t encode(uint32_t value, uint8_t* out);
 };
 
 void test_UTF8();
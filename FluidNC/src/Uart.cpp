@@ -12,8 +12,35 @@
 
 Uart::Uart(int uart_num) : _uart_num(uart_num) {}
 
+uint32_t Uart::overflows = 0;
+
+struct DriverInstall {
+    uart_port_t    port;
+    int            rxBufferSize;
+    int            txBufferSize;
+    int            queueLength;
+    QueueHandle_t* queue;
+    esp_err_t      err;
+};
+
 static void uart_driver_n_install(void* arg) {
-    uart_driver_install((uart_port_t)arg, 256, 0, 0, NULL, ESP_INTR_FLAG_IRAM);
+    auto args = static_cast<DriverInstall*>(arg);
+    uart_driver_delete(args->port);
+    args->err = uart_driver_install(args->port, args->rxBufferSize, args->txBufferSize, args->queueLength, args->queue, ESP_INTR_FLAG_IRAM);
+}
+
+// The queue of a UART that is not in frame mode is only looked at for overflows, so a
+// few entries are enough; the driver drops the events that do not fit.
+static const int overflowQueueLength = 4;
+
+bool Uart::installDriver(int queueLength) {
+    DriverInstall args = { uart_port_t(_uart_num), _rxBufferSize, _txBufferSize, queueLength, &_events, ESP_FAIL };
+    esp_ipc_call_blocking(0, uart_driver_n_install, &args);
+    if (args.err != ESP_OK) {
+        _events = nullptr;
+        return true;
+    }
+    return false;
 }
 
 // This version is used for the initial console UART where we do not want to change the pins
@@ -25,8 +52,8 @@ void Uart::begin(unsigned long baud, UartData dataBits, UartStop stopBits, UartP
     conf.data_bits           = uart_word_length_t(_dataBits);
     conf.parity              = uart_parity_t(_parity);
     conf.stop_bits           = uart_stop_bits_t(_stopBits);
-    conf.flow_ctrl           = UART_HW_FLOWCTRL_DISABLE;
-    conf.rx_flow_ctrl_thresh = 0;
+    conf.flow_ctrl           = flowControl();
+    conf.rx_flow_ctrl_thresh = UART_FIFO_LEN - 8;  // RTS goes inactive while the FIFO is nearly full
     if (uart_param_config(uart_port_t(_uart_num), &conf) != ESP_OK) {
         // TODO FIXME - should this throw an error?
         return;
@@ -34,7 +61,9 @@ void Uart::begin(unsigned long baud, UartData dataBits, UartStop stopBits, UartP
 
     // We init UARTs on core 0 so the interrupt handler runs there,
     // thus avoiding conflict with the StepTimer interrupt
-    esp_ipc_call_blocking(0, uart_driver_n_install, (void*)_uart_num);
+    if (installDriver(overflowQueueLength)) {
+        log_error("UART" << _uart_num << " driver install failed");
+    }
 }
 
 // This version is used when we have a config section with all the parameters
@@ -64,6 +93,17 @@ int Uart::read() {
     return res == 1 ? c : -1;
 }
 
+size_t Uart::read(uint8_t* buffer, size_t len) {
+    countOverflows();
+    size_t count = 0;
+    if (len && _pushback != -1) {
+        buffer[count++] = _pushback;
+        _pushback       = -1;
+    }
+    int res = uart_read_bytes(uart_port_t(_uart_num), buffer + count, len - count, 0);
+    return count + (res < 0 ? 0 : res);
+}
+
 size_t Uart::write(uint8_t c) {
     // Use Uart::write(buf, len) instead of uart_write_bytes() for _addCR
     return write(&c, 1);
@@ -84,9 +124,70 @@ size_t Uart::timedReadBytes(char* buffer, size_t len, TickType_t timeout) {
     return res < 0 ? 0 : res;
 }
 
+uart_hw_flowcontrol_t Uart::flowControl() {
+    if (!_hwFlowControl) {
+        return UART_HW_FLOWCTRL_DISABLE;
+    }
+    if (_rts_pin.undefined()) {
+        return UART_HW_FLOWCTRL_CTS;
+    }
+    return _cts_pin.undefined() ? UART_HW_FLOWCTRL_RTS : UART_HW_FLOWCTRL_CTS_RTS;
+}
+
 bool Uart::setHalfDuplex() {
+    if (_hwFlowControl) {
+        return true;  // The RS485 mode drives RTS for the direction
+    }
     return uart_set_mode(uart_port_t(_uart_num), UART_MODE_RS485_HALF_DUPLEX) != ESP_OK;
 }
+bool Uart::setRxIdleTimeout(int symbols) {
+    return uart_set_rx_timeout(uart_port_t(_uart_num), symbols) != ESP_OK;
+}
+bool Uart::enableFrameEvents(int queueLength) {
+    if (_frameEvents) {
+        return false;
+    }
+    // Like begin(), on core 0 so the interrupt handler runs there.  The mode and
+    // rx timeout are hardware settings that survive reinstalling the driver.
+    if (installDriver(queueLength)) {
+        installDriver(overflowQueueLength);
+        return true;
+    }
+    _frameEvents = true;
+    return false;
+}
+void Uart::countOverflows() {
+    uart_event_t event;
+    while (!_frameEvents && _events && xQueueReceive(_events, &event, 0) == pdTRUE) {
+        if (event.type == UART_FIFO_OVF) {
+            ++overflows;
+        }
+    }
+}
+size_t Uart::readFrame(uint8_t* buffer, size_t len, TickType_t timeout) {
+    size_t       count = 0;
+    uart_event_t event;
+    while (count < len && xQueueReceive(_events, &event, timeout) == pdTRUE) {
+        switch (event.type) {
+            case UART_DATA:
+                count += read(buffer + count, len - count);
+                if (event.timeout_flag) {
+                    return count;  // The line went idle, so the frame is complete
+                }
+                break;
+            case UART_FIFO_OVF:
+                ++overflows;
+                flushRx();
+                return 0;
+            case UART_BUFFER_FULL:
+                flushRx();
+                return 0;
+            default:
+                break;
+        }
+    }
+    return count;
+}
 bool Uart::setPins(int tx_pin, int rx_pin, int rts_pin, int cts_pin) {
     return uart_set_pin(uart_port_t(_uart_num), tx_pin, rx_pin, rts_pin, cts_pin) != ESP_OK;
 }
@@ -95,11 +196,12 @@ bool Uart::flushTxTimed(TickType_t ticks) {
 }
 
 void Uart::config_message(const char* prefix, const char* usage) {
-    log_info(prefix << usage << " Tx:" << _txd_pin.name() << " Rx:" << _rxd_pin.name() << " RTS:" << _rts_pin.name() << " Baud:" << _baud);
+    log_info(prefix << usage << " Tx:" << _txd_pin.name() << " Rx:" << _rxd_pin.name() << " RTS:" << _rts_pin.name() << " Baud:" << _baud
+                     << (_hwFlowControl ? " Flow:RTS/CTS" : ""));
 }
 
 int Uart::rx_buffer_available(void) {
-    return UART_FIFO_LEN - available();
+    return _rxBufferSize - available();
 }
 
 int Uart::peek() {
@@ -123,6 +225,9 @@ int Uart::available() {
 void Uart::flushRx() {
     _pushback = -1;
     uart_flush_input(uart_port_t(_uart_num));
+    if (_events) {
+        xQueueReset(_events);
+    }
 }
 
 #if 0
@@ -10,6 +10,7 @@
 #include "UartTypes.h"
 
 #include <freertos/FreeRTOS.h>  // TickType_T
+#include <freertos/queue.h>     // QueueHandle_t
 
 class Uart : public Stream, public Configuration::Configurable {
 private:
@@ -22,8 +23,16 @@ private:
 
     bool setPins(int tx_pin, int rx_pin, int rts_pin = -1, int cts_pin = -1);
 
+    uart_hw_flowcontrol_t flowControl();
+
     int _uart_num = 0;  // Hardware UART engine number
 
+    QueueHandle_t _events      = nullptr;  // Driver events
+    bool          _frameEvents = false;    // _events is for readFrame(), after enableFrameEvents()
+
+    bool installDriver(int queueLength);
+    void countOverflows();
+
 public:
     // These are public so that validators from classes
     // that use Uart can check that the setup is suitable.
@@ -35,6 +44,16 @@ public:
     UartParity _parity   = UartParity::None;
     UartStop   _stopBits = UartStop::Bits1;
 
+    // Driver buffers, beyond the 128-byte hardware FIFOs.  With no TX buffer,
+    // write() waits until its data fits in the FIFO.
+    int _rxBufferSize = 256;
+    int _txBufferSize = 0;
+
+    // RTS/CTS flow control with whichever of _rts_pin and _cts_pin are defined.  RTS
+    // then tells the sender to pause while the receive FIFO is nearly full, which
+    // cannot be combined with setHalfDuplex().
+    bool _hwFlowControl = false;
+
     Pin _txd_pin;
     Pin _rxd_pin;
     Pin _rts_pin;
@@ -47,6 +66,9 @@ public:
         return nstr;
     }
 
+    // Times a receiver FIFO overflowed and data was lost, for /metrics
+    static uint32_t overflows;
+
     Uart(int uart_num = -1);
     void begin();
     void begin(unsigned long baud, UartData dataBits, UartStop stopBits, UartParity parity);
@@ -57,6 +79,9 @@ public:
     int available(void) override;
     int read(void) override;
 
+    // Reads up to len characters that are already buffered, without waiting
+    size_t read(uint8_t* buffer, size_t len);
+
     // Print methods (Stream inherits from Print)
     size_t write(uint8_t data) override;
     size_t write(const uint8_t* buffer, size_t length) override;
@@ -67,16 +92,32 @@ public:
     size_t timedReadBytes(char* buffer, size_t len, TickType_t timeout);
     size_t timedReadBytes(uint8_t* buffer, size_t len, TickType_t timeout) { return timedReadBytes((char*)buffer, len, timeout); }
 
-    // Used by VFDSpindle
+    // Used by ModbusBus
     bool flushTxTimed(TickType_t ticks);
 
-    // Used by VFDSpindle and Dynamixel2
+    // Used by ModbusBus and Dynamixel2
     bool setHalfDuplex();
 
+    // Used by ModbusBus.  Received bytes are handed over once the line has been
+    // idle for this many character times, instead of the driver default.
+    bool setRxIdleTimeout(int symbols);
+
+    // Used by ModbusBus.  Reinstalls the driver with an event queue, so that
+    // readFrame() can sleep until the receiver reports that the line went idle,
+    // instead of waking for every chunk of a response.
+    bool enableFrameEvents(int queueLength = 8);
+
+    // Reads one frame, ended by the rx idle timeout, waiting up to timeout for
+    // it to arrive.  Stale frames are discarded by flushRx().  Returns the
+    // number of bytes read.
+    size_t readFrame(uint8_t* buffer, size_t len, TickType_t timeout);
+
     // Configuration handlers:
     void validate() override {
         Assert(!_txd_pin.undefined(), "UART: TXD is undefined");
         Assert(!_rxd_pin.undefined(), "UART: RXD is undefined");
+        Assert(!_hwFlowControl || !_rts_pin.undefined() || !_cts_pin.undefined(), "UART: flow_control needs rts_pin or cts_pin");
+        Assert(_txBufferSize == 0 || _txBufferSize > 128, "UART: tx_buffer_size must be 0 or more than 128");
         // RTS and CTS are optional.
     }
 
@@ -90,6 +131,9 @@ public:
 
         handler.item("baud", _baud, 2400, 4000000);
         handler.item("mode", _dataBits, _parity, _stopBits);
+        handler.item("flow_control", _hwFlowControl);
+        handler.item("rx_buffer_size", _rxBufferSize, 256, 16384);
+        handler.item("tx_buffer_size", _txBufferSize, 0, 16384);
     }
 
     void config_message(const char* prefix, const char* usage);
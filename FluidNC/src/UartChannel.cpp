@@ -95,19 +95,24 @@ int UartChannel::read() {
     return _uart->read();
 }
 
+size_t UartChannel::read(uint8_t* buffer, size_t length) {
+    return _uart->read(buffer, length);
+}
+
 void UartChannel::flushRx() {
     _uart->flushRx();
     Channel::flushRx();
 }
 
 size_t UartChannel::timedReadBytes(char* buffer, size_t length, TickType_t timeout) {
-    // It is likely that _queue will be empty because timedReadBytes() is only
+    // It is likely that the ring will be empty because timedReadBytes() is only
     // used in situations where the UART is not receiving GCode commands
     // and Grbl realtime characters.
     size_t remlen = length;
-    while (remlen && _queue.size()) {
-        *buffer++ = _queue.front();
-        _queue.pop();
+    while (remlen && !_rxRing.empty()) {
+        *buffer++ = *_rxRing.front();
+        _rxRing.pop();
+        --remlen;
     }
 
     int res = _uart->timedReadBytes(buffer, remlen, timeout);
@@ -138,7 +143,9 @@ void UartChannel::out_acked(const std::string& s, const char* tag) {
 UartChannel Uart0(0, true);  // Primary serial channel with LF to CRLF conversion
 
 void uartInit() {
-    auto uart0 = new Uart(0);
+    auto uart0           = new Uart(0);
+    uart0->_rxBufferSize = UART0_RX_BUFFER_SIZE;
+    uart0->_txBufferSize = UART0_TX_BUFFER_SIZE;
     uart0->begin(BAUD_RATE, UartData::Bits8, UartStop::Bits1, UartParity::None);
     Uart0.init(uart0);
 }
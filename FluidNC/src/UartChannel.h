@@ -28,9 +28,10 @@ public:
     size_t write(const uint8_t* buf, size_t len) override;
 
     // Stream methods (Channel inherits from Stream)
-    int peek(void) override;
-    int available(void) override;
-    int read() override;
+    int    peek(void) override;
+    int    available(void) override;
+    int    read() override;
+    size_t read(uint8_t* buffer, size_t length) override;
 
     // Channel methods
     int    rx_buffer_available() override;
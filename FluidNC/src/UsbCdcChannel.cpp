@@ -0,0 +1,129 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "UsbCdcChannel.h"
+#include "Serial.h"  // allChannels
+
+#include <sdkconfig.h>  // CONFIG_IDF_TARGET_*
+
+#if CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
+#    define HAVE_USB_CDC
+#    if ARDUINO_USB_MODE
+#        include <HWCDC.h>
+#        if ARDUINO_USB_CDC_ON_BOOT
+static HWCDC& port = Serial;
+#        else
+static HWCDC& port = USBSerial;
+#        endif
+#    else
+#        include <USB.h>
+static USBCDC port(0);
+#    endif
+#endif
+
+UsbCdcChannel::UsbCdcChannel() : Channel("usb_cdc", true) {
+    _lineedit = new Lineedit(this, _line, Channel::maxLine - 1);
+}
+
+void UsbCdcChannel::init() {
+#ifdef HAVE_USB_CDC
+    // The buffer must be set before begin() allocates it
+    port.setRxBufferSize(_rx_buffer_size);
+#    if ARDUINO_USB_MODE
+    port.setTxTimeoutMs(0);  // Output is dropped, not waited on, when no host is listening
+    port.begin();
+#    else
+    port.begin();
+    USB.begin();
+#    endif
+    allChannels.registration(this);
+    setReportInterval(_report_interval_ms);
+    log_info("usb_cdc_channel created with a " << _rx_buffer_size << " byte receive buffer");
+#else
+    log_error("usb_cdc_channel needs an ESP32-S2 or S3");
+#endif
+}
+
+size_t UsbCdcChannel::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+// As for Bluetooth, the data goes out in runs between the CRs that are added, so that a
+// message fills a few USB packets instead of one per character
+size_t UsbCdcChannel::write(const uint8_t* buffer, size_t length) {
+#ifdef HAVE_USB_CDC
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (_addCR && buffer[i] == '\n' && (i ? buffer[i - 1] : _lastOut) != '\r') {
+            port.write(buffer + start, i - start);
+            port.write('\r');
+            start = i;
+        }
+    }
+    port.write(buffer + start, length - start);
+    if (length) {
+        _lastOut = buffer[length - 1];
+    }
+#endif
+    return length;
+}
+
+int UsbCdcChannel::available() {
+#ifdef HAVE_USB_CDC
+    return port.available() + _rxRing.size();
+#else
+    return _rxRing.size();
+#endif
+}
+
+int UsbCdcChannel::peek() {
+#ifdef HAVE_USB_CDC
+    return port.peek();
+#else
+    return -1;
+#endif
+}
+
+int UsbCdcChannel::read() {
+#ifdef HAVE_USB_CDC
+    return port.read();
+#else
+    return -1;
+#endif
+}
+
+size_t UsbCdcChannel::read(uint8_t* buffer, size_t length) {
+#ifdef HAVE_USB_CDC
+    return port.read(buffer, length);
+#else
+    return 0;
+#endif
+}
+
+// The host does not overrun the driver's buffer, so the window only has to keep a
+// character-counting sender from waiting on acks, and can be as large as the buffer
+int UsbCdcChannel::rx_buffer_available() {
+    return std::max(0, std::min(rxWindow(), _rx_buffer_size) - available());
+}
+
+void UsbCdcChannel::flushRx() {
+#ifdef HAVE_USB_CDC
+    uint8_t discard[64];
+    while (port.read(discard, sizeof(discard))) {}
+#endif
+    Channel::flushRx();
+}
+
+bool UsbCdcChannel::realtimeOkay(char c) {
+    return _lineedit->realtime(c);
+}
+
+bool UsbCdcChannel::lineComplete(char* line, char c) {
+    if (_lineedit->step(c)) {
+        _linelen        = _lineedit->finish();
+        _line[_linelen] = '\0';
+        strcpy(line, _line);
+        _linelen = 0;
+        return true;
+    }
+    return false;
+}
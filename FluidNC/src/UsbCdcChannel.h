@@ -0,0 +1,60 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  UsbCdcChannel.h - a channel on the native USB peripheral of the ESP32-S2 and S3
+
+    usb_cdc_channel:
+      rx_buffer_size: 16384
+      report_interval_ms: 0
+      message_level: Info
+
+  The link runs at the USB full speed rate whatever baud rate the host asks for, and the
+  host stops sending while the receive buffer is full instead of losing data, so a sender
+  can stream with a large window without counting characters against a small UART FIFO.
+  The S2, and S3 builds with ARDUINO_USB_MODE=0, use TinyUSB's CDC class; the other S3
+  builds use the USB Serial/JTAG controller.  On the ESP32, which has no USB peripheral,
+  init() only reports that the section cannot be used.
+*/
+
+#include "Channel.h"
+#include "lineedit.h"
+#include "Configuration/Configurable.h"
+
+class UsbCdcChannel : public Channel, public Configuration::Configurable {
+private:
+    Lineedit* _lineedit;
+
+    int     _rx_buffer_size     = 16384;
+    int     _report_interval_ms = 0;
+    uint8_t _lastOut            = '\0';
+
+public:
+    UsbCdcChannel();
+
+    void init();
+
+    // Print methods (Stream inherits from Print)
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+
+    // Stream methods (Channel inherits from Stream)
+    int    peek(void) override;
+    int    available(void) override;
+    int    read() override;
+    size_t read(uint8_t* buffer, size_t length) override;
+
+    // Channel methods
+    int  rx_buffer_available() override;
+    void flushRx() override;
+    bool realtimeOkay(char c) override;
+    bool lineComplete(char* line, char c) override;
+
+    // Configuration methods
+    void group(Configuration::HandlerBase& handler) override {
+        handler.item("rx_buffer_size", _rx_buffer_size, 1024, 65536);
+        handler.item("report_interval_ms", _report_interval_ms);
+        handler.item("message_level", _message_level, messageLevels2);
+    }
+};
@@ -0,0 +1,146 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "WebHook.h"
+
+#include "ProcessSettings.h"   // urlFeedback, ReconnectWifi()
+#include "WebUI/WifiConfig.h"  // URL_ToCall
+#include "Config.h"            // WEBHOOK_TASK_CORE
+#include "Logging.h"
+
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <cstring>
+
+namespace WebHook {
+    static const int        queueLength    = 8;
+    static const size_t     maxQuery       = 192;
+    static const int        maxAttempts    = 9;
+    static const TickType_t firstRetryWait = 500 / portTICK_PERIOD_MS;
+    static const TickType_t maxRetryWait   = 8000 / portTICK_PERIOD_MS;
+    static const TickType_t idleClose      = 60000 / portTICK_PERIOD_MS;
+
+    struct Message {
+        char query[maxQuery];
+    };
+
+    static QueueHandle_t queue = nullptr;
+
+    // The one connection to the URLToCall host.  It is kept open between calls when the
+    // server allows keep-alive, so that only the first call of a job pays for the TLS
+    // handshake, and closed after idleClose without calls, or on any failure, so that the
+    // heap that TLS holds is only in use around jobs.
+    class Connection {
+        WiFiClientSecure _client;
+        HTTPClient       _http;
+        String           _host;
+
+    public:
+        bool open() { return _client.connected(); }
+
+        void close() {
+            if (open()) {
+                log_debug("Closing URL connection");
+            }
+            _client.stop();
+        }
+
+        urlFeedback call(const char* query) {
+            String host = WebUI::URL_ToCall->get();
+            if (host == "") {
+                log_debug("No URL to call");
+                return NO_URL;
+            }
+            if (!((WiFi.status() == WL_CONNECTED) && ((WiFi.getMode() == WIFI_MODE_STA) || (WiFi.getMode() == WIFI_MODE_APSTA)))) {
+                log_debug("Wifi is not connected in STA Mode");
+                close();
+                return NO_GOOD_MODE;
+            }
+            if (host != _host) {
+                close();
+                _host = host;
+            }
+
+            String url = host;
+            if (*query) {
+                url += "?";
+                url += query;
+            }
+            log_debug("URL to call  : " << url.c_str() << (open() ? " (reusing connection)" : ""));
+
+            _client.setInsecure();
+            _http.setReuse(true);
+            _http.begin(_client, url.c_str());
+            int httpCode = _http.GET();
+            _http.end();  // Keeps the connection for the next call if the server allows it
+
+            if (httpCode > 0) {
+                log_info("URL call successful");
+                return URL_CALL_OK;
+            }
+            log_info("Failed to call URL");
+            close();
+            return NOT_SUCCESSFUL;
+        }
+    };
+
+    // Sends the queued notifications one at a time.  A failed call is retried after a wait
+    // that doubles each time, and the station is asked to reconnect if it has dropped.
+    static void dispatcher(void* unused) {
+        Connection connection;
+        Message    msg;
+        while (true) {
+            if (!xQueueReceive(queue, &msg, connection.open() ? idleClose : portMAX_DELAY)) {
+                connection.close();
+                continue;
+            }
+            TickType_t wait = firstRetryWait;
+            for (int attempt = 1; connection.call(msg.query) == NOT_SUCCESSFUL; attempt++) {
+                if (attempt == maxAttempts) {
+                    log_warn("URL call failed after " << maxAttempts << " attempts");
+                    break;
+                }
+                log_info("Retry URL call : " << attempt << "/" << (maxAttempts - 1));
+                if (WiFi.status() != WL_CONNECTED) {
+                    connection.close();
+                    ReconnectWifi();
+                }
+                vTaskDelay(wait);
+                wait = std::min(wait * 2, maxRetryWait);
+            }
+        }
+    }
+
+    bool post(const String& query) {
+        if (WiFi.getMode() == WIFI_MODE_NULL) {
+            return false;
+        }
+        if (query.length() >= maxQuery) {
+            log_warn("URL query too long to send: " << query.c_str());
+            return false;
+        }
+        // The task is started by the first notification, so it costs nothing if none are set up
+        if (!queue) {
+            queue = xQueueCreate(queueLength, sizeof(Message));
+            xTaskCreatePinnedToCore(dispatcher,             // task
+                                    "webhook",              // name for task
+                                    8192,                   // size of task stack, enough for TLS
+                                    nullptr,                // parameters
+                                    WEBHOOK_TASK_PRIORITY,  // priority
+                                    nullptr,                // task handle
+                                    WEBHOOK_TASK_CORE       // core
+            );
+        }
+        Message msg;
+        strcpy(msg.query, query.c_str());
+        if (xQueueSend(queue, &msg, 0) != pdTRUE) {
+            log_warn("URL call queue full; dropped " << msg.query);
+            return false;
+        }
+        return true;
+    }
+}
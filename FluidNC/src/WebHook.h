@@ -0,0 +1,21 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  WebHook.h - job event notifications to the URL of the URLToCall setting
+
+  The G-code parser posts the start and end of job notifications here instead of calling
+  the URL itself, so that motion never waits on the network.  A background task sends
+  them in order, retrying failed calls with growing delays, and keeps the connection to
+  the server open between calls so that later notifications skip the TLS handshake.
+  The connection is closed after a minute without calls, to give back its heap.
+*/
+
+#include <WString.h>
+
+namespace WebHook {
+    // Queues a call of the URL with query appended.  Never blocks; if the queue is full the
+    // notification is dropped with a warning.  Returns false if it was not queued.
+    bool post(const String& query);
+}
@@ -30,14 +30,37 @@ const uint8_t* esp_bt_dev_get_address(void);
 namespace WebUI {
     EnumSetting*   bt_enable;
     StringSetting* bt_name;
+    IntSetting*    bt_rx_buffer;
+
+    size_t BTChannel::write(uint8_t data) { return write(&data, 1); }
+
+    // Passes the data on in runs between the CRs that it adds, so a message goes out in a
+    // few SPP packets instead of one per character
+    size_t BTChannel::write(const uint8_t* buffer, size_t length) {
+        size_t start = 0;
+        for (size_t i = 0; i < length; i++) {
+            if (_addCR && buffer[i] == '\n' && (i ? buffer[i - 1] : _lastOut) != '\r') {
+                SerialBT.write(buffer + start, i - start);
+                SerialBT.write('\r');
+                start = i;
+            }
+        }
+        SerialBT.write(buffer + start, length - start);
+        if (length) {
+            _lastOut = buffer[length - 1];
+        }
+        return length;
+    }
 
-    size_t BTChannel::write(uint8_t data) {
-        static uint8_t lastchar = '\0';
-        if (_addCR && data == '\n' && lastchar != '\r') {
-            SerialBT.write('\r');
+    void BTChannel::setRxBuffer(size_t size) {
+        delete[] _rxStorage;
+        _rxStorage = nullptr;
+        if (size > rxRingSize) {
+            _rxStorage = new uint8_t[size];
+            _rxRing.init(_rxStorage, size);
+        } else {
+            _rxRing.init(_rxBuffer, rxRingSize);
         }
-        lastchar = data;
-        return SerialBT.write(data);
     }
 
     BTConfig* BTConfig::instance = nullptr;
@@ -54,6 +77,9 @@ namespace WebUI {
                                     WebUI::BTConfig::MIN_BTNAME_LENGTH,
                                     WebUI::BTConfig::MAX_BTNAME_LENGTH,
                                     (bool (*)(char*))BTConfig::isBTnameValid);
+
+        bt_rx_buffer = new IntSetting(
+            "Bluetooth receive buffer", WEBSET, WA, NULL, "Bluetooth/RxBuffer", 4096, Channel::rxRingSize, Channel::maxStreamWindow, NULL);
     }
 
     void BTConfig::my_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t* param) {
@@ -125,10 +151,6 @@ namespace WebUI {
         return str;
     }
 
-    int BTChannel::available() { return SerialBT.available(); }
-    int BTChannel::read() { return SerialBT.read(); }
-    int BTChannel::peek() { return SerialBT.peek(); }
-
     bool BTChannel::realtimeOkay(char c) { return _lineedit->realtime(c); }
 
     bool BTChannel::lineComplete(char* line, char c) {
@@ -173,6 +195,8 @@ namespace WebUI {
         if (bt_enable->get() && _btname.length()) {
             esp_bt_mem_release(ESP_BT_MODE_BLE);
             log_debug("Heap: " << xPortGetFreeHeapSize());
+            btChannel.setRxBuffer(bt_rx_buffer->get());
+            SerialBT.onData([](const uint8_t* data, size_t length) { btChannel.push(const_cast<uint8_t*>(data), length); });
             if (!SerialBT.begin(_btname.c_str())) {
                 log_error("Bluetooth failed to start");
                 return false;
@@ -31,25 +31,31 @@ const char* const DEFAULT_BT_NAME = "FluidNC";
 namespace WebUI {
     extern EnumSetting*   bt_enable;
     extern StringSetting* bt_name;
+    extern IntSetting*    bt_rx_buffer;
 
     extern BluetoothSerial SerialBT;
 
+    // Received data is pushed into the channel's ring from the Bluetooth task as it
+    // arrives, as for WebSockets, instead of waiting in BluetoothSerial's 512 byte queue
+    // to be read a character at a time.  The ring can be made larger than that of the
+    // other channels with Bluetooth/RxBuffer, for streaming with a large window.
     class BTChannel : public Channel {
     private:
         Lineedit* _lineedit;
+        uint8_t*  _rxStorage = nullptr;  // Ring storage, if larger than the inline one
+        uint8_t   _lastOut   = '\0';
 
     public:
         // BTChannel(bool addCR = false) : _linelen(0), _addCR(addCR) {}
         BTChannel() : Channel("bluetooth", true) { _lineedit = new Lineedit(this, _line, Channel::maxLine - 1); }
         virtual ~BTChannel() = default;
 
-        int    available() override;
-        int    read() override;
-        int    peek() override;
         void   flush() override { SerialBT.flush(); }
         size_t write(uint8_t data) override;
-        // 512 is RX_QUEUE_SIZE which is defined in BluetoothSerial.cpp but not in its .h
-        int rx_buffer_available() override { return 512 - SerialBT.available(); }
+        size_t write(const uint8_t* buffer, size_t length) override;
+
+        // Sets the size of the ring, while the channel is not registered
+        void setRxBuffer(size_t size);
 
         bool realtimeOkay(char c) override;
         bool lineComplete(char* line, char c) override;
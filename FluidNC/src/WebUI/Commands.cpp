@@ -6,12 +6,20 @@
 #include <Esp.h>        // ESP.restart()
 
 #include "Authentication.h"  // MAX_LOCAL_PASSWORD_LENGTH
+#include "../JobStats.h"      // JobStats::flush()
+#include "../ToolTable.h"     // ToolTable::flush()
+#include "../HomeMemory.h"    // HomeMemory::save()
+#include "../Settings.h"      // Coordinates::flush()
+#include "../InputFile.h"     // InputFile::progress()
+#include "../Planner.h"       // plan_get_current_block()
+#include "../System.h"        // sys
 
 #include <esp_err.h>
 #include <cstring>
 
 namespace WebUI {
     bool COMMANDS::_restart_MCU = false;
+    bool COMMANDS::_whenIdle    = false;
 
     bool COMMANDS::isLocalPasswordValid(char* password) {
         if (!password) {
@@ -36,13 +44,31 @@ namespace WebUI {
     /**
      * Restart ESP
      */
-    void COMMANDS::restart_MCU() { _restart_MCU = true; }
+    void COMMANDS::restart_MCU(bool whenIdle) {
+        // A restart that is already due at once stays so
+        if (!_restart_MCU || !whenIdle) {
+            _whenIdle = whenIdle;
+        }
+        _restart_MCU = true;
+    }
+
+    // Idle, or in an alarm that a restart would not lose anything to, with no job running
+    static bool idle() {
+        float       percent;
+        const char* path;
+        return (sys.state == State::Idle || sys.state == State::Alarm || sys.state == State::ConfigAlarm) && !plan_get_current_block() &&
+               !InputFile::progress(percent, path);
+    }
 
     /**
      * Handle not critical actions that must be done in sync environement
      */
     void COMMANDS::handle() {
-        if (_restart_MCU) {
+        if (_restart_MCU && (!_whenIdle || idle())) {
+            HomeMemory::save();
+            JobStats::flush();
+            Coordinates::flush(true);
+            ToolTable::flush();
             ESP.restart();
             while (1) {}
         }
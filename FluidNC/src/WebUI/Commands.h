@@ -8,10 +8,11 @@ namespace WebUI {
     class COMMANDS {
     public:
         static void handle();
-        static void restart_MCU();
+        static void restart_MCU(bool whenIdle = false);  // whenIdle waits until nothing is moving or queued
         static bool isLocalPasswordValid(char* password);
 
     private:
         static bool _restart_MCU;
+        static bool _whenIdle;
     };
 }
@@ -4,6 +4,8 @@
 #include "../Config.h"
 #include "InputBuffer.h"
 
+#include <cstring>
+
 namespace WebUI {
     InputBuffer inputBuffer;
 
@@ -11,5 +13,49 @@ namespace WebUI {
 
     InputBuffer::operator bool() const { return true; }
 
+    void InputBuffer::queue(const Machine::MacroProgram& program) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back({ program, 0 });
+    }
+
+    bool InputBuffer::running() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_queue.empty();
+    }
+
+    Channel* InputBuffer::pollLine(char* line) {
+        if (!line) {
+            return Channel::pollLine(line);
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_queue.empty()) {
+            Running& running = _queue.front();
+            if (running.step == running.program->size()) {
+                _queue.pop_front();
+                continue;
+            }
+            const Machine::MacroStep& step = (*running.program)[running.step++];
+            if (step.cmd != Cmd::None) {
+                lock.unlock();  // The command may reset, which flushes the queue
+                execute_realtime_command(step.cmd, *this);
+                lock.lock();
+                continue;
+            }
+            // compile() has checked that the line fits
+            memcpy(line, step.line.c_str(), step.line.length() + 1);
+            return this;
+        }
+        lock.unlock();
+        return Channel::pollLine(line);
+    }
+
+    void InputBuffer::flushRx() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.clear();
+        }
+        Channel::flushRx();
+    }
+
     InputBuffer::~InputBuffer() {}
 }
@@ -4,12 +4,36 @@
 #pragma once
 
 #include "../Channel.h"
+#include "../Machine/Macros.h"
+
+#include <deque>
+#include <mutex>
 
 namespace WebUI {
+    // The channel that macros run on.  Queued macro programs are handed to the line
+    // executor a line at a time, each as soon as the one before it has been taken, so a
+    // macro of any length runs without filling the reception ring, and realtime escapes
+    // take effect in their place among the lines.
     class InputBuffer : public Channel {
+        struct Running {
+            Machine::MacroProgram program;
+            size_t                step;
+        };
+        std::deque<Running> _queue;
+        std::mutex          _mutex;
+
     public:
         InputBuffer();
 
+        void queue(const Machine::MacroProgram& program);
+
+        // True from the time a macro is queued until the line after its last line is
+        // asked for, which is after the last line has been executed
+        bool running();
+
+        Channel* pollLine(char* line) override;
+        void     flushRx() override;
+
         size_t write(uint8_t c) override { return 0; }
         int    availableforwrite() { return 0; };
 
@@ -13,17 +13,25 @@ namespace WebUI {
 
     JSONencoder::JSONencoder(bool pretty, std::string* str) : pretty(pretty), level(0), _str(str), category("nvs") { count[level] = 0; }
 
+    JSONencoder::JSONencoder(bool pretty, sink_t sink) : pretty(pretty), level(0), _str(&linebuf), _sink(sink), category("nvs") {
+        count[level] = 0;
+        linebuf.reserve(SINK_CHUNK);
+    }
+
     void JSONencoder::flush() {
         if (_channel && (*_str).length()) {
             // Output to channels is encapsulated in [MSG:JSON:...]
             (*_channel).out_acked(*_str, "JSON:");
             //            *_str = "";
             (*_str).clear();
+        } else if (_sink && (*_str).length()) {
+            _sink((*_str).data(), (*_str).length());
+            (*_str).clear();
         }
     }
     void JSONencoder::add(char c) {
         (*_str) += c;
-        if (_channel && (*_str).length() >= 100) {
+        if ((_channel && (*_str).length() >= 100) || (_sink && (*_str).length() >= SINK_CHUNK)) {
             flush();
         }
     }
@@ -1,14 +1,20 @@
 #pragma once
 
 #include "../Channel.h"
+#include <functional>
 #include <string>
 
 // Class for creating JSON-encoded strings.
 
 namespace WebUI {
     class JSONencoder {
+    public:
+        // Receives the encoded text a piece at a time, in order
+        using sink_t = std::function<void(const char* data, size_t length)>;
+
     private:
-        static const int MAX_JSON_LEVEL = 16;
+        static const int    MAX_JSON_LEVEL = 16;
+        static const size_t SINK_CHUNK     = 512;  // Text collected before it is passed to a sink
 
         bool pretty;
         int  level;
@@ -30,6 +36,7 @@ namespace WebUI {
 
         std::string* _str     = nullptr;
         Channel*     _channel = nullptr;
+        sink_t       _sink    = nullptr;
 
         std::string category;
 
@@ -39,6 +46,9 @@ namespace WebUI {
         // Constructor; set _pretty true for pretty printing
         JSONencoder(bool pretty, Channel* channel);
         JSONencoder(bool pretty, std::string* str);
+        // Streams the text to sink, so the whole of it is never held in memory.
+        // end() passes the last of it.
+        JSONencoder(bool pretty, sink_t sink);
 
         // begin() starts the encoding process.
         void begin();
@@ -10,9 +10,10 @@
 #    include "WifiServices.h"
 
 #    include <WiFi.h>
+#    include <lwip/sockets.h>  // send()
 
 namespace WebUI {
-    TelnetClient::TelnetClient(WiFiClient* wifiClient) : Channel("telnet"), _wifiClient(wifiClient) {}
+    TelnetClient::TelnetClient(WiFiClient* wifiClient) : Channel("telnet"), _wifiClient(wifiClient) { _output.reserve(OUTPUT_BUFFER_SIZE); }
 
     void TelnetClient::handle() {}
 
@@ -28,58 +29,123 @@ namespace WebUI {
     size_t TelnetClient::write(uint8_t data) { return write(&data, 1); }
 
     size_t TelnetClient::write(const uint8_t* buffer, size_t length) {
+        if (_state == -1) {
+            return length;
+        }
+        std::lock_guard<std::mutex> lock(_outputMutex);
+
         // Replace \n with \r\n
-        size_t  rem      = length;
-        uint8_t lastchar = '\0';
-        size_t  j        = 0;
-        while (rem) {
-            const int bufsize = 128;
-            uint8_t   modbuf[bufsize];
-            // bufsize-1 in case the last character is \n
-            size_t k = 0;
-            while (rem && k < (bufsize - 1)) {
-                uint8_t c = buffer[j++];
-                if (c == '\n' && lastchar != '\r') {
-                    modbuf[k++] = '\r';
-                }
-                lastchar    = c;
-                modbuf[k++] = c;
-                --rem;
+        size_t extra = 0;
+        for (size_t i = 0; i < length; ++i) {
+            extra += buffer[i] == '\n' && (i == 0 || buffer[i - 1] != '\r');
+        }
+        sendOutput();
+        if (!makeRoom(length + extra)) {
+            // Nothing can be dropped, so wait for the socket to take what is buffered
+            if (_output.length() && _wifiClient->write((const uint8_t*)_output.data(), _output.length()) != _output.length()) {
+                closeOnDisconnect();
             }
-            if (k) {
-                auto nWritten = _wifiClient->write(modbuf, k);
-                if (nWritten == 0) {
-                    closeOnDisconnect();
-                }
+            _output.clear();
+        }
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t c = buffer[i];
+            if (c == '\n' && (i == 0 || buffer[i - 1] != '\r')) {
+                _output += '\r';
             }
+            _output += c;
         }
+        sendOutput();
         return length;
     }
 
+    // Sends as much of the buffered output as the socket will take now.  Call with _outputMutex held.
+    void TelnetClient::sendOutput() {
+        if (_output.empty() || _state == -1) {
+            return;
+        }
+        int sent = send(_wifiClient->fd(), _output.data(), _output.length(), MSG_DONTWAIT);
+        if (sent > 0) {
+            _output.erase(0, sent);
+        } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            _output.clear();
+            closeOnDisconnect();
+        }
+    }
+
+    // Drops the oldest messages and status reports until length more bytes fit.  The first
+    // line is kept, as it may have been partly sent.  Call with _outputMutex held.
+    bool TelnetClient::makeRoom(size_t length) {
+        if (length > OUTPUT_BUFFER_SIZE) {
+            return false;
+        }
+        size_t pos = _output.find('\n');
+        while (_output.length() + length > OUTPUT_BUFFER_SIZE) {
+            if (pos == std::string::npos) {
+                return false;
+            }
+            size_t start = pos + 1;
+            size_t end   = _output.find('\n', start);
+            if (end == std::string::npos) {
+                return false;
+            }
+            if (_output[start] == '[' || _output[start] == '<') {
+                _output.erase(start, end + 1 - start);
+            } else {
+                pos = end;
+            }
+        }
+        return true;
+    }
+
+    void TelnetClient::autoReport() {
+        {
+            std::lock_guard<std::mutex> lock(_outputMutex);
+            sendOutput();
+        }
+        Channel::autoReport();
+    }
+
     int TelnetClient::peek(void) { return _wifiClient->peek(); }
 
     int TelnetClient::available() { return _wifiClient->available(); }
 
-    int TelnetClient::rx_buffer_available() { return WIFI_CLIENT_READ_BUFFER_SIZE - available(); }
+    // In streaming mode TCP flow control holds back whatever does not fit in the
+    // client buffer, so the larger window can be advertised safely.
+    int TelnetClient::rx_buffer_available() {
+        return std::max(0, std::max(int(_streamWindow), int(WIFI_CLIENT_READ_BUFFER_SIZE)) - available());
+    }
 
     int TelnetClient::read(void) {
         if (_state == -1) {
             return -1;
         }
         auto ret = _wifiClient->read();
-        if (ret < 0) {
-            // calling _wifiClient->connected() is expensive when the client is
-            // connected because it calls recv() to double check, so we check
-            // infrequently, only after quite a few reads have returned no data
-            if (++_state >= DISCONNECT_CHECK_COUNTS) {
-                _state = 0;
-                closeOnDisconnect();  // sets _state to -1 if disconnected
-            }
-        } else {
+        checkIdle(ret >= 0);
+        return ret;
+    }
+
+    size_t TelnetClient::read(uint8_t* buffer, size_t length) {
+        if (_state == -1 || !length) {
+            return 0;
+        }
+        int ret = _wifiClient->read(buffer, length);
+        checkIdle(ret > 0);
+        return ret > 0 ? ret : 0;
+    }
+
+    void TelnetClient::checkIdle(bool gotData) {
+        if (gotData) {
             // Reset the counter if we have data
             _state = 0;
+            return;
+        }
+        // calling _wifiClient->connected() is expensive when the client is
+        // connected because it calls recv() to double check, so we check
+        // infrequently, only after quite a few reads have returned no data
+        if (++_state >= DISCONNECT_CHECK_COUNTS) {
+            _state = 0;
+            closeOnDisconnect();  // sets _state to -1 if disconnected
         }
-        return ret;
     }
 
     TelnetClient::~TelnetClient() { delete _wifiClient; }
@@ -8,6 +8,8 @@
 
 #ifdef ENABLE_WIFI
 #    include <WiFi.h>
+#    include <mutex>
+#    include <string>
 
 namespace WebUI {
     class TelnetClient : public Channel {
@@ -23,8 +25,21 @@ namespace WebUI {
 
         static const int DISCONNECT_CHECK_COUNTS = 1000;
 
+        // Output goes into this buffer and is sent as the socket takes it, without waiting,
+        // so a client that reads slowly does not hold up the output task.  When the buffer is
+        // full, the oldest messages and status reports are dropped to make room, since they
+        // are superseded by later ones.  Other output, like acks and command responses, is
+        // never dropped; if nothing can be, the write waits for the socket as it used to.
+        static const size_t OUTPUT_BUFFER_SIZE = 4096;
+
+        std::string _output;
+        std::mutex  _outputMutex;
+
         int _state = 0;
 
+        void sendOutput();
+        bool makeRoom(size_t length);
+
     public:
         TelnetClient(WiFiClient* wifiClient);
 
@@ -32,12 +47,16 @@ namespace WebUI {
         size_t write(uint8_t data) override;
         size_t write(const uint8_t* buffer, size_t size) override;
         int    read(void) override;
+        size_t read(uint8_t* buffer, size_t length) override;
         int    peek(void) override;
         int    available() override;
         void   flush() override {}
         void   flushRx() override;
 
         void closeOnDisconnect();
+        void checkIdle(bool gotData);
+
+        void autoReport() override;
 
         void handle() override;
 
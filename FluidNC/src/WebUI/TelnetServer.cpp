@@ -79,6 +79,7 @@ namespace WebUI {
             _disconnected.pop();
             allChannels.deregistration(client);
             delete client;
+            --_nClients;
         }
 
         //check if there are any new clients
@@ -87,9 +88,16 @@ namespace WebUI {
             if (!tcpClient) {
                 log_error("Creating telnet client failed");
             }
+            if (_nClients >= MAX_TLNT_CLIENTS) {
+                log_info("Telnet from " << tcpClient->remoteIP() << " refused, " << MAX_TLNT_CLIENTS << " clients connected");
+                tcpClient->stop();
+                delete tcpClient;
+                return;
+            }
             log_debug("Telnet from " << tcpClient->remoteIP());
             TelnetClient* tnc = new TelnetClient(tcpClient);
             allChannels.registration(tnc);
+            ++_nClients;
         }
     }
     TelnetServer::~TelnetServer() { end(); }
@@ -23,7 +23,9 @@ namespace WebUI {
         static const int MAX_TELNET_PORT = 65001;
         static const int MIN_TELNET_PORT = 1;
 
-        static const int MAX_TLNT_CLIENTS = 2;
+        // Each client takes an lwIP socket, of which there are CONFIG_LWIP_MAX_SOCKETS (10),
+        // shared with HTTP, WebSocket and outgoing connections
+        static const int MAX_TLNT_CLIENTS = 4;
 
         static const int FLUSHTIMEOUT = 500;
 
@@ -44,6 +46,7 @@ namespace WebUI {
         bool        _setupdone  = false;
         WiFiServer* _wifiServer = nullptr;
         uint16_t    _port       = 0;
+        int         _nClients   = 0;
     };
 
     extern TelnetServer telnetServer;
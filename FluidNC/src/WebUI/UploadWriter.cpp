@@ -0,0 +1,132 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "UploadWriter.h"
+
+#include "../Config.h"   // UPLOAD_TASK_*
+#include "../Logging.h"  // log_*
+#include "../SdArbiter.h"
+
+#include <freertos/task.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace WebUI {
+    QueueHandle_t UploadWriter::_full = nullptr;
+    QueueHandle_t UploadWriter::_free = nullptr;
+
+    bool UploadWriter::start() {
+        if (_full) {
+            return true;
+        }
+        _full = xQueueCreate(1, sizeof(Block));
+        _free = xQueueCreate(2, sizeof(uint8_t*));
+        if (_full && _free &&
+            xTaskCreatePinnedToCore(writer,                // task
+                                    "upload",              // name for task
+                                    3072,                  // size of task stack
+                                    nullptr,               // parameters
+                                    UPLOAD_TASK_PRIORITY,  // priority
+                                    nullptr,               // task handle
+                                    UPLOAD_TASK_CORE       // core
+                                    ) == pdPASS) {
+            return true;
+        }
+        if (_full) {
+            vQueueDelete(_full);
+            _full = nullptr;
+        }
+        if (_free) {
+            vQueueDelete(_free);
+            _free = nullptr;
+        }
+        return false;
+    }
+
+    void UploadWriter::writer(void* arg) {
+        Block block;
+        while (true) {
+            if (xQueueReceive(_full, &block, portMAX_DELAY) == pdTRUE) {
+                auto owner = block.owner;
+                if (!owner->_failed && !owner->_sink(block.data, block.length)) {
+                    owner->_failed = true;
+                }
+                xQueueSend(_free, &block.data, portMAX_DELAY);
+            }
+        }
+    }
+
+    UploadWriter::UploadWriter(FileStream* file) :
+        UploadWriter([file](const uint8_t* data, size_t length) {
+            return SdArbiter::write(*file, data, length, SdArbiter::Web) == length;
+        }) {}
+
+    UploadWriter::UploadWriter(Sink sink) : _sink(sink) {
+        _buffers[0] = static_cast<uint8_t*>(malloc(blockSize));
+        _buffers[1] = static_cast<uint8_t*>(malloc(blockSize));
+        if (!_buffers[0] || !_buffers[1] || !start()) {
+            log_debug("Upload buffers unavailable, writing directly");
+            free(_buffers[0]);
+            free(_buffers[1]);
+            _buffers[0] = _buffers[1] = nullptr;
+            return;
+        }
+        _filling.data = _buffers[0];
+        xQueueSend(_free, &_buffers[1], 0);
+    }
+
+    // Queues the filling buffer for the task and starts on a written one
+    bool UploadWriter::hand_over() {
+        xQueueSend(_full, &_filling, portMAX_DELAY);
+        xQueueReceive(_free, &_filling.data, portMAX_DELAY);
+        _filling.length = 0;
+        return !_failed;
+    }
+
+    bool UploadWriter::write(const uint8_t* data, size_t length) {
+        if (!_filling.data) {
+            if (!_sink(data, length)) {
+                _failed = true;
+            }
+            return !_failed;
+        }
+        while (length && !_failed) {
+            size_t n = std::min(length, blockSize - _filling.length);
+            memcpy(_filling.data + _filling.length, data, n);
+            _filling.length += n;
+            data += n;
+            length -= n;
+            if (_filling.length == blockSize && !hand_over()) {
+                break;
+            }
+        }
+        return !_failed;
+    }
+
+    // Waits until the other buffer is back, so that nothing is being written
+    void UploadWriter::drain() {
+        uint8_t* other;
+        xQueueReceive(_free, &other, portMAX_DELAY);
+        xQueueSend(_free, &other, 0);
+    }
+
+    bool UploadWriter::finish() {
+        if (_filling.data) {
+            if (_filling.length && !_failed) {
+                hand_over();
+            }
+            drain();
+        }
+        return !_failed;
+    }
+
+    UploadWriter::~UploadWriter() {
+        if (_filling.data) {
+            drain();
+            uint8_t* other;
+            xQueueReceive(_free, &other, 0);  // Leaves the queue empty for the next upload
+            free(_buffers[0]);
+            free(_buffers[1]);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  UploadWriter.h - writes an upload to a file behind the network
+
+  The web server hands over uploads in pieces of about 1.4 KB, and writing each one
+  to a FAT file costs nearly as much as writing a whole cluster.  UploadWriter
+  collects the pieces into blockSize buffers, which are a whole number of sectors
+  and, since the file is written from the start, land on sector boundaries.  A full
+  buffer is written by a task of its own while the next one fills, so the upload
+  only waits for the card when it gets a whole buffer ahead of it.  The task is
+  started by the first upload and then waits for the next one.
+
+  Firmware updates go through the same buffers and task, with a Sink that hashes each
+  block as it writes it to the update partition.
+
+  If the buffers cannot be allocated, pieces are written straight to the file.
+*/
+
+#include "../FileStream.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <functional>
+
+namespace WebUI {
+    class UploadWriter {
+    public:
+        static const size_t blockSize = 16384;
+
+        // Takes a block, returning false if it could not be written
+        using Sink = std::function<bool(const uint8_t* data, size_t length)>;
+
+        explicit UploadWriter(FileStream* file);
+        explicit UploadWriter(Sink sink);
+
+        UploadWriter(const UploadWriter&)            = delete;
+        UploadWriter& operator=(const UploadWriter&) = delete;
+
+        // Returns false if this or an earlier write failed
+        bool write(const uint8_t* data, size_t length);
+
+        // Writes what is left and waits for the file to be up to date.  Returns false if any write failed.
+        bool finish();
+
+        // Waits for writes in progress, but drops what has not been handed over
+        ~UploadWriter();
+
+    private:
+        struct Block {
+            UploadWriter* owner;
+            uint8_t*      data;
+            size_t        length;
+        };
+
+        Sink          _sink;
+        uint8_t*      _buffers[2] = { nullptr, nullptr };
+        Block         _filling    = { this, nullptr, 0 };
+        volatile bool _failed     = false;
+
+        // Uploads come one at a time, so they share the task and its queues
+        static QueueHandle_t _full;  // Blocks for the task to write
+        static QueueHandle_t _free;  // Buffers that have been written
+
+        static bool start();
+        static void writer(void* arg);
+
+        bool hand_over();
+        void drain();
+    };
+}
@@ -8,11 +8,19 @@
 #    include <WebSocketsServer.h>
 #    include <WiFi.h>
 
-#    include "../Serial.h"  // is_realtime_command
+#    include "../Serial.h"                  // is_realtime_command
+#    include "../Report.h"                  // report_machine_status
+#    include "../Machine/MachineConfig.h"  // config
 
 namespace WebUI {
     class WSChannels;
 
+    static_assert(WSFrame::headerRoom >= WEBSOCKETS_MAX_HEADER_SIZE, "WSFrame needs room for the largest header");
+
+    WSFrame::WSFrame(const uint8_t* data, size_t length, bool status) : status(status), _buffer(headerRoom + length) {
+        memcpy(payload(), data, length);
+    }
+
     WSChannel::WSChannel(WebSocketsServer* server, uint8_t clientNum) : Channel("websocket"), _server(server), _clientNum(clientNum) {}
 
     int WSChannel::read() {
@@ -56,21 +64,12 @@ namespace WebUI {
             out    = (uint8_t*)_output_line.c_str();
             outlen = _output_line.length();
         }
-        int stat = _server->canSend(_clientNum);
-        if (stat < 0) {
-            _active = false;
-            log_debug("WebSocket is dead; closing");
-            return 0;
-        }
-        if (stat == 0) {
-            if (_output_line.length()) {
-                _output_line = "";
-            }
-            return size;
-        }
-        if (!_server->sendBIN(_clientNum, out, outlen)) {
-            _active = false;
-            log_debug("WebSocket is unresponsive; closing");
+        // A status report on its own can be replaced by a newer one, but not one batched with other output
+        bool status = out[0] == '<' && memchr(out, '\n', outlen) == out + outlen - 1;
+        {
+            std::lock_guard<std::mutex> lock(WSChannels::sendMutex);
+            queue(WSChannels::frame(out, outlen, status));
+            sendQueued();
         }
         if (_output_line.length()) {
             _output_line = "";
@@ -79,10 +78,55 @@ namespace WebUI {
         return size;
     }
 
+    // Call with WSChannels::sendMutex held
+    void WSChannel::queue(WSFramePtr frame) {
+        if (frame->status) {
+            for (auto& queued : _sendQueue) {
+                if (queued->status) {
+                    queued = frame;
+                    return;
+                }
+            }
+        }
+        if (_sendQueue.size() == maxQueued) {
+            _sendQueue.pop_front();
+            if (_dropped++ == 0) {
+                log_debug("WebSocket " << int(_clientNum) << " is slow; dropping output");
+            }
+        }
+        _sendQueue.push_back(frame);
+    }
+
+    // Sends frames while the socket takes them without waiting.  Call with WSChannels::sendMutex held
+    void WSChannel::sendQueued() {
+        while (_active && !_sendQueue.empty()) {
+            int stat = _server->canSend(_clientNum);
+            if (stat < 0) {
+                _active = false;
+                log_debug("WebSocket is dead; closing");
+                break;
+            }
+            if (stat == 0) {
+                return;
+            }
+            auto& frame = _sendQueue.front();
+            if (!_server->sendBIN(_clientNum, frame->payload(), frame->length(), true)) {
+                _active = false;
+                log_debug("WebSocket is unresponsive; closing");
+                break;
+            }
+            _sendQueue.pop_front();
+        }
+        if (!_active) {
+            _sendQueue.clear();
+        }
+    }
+
     bool WSChannel::sendTXT(std::string& s) {
         if (!_active) {
             return false;
         }
+        std::lock_guard<std::mutex> lock(WSChannels::sendMutex);
         if (!_server->sendTXT(_clientNum, s.c_str())) {
             _active = false;
             log_debug("WebSocket is unresponsive; closing");
@@ -92,12 +136,77 @@ namespace WebUI {
     }
 
     void WSChannel::autoReport() {
-        if (!_active || !_server->canSend(_clientNum)) {
-            return;
+        {
+            std::lock_guard<std::mutex> lock(WSChannels::sendMutex);
+            sendQueued();
+            // Reports wait until the output before them has gone
+            if (!_active || !_sendQueue.empty() || _server->canSend(_clientNum) <= 0) {
+                return;
+            }
         }
         Channel::autoReport();
     }
 
+    void WSChannel::reportStatus() {
+        if (_binaryStatus) {
+            sendStatusFrame();
+        } else {
+            Channel::reportStatus();
+        }
+    }
+
+    static uint8_t* put16(uint8_t* p, uint16_t value) {
+        *p++ = value;
+        *p++ = value >> 8;
+        return p;
+    }
+    static uint8_t* put32(uint8_t* p, uint32_t value) { return put16(put16(p, value), value >> 16); }
+    static uint8_t* putFloat(uint8_t* p, float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return put32(p, bits);
+    }
+
+    void WSChannel::sendStatusFrame() {
+        MachineStatus status;
+        report_machine_status(status);
+
+        auto     n_axis = config->_axes->_numberAxis;
+        uint8_t  flags  = (status.isMpos ? 1 : 0) | (config->_reportInches ? 2 : 0) | (status.probe ? 4 : 0) | (status.fileJob ? 8 : 0);
+        uint16_t limits = 0;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (status.limits[axis]) {
+                limits |= 1 << axis;
+            }
+        }
+
+        uint8_t  frame[statusFrameMax];
+        uint8_t* p = frame;
+        *p++       = statusFrameMarker;
+        *p++       = statusFrameVersion;
+        p          = put16(p, _statusSequence++);
+        p          = put32(p, xTaskGetTickCount());
+        *p++       = uint8_t(status.state);
+        *p++       = flags;
+        *p++       = n_axis;
+        *p++       = uint8_t(status.filePercent);
+        *p++       = status.feedOverride;
+        *p++       = status.rapidOverride;
+        *p++       = status.spindleOverride;
+        *p++       = 0;
+        p          = put16(p, limits);
+        p          = put16(p, 0);
+        p          = putFloat(p, status.feedRate);
+        p          = put32(p, status.spindleSpeed);
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            p = putFloat(p, status.position[axis]);
+        }
+
+        std::lock_guard<std::mutex> lock(WSChannels::sendMutex);
+        queue(std::make_shared<WSFrame>(frame, p - frame, true));
+        sendQueued();
+    }
+
     WSChannel::~WSChannel() {}
 
     std::map<uint8_t, WSChannel*> WSChannels::_wsChannels;
@@ -105,6 +214,17 @@ namespace WebUI {
 
     WSChannel* WSChannels::_lastWSChannel = nullptr;
 
+    WSFramePtr WSChannels::_lastFrame;
+    std::mutex WSChannels::sendMutex;
+
+    // Call with sendMutex held
+    WSFramePtr WSChannels::frame(const uint8_t* data, size_t length, bool status) {
+        if (!_lastFrame || !_lastFrame->same(data, length)) {
+            _lastFrame = std::make_shared<WSFrame>(data, length, status);
+        }
+        return _lastFrame;
+    }
+
     WSChannel* WSChannels::getWSChannel(int pageid) {
         WSChannel* wsChannel = nullptr;
         if (pageid != -1) {
@@ -7,8 +7,12 @@
 
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 class WebSocketsServer;
 
@@ -28,6 +32,54 @@ namespace WebUI {
 #    include "../Channel.h"
 
 namespace WebUI {
+    // Binary status frame, sent as a WebSocket binary message when the client turns
+    // binary status on with the BinaryStatus realtime command (0xA8).  All fields are
+    // little-endian.  Text output never begins with statusFrameMarker, which is not
+    // valid UTF-8, so clients can tell the frames apart from report lines.
+    //
+    //   0  u8   statusFrameMarker
+    //   1  u8   statusFrameVersion
+    //   2  u16  sequence number, incremented for every frame
+    //   4  u32  time in ms
+    //   8  u8   State, numbered as in Types.h
+    //   9  u8   flags: 1 = machine position, 2 = inches, 4 = probe, 8 = file job running
+    //  10  u8   number of axes, N
+    //  11  u8   file job percent complete
+    //  12  u8   feed override percent
+    //  13  u8   rapid override percent
+    //  14  u8   spindle override percent
+    //  15  u8   reserved, 0
+    //  16  u16  limit switches, one bit per axis
+    //  18  u16  reserved, 0
+    //  20  f32  feed rate
+    //  24  u32  spindle speed
+    //  28  f32  N axis positions, in the same units as the text report
+    static const uint8_t statusFrameMarker  = 0xFE;
+    static const uint8_t statusFrameVersion = 1;
+    static const size_t  statusFrameMax     = 28 + 4 * MAX_N_AXIS;
+
+    // A binary frame's payload, with room in front of it for the frame header so that the
+    // WebSockets library can send it without copying.  A line written to every channel is
+    // made into one frame that all the clients send.
+    class WSFrame {
+    public:
+        static const size_t headerRoom = 14;  // WEBSOCKETS_MAX_HEADER_SIZE
+
+        WSFrame(const uint8_t* data, size_t length, bool status);
+
+        uint8_t* payload() { return _buffer.data() + headerRoom; }
+        size_t   length() const { return _buffer.size() - headerRoom; }
+        bool     same(const uint8_t* data, size_t length) const {
+            return length == this->length() && !memcmp(_buffer.data() + headerRoom, data, length);
+        }
+
+        const bool status;  // A status report, which a newer one replaces if it is not sent yet
+
+    private:
+        std::vector<uint8_t> _buffer;
+    };
+    using WSFramePtr = std::shared_ptr<WSFrame>;
+
     class WSChannel : public Channel {
     public:
         WSChannel(WebSocketsServer* server, uint8_t clientNum);
@@ -47,23 +99,35 @@ namespace WebUI {
 
         int id() { return _clientNum; }
 
-        int rx_buffer_available() override { return std::max(0, 256 - int(_queue.size())); }
-
         operator bool() const;
 
         ~WSChannel();
 
         int read() override;
-        int available() override { return _queue.size() + (_rtchar > -1); }
+        int available() override { return _rxRing.size() + (_rtchar > -1); }
 
         void autoReport() override;
+        bool canSendBinary() override { return true; }
+        void reportStatus() override;
 
     private:
         WebSocketsServer* _server;
         uint8_t           _clientNum;
 
+        uint16_t _statusSequence = 0;
+        void     sendStatusFrame();
+
         std::string _output_line;
 
+        // Frames wait here while the client's socket cannot take more, so a slow client
+        // holds up only itself.  When the queue is full the oldest frame is dropped.
+        static const size_t    maxQueued = 16;
+        std::deque<WSFramePtr> _sendQueue;
+        uint32_t               _dropped = 0;
+
+        void queue(WSFramePtr frame);
+        void sendQueued();
+
         // Instead of queueing realtime characters, we put them here
         // so they can be processed immediately during operations like
         // homing where GCode handling is blocked.
@@ -78,7 +142,16 @@ namespace WebUI {
         static WSChannel* _lastWSChannel;
         static WSChannel* getWSChannel(int pageid);
 
+        static WSFramePtr _lastFrame;
+
     public:
+        // Sending is serialized, as frames are written from the output, polling and web
+        // server tasks and shared frames get their header written in place
+        static std::mutex sendMutex;
+
+        // Returns a frame for the data, the last one made if it has the same contents
+        static WSFramePtr frame(const uint8_t* data, size_t length, bool status);
+
         static void removeChannel(WSChannel* channel);
         static void removeChannel(uint8_t num);
 
@@ -61,7 +61,10 @@ namespace WebUI {
         }
     }
 
-    void WebClient::sendLine(MsgLevel level, const char* line) { print_msg(level, line); }
+    void WebClient::sendLine(MsgLevel level, const char* line) {
+        print_msg(level, line);
+        log_pool_release(line);
+    }
     void WebClient::sendLine(MsgLevel level, const std::string* line) {
         print_msg(level, line->c_str());
         delete line;
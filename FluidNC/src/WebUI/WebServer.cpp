@@ -30,10 +30,20 @@
 #    include "WebClient.h"
 
 #    include "src/Protocol.h"  // protocol_send_event
+#    include "src/Report.h"    // git_info
 #    include "src/FluidPath.h"
 #    include "src/WebUI/JSONEncoder.h"
 
 #    include "src/HashFS.h"
+#    include "src/Planner.h"          // plan_get_block_buffer_available
+#    include "src/Stepper.h"          // isr_stats
+#    include "src/JobStats.h"
+#    include "src/SdArbiter.h"        // SdArbiter::with(), SdArbiter::read()
+#    include "src/Modbus.h"           // ModbusBus::commsErrors
+#    include "src/Uart.h"             // Uart::overflows
+#    include "Driver/soft_wdt.h"       // soft_wdt_stats()
+#    include "src/Motors/TrinamicBase.h"  // TrinamicBase::instances
+#    include "src/Motors/Dynamixel2.h"    // Dynamixel2::instances
 #    include <list>
 
 namespace WebUI {
@@ -42,6 +52,8 @@ namespace WebUI {
 }
 
 #    include <esp_ota_ops.h>
+#    include <mbedtls/md.h>
+#    include <strings.h>  // strcasecmp()
 
 //embedded response file if no files on LocalFS
 #    include "NoFile.h"
@@ -70,7 +82,11 @@ namespace WebUI {
     uint8_t           Web_Server::_nb_ip = 0;
     const int         MAX_AUTH_IP        = 10;
 #    endif
-    FileStream* Web_Server::_uploadFile = nullptr;
+    FileStream*   Web_Server::_uploadFile   = nullptr;
+    UploadWriter* Web_Server::_uploadWriter = nullptr;
+
+    std::recursive_mutex Web_Server::_mutex;
+    TaskHandle_t         Web_Server::_task = nullptr;
 
     EnumSetting *http_enable, *http_block_during_motion;
     IntSetting*  http_port;
@@ -90,6 +106,8 @@ namespace WebUI {
     Web_Server::~Web_Server() { end(); }
 
     bool Web_Server::begin() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
         bool no_error = true;
         _setupdone    = false;
 
@@ -100,17 +118,16 @@ namespace WebUI {
 
         //create instance
         _webserver = new WebServer(_port);
+        //here the list of headers to be recorded.  Each call replaces the list, so
+        //they all have to be in one.
+        const char* headerkeys[] = {
+            "If-None-Match",
+            "Range",
 #    ifdef ENABLE_AUTHENTICATION
-        //here the list of headers to be recorded
-        const char* headerkeys[]   = { "Cookie" };
-        size_t      headerkeyssize = sizeof(headerkeys) / sizeof(char*);
-        //ask server to track these headers
-        _webserver->collectHeaders(headerkeys, headerkeyssize);
+            "Cookie",
 #    endif
-
-        //here the list of headers to be recorded
-        const char* headerkeys[]   = { "If-None-Match" };
-        size_t      headerkeyssize = sizeof(headerkeys) / sizeof(char*);
+        };
+        size_t headerkeyssize = sizeof(headerkeys) / sizeof(char*);
         _webserver->collectHeaders(headerkeys, headerkeyssize);
 
         _socket_server = new WebSocketsServer(_port + 1);
@@ -137,6 +154,9 @@ namespace WebUI {
         _webserver->on("/command_silent", HTTP_ANY, handle_web_command_silent);
         _webserver->on("/feedhold_reload", HTTP_ANY, handleFeedholdReload);
 
+        //Counters for monitoring systems
+        _webserver->on("/metrics", HTTP_GET, handle_metrics);
+
         //LocalFS
         _webserver->on("/files", HTTP_ANY, handleFileList, LocalFSFileupload);
 
@@ -191,11 +211,31 @@ namespace WebUI {
 
         HashFS::hash_all();
 
+        if (!_task) {
+            xTaskCreatePinnedToCore(serverTask,                // task
+                                    "webserver",               // name for task
+                                    8192,                      // size of task stack
+                                    nullptr,                   // parameters
+                                    WEB_SERVER_TASK_PRIORITY,  // priority
+                                    &_task,                    // task handle
+                                    WEB_SERVER_TASK_CORE       // core
+            );
+        }
+
         _setupdone = true;
         return no_error;
     }
 
+    void Web_Server::serverTask(void* unused) {
+        for (; true; vTaskDelay(1)) {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            handle();
+        }
+    }
+
     void Web_Server::end() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
         _setupdone = false;
 
         SSDP.end();
@@ -241,9 +281,8 @@ namespace WebUI {
             hash = HashFS::hash(gzpath);
         }
 
-        if (hash.length() && std::string(_webserver->header("If-None-Match").c_str()) == hash) {
+        if (notModified(hash)) {
             log_debug(path << " is cached");
-            _webserver->send(304);
             return true;
         }
         // If you load or reload WebUI while a program is running, there is a high
@@ -261,12 +300,12 @@ namespace WebUI {
         bool        isGzip = false;
         FileStream* file;
         try {
-            file = new FileStream(path, "r", "");
+            file = SdArbiter::with(SdArbiter::Web, [path] { return new FileStream(path, "r", ""); });
         } catch (const Error err) {
             try {
                 std::filesystem::path gzpath(fpath);
                 gzpath += ".gz";
-                file   = new FileStream(gzpath, "r", "");
+                file   = SdArbiter::with(SdArbiter::Web, [&gzpath] { return new FileStream(gzpath, "r", ""); });
                 isGzip = true;
             } catch (const Error err) {
                 log_debug(path << " not found");
@@ -277,56 +316,112 @@ namespace WebUI {
             _webserver->sendHeader("Content-Disposition", "attachment");
         }
         if (hash.length()) {
-            _webserver->sendHeader("ETag", hash.c_str());
+            sendCacheHeaders(hash);
         }
-        _webserver->setContentLength(file->size());
         if (isGzip) {
             _webserver->sendHeader("Content-Encoding", "gzip");
         }
-        _webserver->send(200, getContentType(path), "");
-
-        // This depends on the fact that FileStream inherits from Stream
-        // The Arduino implementation of WiFiClient::write(Stream*) just
-        // reads repetitively from the stream in 1360-byte chunks and
-        // sends the data over the TCP socket. so nothing special.
-        _webserver->client().write(*file);
+        _webserver->sendHeader("Accept-Ranges", "bytes");
+
+        size_t size  = file->size();
+        size_t first = 0;
+        size_t last  = size - 1;
+        int    code  = 200;
+        if (size && range(size, first, last)) {
+            if (first >= size) {
+                _webserver->sendHeader("Content-Range", ("bytes */" + std::to_string(size)).c_str());
+                _webserver->send(416);
+                delete file;
+                return true;
+            }
+            std::string content_range("bytes ");
+            content_range += std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(size);
+            _webserver->sendHeader("Content-Range", content_range.c_str());
+            file->seek(first);
+            code = 206;
+        }
+        size_t length = size ? last - first + 1 : 0;
+        _webserver->setContentLength(length);
+        _webserver->send(code, getContentType(path), "");
+
+        // WiFiClient::write(Stream&) would send to the end of the file, so the range is
+        // copied in pieces of the size that it uses.  The card is taken only for the reads.
+        uint8_t buf[1360];
+        while (length) {
+            size_t n = SdArbiter::read(*file, buf, std::min(length, sizeof(buf)), SdArbiter::Web);
+            if (!n || _webserver->client().write(buf, n) != n) {
+                break;
+            }
+            length -= n;
+        }
 
         delete file;
         return true;
     }
-    void Web_Server::sendWithOurAddress(const char* content, int code) {
-        auto        ip    = WiFi.getMode() == WIFI_STA ? WiFi.localIP() : WiFi.softAPIP();
-        std::string ipstr = IP_string(ip);
-        if (_port != 80) {
-            ipstr += ":";
-            ipstr += std::to_string(_port);
-        }
-
-        std::string scontent(content);
-        replace_string_in_place(scontent, "$WEB_ADDRESS$", ipstr);
-        replace_string_in_place(scontent, "$QUERY$", _webserver->uri().c_str());
-        _webserver->send(code, "text/html", scontent.c_str());
-    }
-
-    // Captive Portal Page for use in AP mode
-    const char PAGE_CAPTIVE[] =
-        "<HTML>\n<HEAD>\n<title>Captive Portal</title> \n</HEAD>\n<BODY>\n<CENTER>Captive Portal page : $QUERY$- you will be "
-        "redirected...\n<BR><BR>\nif not redirected, <a href='http://$WEB_ADDRESS$'>click here</a>\n<BR><BR>\n<PROGRESS name='prg' "
-        "id='prg'></PROGRESS>\n\n<script>\nvar i = 0; \nvar x = document.getElementById(\"prg\"); \nx.max=5; \nvar "
-        "interval=setInterval(function(){\ni=i+1; \nvar x = document.getElementById(\"prg\"); \nx.value=i; \nif (i>5) "
-        "\n{\nclearInterval(interval);\nwindow.location.href='/';\n}\n},1000);\n</script>\n</CENTER>\n</BODY>\n</HTML>\n\n";
 
-    void Web_Server::sendCaptivePortal() { sendWithOurAddress(PAGE_CAPTIVE, 200); }
+    // True, having sent a 304 reply, if the browser already has the version with this hash.
+    // If-None-Match can list several entity tags, or be * for any.
+    bool Web_Server::notModified(const std::string& hash) {
+        if (!hash.length() || !_webserver->hasHeader("If-None-Match")) {
+            return false;
+        }
+        std::string tags(_webserver->header("If-None-Match").c_str());
+        if (tags != "*" && tags.find(hash) == std::string::npos) {
+            return false;
+        }
+        sendCacheHeaders(hash);
+        _webserver->send(304);
+        return true;
+    }
 
-    //Default 404 page that is sent when a request cannot be satisfied
-    const char PAGE_404[] =
-        "<HTML>\n<HEAD>\n<title>Redirecting...</title> \n</HEAD>\n<BODY>\n<CENTER>Unknown page : $QUERY$- you will be "
-        "redirected...\n<BR><BR>\nif not redirected, <a href='http://$WEB_ADDRESS$'>click here</a>\n<BR><BR>\n<PROGRESS name='prg' "
-        "id='prg'></PROGRESS>\n\n<script>\nvar i = 0; \nvar x = document.getElementById(\"prg\"); \nx.max=5; \nvar "
-        "interval=setInterval(function(){\ni=i+1; \nvar x = document.getElementById(\"prg\"); \nx.value=i; \nif (i>5) "
-        "\n{\nclearInterval(interval);\nwindow.location.href='/';\n}\n},1000);\n</script>\n</CENTER>\n</BODY>\n</HTML>\n\n";
+    // The browser may keep the file, but has to check with If-None-Match before using it,
+    // so a changed file is picked up at once while an unchanged one costs only a 304
+    void Web_Server::sendCacheHeaders(const std::string& hash) {
+        _webserver->sendHeader("ETag", hash.c_str());
+        _webserver->sendHeader("Cache-Control", "no-cache");
+    }
 
-    void Web_Server::send404Page() { sendWithOurAddress(PAGE_404, 404); }
+    // Parses a single Range: bytes=first-last, bytes=first- or bytes=-suffix request into the
+    // first and last byte to send.  Returns false to send the whole file, as for no Range, or a
+    // Range with several parts, which are seldom asked for.  first is size or more if the range
+    // is past the end of the file.
+    bool Web_Server::range(size_t size, size_t& first, size_t& last) {
+        if (!_webserver->hasHeader("Range")) {
+            return false;
+        }
+        std::string spec(_webserver->header("Range").c_str());
+        if (spec.rfind("bytes=", 0) != 0 || spec.find(',') != std::string::npos) {
+            return false;
+        }
+        spec.erase(0, 6);
+        auto dash = spec.find('-');
+        if (dash == std::string::npos) {
+            return false;
+        }
+        char* end;
+        if (dash == 0) {
+            unsigned long suffix = strtoul(spec.c_str() + 1, &end, 10);
+            if (end == spec.c_str() + 1 || *end || suffix == 0) {
+                return false;
+            }
+            first = suffix < size ? size - suffix : 0;
+            last  = size - 1;
+            return true;
+        }
+        first = strtoul(spec.c_str(), &end, 10);
+        if (end != spec.c_str() + dash) {
+            return false;
+        }
+        last = size - 1;
+        if (dash + 1 < spec.length()) {
+            size_t to = strtoul(spec.c_str() + dash + 1, &end, 10);
+            if (*end || to < first) {
+                return false;
+            }
+            last = std::min(to, size - 1);
+        }
+        return true;
+    }
 
     void Web_Server::handle_root() {
         log_info("WebUI: Request from " << _webserver->client().remoteIP());
@@ -336,7 +431,17 @@ namespace WebUI {
             }
         }
 
-        // If we did not send index.html, send the default content that provides simple localfs file management
+        // If we did not send index.html, send the default content that provides simple localfs file management.
+        // It is built into the firmware, so the firmware version tags it.
+        std::string hash("\"nofile-");
+        for (const char* p = git_info; *p; ++p) {
+            hash += (*p > ' ' && *p != '"') ? *p : '-';  // Not allowed in an entity tag
+        }
+        hash += '"';
+        if (notModified(hash)) {
+            return;
+        }
+        sendCacheHeaders(hash);
         _webserver->sendHeader("Content-Encoding", "gzip");
         _webserver->send_P(200, "text/html", PAGE_NOFILES, PAGE_NOFILES_SIZE);
     }
@@ -467,6 +572,113 @@ namespace WebUI {
     }
 
     //login status check
+    // Appends one metric in the Prometheus text format.  snprintf() never writes past
+    // end, and a full buffer just drops the metrics that do not fit.
+    static char* add_metric(char* p, char* end, const char* name, const char* type, const char* help, double value) {
+        if (p < end) {
+            p += snprintf(p, end - p, "# HELP fluidnc_%s %s\n# TYPE fluidnc_%s %s\nfluidnc_%s %.17g\n", name, help, name, type, name, value);
+        }
+        return p < end ? p : end;
+    }
+
+    // Appends the health of every Trinamic driver as one metric with a motor label
+    // per driver, from the cache, so the scrape never waits for the driver bus.
+    static char* add_driver_metric(char* p, char* end, const char* name, const char* help, double (*value)(const MotorDrivers::TrinamicBase::Health&)) {
+        auto& drivers = MotorDrivers::TrinamicBase::instances();
+        if (drivers.empty() || p >= end) {
+            return p;
+        }
+        p += snprintf(p, end - p, "# HELP fluidnc_%s %s\n# TYPE fluidnc_%s gauge\n", name, help, name);
+        for (auto driver : drivers) {
+            auto health = driver->health();
+            if (p >= end) {
+                break;
+            }
+            if (health.valid) {
+                p += snprintf(p, end - p, "fluidnc_%s{motor=\"%s\"} %.17g\n", name, driver->motorName().c_str(), value(health));
+            }
+        }
+        return p < end ? p : end;
+    }
+
+    // The same for the telemetry of every Dynamixel servo, from the last sync read
+    static char* add_servo_metric(char* p, char* end, const char* name, const char* help, double (*value)(const MotorDrivers::Dynamixel2::Telemetry&)) {
+        auto& servos = MotorDrivers::Dynamixel2::instances();
+        if (servos.empty() || p >= end) {
+            return p;
+        }
+        p += snprintf(p, end - p, "# HELP fluidnc_%s %s\n# TYPE fluidnc_%s gauge\n", name, help, name);
+        for (auto servo : servos) {
+            auto telemetry = servo->telemetry();
+            if (p >= end) {
+                break;
+            }
+            if (telemetry.valid) {
+                p += snprintf(p, end - p, "fluidnc_%s{motor=\"%s\"} %.17g\n", name, servo->motorName().c_str(), value(telemetry));
+            }
+        }
+        return p < end ? p : end;
+    }
+
+    // The metrics are read from counters that are kept anyway and formatted into a fixed
+    // buffer, so a scrape takes no locks, allocates nothing and never touches a GCode channel.
+    // The web server runs in one task, so the buffer can be static.
+    void Web_Server::handle_metrics() {
+        static char text[5120];
+        char*       p   = text;
+        char* end = text + sizeof(text);
+
+        auto& stats = Stepper::isr_stats;
+
+        p = add_metric(p, end, "lines_executed_total", "counter", "GCode and $ lines executed", linesExecuted);
+        p = add_metric(p, end, "jobs_done_total", "counter", "Jobs completed since $RW", JobStats::jobs());
+        p = add_metric(p, end, "jobs_lifetime_total", "counter", "Jobs completed since $Stats=RESET", JobStats::total_jobs());
+        p = add_metric(p, end, "cycle_seconds_total", "counter", "Time spent running motion", JobStats::cycle_seconds());
+        p = add_metric(p, end, "spindle_seconds_total", "counter", "Time with the spindle on", JobStats::spindle_seconds());
+        uint32_t eta;
+        if (report_eta(eta)) {
+            p = add_metric(p, end, "eta_seconds", "gauge", "Time until the job or the buffered motion is done", eta);
+        }
+        uint32_t planned = config->_planner_blocks - 1 - plan_get_block_buffer_available();
+
+        p = add_metric(p, end, "planner_blocks", "gauge", "Planner blocks queued", planned);
+        p = add_metric(p, end, "planner_capacity", "gauge", "Planner blocks that can be queued", config->_planner_blocks - 1);
+        p = add_metric(p, end, "segment_underruns_total", "counter", "Times the segment buffer ran dry in a block", stats.underruns);
+        p = add_metric(p, end, "step_isr_max_cycles", "gauge", "Longest step ISR in CPU cycles", stats.max_ticks);
+        p = add_metric(p, end, "step_isr_cache_off_total", "counter", "Step ISR runs with the flash cache off", stats.cache_off);
+        p = add_metric(p, end, "heap_free_bytes", "gauge", "Free heap", xPortGetFreeHeapSize());
+        p = add_metric(p, end, "heap_low_water_bytes", "gauge", "Least free heap seen", heapLowWater);
+        p = add_metric(p, end, "spindle_speed_rpm", "gauge", "Programmed spindle speed", sys.spindle_speed);
+        p = add_metric(p, end, "modbus_comms_errors_total", "counter", "Modbus exchanges that failed", ModbusBus::commsErrors);
+        p = add_metric(p, end, "uart_rx_overflows_total", "counter", "Times a UART receiver dropped data", Uart::overflows);
+        auto realtime = soft_wdt_stats(SoftWdtRealtime);
+        auto prep     = soft_wdt_stats(SoftWdtPrep);
+        p = add_metric(p, end, "realtime_gap_max_us", "gauge", "Longest realtime check gap since $System/Tasks", realtime.maxGapUs);
+        p = add_metric(p, end, "realtime_stalls_total", "counter", "Gaps between realtime checks over $System/StallMs", realtime.stalls);
+        p = add_metric(p, end, "prep_gap_max_us", "gauge", "Longest gap between segment refills since $System/Tasks", prep.maxGapUs);
+        p = add_metric(p, end, "prep_stalls_total", "counter", "Gaps between segment refills over $System/StallMs", prep.stalls);
+        p = add_metric(p, end, "state", "gauge", "Machine state, numbered as in Types.h", int(sys.state));
+        p = add_metric(p, end, "uptime_seconds", "counter", "Time since boot", xTaskGetTickCount() / double(configTICK_RATE_HZ));
+
+        using Health = MotorDrivers::TrinamicBase::Health;
+        p = add_driver_metric(p, end, "tmc_sg_result", "StallGuard load measurement", [](const Health& h) { return double(h.sgResult); });
+        p = add_driver_metric(p, end, "tmc_cs_actual", "Motor current scale", [](const Health& h) { return double(h.csActual); });
+        p = add_driver_metric(p, end, "tmc_overtemp_warning", "Driver overtemperature prewarning", [](const Health& h) { return double(h.overTempWarn); });
+        p = add_driver_metric(p, end, "tmc_fault", "Driver overtemperature, short or open load", [](const Health& h) {
+            return double(h.overTemp || h.shortToGround || h.openLoad);
+        });
+
+        using Telemetry = MotorDrivers::Dynamixel2::Telemetry;
+        p = add_servo_metric(p, end, "dxl_following_error_mm", "Servo present position minus goal", [](const Telemetry& t) {
+            return double(t.followingError);
+        });
+        p = add_servo_metric(p, end, "dxl_load_percent", "Servo load", [](const Telemetry& t) { return double(t.load); });
+        p = add_servo_metric(p, end, "dxl_temperature_celsius", "Servo temperature", [](const Telemetry& t) { return double(t.temperature); });
+
+        _webserver->sendHeader("Cache-Control", "no-cache");
+        _webserver->send(200, "text/plain; version=0.0.4", text);
+    }
+
     void Web_Server::handle_login() {
 #    ifdef ENABLE_AUTHENTICATION
         const char* smsg;
@@ -757,19 +969,46 @@ namespace WebUI {
 
         sendStatus(200, std::to_string(int(_upload_status)).c_str());
 
-        //if success restart
+        // The new firmware is the boot partition, and runs after the next restart.  That
+        // waits until the machine is idle, so an update never stops a job.
         if (_upload_status == UploadStatus::SUCCESSFUL) {
             delay_ms(1000);
-            COMMANDS::restart_MCU();
+            log_info("Restarting into the update once the machine is idle");
+            COMMANDS::restart_MCU(true);
         } else {
             _upload_status = UploadStatus::NONE;
         }
     }
 
-    //File upload for Web update
+    // SHA-256 of a firmware update, found by the writer task as it writes each block
+    static mbedtls_md_context_t updateSha;
+
+    static std::string hex_string(const uint8_t* data, size_t length) {
+        std::string str;
+        for (size_t i = 0; i < length; i++) {
+            str += "0123456789abcdef"[data[i] >> 4];
+            str += "0123456789abcdef"[data[i] & 0xf];
+        }
+        return str;
+    }
+
+    // Waits for the writes in progress and drops the rest
+    void Web_Server::endUpdateWriter() {
+        if (_uploadWriter) {
+            delete _uploadWriter;
+            _uploadWriter = nullptr;
+            mbedtls_md_free(&updateSha);
+        }
+    }
+
+    // File upload for Web update.  Blocks of the image are written to the update partition
+    // by the upload writer task while the next ones arrive, and hashed as they go.  If the
+    // request has a <filename>H argument, the SHA-256 in hex, the image must match it.
+    // Update.end() then checks the image itself before making it the boot partition.
     void Web_Server::WebUpdateUpload() {
-        static size_t   last_upload_update;
-        static uint32_t maxSketchSpace = 0;
+        static size_t      last_upload_update;
+        static uint32_t    maxSketchSpace = 0;
+        static std::string expectedSha;
 
         //only admin can update FW
         if (is_authenticated() != AuthenticationLevel::LEVEL_ADMIN) {
@@ -791,6 +1030,9 @@ namespace WebUI {
                     if (_webserver->hasArg(sizeargname.c_str())) {
                         maxSketchSpace = _webserver->arg(sizeargname.c_str()).toInt();
                     }
+                    std::string shaargname(upload.filename.c_str());
+                    shaargname += "H";
+                    expectedSha = _webserver->hasArg(shaargname.c_str()) ? _webserver->arg(shaargname.c_str()).c_str() : "";
                     //check space
                     size_t flashsize = 0;
                     if (esp_ota_get_running_partition()) {
@@ -811,13 +1053,19 @@ namespace WebUI {
                             log_info("Update cancelled");
                             pushError(ESP_ERROR_NOT_ENOUGH_SPACE, "Upload rejected, not enough space");
                         } else {
+                            mbedtls_md_init(&updateSha);
+                            mbedtls_md_setup(&updateSha, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+                            mbedtls_md_starts(&updateSha);
+                            _uploadWriter = new UploadWriter([](const uint8_t* data, size_t length) {
+                                mbedtls_md_update(&updateSha, data, length);
+                                return Update.write(const_cast<uint8_t*>(data), length) == length;
+                            });
                             log_info("Update 0%");
                         }
                     }
                     //Upload write
                     //**************
                 } else if (upload.status == UPLOAD_FILE_WRITE) {
-                    vTaskDelay(1 / portTICK_RATE_MS);
                     //check if no error
                     if (_upload_status == UploadStatus::ONGOING) {
                         if (((100 * upload.totalSize) / maxSketchSpace) != last_upload_update) {
@@ -829,7 +1077,7 @@ namespace WebUI {
 
                             log_info("Update " << last_upload_update << "%");
                         }
-                        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
+                        if (!_uploadWriter->write(upload.buf, upload.currentSize)) {
                             _upload_status = UploadStatus::FAILED;
                             log_info("Update write failed");
                             pushError(ESP_ERROR_FILE_WRITE, "File write failed");
@@ -838,7 +1086,21 @@ namespace WebUI {
                     //Upload end
                     //**************
                 } else if (upload.status == UPLOAD_FILE_END) {
-                    if (Update.end(true)) {  //true to set the size to the current progress
+                    bool    written = _uploadWriter->finish();
+                    uint8_t sha[32];
+                    mbedtls_md_finish(&updateSha, sha);
+                    endUpdateWriter();
+                    std::string actualSha = hex_string(sha, sizeof(sha));
+                    log_info("Update SHA-256 " << actualSha);
+                    if (!written) {
+                        _upload_status = UploadStatus::FAILED;
+                        log_info("Update write failed");
+                        pushError(ESP_ERROR_FILE_WRITE, "File write failed");
+                    } else if (expectedSha.length() && strcasecmp(expectedSha.c_str(), actualSha.c_str())) {
+                        _upload_status = UploadStatus::FAILED;
+                        log_info("Update SHA-256 mismatch, expected " << expectedSha);
+                        pushError(ESP_ERROR_UPLOAD, "Update checksum mismatch");
+                    } else if (Update.end(true)) {  //true to set the size to the current progress
                         //Now Reboot
                         log_info("Update 100%");
                         _upload_status = UploadStatus::SUCCESSFUL;
@@ -850,6 +1112,8 @@ namespace WebUI {
                 } else if (upload.status == UPLOAD_FILE_ABORTED) {
                     log_info("Update failed");
                     _upload_status = UploadStatus::FAILED;
+                    endUpdateWriter();
+                    Update.abort();
                     return;
                 }
             }
@@ -857,10 +1121,29 @@ namespace WebUI {
 
         if (_upload_status == UploadStatus::FAILED) {
             cancelUpload();
-            Update.end();
+            endUpdateWriter();
+            Update.abort();
         }
     }
 
+    // Moves to the next entry of a listing if advance is set, and reads that entry, with the
+    // card taken only meanwhile, since the listing is sent between entries.  Returns false
+    // at the end of the directory.
+    bool Web_Server::read_entry(stdfs::directory_iterator& iter, bool advance, ListEntry& entry) {
+        SdArbiter::Access sd(SdArbiter::Web);
+        std::error_code   ec;
+        if (advance) {
+            iter.increment(ec);
+        }
+        if (ec || iter == stdfs::directory_iterator()) {
+            return false;
+        }
+        entry.name        = iter->path().filename();
+        entry.isDirectory = iter->is_directory();
+        entry.size        = entry.isDirectory ? 0 : iter->file_size();
+        return true;
+    }
+
     void Web_Server::handleFileOps(const char* fs) {
         //this is only for admin and user
         if (is_authenticated() == AuthenticationLevel::LEVEL_GUEST) {
@@ -902,7 +1185,8 @@ namespace WebUI {
 
         // Handle deletions and directory creation
         if (_webserver->hasArg("action") && _webserver->hasArg("filename")) {
-            std::string action(_webserver->arg("action").c_str());
+            SdArbiter::Access sd(SdArbiter::Web);
+            std::string       action(_webserver->arg("action").c_str());
             std::string filename = std::string(_webserver->arg("filename").c_str());
             if (action == "delete") {
                 if (stdfs::remove(fpath / filename, ec)) {
@@ -954,27 +1238,52 @@ namespace WebUI {
             list_files = false;
         }
 
-        std::string        s;
-        WebUI::JSONencoder j(false, &s);
+        // A page of the listing can be asked for with start, the index of its first entry,
+        // and count, the most entries to list.  next is then the start of the next page.
+        size_t start = _webserver->hasArg("start") ? _webserver->arg("start").toInt() : 0;
+        size_t count = _webserver->hasArg("count") ? _webserver->arg("count").toInt() : SIZE_MAX;
+
+        // The listing is streamed, so a large directory needs no more memory than a small one
+        _webserver->setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _webserver->sendHeader("Cache-Control", "no-cache");
+        _webserver->send(200, "application/json", "");
+
+        WebUI::JSONencoder j(false, [](const char* data, size_t length) { _webserver->sendContent(data, length); });
         j.begin();
 
         if (list_files) {
-            auto iter = stdfs::directory_iterator { fpath, ec };
+            auto iter = SdArbiter::with(SdArbiter::Web, [&] { return stdfs::directory_iterator { fpath, ec }; });
             if (!ec) {
+                size_t    index = 0;
+                bool      more  = false;
+                ListEntry entry;
                 j.begin_array("files");
-                for (auto const& dir_entry : iter) {
-                    j.begin_object();
-                    j.member("name", dir_entry.path().filename());
-                    j.member("shortname", dir_entry.path().filename());
-                    j.member("size", dir_entry.is_directory() ? -1 : dir_entry.file_size());
-                    j.member("datetime", "");
-                    j.end_object();
+                for (bool found = read_entry(iter, false, entry); found; found = read_entry(iter, true, entry)) {
+                    if (index >= start) {
+                        if (index - start == count) {
+                            more = true;
+                            break;
+                        }
+                        j.begin_object();
+                        j.member("name", entry.name);
+                        j.member("shortname", entry.name);
+                        j.member("size", entry.isDirectory ? -1 : entry.size);
+                        j.member("datetime", "");
+                        j.end_object();
+                    }
+                    ++index;
                 }
                 j.end_array();
+                if (start) {
+                    j.member("start", start);
+                }
+                if (more) {
+                    j.member("next", index);
+                }
             }
         }
 
-        auto space = stdfs::space(fpath, ec);
+        auto space = SdArbiter::with(SdArbiter::Web, [&] { return stdfs::space(fpath, ec); });
         totalspace = space.capacity;
         usedspace  = totalspace - space.available;
 
@@ -987,7 +1296,7 @@ namespace WebUI {
         j.member("occupation", percent);
         j.member("status", sstatus);
         j.end();
-        sendJSON(200, s);
+        _webserver->sendContent("");
     }
 
     void Web_Server::handle_direct_SDFileList() { handleFileOps(sdName); }
@@ -1005,11 +1314,11 @@ namespace WebUI {
             return;
         }
 
-        auto space = stdfs::space(fpath);
+        auto space = SdArbiter::with(SdArbiter::Web, [&] { return stdfs::space(fpath); });
         if (filesize && filesize > space.available) {
             // If the file already exists, maybe there will be enough space
             // when we replace it.
-            auto existing_size = stdfs::file_size(fpath, ec);
+            auto existing_size = SdArbiter::with(SdArbiter::Web, [&] { return stdfs::file_size(fpath, ec); });
             if (ec || (filesize > (space.available + existing_size))) {
                 _upload_status = UploadStatus::FAILED;
                 log_info("Upload not enough space");
@@ -1021,7 +1330,8 @@ namespace WebUI {
         if (_upload_status != UploadStatus::FAILED) {
             //Create file for writing
             try {
-                _uploadFile    = new FileStream(fpath, "w");
+                _uploadFile    = SdArbiter::with(SdArbiter::Web, [&] { return new FileStream(fpath, "w"); });
+                _uploadWriter  = new UploadWriter(_uploadFile);
                 _upload_status = UploadStatus::ONGOING;
             } catch (const Error err) {
                 _uploadFile    = nullptr;
@@ -1033,10 +1343,9 @@ namespace WebUI {
     }
 
     void Web_Server::uploadWrite(uint8_t* buffer, size_t length) {
-        vTaskDelay(1 / portTICK_RATE_MS);
         if (_uploadFile && _upload_status == UploadStatus::ONGOING) {
             //no error write post data
-            if (length != _uploadFile->write(buffer, length)) {
+            if (!_uploadWriter->write(buffer, length)) {
                 _upload_status = UploadStatus::FAILED;
                 log_info("Upload failed - file write failed");
                 pushError(ESP_ERROR_FILE_WRITE, "File write failed");
@@ -1051,11 +1360,16 @@ namespace WebUI {
     void Web_Server::uploadEnd(size_t filesize) {
         //if file is open close it
         if (_uploadFile) {
-            //            delete _uploadFile;
-            // _uploadFile = nullptr;
+            if (!_uploadWriter->finish()) {
+                _upload_status = UploadStatus::FAILED;
+                log_info("Upload failed - file write failed");
+                pushError(ESP_ERROR_FILE_WRITE, "File write failed");
+            }
+            delete _uploadWriter;
+            _uploadWriter = nullptr;
 
             std::string pathname = _uploadFile->fpath();
-            delete _uploadFile;
+            SdArbiter::with(SdArbiter::Web, [] { delete _uploadFile; });
             _uploadFile = nullptr;
             log_debug("pathname " << pathname);
 
@@ -1067,7 +1381,7 @@ namespace WebUI {
             if (filesize) {
                 uint32_t actual_size;
                 try {
-                    actual_size = stdfs::file_size(filepath);
+                    actual_size = SdArbiter::with(SdArbiter::Web, [&] { return stdfs::file_size(filepath); });
                 } catch (const Error err) { actual_size = 0; }
 
                 if (filesize != actual_size) {
@@ -1093,7 +1407,9 @@ namespace WebUI {
         log_info("Upload cancelled");
         if (_uploadFile) {
             std::filesystem::path filepath = _uploadFile->fpath();
-            delete _uploadFile;
+            delete _uploadWriter;
+            _uploadWriter = nullptr;
+            SdArbiter::with(SdArbiter::Web, [] { delete _uploadFile; });
             _uploadFile = nullptr;
             HashFS::rehash_file(filepath);
         }
@@ -1104,9 +1420,13 @@ namespace WebUI {
             cancelUpload();
             if (_uploadFile) {
                 std::filesystem::path filepath = _uploadFile->fpath();
-                delete _uploadFile;
+                delete _uploadWriter;
+                _uploadWriter = nullptr;
+                SdArbiter::with(SdArbiter::Web, [&] {
+                    delete _uploadFile;
+                    stdfs::remove(filepath, error_code);
+                });
                 _uploadFile = nullptr;
-                stdfs::remove(filepath, error_code);
                 HashFS::rehash_file(filepath);
             }
         }
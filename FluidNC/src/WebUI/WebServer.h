@@ -11,6 +11,11 @@
 #    include "../Settings.h"
 #    include "Authentication.h"  // AuthenticationLevel
 #    include "Commands.h"
+#    include "UploadWriter.h"
+
+#    include <mutex>
+#    include <freertos/FreeRTOS.h>
+#    include <freertos/task.h>
 
 class WebSocketsServer;
 class WebServer;
@@ -60,6 +65,14 @@ namespace WebUI {
         static uint16_t          _port;
         static UploadStatus      _upload_status;
         static FileStream*       _uploadFile;
+        static UploadWriter*     _uploadWriter;  // Also writes firmware updates
+
+        // Requests are served by a task of their own, so a slow client holds up no input
+        // polling.  The mutex keeps begin() and end() from pulling the server out from
+        // under a request; it is recursive because a request can restart the server.
+        static std::recursive_mutex _mutex;
+        static TaskHandle_t         _task;
+        static void                 serverTask(void* unused);
 
         static const char* getContentType(const char* filename);
 
@@ -76,6 +89,7 @@ namespace WebUI {
         static void handle_SSDP();
         static void handle_root();
         static void handle_login();
+        static void handle_metrics();
         static void handle_not_found();
         static void _handle_web_command(bool);
         static void handle_web_command() { _handle_web_command(false); }
@@ -87,12 +101,23 @@ namespace WebUI {
         static void handleFileList();
         static void handleUpdate();
         static void WebUpdateUpload();
+        static void endUpdateWriter();
 
         static bool myStreamFile(const char* path, bool download = false);
+        static bool notModified(const std::string& hash);
+        static void sendCacheHeaders(const std::string& hash);
+        static bool range(size_t size, size_t& first, size_t& last);
 
         static void pushError(int code, const char* st, bool web_error = 500, uint16_t timeout = 1000);
 
         static void cancelUpload();
+
+        struct ListEntry {
+            std::string name;
+            bool        isDirectory;
+            uintmax_t   size;
+        };
+        static bool read_entry(stdfs::directory_iterator& iter, bool advance, ListEntry& entry);
         static void handleFileOps(const char* mountpoint);
         static void handle_direct_SDFileList();
         static void fileUpload(const char* fs);
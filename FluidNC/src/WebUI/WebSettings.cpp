@@ -13,14 +13,20 @@
 #include "../Settings.h"
 #include "../Machine/MachineConfig.h"
 #include "../Configuration/JsonGenerator.h"
-#include "../Uart.h"       // Uart0.baud
-#include "../Report.h"     // git_info
-#include "../InputFile.h"  // InputFile
+#include "../Uart.h"         // Uart0.baud
+#include "../Report.h"       // git_info
+#include "../InputFile.h"    // InputFile
+#include "../JobStats.h"     // JobStats::file_started()
+#include "../StreamJob.h"    // StreamJob::run()
+#include "../MotionBench.h"  // MotionBench::run(), MotionBench::motion_ms()
+#include "../Extents.h"      // Extents::scan(), Extents::check_job()
+#include "../Telemetry.h"    // Telemetry::job_started()
 
 #include "Commands.h"  // COMMANDS::restart_MCU();
 #include "WifiConfig.h"
 
 #include "src/HashFS.h"
+#include "src/FileCache.h"
 
 #include <cstring>
 #include <sstream>
@@ -408,16 +414,139 @@ namespace WebUI {
             log_string(out, "Busy");
             return Error::IdleError;
         }
+        // file,line=N resumes the job at line N
+        uint32_t resumeLine = 0;
+        char*    resume     = strstr(parameter, ",line=");
+        if (resume) {
+            *resume    = '\0';
+            resumeLine = atoi(resume + strlen(",line="));
+            if (resumeLine < 1) {
+                log_error_to(out, "Invalid resume line");
+                return Error::InvalidValue;
+            }
+        }
         InputFile* theFile;
         if ((err = openFile(fs, parameter, auth_level, out, theFile)) != Error::Ok) {
             return err;
         }
+        if (resumeLine > 1 && (err = theFile->resumeAt(resumeLine)) != Error::Ok) {
+            delete theFile;
+            return err;
+        }
+        if (resumeLine <= 1 && (err = Extents::check_job(*theFile, out)) != Error::Ok) {
+            delete theFile;
+            return err;
+        }
+        JobStats::file_started(parameter);
+        Telemetry::job_started(*theFile);
         allChannels.registration(theFile);
 
         //report_realtime_status(out);
         return Error::Ok;
     }
 
+    // Runs the file through the motion pipeline without moving, and reports its timing.
+    // file,options adds holds and overrides; see MotionBench.h.
+    static Error benchFile(const char* fs, char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        if (sys.state != State::Idle) {
+            log_string(out, "Busy");
+            return Error::IdleError;
+        }
+        char* options = strchr(parameter, ',');
+        if (options) {
+            *options++ = '\0';
+        }
+        InputFile* theFile;
+        Error      err;
+        if ((err = openFile(fs, parameter, auth_level, out, theFile)) != Error::Ok) {
+            return err;
+        }
+        err = MotionBench::run(*theFile, out, options);
+        delete theFile;
+        return err;
+    }
+
+    static Error benchSDFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        return benchFile("sd", parameter, auth_level, out);
+    }
+
+    static Error benchLocalFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        return benchFile("", parameter, auth_level, out);
+    }
+
+    // Runs the file on the motion bench for its motion time, which is kept as the time
+    // of the file, for the ETA when it runs
+    static Error estimateFile(const char* fs, char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        if (sys.state != State::Idle) {
+            log_string(out, "Busy");
+            return Error::IdleError;
+        }
+        InputFile* theFile;
+        Error      err;
+        if ((err = openFile(fs, parameter, auth_level, out, theFile)) != Error::Ok) {
+            return err;
+        }
+        err = MotionBench::run(*theFile, out, nullptr, true);
+        delete theFile;
+        if (err != Error::Ok) {
+            return err;
+        }
+        uint32_t seconds = (MotionBench::motion_ms() + 500) / 1000;
+        JobStats::set_estimate(parameter, seconds);
+        char hms[20];
+        snprintf(hms, sizeof(hms), "%u:%02u:%02u", unsigned(seconds / 3600), unsigned(seconds / 60 % 60), unsigned(seconds % 60));
+        log_info_to(out, "Estimated time of " << parameter << " " << hms);
+        return Error::Ok;
+    }
+
+    // Finds the extents of the file, which then let it start against the soft limits at once;
+    // see Extents.h
+    static Error extentsFile(const char* fs, char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        InputFile* theFile;
+        Error      err;
+        if ((err = openFile(fs, parameter, auth_level, out, theFile)) != Error::Ok) {
+            return err;
+        }
+        err = Extents::scan(*theFile, out);
+        delete theFile;
+        return err;
+    }
+
+    static Error extentsSDFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        return extentsFile("sd", parameter, auth_level, out);
+    }
+
+    static Error extentsLocalFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        return extentsFile("", parameter, auth_level, out);
+    }
+
+    static Error estimateSDFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        return estimateFile("sd", parameter, auth_level, out);
+    }
+
+    static Error estimateLocalFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        return estimateFile("", parameter, auth_level, out);
+    }
+
+    static Error runStream(char* parameter, AuthenticationLevel auth_level, Channel& out) {
+        if (sys.state == State::Alarm || sys.state == State::ConfigAlarm) {
+            log_string(out, "Alarm");
+            return Error::IdleError;
+        }
+        if (sys.state != State::Idle) {
+            log_string(out, "Busy");
+            return Error::IdleError;
+        }
+        if (!parameter || !*parameter) {
+            return Error::InvalidValue;
+        }
+        Error err = StreamJob::run(parameter, auth_level, out);
+        if (err == Error::Ok) {
+            JobStats::file_started(parameter);
+        }
+        return err;
+    }
+
     static Error runSDFile(char* parameter, AuthenticationLevel auth_level, Channel& out) {  // ESP220
         return runFile("sd", parameter, auth_level, out);
     }
@@ -730,9 +859,12 @@ namespace WebUI {
         return err;
     }
     static Error showLocalFSHashes(char* parameter, WebUI::AuthenticationLevel auth_level, Channel& out) {
-        for (const auto& [name, hash] : HashFS::localFsHashes) {
-            log_info_to(out, name << ": " << hash);
-        }
+        HashFS::show(out);
+        return Error::Ok;
+    }
+
+    static Error showLocalFSCache(char* parameter, WebUI::AuthenticationLevel auth_level, Channel& out) {
+        FileCache::show(out);
         return Error::Ok;
     }
 
@@ -873,6 +1005,9 @@ namespace WebUI {
         new WebCommand("FORMAT", WEBCMD, WA, "ESP710", "LocalFS/Format", formatLocalFS);
         new WebCommand("path", WEBCMD, WU, "ESP701", "LocalFS/Show", showLocalFile);
         new WebCommand("path", WEBCMD, WU, "ESP700", "LocalFS/Run", runLocalFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Bench", benchLocalFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Estimate", estimateLocalFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Extents", extentsLocalFile);
         new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/List", listLocalFiles);
         new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/ListJSON", listLocalFilesJSON);
         new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Delete", deleteLocalFile);
@@ -881,10 +1016,15 @@ namespace WebUI {
         new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Restore", restoreLocalFS);
         new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Migrate", migrateLocalFS);
         new WebCommand(NULL, WEBCMD, WU, NULL, "LocalFS/Hashes", showLocalFSHashes);
+        new WebCommand(NULL, WEBCMD, WU, NULL, "LocalFS/Cache", showLocalFSCache);
 
         new WebCommand("path", WEBCMD, WU, "ESP221", "File/ShowSome", fileShowSome);
         new WebCommand("path", WEBCMD, WU, "ESP221", "SD/Show", showSDFile);
         new WebCommand("path", WEBCMD, WU, "ESP220", "SD/Run", runSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Bench", benchSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Estimate", estimateSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Extents", extentsSDFile);
+        new WebCommand("url", WEBCMD, WU, NULL, "Stream/Run", runStream);
         new WebCommand("file_or_directory_path", WEBCMD, WU, "ESP215", "SD/Delete", deleteSDObject);
         new WebCommand("path", WEBCMD, WU, NULL, "SD/Rename", renameSDObject);
         new WebCommand(NULL, WEBCMD, WU, "ESP210", "SD/List", listSDFiles);
@@ -14,6 +14,7 @@ WebUI::WiFiConfig wifi_config __attribute__((init_priority(109)));
 #    include "../Config.h"
 #    include "../Main.h"
 #    include "Commands.h"      // COMMANDS
+#    include "../System.h"     // sys
 #    include "WifiServices.h"  // wifi_services.start() etc.
 #    include "WebSettings.h"   // split_params(), get_params()
 
@@ -27,6 +28,8 @@ WebUI::WiFiConfig wifi_config __attribute__((init_priority(109)));
 #    include <cstring>
 
 #    include <esp_ota_ops.h>
+#    include <freertos/timers.h>
+#    include <algorithm>
 
 namespace WebUI {
     enum WiFiStartupMode {
@@ -43,6 +46,16 @@ namespace WebUI {
         { "STA>AP", WiFiFallback },
     };
 
+    enum WiFiPowerSave {
+        PowerSaveNone = 0,
+        PowerSaveIdle,  // Modem sleep, and IdleTxPower, while the machine is not busy
+    };
+
+    enum_opt_t wifiPowerSaveOptions = {
+        { "None", PowerSaveNone },
+        { "Idle", PowerSaveIdle },
+    };
+
     enum WiFiContry {
         WiFiCountry01 = 0,  // country "01" is the safest set of settings which complies with all regulatory domains
         WiFiCountryAT,
@@ -109,6 +122,8 @@ namespace WebUI {
     StringSetting* wifi_sta_password;
 
     EnumSetting*   wifi_fast_scan;
+    EnumSetting*   wifi_power_save;
+    IntSetting*    wifi_idle_tx_power;
     EnumSetting*   wifi_sta_min_security;
     EnumSetting*   wifi_sta_mode;
     IPaddrSetting* wifi_sta_ip;
@@ -358,6 +373,9 @@ namespace WebUI {
         wifi_sta_ip      = new IPaddrSetting("Station Static IP", WEBSET, WA, NULL, "Sta/IP", DEFAULT_STA_IP, NULL);
         wifi_sta_mode  = new EnumSetting("Station IP Mode", WEBSET, WA, "ESP102", "Sta/IPMode", DEFAULT_STA_IP_MODE, &staModeOptions, NULL);
         wifi_fast_scan = new EnumSetting("WiFi Fast Scan", WEBSET, WA, NULL, "WiFi/FastScan", 0, &onoffOptions, NULL);
+        wifi_power_save =
+            new EnumSetting("WiFi Power Save", WEBSET, WA, NULL, "WiFi/PowerSave", PowerSaveNone, &wifiPowerSaveOptions, NULL);
+        wifi_idle_tx_power = new IntSetting("WiFi Idle TX Power dBm", WEBSET, WA, NULL, "WiFi/IdleTxPower", 20, 2, 20, NULL);
         wifi_sta_min_security =
             new EnumSetting("Station IP Mode", WEBSET, WA, NULL, "Sta/MinSecurity", DEFAULT_STA_MIN_SECURITY, &staSecurityOptions, NULL);
         wifi_sta_password = new StringSetting("Station Password",
@@ -529,12 +547,115 @@ namespace WebUI {
      * SYSTEM_EVENT_MAX
      */
 
+    // Station reconnection.  The BSSID and channel of the AP are kept from the last
+    // connection, so that reconnecting goes straight to it instead of scanning.  The
+    // attempts are made from a timer, at intervals that double up to maxReconnectWait,
+    // so nothing waits for them, and after fastAttempts failures the AP is looked for
+    // by SSID again, in case it has moved to another channel.
+    static const TickType_t firstReconnectWait = 250 / portTICK_PERIOD_MS;
+    static const TickType_t maxReconnectWait   = 16000 / portTICK_PERIOD_MS;
+    static const int        fastAttempts       = 3;
+
+    static TimerHandle_t reconnectTimer    = nullptr;
+    static TickType_t    reconnectWait     = firstReconnectWait;
+    static int           reconnectAttempts = 0;
+    static bool          stationWanted     = false;  // Connected by begin() in STA mode, until StopWiFi()
+    static bool          haveAp            = false;
+    static uint8_t       apBssid[6];
+    static uint8_t       apChannel;
+
+    static void schedule_reconnect() {
+        xTimerChangePeriod(reconnectTimer, reconnectWait, 0);  // Also starts it
+        reconnectWait = std::min(reconnectWait * 2, maxReconnectWait);
+    }
+
+    static void reconnect_attempt(TimerHandle_t timer) {
+        if (!stationWanted || WiFi.status() == WL_CONNECTED) {
+            return;
+        }
+        wifi_config_t conf;
+        if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK) {
+            bool fast          = haveAp && reconnectAttempts < fastAttempts;
+            conf.sta.bssid_set = fast;
+            conf.sta.channel   = fast ? apChannel : 0;
+            if (fast) {
+                memcpy(conf.sta.bssid, apBssid, sizeof(apBssid));
+            }
+            esp_wifi_set_config(WIFI_IF_STA, &conf);
+        }
+        ++reconnectAttempts;
+        esp_wifi_disconnect();  // Ends a connection attempt that the stack is still making
+        esp_wifi_connect();
+        schedule_reconnect();
+    }
+
+    // With WiFi/PowerSave=Idle, the station stays awake at full power only while the
+    // machine is busy, when a sleeping modem would delay the streamed lines and the
+    // reports by up to a beacon interval.  It goes back to modem sleep, and to
+    // WiFi/IdleTxPower, once the machine has been idle for idleSleepDelay, so that short
+    // pauses between jobs do not toggle it.
+    static const TickType_t idleSleepDelay = 5000 / portTICK_PERIOD_MS;
+
+    static bool       radioAwake = true;  // As begin() leaves it
+    static TickType_t idleSince  = 0;
+
+    static void set_radio_awake(bool awake) {
+        radioAwake = awake;
+        esp_wifi_set_ps(awake ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+        esp_wifi_set_max_tx_power(awake ? 80 : wifi_idle_tx_power->get() * 4);  // In 0.25 dBm units
+    }
+
+    static void update_power_save() {
+        if (WiFi.getMode() != WIFI_STA) {
+            return;  // An AP cannot sleep
+        }
+        if (wifi_power_save->get() == PowerSaveNone) {
+            if (!radioAwake) {
+                set_radio_awake(true);
+            }
+            return;
+        }
+        State state = sys.state;
+        bool  busy  = state != State::Idle && state != State::Alarm && state != State::Sleep && state != State::ConfigAlarm;
+        if (busy) {
+            idleSince = 0;
+            if (!radioAwake) {
+                set_radio_awake(true);
+            }
+            return;
+        }
+        TickType_t now = xTaskGetTickCount();
+        if (!idleSince) {
+            idleSince = now | 1;  // Never 0
+        } else if (radioAwake && (now - idleSince) >= idleSleepDelay) {
+            set_radio_awake(false);
+        }
+    }
+
+    void WiFiConfig::reconnect() {
+        if (stationWanted && WiFi.status() != WL_CONNECTED && reconnectTimer) {
+            reconnectWait = firstReconnectWait;
+            schedule_reconnect();
+        }
+    }
+
     void WiFiConfig::WiFiEvent(WiFiEvent_t event) {
         switch (event) {
             case SYSTEM_EVENT_STA_GOT_IP:
+                memcpy(apBssid, WiFi.BSSID(), sizeof(apBssid));
+                apChannel         = WiFi.channel();
+                haveAp            = true;
+                reconnectAttempts = 0;
+                reconnectWait     = firstReconnectWait;
+                if (reconnectTimer) {
+                    xTimerStop(reconnectTimer, 0);
+                }
                 break;
             case SYSTEM_EVENT_STA_DISCONNECTED:
                 log_info("WiFi Disconnected");
+                if (stationWanted && !xTimerIsTimerActive(reconnectTimer)) {
+                    schedule_reconnect();
+                }
                 break;
             default:
                 //log_info("WiFi event:" << event);
@@ -627,6 +748,7 @@ namespace WebUI {
         //Hostname needs to be set before mode to take effect
         WiFi.setHostname(wifi_hostname->get());
         WiFi.mode(WIFI_STA);
+        WiFi.setAutoReconnect(false);  // Reconnection is done by reconnect_attempt()
         WiFi.setMinSecurity(static_cast<wifi_auth_mode_t>(wifi_sta_min_security->get()));
         WiFi.setScanMethod(wifi_fast_scan->get() ? WIFI_FAST_SCAN : WIFI_ALL_CHANNEL_SCAN);
         //Get parameters for STA
@@ -717,6 +839,7 @@ namespace WebUI {
      */
 
     void WiFiConfig::reset() {
+        stationWanted = false;
         WiFi.persistent(false);
         WiFi.disconnect(true);
         WiFi.enableSTA(false);
@@ -725,6 +848,7 @@ namespace WebUI {
     }
 
     void WiFiConfig::StopWiFi() {
+        stationWanted = false;
         if (WiFi.getMode() != WIFI_MODE_NULL) {
             if ((WiFi.getMode() == WIFI_STA) || (WiFi.getMode() == WIFI_AP_STA)) {
                 WiFi.disconnect(true);
@@ -787,7 +911,13 @@ namespace WebUI {
             WiFi.onEvent(WiFiConfig::WiFiEvent);
             _events_registered = true;
         }
+        if (!reconnectTimer) {
+            reconnectTimer = xTimerCreate("WiFiReconnect", firstReconnectWait, false, nullptr, reconnect_attempt);
+        }
+        stationWanted = WiFi.getMode() == WIFI_STA;
         esp_wifi_set_ps(WIFI_PS_NONE);
+        radioAwake = true;
+        idleSince  = 0;
         log_info("WiFi on");
         wifi_services.begin();
         return true;
@@ -821,7 +951,10 @@ namespace WebUI {
     /**
      * Handle not critical actions that must be done in sync environment
      */
-    void WiFiConfig::handle() { wifi_services.handle(); }
+    void WiFiConfig::handle() {
+        wifi_services.handle();
+        update_power_save();
+    }
 
     // Used by js/scanwifidlg.js
     Error WiFiConfig::listAPs(char* parameter, AuthenticationLevel auth_level, Channel& out) {  // ESP410
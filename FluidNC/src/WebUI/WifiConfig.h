@@ -26,6 +26,7 @@ namespace WebUI {
         static void handle() {}
         static bool isOn() { return false; }
         static void showWifiStats(Channel& out) {}
+        static void reconnect() {}
     };
     extern WiFiConfig wifi_config;
 }
@@ -102,6 +103,9 @@ namespace WebUI {
         static void    reset_settings();
         static bool    isOn();
 
+        // Starts reconnecting the station in the background if it is not connected
+        static void reconnect();
+
         static Error listAPs(char* parameter, AuthenticationLevel auth_level, Channel& out);
         static void  showWifiStats(Channel& out);
 
@@ -123,6 +127,8 @@ namespace WebUI {
     extern StringSetting* wifi_sta_password;
 
     extern EnumSetting*   wifi_fast_scan;
+    extern EnumSetting*   wifi_power_save;
+    extern IntSetting*    wifi_idle_tx_power;
     extern EnumSetting*   wifi_sta_min_security;
     extern EnumSetting*   wifi_sta_mode;
     extern IPaddrSetting* wifi_sta_ip;
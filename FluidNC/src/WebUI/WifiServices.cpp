@@ -123,7 +123,6 @@ namespace WebUI {
             }
         }
         ArduinoOTA.handle();
-        webServer.handle();
         telnetServer.handle();
     }
 }
@@ -34,6 +34,11 @@
 
 #include "xmodem.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
 static Channel* serialPort;
 static Print*   file;
 
@@ -114,6 +119,61 @@ static void flushinput(void) {
         ;
 }
 
+static void cancel(void) {
+    flushinput();
+    _outbyte(CAN);
+    _outbyte(CAN);
+    _outbyte(CAN);
+}
+
+// Reads the rest of a packet after its first byte.  The bytes of a packet come
+// back to back, so they are read in as few calls as the UART delivers them,
+// allowing a second for each run of them to arrive.
+static bool read_rest(uint8_t* buf, size_t len) {
+    while (len) {
+        size_t n = serialPort->timedReadBytes(buf, len, DLY_1S);
+        if (n == 0) {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Received data is gathered into chunks of this size before it is written, so
+// that the file system gets a few large writes at sector boundaries instead of
+// a small one for every packet.  Without memory for a chunk, packets are
+// written as they come.
+static const size_t chunkSize = 4096;
+static uint8_t*     chunk;
+static size_t       chunk_len;
+
+static void write_bytes(const uint8_t* buf, size_t len) {
+    if (!chunk) {
+        file->write(buf, len);
+        return;
+    }
+    while (len) {
+        size_t n = std::min(len, chunkSize - chunk_len);
+        memcpy(chunk + chunk_len, buf, n);
+        chunk_len += n;
+        buf += n;
+        len -= n;
+        if (chunk_len == chunkSize) {
+            file->write(chunk, chunk_len);
+            chunk_len = 0;
+        }
+    }
+}
+
+static void flush_chunk() {
+    if (chunk_len) {
+        file->write(chunk, chunk_len);
+        chunk_len = 0;
+    }
+}
+
 // We delay writing each packet until the next one arrives
 // so that we can remove trailing control-Z's in only the
 // last one.  The Xmodem protocol has no good way to denote
@@ -124,44 +184,54 @@ static void flushinput(void) {
 // fails with binary files that are supposed to have trailing
 // control-Z's.  Doing the control-Z removal only on the final
 // packet avoids removing interior control-Z's that happen to
-// land at the end of a packet.
+// land at the end of a packet.  YMODEM sends the size of the
+// file, so the final packet is cut to that instead.
 static uint8_t held_packet[1024];
 static size_t  held_packet_len;
-static void    flush_packet(size_t packet_len, size_t& total_len) {
+static size_t  file_size;  // From the YMODEM header, SIZE_MAX if not known
+static void    flush_packet(size_t& total_len) {
     if (held_packet_len > 0) {
-        // Remove trailing ctrl-z's on the final packet
         size_t count;
-        for (count = held_packet_len; count > 0; --count) {
-            if (held_packet[count - 1] != CTRLZ) {
-                break;
+        if (file_size != SIZE_MAX) {
+            count = file_size > total_len ? std::min(held_packet_len, file_size - total_len) : 0;
+        } else {
+            // Remove trailing ctrl-z's on the final packet
+            for (count = held_packet_len; count > 0; --count) {
+                if (held_packet[count - 1] != CTRLZ) {
+                    break;
+                }
             }
         }
-        file->write(held_packet, count);
+        write_bytes(held_packet, count);
         total_len += count;
         held_packet_len = 0;
     }
+    flush_chunk();
 }
 static void write_packet(uint8_t* buf, size_t packet_len, size_t& total_len) {
     if (held_packet_len > 0) {
-        file->write(held_packet, held_packet_len);
+        write_bytes(held_packet, held_packet_len);
         total_len += held_packet_len;
         held_packet_len = 0;
     }
     memcpy(held_packet, buf, packet_len);
     held_packet_len = packet_len;
 }
-int xmodemReceive(Channel* serial, FileStream* out) {
-    serialPort      = serial;
+
+// Receives the data packets of a file, starting from packet 1, until the sender
+// sends EOT.  In a YMODEM batch the sender goes on to the next header after
+// that, instead of going quiet.
+static int receive_file(uint8_t* xbuff, FileStream* out, size_t size, bool batch) {
     file            = out;
+    file_size       = size;
     held_packet_len = 0;
+    chunk_len       = 0;
 
-    uint8_t  xbuff[1030]; /* 1024 for XModem 1k + 3 head chars + 2 crc + nul */
-    uint8_t* p;
-    int      bufsz = 0, crc = 0;
-    uint8_t  trychar  = 'C';
-    uint8_t  packetno = 1;
-    int      i, c           = 0;
-    int      retry, retrans = MAXRETRANS;
+    int     bufsz = 0, crc = 0;
+    uint8_t trychar  = 'C';
+    uint8_t packetno = 1;
+    int     c        = 0;
+    int     retry, retrans = MAXRETRANS;
 
     size_t len = 0;
 
@@ -178,9 +248,11 @@ int xmodemReceive(Channel* serial, FileStream* out) {
                         bufsz = 1024;
                         goto start_recv;
                     case EOT:
-                        flush_packet(bufsz, len);
+                        flush_packet(len);
                         _outbyte(ACK);
-                        flushinput();
+                        if (!batch) {
+                            flushinput();
+                        }
                         return len; /* normal end */
                     case CAN:
                         if ((c = _inbyte(DLY_1S)) == CAN) {
@@ -194,39 +266,31 @@ int xmodemReceive(Channel* serial, FileStream* out) {
                 }
             }
         }
-        if (trychar == 'C') {
+        // YMODEM always uses CRCs
+        if (trychar == 'C' && !batch) {
             trychar = NAK;
             continue;
         }
-        flushinput();
-        _outbyte(CAN);
-        _outbyte(CAN);
-        _outbyte(CAN);
+        cancel();
         return -2; /* sync error */
 
     start_recv:
         if (trychar == 'C')
             crc = 1;
-        trychar = 0;
-        p       = xbuff;
-        *p++    = c;
-        for (i = 0; i < (bufsz + (crc ? 1 : 0) + 3); ++i) {
-            if ((c = _inbyte(DLY_1S)) < 0)
-                goto reject;
-            *p++ = c;
-        }
+        trychar  = 0;
+        xbuff[0] = c;
+        if (!read_rest(xbuff + 1, bufsz + (crc ? 1 : 0) + 3))
+            goto reject;
 
-        if (xbuff[1] == (uint8_t)(~xbuff[2]) && (xbuff[1] == packetno || xbuff[1] == packetno - 1) && check(crc, &xbuff[3], bufsz)) {
+        if (xbuff[1] == (uint8_t)(~xbuff[2]) && (xbuff[1] == packetno || xbuff[1] == (uint8_t)(packetno - 1)) &&
+            check(crc, &xbuff[3], bufsz)) {
             if (xbuff[1] == packetno) {
                 write_packet(xbuff + 3, bufsz, len);
                 ++packetno;
                 retrans = MAXRETRANS + 1;
             }
             if (--retrans <= 0) {
-                flushinput();
-                _outbyte(CAN);
-                _outbyte(CAN);
-                _outbyte(CAN);
+                cancel();
                 return -3; /* too many retry error */
             }
             _outbyte(ACK);
@@ -238,6 +302,90 @@ int xmodemReceive(Channel* serial, FileStream* out) {
     }
 }
 
+static void start_receive(Channel* serial) {
+    serialPort = serial;
+    chunk      = static_cast<uint8_t*>(malloc(chunkSize));
+}
+
+static void end_receive() {
+    free(chunk);
+    chunk = nullptr;
+}
+
+int xmodemReceive(Channel* serial, FileStream* out) {
+    uint8_t xbuff[1030]; /* 1024 for XModem 1k + 3 head chars + 2 crc + nul */
+
+    start_receive(serial);
+    int len = receive_file(xbuff, out, SIZE_MAX, false);
+    end_receive();
+    return len;
+}
+
+// Receives YMODEM packet 0, which holds the name of the next file and its size,
+// or an empty name at the end of the batch.  The packet is ACKed at once, and
+// the data then starts with the 'C' that receive_file() sends.
+static int receive_header(uint8_t* xbuff) {
+    for (int retry = 0; retry < 16; ++retry) {
+        _outbyte('C');
+        int c = _inbyte((DLY_1S) << 1);
+        if (c == CAN && _inbyte(DLY_1S) == CAN) {
+            flushinput();
+            _outbyte(ACK);
+            return -1; /* canceled by remote */
+        }
+        if (c != SOH && c != STX) {
+            continue;
+        }
+        int bufsz = c == SOH ? 128 : 1024;
+        xbuff[0]  = c;
+        if (read_rest(xbuff + 1, bufsz + 4) && xbuff[1] == 0 && xbuff[2] == 0xff && check(1, &xbuff[3], bufsz)) {
+            xbuff[3 + bufsz - 1] = '\0';  // The name and size are NUL-terminated within the packet
+            _outbyte(ACK);
+            return bufsz;
+        }
+        flushinput();
+    }
+    cancel();
+    return -2; /* sync error */
+}
+
+int ymodemReceive(Channel* serial, const ymodem_open_t& open, const ymodem_close_t& close) {
+    uint8_t xbuff[1030];
+    int     files = 0;
+
+    start_receive(serial);
+    for (;;) {
+        int bufsz = receive_header(xbuff);
+        if (bufsz < 0) {
+            files = bufsz;
+            break;
+        }
+        const char* name = (const char*)&xbuff[3];
+        if (!*name) {
+            break; /* end of batch */
+        }
+        // The size follows the name in decimal, then other fields that are not used
+        const char* sizestr = name + strlen(name) + 1;
+        size_t      size    = *sizestr ? strtoul(sizestr, nullptr, 10) : SIZE_MAX;
+
+        FileStream* out = open(name);
+        if (!out) {
+            cancel();
+            files = -4; /* cannot create file */
+            break;
+        }
+        int len = receive_file(xbuff, out, size, true);
+        close(out, len);
+        if (len < 0) {
+            files = len;
+            break;
+        }
+        ++files;
+    }
+    end_receive();
+    return files;
+}
+
 int xmodemTransmit(Channel* serial, FileStream* infile) {
     serialPort = serial;
 
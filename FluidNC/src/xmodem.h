@@ -3,5 +3,16 @@
 #include "Channel.h"
 #include "FileStream.h"
 
+#include <functional>
+
 int xmodemReceive(Channel* serial, FileStream* outfile);
+
+// YMODEM batch receive.  open() is called with the name of each file as the sender
+// announces it, and returns the stream to write it to, or nullptr to stop.  close()
+// is called with the stream when the file is done, with the number of bytes written
+// or a negative error.  Returns the number of files received or a negative error.
+using ymodem_open_t  = std::function<FileStream*(const char* name)>;
+using ymodem_close_t = std::function<void(FileStream* file, int size)>;
+
+int ymodemReceive(Channel* serial, const ymodem_open_t& open, const ymodem_close_t& close);
 int xmodemTransmit(Channel* serial, FileStream* infile);
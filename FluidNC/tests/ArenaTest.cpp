@@ -0,0 +1,65 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/Configuration/Arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using Configuration::Arena;
+
+namespace {
+    struct Small : public Configuration::ArenaAllocated {
+        int32_t value[3];
+    };
+    struct Large : public Configuration::ArenaAllocated {
+        char bytes[Arena::blockSize];
+    };
+}
+
+TEST(Arena, ClosedUsesTheHeap) {
+    ASSERT_TRUE(Arena::release());
+    auto p = new Small();
+    EXPECT_EQ(Arena::used(), 0u);
+    EXPECT_EQ(Arena::live(), 0u);
+    delete p;
+}
+
+TEST(Arena, ObjectsArePackedAndAligned) {
+    ASSERT_TRUE(Arena::release());
+    Arena::open();
+    std::vector<Small*> objects;
+    for (int i = 0; i < 1000; i++) {
+        objects.push_back(new Small());
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(objects.back()) % alignof(std::max_align_t), 0u);
+    }
+    const size_t align  = alignof(std::max_align_t);
+    size_t       stride = reinterpret_cast<char*>(objects[1]) - reinterpret_cast<char*>(objects[0]);
+    EXPECT_EQ(stride, (sizeof(Small) + align - 1) / align * align);
+
+    // A large object gets a block of its own, and the next small one still goes in the
+    // block that was being filled
+    size_t before = Arena::reserved();
+    auto   large  = new Large();
+    EXPECT_GE(Arena::reserved() - before, sizeof(Large));
+    EXPECT_LT(Arena::reserved() - before, sizeof(Large) + 64);
+    before     = Arena::reserved();
+    auto after = new Small();
+    EXPECT_EQ(Arena::reserved(), before);
+    Arena::close();
+
+    EXPECT_EQ(Arena::live(), 1002u);
+    EXPECT_GE(Arena::reserved(), Arena::used());
+    EXPECT_LT(Arena::reserved(), Arena::used() + 2 * Arena::blockSize);
+
+    // Blocks stay until the last object is gone
+    for (auto p : objects) {
+        delete p;
+    }
+    delete large;
+    EXPECT_FALSE(Arena::release());
+    delete after;
+    EXPECT_TRUE(Arena::release());
+    EXPECT_EQ(Arena::reserved(), 0u);
+}
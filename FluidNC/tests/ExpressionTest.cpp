@@ -0,0 +1,108 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/Expression.h"
+
+#include <cstring>
+#include <string>
+
+// Lines reach the parser collapsed: upper case, without spaces
+static Error eval(const char* text, float& value, size_t& end) {
+    end = 0;
+    return Expression::read_value(text, &end, &value);
+}
+
+static float eval(const char* text) {
+    float  value = -999;
+    size_t end;
+    EXPECT_EQ(eval(text, value, end), Error::Ok) << text;
+    EXPECT_EQ(end, strlen(text)) << text;
+    return value;
+}
+
+static void set(const char* text) {
+    Expression::Assignment assignment;
+    size_t                 end = 0;
+    ASSERT_EQ(Expression::read_assignment(text, &end, assignment), Error::Ok) << text;
+    ASSERT_EQ(Expression::assign(assignment), Error::Ok) << text;
+}
+
+TEST(Expression, Precedence) {
+    EXPECT_FLOAT_EQ(eval("[1+2*3]"), 7);
+    EXPECT_FLOAT_EQ(eval("[[1+2]*3]"), 9);
+    EXPECT_FLOAT_EQ(eval("[2**3**2]"), 64);  // Left to right, as LinuxCNC
+    EXPECT_FLOAT_EQ(eval("[10-4-3]"), 3);
+    EXPECT_FLOAT_EQ(eval("[7MOD3]"), 1);
+    EXPECT_FLOAT_EQ(eval("[-7MOD3]"), 2);
+    EXPECT_FLOAT_EQ(eval("[1+1EQ2]"), 1);
+    EXPECT_FLOAT_EQ(eval("[1LT2AND3GE4]"), 0);
+    EXPECT_FLOAT_EQ(eval("[1LT2OR3GE4]"), 1);
+    EXPECT_FLOAT_EQ(eval("[2*-3]"), -6);
+    EXPECT_FLOAT_EQ(eval("-[1+2]"), -3);
+}
+
+TEST(Expression, Functions) {
+    EXPECT_NEAR(eval("SIN[30]"), 0.5f, 1e-6);
+    EXPECT_NEAR(eval("ATAN[1]/[1]"), 45, 1e-4);
+    EXPECT_FLOAT_EQ(eval("SQRT[16]"), 4);
+    EXPECT_FLOAT_EQ(eval("FIX[-1.5]"), -2);
+    EXPECT_FLOAT_EQ(eval("FUP[1.2]"), 2);
+    EXPECT_FLOAT_EQ(eval("ABS[-2.5]"), 2.5f);
+
+    float  value;
+    size_t end;
+    EXPECT_EQ(eval("SQRT[-1]", value, end), Error::ExpressionInvalidArgument);
+    EXPECT_EQ(eval("[1/0]", value, end), Error::ExpressionDivideByZero);
+    EXPECT_EQ(eval("NOPE[1]", value, end), Error::ExpressionSyntaxError);
+    EXPECT_EQ(eval("[1+2", value, end), Error::ExpressionSyntaxError);
+    EXPECT_EQ(eval("Y", value, end), Error::BadNumberFormat);
+}
+
+TEST(Expression, Parameters) {
+    set("#1=5");
+    set("#31=[#1*2]");
+    set("#<_WIDTH>=2.5");
+    set("#<DEPTH>=-1");
+    EXPECT_FLOAT_EQ(eval("#1"), 5);
+    EXPECT_FLOAT_EQ(eval("#31"), 10);
+    EXPECT_FLOAT_EQ(eval("##1"), 0);  // #5, never set
+    EXPECT_FLOAT_EQ(eval("-#<_WIDTH>"), -2.5f);
+    EXPECT_FLOAT_EQ(eval("[#<DEPTH>+#1]"), 4);
+    EXPECT_FLOAT_EQ(eval("EXISTS[#<DEPTH>]"), 1);
+    EXPECT_FLOAT_EQ(eval("EXISTS[#<NONE>]"), 0);
+
+    // Only the name is read, so the rest of the line is the next word
+    float  value;
+    size_t end;
+    EXPECT_EQ(eval("#1Y2", value, end), Error::Ok);
+    EXPECT_EQ(end, 2u);
+    EXPECT_EQ(eval("#<NONE>", value, end), Error::ExpressionUnknownParameter);
+
+    Expression::Assignment assignment;
+    end = 0;
+    ASSERT_EQ(Expression::read_assignment("#5221=1", &end, assignment), Error::Ok);
+    EXPECT_EQ(Expression::assign(assignment), Error::ExpressionReadOnlyParameter);
+}
+
+TEST(Expression, Frames) {
+    set("#2=7");
+    set("#<LOCAL>=1");
+    set("#<_GLOBAL>=2");
+    float args[] = { 3, 4 };
+    ASSERT_TRUE(Expression::push_frame(args, 2));
+    EXPECT_FLOAT_EQ(eval("#1"), 3);
+    EXPECT_FLOAT_EQ(eval("#2"), 4);
+    EXPECT_FLOAT_EQ(eval("#3"), 0);
+    EXPECT_FLOAT_EQ(eval("EXISTS[#<LOCAL>]"), 0);
+    EXPECT_FLOAT_EQ(eval("#<_GLOBAL>"), 2);
+    Expression::pop_frame();
+    EXPECT_FLOAT_EQ(eval("#2"), 7);
+    EXPECT_FLOAT_EQ(eval("#<LOCAL>"), 1);
+
+    for (size_t i = 0; i < Expression::maxFrames; i++) {
+        ASSERT_TRUE(Expression::push_frame(nullptr, 0));
+    }
+    EXPECT_FALSE(Expression::push_frame(nullptr, 0));
+    Expression::reset();
+    EXPECT_FLOAT_EQ(eval("#2"), 7);
+}
@@ -0,0 +1,72 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/FloatFormat.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static std::string fixed(float value, int decimals) {
+    char buf[fixedFormatMax];
+    size_t length = format_fixed(buf, value, decimals);
+    EXPECT_EQ(length, strlen(buf));
+    return buf;
+}
+
+static std::string printed(float value, int decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    return buf;
+}
+
+TEST(FloatFormat, Simple) {
+    ASSERT_EQ(fixed(0.0f, 3), "0.000");
+    ASSERT_EQ(fixed(1.5f, 3), "1.500");
+    ASSERT_EQ(fixed(-12.25f, 4), "-12.2500");
+    ASSERT_EQ(fixed(100.0f, 0), "100");
+    ASSERT_EQ(fixed(25.4f, 1), "25.4");
+}
+
+TEST(FloatFormat, NegativeZero) {
+    ASSERT_EQ(fixed(-0.0f, 3), "-0.000");
+    ASSERT_EQ(fixed(-0.0001f, 3), "-0.000");
+}
+
+TEST(FloatFormat, TiesRoundToEven) {
+    // 0.0625 and 0.5 are exact in binary, so these are true ties
+    ASSERT_EQ(fixed(0.0625f, 3), printed(0.0625f, 3));
+    ASSERT_EQ(fixed(0.5f, 0), printed(0.5f, 0));
+    ASSERT_EQ(fixed(1.5f, 0), printed(1.5f, 0));
+}
+
+TEST(FloatFormat, Huge) {
+    ASSERT_EQ(fixed(1e20f, 3), printed(1e20f, 3));
+}
+
+TEST(FloatFormat, MatchesPrintf) {
+    srand(1);
+    for (int i = 0; i < 200000; ++i) {
+        int   decimals = i % 5;
+        float value    = (float(rand()) / RAND_MAX - 0.5f) * (i % 3 == 0 ? 2000000.0f : 2000.0f);
+        ASSERT_EQ(fixed(value, decimals), printed(value, decimals)) << value;
+    }
+}
+
+static std::string scaled(int32_t value, int decimals) {
+    char buf[fixedFormatMax];
+    size_t length = format_scaled(buf, value, decimals);
+    EXPECT_EQ(length, strlen(buf));
+    return buf;
+}
+
+TEST(FloatFormat, Scaled) {
+    ASSERT_EQ(scaled(0, 3), "0.000");
+    ASSERT_EQ(scaled(12345, 3), "12.345");
+    ASSERT_EQ(scaled(-5, 3), "-0.005");
+    ASSERT_EQ(scaled(-125400, 4), "-12.5400");
+    ASSERT_EQ(scaled(42, 0), "42");
+    ASSERT_EQ(scaled(INT32_MIN, 3), "-2147483.648");
+    ASSERT_EQ(scaled(INT32_MAX, 6), "2147.483647");
+}
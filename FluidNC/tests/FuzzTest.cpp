@@ -0,0 +1,227 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Fuzz targets for the parsers that see the input from the network, and a test that
+// runs them over generated inputs, and over a fuzzing corpus, and flags the inputs that
+// take much longer per character than the median for their parser.
+//
+// LLVMFuzzerTestOneInput() is the libFuzzer entry point.  The first byte of an input
+// picks the parser and the rest is what it is fed.  To fuzz, build it with clang, without
+// test_main.cpp, from FluidNC/:
+//   clang++ -std=c++17 -g -fsanitize=fuzzer,address,undefined -I. -Isrc -I../X86TestSupport/TestSupport
+//       tests/FuzzTest.cpp src/UTF8.cpp src/lineedit.cpp src/ReadFloat.cpp
+//       ../X86TestSupport/TestSupport/Print.cpp -lgtest -lpthread -o /tmp/fuzz
+//   mkdir -p /tmp/corpus && /tmp/fuzz -max_len=256 /tmp/corpus
+// The corpus that it grows covers the parsers' branches, and FUZZ_CORPUS=/tmp/corpus
+// makes Fuzz.Outliers time every input in it as well.
+//
+// gc_execute_line() and Channel::pollLine() need the machine, so the GCode target runs
+// the number reader that gc_execute_line() spends its time in, over the words of a line
+// as it does.
+
+#include "gtest/gtest.h"
+#include "src/UTF8.h"
+#include "src/lineedit.h"
+#include "src/ReadFloat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+static const size_t maxLine = 255;  // Channel::maxLine
+
+// Setting names for completion, in place of the ones that Completer.cpp finds
+static const char* names[] = { "Report/Interval", "Report/Status", "Sta/SSID", "Sta/Password", "Start/Message", "Stepping/Trace" };
+
+int num_initial_matches(char* key, int keylen, int matchnum, char* matchname) {
+    int nfound = 0;
+    for (auto name : names) {
+        if (int(strlen(name)) >= keylen && strncasecmp(key, name, keylen) == 0) {
+            if (matchname && nfound == matchnum) {
+                strcpy(matchname, name);
+            }
+            ++nfound;
+        }
+    }
+    return nfound;
+}
+
+class NullPrint : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+};
+
+enum Target { Utf8 = 0, Edit, Words, nTargets };
+
+static const char* targetNames[] = { "UTF8", "lineedit", "GCode words" };
+
+static void fuzzUtf8(const uint8_t* data, size_t size) {
+    UTF8 utf8;
+    for (size_t i = 0; i < size; i++) {
+        uint32_t value;
+        if (utf8.decode(data[i], value) == 1 && value < 0x110000) {
+            // Whatever decodes to a code point must come back from its encoding
+            uint32_t again;
+            if (!utf8.decode(utf8.encode(value), again) || again != value) {
+                abort();
+            }
+        }
+    }
+}
+
+// As a UartChannel feeds its editor, with the realtime characters taken out
+static void fuzzEdit(const uint8_t* data, size_t size) {
+    NullPrint out;
+    char      line[maxLine];
+    Lineedit  editor(&out, line, maxLine - 1);
+    for (size_t i = 0; i < size; i++) {
+        uint8_t c = data[i];
+        if (editor.realtime(c) && (c >= 0x80 || c == 0x18 || c == '?' || c == '~' || c == '!')) {
+            continue;
+        }
+        if (editor.step(c)) {
+            int len = editor.finish();
+            if (len < 0 || len >= int(maxLine)) {
+                abort();
+            }
+        }
+    }
+}
+
+static void fuzzWords(const uint8_t* data, size_t size) {
+    char line[maxLine];
+    size = std::min(size, maxLine - 1);
+    memcpy(line, data, size);
+    line[size] = '\0';
+
+    size_t pos = 0;
+    while (line[pos]) {
+        pos++;  // Word letter
+        size_t start = pos;
+        float  value;
+        if (!read_float(line, &pos, &value)) {
+            pos = start;
+        } else if (pos <= start || pos > size) {
+            abort();
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    switch (data[0] % nTargets) {
+        case Utf8:
+            fuzzUtf8(data + 1, size - 1);
+            break;
+        case Edit:
+            fuzzEdit(data + 1, size - 1);
+            break;
+        case Words:
+            fuzzWords(data + 1, size - 1);
+            break;
+    }
+    return 0;
+}
+
+// Inputs that are likely to find the slow paths: words, numbers, escape sequences,
+// editing keys, completion and multibyte characters, in random runs of random length
+static std::vector<uint8_t> generate(std::mt19937& rng, Target target) {
+    static const char* pieces[] = {
+        "G1", "X-12.5", "F1e9", "0000000000", ".", "-", "+", "(comment)", ";", "$", "S", "St", "\r", "\n",
+        "\x1b[A", "\x1b[B", "\x1b[C", "\x1b[D", "\x1b[3~", "\t", "\b", "\x0b", "\x19", "\x7f",
+        "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xc3", "\xff",
+    };
+    std::vector<uint8_t> input = { uint8_t(target) };
+    size_t               want  = std::uniform_int_distribution<size_t>(1, maxLine)(rng);
+    while (input.size() < want) {
+        const char* piece = pieces[std::uniform_int_distribution<size_t>(0, std::size(pieces) - 1)(rng)];
+        int         times = std::uniform_int_distribution<int>(1, 8)(rng);
+        while (times--) {
+            input.insert(input.end(), piece, piece + strlen(piece));
+        }
+    }
+    input.resize(want);
+    return input;
+}
+
+static std::vector<std::vector<uint8_t>> corpus() {
+    std::vector<std::vector<uint8_t>> inputs;
+    const char*                       dir = getenv("FUZZ_CORPUS");
+    if (!dir) {
+        return inputs;
+    }
+    for (auto& entry : std::filesystem::directory_iterator(dir)) {
+        std::ifstream file(entry.path(), std::ios::binary);
+        inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    return inputs;
+}
+
+// The fastest of a few runs, so that a preemption does not make an outlier
+static double nsPerByte(const std::vector<uint8_t>& input) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best                                              = std::min(best, elapsed.count());
+    }
+    return best / input.size();
+}
+
+TEST(Fuzz, Outliers) {
+    // An input is an outlier when it is this much slower per character than the median
+    // for its parser.  The floor keeps timer noise on tiny inputs out of it.
+    const double factor    = 50;
+    const double floorNsec = 20000;
+
+    std::mt19937                      rng(104);  // Fixed, so every run sees the same inputs
+    std::vector<std::vector<uint8_t>> inputs = corpus();
+    size_t                            fromCorpus = inputs.size();
+    for (int target = 0; target < nTargets; target++) {
+        for (int i = 0; i < 1000; i++) {
+            inputs.push_back(generate(rng, Target(target)));
+        }
+    }
+
+    std::vector<double> perByte[nTargets];
+    std::vector<size_t> which[nTargets];
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i].empty()) {
+            continue;
+        }
+        int target = inputs[i][0] % nTargets;
+        perByte[target].push_back(nsPerByte(inputs[i]));
+        which[target].push_back(i);
+    }
+
+    int outliers = 0;
+    for (int target = 0; target < nTargets; target++) {
+        auto sorted = perByte[target];
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size() / 2];
+        printf("%s: %zu inputs, median %.1f ns per character\n", targetNames[target], sorted.size(), median);
+        for (size_t j = 0; j < perByte[target].size(); j++) {
+            auto&  input = inputs[which[target][j]];
+            double nsec  = perByte[target][j] * input.size();
+            if (perByte[target][j] > factor * median && nsec > floorNsec) {
+                printf("  outlier: %.1f ns per character, %zu characters, %s input %zu\n",
+                       perByte[target][j],
+                       input.size(),
+                       which[target][j] < fromCorpus ? "corpus" : "generated",
+                       which[target][j]);
+                ++outliers;
+            }
+        }
+    }
+    EXPECT_EQ(outliers, 0);
+}
@@ -0,0 +1,135 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/ReadFloat.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static bool read(const char* text, float& value, size_t& end) {
+    end = 0;
+    return read_float(text, &end, &value);
+}
+
+TEST(ReadFloat, Integers) {
+    float  value;
+    size_t end;
+    ASSERT_TRUE(read("0", value, end));
+    ASSERT_EQ(value, 0.0f);
+    ASSERT_EQ(end, 1);
+    ASSERT_TRUE(read("1200", value, end));
+    ASSERT_EQ(value, 1200.0f);
+    ASSERT_TRUE(read("-42", value, end));
+    ASSERT_EQ(value, -42.0f);
+    ASSERT_TRUE(read("+7", value, end));
+    ASSERT_EQ(value, 7.0f);
+}
+
+TEST(ReadFloat, Decimals) {
+    float  value;
+    size_t end;
+    ASSERT_TRUE(read("1.", value, end));
+    ASSERT_EQ(value, 1.0f);
+    ASSERT_EQ(end, 2);
+    ASSERT_TRUE(read("-.5", value, end));
+    ASSERT_EQ(value, -0.5f);
+    ASSERT_TRUE(read("007.50", value, end));
+    ASSERT_EQ(value, 7.5f);
+    ASSERT_TRUE(read("0.0001", value, end));
+    ASSERT_EQ(value, 0.0001f);
+}
+
+TEST(ReadFloat, StopsAtNextWord) {
+    float  value;
+    size_t end;
+    ASSERT_TRUE(read("12.5Y3", value, end));
+    ASSERT_EQ(value, 12.5f);
+    ASSERT_EQ(end, 4);
+    ASSERT_TRUE(read("1.2.3", value, end));
+    ASSERT_EQ(value, 1.2f);
+    ASSERT_EQ(end, 3);
+    // Scientific notation is not g-code
+    ASSERT_TRUE(read("1E3", value, end));
+    ASSERT_EQ(value, 1.0f);
+    ASSERT_EQ(end, 1);
+}
+
+TEST(ReadFloat, NoDigits) {
+    float  value;
+    size_t end;
+    ASSERT_FALSE(read("", value, end));
+    ASSERT_FALSE(read("-", value, end));
+    ASSERT_FALSE(read(".", value, end));
+    ASSERT_FALSE(read("-.X", value, end));
+    ASSERT_FALSE(read("X1", value, end));
+}
+
+TEST(ReadFloat, RoundsLikeStrtof) {
+    // Up to 7 significant digits, the result must be the correctly rounded float
+    char text[32];
+    srand(1);
+    for (int i = 0; i < 200000; i++) {
+        long mantissa = rand() % 10000000;
+        int  decimals = rand() % 7;
+        int  n        = snprintf(text, sizeof(text), "%s%ld", rand() % 2 ? "-" : "", mantissa);
+        int  digits   = n - (text[0] == '-');
+        if (decimals && digits > decimals) {
+            memmove(&text[n - decimals + 1], &text[n - decimals], decimals + 1);
+            text[n - decimals] = '.';
+        }
+        float  value;
+        size_t end;
+        ASSERT_TRUE(read(text, value, end)) << text;
+        ASSERT_EQ(value, strtof(text, nullptr)) << text;
+        ASSERT_EQ(end, strlen(text)) << text;
+    }
+}
+
+TEST(ReadFloat, LongNumbers) {
+    float  value;
+    size_t end;
+    ASSERT_TRUE(read("123456789.5", value, end));
+    ASSERT_FLOAT_EQ(value, 123456789.5f);
+    ASSERT_TRUE(read("0.000000012345", value, end));
+    ASSERT_FLOAT_EQ(value, 0.000000012345f);
+    ASSERT_TRUE(read("98765432109876", value, end));
+    ASSERT_FLOAT_EQ(value, 98765432109876.0f);
+}
+
+// Not a pass/fail test: reports the rate at which the words of typical CAM output,
+// as collapsed by collapseGCode(), are split and converted
+TEST(ReadFloat, Benchmark) {
+    const char* lines[] = {
+        "G1X12.345Y-3.21F1200",
+        "G1X12.412Y-3.198",
+        "G1X12.5Y-3.17Z-0.25",
+        "G2X14.2Y-1.5I0.85J1.7",
+        "G1X-103.0254Y48.3371S850",
+        "G0Z5.",
+        "G1Z-1.5F300",
+        "G3X0.Y25.4R12.7",
+        "N1234G1X57.8123Y-12.0007",
+        "M3S12000",
+    };
+    const int nLines = sizeof(lines) / sizeof(lines[0]);
+    const int passes = 100000;
+
+    float sum   = 0;
+    auto  start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < nLines; i++) {
+            const char* line = lines[i];
+            size_t      pos  = 0;
+            while (line[pos]) {
+                pos++;  // Word letter
+                float value;
+                ASSERT_TRUE(read_float(line, &pos, &value));
+                sum += value;
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("read_float: %.0f lines/s (checksum %g)\n", passes * nLines / elapsed.count(), sum);
+}
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# Compare the results of a benchmark run with a saved baseline.
+#
+# Usage: python benchmark.py [--save] [--tolerance 10] [--baseline file.json] [session.txt]
+#
+# Reads the [BENCH:name,value,unit] lines that $Benchmark, $SD/Bench and
+# $LocalFS/Bench send, from the captured session in the file or from stdin.
+# With --save, writes them to the baseline, by default benchmarks/<name>.json
+# for the board and configuration being measured, for committing alongside the
+# code.  Otherwise compares them with the baseline and exits with status 1 if
+# any result is worse than it by more than the tolerance, in percent.  Rates,
+# with units ending in /s, are better higher; times and cycles are better lower.
+
+import json, os, re, sys
+
+
+def read_results(infile):
+    result = re.compile(r"\[BENCH:([^,\]]+),([-0-9.]+),([^\]]*)\]")
+    results = {}
+    for line in infile:
+        m = result.search(line)
+        if m:
+            name, value, unit = m.groups()
+            results[name] = {"value": float(value), "unit": unit}
+    return results
+
+
+def main():
+    args = sys.argv[1:]
+    save = False
+    tolerance = 10.0
+    baseline = os.path.join("benchmarks", "baseline.json")
+    while args and args[0].startswith("--"):
+        opt = args.pop(0)
+        if opt == "--save":
+            save = True
+        elif opt == "--tolerance":
+            tolerance = float(args.pop(0))
+        elif opt == "--baseline":
+            baseline = args.pop(0)
+        else:
+            sys.exit("Unknown option " + opt)
+    infile = open(args[0]) if args else sys.stdin
+    results = read_results(infile)
+    if not results:
+        print("No [BENCH:] results found")
+        return 1
+
+    if save:
+        os.makedirs(os.path.dirname(baseline) or ".", exist_ok=True)
+        with open(baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Saved %d results to %s" % (len(results), baseline))
+        return 0
+
+    with open(baseline) as f:
+        base = json.load(f)
+    regressions = 0
+    for name in sorted(results):
+        now = results[name]
+        if name not in base:
+            print("%-32s %12.3f %-12s (new)" % (name, now["value"], now["unit"]))
+            continue
+        was = base[name]["value"]
+        change = (now["value"] - was) / was * 100.0 if was else 0.0
+        worse = -change if now["unit"].endswith("/s") else change
+        flag = ""
+        if worse > tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-32s %12.3f %-12s was %12.3f  %+6.1f%%%s" % (name, now["value"], now["unit"], was, change, flag))
+    for name in sorted(set(base) - set(results)):
+        print("%-32s missing" % name)
+    if regressions:
+        print("%d regressions beyond %.1f%%" % (regressions, tolerance))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
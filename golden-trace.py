@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# Record and compare golden position traces of motion bench runs.
+#
+# Usage: python golden-trace.py save session.txt golden/arcs.trace
+#        python golden-trace.py compare golden/arcs.trace session.txt [--steps 0] [--usecs 0] [--cpu-mhz 240]
+#
+# A session is captured from a controller with the position trace running on
+# the motion bench, for example for each program in golden/:
+#   $Stepping/Trace=1000
+#   $SD/Bench=arcs.nc
+#   $Stepping/Trace=Off
+# The bench runs on a virtual clock, so the [TRACE:usecs,steps...] lines are
+# the same on every run while the motion code behaves the same.  save keeps
+# them, relative to the first sample, as the golden trace to commit.  compare
+# checks a new session against it, sample by sample, and exits with status 1
+# if a sample is missing or any axis is further off than --steps.  --usecs
+# lets a sample match one that far away in time.  The trace time is 32 bits of
+# CPU ticks, so it wraps after 2^32 / --cpu-mhz microseconds.
+
+import bisect, re, sys
+
+
+def read_trace(infile, cpu_mhz):
+    trace = re.compile(r"\[TRACE:(\d+)((?:,-?\d+)+)\]")
+    wrap = (1 << 32) // cpu_mhz
+    samples = []
+    last = None
+    offset = 0
+    for line in infile:
+        m = trace.search(line)
+        if not m:
+            continue
+        usecs = int(m.group(1))
+        steps = [int(s) for s in m.group(2)[1:].split(",")]
+        if last is not None and usecs < last:
+            offset += wrap
+        last = usecs
+        samples.append((usecs + offset, steps))
+    if samples:
+        t0, s0 = samples[0]
+        samples = [(t - t0, [a - b for a, b in zip(s, s0)]) for t, s in samples]
+    return samples
+
+
+def read_golden(path):
+    samples = []
+    for line in open(path):
+        if line.startswith("#") or not line.strip():
+            continue
+        fields = [int(f) for f in line.split(",")]
+        samples.append((fields[0], fields[1:]))
+    return samples
+
+
+def save(session, path, cpu_mhz):
+    samples = read_trace(open(session), cpu_mhz)
+    if not samples:
+        print("No [TRACE:] samples found")
+        return 1
+    with open(path, "w") as f:
+        f.write("# usecs,steps... relative to the first sample, from %s\n" % session)
+        for usecs, steps in samples:
+            f.write("%d,%s\n" % (usecs, ",".join(str(s) for s in steps)))
+    print("Saved %d samples to %s" % (len(samples), path))
+    return 0
+
+
+def compare(path, session, max_steps, max_usecs, cpu_mhz):
+    golden = read_golden(path)
+    samples = read_trace(open(session), cpu_mhz)
+    if not samples:
+        print("No [TRACE:] samples found")
+        return 1
+    times = [t for t, _ in samples]
+    n_axes = len(golden[0][1]) if golden else 0
+    worst = [0] * n_axes
+    missing = 0
+    first_bad = None
+    for usecs, steps in golden:
+        i = bisect.bisect_left(times, usecs - max_usecs)
+        if i == len(times) or times[i] > usecs + max_usecs:
+            missing += 1
+            if first_bad is None:
+                first_bad = usecs
+            continue
+        for axis, (want, got) in enumerate(zip(steps, samples[i][1])):
+            off = abs(got - want)
+            worst[axis] = max(worst[axis], off)
+            if off > max_steps and first_bad is None:
+                first_bad = usecs
+    print("%d golden samples, %d in this session, %d missing" % (len(golden), len(samples), missing))
+    print("largest difference in steps per axis: %s" % " ".join(str(w) for w in worst))
+    if len(samples) != len(golden):
+        print("sample count differs by %d" % (len(samples) - len(golden)))
+    if first_bad is not None:
+        print("first difference at %.3f ms" % (first_bad / 1000.0))
+        return 1
+    return 0
+
+
+def main():
+    args = sys.argv[1:]
+    options = {"--steps": 0, "--usecs": 0, "--cpu-mhz": 240}
+    positional = []
+    while args:
+        arg = args.pop(0)
+        if arg in options:
+            options[arg] = int(args.pop(0))
+        else:
+            positional.append(arg)
+    if len(positional) == 3 and positional[0] == "save":
+        return save(positional[1], positional[2], options["--cpu-mhz"])
+    if len(positional) == 3 and positional[0] == "compare":
+        return compare(positional[1], positional[2], options["--steps"], options["--usecs"], options["--cpu-mhz"])
+    print("Usage: golden-trace.py save <session> <golden> | compare <golden> <session> [--steps N] [--usecs N] [--cpu-mhz N]")
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,14 @@
+(Arcs in each plane, by centre offset and by radius, and a helix)
+G21 G91 G94 G17
+G1 X10 F1500
+G2 X10 Y10 I10 J0
+G3 X-10 Y10 R10
+G2 X0 Y0 I0 J-10
+G18
+G2 X10 Z0 I5 K0 F800
+G19
+G3 Y5 Z0 J2.5 K0
+G17
+G2 X0 Y0 Z-2 I-5 J0 F1000
+G0 Z2
+G0 X-20 Y-25
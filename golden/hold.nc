@@ -0,0 +1,7 @@
+(Feed hold and overrides in the middle of long moves.  Run with
+ $SD/Bench=hold.nc,hold=800,feed=1500:150,rapid=2500:50)
+G21 G91 G94
+G1 X40 F1200
+G1 Y40
+G0 X-40
+G0 Y-40
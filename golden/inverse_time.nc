@@ -0,0 +1,7 @@
+(Inverse time feed rates, with a rotary axis if the machine has one)
+G21 G91 G93
+G1 X10 Y10 F60
+G1 X-5 Y5 F120
+G2 X-5 Y-5 I0 J-5 F30
+G94
+G0 X0 Y-10
@@ -0,0 +1,7 @@
+(Jogs between GCode moves)
+G21 G91 G94
+G1 X5 F1000
+$J=G91 G21 X10 Y5 F2000
+$J=G91 G21 Y-5 F2000
+G1 X-5 Y-5 F1000
+$J=G91 G21 X-10 Y5 F3000
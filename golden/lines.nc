@@ -0,0 +1,14 @@
+(Straight moves: rapids, feeds at several rates and short segments)
+G21 G91 G94
+G0 X10 Y5
+G1 X20 F1200
+G1 Y20 F600
+G1 X-20 Y-20 Z-1 F2000
+G1 X0.5 Y0.5 F3000
+G1 X0.5 Y-0.5
+G1 X0.5 Y0.5
+G1 X0.5 Y-0.5
+G1 X0.5 Y0.5
+G1 X0.5 Y-0.5
+G0 Z1
+G0 X-13 Y-5
@@ -0,0 +1,42 @@
+# Prints the build flags for a build dedicated to one machine model, as named by the
+# FLUIDNC_MACHINE environment variable, a config file such as example_configs/foo.yaml.
+# Without it, nothing is printed and the build works with any config file.
+#
+#   FLUIDNC_MACHINE=example_configs/foo.yaml pio run -e wifi
+#
+# The axis count is fixed to the one that the config file declares; see
+# FLUIDNC_FIXED_N_AXIS in FluidNC/src/Config.h.
+
+import os, sys
+
+axisLetters = "xyzabcuvw"
+
+def axis_count(path):
+    # The config file is read as plain text, since only the keys of the axes section matter
+    indent = None
+    count = 0
+    with open(path) as f:
+        for line in f:
+            text = line.split("#", 1)[0].rstrip()
+            if not text.strip():
+                continue
+            depth = len(text) - len(text.lstrip())
+            key = text.strip().split(":", 1)[0].strip().lower()
+            if indent is None:
+                if depth == 0 and key == "axes":
+                    indent = -1
+                continue
+            if depth == 0:
+                break
+            if indent == -1:
+                indent = depth
+            if depth == indent and len(key) == 1 and key in axisLetters:
+                count = max(count, axisLetters.index(key) + 1)
+    return max(count, 3)  # Senders might assume 3 axes, as in Axes::afterParse()
+
+machine = os.environ.get("FLUIDNC_MACHINE")
+if machine:
+    if not os.path.exists(machine):
+        sys.stderr.write("FLUIDNC_MACHINE names " + machine + ", which does not exist\n")
+        sys.exit(1)
+    print("-DFLUIDNC_FIXED_N_AXIS=" + str(axis_count(machine)))
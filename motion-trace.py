@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Analyze a motion trace captured with $Trace/Motion=On and $Trace/Dump.
+#
+# Usage: python motion-trace.py [--csv occupancy.csv] [trace.txt]
+#
+# Reads the [MTR:usecs,event,arg] lines from the file or from stdin, rebuilds the
+# planner and segment buffer occupancy over time, and points out where the
+# pipeline stalled: slow GCode lines, a planner that ran low, segment gaps and
+# underruns.
+
+import re, sys
+
+LINE_START, LINE_END, PLAN_BLOCK, PREP_SEGMENT, LOAD_SEGMENT, UNDERRUN = range(6)
+names = ["LineStart", "LineEnd", "PlanBlock", "PrepSegment", "LoadSegment", "Underrun"]
+
+
+def read_records(infile):
+    record = re.compile(r"\[MTR:(\d+),(\d+),(\d+)\]")
+    records = []
+    last = None
+    wraps = 0
+    for line in infile:
+        m = record.search(line)
+        if not m:
+            continue
+        usecs, event, arg = (int(g) for g in m.groups())
+        # The time is 32 bits of microseconds, so unwrap it
+        if last is not None and usecs < last:
+            wraps += 1
+        last = usecs
+        records.append((usecs + (wraps << 32), event, arg))
+    return records
+
+
+def main():
+    args = sys.argv[1:]
+    csv = None
+    if len(args) >= 2 and args[0] == "--csv":
+        csv = open(args[1], "w")
+        args = args[2:]
+    infile = open(args[0]) if args else sys.stdin
+    records = read_records(infile)
+    if not records:
+        print("No [MTR:] records found")
+        return
+
+    counts = [0] * len(names)
+    planner = segments = 0
+    line_start = None
+    slow_lines = []
+    last_load = None
+    gaps = []
+    low_planner = None
+    t0 = records[0][0]
+    if csv:
+        csv.write("ms,planner_blocks,segments\n")
+    for usecs, event, arg in records:
+        if event < len(names):
+            counts[event] += 1
+        if event == LINE_START:
+            planner = arg
+            line_start = usecs
+        elif event == LINE_END and line_start is not None:
+            slow_lines.append((usecs - line_start, line_start, arg))
+            line_start = None
+        elif event == PLAN_BLOCK:
+            planner = arg
+        elif event == PREP_SEGMENT:
+            segments = arg
+        elif event == LOAD_SEGMENT:
+            segments = arg
+            if last_load is not None:
+                gaps.append((usecs - last_load, last_load))
+            last_load = usecs
+            if low_planner is None or planner < low_planner[0]:
+                low_planner = (planner, usecs)
+        elif event == UNDERRUN:
+            print("%10.3f ms  underrun with %d planner blocks queued" % ((usecs - t0) / 1000.0, planner))
+            last_load = None
+        if csv:
+            csv.write("%.3f,%d,%d\n" % ((usecs - t0) / 1000.0, planner, segments))
+
+    span = (records[-1][0] - t0) / 1000.0
+    print("%d records over %.1f ms" % (len(records), span))
+    for name, count in zip(names, counts):
+        print("  %-12s %d" % (name, count))
+    for duration, start, status in sorted(slow_lines, reverse=True)[:5]:
+        print("slow line: %8.3f ms at %10.3f ms, status %d" % (duration / 1000.0, (start - t0) / 1000.0, status))
+    for duration, start in sorted(gaps, reverse=True)[:5]:
+        print("segment gap: %8.3f ms at %10.3f ms" % (duration / 1000.0, (start - t0) / 1000.0))
+    if low_planner:
+        print("fewest planner blocks while stepping: %d at %.3f ms" % (low_planner[0], (low_planner[1] - t0) / 1000.0))
+
+
+if __name__ == "__main__":
+    main()
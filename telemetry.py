@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+# Convert a job telemetry file, as recorded with sdcard/telemetry_ms set, to CSV.
+#
+# Usage: python telemetry.py job.nc.12.tlm [out.csv]
+#
+# The format is described in FluidNC/src/Telemetry.h: a 128 byte header, a 20 byte
+# record per sample, and a trailer of the same size.  Without out.csv the CSV goes to
+# stdout, and the summary always goes to stderr.
+
+import struct, sys
+
+HEADER = struct.Struct("<4sHHII112s")
+RECORD = struct.Struct("<IIHHHBBBBH")
+TRAILER = struct.Struct("<4sIIIB3x")
+
+states = ["Idle", "Alarm", "CheckMode", "Homing", "Cycle", "Hold", "Jog", "SafetyDoor", "Sleep", "ConfigAlarm", "Critical"]
+
+
+def main():
+    args = sys.argv[1:]
+    if not args:
+        sys.stderr.write("Usage: python telemetry.py <file.tlm> [out.csv]\n")
+        sys.exit(1)
+    data = open(args[0], "rb").read()
+    out = open(args[1], "w") if len(args) > 1 else sys.stdout
+
+    magic, version, record_size, period_ms, run, job = HEADER.unpack_from(data, 0)
+    if magic != b"FTLM" or version != 1 or record_size != RECORD.size:
+        sys.stderr.write("%s is not a version 1 telemetry file\n" % args[0])
+        sys.exit(1)
+    job = job.split(b"\0", 1)[0].decode(errors="replace")
+
+    trailer = None
+    body = data[HEADER.size:]
+    if len(body) >= TRAILER.size and body[-TRAILER.size:][:4] == b"FEND":
+        trailer = TRAILER.unpack(body[-TRAILER.size:])
+        body = body[:-TRAILER.size]
+
+    out.write("ms,line,feed,speed,actual_speed,state,alarm,feed_override,spindle_override\n")
+    count = len(body) // RECORD.size
+    for i in range(count):
+        ms, line, feed, speed, actual, state, alarm, fovr, sovr, _ = RECORD.unpack_from(body, i * RECORD.size)
+        name = states[state] if state < len(states) else str(state)
+        actual = "" if actual == 0xFFFF else str(actual)
+        out.write("%d,%d,%d,%d,%s,%s,%d,%d,%d\n" % (ms, line, feed, speed, actual, name, alarm, fovr, sovr))
+
+    sys.stderr.write("%s run %d, sampled every %d ms: %d samples\n" % (job, run, period_ms, count))
+    if trailer:
+        _, records, dropped, ms, succeeded = trailer
+        sys.stderr.write("job %s after %.1f s, %d samples lost\n" % ("succeeded" if succeeded else "failed", ms / 1000.0, dropped))
+    else:
+        sys.stderr.write("no trailer: the recording was cut short\n")
+
+
+if __name__ == "__main__":
+    main()